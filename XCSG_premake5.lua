@@ -1,4 +1,18 @@
 -- premake5 script, genrated by Code::Blocks plugin premake5cb by cacb
+
+-- a scalable allocator may be linked into the xcsg programs, e.g. premake5 --allocator=jemalloc gmake2
+newoption {
+	trigger     = "allocator",
+	value       = "NAME",
+	description = "Memory allocator linked into xcsg",
+	default     = "default",
+	allowed     = {
+		{ "default",  "System malloc" },
+		{ "jemalloc", "jemalloc, must be installed" },
+		{ "mimalloc", "mimalloc, must be installed" }
+	}
+}
+
 workspace "XCSG"
 	location "buildpm5"
 	configurations { "debug","release" } 
@@ -141,6 +155,8 @@ workspace "XCSG"
 			,"dmesh/dmesh.h"
 			,"dmesh/dpos2d.cpp"
 			,"dmesh/dpos2d.h"
+			,"dmesh/dpredicates.cpp"
+			,"dmesh/dpredicates.h"
 			,"dmesh/dprofile.cpp"
 			,"dmesh/dprofile.h"
 			,"dmesh/dtriangle.cpp"
@@ -257,7 +273,9 @@ workspace "XCSG"
 
 		-- 'files' paths are relative to premake file
 		files {
-			"csg_parser/cf_xmlNode.cpp"
+			"csg_parser/cf_number.cpp"
+			,"csg_parser/cf_number.h"
+			,"csg_parser/cf_xmlNode.cpp"
 			,"csg_parser/cf_xmlNode.h"
 			,"csg_parser/cf_xmlTree.cpp"
 			,"csg_parser/cf_xmlTree.h"
@@ -301,8 +319,14 @@ workspace "XCSG"
 
 		-- 'files' paths are relative to premake file
 		files {
-			"xcsg/amf_file.cpp"
+			"xcsg/allocator_stats.cpp"
+			,"xcsg/allocator_stats.h"
+			,"xcsg/amf_file.cpp"
 			,"xcsg/amf_file.h"
+			,"xcsg/array_pattern.cpp"
+			,"xcsg/array_pattern.h"
+			,"xcsg/boolean_engine.cpp"
+			,"xcsg/boolean_engine.h"
 			,"xcsg/boolean_timer.cpp"
 			,"xcsg/boolean_timer.h"
 			,"xcsg/boost_command_line.cpp"
@@ -321,6 +345,10 @@ workspace "XCSG"
 			,"xcsg/carve_triangulate.h"
 			,"xcsg/carve_triangulate_face.cpp"
 			,"xcsg/carve_triangulate_face.h"
+			,"xcsg/carve_union_tree.cpp"
+			,"xcsg/carve_union_tree.h"
+			,"xcsg/char_buffer.cpp"
+			,"xcsg/char_buffer.h"
 			,"xcsg/clipper_boolean.cpp"
 			,"xcsg/clipper_boolean.h"
 			,"xcsg/clipper_csg/clipper.cpp"
@@ -333,38 +361,96 @@ workspace "XCSG"
 			,"xcsg/clipper_csg/contour2d.h"
 			,"xcsg/clipper_csg/dmesh_adapter.cpp"
 			,"xcsg/clipper_csg/dmesh_adapter.h"
+			,"xcsg/clipper_csg/monotone_adapter.cpp"
+			,"xcsg/clipper_csg/monotone_adapter.h"
 			,"xcsg/clipper_csg/polygon2d.cpp"
 			,"xcsg/clipper_csg/polygon2d.h"
 			,"xcsg/clipper_csg/polymesh2d.cpp"
 			,"xcsg/clipper_csg/polymesh2d.h"
 			,"xcsg/clipper_csg/polyset2d.cpp"
 			,"xcsg/clipper_csg/polyset2d.h"
+			,"xcsg/clipper_csg/tess_pool.cpp"
+			,"xcsg/clipper_csg/tess_pool.h"
 			,"xcsg/clipper_csg/tmesh_adapter.cpp"
 			,"xcsg/clipper_csg/tmesh_adapter.h"
 			,"xcsg/clipper_csg/vmap2d.cpp"
 			,"xcsg/clipper_csg/vmap2d.h"
+			,"xcsg/compile_context.cpp"
+			,"xcsg/compile_context.h"
+			,"xcsg/cost_history.cpp"
+			,"xcsg/cost_history.h"
+			,"xcsg/decimate_mesh.cpp"
+			,"xcsg/decimate_mesh.h"
+			,"xcsg/deflate_stream.cpp"
+			,"xcsg/deflate_stream.h"
+			,"xcsg/difference_planner.cpp"
+			,"xcsg/difference_planner.h"
 			,"xcsg/dxf_file.cpp"
 			,"xcsg/dxf_file.h"
+			,"xcsg/export_hash.cpp"
+			,"xcsg/export_hash.h"
 			,"xcsg/extrude_mesh.cpp"
 			,"xcsg/extrude_mesh.h"
+			,"xcsg/face_bvh.cpp"
+			,"xcsg/face_bvh.h"
+			,"xcsg/file_watch.cpp"
+			,"xcsg/file_watch.h"
 			,"xcsg/geodesic_sphere.cpp"
 			,"xcsg/geodesic_sphere.h"
+			,"xcsg/geom_kernel.cpp"
+			,"xcsg/geom_kernel.h"
+			,"xcsg/gz_file.cpp"
+			,"xcsg/gz_file.h"
+			,"xcsg/instance_cache.cpp"
+			,"xcsg/instance_cache.h"
 			,"xcsg/main.cpp"
+			,"xcsg/malloc_tuning.cpp"
+			,"xcsg/malloc_tuning.h"
+			,"xcsg/memory_budget.cpp"
+			,"xcsg/memory_budget.h"
+			,"xcsg/mesh_cache.cpp"
+			,"xcsg/mesh_cache.h"
+			,"xcsg/mesh_estimate.cpp"
+			,"xcsg/mesh_estimate.h"
+			,"xcsg/mesh_source.cpp"
+			,"xcsg/mesh_source.h"
 			,"xcsg/mesh_utils.cpp"
 			,"xcsg/mesh_utils.h"
+			,"xcsg/message_log.cpp"
+			,"xcsg/message_log.h"
+			,"xcsg/node_profiler.cpp"
+			,"xcsg/node_profiler.h"
 			,"xcsg/openscad_csg.cpp"
 			,"xcsg/openscad_csg.h"
 			,"xcsg/out_triangles.cpp"
 			,"xcsg/out_triangles.h"
+			,"xcsg/perf_counters.cpp"
+			,"xcsg/perf_counters.h"
+			,"xcsg/phase_timer.cpp"
+			,"xcsg/phase_timer.h"
 			,"xcsg/polymesh3d.cpp"
 			,"xcsg/polymesh3d.h"
+			,"xcsg/primitive_boolean.cpp"
+			,"xcsg/primitive_boolean.h"
+			,"xcsg/primitive_cache.cpp"
+			,"xcsg/primitive_cache.h"
 			,"xcsg/primitives2d.cpp"
 			,"xcsg/primitives2d.h"
 			,"xcsg/primitives3d.cpp"
 			,"xcsg/primitives3d.h"
 			,"xcsg/project_mesh.cpp"
 			,"xcsg/project_mesh.h"
+			,"xcsg/remote_executor.cpp"
+			,"xcsg/remote_executor.h"
 			,"xcsg/safe_queue.h"
+			,"xcsg/sdf_engine.cpp"
+			,"xcsg/sdf_engine.h"
+			,"xcsg/server_metrics.cpp"
+			,"xcsg/server_metrics.h"
+			,"xcsg/slice_mesh.cpp"
+			,"xcsg/slice_mesh.h"
+			,"xcsg/snap_engine.cpp"
+			,"xcsg/snap_engine.h"
 			,"xcsg/std_filename.cpp"
 			,"xcsg/std_filename.h"
 			,"xcsg/svg_file.cpp"
@@ -381,17 +467,33 @@ workspace "XCSG"
 			,"xcsg/sweep_path_spline.h"
 			,"xcsg/sweep_path_transform.cpp"
 			,"xcsg/sweep_path_transform.h"
+			,"xcsg/thread_pool.cpp"
+			,"xcsg/thread_pool.h"
 			,"xcsg/tin_mesh.cpp"
 			,"xcsg/tin_mesh.h"
+			,"xcsg/trace_recorder.cpp"
+			,"xcsg/trace_recorder.h"
+			,"xcsg/triangle_mesh.cpp"
+			,"xcsg/triangle_mesh.h"
 			,"xcsg/version.h"
+			,"xcsg/xarray2d.cpp"
+			,"xcsg/xarray2d.h"
+			,"xcsg/xarray3d.cpp"
+			,"xcsg/xarray3d.h"
+			,"xcsg/xbox3d.cpp"
+			,"xcsg/xbox3d.h"
 			,"xcsg/xcircle.cpp"
 			,"xcsg/xcircle.h"
 			,"xcsg/xcone.cpp"
 			,"xcsg/xcone.h"
+			,"xcsg/xcsg_compiler.cpp"
+			,"xcsg/xcsg_compiler.h"
 			,"xcsg/xcsg_factory.cpp"
 			,"xcsg/xcsg_factory.h"
 			,"xcsg/xcsg_main.cpp"
 			,"xcsg/xcsg_main.h"
+			,"xcsg/xcsg_server.cpp"
+			,"xcsg/xcsg_server.h"
 			,"xcsg/xcube.cpp"
 			,"xcsg/xcube.h"
 			,"xcsg/xcuboid.cpp"
@@ -410,12 +512,16 @@ workspace "XCSG"
 			,"xcsg/xhull2d.h"
 			,"xcsg/xhull3d.cpp"
 			,"xcsg/xhull3d.h"
+			,"xcsg/ximport3d.cpp"
+			,"xcsg/ximport3d.h"
 			,"xcsg/xintersection2d.cpp"
 			,"xcsg/xintersection2d.h"
 			,"xcsg/xintersection3d.cpp"
 			,"xcsg/xintersection3d.h"
 			,"xcsg/xlinear_extrude.cpp"
 			,"xcsg/xlinear_extrude.h"
+			,"xcsg/xmesh_file.cpp"
+			,"xcsg/xmesh_file.h"
 			,"xcsg/xminkowski2d.cpp"
 			,"xcsg/xminkowski2d.h"
 			,"xcsg/xminkowski3d.cpp"
@@ -426,6 +532,10 @@ workspace "XCSG"
 			,"xcsg/xpolygon.h"
 			,"xcsg/xpolyhedron.cpp"
 			,"xcsg/xpolyhedron.h"
+			,"xcsg/xprofiled_shape2d.cpp"
+			,"xcsg/xprofiled_shape2d.h"
+			,"xcsg/xprofiled_solid.cpp"
+			,"xcsg/xprofiled_solid.h"
 			,"xcsg/xprojection2d.cpp"
 			,"xcsg/xprojection2d.h"
 			,"xcsg/xrectangle.cpp"
@@ -438,6 +548,8 @@ workspace "XCSG"
 			,"xcsg/xshape2d.h"
 			,"xcsg/xshape2d_collector.cpp"
 			,"xcsg/xshape2d_collector.h"
+			,"xcsg/xshared_solid.cpp"
+			,"xcsg/xshared_solid.h"
 			,"xcsg/xsolid.cpp"
 			,"xcsg/xsolid.h"
 			,"xcsg/xsolid_collector.cpp"
@@ -450,6 +562,8 @@ workspace "XCSG"
 			,"xcsg/xsquare.h"
 			,"xcsg/xsweep.cpp"
 			,"xcsg/xsweep.h"
+			,"xcsg/xsymmetry3d.cpp"
+			,"xcsg/xsymmetry3d.h"
 			,"xcsg/xtin_model.cpp"
 			,"xcsg/xtin_model.h"
 			,"xcsg/xtmatrix.cpp"
@@ -460,13 +574,15 @@ workspace "XCSG"
 			,"xcsg/xunion2d.h"
 			,"xcsg/xunion3d.cpp"
 			,"xcsg/xunion3d.h"
+			,"xcsg/zip_file.cpp"
+			,"xcsg/zip_file.h"
 			}
 
 		filter { "configurations:debug" }
 			defines  ( "DEBUG" ) 
 			kind ( "ConsoleApp" ) 
 			-- When linking within workspace, 'links' refer to project name.
-			links { "carve","csg_parser","csplines","dmesh","qhull","tmesh" } 
+			links { "carve","csg_parser","csplines","dmesh","qhull","tmesh","z" } 
 			symbols  ( "on" ) 
 		filter { }
 
@@ -474,6 +590,227 @@ workspace "XCSG"
 			defines  ( "NDEBUG" ) 
 			kind ( "ConsoleApp" ) 
 			-- When linking within workspace, 'links' refer to project name.
-			links { "carve","csg_parser","csplines","dmesh","qhull","tmesh" } 
+			links { "carve","csg_parser","csplines","dmesh","qhull","tmesh","z" } 
+			optimize  ( "on" ) 
+		filter { }
+
+		filter { "options:allocator=jemalloc" }
+			defines  ( "XCSG_JEMALLOC" ) 
+			links { "jemalloc" } 
+		filter { }
+
+		filter { "options:allocator=mimalloc" }
+			defines  ( "XCSG_MIMALLOC" ) 
+			links { "mimalloc" } 
+		filter { }
+
+	project "libxcsg"
+		location "buildpm5/libxcsg"
+		architecture  ( "x86_64" ) 
+		cppdialect  ( "c++17" ) 
+		dependson { "csg_parser","csplines","dmesh","qhull","tmesh" } 
+		exceptionhandling  ( "on" ) 
+		includedirs { ".","csg_parser","csplines","dmesh","qhull","tmesh","xcsg" } 
+		language  ( "c++" ) 
+		pic  ( "on" ) 
+		rtti  ( "on" ) 
+		staticruntime  ( "off" ) 
+		targetname ( "xcsg" ) 
+
+		-- 'files' paths are relative to premake file.
+		-- The library for embedding xcsg contains the xcsg sources, except the xcsg main program.
+		-- Programs using it call xcsg_compiler, see xcsg/xcsg_compiler.h
+		files {
+			"xcsg/**.cpp"
+			,"xcsg/**.h"
+			}
+		removefiles {
+			"xcsg/main.cpp"
+			,"xcsg/xsoffset2d.cpp"
+			,"xcsg/xsoffset2d.h"
+			}
+
+		filter { "configurations:debug" }
+			defines  ( "DEBUG" ) 
+			kind ( "StaticLib" ) 
+			symbols  ( "on" ) 
+		filter { }
+
+		filter { "configurations:release" }
+			defines  ( "NDEBUG" ) 
+			kind ( "StaticLib" ) 
+			optimize  ( "on" ) 
+		filter { }
+
+		filter { "options:allocator=jemalloc" }
+			defines  ( "XCSG_JEMALLOC" ) 
+		filter { }
+
+		filter { "options:allocator=mimalloc" }
+			defines  ( "XCSG_MIMALLOC" ) 
+		filter { }
+
+	project "xcsg_bench"
+		location "buildpm5/xcsg_bench"
+		architecture  ( "x86_64" ) 
+		cppdialect  ( "c++17" ) 
+		dependson { "xcsg" } 
+		exceptionhandling  ( "on" ) 
+		language  ( "c++" ) 
+		rtti  ( "on" ) 
+		staticruntime  ( "off" ) 
+
+		-- 'files' paths are relative to premake file
+		files {
+			"xcsg_bench/xcsg_bench.cpp"
+			}
+
+		filter { "configurations:debug" }
+			defines  ( "DEBUG" ) 
+			kind ( "ConsoleApp" ) 
+			symbols  ( "on" ) 
+		filter { }
+
+		filter { "configurations:release" }
+			defines  ( "NDEBUG" ) 
+			kind ( "ConsoleApp" ) 
+			optimize  ( "on" ) 
+		filter { }
+
+	project "xcsg_gen"
+		location "buildpm5/xcsg_gen"
+		architecture  ( "x86_64" ) 
+		cppdialect  ( "c++17" ) 
+		exceptionhandling  ( "on" ) 
+		language  ( "c++" ) 
+		rtti  ( "on" ) 
+		staticruntime  ( "off" ) 
+
+		-- 'files' paths are relative to premake file
+		files {
+			"xcsg_bench/xcsg_gen.cpp"
+			}
+
+		filter { "configurations:debug" }
+			defines  ( "DEBUG" ) 
+			kind ( "ConsoleApp" ) 
+			symbols  ( "on" ) 
+		filter { }
+
+		filter { "configurations:release" }
+			defines  ( "NDEBUG" ) 
+			kind ( "ConsoleApp" ) 
 			optimize  ( "on" ) 
 		filter { }
+
+	project "xcsg_bench_compare"
+		location "buildpm5/xcsg_bench_compare"
+		architecture  ( "x86_64" ) 
+		cppdialect  ( "c++17" ) 
+		exceptionhandling  ( "on" ) 
+		language  ( "c++" ) 
+		rtti  ( "on" ) 
+		staticruntime  ( "off" ) 
+
+		-- 'files' paths are relative to premake file
+		files {
+			"xcsg_bench/xcsg_bench_compare.cpp"
+			}
+
+		filter { "configurations:debug" }
+			defines  ( "DEBUG" ) 
+			kind ( "ConsoleApp" ) 
+			symbols  ( "on" ) 
+		filter { }
+
+		filter { "configurations:release" }
+			defines  ( "NDEBUG" ) 
+			kind ( "ConsoleApp" ) 
+			optimize  ( "on" ) 
+		filter { }
+
+	project "xcsg_kernel_bench"
+		location "buildpm5/xcsg_kernel_bench"
+		architecture  ( "x86_64" ) 
+		cppdialect  ( "c++17" ) 
+		dependson { "libxcsg","csg_parser","csplines","dmesh","qhull","tmesh" } 
+		exceptionhandling  ( "on" ) 
+		includedirs { ".","csg_parser","csplines","dmesh","qhull","tmesh","xcsg" } 
+		language  ( "c++" ) 
+		rtti  ( "on" ) 
+		staticruntime  ( "off" ) 
+
+		-- 'files' paths are relative to premake file.
+		-- The kernels are linked in from the libxcsg library
+		files {
+			"xcsg_bench/kernel_bench.cpp"
+			}
+
+		filter { "configurations:debug" }
+			defines  ( "DEBUG" ) 
+			kind ( "ConsoleApp" ) 
+			-- When linking within workspace, 'links' refer to project name.
+			links { "libxcsg","carve","csg_parser","csplines","dmesh","qhull","tmesh","z" } 
+			symbols  ( "on" ) 
+		filter { }
+
+		filter { "configurations:release" }
+			defines  ( "NDEBUG" ) 
+			kind ( "ConsoleApp" ) 
+			-- When linking within workspace, 'links' refer to project name.
+			links { "libxcsg","carve","csg_parser","csplines","dmesh","qhull","tmesh","z" } 
+			optimize  ( "on" ) 
+		filter { }
+
+		filter { "options:allocator=jemalloc" }
+			defines  ( "XCSG_JEMALLOC" ) 
+			links { "jemalloc" } 
+		filter { }
+
+		filter { "options:allocator=mimalloc" }
+			defines  ( "XCSG_MIMALLOC" ) 
+			links { "mimalloc" } 
+		filter { }
+
+	project "xcsg_replay"
+		location "buildpm5/xcsg_replay"
+		architecture  ( "x86_64" ) 
+		cppdialect  ( "c++17" ) 
+		dependson { "libxcsg","csg_parser","csplines","dmesh","qhull","tmesh" } 
+		exceptionhandling  ( "on" ) 
+		includedirs { ".","csg_parser","csplines","dmesh","qhull","tmesh","xcsg" } 
+		language  ( "c++" ) 
+		rtti  ( "on" ) 
+		staticruntime  ( "off" ) 
+
+		-- 'files' paths are relative to premake file.
+		-- The captured booleans are replayed with the libxcsg library
+		files {
+			"xcsg_bench/xcsg_replay.cpp"
+			}
+
+		filter { "configurations:debug" }
+			defines  ( "DEBUG" ) 
+			kind ( "ConsoleApp" ) 
+			-- When linking within workspace, 'links' refer to project name.
+			links { "libxcsg","carve","csg_parser","csplines","dmesh","qhull","tmesh","z" } 
+			symbols  ( "on" ) 
+		filter { }
+
+		filter { "configurations:release" }
+			defines  ( "NDEBUG" ) 
+			kind ( "ConsoleApp" ) 
+			-- When linking within workspace, 'links' refer to project name.
+			links { "libxcsg","carve","csg_parser","csplines","dmesh","qhull","tmesh","z" } 
+			optimize  ( "on" ) 
+		filter { }
+
+		filter { "options:allocator=jemalloc" }
+			defines  ( "XCSG_JEMALLOC" ) 
+			links { "jemalloc" } 
+		filter { }
+
+		filter { "options:allocator=mimalloc" }
+			defines  ( "XCSG_MIMALLOC" ) 
+			links { "mimalloc" } 
+		filter { }
@@ -0,0 +1,67 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "cf_number.h"
+
+#include <cctype>
+#include <locale>
+#include <sstream>
+
+// std::from_chars for double requires C++17 and a recent standard library
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define CF_NUMBER_FROM_CHARS
+#endif
+#endif
+
+// strip surrounding white space and a leading '+', which std::from_chars does not accept
+static bool trim(const std::string& text, const char*& first, const char*& last)
+{
+   first = text.data();
+   last  = first + text.size();
+   while(first<last && isspace(static_cast<unsigned char>(*first))) first++;
+   while(last>first && isspace(static_cast<unsigned char>(*(last-1)))) last--;
+   if(first<last && *first == '+') first++;
+   return (first != last);
+}
+
+template <typename T>
+static bool from_text(const std::string& text, T& value)
+{
+   const char* first = 0;
+   const char* last  = 0;
+   if(!trim(text,first,last)) return false;
+
+#ifdef CF_NUMBER_FROM_CHARS
+   std::from_chars_result res = std::from_chars(first,last,value);
+   return (res.ec == std::errc() && res.ptr == last);
+#else
+   std::istringstream in(std::string(first,last));
+   in.imbue(std::locale::classic());
+   in >> value;
+   return (!in.fail() && in.peek() == std::char_traits<char>::eof());
+#endif
+}
+
+bool cf_to_double(const std::string& text, double& value)
+{
+   return from_text(text,value);
+}
+
+bool cf_to_int(const std::string& text, int& value)
+{
+   return from_text(text,value);
+}
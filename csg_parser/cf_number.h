@@ -0,0 +1,26 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef CF_NUMBER_H
+#define CF_NUMBER_H
+
+#include <string>
+
+// locale independent conversion of the complete text to a number, surrounding white space
+// and a leading '+' allowed. Returns false if the text is not a number or out of range.
+bool cf_to_double(const std::string& text, double& value);
+bool cf_to_int(const std::string& text, int& value);
+
+#endif // CF_NUMBER_H
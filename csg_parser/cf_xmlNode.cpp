@@ -14,6 +14,7 @@
 // EndLicense:
 
 #include "cf_xmlNode.h"
+#include "cf_number.h"
 
 #include <boost/algorithm/string.hpp>
 using namespace std;
@@ -143,15 +144,46 @@ int    cf_xmlNode::get_property(const string& name, int default_value) const
 
 double cf_xmlNode::get_property(const string& name, double default_value) const
 {
+   // direct lookup of the attribute and conversion of its text, this avoids
+   // the path parsing and stream based conversion of ptree::get_optional
    if(m_ptree_node) {
-      string attrib = "<xmlattr>." + name;
-      boost::optional<double> v = m_ptree_node.get().get_optional<double>(attrib);
-      if(v) return v.get();
-      return  default_value;
+      const ptree& node = m_ptree_node.get();
+      ptree::const_assoc_iterator iattr = node.find("<xmlattr>");
+      if(iattr != node.not_found()) {
+         ptree::const_assoc_iterator iprop = iattr->second.find(name);
+         if(iprop != iattr->second.not_found()) {
+            double value = 0.0;
+            if(cf_to_double(iprop->second.data(),value)) return value;
+         }
+      }
    }
    return  default_value;
 }
 
+size_t cf_xmlNode::get_properties(const char* const names[], size_t n, double values[]) const
+{
+   size_t nfound = 0;
+   if(m_ptree_node) {
+      const ptree& node = m_ptree_node.get();
+      ptree::const_assoc_iterator iattr = node.find("<xmlattr>");
+      if(iattr != node.not_found()) {
+         for(auto& prop : iattr->second) {
+            for(size_t i=0; i<n; i++) {
+               if(prop.first == names[i]) {
+                  double value = 0.0;
+                  if(cf_to_double(prop.second.data(),value)) {
+                     values[i] = value;
+                     nfound++;
+                  }
+                  break;
+               }
+            }
+         }
+      }
+   }
+   return nfound;
+}
+
 bool cf_xmlNode::put_value(const string& value)
 {
    if(m_ptree_node) {
@@ -245,12 +277,22 @@ cf_xmlNode cf_xmlNode::add_child(const string& tag)
    return cf_xmlNode();
 }
 
+cf_xmlNode cf_xmlNode::add_child(const cf_xmlNode& node)
+{
+   if(m_ptree_node && node.m_ptree_node) {
+      return cf_xmlNode(node.m_tag, m_ptree_node.get().add_child(node.m_tag,node.m_ptree_node.get()));
+   }
+   return cf_xmlNode();
+}
+
 bool cf_xmlNode::get_child(const string& tag, cf_xmlNode& child) const
 {
+   // direct lookup of the immediate child, tags are never paths
    if(m_ptree_node) {
-      boost::optional<ptree &> child_node = m_ptree_node.get().get_child_optional(tag);
-      if(child_node) {
-         child = cf_xmlNode(tag, child_node.get());
+      ptree& node = m_ptree_node.get();
+      ptree::assoc_iterator ichild = node.find(tag);
+      if(ichild != node.not_found()) {
+         child = cf_xmlNode(tag, ichild->second);
          return true;
       }
    }
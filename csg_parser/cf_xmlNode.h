@@ -61,6 +61,11 @@ public:
    int    get_property(const string& name, int default_value) const;
    double get_property(const string& name, double default_value) const;
 
+   // return n numeric properties in one pass over the attributes of this node.
+   // values[i] is left unchanged if property names[i] is not found or not a number.
+   // Returns the number of properties found
+   size_t get_properties(const char* const names[], size_t n, double values[]) const;
+
    // store a value directly in this node <tag> value </tag>
    bool put_value(const string& value);
    bool put_value(size_t value);
@@ -81,6 +86,9 @@ public:
    // add a child node to this node, return a child reference
    cf_xmlNode add_child(const string& tag);
 
+   // add a copy of node and all its children as a child of this node, return a child reference
+   cf_xmlNode add_child(const cf_xmlNode& node);
+
    // return the (first) named child if such exists
    bool get_child(const string& tag, cf_xmlNode& child) const;
 
@@ -15,8 +15,20 @@
 
 #include "cf_xmlTree.h"
 #include <fstream>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <iterator>
+#include <map>
+#include <unordered_map>
+#include <stdexcept>
 #include <boost/property_tree/xml_parser.hpp>
 #include <boost/property_tree/json_parser.hpp>
+#include <boost/property_tree/detail/rapidxml.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <boost/filesystem.hpp>
 
 cf_xmlTree::cf_xmlTree()
 {}
@@ -78,9 +90,234 @@ bool cf_xmlTree::read_xml(istream& is)
 
 bool cf_xmlTree::read_xml(const string& path)
 {
-   ifstream in(path.c_str());
-   if(in.is_open()) {
-      return read_xml(in);
+   // The file is memory mapped and copied in one block to a zero terminated buffer,
+   // which is parsed in place by rapidxml. This avoids reading the stream character
+   // by character as boost::property_tree::read_xml does. The resulting tree is the
+   // same as from read_xml(istream&).
+   boost::system::error_code ec;
+   uintmax_t file_size = boost::filesystem::file_size(path,ec);
+   if(ec) return false;
+
+   std::vector<char> buffer(static_cast<size_t>(file_size)+1,0);
+   if(file_size > 0) {
+      try {
+         boost::interprocess::file_mapping  file(path.c_str(),boost::interprocess::read_only);
+         boost::interprocess::mapped_region region(file,boost::interprocess::read_only);
+         std::memcpy(buffer.data(),region.get_address(),static_cast<size_t>(file_size));
+      }
+      catch(boost::interprocess::interprocess_exception&) {
+         return false;
+      }
+   }
+
+   using namespace boost::property_tree;
+   using namespace boost::property_tree::detail::rapidxml;
+   const int flags = xml_parser::trim_whitespace;
+   const int parse_flags = parse_normalize_whitespace | parse_trim_whitespace | parse_comment_nodes;
+
+   ptree local;
+   try {
+      xml_document<char> doc;
+      doc.parse<parse_flags>(buffer.data());
+      for(xml_node<char>* child = doc.first_node(); child; child = child->next_sibling()) {
+         xml_parser::read_xml_node(child,local,flags);
+      }
+   }
+   catch(parse_error& e) {
+      long line = static_cast<long>(std::count(buffer.data(),e.where<char>(),'\n') + 1);
+      BOOST_PROPERTY_TREE_THROW(xml_parser::xml_parser_error(e.what(),path,line));
+   }
+
+   m_tree.swap(local);
+   if(m_tree.size() == 1) {
+      ptree::iterator i=m_tree.begin();
+      m_root_name = i->first;
+      return true;
+   }
+   return false;
+}
+
+// binary format:
+//    "XCSB" version
+//    nkeys, nkeys * ( length, characters )
+//    root node
+// node:
+//    length, characters of node value
+//    nchildren, nchildren * ( key index, node )
+// All integers are unsigned LEB128 varints, 7 bits per byte starting with the least significant.
+// Attributes are stored as children of the "<xmlattr>" node as in XML.
+
+static const char     binary_magic[]  = { 'X','C','S','B' };
+static const uint32_t binary_version  = 1;
+
+static void put_uint32(std::string& out, uint32_t value)
+{
+   while(value >= 0x80) {
+      out.push_back(char((value & 0x7f) | 0x80));
+      value >>= 7;
+   }
+   out.push_back(char(value));
+}
+
+static void put_string(std::string& out, const std::string& value)
+{
+   put_uint32(out,static_cast<uint32_t>(value.size()));
+   out.append(value);
+}
+
+static void collect_keys(const cf_xmlTree::ptree& node, std::map<std::string,uint32_t>& keys)
+{
+   for(auto& child : node) {
+      keys.insert(std::make_pair(child.first,static_cast<uint32_t>(keys.size())));
+      collect_keys(child.second,keys);
+   }
+}
+
+static void put_node(std::string& out, const cf_xmlTree::ptree& node, const std::map<std::string,uint32_t>& keys)
+{
+   put_string(out,node.data());
+   put_uint32(out,static_cast<uint32_t>(node.size()));
+   for(auto& child : node) {
+      put_uint32(out,keys.find(child.first)->second);
+      put_node(out,child.second,keys);
+   }
+}
+
+// reads the binary format from a memory buffer, throws std::runtime_error when the data is truncated or corrupt
+class binary_reader {
+public:
+   binary_reader(const char* begin, const char* end) : m_p(begin), m_end(end) {}
+
+   bool at_end() const { return m_p == m_end; }
+
+   uint32_t get_uint32()
+   {
+      uint32_t value = 0;
+      for(int shift=0; shift<32; shift+=7) {
+         check(1);
+         unsigned char b = static_cast<unsigned char>(*m_p++);
+         value |= uint32_t(b & 0x7f) << shift;
+         if((b & 0x80) == 0) return value;
+      }
+      throw std::runtime_error("cf_xmlTree::read_binary, invalid integer");
+   }
+
+   void get_string(std::string& value)
+   {
+      uint32_t len = get_uint32();
+      check(len);
+      value.assign(m_p,len);
+      m_p += len;
+   }
+
+   // children are created by copying an empty child with the right key, this avoids
+   // creating and copying a temporary for every child
+   void get_node(cf_xmlTree::ptree& node, const std::vector<cf_xmlTree::ptree::value_type>& keys)
+   {
+      get_string(node.data());
+      uint32_t nchildren = get_uint32();
+      for(uint32_t i=0; i<nchildren; i++) {
+         uint32_t ikey = get_uint32();
+         if(ikey >= keys.size()) throw std::runtime_error("cf_xmlTree::read_binary, invalid key index");
+         cf_xmlTree::ptree& child = node.push_back(keys[ikey])->second;
+         get_node(child,keys);
+      }
+   }
+
+private:
+   void check(size_t nbytes) const
+   {
+      if(size_t(m_end-m_p) < nbytes) throw std::runtime_error("cf_xmlTree::read_binary, unexpected end of data");
+   }
+
+private:
+   const char* m_p;
+   const char* m_end;
+};
+
+static bool read_binary_buffer(const char* begin, const char* end, cf_xmlTree::ptree& tree)
+{
+   if(size_t(end-begin) < sizeof(binary_magic) || std::memcmp(begin,binary_magic,sizeof(binary_magic)) != 0) return false;
+
+   binary_reader reader(begin+sizeof(binary_magic),end);
+   uint32_t version = reader.get_uint32();
+   if(version != binary_version) throw std::runtime_error("cf_xmlTree::read_binary, unsupported version " + std::to_string(version));
+
+   std::vector<cf_xmlTree::ptree::value_type> keys;
+   uint32_t nkeys = reader.get_uint32();
+   std::string key;
+   for(uint32_t i=0; i<nkeys; i++) {
+      reader.get_string(key);
+      keys.push_back(cf_xmlTree::ptree::value_type(key,cf_xmlTree::ptree()));
+   }
+
+   reader.get_node(tree,keys);
+   if(!reader.at_end()) throw std::runtime_error("cf_xmlTree::read_binary, unexpected data after tree");
+   return true;
+}
+
+bool cf_xmlTree::write_binary(ostream& os)
+{
+   std::map<std::string,uint32_t> key_map;
+   collect_keys(m_tree,key_map);
+   std::vector<const std::string*> keys(key_map.size());
+   for(auto& k : key_map) keys[k.second] = &k.first;
+
+   std::string out(binary_magic,sizeof(binary_magic));
+   put_uint32(out,binary_version);
+   put_uint32(out,static_cast<uint32_t>(keys.size()));
+   for(auto key : keys) put_string(out,*key);
+   put_node(out,m_tree,key_map);
+
+   os.write(out.data(),out.size());
+   return os.good();
+}
+
+bool cf_xmlTree::write_binary(const string& path)
+{
+   ofstream out(path.c_str(),std::ios::binary);
+   return write_binary(out);
+}
+
+bool cf_xmlTree::read_binary(istream& is)
+{
+   std::vector<char> buffer((std::istreambuf_iterator<char>(is)),std::istreambuf_iterator<char>());
+
+   ptree local;
+   if(!read_binary_buffer(buffer.data(),buffer.data()+buffer.size(),local)) return false;
+
+   m_tree.swap(local);
+   if(m_tree.size() == 1) {
+      ptree::iterator i=m_tree.begin();
+      m_root_name = i->first;
+      return true;
+   }
+   return false;
+}
+
+bool cf_xmlTree::read_binary(const string& path)
+{
+   // the file is memory mapped and decoded directly from the mapped region
+   boost::system::error_code ec;
+   uintmax_t file_size = boost::filesystem::file_size(path,ec);
+   if(ec || file_size == 0) return false;
+
+   ptree local;
+   try {
+      boost::interprocess::file_mapping  file(path.c_str(),boost::interprocess::read_only);
+      boost::interprocess::mapped_region region(file,boost::interprocess::read_only);
+      const char* begin = static_cast<const char*>(region.get_address());
+      if(!read_binary_buffer(begin,begin+static_cast<size_t>(file_size),local)) return false;
+   }
+   catch(boost::interprocess::interprocess_exception&) {
+      return false;
+   }
+
+   m_tree.swap(local);
+   if(m_tree.size() == 1) {
+      ptree::iterator i=m_tree.begin();
+      m_root_name = i->first;
+      return true;
    }
    return false;
 }
@@ -99,10 +336,225 @@ bool cf_xmlTree::write_json(const string& path, bool pretty)
 }
 
 
+// json_reader parses JSON from a memory buffer into a ptree, with the same result as
+// boost::property_tree::read_json: object members become children with their names as keys,
+// array elements become children with empty keys and all values are stored as text.
+// The input is scanned once, strings without escapes are copied in one block.
+class json_reader {
+public:
+   typedef cf_xmlTree::ptree ptree;
+
+   json_reader(const char* begin, const char* end, const std::string& filename)
+   : m_begin(begin), m_p(begin), m_end(end), m_filename(filename) {}
+
+   void parse(ptree& root)
+   {
+      skip_ws();
+      if(peek() == '{')      parse_object(root);
+      else if(peek() == '[') parse_array(root);
+      else error("expected object or array");
+      skip_ws();
+      if(m_p != m_end) error("garbage after data");
+   }
+
+private:
+   char peek() const { return (m_p < m_end)? *m_p : '\0'; }
+
+   void skip_ws()
+   {
+      while(m_p < m_end && (*m_p==' ' || *m_p=='\t' || *m_p=='\n' || *m_p=='\r')) m_p++;
+   }
+
+   void expect(char c, const char* msg)
+   {
+      skip_ws();
+      if(peek() != c) error(msg);
+      m_p++;
+   }
+
+   // add a child with the given key, the empty children are copied from one template per key
+   ptree& add_child(ptree& node, const std::string& key)
+   {
+      auto it = m_templates.find(key);
+      if(it == m_templates.end()) it = m_templates.insert(std::make_pair(key,ptree::value_type(key,ptree()))).first;
+      return node.push_back(it->second)->second;
+   }
+
+   void parse_value(ptree& node)
+   {
+      skip_ws();
+      switch(peek()) {
+         case '{': { parse_object(node); break; }
+         case '[': { parse_array(node); break; }
+         case '"': { parse_string(node.data()); break; }
+         case 't': { parse_literal("true",node.data()); break; }
+         case 'f': { parse_literal("false",node.data()); break; }
+         case 'n': { parse_literal("null",node.data()); break; }
+         default:  { parse_number(node.data()); break; }
+      };
+   }
+
+   void parse_object(ptree& node)
+   {
+      m_p++;
+      skip_ws();
+      if(peek() == '}') { m_p++; return; }
+      std::string key;
+      while(true) {
+         skip_ws();
+         if(peek() != '"') error("expected member name");
+         parse_string(key);
+         expect(':',"expected ':'");
+         parse_value(add_child(node,key));
+         skip_ws();
+         if(peek() == ',') { m_p++; continue; }
+         expect('}',"expected ',' or '}'");
+         return;
+      }
+   }
+
+   void parse_array(ptree& node)
+   {
+      m_p++;
+      skip_ws();
+      if(peek() == ']') { m_p++; return; }
+      const std::string key;
+      while(true) {
+         parse_value(add_child(node,key));
+         skip_ws();
+         if(peek() == ',') { m_p++; continue; }
+         expect(']',"expected ',' or ']'");
+         return;
+      }
+   }
+
+   void parse_literal(const char* literal, std::string& value)
+   {
+      size_t len = std::strlen(literal);
+      if(size_t(m_end-m_p) < len || std::memcmp(m_p,literal,len) != 0) error("invalid literal");
+      value.assign(m_p,len);
+      m_p += len;
+   }
+
+   void parse_number(std::string& value)
+   {
+      const char* start = m_p;
+      if(peek() == '-') m_p++;
+      size_t ndigits = 0;
+      while(m_p < m_end) {
+         char c = *m_p;
+         if(c>='0' && c<='9') ndigits++;
+         else if(c!='.' && c!='e' && c!='E' && c!='+' && c!='-') break;
+         m_p++;
+      }
+      if(ndigits == 0) error("expected value");
+      value.assign(start,m_p);
+   }
+
+   void parse_string(std::string& value)
+   {
+      m_p++;
+      value.clear();
+      while(true) {
+         // copy the run of plain characters in one block
+         const char* run = m_p;
+         while(m_p < m_end && *m_p != '"' && *m_p != '\\') m_p++;
+         value.append(run,m_p);
+         if(m_p == m_end) error("unterminated string");
+         if(*m_p++ == '"') return;
+
+         // escape sequence
+         if(m_p == m_end) error("unterminated string");
+         char c = *m_p++;
+         switch(c) {
+            case '"':  { value += '"'; break; }
+            case '\\': { value += '\\'; break; }
+            case '/':  { value += '/'; break; }
+            case 'b':  { value += '\b'; break; }
+            case 'f':  { value += '\f'; break; }
+            case 'n':  { value += '\n'; break; }
+            case 'r':  { value += '\r'; break; }
+            case 't':  { value += '\t'; break; }
+            case 'u':  { append_utf8(value,parse_codepoint()); break; }
+            default:   { error("invalid escape sequence"); }
+         };
+      }
+   }
+
+   unsigned long parse_hex4()
+   {
+      if(m_end-m_p < 4) error("invalid escape sequence");
+      unsigned long value = 0;
+      for(int i=0; i<4; i++) {
+         char c = *m_p++;
+         value <<= 4;
+         if(c>='0' && c<='9')      value += c-'0';
+         else if(c>='a' && c<='f') value += c-'a'+10;
+         else if(c>='A' && c<='F') value += c-'A'+10;
+         else error("invalid escape sequence");
+      }
+      return value;
+   }
+
+   unsigned long parse_codepoint()
+   {
+      unsigned long cp = parse_hex4();
+      if(cp >= 0xD800 && cp < 0xDC00) {
+         // surrogate pair
+         if(m_end-m_p < 2 || m_p[0] != '\\' || m_p[1] != 'u') error("invalid surrogate pair");
+         m_p += 2;
+         unsigned long low = parse_hex4();
+         if(low < 0xDC00 || low >= 0xE000) error("invalid surrogate pair");
+         cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+      }
+      return cp;
+   }
+
+   static void append_utf8(std::string& value, unsigned long cp)
+   {
+      if(cp < 0x80) {
+         value += char(cp);
+      }
+      else if(cp < 0x800) {
+         value += char(0xC0 | (cp >> 6));
+         value += char(0x80 | (cp & 0x3F));
+      }
+      else if(cp < 0x10000) {
+         value += char(0xE0 | (cp >> 12));
+         value += char(0x80 | ((cp >> 6) & 0x3F));
+         value += char(0x80 | (cp & 0x3F));
+      }
+      else {
+         value += char(0xF0 | (cp >> 18));
+         value += char(0x80 | ((cp >> 12) & 0x3F));
+         value += char(0x80 | ((cp >> 6) & 0x3F));
+         value += char(0x80 | (cp & 0x3F));
+      }
+   }
+
+   void error(const char* msg) const
+   {
+      unsigned long line = static_cast<unsigned long>(std::count(m_begin,m_p,'\n') + 1);
+      BOOST_PROPERTY_TREE_THROW(boost::property_tree::json_parser::json_parser_error(msg,m_filename,line));
+   }
+
+private:
+   const char*  m_begin;
+   const char*  m_p;
+   const char*  m_end;
+   std::string  m_filename;
+   std::unordered_map<std::string,ptree::value_type> m_templates;
+};
+
 bool cf_xmlTree::read_json(istream& is)
 {
-   m_tree = ptree();
-   boost::property_tree::read_json(is,m_tree);
+   std::vector<char> buffer((std::istreambuf_iterator<char>(is)),std::istreambuf_iterator<char>());
+
+   ptree local;
+   json_reader reader(buffer.data(),buffer.data()+buffer.size(),"");
+   reader.parse(local);
+
+   m_tree.swap(local);
    if(m_tree.size() == 1) {
       ptree::iterator i=m_tree.begin();
       m_root_name = i->first;
@@ -113,9 +565,28 @@ bool cf_xmlTree::read_json(istream& is)
 
 bool cf_xmlTree::read_json(const string& path)
 {
-   ifstream in(path.c_str());
-   if(in.is_open()) {
-      return read_json(in);
+   // the file is memory mapped and parsed directly from the mapped region
+   boost::system::error_code ec;
+   uintmax_t file_size = boost::filesystem::file_size(path,ec);
+   if(ec || file_size == 0) return false;
+
+   ptree local;
+   try {
+      boost::interprocess::file_mapping  file(path.c_str(),boost::interprocess::read_only);
+      boost::interprocess::mapped_region region(file,boost::interprocess::read_only);
+      const char* begin = static_cast<const char*>(region.get_address());
+      json_reader reader(begin,begin+static_cast<size_t>(file_size),path);
+      reader.parse(local);
+   }
+   catch(boost::interprocess::interprocess_exception&) {
+      return false;
+   }
+
+   m_tree.swap(local);
+   if(m_tree.size() == 1) {
+      ptree::iterator i=m_tree.begin();
+      m_root_name = i->first;
+      return true;
    }
    return false;
 }
@@ -55,6 +55,23 @@ public:
    // read xml data from file
    bool read_xml(const string& path);
 
+   // === Binary export/import
+   // The binary format stores the tree with a table of tags and attribute names,
+   // node values and attributes are stored as length prefixed strings. Reading it
+   // involves no tokenizing or entity decoding, and the tree is the same as from XML
+
+   // write binary data to any output stream
+   bool write_binary(ostream& os);
+
+   // write binary data to file
+   bool write_binary(const string& path);
+
+   // read binary data from any input stream
+   bool read_binary(istream& is);
+
+   // read binary data from file
+   bool read_binary(const string& path);
+
    // === JSON export/import
 
    // write json data to any output stream, set pretty=false to make a compact file
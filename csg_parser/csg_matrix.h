@@ -43,6 +43,7 @@ public:
 
    void set_diagonal(const T& value);               // set value on diagonal
    csg_matrix& transpose();                         // in-place transpose NxN matrix
+   bool is_identity() const;                        // exact identity matrix
 
    size_t dimension1() const {return N;}
    size_t dimension2() const {return M;}
@@ -145,6 +146,17 @@ void csg_matrix<N,M,T>::set_diagonal(const T& value)
    }
 }
 
+template <size_t N, size_t M, class T>
+bool csg_matrix<N,M,T>::is_identity() const
+{
+   for(size_t n=0; n<N; n++) {
+      for(size_t m=0; m<M; m++) {
+         if(operator()(n,m) != ((n==m)? T(1) : T(0))) return false;
+      }
+   }
+   return true;
+}
+
 template <size_t N, size_t M, class T>
 csg_matrix<N,M,T>& csg_matrix<N,M,T>::transpose()
 {
@@ -197,5 +209,37 @@ private:
    value_type m_res;
 };
 
+/*
+    4x4 specialisation used for composing transformations. The products are
+    written out over the column major storage, so no index arithmetic remains
+*/
+
+template <class T>
+class csg_matrix_mult<4,4,4,T> {
+public:
+   typedef csg_matrix<4,4,T> A_type;
+   typedef csg_matrix<4,4,T> B_type;
+   typedef csg_matrix<4,4,T> value_type;
+
+   csg_matrix_mult(const A_type& matrix_a, const B_type& matrix_b)
+   {
+      const T* a = matrix_a.raw();
+      const T* b = matrix_b.raw();
+      T* c = m_res.raw();
+      for(size_t n=0; n<4; n++) {
+         const T* bn = b + 4*n;
+         T* cn = c + 4*n;
+         cn[0] = a[0]*bn[0] + a[4]*bn[1] + a[ 8]*bn[2] + a[12]*bn[3];
+         cn[1] = a[1]*bn[0] + a[5]*bn[1] + a[ 9]*bn[2] + a[13]*bn[3];
+         cn[2] = a[2]*bn[0] + a[6]*bn[1] + a[10]*bn[2] + a[14]*bn[3];
+         cn[3] = a[3]*bn[0] + a[7]*bn[1] + a[11]*bn[2] + a[15]*bn[3];
+      }
+   }
+
+   operator const value_type& () const { return m_res; }
+private:
+   value_type m_res;
+};
+
 #endif
 
@@ -18,6 +18,7 @@
 #include <stdexcept>
 #include <cmath>
 #include <unordered_set>
+#include <algorithm>
 
 #include "csg_node.h"
 #include "csg_scalar.h"
@@ -26,27 +27,6 @@
 static const double pi = 4.0*atan(1.0);
 
 
-inline void tokenize(const std::string& input,
-                     const std::string& delimiters,
-                     std::vector<std::string>& tokens)
-{
-   using namespace std;
-   string::size_type last_pos = 0;
-   string::size_type pos = 0;
-   while(true) {
-      pos = input.find_first_of(delimiters, last_pos);
-      if( pos == string::npos ) {
-         if(input.length()-last_pos > 0)tokens.push_back(input.substr(last_pos));
-         break;
-      }
-      else {
-         if(pos-last_pos > 0)tokens.push_back(input.substr(last_pos, pos - last_pos));
-         last_pos = pos + 1;
-      }
-   }
-}
-
-
 csg_node::xmap csg_node::m_xmap;
 
 void csg_node::configure_xmap()
@@ -94,10 +74,10 @@ csg_node::csg_node()
 , m_has_matrix(false)
 {}
 
-csg_node::csg_node(size_t level, size_t line_no, const std::string& func)
+csg_node::csg_node(size_t level, size_t line_no, std::string func)
 : m_level(int(level))
 , m_line_no(line_no)
-, m_func(func)
+, m_func(std::move(func))
 , m_has_matrix(false)
 {
    parse_params();
@@ -131,15 +111,15 @@ void csg_node::push_back(std::shared_ptr<csg_node> child)
    m_children.push_back(child);
 }
 
-void csg_node::build_tree(const std::vector<func_data>& func, size_t& index)
+void csg_node::build_tree(std::vector<func_data>& func, size_t& index)
 {
    while(index < func.size()) {
-      const func_data& f = func[index];
+      func_data& f = func[index];
       auto& p = f.second;
       int level = int(p.first);
       size_t line_no = p.second;
       if(level == m_level+1){
-         std::shared_ptr<csg_node> child = std::make_shared<csg_node>(level,line_no,f.first);
+         std::shared_ptr<csg_node> child = std::make_shared<csg_node>(level,line_no,std::move(f.first));
          m_children.push_back(child);
          child->build_tree(func,++index);
       }
@@ -149,68 +129,63 @@ void csg_node::build_tree(const std::vector<func_data>& func, size_t& index)
 
 void csg_node::parse_params()
 {
-   std::string type   = tag();
-   std::string params = par();
-
-   // first get rid of the enclosing parentheses
-   std::vector<std::string> tokens;
-   tokenize(params,"()",tokens);
-   if(tokens.size() > 0) {
-
-      size_t iparam = 0; // parameter counter
-      params = tokens[0];
-
-      // we now have  name1=value1,name2=name2,... where values can be (nested) vectors
-      // but note that in some few cases, the name is missing (multmatrix)
-      while(params.size() > 0) {
-         size_t ieq = params.find_first_of('=');
-         std::string name;
-         if(ieq==std::string::npos) {
-            name = par_name(iparam);  // nameless parameter
-            ieq = 0;
-         }
-         else {
-            // increment ieq to eat equal sign
-            name = params.substr(0,ieq++);
-         }
+   // the parameter list is found between the opening parenthesis and the next parenthesis.
+   // It is scanned in place, only names and scalar values are copied
+   size_t ibeg = m_func.find_first_of('(');
+   if(ibeg == std::string::npos) return;
+   size_t iend = m_func.find_first_of("()",++ibeg);
+   if(iend == std::string::npos) iend = m_func.size();
+
+   const char* params = m_func.data() + ibeg;
+   const char* end    = m_func.data() + iend;
+
+   size_t iparam = 0; // parameter counter
+
+   // we now have  name1=value1,name2=name2,... where values can be (nested) vectors
+   // but note that in some few cases, the name is missing (multmatrix)
+   while(params < end) {
+      const char* ieq = std::find(params,end,'=');
+      std::string name;
+      if(ieq == end) {
+         name = par_name(iparam);  // nameless parameter
+      }
+      else {
+         // eat equal sign
+         name.assign(params,ieq);
+         params = ieq+1;
+      }
 
-         // extract value, parse it and assign it to parameter map
-         std::string value_str = par_value(params,ieq);
-         std::shared_ptr<csg_value> value = csg_value::parse(value_str,m_line_no);
-         if(value.get()) m_par[name] = value;
+      // extract value, parse it and assign it to parameter map
+      const char* value_end = par_value(params,end);
+      std::shared_ptr<csg_value> value = csg_value::parse(params,value_end,m_line_no);
+      if(value.get()) m_par[name] = value;
 
-         // truncate the parameter list from left
-         size_t len = name.length()+1 + value_str.length()+1;
-         params = (len <= params.size()) ? params.substr(len) : "";
-      }
+      // continue after the value and its comma
+      params = value_end;
+      if(params < end && *params == ',') params++;
    }
 }
 
-// find the next value substring in the parameter list
+// find the end of the value in the parameter list
 // Make sure to account for (nested) vectors using [] characters
 // we essentially search for end of vector ']', next comma or end of string
-// if we find a comma, we replace it with a blank
-std::string csg_node::par_value(std::string& param, size_t istart)
+const char* csg_node::par_value(const char* begin, const char* end)
 {
-   std::string value;
    size_t inside = 0;
-   for(size_t i=istart; i<param.size(); i++) {
-      char c = param[i];
+   for(const char* p=begin; p<end; p++) {
+      char c = *p;
       if(c == '[') inside++;        // vector begins
       if(c == ',' && inside==0) {   // next parameter
-         param[i] = ' ';
-         break;
+         return p;
       }
       if(c == ']') {                // vector ends
          inside--;
          if(inside==0) {            // outer vector ends
-            value += c;
-            break;
+            return p+1;
          }
       }
-      value += c;
    }
-   return value;
+   return end;
 }
 
 void  csg_node::dump()
@@ -282,6 +257,55 @@ void csg_node::assign_matrix()
    m_has_matrix = true;
 }
 
+bool csg_node::is_union()
+{
+   std::string this_tag = tag();
+   return (m_level == -1 || this_tag == "group" || this_tag == "union" || this_tag == "color" || this_tag == "render" || this_tag == "multmatrix");
+}
+
+bool csg_node::is_pass_through()
+{
+   return (m_level != -1 && is_union() && size_children() == 1);
+}
+
+void csg_node::fold_transforms()
+{
+   if(!m_has_matrix && tag() == "multmatrix") assign_matrix();
+
+   for(auto& c : m_children) {
+
+      // the children of c are folded first, so its only child is not a pass-through node
+      c->fold_transforms();
+      if(c->is_pass_through()) {
+         std::shared_ptr<csg_node> child;
+         for(auto& cc : c->m_children) {
+            if(!cc->is_dummy()) child = cc;
+         }
+         if(c->m_has_matrix) {
+            if(child->m_has_matrix) child->m_matrix = csg_matrix_mult<4,4,4>(c->m_matrix,child->m_matrix);
+            else                    child->m_matrix = c->m_matrix;
+            child->m_has_matrix = true;
+         }
+         c = child;
+      }
+   }
+
+   // dummy children produce nothing, and the children of an untransformed union child are
+   // children of this union as well
+   std::vector<std::shared_ptr<csg_node>> children;
+   children.reserve(m_children.size());
+   for(auto& c : m_children) {
+      if(c->is_dummy()) continue;
+      if(is_union() && c->is_union() && (!c->m_has_matrix || c->m_matrix.is_identity())) {
+         for(auto& cc : c->m_children) children.push_back(cc);
+      }
+      else {
+         children.push_back(c);
+      }
+   }
+   m_children.swap(children);
+}
+
 void csg_node::to_xcsg(cf_xmlNode& target, csg_matrix<4,4>& matrix)
 {
    // assign transformation to this xml object
@@ -406,8 +430,8 @@ cf_xmlNode csg_node::to_xcsg(cf_xmlNode& parent)
      // if(openscad_tag == "group" && dimension()==0) return xml_this;
       if(dimension()==0) return xml_this;
 
-      // first check for special cases
-      if(openscad_tag == "multmatrix") {
+      // first check for special cases, the matrix is already assigned when the tree is folded
+      if(openscad_tag == "multmatrix" && !m_has_matrix) {
          assign_matrix();
       }
 
@@ -649,13 +673,14 @@ cf_xmlNode csg_node::to_xcsg(cf_xmlNode& parent)
                xml_this.add_property("angle",iangle->second->to_double()*pi/180);
 
                // special -90 deg rotate around x applied here since
-               // openscad's rotate_extrude implies -90 deg rotate around x after extrusion
+               // openscad's rotate_extrude implies -90 deg rotate around x after extrusion,
+               // i.e. before any transform folded into this node
                csg_matrix<4,4> rotx;
                rotx(1,1)=0;
                rotx(1,2)=1;
                rotx(2,1)=-1;
                rotx(2,2)=0;
-               if(m_has_matrix) m_matrix = csg_matrix_mult<4,4,4>(rotx,m_matrix);
+               if(m_has_matrix) m_matrix = csg_matrix_mult<4,4,4>(m_matrix,rotx);
                else             m_matrix = rotx;
                m_has_matrix = true;
 
@@ -702,18 +727,10 @@ cf_xmlNode csg_node::to_xcsg(cf_xmlNode& parent)
 
                // check if this is a "cut" or a proper projection
                // if projection it is a no-op here
-               // if cut, insert an intersection with a very thin cuboid, and project that
+               // if cut, the section at z=0 is computed by projection2d directly
                bool cut = get_value("cut")->to_bool();
                if(cut) {
-                  cf_xmlNode xml_intersection = xml_this.add_child("intersection3d");
-                  cf_xmlNode xml_cuboid = xml_intersection.add_child("cuboid");
-                  xml_cuboid.add_property("dx",1.0E4);
-                  xml_cuboid.add_property("dy",1.0E4);
-                  xml_cuboid.add_property("dz",1.0E-4);
-                  xml_cuboid.add_property("center","true");
-
-                  // hijack "xml_this" so the children are applied to intersection below
-                  xml_this = xml_intersection;
+                  xml_this.add_property("cut","true");
                }
             }
             else if(xcsg_tag.substr(0,4)=="diff" ||
@@ -749,7 +766,7 @@ cf_xmlNode csg_node::to_xcsg(cf_xmlNode& parent)
             }
 
             // apply transform
-            if(m_has_matrix) to_xcsg(xml_this,m_matrix);
+            if(m_has_matrix && !m_matrix.is_identity()) to_xcsg(xml_this,m_matrix);
          }
          else {
              throw std::runtime_error(line_no+": OpenSCAD node dimension could not be determined:" + openscad_tag + " --> " + xcsg_tag + ": " + m_func);
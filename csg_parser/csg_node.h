@@ -39,7 +39,7 @@ public:
    typedef par_map::iterator par_iterator;
 
    csg_node();
-   csg_node(size_t level, size_t line_no, const std::string& func);
+   csg_node(size_t level, size_t line_no, std::string func);
    virtual ~csg_node();
 
    // return naked function name
@@ -61,6 +61,11 @@ public:
 
    cf_xmlNode to_xcsg(cf_xmlNode& parent);
 
+   // simplify the tree before to_xcsg: group, union, color, render and multmatrix nodes with a
+   // single non-dummy child are replaced by that child, with the multmatrix transforms composed
+   // into it. Untransformed unions inside unions are merged. Identity transforms are not exported
+   void fold_transforms();
+
    // returns 0 for no children
    // returns 2 for 2d children
    // returns 3 for 3d children
@@ -72,9 +77,12 @@ public:
 protected:
 
    // helpers to buuild csg tree, parse node parameters etc
-   void build_tree(const std::vector<func_data>& func, size_t& index);
+   // the function signatures are moved into the tree nodes
+   void build_tree(std::vector<func_data>& func, size_t& index);
    void parse_params();
-   std::string par_value(std::string& param, size_t istart);
+
+   // find the end of the parameter value starting at begin
+   static const char* par_value(const char* begin, const char* end);
 
    void dump();
 
@@ -93,6 +101,12 @@ protected:
    // assign node transformation from multmatrix
    void assign_matrix();
 
+   // true for the root and nodes exported as union, i.e. group, union, color, render and multmatrix
+   bool is_union();
+
+   // true for union nodes with a single non-dummy child, except the root
+   bool is_pass_through();
+
    // export matrix to xcsg for given target node
    void to_xcsg(cf_xmlNode& target, csg_matrix<4,4>& matrix);
 
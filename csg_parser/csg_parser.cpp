@@ -17,21 +17,41 @@
 #include <sstream>
 #include <vector>
 #include <iomanip>
+#include <iterator>
 
 csg_parser::csg_parser(std::istream& csg, double secant_tolerance)
 : m_root(std::make_shared<csg_node>())
 , m_secant_tolerance(secant_tolerance)
 {
-   // read the whole file into a string
-   std::ostringstream sstr;
-   sstr << csg.rdbuf();
-   init_func(sstr.str());
+   // read the whole file into a string, sized up front when the stream is seekable
+   std::string text;
+   std::streampos start = csg.tellg();
+   if(start != std::streampos(-1) && csg.seekg(0,std::ios::end)) {
+      std::streampos end = csg.tellg();
+      csg.seekg(start);
+      if(end > start) text.reserve(static_cast<size_t>(end - start));
+   }
+   csg.clear();
+   text.assign(std::istreambuf_iterator<char>(csg),std::istreambuf_iterator<char>());
+   init_func(text);
    // m_root->dump();
 }
 
 csg_parser::~csg_parser()
 {}
 
+// characters not contributing to tokens
+static inline bool is_separator(char c)
+{
+   return (c==' ' || c=='\t' || c=='\n' || c=='\r' || c==';' || c=='{' || c=='}' || c=='#');
+}
+
+// true when a // comment starts at position i
+static inline bool is_comment(const std::string& csg, size_t i)
+{
+   return (csg[i]=='/' && i+1<csg.size() && csg[i+1]=='/');
+}
+
 void csg_parser::init_func(const std::string& csg)
 {
    std::vector<func_data>   func;  // function calls, by function index
@@ -42,39 +62,47 @@ void csg_parser::init_func(const std::string& csg)
    size_t level = 0;
    size_t line_no = 1;
 
+   const size_t n = csg.size();
    size_t i=0;
-   while(i<csg.size()) {
+   while(i<n) {
 
       // get current character
-      char c = csg[i++];
+      char c = csg[i];
 
-      // Skip // comment line
-      while(c=='/' && csg[i]=='/') {
-         while(csg[++i]!='\n') c = csg[i];
-         c = csg[i];
+      // Skip // comment line, the line break is processed as usual
+      if(is_comment(csg,i)) {
+         i = csg.find('\n',i);
+         if(i == std::string::npos) break;
+         continue;
       }
 
-      // update the tree level
-           if( c=='{') ++level;
-      else if( c=='}') --level;
+      if(is_separator(c)) {
 
-      if( c=='\n') {
-         line_no++;
-         token.clear();
-      }
+         // update the tree level
+              if( c=='{') ++level;
+         else if( c=='}') --level;
 
-      // characters not contributing to token
-      if( c==' ' || c=='\t' || c=='\n' || c==';' || c=='{' || c=='}' || c=='#') continue;
+         if( c=='\n') {
+            line_no++;
+            token.clear();
+         }
+         i++;
+         continue;
+      }
 
-      // add character to token
-      token += c;
+      // append the run of token characters up to and including an eventual ')'
+      size_t j = i;
+      while(j<n && csg[j]!=')' && !is_separator(csg[j]) && !is_comment(csg,j)) j++;
+      bool end_of_token = (j<n && csg[j]==')');
+      if(end_of_token) j++;
+      token.append(csg,i,j-i);
+      i = j;
 
-      if(c==')') {
+      if(end_of_token) {
          // end of token
-         func.push_back(func_data(token,std::make_pair(level,line_no)));
+         func.push_back(func_data(std::move(token),std::make_pair(level,line_no)));
          token.clear();
       }
-
    }
 
    if(func.size() == 0) throw std::runtime_error("csg tree has 0 elements!");
@@ -95,6 +123,7 @@ bool csg_parser::to_xcsg(cf_xmlTree& tree)
          root.add_property("version","1.0");
          root.add_property("secant_tolerance",m_secant_tolerance);
 
+         m_root->fold_transforms();
          m_root->to_xcsg(root);
          if(m_root->dimension() < 2) throw std::runtime_error("Undetermined .csg model dimension, conversion failed.");
 
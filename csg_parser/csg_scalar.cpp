@@ -14,8 +14,8 @@
 // EndLicense:
 
 #include "csg_scalar.h"
+#include "cf_number.h"
 #include <stdexcept>
-#include <boost/lexical_cast.hpp>
 
 csg_scalar::csg_scalar()
 : csg_value(0)
@@ -26,6 +26,11 @@ csg_scalar::csg_scalar(const std::string& value,size_t line_no)
 , m_value(value)
 {}
 
+csg_scalar::csg_scalar(const char* begin, const char* end, size_t line_no)
+: csg_value(line_no)
+, m_value(begin,end)
+{}
+
 csg_scalar::~csg_scalar()
 {}
 
@@ -36,10 +41,19 @@ bool csg_scalar::to_bool() const
 
 int csg_scalar::to_int() const
 {
-   return boost::lexical_cast<int>(m_value);
+   int value = 0;
+   if(!cf_to_int(m_value,value)) {
+      throw std::runtime_error(".csg file line " + std::to_string(line_no()) +", csg_scalar::to_int(), '" + m_value + "' is not an integer");
+   }
+   return value;
 }
 
 double csg_scalar::to_double() const
 {
-   return boost::lexical_cast<double>(m_value);
+   // locale independent, the whole string must be consumed
+   double value = 0.0;
+   if(!cf_to_double(m_value,value)) {
+      throw std::runtime_error(".csg file line " + std::to_string(line_no()) +", csg_scalar::to_double(), '" + m_value + "' is not a number");
+   }
+   return value;
 }
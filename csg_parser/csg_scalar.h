@@ -24,6 +24,7 @@ class csg_scalar : public csg_value {
 public:
    csg_scalar();
    csg_scalar(const std::string& value,size_t line_no);
+   csg_scalar(const char* begin, const char* end, size_t line_no);
    virtual ~csg_scalar();
 
    size_t size() const { return 1; }
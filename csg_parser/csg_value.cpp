@@ -17,6 +17,10 @@
 #include "csg_scalar.h"
 #include "csg_vector.h"
 #include <stdexcept>
+#include <algorithm>
+
+csg_value::parallel_for csg_value::m_parallel_for;
+size_t                  csg_value::m_nthreads = 1;
 
 csg_value::csg_value(size_t line_no)
 : m_line_no(line_no)
@@ -50,70 +54,143 @@ std::shared_ptr<csg_value> csg_value::get(size_t i) const
    throw std::runtime_error(".csg file line " + std::to_string(m_line_no) +", csg_value::get(), value is not a vector");
 }
 
+void csg_value::set_parallel_for(parallel_for run, size_t nthreads)
+{
+   m_parallel_for = run;
+   m_nthreads     = (run)? nthreads : 1;
+}
+
 std::shared_ptr<csg_value> csg_value::parse(const std::string& value_str, size_t line_no)
 {
-   std::shared_ptr<csg_value> value;
+   return parse(value_str.data(),value_str.data()+value_str.size(),line_no);
+}
 
-   // recursively parse the string
-   // when a vector is found [
-   //    call this function again, until corresponding ] is found
+std::shared_ptr<csg_value> csg_value::parse(const char* begin, const char* end, size_t line_no)
+{
+   std::shared_ptr<csg_value> value;
 
-   for(size_t i=0; i<value_str.size(); i++) {
-      char c = value_str[i];
+   for(const char* p=begin; p<end; p++) {
+      char c = *p;
 
       if( c==',') continue;
 
       if(c == '[') {
-         // found an array, find the corresponding ']' from the right side
-         size_t i2 = value_str.find_last_of(']');
-
-         // strip the [] pair from both sides
-         // so we end up with a string of comma separated values (which may be vectors)
-         return parse_vector(value_str.substr(i+1,i2-1),line_no);
+         // found a (nested) vector, parsed recursively until the corresponding ']'
+         return parse_vector(++p,end,line_no);
       }
       else {
          // found a scalar
-         return std::make_shared<csg_scalar>(value_str,line_no);
+         return std::make_shared<csg_scalar>(begin,end,line_no);
       }
    }
 
    return value;
 }
 
-std::shared_ptr<csg_value> csg_value::parse_vector(const std::string& values, size_t line_no)
+// vectors longer than this are parsed in parallel chunks
+static const size_t parallel_size = 1<<20;
+
+// minimum number of characters in a chunk
+static const size_t min_chunk_size = 1<<18;
+
+std::shared_ptr<csg_value> csg_value::parse_vector(const char*& p, const char* end, size_t line_no)
 {
-   std::vector<std::shared_ptr<csg_value>> vec;
-   std::string token;
+   value_vector vec;
+
+   // only the top level vector is split, end is the end of its value
+   size_t nthreads = m_nthreads;
+   if(nthreads > 1 && size_t(end-p) > parallel_size) {
+
+      std::vector<const char*> splits;
+      size_t chunk_size = std::max(min_chunk_size,size_t(end-p)/(4*nthreads));
+      const char* close = split_vector(p,end,chunk_size,splits);
+      if(splits.size() > 2) {
+
+         // each chunk is parsed into its own vector, the first error in file order is reported
+         size_t nchunks = splits.size()-1;
+         std::vector<value_vector> chunks(nchunks);
+         std::vector<std::string>  errors(nchunks);
+         m_parallel_for(nchunks,[&](size_t ichunk) {
+            try {
+               const char* chunk_p = splits[ichunk];
+               parse_elements(chunk_p,splits[ichunk+1],line_no,chunks[ichunk]);
+            }
+            catch(std::exception& ex) {
+               errors[ichunk] = ex.what();
+            }
+         });
+
+         for(auto& error : errors) {
+            if(error.length() > 0) throw std::runtime_error(error);
+         }
+
+         size_t nvec = 0;
+         for(auto& chunk : chunks) nvec += chunk.size();
+         vec.reserve(nvec);
+         for(auto& chunk : chunks) {
+            vec.insert(vec.end(),chunk.begin(),chunk.end());
+         }
+
+         // continue after the closing ']'
+         p = (close < end)? close+1 : end;
+         return std::make_shared<csg_vector>(std::move(vec),line_no);
+      }
+   }
 
-   size_t icount = 0;
-   for(size_t i=0; i<values.size(); i++) {
-      char c = values[i];
+   parse_elements(p,end,line_no,vec);
+   return std::make_shared<csg_vector>(std::move(vec),line_no);
+}
 
-      if(c == '[') icount++;
-      if(c == ']') icount--;
-      token +=c;
+void csg_value::parse_elements(const char*& p, const char* end, size_t line_no, value_vector& vec)
+{
+   while(p < end) {
+      char c = *p;
 
-      if(icount==0 && c == ']') {
+      if(c == ']') {
          // end of vector data
-         size_t len = token.size();
-         std::string vals = token.substr(1,len-2);
-         vec.push_back(parse_vector(vals,line_no));
-         token  = "";
-         icount = 0;
-
-         // eat following comma
-         i++;
+         p++;
+         break;
+      }
+
+      if(c == '[') {
+         // nested vector
+         value_vector nested;
+         parse_elements(++p,end,line_no,nested);
+         vec.push_back(std::make_shared<csg_vector>(std::move(nested),line_no));
+      }
+      else {
+         // scalar data ends at the next comma or at the end of this vector
+         const char* s = p;
+         while(p < end && *p != ',' && *p != ']') p++;
+         vec.push_back(std::make_shared<csg_scalar>(s,p,line_no));
+      }
+
+      // eat following comma
+      if(p < end && *p == ',') p++;
+   }
+}
+
+const char* csg_value::split_vector(const char* p, const char* end, size_t chunk_size, std::vector<const char*>& splits)
+{
+   // only the brackets are tracked here, the chunks are split after a comma between two elements
+   splits.push_back(p);
+   const char* next_split = p + chunk_size;
+   size_t inside = 0;
+   for(; p<end; p++) {
+      char c = *p;
+      if(c == '[') inside++;
+      else if(c == ']') {
+         if(inside == 0) break;
+         inside--;
       }
-      else if(icount==0 && (c == ',' || i==values.size()-1) ) {
-         // end of scalar data
-         size_t len = (c == ',')? token.size()-1 : token.size();
-         std::string val = token.substr(0,len);
-         vec.push_back(std::make_shared<csg_scalar>(val,line_no));
-         token  = "";
-         icount = 0;
+      else if(c == ',' && inside == 0 && p >= next_split) {
+         splits.push_back(p+1);
+         next_split = p + chunk_size;
       }
    }
-   return std::make_shared<csg_vector>(vec,line_no);
+   // the last chunk ends at the closing ']', which is not part of any chunk
+   splits.push_back(p);
+   return p;
 }
 
 
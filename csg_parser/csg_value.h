@@ -16,8 +16,10 @@
 #ifndef CSG_VALUE_H
 #define CSG_VALUE_H
 
+#include <functional>
 #include <string>
 #include <memory>
+#include <vector>
 
 // abstract parameter value for csg node
 class csg_value {
@@ -27,7 +29,9 @@ public:
 
    // convert a value string into a csg_value, possibly a scalar or (nested) vector
    static std::shared_ptr<csg_value> parse(const std::string& value_str, size_t line_no);
-   static std::shared_ptr<csg_value> parse_vector(const std::string& value_str, size_t line_no);
+
+   // same as above for the characters in [begin,end>, the value is parsed in a single pass
+   static std::shared_ptr<csg_value> parse(const char* begin, const char* end, size_t line_no);
 
    virtual bool is_vector() const { return false; }
 
@@ -45,8 +49,33 @@ public:
 
    size_t line_no() const { return m_line_no; }
 
+   // runs task(0), ... task(n-1), possibly in parallel, and returns when all have completed
+   typedef std::function<void(size_t n, const std::function<void(size_t)>& task)> parallel_for;
+
+   // let large vectors be parsed in parallel with nthreads threads using run.
+   // Without it, or with nthreads < 2, all vectors are parsed in the calling thread
+   static void set_parallel_for(parallel_for run, size_t nthreads);
+
+protected:
+   typedef std::vector<std::shared_ptr<csg_value>> value_vector;
+
+   // parse the elements of a top level vector from p up to and including the closing ']', p is advanced past it.
+   // end is the end of the value. Large vectors such as polyhedron points and faces are parsed in parallel chunks
+   static std::shared_ptr<csg_value> parse_vector(const char*& p, const char* end, size_t line_no);
+
+   // parse vector elements from p and append them to vec, until the closing ']' or end is reached.
+   // p is advanced past the closing ']' or to end. Nested vectors are parsed in the calling thread
+   static void parse_elements(const char*& p, const char* end, size_t line_no, value_vector& vec);
+
+   // find the closing ']' of the vector starting at p, and split its elements into chunks of
+   // approximately chunk_size characters. Returns end if the vector is not closed
+   static const char* split_vector(const char* p, const char* end, size_t chunk_size, std::vector<const char*>& splits);
+
 private:
    size_t m_line_no;   // csg file line no
+
+   static parallel_for m_parallel_for;
+   static size_t       m_nthreads;
 };
 
 #endif // CSG_VALUE_H
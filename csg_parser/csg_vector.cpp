@@ -34,6 +34,11 @@ csg_vector::csg_vector(const std::vector<std::shared_ptr<csg_value>>& vec,size_t
 , m_vector(vec)
 {}
 
+csg_vector::csg_vector(std::vector<std::shared_ptr<csg_value>>&& vec,size_t line_no)
+: csg_value(line_no)
+, m_vector(std::move(vec))
+{}
+
 csg_vector::~csg_vector()
 {}
 
@@ -65,55 +65,187 @@ namespace csplines {
       for(int i=1; i<n; i++) t(i) *= scale;
       m_length = tsum;
 
-      buildcubicspline(t,px,n,0,0.0,0,0.0,m_cpx);
-      buildcubicspline(t,py,n,0,0.0,0,0.0,m_cpy);
-      buildcubicspline(t,pz,n,0,0.0,0,0.0,m_cpz);
+      m_knot.resize(n);
+      m_coef.assign(4*NCOMP*(n-1),0.0);
 
-      buildcubicspline(t,vx,n,0,0.0,0,0.0,m_cvx);
-      buildcubicspline(t,vy,n,0,0.0,0,0.0,m_cvy);
-      buildcubicspline(t,vz,n,0,0.0,0,0.0,m_cvz);
+      const ap::real_1d_array* comp[NCOMP] = { &px, &py, &pz, &vx, &vy, &vz };
+      for(size_t icomp=0; icomp<NCOMP; icomp++) {
+         ap::real_1d_array c;
+         buildcubicspline(t,*comp[icomp],n,0,0.0,0,0.0,c);
+         store_spline(c,icomp);
+      }
+      compute_arc_table();
       return true;
    }
 
-   cpoint spline_path::pos(double t) const
+   void spline_path::store_spline(const ap::real_1d_array& c, size_t icomp)
+   {
+      // buildcubicspline table: c(2)=n, c(3..3+n-1) knots, then 4 coefficients per interval.
+      // The knots are the same for all components
+      int n = ap::round(c(2));
+      for(int i=0; i<n; i++) m_knot[i] = c(3+i);
+      for(int iseg=0; iseg<n-1; iseg++) {
+         int m = 3+n+4*iseg;
+         for(int k=0; k<4; k++) m_coef[(4*iseg+k)*NCOMP+icomp] = c(m+k);
+      }
+   }
+
+   size_t spline_path::interval(double t, size_t hint) const
+   {
+      // same interval as splineinterpolation: the last interval with knot below t,
+      // parameters outside [0,1] extrapolate from the end intervals
+      const size_t nseg = m_knot.size()-1;
+      if(nseg < 2) return 0;
+      if(hint >= nseg) hint = nseg-1;
+
+      if(hint==0 || m_knot[hint] < t) {
+         // forward scan a few intervals before falling back to binary search
+         for(size_t i=0; i<4; i++) {
+            if(hint+1 >= nseg || m_knot[hint+1] >= t) return hint;
+            hint++;
+         }
+      }
+      return (std::lower_bound(m_knot.begin()+1,m_knot.begin()+nseg,t) - m_knot.begin()) - 1;
+   }
+
+   void spline_path::eval_components(size_t iseg, double t, double* s, double* ds, double* d2s) const
+   {
+      const double  x  = t - m_knot[iseg];
+      const double* c0 = &m_coef[4*iseg*NCOMP];
+      const double* c1 = c0 + NCOMP;
+      const double* c2 = c1 + NCOMP;
+      const double* c3 = c2 + NCOMP;
+      for(size_t i=0; i<NCOMP; i++) s[i] = c0[i]+x*(c1[i]+x*(c2[i]+x*c3[i]));
+      if(ds) {
+         for(size_t i=0; i<NCOMP; i++) ds[i] = c1[i]+2*x*c2[i]+3*(x*x)*c3[i];
+      }
+      if(d2s) {
+         for(size_t i=0; i<NCOMP; i++) d2s[i] = 2*c2[i]+6*x*c3[i];
+      }
+   }
+
+   double spline_path::speed(size_t iseg, double t) const
+   {
+      double s[NCOMP],ds[NCOMP];
+      eval_components(iseg,t,s,ds,0);
+      return sqrt(ds[0]*ds[0]+ds[1]*ds[1]+ds[2]*ds[2]);
+   }
+
+   double spline_path::arc_integral(size_t iseg, double t0, double t1) const
+   {
+      // 5 point Gauss-Legendre, exact for the polynomial part of the speed over short spans
+      static const double xg[5] = { 0.0, -0.5384693101056831, 0.5384693101056831, -0.9061798459386640, 0.9061798459386640 };
+      static const double wg[5] = { 0.5688888888888889, 0.4786286704993665, 0.4786286704993665, 0.2369268850561891, 0.2369268850561891 };
+      const double half = 0.5*(t1-t0);
+      const double mid  = 0.5*(t1+t0);
+      double sum = 0.0;
+      for(size_t i=0; i<5; i++) sum += wg[i]*speed(iseg,mid+half*xg[i]);
+      return half*sum;
+   }
+
+   void spline_path::compute_arc_table()
    {
-      double px = splineinterpolation(m_cpx,t);
-      double py = splineinterpolation(m_cpy,t);
-      double pz = splineinterpolation(m_cpz,t);
+      const size_t nseg = m_knot.size()-1;
+      m_arc_t.clear();
+      m_arc_s.clear();
+      m_arc_t.reserve(nseg*ARC_SAMPLES+1);
+      m_arc_s.reserve(nseg*ARC_SAMPLES+1);
 
-      double vx = splineinterpolation(m_cvx,t);
-      double vy = splineinterpolation(m_cvy,t);
-      double vz = splineinterpolation(m_cvz,t);
+      double s = 0.0;
+      m_arc_t.push_back(m_knot[0]);
+      m_arc_s.push_back(s);
+      for(size_t iseg=0; iseg<nseg; iseg++) {
+         const double t0 = m_knot[iseg];
+         const double dt = (m_knot[iseg+1]-t0)/ARC_SAMPLES;
+         for(size_t i=1; i<=ARC_SAMPLES; i++) {
+            const double ta = t0 + (i-1)*dt;
+            const double tb = (i==ARC_SAMPLES)? m_knot[iseg+1] : t0 + i*dt;
+            s += arc_integral(iseg,ta,tb);
+            m_arc_t.push_back(tb);
+            m_arc_s.push_back(s);
+         }
+      }
+   }
+
+   double spline_path::arc_length() const
+   {
+      return m_arc_s.back();
+   }
+
+   double spline_path::arc_length(double t) const
+   {
+      if(!(t > m_arc_t.front())) return 0.0;
+      if(!(t < m_arc_t.back()))  return m_arc_s.back();
+
+      // table sample at or below t, then integrate the remainder
+      size_t i = (std::upper_bound(m_arc_t.begin(),m_arc_t.end(),t) - m_arc_t.begin()) - 1;
+      return m_arc_s[i] + arc_integral(interval(t,i/ARC_SAMPLES),m_arc_t[i],t);
+   }
+
+   double spline_path::arc_param(double s) const
+   {
+      if(!(s > 0.0))               return m_arc_t.front();
+      if(!(s < m_arc_s.back()))    return m_arc_t.back();
 
-      return cpoint(px,py,pz, vx,vy,vz);
+      // table span containing s, then Newton iterations on arc_length(t)=s, kept within the span
+      size_t i = (std::upper_bound(m_arc_s.begin(),m_arc_s.end(),s) - m_arc_s.begin()) - 1;
+      const double ta = m_arc_t[i];
+      const double tb = m_arc_t[i+1];
+      const double sa = m_arc_s[i];
+      const double sb = m_arc_s[i+1];
+      if(!(sb > sa)) return ta;
+
+      const size_t iseg = interval(0.5*(ta+tb),i/ARC_SAMPLES);
+      double t = ta + (tb-ta)*(s-sa)/(sb-sa);
+      for(size_t iter=0; iter<8; iter++) {
+         double v = speed(iseg,t);
+         if(!(v > 0.0)) break;
+         double dt = (sa + arc_integral(iseg,ta,t) - s)/v;
+         t = std::min(tb,std::max(ta,t-dt));
+         if(fabs(dt) < 1.0E-15) break;
+      }
+      return t;
+   }
+
+   cpoint spline_path::pos(double t) const
+   {
+      double s[NCOMP];
+      eval_components(interval(t,0),t,s,0,0);
+      return cpoint(s[0],s[1],s[2], s[3],s[4],s[5]);
    }
 
    cpoint spline_path::dir(double t) const
    {
-      double px,dpx,d2px;
-      double py,dpy,d2py;
-      double pz,dpz,d2pz;
-      splinedifferentiation(m_cpx,t,px,dpx,d2px);
-      splinedifferentiation(m_cpy,t,py,dpy,d2py);
-      splinedifferentiation(m_cpz,t,pz,dpz,d2pz);
-
-      double vx = splineinterpolation(m_cvx,t);
-      double vy = splineinterpolation(m_cvy,t);
-      double vz = splineinterpolation(m_cvz,t);
-
-      return cpoint(dpx,dpy,dpz, vx,vy,vz);
+      double s[NCOMP],ds[NCOMP];
+      eval_components(interval(t,0),t,s,ds,0);
+      return cpoint(ds[0],ds[1],ds[2], s[3],s[4],s[5]);
+   }
+
+   void spline_path::eval(const std::vector<double>& t, std::vector<cpoint>& pos, std::vector<cpoint>& dir) const
+   {
+      pos.clear();
+      dir.clear();
+      pos.reserve(t.size());
+      dir.reserve(t.size());
+
+      double s[NCOMP],ds[NCOMP];
+      size_t iseg = 0;
+      for(double ti : t) {
+         iseg = interval(ti,iseg);
+         eval_components(iseg,ti,s,ds,0);
+         pos.push_back(cpoint(s[0],s[1],s[2], s[3],s[4],s[5]));
+         dir.push_back(cpoint(ds[0],ds[1],ds[2], s[3],s[4],s[5]));
+      }
    }
 
    double spline_path::curvature(double t) const
    {
       // https://math.stackexchange.com/questions/1786495/estimating-the-curvature-of-a-discretized-curve-in-3d-with-cubic-splines
 
-      double px,dpx,d2px;
-      double py,dpy,d2py;
-      double pz,dpz,d2pz;
-      splinedifferentiation(m_cpx,t,px,dpx,d2px);
-      splinedifferentiation(m_cpy,t,py,dpy,d2py);
-      splinedifferentiation(m_cpz,t,pz,dpz,d2pz);
+      double s[NCOMP],ds[NCOMP],d2s[NCOMP];
+      eval_components(interval(t,0),t,s,ds,d2s);
+      double dpx = ds[0], dpy = ds[1], dpz = ds[2];
+      double d2px = d2s[0], d2py = d2s[1], d2pz = d2s[2];
 
       double v1 =pow((d2pz*dpy-d2py*dpz),2.0);
       double v2 =pow((d2px*dpz-d2pz*dpx),2.0);
@@ -56,6 +56,10 @@ namespace csplines {
       // vx,vy,vz contains interpolated vector
       cpoint dir(double t) const;
 
+      // batch evaluation of pos(t) and dir(t) for all parameters in t, results are returned in pos and dir.
+      // Intervals are located incrementally for ascending parameters, so sorted input is faster
+      void eval(const std::vector<double>& t, std::vector<cpoint>& pos, std::vector<cpoint>& dir) const;
+
       // return max curvature observed by sampling nseg segments
       // note that this evaluates points only (see summed_spline() to evaluate both)
       double max_curvature(int nseg) const;
@@ -66,6 +70,15 @@ namespace csplines {
       // return sum of segment lengths
       double length() const;
 
+      // return the arc length of the curve
+      double arc_length() const;
+
+      // return the arc length along the curve from parameter 0 to t [0,1]
+      double arc_length(double t) const;
+
+      // return the parameter t [0,1] at arc length s [0,arc_length()] from the curve start
+      double arc_param(double s) const;
+
       // return number of input control points
       size_t size() const;
 
@@ -79,15 +92,43 @@ namespace csplines {
    protected:
       std::vector<cpoint>  summed_points() const;
 
+      // number of interpolated components: px,py,pz,vx,vy,vz
+      enum { NCOMP = 6 };
+
+      // copy the coefficients of a spline built by buildcubicspline into the common table
+      void store_spline(const ap::real_1d_array& c, size_t icomp);
+
+      // return the interval containing t. The search starts at hint and is fast
+      // when t is in the hint interval or close above it
+      size_t interval(double t, size_t hint) const;
+
+      // evaluate all components in interval iseg at parameter t,
+      // ds and d2s return first and second derivatives unless null
+      void eval_components(size_t iseg, double t, double* s, double* ds, double* d2s) const;
+
+      // curve speed |dp/dt| at t in interval iseg
+      double speed(size_t iseg, double t) const;
+
+      // arc length from t0 to t1 within interval iseg, by Gauss-Legendre quadrature
+      double arc_integral(size_t iseg, double t0, double t1) const;
+
+      // build the arc length table after the coefficients are stored
+      void compute_arc_table();
+
    private:
       std::vector<cpoint> m_points;
       double              m_length;  // sum of segment lengths
-      ap::real_1d_array   m_cpx;
-      ap::real_1d_array   m_cpy;
-      ap::real_1d_array   m_cpz;
-      ap::real_1d_array   m_cvx;
-      ap::real_1d_array   m_cvy;
-      ap::real_1d_array   m_cvz;
+
+      // spline coefficients for all components, interval by interval. Within an interval
+      // the coefficients are grouped by polynomial degree, so that all components
+      // are evaluated with the same contiguous operations: m_coef[(4*iseg+k)*NCOMP+icomp]
+      std::vector<double> m_knot;    // parameter value at start of each interval, plus final value
+      std::vector<double> m_coef;
+
+      // arc length table, sampled ARC_SAMPLES times per interval. m_arc_s[i] is the arc length at m_arc_t[i]
+      enum { ARC_SAMPLES = 8 };
+      std::vector<double> m_arc_t;
+      std::vector<double> m_arc_s;
    };
 
 }
@@ -24,9 +24,32 @@ dcoedge::dcoedge(dentity* parent, dedge* edge, bool fwd)
    m_edge->addref(this);
 }
 
+dcoedge::dcoedge()
+: m_parent(0)
+, m_edge(0)
+, m_fwd(true)
+{}
+
 dcoedge::~dcoedge()
 {
-   m_edge->release(this);
+   detach();
+}
+
+void dcoedge::attach(dentity* parent, dedge* edge, bool fwd)
+{
+   detach();
+   m_parent = parent;
+   m_edge   = edge;
+   m_fwd    = fwd;
+   m_edge->addref(this);
+}
+
+void dcoedge::detach()
+{
+   if(m_edge) {
+      m_edge->release(this);
+      m_edge = 0;
+   }
 }
 
 dcoedge* dcoedge::clone(dentity* parent)
@@ -25,7 +25,8 @@ class dtriangle;
 // Topology
 // ========
 // A dcoedge refers to a dedge. It carries a flag indicating the direction of the coedge relative to the dedge.
-// a dcoedge is uniquely owned by its parent.
+// a dcoedge is uniquely owned by its parent. Triangles hold their coedges by value,
+// these are attached to an edge when the triangle is initialised.
 
 class dcoedge {
 public:
@@ -60,6 +61,19 @@ protected:
    dcoedge(dentity* parent, dedge* edge, bool fwd);
    virtual ~dcoedge();
 
+   // detached coedge, see attach()
+   dcoedge();
+
+   // attach to edge, adding a reference to it
+   void attach(dentity* parent, dedge* edge, bool fwd);
+
+   // release the edge reference, if any
+   void detach();
+
+   // coedges are referenced from edges, so they cannot be copied
+   dcoedge(const dcoedge&) = delete;
+   dcoedge& operator=(const dcoedge&) = delete;
+
 private:
    dentity*   m_parent; // parent can be dtriangle or dloop
    dedge*     m_edge;   // the edge referred to from this coedge
@@ -29,6 +29,13 @@ dedge::dedge(dmesh* mesh, size_t iv1, size_t iv2)
 dedge::~dedge()
 {}
 
+void dedge::reset(size_t iv1, size_t iv2)
+{
+   m_iv1 = (iv1<iv2)? iv1 : iv2;
+   m_iv2 = (iv1<iv2)? iv2 : iv1;
+   m_users.clear();
+}
+
 size_t dedge::key(size_t iv1, size_t iv2)
 {
    if(iv1 < iv2) return iv1*1000000 + iv2;
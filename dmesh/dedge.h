@@ -21,20 +21,23 @@
 #include "dline2d.h"
 #include "dcoedge.h"
 class dtriangle;
+#include <algorithm>
 #include <unordered_set>
+#include <vector>
 
 // Topology
 // ========
 // A dedge is connected to 2 vertices, defined by their vertex indices.
 // The first vertex index is always the lowest index value, no exception.
-// The dedge maintains a set of coedges referring to it
+// The dedge maintains the coedges referring to it, normally 1-3 of them
 
 class dedge : public dentity {
 public:
    friend class dmesh;
 
-   typedef std::unordered_set<dcoedge*> dcoedge_set;
-   typedef dcoedge_set::iterator coedge_iterator;
+   typedef std::vector<dcoedge*> dcoedge_vector;
+   typedef dcoedge_vector::iterator coedge_iterator;
+   typedef dcoedge_vector::const_iterator coedge_const_iterator;
 
    // return vertex indices
    size_t vertex1() const { return m_iv1; }
@@ -43,11 +46,13 @@ public:
    // coedge traversal, i.e. over coedges referring to this edge
    coedge_iterator begin() { return m_users.begin(); }
    coedge_iterator end()   { return m_users.end(); }
+   coedge_const_iterator begin() const { return m_users.begin(); }
+   coedge_const_iterator end() const   { return m_users.end(); }
 
    // coedge reference management
    size_t use_count() const { return m_users.size(); }
-   void addref(dcoedge* coedge) { m_users.insert(coedge); }
-   void release(dcoedge* coedge) { m_users.erase(coedge); }
+   void addref(dcoedge* coedge);
+   void release(dcoedge* coedge);
 
    // compute the direction from iv1 to iv2
    dvec2d dir() const;
@@ -71,10 +76,13 @@ protected:
    dedge(dmesh* mesh, size_t iv1, size_t iv2);
    virtual ~dedge();
 
+   // reinitialise an unused edge with new vertices, used when recycling edges
+   void reset(size_t iv1, size_t iv2);
+
 private:
    size_t       m_iv1;   // ALWAYS the lowest vertex index
    size_t       m_iv2;   // ALWAYS the highest vertex index
-   dcoedge_set  m_users;
+   dcoedge_vector  m_users;
 };
 
 
@@ -87,4 +95,18 @@ bool dedge::is_referenced_from() const
    return false;
 }
 
+inline void dedge::addref(dcoedge* coedge)
+{
+   if(std::find(m_users.begin(),m_users.end(),coedge) == m_users.end()) m_users.push_back(coedge);
+}
+
+inline void dedge::release(dcoedge* coedge)
+{
+   auto i = std::find(m_users.begin(),m_users.end(),coedge);
+   if(i != m_users.end()) {
+      *i = m_users.back();
+      m_users.pop_back();
+   }
+}
+
 #endif // DEDGE_H
@@ -21,7 +21,10 @@
 
 #include "dpos2d.h"
 #include "dvec2d.h"
+#include "dpredicates.h"
+#include <algorithm>
 #include <map>
+#include <random>
 #include <string>
 #include <cmath>
 
@@ -29,11 +32,16 @@
 
 dmesh::dmesh(double epspnt)
 : m_epspnt(epspnt)
+, m_last_tri(0)
 , m_profile(this)
 {}
 
 dmesh::~dmesh()
-{}
+{
+   clear();
+   for(auto triangle : m_tri_free) delete triangle;
+   for(auto edge : m_edge_free)    delete edge;
+}
 
 bool dmesh::triangulate_point_cloud(const std::vector<dpos2d>& points)
 {
@@ -49,8 +57,9 @@ bool dmesh::triangulate_point_cloud(const std::vector<dpos2d>& points)
      size_t iv = add_vertex(p);
    }
 
-   // then run triangulation based on the new vertices
-   return triangulate_vertices();
+   // then run triangulation based on the new vertices.
+   // Raw points may come in any order, so insert them in spatial order to keep the walks short
+   return triangulate_vertices(true);
 }
 
 void dmesh::reserve_vertices(size_t nv)
@@ -100,7 +109,7 @@ bool dmesh::triangulate_profile(bool rmv_nonmat, bool split_loops, bool rmv_unbo
       remove_unused_edges();
 
       repeat = false;
-      triangulate_vertices();
+      triangulate_vertices(true);
 
       // remove extra triangles
       if(rmv_nonmat) {
@@ -166,7 +175,7 @@ dtriangle* dmesh::add_supertriangle()
    if(m_vert.size()<6)throw std::logic_error("add_supertriangle: not enough vertices exist");
 
    // compute the extent of the point cloud
-   const dpos2d& p0 = m_vert[0]->pos();
+   const dpos2d& p0 = m_vert[0].pos();
    double xmin = p0.x();
    double xmax = xmin;
    double ymin = p0.y();
@@ -174,7 +183,7 @@ dtriangle* dmesh::add_supertriangle()
 
    // skip the supervertices in this loop
    for(size_t iv=3; iv<m_vert.size(); iv++) {
-      const dpos2d& p = m_vert[iv]->pos();
+      const dpos2d& p = m_vert[iv].pos();
       double x = p.x();
       double y = p.y();
       xmax = (x > xmax)? x : xmax;
@@ -190,9 +199,9 @@ dtriangle* dmesh::add_supertriangle()
    double xmid = (xmax + xmin) / 2.0;
    double ymid = (ymax + ymin) / 2.0;
 
-   m_vert[0]->set_pos(dpos2d(xmid-2*dmax, ymid-dmax   ));
-   m_vert[1]->set_pos(dpos2d(xmid+2*dmax, ymid-dmax   ));
-   m_vert[2]->set_pos(dpos2d(xmid       , ymid+2*dmax ));
+   m_vert[0].set_pos(dpos2d(xmid-2*dmax, ymid-dmax   ));
+   m_vert[1].set_pos(dpos2d(xmid+2*dmax, ymid-dmax   ));
+   m_vert[2].set_pos(dpos2d(xmid       , ymid+2*dmax ));
 
    // supertiangle
    dtriangle* triangle = add_triangle(0,1,2);
@@ -202,7 +211,7 @@ dtriangle* dmesh::add_supertriangle()
    return triangle;
 }
 
-bool dmesh::triangulate_vertices()
+bool dmesh::triangulate_vertices(bool spatial_order)
 {
    if(m_vert.size()<6)throw std::logic_error("triangulate_vertices: not enough vertices exist");
 
@@ -218,8 +227,15 @@ bool dmesh::triangulate_vertices()
    size_t isv3 = triangle->vertex3();
 
    // perform meshing by adding user points (skipping the super vertices)
-   for(size_t iv=3; iv<m_vert.size(); iv++) {
-      bowyer_watson(iv);
+   if(spatial_order) {
+      for(size_t iv : spatial_vertex_order()) {
+         bowyer_watson(iv);
+      }
+   }
+   else {
+      for(size_t iv=3; iv<m_vert.size(); iv++) {
+         bowyer_watson(iv);
+      }
    }
 
    // remove triangles referring to supervertices
@@ -259,14 +275,36 @@ bool dmesh::triangulate_vertices()
 void dmesh::bowyer_watson(size_t iv)
 {
    // get the position of the vertex
-   const dpos2d& p = m_vert[iv]->pos();
+   const dpos2d& p = m_vert[iv].pos();
 
    // this will contain the triangles to be removed because of p
    std::unordered_set<dtriangle*> bad_triangles;
 
-   for(auto triangle : m_tri) {
-      if(triangle->in_circumcircle(p,m_epspnt)) {
-         bad_triangles.insert(triangle);
+   dtriangle* start = locate_triangle(p);
+   if(start && start->in_circumcircle(p,m_epspnt)) {
+      // the bad triangles form a connected cavity around the triangle containing p,
+      // so grow it through the neighbours instead of testing every triangle.
+      // The exact test leaves out cocircular neighbours, they remain valid Delaunay triangles
+      std::vector<dtriangle*> candidates(1,start);
+      bad_triangles.insert(start);
+      while(candidates.size() > 0) {
+         dtriangle* triangle = candidates.back();
+         candidates.pop_back();
+         for(size_t i=0; i<3; i++) {
+            dtriangle* next = neighbour_triangle(triangle,triangle->coedge(i)->edge());
+            if(next && bad_triangles.find(next)==bad_triangles.end() && next->incircle(p) > 0.0) {
+               bad_triangles.insert(next);
+               candidates.push_back(next);
+            }
+         }
+      }
+   }
+   else {
+      // p is not covered by the mesh, check all triangles
+      for(auto triangle : m_tri) {
+         if(triangle->in_circumcircle(p,m_epspnt)) {
+            bad_triangles.insert(triangle);
+         }
       }
    }
 
@@ -302,6 +340,100 @@ void dmesh::bowyer_watson(size_t iv)
    }
 }
 
+dtriangle* dmesh::neighbour_triangle(dtriangle* triangle, dedge* edge)
+{
+   for(auto coedge : *edge) {
+      // the supertriangle edges carry a null reference
+      if(!coedge) continue;
+      if(dtriangle* other = dynamic_cast<dtriangle*>(coedge->parent())) {
+         if(other != triangle) return other;
+      }
+   }
+   return 0;
+}
+
+dtriangle* dmesh::locate_triangle(const dpos2d& pos)
+{
+   dtriangle* triangle = m_last_tri;
+   if(!triangle) {
+      if(m_tri.size() == 0) return 0;
+      triangle = *m_tri.begin();
+   }
+
+   // visibility walk: cross any edge with pos on its outside until no such edge exists.
+   // The first edge tested rotates with each step, so the walk cannot cycle
+   size_t maxstep = m_tri.size() + 3;
+   for(size_t istep=0; istep<maxstep; istep++) {
+      dtriangle* next = 0;
+      for(size_t k=0; k<3; k++) {
+         dcoedge* coedge = triangle->coedge((istep+k)%3);
+         const dpos2d& p1 = m_vert[coedge->vertex1()].pos();
+         const dpos2d& p2 = m_vert[coedge->vertex2()].pos();
+
+         // triangles are CCW, so pos is outside when it is to the right of the coedge
+         if(dpredicates::orient2d(p1,p2,pos) < 0.0) {
+            next = neighbour_triangle(triangle,coedge->edge());
+            if(!next) return 0;
+            break;
+         }
+      }
+      if(!next) return triangle;
+      triangle = next;
+   }
+   return 0;
+}
+
+std::vector<size_t> dmesh::spatial_vertex_order() const
+{
+   std::vector<size_t> order;
+   if(m_vert.size() <= 3) return order;
+   const size_t nv = m_vert.size()-3;
+   order.reserve(nv);
+   for(size_t iv=3; iv<m_vert.size(); iv++) order.push_back(iv);
+
+   // shuffle with a fixed seed, so the result is repeatable on all platforms
+   std::mt19937 gen(5489u);
+   for(size_t i=nv-1; i>0; i--) {
+      std::swap(order[i],order[gen()%(i+1)]);
+   }
+
+   // extent of the user vertices
+   double xmin = m_vert[3].pos().x(), xmax = xmin;
+   double ymin = m_vert[3].pos().y(), ymax = ymin;
+   for(size_t iv=4; iv<m_vert.size(); iv++) {
+      const dpos2d& p = m_vert[iv].pos();
+      xmin = std::min(xmin,p.x()); xmax = std::max(xmax,p.x());
+      ymin = std::min(ymin,p.y()); ymax = std::max(ymax,p.y());
+   }
+
+   // the shuffled vertices are inserted in rounds doubling in size. Within each round
+   // the vertices are sorted by grid cell, the rows traversed in alternating direction,
+   // so consecutive vertices are close to each other and the walks are short
+   std::vector<std::pair<size_t,size_t>> cells;
+   size_t first = 0;
+   size_t count = std::min<size_t>(nv,64);
+   while(first < nv) {
+      size_t ngrid = std::max<size_t>(1,static_cast<size_t>(std::sqrt(count/4.0)));
+      double dx    = std::max(xmax-xmin,1.0E-300)/ngrid;
+      double dy    = std::max(ymax-ymin,1.0E-300)/ngrid;
+
+      cells.clear();
+      for(size_t i=first; i<first+count; i++) {
+         const dpos2d& p = m_vert[order[i]].pos();
+         size_t ix = std::min(ngrid-1,static_cast<size_t>((p.x()-xmin)/dx));
+         size_t iy = std::min(ngrid-1,static_cast<size_t>((p.y()-ymin)/dy));
+         if(iy%2) ix = ngrid-1-ix;
+         cells.push_back(std::make_pair(iy*ngrid+ix,order[i]));
+      }
+      std::sort(cells.begin(),cells.end());
+      for(size_t i=0; i<count; i++) order[first+i] = cells[i].second;
+
+      first += count;
+      count  = std::min(nv-first,2*first);
+   }
+   return order;
+}
+
 bool dmesh::compute_profile()
 {
    m_profile.compute(this);
@@ -311,14 +443,14 @@ bool dmesh::compute_profile()
 size_t dmesh::add_vertex(const dpos2d& pos)
 {
    size_t iv = m_vert.size();
-   m_vert.push_back(new dvertex(pos));
+   m_vert.push_back(dvertex(pos));
    return iv;
 }
 
 const dvertex* dmesh::get_vertex(size_t iv) const
 {
    if(iv >= m_vert.size())throw std::logic_error("get_vertex: no such vertex");
-   return m_vert[iv];
+   return &m_vert[iv];
 }
 
 dedge* dmesh::get_create_edge(size_t iv1, size_t iv2)
@@ -329,7 +461,17 @@ dedge* dmesh::get_create_edge(size_t iv1, size_t iv2)
    // look it up or create a new
    auto iedge = m_edge.find(key);
    if(iedge == m_edge.end()) {
-      auto p = m_edge.insert(std::make_pair(key,new dedge(this,iv1,iv2)));
+      dedge* edge = 0;
+      if(m_edge_free.size() > 0) {
+         // recycle a removed edge
+         edge = m_edge_free.back();
+         m_edge_free.pop_back();
+         edge->reset(iv1,iv2);
+      }
+      else {
+         edge = new dedge(this,iv1,iv2);
+      }
+      auto p = m_edge.insert(std::make_pair(key,edge));
       iedge = p.first;
    }
    return iedge->second;
@@ -340,10 +482,7 @@ double dmesh::cross(size_t iv1, size_t iv2, size_t iv3)
    const dvertex* v1 = get_vertex(iv1);
    const dvertex* v2 = get_vertex(iv2);
    const dvertex* v3 = get_vertex(iv3);
-
-   dvec2d vec1(v1->pos(),v2->pos());
-   dvec2d vec2(v1->pos(),v3->pos());
-   return vec1.cross(vec2);
+   return dpredicates::orient2d(v1->pos(),v2->pos(),v3->pos());
 }
 
 dtriangle* dmesh::add_triangle(size_t iv1, dedge* edge)
@@ -353,14 +492,21 @@ dtriangle* dmesh::add_triangle(size_t iv1, dedge* edge)
 
 dtriangle* dmesh::add_triangle(size_t iv1, size_t iv2,size_t iv3)
 {
+   // CCW vertex order
+   if(cross(iv1,iv2,iv3) <= 0) std::swap(iv2,iv3);
+
    dtriangle* triangle = 0;
-   if(cross(iv1,iv2,iv3) > 0) {
-      triangle = new dtriangle(this,iv1,iv2,iv3);
+   if(m_tri_free.size() > 0) {
+      // recycle a removed triangle
+      triangle = m_tri_free.back();
+      m_tri_free.pop_back();
+      triangle->init(iv1,iv2,iv3);
    }
    else {
-      triangle = new dtriangle(this,iv1,iv3,iv2);
+      triangle = new dtriangle(this,iv1,iv2,iv3);
    }
    m_tri.insert(triangle);
+   m_last_tri = triangle;
 
    return triangle;
 }
@@ -371,7 +517,9 @@ std::vector<dedge*> dmesh::remove_triangle(dtriangle* triangle, bool remove_unus
    // some of the edges may have use_count=0 after deleting triangle
    std::vector<dedge*> edges = triangle->get_edges();
    m_tri.erase(triangle);
-   delete triangle;
+   if(triangle == m_last_tri) m_last_tri = 0;
+   triangle->clear();
+   m_tri_free.push_back(triangle);
 
    if(remove_unused_edges) {
       std::vector<dedge*> used_edges;
@@ -381,7 +529,7 @@ std::vector<dedge*> dmesh::remove_triangle(dtriangle* triangle, bool remove_unus
          if(edge->use_count() == 0) {
             size_t key = dedge::key(edge->vertex1(),edge->vertex2());
             m_edge.erase(key);
-            delete edge;
+            m_edge_free.push_back(edge);
          }
          else {
             // this edge is still in use after deleting triangle
@@ -399,7 +547,7 @@ void dmesh::remove_edge(dedge* edge)
    if(!edge->use_count() == 0) throw std::logic_error("remove_edge: trying to remove edge with use_count>0!");
    size_t key = dedge::key(edge->vertex1(),edge->vertex2());
    m_edge.erase(key);
-   delete edge;
+   m_edge_free.push_back(edge);
 }
 
 void dmesh::clear_triangles()
@@ -429,9 +577,6 @@ void dmesh::clear_vertices()
    if(m_tri.size() > 0) throw std::logic_error("clear_vertices: error, triangles exist!");
    if(m_edge.size() > 0) throw std::logic_error("clear_vertices: error, edges exist!");
 
-   for(auto v : m_vert) {
-      delete v;
-   }
    m_vert.clear();
 }
 
@@ -621,8 +766,8 @@ size_t dmesh::split_edge(dedge* edge)
       size_t v3 = triangle1->oppsite_vertex(edge);
       size_t v4 = triangle2->oppsite_vertex(edge);
 
-      const dpos2d& p3 = m_vert[v3]->pos();
-      const dpos2d& p4 = m_vert[v4]->pos();
+      const dpos2d& p3 = m_vert[v3].pos();
+      const dpos2d& p4 = m_vert[v4].pos();
 
       if(edge->length() > p3.dist(p4)) {
          // we prefer an edge flip instead of splitting the edge
@@ -646,8 +791,8 @@ size_t dmesh::split_edge(dedge* edge)
          double par = area1/(area1+area2);
 
          // compute new vertex as mean
-         const dpos2d& p1 = m_vert[v1]->pos();
-         const dpos2d& p2 = m_vert[v2]->pos();
+         const dpos2d& p1 = m_vert[v1].pos();
+         const dpos2d& p2 = m_vert[v2].pos();
 
          // weighted position between v3 and v4, moving the pos in direction of largest area
          dpos2d pmid = p4 + par*(p3-p4);
@@ -679,7 +824,7 @@ void dmesh::debug_mesh_report(std::ostream& out) const
 
    size_t ivert = 0;
    for(auto& v : m_vert) {
-      const dpos2d& p = v->pos();
+      const dpos2d& p = v.pos();
       out << "Vertex: "
           << setw(5)  << 'v'+std::to_string(ivert++)
           << setw(12) << p.x()
@@ -741,7 +886,7 @@ void dmesh::debug_stl(std::ostream& out) const
       out << "facet normal 0 0 1" << std::endl;
       out << "\touter loop" << std::endl;
 
-      std::vector<dpos2d> p = { m_vert[t->vertex1()]->pos(), m_vert[t->vertex2()]->pos(),m_vert[t->vertex3()]->pos() };
+      std::vector<dpos2d> p = { m_vert[t->vertex1()].pos(), m_vert[t->vertex2()].pos(),m_vert[t->vertex3()].pos() };
 
       for(size_t iv=0; iv<p.size(); iv++ ) {
          out << "\t\tvertex "<< std::setprecision(16) << p[iv].x() <<
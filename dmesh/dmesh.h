@@ -27,8 +27,8 @@
 #include "dentity.h"
 #include "dpos2d.h"
 #include "dprofile.h"
+#include "dvertex.h"
 
-class dvertex;
 class dedge;
 class dcoedge;
 class dtriangle;
@@ -40,6 +40,8 @@ class dtriangle;
 // It can mesh from a raw point cloud (option A) or a predefined profile (option B)
 //
 // Each dmesh instance represents a unique 2d mesh. Several instances can coexist.
+// Vertices are stored by value. Removed triangles and edges are recycled by later insertions,
+// so remeshing does not go through the allocator for each element.
 
 class dmesh {
 public:
@@ -143,12 +145,24 @@ protected:
    // compute the orientation of triangle (iv1,iv2,iv3)
    double         cross(size_t iv1, size_t iv2, size_t iv3);
 
-   // triangulate based on existing vertices
-   bool           triangulate_vertices();
+   // triangulate based on existing vertices.
+   // With spatial_order, the vertices are inserted in the order of spatial_vertex_order() instead of index order
+   bool           triangulate_vertices(bool spatial_order=false);
 
    // add point based on Bowyer Watson method, using a pre-created vertex
    void           bowyer_watson(size_t iv);
 
+   // find the triangle containing pos by walking from the most recently created triangle.
+   // Returns NULL when the walk leaves the mesh, i.e. the mesh does not cover pos
+   dtriangle*     locate_triangle(const dpos2d& pos);
+
+   // return the triangle on the other side of the edge, or NULL
+   static dtriangle* neighbour_triangle(dtriangle* triangle, dedge* edge);
+
+   // return the user vertex indices in biased randomized insertion order: shuffled,
+   // then sorted by grid cell within rounds of doubling size
+   std::vector<size_t> spatial_vertex_order() const;
+
    // remove nonmaterial triangles next to loops.
    // This can be inside holes our outside outer loops.
    void           remove_nonmaterial_triangles();
@@ -170,9 +184,12 @@ protected:
 
 private:
    double                            m_epspnt;   // tolerance for circumcircles
-   std::vector<dvertex*>             m_vert;     // user defined vertices
+   std::vector<dvertex>              m_vert;     // user defined vertices
    std::unordered_map<size_t,dedge*> m_edge;     // map of edges key(v1,v2), allowing lookup of edge based on vertices
    std::unordered_set<dtriangle*>    m_tri;      // generated triangles
+   dtriangle*                        m_last_tri; // most recently created triangle, start of locate_triangle
+   std::vector<dtriangle*>           m_tri_free; // removed triangles kept for reuse
+   std::vector<dedge*>               m_edge_free;// removed edges kept for reuse
 
    dprofile                     m_profile;  // the mesh profile (optional)
 };
@@ -0,0 +1,232 @@
+// BeginLicense:
+// Part of: dmesh - Delaunay mesh library
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "dpredicates.h"
+#include <cmath>
+#include <vector>
+
+namespace {
+
+   // an expansion is a sum of nonoverlapping doubles in increasing magnitude, without zeros
+   typedef std::vector<double> expansion;
+
+   const double epsilon        = std::ldexp(1.0,-53);
+   const double splitter       = std::ldexp(1.0,27) + 1.0;
+   const double ccwerrboundA   = (3.0 + 16.0*epsilon)*epsilon;
+   const double iccerrboundA   = (10.0 + 96.0*epsilon)*epsilon;
+
+   // x+y == a+b exactly
+   inline void two_sum(double a, double b, double& x, double& y)
+   {
+      x = a + b;
+      double bvirt = x - a;
+      double avirt = x - bvirt;
+      y = (a - avirt) + (b - bvirt);
+   }
+
+   // x+y == a+b exactly, requires |a| >= |b|
+   inline void fast_two_sum(double a, double b, double& x, double& y)
+   {
+      x = a + b;
+      y = b - (x - a);
+   }
+
+   inline void split(double a, double& hi, double& lo)
+   {
+      double c    = splitter*a;
+      double abig = c - a;
+      hi = c - abig;
+      lo = a - hi;
+   }
+
+   // x+y == a*b exactly
+   inline void two_product(double a, double b, double& x, double& y)
+   {
+      x = a*b;
+      double ahi,alo,bhi,blo;
+      split(a,ahi,alo);
+      split(b,bhi,blo);
+      double err1 = x - (ahi*bhi);
+      double err2 = err1 - (alo*bhi);
+      double err3 = err2 - (ahi*blo);
+      y = (alo*blo) - err3;
+   }
+
+   // the exact difference a-b as an expansion
+   expansion difference(double a, double b)
+   {
+      double x = a - b;
+      double bvirt = a - x;
+      double avirt = x + bvirt;
+      double y = (a - avirt) + (bvirt - b);
+      expansion h;
+      if(y != 0.0) h.push_back(y);
+      if(x != 0.0) h.push_back(x);
+      return h;
+   }
+
+   // h = e + b
+   expansion grow(const expansion& e, double b)
+   {
+      expansion h;
+      h.reserve(e.size()+1);
+      double q = b;
+      for(double ei : e) {
+         double hh;
+         two_sum(q,ei,q,hh);
+         if(hh != 0.0) h.push_back(hh);
+      }
+      if(q != 0.0 || h.empty()) h.push_back(q);
+      return h;
+   }
+
+   // h = e + f
+   expansion sum(const expansion& e, const expansion& f)
+   {
+      expansion h(e);
+      for(double fi : f) h = grow(h,fi);
+      return h;
+   }
+
+   // h = e * b
+   expansion scale(const expansion& e, double b)
+   {
+      expansion h;
+      if(e.empty()) return h;
+      h.reserve(2*e.size());
+      double q,hh;
+      two_product(e[0],b,q,hh);
+      if(hh != 0.0) h.push_back(hh);
+      for(size_t i=1; i<e.size(); i++) {
+         double p1,p0,s;
+         two_product(e[i],b,p1,p0);
+         two_sum(q,p0,s,hh);
+         if(hh != 0.0) h.push_back(hh);
+         fast_two_sum(p1,s,q,hh);
+         if(hh != 0.0) h.push_back(hh);
+      }
+      if(q != 0.0) h.push_back(q);
+      return h;
+   }
+
+   // h = e * f
+   expansion product(const expansion& e, const expansion& f)
+   {
+      expansion h;
+      for(double fi : f) h = sum(h,scale(e,fi));
+      return h;
+   }
+
+   expansion negate(expansion e)
+   {
+      for(double& ei : e) ei = -ei;
+      return e;
+   }
+
+   // the largest component carries the sign of the expansion
+   inline double estimate(const expansion& e)
+   {
+      return (e.empty())? 0.0 : e.back();
+   }
+}
+
+double dpredicates::orient2d(const dpos2d& pa, const dpos2d& pb, const dpos2d& pc)
+{
+   double detleft  = (pa.x() - pc.x()) * (pb.y() - pc.y());
+   double detright = (pa.y() - pc.y()) * (pb.x() - pc.x());
+   double det      = detleft - detright;
+
+   // the result is certain when the terms have opposite signs or the determinant exceeds the error bound
+   double detsum = 0.0;
+   if(detleft > 0.0) {
+      if(detright <= 0.0) return det;
+      detsum = detleft + detright;
+   }
+   else if(detleft < 0.0) {
+      if(detright >= 0.0) return det;
+      detsum = -detleft - detright;
+   }
+   else {
+      return det;
+   }
+
+   double errbound = ccwerrboundA*detsum;
+   if(det >= errbound || -det >= errbound) return det;
+
+   return orient2d_exact(pa,pb,pc);
+}
+
+double dpredicates::orient2d_exact(const dpos2d& pa, const dpos2d& pb, const dpos2d& pc)
+{
+   expansion acx = difference(pa.x(),pc.x());
+   expansion acy = difference(pa.y(),pc.y());
+   expansion bcx = difference(pb.x(),pc.x());
+   expansion bcy = difference(pb.y(),pc.y());
+   return estimate(sum(product(acx,bcy),negate(product(acy,bcx))));
+}
+
+double dpredicates::incircle(const dpos2d& pa, const dpos2d& pb, const dpos2d& pc, const dpos2d& pd)
+{
+   double adx = pa.x() - pd.x();
+   double bdx = pb.x() - pd.x();
+   double cdx = pc.x() - pd.x();
+   double ady = pa.y() - pd.y();
+   double bdy = pb.y() - pd.y();
+   double cdy = pc.y() - pd.y();
+
+   double bdxcdy = bdx*cdy;
+   double cdxbdy = cdx*bdy;
+   double alift  = adx*adx + ady*ady;
+
+   double cdxady = cdx*ady;
+   double adxcdy = adx*cdy;
+   double blift  = bdx*bdx + bdy*bdy;
+
+   double adxbdy = adx*bdy;
+   double bdxady = bdx*ady;
+   double clift  = cdx*cdx + cdy*cdy;
+
+   double det = alift*(bdxcdy - cdxbdy)
+              + blift*(cdxady - adxcdy)
+              + clift*(adxbdy - bdxady);
+
+   double permanent = (std::fabs(bdxcdy) + std::fabs(cdxbdy))*alift
+                    + (std::fabs(cdxady) + std::fabs(adxcdy))*blift
+                    + (std::fabs(adxbdy) + std::fabs(bdxady))*clift;
+   double errbound = iccerrboundA*permanent;
+   if(det > errbound || -det > errbound) return det;
+
+   return incircle_exact(pa,pb,pc,pd);
+}
+
+double dpredicates::incircle_exact(const dpos2d& pa, const dpos2d& pb, const dpos2d& pc, const dpos2d& pd)
+{
+   expansion adx = difference(pa.x(),pd.x());
+   expansion bdx = difference(pb.x(),pd.x());
+   expansion cdx = difference(pc.x(),pd.x());
+   expansion ady = difference(pa.y(),pd.y());
+   expansion bdy = difference(pb.y(),pd.y());
+   expansion cdy = difference(pc.y(),pd.y());
+
+   expansion alift = sum(product(adx,adx),product(ady,ady));
+   expansion blift = sum(product(bdx,bdx),product(bdy,bdy));
+   expansion clift = sum(product(cdx,cdx),product(cdy,cdy));
+
+   expansion bc = sum(product(bdx,cdy),negate(product(cdx,bdy)));
+   expansion ca = sum(product(cdx,ady),negate(product(adx,cdy)));
+   expansion ab = sum(product(adx,bdy),negate(product(bdx,ady)));
+
+   return estimate(sum(sum(product(alift,bc),product(blift,ca)),product(clift,ab)));
+}
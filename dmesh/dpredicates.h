@@ -0,0 +1,43 @@
+// BeginLicense:
+// Part of: dmesh - Delaunay mesh library
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef DPREDICATES_H
+#define DPREDICATES_H
+
+#include "dpos2d.h"
+
+// Geometry
+// ========
+// dpredicates are the robust geometric predicates used by the mesher, following
+// J.R. Shewchuk, "Adaptive Precision Floating-Point Arithmetic and Fast Robust Geometric Predicates".
+// Each predicate is first evaluated in plain floating point. Only when the result is smaller
+// than the error bound, the sign is determined by exact expansion arithmetic.
+
+class dpredicates {
+public:
+   // positive when pa,pb,pc are in CCW order, negative when CW and zero when collinear.
+   // The value is twice the signed area of the triangle
+   static double orient2d(const dpos2d& pa, const dpos2d& pb, const dpos2d& pc);
+
+   // positive when pd is inside the circle through the CCW ordered pa,pb,pc,
+   // negative when outside and zero when the 4 points are cocircular
+   static double incircle(const dpos2d& pa, const dpos2d& pb, const dpos2d& pc, const dpos2d& pd);
+
+protected:
+   static double orient2d_exact(const dpos2d& pa, const dpos2d& pb, const dpos2d& pc);
+   static double incircle_exact(const dpos2d& pa, const dpos2d& pb, const dpos2d& pc, const dpos2d& pd);
+};
+
+#endif // DPREDICATES_H
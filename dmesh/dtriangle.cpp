@@ -22,6 +22,7 @@
 #include "dloop.h"
 #include "dvec2d.h"
 #include "dline2d.h"
+#include "dpredicates.h"
 
 #include <unordered_set>
 
@@ -29,25 +30,29 @@ dtriangle::dtriangle(dmesh* mesh,size_t iv1,size_t iv2,size_t iv3)
 : dentity(mesh)
 , m_circle(dpos2d(),-1.0)
 {
-   // create_coedge will generate the underlying dedge as required
+   init(iv1,iv2,iv3);
+}
 
-   m_coedges.reserve(3);
-   m_coedges.push_back(create_coedge(iv1,iv2));
-   m_coedges.push_back(create_coedge(iv2,iv3));
-   m_coedges.push_back(create_coedge(iv3,iv1));
+void dtriangle::init(size_t iv1,size_t iv2,size_t iv3)
+{
+   // attach_coedge will generate the underlying dedge as required
+   attach_coedge(0,iv1,iv2);
+   attach_coedge(1,iv2,iv3);
+   attach_coedge(2,iv3,iv1);
 
-   const dpos2d& p1 = mesh->get_vertex(m_coedges[0]->vertex1())->pos();
-   const dpos2d& p2 = mesh->get_vertex(m_coedges[1]->vertex1())->pos();
-   const dpos2d& p3 = mesh->get_vertex(m_coedges[2]->vertex1())->pos();
+   const dmesh* mesh = get_mesh();
+   const dpos2d& p1 = mesh->get_vertex(iv1)->pos();
+   const dpos2d& p2 = mesh->get_vertex(iv2)->pos();
+   const dpos2d& p3 = mesh->get_vertex(iv3)->pos();
 
    m_circle = dcircle(p1,p2,p3);
 }
 
 void dtriangle::super()
 {
-   m_coedges[0]->edge()->addref(0);
-   m_coedges[1]->edge()->addref(0);
-   m_coedges[2]->edge()->addref(0);
+   m_coedges[0].edge()->addref(0);
+   m_coedges[1].edge()->addref(0);
+   m_coedges[2].edge()->addref(0);
 }
 
 dtriangle::~dtriangle()
@@ -60,43 +65,51 @@ bool dtriangle::in_circumcircle(const dpos2d& pos, double epspnt)
    return m_circle.pos_inside(pos,epspnt);
 }
 
-dcoedge* dtriangle::create_coedge(size_t iv1, size_t iv2)
+double dtriangle::incircle(const dpos2d& pos) const
+{
+   const dmesh* mesh = get_mesh();
+   const dpos2d& p1 = mesh->get_vertex(vertex1())->pos();
+   const dpos2d& p2 = mesh->get_vertex(vertex2())->pos();
+   const dpos2d& p3 = mesh->get_vertex(vertex3())->pos();
+   return dpredicates::incircle(p1,p2,p3,pos);
+}
+
+void dtriangle::attach_coedge(size_t i, size_t iv1, size_t iv2)
 {
    // get the underlying edge
    dedge* edge = get_mesh()->get_create_edge(iv1,iv2);
    bool fwd = (iv1 == edge->vertex1());
-   return new dcoedge(this,edge,fwd);
+   m_coedges[i].attach(this,edge,fwd);
 }
 
 void dtriangle::clear()
 {
    // the coedges are owned here
-   for(auto coedge : m_coedges) {
-      delete coedge;
+   for(auto& coedge : m_coedges) {
+      coedge.detach();
    }
-   m_coedges.clear();
 }
 
 
 std::vector<dedge*> dtriangle::get_edges() const
 {
    std::vector<dedge*> edges(3);
-   edges[0] = m_coedges[0]->edge();
-   edges[1] = m_coedges[1]->edge();
-   edges[2] = m_coedges[2]->edge();
+   edges[0] = m_coedges[0].edge();
+   edges[1] = m_coedges[1].edge();
+   edges[2] = m_coedges[2].edge();
    return std::move(edges);
 }
 
 const dcoedge* dtriangle::coedge(size_t i) const
 {
    if(i>2) throw std::logic_error("dtriangle::coedge: index > 2");
-   return m_coedges[i];
+   return &m_coedges[i];
 }
 
 dcoedge* dtriangle::coedge(size_t i)
 {
    if(i>2) throw std::logic_error("dtriangle::coedge: index > 2");
-   return m_coedges[i];
+   return &m_coedges[i];
 }
 
 
@@ -124,10 +137,11 @@ double dtriangle::signed_area() const
    */
 
    double sum = 0.0;
-   size_t ivcur = (*m_coedges.begin())->vertex1();
+   size_t ivcur = m_coedges[0].vertex1();
    const dmesh* mesh = get_mesh();
    dpos2d p1 = mesh->get_vertex(ivcur)->pos();
-   for(auto coedge : m_coedges) {
+   for(auto& c : m_coedges) {
+      const dcoedge* coedge = &c;
 
       // edge vertex coordinates
       ivcur = coedge->vertex2();
@@ -211,7 +225,8 @@ double dtriangle::aspect_ratio() const
 
 const dcoedge* dtriangle::free_coedge() const
 {
-   for(auto coedge : m_coedges) {
+   for(auto& c : m_coedges) {
+      const dcoedge* coedge = &c;
       if(coedge->edge()->use_count() < 2)return coedge;
    }
    return 0;
@@ -219,8 +234,9 @@ const dcoedge* dtriangle::free_coedge() const
 
 const dcoedge*  dtriangle::reversed_loop() const
 {
-   for(auto coedge : m_coedges) {
-      dedge* edge = coedge->edge();
+   for(auto& c : m_coedges) {
+      const dcoedge* coedge = &c;
+      const dedge* edge = coedge->edge();
       // traverse the neighbouring coedges
       for(auto other_coedge : *edge) {
          if(dloop* loop = dynamic_cast<dloop*>(other_coedge->parent())) {
@@ -237,8 +253,9 @@ size_t dtriangle::oppsite_vertex(const dedge* edge) const
    vt.insert(vertex1());
    vt.insert(vertex2());
    vt.insert(vertex3());
-   for(auto coedge : m_coedges) {
-      dedge* this_edge = coedge->edge();
+   for(auto& c : m_coedges) {
+      const dcoedge* coedge = &c;
+      const dedge* this_edge = coedge->edge();
       if(this_edge == edge) {
          vt.erase(edge->vertex1());
          vt.erase(edge->vertex2());
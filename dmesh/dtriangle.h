@@ -30,6 +30,7 @@ class dedge;
 // A dtriangle is a mesh triangle with its 3 sides defined by coedges
 // it also contains a circle defined by the 3 triangle vertices.
 // Triangles shall be defined with CCW vertex order, giving positive signed area.
+// The coedges are held by value. Removed triangles are kept by the mesh for reuse.
 
 class dtriangle : public dentity {
 public:
@@ -43,13 +44,17 @@ public:
    const dcoedge* coedge(size_t i) const;
 
    // convenient access to the 3 vertices of the triangle
-   size_t vertex1() const { return m_coedges[0]->vertex1(); }
-   size_t vertex2() const { return m_coedges[1]->vertex1(); }
-   size_t vertex3() const { return m_coedges[2]->vertex1(); }
+   size_t vertex1() const { return m_coedges[0].vertex1(); }
+   size_t vertex2() const { return m_coedges[1].vertex1(); }
+   size_t vertex3() const { return m_coedges[2].vertex1(); }
 
    // return true if 'pos' is inside the triangle circumcircle
    bool in_circumcircle(const dpos2d& pos, double epspnt);
 
+   // exact circumcircle test: positive when pos is strictly inside the circumcircle,
+   // negative outside and zero on the circle
+   double incircle(const dpos2d& pos) const;
+
    // return true if 'pos' is inside the triangle (more expensive than in_circumcircle(...))
    bool in_triangle(const dpos2d& pos);
 
@@ -81,17 +86,23 @@ protected:
    // return container with all triangle edges
    std::vector<dedge*> get_edges() const;
 
-   // create coedge in this triangle
-   dcoedge* create_coedge(size_t iv1, size_t iv2);
+   // attach coedge i of this triangle to the edge (iv1,iv2)
+   void attach_coedge(size_t i, size_t iv1, size_t iv2);
 
    dtriangle(dmesh* mesh, size_t iv1,size_t iv2,size_t iv3);
    virtual ~dtriangle();
 
+   // (re)initialise the triangle from 3 vertices
+   void init(size_t iv1,size_t iv2,size_t iv3);
+
+   // detach the coedges from their edges
    void clear();
 
 private:
-   std::vector<dcoedge*> m_coedges;  // the 3 edges of the triangle
-   dcircle          m_circle;   // the circumcircle of the triangle
+   // the 3 edges of the triangle. Mutable as const triangles hand out their edges for modification,
+   // as when the coedges were held by pointer
+   mutable dcoedge  m_coedges[3];
+   dcircle          m_circle;      // the circumcircle of the triangle
 };
 
 #endif // DTRIANGLE_H
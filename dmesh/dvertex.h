@@ -22,19 +22,20 @@
 // Topology
 // ========
 // a dvertex is a topological point with reference to a geometrical position.
+// The mesh stores its vertices by value in a contiguous array.
 
 class dvertex  {
 public:
    friend class dmesh;
 
+   dvertex(const dpos2d& pos);
+   ~dvertex();
+
    // return vertex position
    const dpos2d& pos() const { return m_pos; }
 
 protected:
 
-   dvertex(const dpos2d& pos);
-   virtual ~dvertex();
-
    // change the vertex position
    void set_pos(const dpos2d& pos);
 
@@ -14,26 +14,9 @@
 // EndLicense:
 
 #include "qhull2d.h"
-#include "qvec3d.h"
-#include <iostream>
-#include <set>
+#include <algorithm>
 using namespace std;
 
-// ref http://stackoverflow.com/questions/19530731/qhull-library-c-interface
-
-//#include "libqhullcpp/RboxPoints.h"
-//#include "libqhullcpp/Coordinates.h"
-//#include "libqhullcpp/QhullError.h"
-#include "libqhullcpp/Qhull.h"
-//#include "libqhullcpp/QhullQh.h"
-#include "libqhullcpp/QhullFacet.h"
-#include "libqhullcpp/QhullFacetList.h"
-#include "libqhullcpp/QhullFacetSet.h"
-//#include "libqhullcpp/QhullLinkedList.h"
-#include "libqhullcpp/QhullVertex.h"
-//#include "libqhullcpp/QhullSet.h"
-#include "libqhullcpp/QhullVertexSet.h"
-
 qhull2d::qhull2d()
 {}
 
@@ -48,13 +31,12 @@ void qhull2d::clear()
 
 void qhull2d::reserve(size_t nvert)
 {
-   m_in_vert.reserve(3*nvert);
+   m_in_vert.reserve(nvert);
 }
 
 void qhull2d::push_back(const xy& pnt)
 {
-   m_in_vert.push_back(pnt.x);
-   m_in_vert.push_back(pnt.y);
+   m_in_vert.push_back(pnt);
 }
 
 size_t qhull2d::vertex_size() const
@@ -62,104 +44,42 @@ size_t qhull2d::vertex_size() const
    return m_contour.size();
 }
 
-// a hidden helper function to get to next vertex along contour using obfuscated code....
-static orgQhull::QhullVertex next_contour_vertex(orgQhull::QhullVertex& vtx, const std::set<size_t>& visited)
+// z component of (a-o) x (b-o), positive when o->a->b turns CCW
+static inline double cross(const qhull2d::xy& o, const qhull2d::xy& a, const qhull2d::xy& b)
 {
-   // get vertex neighbour facets, look for 1st unvisited vertex and return it
-   // This causes us to traverse the contour in one direction
-   orgQhull::QhullFacetSet fSet = vtx.neighborFacets();
-   for(auto fit = fSet.begin(); fit != fSet.end(); ++fit)  {
-      const orgQhull::QhullFacet& f = *fit;
-      orgQhull::QhullVertexSet vSet = f.vertices();
-      for (auto vIt = vSet.begin(); vIt != vSet.end(); ++vIt)  {
-         orgQhull::QhullVertex v = *vIt;
-         if(visited.find(v.id()) == visited.end()) return v;
-      }
-   }
-   return vtx;
+   return (a.x-o.x)*(b.y-o.y) - (a.y-o.y)*(b.x-o.x);
 }
 
 bool qhull2d::compute()
 {
-   // this is the 2d version
-   const int pointDimension = 2;
-   int pointCount = static_cast<int>(m_in_vert.size()/pointDimension);
-
-   // actually run the hull algorithm
-   orgQhull::Qhull qhull;
-   qhull.runQhull("qhull2d",pointDimension, pointCount,&m_in_vert[0],"Qt");
-
-   // the result will be somewhat chaotic, the following must be fixed in a few post-processing steps
-   // - The "facets" returned are actually edges between hull contour vertices
-   // - we need to look at neighbour facets at each vertex and then pick the next one we have not already seen
-   // - once complete, we must check for CW vs. CCW contour sequence and reverse as required. we want CCW
-
-   // compute the hull contour
-   // call to defineVertexNeighborFacets() is required for vtx.neighborFacets() to work
-   std::set<size_t> visited;
-   qhull.defineVertexNeighborFacets();
-   orgQhull::QhullVertex vtx =  qhull.firstVertex();
-   int id_prev = vtx.id();
-   do {
-      // record the current vertex as seen
-      id_prev = vtx.id();
-      visited.insert(id_prev);
-
-      // store the vertex coordinates in the contour vector
-      orgQhull::QhullPoint p = vtx.point();
-      double* coords = p.coordinates();
-      m_contour.push_back(xy(coords[0],coords[1]));
-
-      // get next vertex along contour
-      // if no next found, the input vertex is returned
-      vtx = next_contour_vertex(vtx,visited);
+   // Andrew's monotone chain: sort the points lexicographically, then build the lower
+   // and upper hulls in one pass each. Input from profile contours is often sorted already
+   auto less_xy = [](const xy& a, const xy& b) { return (a.x < b.x) || (a.x == b.x && a.y < b.y); };
+   if(!std::is_sorted(m_in_vert.begin(),m_in_vert.end(),less_xy)) {
+      std::sort(m_in_vert.begin(),m_in_vert.end(),less_xy);
    }
-   while(vtx.id() != id_prev);
 
-   // At this point we have the complete contour, but it might be sorted the wrong way.
-   // We want CCW, so we require a negative area
-   if(signed_area() > 0) {
-      // we need to flip
-      std::reverse(m_contour.begin(),m_contour.end());
+   m_contour.clear();
+   const size_t np = m_in_vert.size();
+   if(np < 3) return false;
+   m_contour.resize(2*np);
+
+   // lower hull, collinear points are dropped
+   size_t k = 0;
+   for(size_t i=0; i<np; i++) {
+      while(k >= 2 && cross(m_contour[k-2],m_contour[k-1],m_in_vert[i]) <= 0) k--;
+      m_contour[k++] = m_in_vert[i];
    }
-   return (m_contour.size() > 2);
-}
-
-double qhull2d::signed_area() const
-{
-   // this function computes the area of the polygon described by m_contour.
-   // it returns a positive area if the contour is CW
-
-   size_t np  = m_contour.size();
-   double sum = 0.0;
-
-   for (size_t ip = 1; ip < np; ip++)    {
-      const xy& prev = m_contour[ip-1];
-      const xy& pcur = m_contour[ip];
 
-      double x1 = prev.x;
-      double y1 = prev.y;
-
-      double x2 = pcur.x;
-      double y2 = pcur.y;
-
-      sum += (x2 - x1)*(y2 + y1);
+   // upper hull, the last point is the first point of the lower hull
+   for(size_t i=np-1, t=k+1; i>0; i--) {
+      while(k >= t && cross(m_contour[k-2],m_contour[k-1],m_in_vert[i-1]) <= 0) k--;
+      m_contour[k++] = m_in_vert[i-1];
    }
 
-   // close the polygon: account for the final edge from last to first point
-   const xy& prev = m_contour[np-1];
-   const xy& pcur = m_contour[0];
-
-   double x1 = prev.x;
-   double y1 = prev.y;
-
-   double x2 = pcur.x;
-   double y2 = pcur.y;
-
-   sum += (x2 - x1)*(y2 + y1);
-
-   double s_area = 0.5*sum;
-   return s_area;
+   // the resulting contour is CCW
+   m_contour.resize(k-1);
+   return (m_contour.size() > 2);
 }
 
 qhull2d::vertex_iterator qhull2d::vertex_begin()
@@ -171,5 +91,3 @@ qhull2d::vertex_iterator qhull2d::vertex_end()
 {
    return m_contour.end();
 }
-
-
@@ -20,7 +20,7 @@
 #include <map>
 #include <cstddef>
 
-// compute convex 2d hull from a set of input coordinates
+// compute convex 2d hull from a set of input coordinates using Andrew's monotone chain.
 // the resulting hull contour is guaranteed to be CCW
 
 class qhull2d {
@@ -62,10 +62,7 @@ public:
    vertex_iterator vertex_end();
 
 private:
-   double signed_area() const;
-
-private:
-   std::vector<double>  m_in_vert;   // input vertices as flat vector {x1,y1,z1,x2,y2,z2,....,xn,yn,zn}
+   vertex_vector        m_in_vert;   // input vertices
    vertex_vector        m_contour;   // hull contour
 };
 
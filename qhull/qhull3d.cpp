@@ -15,6 +15,7 @@
 
 #include "qhull3d.h"
 #include "qvec3d.h"
+#include <algorithm>
 #include <iostream>
 using namespace std;
 
@@ -27,6 +28,7 @@ using namespace std;
 //#include "libqhullcpp/QhullQh.h"
 #include "libqhullcpp/QhullFacet.h"
 #include "libqhullcpp/QhullFacetList.h"
+#include "libqhullcpp/QhullHyperplane.h"
 //#include "libqhullcpp/QhullLinkedList.h"
 #include "libqhullcpp/QhullVertex.h"
 //#include "libqhullcpp/QhullSet.h"
@@ -99,6 +101,13 @@ void qhull3d::push_back(double x, double y, double z)
    m_in_vert.push_back(z);
 }
 
+double* qhull3d::append(size_t npoints)
+{
+   size_t offset = m_in_vert.size();
+   m_in_vert.resize(offset + 3*npoints);
+   return (npoints > 0)? &m_in_vert[offset] : 0;
+}
+
 size_t qhull3d::nvertices() const
 {
    return m_vert.size();
@@ -106,11 +115,96 @@ size_t qhull3d::nvertices() const
 
 size_t qhull3d::nfaces() const
 {
-   return m_faces.size();
+   return m_faces.size()/3;
+}
+
+// inputs with fewer points than this are passed directly to qhull
+static const size_t filter_min_points = 64;
+
+size_t qhull3d::filter_interior()
+{
+   const size_t np = m_in_vert.size()/3;
+   if(np < filter_min_points) return 0;
+
+   // extreme points along the axes and the diagonals
+   static const double dirs[13][3] = { {1,0,0},{0,1,0},{0,0,1},
+                                       {1,1,1},{1,1,-1},{1,-1,1},{1,-1,-1},
+                                       {1,1,0},{1,-1,0},{1,0,1},{1,0,-1},{0,1,1},{0,1,-1} };
+   const size_t ndir = 13;
+   std::vector<size_t> imin(ndir,0),imax(ndir,0);
+   std::vector<double> dmin(ndir),dmax(ndir);
+   for(size_t id=0; id<ndir; id++) {
+      dmin[id] = dmax[id] = dirs[id][0]*m_in_vert[0] + dirs[id][1]*m_in_vert[1] + dirs[id][2]*m_in_vert[2];
+   }
+   for(size_t ip=1; ip<np; ip++) {
+      const double* p = &m_in_vert[3*ip];
+      for(size_t id=0; id<ndir; id++) {
+         double d = dirs[id][0]*p[0] + dirs[id][1]*p[1] + dirs[id][2]*p[2];
+         if(d < dmin[id]) { dmin[id] = d; imin[id] = ip; }
+         if(d > dmax[id]) { dmax[id] = d; imax[id] = ip; }
+      }
+   }
+
+   std::vector<size_t> extremes(imin);
+   extremes.insert(extremes.end(),imax.begin(),imax.end());
+   std::sort(extremes.begin(),extremes.end());
+   extremes.erase(std::unique(extremes.begin(),extremes.end()),extremes.end());
+   if(extremes.size() < 4) return 0;
+
+   std::vector<double> coords;
+   coords.reserve(3*extremes.size());
+   for(size_t ip : extremes) coords.insert(coords.end(),&m_in_vert[3*ip],&m_in_vert[3*ip+3]);
+
+   // planes of the extreme point polytope, normals pointing out. A degenerate
+   // polytope (e.g. flat input) makes qhull fail, then nothing is filtered
+   std::vector<double> planes;
+   try {
+      orgQhull::Qhull qhull;
+      qhull.runQhull("qhull3d_filter",3,static_cast<int>(extremes.size()),&coords[0],"Qt");
+      orgQhull::QhullFacetList facets = qhull.facetList();
+      for(orgQhull::QhullFacetList::iterator it = facets.begin(); it != facets.end(); ++it)  {
+         if(!it->isGood()) continue;
+         orgQhull::QhullHyperplane plane = it->hyperplane();
+         const double* n = plane.coordinates();
+         planes.push_back(n[0]);
+         planes.push_back(n[1]);
+         planes.push_back(n[2]);
+         planes.push_back(plane.offset());
+      }
+   }
+   catch(std::exception&) {
+      return 0;
+   }
+   if(planes.size() == 0) return 0;
+
+   // points within tolerance of the polytope surface are kept
+   double extent = 0.0;
+   for(size_t id=0; id<3; id++) extent = std::max(extent,dmax[id]-dmin[id]);
+   const double tol = 1.0E-9*extent;
+
+   size_t nkeep = 0;
+   for(size_t ip=0; ip<np; ip++) {
+      const double* p = &m_in_vert[3*ip];
+      bool inside = true;
+      for(size_t ipl=0; ipl<planes.size() && inside; ipl+=4) {
+         inside = (planes[ipl]*p[0] + planes[ipl+1]*p[1] + planes[ipl+2]*p[2] + planes[ipl+3] < -tol);
+      }
+      if(!inside) {
+         if(nkeep != ip) std::copy(p,p+3,&m_in_vert[3*nkeep]);
+         nkeep++;
+      }
+   }
+   m_in_vert.resize(3*nkeep);
+
+   return np - nkeep;
 }
 
 bool qhull3d::compute()
 {
+   filter_interior();
+   m_vert.clear();
+   m_faces.clear();
+
    const int pointDimension = 3;
    int pointCount = static_cast<int>(m_in_vert.size()/pointDimension);
 
@@ -122,16 +216,20 @@ bool qhull3d::compute()
    // - vertex id's are not sequential anymore, some may be missing
    // - some faces will have face normals pointing the wrong way, no consistency
 
-   // <id,iinode> : vmap = mapping from qhull vertex_id to iinode (zero based and sequential)
-   map<size_t,size_t> vmap;
-   size_t iinode = 0;
+   // vmap = mapping from qhull vertex_id to zero based sequential index
+   orgQhull::QhullVertexList  vertices = qhull.vertexList();
+   size_t max_id = 0;
+   for (orgQhull::QhullVertexList::iterator it = vertices.begin(); it != vertices.end(); ++it)  {
+      max_id = std::max(max_id,static_cast<size_t>(it->id()));
+   }
+   std::vector<size_t>& vmap = m_vmap;
+   vmap.assign(max_id+1,0);
 
    // compute mean hull coordinate, this will always be inside the convex hull
    xyz pmean;
-   size_t nv = 0;
+   m_vert.reserve(qhull.vertexCount());
 
    // First collect vertices
-   orgQhull::QhullVertexList  vertices = qhull.vertexList();
    for (orgQhull::QhullVertexList::iterator it = vertices.begin(); it != vertices.end(); ++it)  {
 
       // vertex and its coordinates
@@ -139,148 +237,70 @@ bool qhull3d::compute()
       orgQhull::QhullPoint p = v.point();
       double* coords = p.coordinates();
 
-      // insert the new vertex with sequential number iinode, then keep mapping from id() to iinode
       xyz pnt(coords[0],coords[1],coords[2]);
-
-      // add oint to boundary box
       pmean.add(pnt);
-      nv++;
-
-      // insert in vertex map
-      m_vert.insert(std::make_pair(iinode, pnt ));
 
-      // insert in id to iinode map
-      vmap[v.id()] = iinode++;
+      vmap[v.id()] = m_vert.size();
+      m_vert.push_back(pnt);
    }
 
    // the "hull_center" is a point guaranteed to be inside the convex hull body
-   pmean.scale(1.0/nv);
+   pmean.scale(1.0/m_vert.size());
    xyz hull_center = pmean;
 
-   int iface = 0;
+   // "Qt" makes all facets triangles, larger facets would be split in a fan
+   m_faces.reserve(3*qhull.facetCount());
    orgQhull::QhullFacetList facets = qhull.facetList();
    for (orgQhull::QhullFacetList::iterator it = facets.begin(); it != facets.end(); ++it)  {
 
       // check to see if the face is usable
       if(it->isGood()) {
-
-         // get the face and it vertices
-         orgQhull::QhullFacet& f = *it;
-         orgQhull::QhullVertexSet vSet = f.vertices();
-
-         // we want a continuous sequence of face id's as output, so just increment here
-         face_vertices& fv = m_faces[iface++];
-
-         // compute the face center
-         xyz face_cen;
+         orgQhull::QhullVertexSet vSet = it->vertices();
+         size_t fv[3] = {0,0,0};
+         size_t nfv = 0;
          for (orgQhull::QhullVertexSet::iterator vIt = vSet.begin(); vIt != vSet.end(); ++vIt)  {
-
-            orgQhull::QhullVertex v = *vIt;
-            size_t node_id = v.id();
-            size_t iinode  = vmap[node_id];
-
-            // Keep the converted reference for the face vertex in the face vertex vector
-            fv.push_back(iinode);
-
-            // accumulate face vertex coordinates
-            xyz& fvc = m_vert[iinode];
-            face_cen.x += fvc.x;
-            face_cen.y += fvc.y;
-            face_cen.z += fvc.z;
+            size_t iv = vmap[(*vIt).id()];
+            if(nfv < 2) fv[nfv] = iv;
+            else {
+               fv[2] = iv;
+               add_triangle(hull_center,fv[0],fv[1],fv[2]);
+               fv[1] = iv;
+            }
+            nfv++;
          }
-
-         // divide by number of face vertices to get the face center estimate
-         size_t nfv = fv.size();
-         face_cen.x /= nfv;
-         face_cen.y /= nfv;
-         face_cen.z /= nfv;
-
-         // compute the face normal and flip the face as needed
-         check_flip(hull_center,face_cen,fv);
       }
    }
 
    return true;
 }
 
-void qhull3d::check_flip(xyz& cen, xyz& face_cen, face_vertices& fv)
-{
-   // vector from centre of hull to centre of face
-   qvec3d vref(face_cen.x-cen.x,face_cen.y-cen.y,face_cen.z-cen.z);
-   qvec3d vnorm;
-
-   if(fv.size() < 4) {
-      // a simple triangle, use the fastest method
-
-      // face coordinates
-      xyz&  p0 = m_vert[fv[0]];
-      xyz&  p1 = m_vert[fv[1]];
-      xyz&  p2 = m_vert[fv[2]];
-
-      // face edge vectors
-      qvec3d v1(p1.x-p0.x,p1.y-p0.y,p1.z-p0.z);
-      qvec3d v2(p2.x-p1.x,p2.y-p1.y,p2.z-p1.z);
-
-      // face normal
-      vnorm = v1.cross(v2);
-   }
-   else {
-      // use Newell's method, more expensive but safer for general polygons
-      vnorm = newell_face_normal(fv);
-   }
-
-   if(vref.dot(vnorm) < 0.0) {
-
-      // normal was opposite the reference, so we must flip the face
-      std::reverse(fv.begin(),fv.end());
-   }
-}
-
-qvec3d qhull3d::newell_face_normal(face_vertices& fv)
+void qhull3d::add_triangle(const xyz& cen, size_t i0, size_t i1, size_t i2)
 {
-   // https://www.opengl.org/wiki/Calculating_a_Surface_Normal
-   // http://www.gamedev.net/topic/416131-calculating-a-polygon-normal/?p=3771628#entry3771628
-
-   double nx(0.0),ny(0.0),nz(0.0);
-   size_t nvert = fv.size();
-   size_t ilast = nvert-1;
-   for(size_t i=0; i<nvert; i++) {
-
-      // determine next vertex
-      size_t inext = (i<ilast)? (i+1) : 0;
-
-      // obtain current and next vertex coorddinates
-      const xyz& vc = m_vert[fv[i]];
-      const xyz& vn = m_vert[fv[inext]];
-
-      // compute for this vertex
-      nx += (vc.y - vn.y) * (vc.z + vn.z);
-      ny += (vc.z - vn.z) * (vc.x + vn.x);
-      nz += (vc.x - vn.x) * (vc.y + vn.y);
-   }
+   const xyz&  p0 = m_vert[i0];
+   const xyz&  p1 = m_vert[i1];
+   const xyz&  p2 = m_vert[i2];
 
-   // normalise vector
-   qvec3d vnorm(nx,ny,nz);
-   vnorm.normalise();
-   return vnorm;
-}
-
-qhull3d::face_iterator qhull3d::face_begin()
-{
-   return m_faces.begin();
-}
-
-qhull3d::face_iterator qhull3d::face_end()
-{
-   return m_faces.end();
+   // vector from centre of hull to centre of face
+   qvec3d vref((p0.x+p1.x+p2.x)/3.0-cen.x,(p0.y+p1.y+p2.y)/3.0-cen.y,(p0.z+p1.z+p2.z)/3.0-cen.z);
+
+   // face normal from the edge vectors
+   qvec3d v1(p1.x-p0.x,p1.y-p0.y,p1.z-p0.z);
+   qvec3d v2(p2.x-p1.x,p2.y-p1.y,p2.z-p1.z);
+   qvec3d vnorm = v1.cross(v2);
+
+   // normal opposite the reference means the face must be flipped
+   bool flip = (vref.dot(vnorm) < 0.0);
+   m_faces.push_back(i0);
+   m_faces.push_back(flip? i2 : i1);
+   m_faces.push_back(flip? i1 : i2);
 }
 
-qhull3d::vertex_iterator qhull3d::vertex_begin()
+qhull3d::vertex_iterator qhull3d::vertex_begin() const
 {
    return m_vert.begin();
 }
 
-qhull3d::vertex_iterator qhull3d::vertex_end()
+qhull3d::vertex_iterator qhull3d::vertex_end() const
 {
    return m_vert.end();
 }
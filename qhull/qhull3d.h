@@ -17,7 +17,6 @@
 #define QHULL3D_H
 
 #include <vector>
-#include <map>
 #include <cstddef>
 #include "qvec3d.h"
 
@@ -38,17 +37,16 @@ public:
       double z;
    };
 
-   typedef std::map<size_t,xyz>           vertex_map;
-   typedef vertex_map::iterator           vertex_iterator;
+   typedef std::vector<xyz>               vertex_vector;
+   typedef vertex_vector::const_iterator  vertex_iterator;
 
-   typedef std::vector<size_t>            face_vertices;
-   typedef std::map<size_t,face_vertices> face_map;
-   typedef face_map::iterator             face_iterator;
+   // triangle vertex indices, 3 consecutive entries per face
+   typedef std::vector<size_t>            face_vector;
 
    qhull3d();
    virtual ~qhull3d();
 
-   // clear all
+   // clear all, allocated capacity is kept so the object can be reused for another hull
    void clear();
 
    // reserve space for number of vertices
@@ -56,10 +54,19 @@ public:
 
    // push an input coordinate
    void push_back(double x, double y, double z);
+
+   // add npoints input coordinates and return the flat {x,y,z,...} block to fill in.
+   // The pointer is invalidated by the next push_back or append
+   double* append(size_t npoints);
    in_coords_iterator in_coords_begin();
    in_coords_iterator in_coords_end();
 
-   // compute the convex hull, faces will be properly oriented
+   // remove input points strictly inside the polytope spanned by the extreme points
+   // in a few fixed directions (Akl-Toussaint). Returns the number of points removed
+   size_t filter_interior();
+
+   // compute the convex hull, faces will be properly oriented.
+   // Large inputs are reduced with filter_interior first
    bool compute();
 
    // number of vertices (defined after calling compute)
@@ -69,24 +76,23 @@ public:
    size_t nfaces() const;
 
    // vertex traversal. result vertices are different from input!
-   vertex_iterator vertex_begin();
-   vertex_iterator vertex_end();
+   vertex_iterator vertex_begin() const;
+   vertex_iterator vertex_end() const;
 
-   // face traversal
-   face_iterator face_begin();
-   face_iterator face_end();
+   // result vertices and triangles, face i uses faces()[3*i .. 3*i+2]
+   const vertex_vector& vertices() const { return m_vert; }
+   const face_vector&   faces() const    { return m_faces; }
 
 private:
-   void check_flip(xyz& cen, xyz& face_cen, face_vertices& vert);
-
-   // compute a face normal using Newell's method
-   qvec3d newell_face_normal(face_vertices& vert);
+   // append triangle (i0,i1,i2), flipped as required to make its normal point away from cen
+   void add_triangle(const xyz& cen, size_t i0, size_t i1, size_t i2);
 
 private:
    in_coords  m_in_vert;   // input vertices as flat vector {x1,y1,z1,x2,y2,z2,....,xn,yn,zn}
 
-   vertex_map     m_vert;    // result vertices
-   face_map       m_faces;   // face id, face vertex indices
+   vertex_vector        m_vert;    // result vertices
+   face_vector          m_faces;   // result triangles, 3 vertex indices per face
+   std::vector<size_t>  m_vmap;    // qhull vertex id to result vertex index, kept for reuse
 };
 
 #endif // QHULL3D_H
@@ -0,0 +1,114 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "allocator_stats.h"
+#include <cstdint>
+#include <string>
+
+#if defined(XCSG_JEMALLOC)
+#include <jemalloc/jemalloc.h>
+#elif defined(XCSG_MIMALLOC)
+#include <mimalloc.h>
+#elif defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+#include <malloc.h>
+#define XCSG_GLIBC_MALLINFO2
+#endif
+
+#if defined(XCSG_JEMALLOC)
+// read a jemalloc statistic, 0 when it is not present in this jemalloc build
+template <typename T>
+static T je_stat(const std::string& name)
+{
+   T value = 0;
+   size_t size = sizeof(value);
+   if(mallctl(name.c_str(),&value,&size,nullptr,0) != 0) return 0;
+   return value;
+}
+
+// the statistics are cached by jemalloc, advancing the epoch refreshes them
+static void je_refresh()
+{
+   uint64_t epoch = 1;
+   size_t size = sizeof(epoch);
+   mallctl("epoch",&epoch,&size,&epoch,size);
+}
+#endif
+
+const char* allocator_stats::name()
+{
+#if defined(XCSG_JEMALLOC)
+   return "jemalloc";
+#elif defined(XCSG_MIMALLOC)
+   return "mimalloc";
+#elif defined(__GLIBC__)
+   return "glibc";
+#else
+   return "default";
+#endif
+}
+
+bool allocator_stats::available()
+{
+#if defined(XCSG_JEMALLOC) || defined(XCSG_MIMALLOC) || defined(XCSG_GLIBC_MALLINFO2)
+   return true;
+#else
+   return false;
+#endif
+}
+
+allocator_stats::snapshot allocator_stats::current()
+{
+   snapshot stats = { 0, 0, 0 };
+
+#if defined(XCSG_JEMALLOC)
+   je_refresh();
+   stats.in_use   = je_stat<size_t>("stats.allocated");
+   stats.resident = je_stat<size_t>("stats.resident");
+
+   // lock waits summed over all arenas, for the small size bins and the arena mutexes
+   const std::string arenas = "stats.arenas." + std::to_string(MALLCTL_ARENAS_ALL);
+   unsigned nbins = je_stat<unsigned>("arenas.nbins");
+   for(unsigned ibin=0; ibin<nbins; ibin++) {
+      stats.lock_waits += je_stat<uint64_t>(arenas + ".bins." + std::to_string(ibin) + ".mutex.num_wait");
+   }
+   for(const char* mutex : { "large", "extent_avail", "extents_dirty", "extents_muzzy", "extents_retained", "decay_dirty", "decay_muzzy", "base", "tcache_list" }) {
+      stats.lock_waits += je_stat<uint64_t>(arenas + ".mutexes." + mutex + ".num_wait");
+   }
+#elif defined(XCSG_MIMALLOC)
+   // mimalloc allocates from thread local heaps without locks, so there are no waits to report
+   size_t elapsed_msecs=0, user_msecs=0, system_msecs=0, current_rss=0, peak_rss=0, current_commit=0, peak_commit=0, page_faults=0;
+   mi_process_info(&elapsed_msecs,&user_msecs,&system_msecs,&current_rss,&peak_rss,&current_commit,&peak_commit,&page_faults);
+   stats.in_use   = current_commit;
+   stats.resident = current_rss;
+#elif defined(XCSG_GLIBC_MALLINFO2)
+   struct mallinfo2 info = mallinfo2();
+   stats.in_use   = info.uordblks + info.hblkhd;
+   stats.resident = info.arena + info.hblkhd;
+#endif
+
+   return stats;
+}
+
+size_t allocator_stats::in_use()
+{
+#if defined(XCSG_JEMALLOC)
+   je_refresh();
+   return je_stat<size_t>("stats.allocated");
+#elif defined(XCSG_MIMALLOC) || defined(XCSG_GLIBC_MALLINFO2)
+   return current().in_use;
+#else
+   return 0;
+#endif
+}
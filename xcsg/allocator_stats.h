@@ -0,0 +1,47 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef ALLOCATOR_STATS_H
+#define ALLOCATOR_STATS_H
+
+#include <cstddef>
+
+// allocator_stats reads the statistics of the memory allocator xcsg is linked with.
+// A scalable allocator is selected at build time, "premake5 --allocator=jemalloc" or
+// "--allocator=mimalloc" defines XCSG_JEMALLOC or XCSG_MIMALLOC and links the library.
+// Without either, the statistics of glibc malloc are read where available.
+
+class allocator_stats {
+public:
+   struct snapshot {
+      size_t in_use;       // bytes allocated by the program
+      size_t resident;     // bytes of physical memory held by the allocator
+      size_t lock_waits;   // number of times a thread waited for an allocator lock, 0 if unknown
+   };
+
+   // name of the allocator, e.g. "jemalloc"
+   static const char* name();
+
+   // true if current() returns statistics
+   static bool available();
+
+   // current statistics, all zero when not available
+   static snapshot current();
+
+   // current bytes in use only, cheaper than current() when sampled often
+   static size_t in_use();
+};
+
+#endif // ALLOCATOR_STATS_H
@@ -14,14 +14,18 @@
 // EndLicense:
 
 #include "amf_file.h"
-#include "csg_parser/cf_xmlTree.h"
-#include <carve/poly.hpp>
+#include "char_buffer.h"
+#include "zip_file.h"
 #include <ctime>
+#include <algorithm>
+#include <stdexcept>
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
 
 amf_file::amf_file()
+: m_file(0)
+, m_zip(0)
 {
    //ctor
 }
@@ -31,14 +35,26 @@ amf_file::~amf_file()
    //dtor
 }
 
-std::string amf_file::write(std::shared_ptr<poly_vector> polyset, const std::string& file_path)
+void amf_file::flush(char_buffer& out, bool force)
+{
+   if(!force && out.size() < char_buffer::flush_size) return;
+   if(m_zip) {
+      m_zip->write(out.data(),out.size());
+      out.clear();
+   }
+   else if(!out.flush(m_file)) {
+      throw std::runtime_error("Could not write AMF file");
+   }
+}
+
+std::string amf_file::write(std::shared_ptr<mesh_vector> meshes, const std::string& file_path, bool zip)
 {
    // ISO8601 date and time string of current time
    time_t now = time(0);
    const size_t blen = 80;
    char buffer[blen];
    strftime(buffer,blen,"%Y-%m-%dT%H:%M:%S",gmtime(&now));
-   string iso8601(buffer);
+   std::string iso8601(buffer);
 
    boost::filesystem::path fullpath(file_path);
    boost::filesystem::path amf_path = fullpath.parent_path() / fullpath.stem();
@@ -47,66 +63,89 @@ std::string amf_file::write(std::shared_ptr<poly_vector> polyset, const std::str
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
-   cf_xmlTree tree;
-   if(tree.create_root("amf")) {
-      cf_xmlNode root;
-      if(tree.get_root(root)) {
-         root.add_property("unit","millimeter");
+   // the xml is written directly rather than via cf_xmlTree, as the tree
+   // for a large mesh takes much more memory and time than the file itself
+   FILE* file = std::fopen(path.c_str(),(zip)? "wb" : "w");
+   if(!file) throw std::runtime_error("Could not open file: " + path);
+
+   std::unique_ptr<zip_file> zip_out;
+   bool ok = true;
+   try {
+      // the zip archive holds one entry named as the file
+      if(zip) {
+         zip_out.reset(new zip_file(file));
+         zip_out->begin_entry(fullpath.stem().string() + ".amf");
+      }
+      m_file = file;
+      m_zip  = zip_out.get();
+
+      char_buffer out(char_buffer::flush_size);
+      out.append("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+      out.append("<amf unit=\"millimeter\">\n");
 
-         // add some metadata
-         cf_xmlNode name      = root.add_child("metadata"); name.add_property("type","name");         name.put_value(fullpath.stem().string());
-         cf_xmlNode date_time = root.add_child("metadata"); date_time.add_property("type","created"); date_time.put_value(iso8601);
-         cf_xmlNode software  = root.add_child("metadata"); software.add_property("type","software"); software.put_value("xcsg");
+      // add some metadata
+      out.append("\t<metadata type=\"name\">").append_xml(fullpath.stem().string()).append("</metadata>\n");
+      out.append("\t<metadata type=\"created\">").append(iso8601).append("</metadata>\n");
+      out.append("\t<metadata type=\"software\">xcsg</metadata>\n");
 
-         // write one amf "object" per polyhedron
-         for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
-            to_amf_object(root,polyset,ipoly);
-         }
+      // write one amf "object" per mesh
+      for(size_t imesh=0; imesh<meshes->size(); imesh++) {
+         write_amf_object(out,*(*meshes)[imesh],imesh);
+      }
+      out.append("</amf>\n");
+      flush(out,true);
 
-         tree.write_xml(path);
+      if(zip_out) {
+         zip_out->end_entry();
+         zip_out->close();
       }
    }
+   catch(std::exception&) {
+      ok = false;
+   }
+   zip_out.reset();
+   m_file = 0;
+   m_zip  = 0;
+   ok = (std::fclose(file) == 0) && ok;
+   if(!ok) throw std::runtime_error("Could not write file: " + path);
 
    return path;
 }
 
-
-bool amf_file::to_amf_object(cf_xmlNode& parent, std::shared_ptr<poly_vector> polyset, size_t index)
+void amf_file::write_amf_object(char_buffer& out, const triangle_mesh& mesh, size_t index)
 {
-   std::shared_ptr<carve::poly::Polyhedron> poly = (*polyset)[index];
-
-   cf_xmlNode object = parent.add_child("object");
-   object.add_property("id",index);
-   cf_xmlNode mesh = object.add_child("mesh");
-
-   cf_xmlNode vertices = mesh.add_child("vertices");
-   for(size_t ivert=0; ivert<poly->vertices.size(); ivert++) {
-      carve::poly::Geometry<3>::vertex_t& vtx = poly->vertices[ivert];
-
-      cf_xmlNode coordinates = vertices.add_child("vertex").add_child("coordinates");
-      coordinates.add_child("x").put_value(vtx.v[0]);
-      coordinates.add_child("y").put_value(vtx.v[1]);
-      coordinates.add_child("z").put_value(vtx.v[2]);
+   out.append("\t<object id=\"").append(index).append("\">\n");
+   out.append("\t\t<mesh>\n");
+
+   out.append("\t\t\t<vertices>\n");
+   for(size_t ivert=0; ivert<mesh.v_size(); ivert++) {
+      const carve::geom3d::Vector& vtx = mesh.v_get(ivert);
+      out.append("\t\t\t\t<vertex>\n\t\t\t\t\t<coordinates>\n");
+      out.append("\t\t\t\t\t\t<x>").append(vtx.v[0]).append("</x>\n");
+      out.append("\t\t\t\t\t\t<y>").append(vtx.v[1]).append("</y>\n");
+      out.append("\t\t\t\t\t\t<z>").append(vtx.v[2]).append("</z>\n");
+      out.append("\t\t\t\t\t</coordinates>\n\t\t\t\t</vertex>\n");
+      flush(out,false);
    }
+   out.append("\t\t\t</vertices>\n");
 
-   cf_xmlNode volume = mesh.add_child("volume");
-
-   const string vtags[] = { "v1", "v2", "v3" } ;
+   out.append("\t\t\t<volume>\n");
 
-   for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-      carve::poly::Face<3>& face = poly->faces[iface];
+   const char* vtags[] = { "v1", "v2", "v3" } ;
 
-      size_t nvert = face.nVertices();
-      if(nvert != 3)throw std::logic_error("amf_file::to_xml, non-triangular face encountered!");
+   for(size_t itri = 0; itri<mesh.t_size(); ++itri) {
+      const uint32_t* tri = mesh.t_get(itri);
 
-      cf_xmlNode triangle = volume.add_child("triangle");
-      std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-      poly->faces[iface].getVertexLoop(vloop);
-      for(size_t ivert=0; ivert<nvert; ivert++) {
-         size_t index = poly->vertexToIndex(vloop[ivert]);
-         triangle.add_child(vtags[ivert]).put_value(index);
+      out.append("\t\t\t\t<triangle>\n");
+      for(size_t ivert=0; ivert<3; ivert++) {
+         size_t index = tri[ivert];
+         out.append("\t\t\t\t\t<").append(vtags[ivert]).append('>').append(index).append("</").append(vtags[ivert]).append(">\n");
       }
+      out.append("\t\t\t\t</triangle>\n");
+      flush(out,false);
    }
 
-   return true;
+   out.append("\t\t\t</volume>\n");
+   out.append("\t\t</mesh>\n");
+   out.append("\t</object>\n");
 }
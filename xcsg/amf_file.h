@@ -16,25 +16,37 @@
 #ifndef AMF_FILE_H
 #define AMF_FILE_H
 
-class cf_xmlNode;
+class char_buffer;
+class zip_file;
+#include <cstdio>
 #include <vector>
 #include <memory>
-#include <carve/csg.hpp>
+#include <string>
 #include <ostream>
+#include "triangle_mesh.h"
 
 class amf_file {
 public:
-   typedef std::vector<std::shared_ptr<carve::poly::Polyhedron>> poly_vector;
+   typedef triangle_mesh_vector mesh_vector;
 
    amf_file();
    virtual ~amf_file();
 
    // export to AMF, return the path to the file created
    // input is full path to file, file extension will be replaced to ".amf"
-   std::string  write(std::shared_ptr<poly_vector> polyset, const std::string& file_path);
+   // With zip, the file is a zip archive holding the AMF document, as allowed by the AMF format
+   std::string  write(std::shared_ptr<mesh_vector> meshes, const std::string& file_path, bool zip = false);
 
 protected:
-   bool to_amf_object(cf_xmlNode& parent, std::shared_ptr<poly_vector> polyset, size_t index);
+   // append one amf object to the buffer, flushing to file as it grows
+   void write_amf_object(char_buffer& out, const triangle_mesh& mesh, size_t index);
+
+   // write the buffer to the file or zip archive, when full or when forced
+   void flush(char_buffer& out, bool force);
+
+private:
+   FILE*     m_file;
+   zip_file* m_zip;
 
 };
 
@@ -0,0 +1,100 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "array_pattern.h"
+#include "csg_parser/cf_xmlNode.h"
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+static const double pi = 4.0*atan(1.0);
+
+array_pattern::array_pattern()
+{}
+
+array_pattern::array_pattern(const cf_xmlNode& node)
+{
+   std::string pattern = node.get_property("pattern","linear");
+   double dx = node.get_property("dx",0.0);
+   double dy = node.get_property("dy",0.0);
+   double dz = node.get_property("dz",0.0);
+
+   if(pattern == "linear") {
+      int n = node.get_property("n",0);
+      if(n < 1) throw std::logic_error(node.tag() + ": linear pattern requires n >= 1");
+      m_placements.reserve(n);
+      for(int i=0; i<n; i++) m_placements.push_back(carve::math::Matrix::TRANS(i*dx,i*dy,i*dz));
+   }
+   else if(pattern == "grid") {
+      int nx = node.get_property("nx",1);
+      int ny = node.get_property("ny",1);
+      int nz = node.get_property("nz",1);
+      if(nx < 1 || ny < 1 || nz < 1) throw std::logic_error(node.tag() + ": grid pattern requires nx, ny and nz >= 1");
+      m_placements.reserve(size_t(nx)*ny*nz);
+      for(int iz=0; iz<nz; iz++) {
+         for(int iy=0; iy<ny; iy++) {
+            for(int ix=0; ix<nx; ix++) m_placements.push_back(carve::math::Matrix::TRANS(ix*dx,iy*dy,iz*dz));
+         }
+      }
+   }
+   else if(pattern == "polar") {
+      int n = node.get_property("n",0);
+      double angle = node.get_property("angle",2*pi);
+      if(n < 1) throw std::logic_error(node.tag() + ": polar pattern requires n >= 1");
+      bool full_turn = (fabs(angle) >= 2*pi*(1.0-1.0E-12));
+      double step = (full_turn || n == 1)? angle/n : angle/(n-1);
+      m_placements.reserve(n);
+      for(int i=0; i<n; i++) m_placements.push_back(carve::math::Matrix::ROT(i*step,carve::geom::VECTOR(0.0,0.0,1.0)));
+   }
+   else {
+      throw std::logic_error(node.tag() + ": unknown pattern '" + pattern + "', expected linear, grid or polar");
+   }
+}
+
+array_pattern::~array_pattern()
+{}
+
+std::vector<carve::math::Matrix> array_pattern::transforms(const carve::math::Matrix& t) const
+{
+   std::vector<carve::math::Matrix> result;
+   result.reserve(m_placements.size());
+   for(auto& placement : m_placements) result.push_back(t*placement);
+   return result;
+}
+
+bool array_pattern::disjoint(const std::vector<xbox3d>& boxes, double tol)
+{
+   // sweep along x, so only boxes overlapping in x are compared
+   std::vector<size_t> order(boxes.size());
+   std::iota(order.begin(),order.end(),0);
+   std::sort(order.begin(),order.end(),[&boxes](size_t a, size_t b) { return boxes[a].p1()[0] < boxes[b].p1()[0]; });
+
+   std::vector<size_t> active;
+   for(size_t i : order) {
+      const xbox3d& box = boxes[i];
+      if(!box.initialised()) continue;
+
+      const double xmin = box.p1()[0] - tol;
+      active.erase(std::remove_if(active.begin(),active.end(),[&boxes,xmin](size_t j) { return boxes[j].p2()[0] < xmin; }),active.end());
+      for(size_t j : active) {
+         if(boxes[j].intersects(box,tol)) return false;
+      }
+      active.push_back(i);
+   }
+   return true;
+}
@@ -0,0 +1,55 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef ARRAY_PATTERN_H
+#define ARRAY_PATTERN_H
+
+#include <vector>
+#include <carve/matrix.hpp>
+#include "xbox3d.h"
+class cf_xmlNode;
+
+// array_pattern holds the placements of the copies in an array3d or array2d node,
+// given by the "pattern" attribute:
+//
+//    linear   n copies, each offset by dx,dy,dz from the previous one
+//    grid     nx*ny*nz copies spaced dx,dy,dz along the axes
+//    polar    n copies rotated about the z axis, spread evenly over angle radians.
+//             A full turn (the default) does not repeat the first copy at the end
+
+class array_pattern {
+public:
+   array_pattern();
+   array_pattern(const cf_xmlNode& node);
+   virtual ~array_pattern();
+
+   // number of copies
+   size_t size() const { return m_placements.size(); }
+
+   // placement of each copy, applied before the child's own transform
+   const std::vector<carve::math::Matrix>& placements() const { return m_placements; }
+
+   // placements combined with t, t*placement for each copy
+   std::vector<carve::math::Matrix> transforms(const carve::math::Matrix& t) const;
+
+   // true if no two boxes intersect within tol. Touching boxes count as intersecting
+   static bool disjoint(const std::vector<xbox3d>& boxes, double tol);
+
+private:
+   std::vector<carve::math::Matrix> m_placements;
+};
+
+#endif // ARRAY_PATTERN_H
@@ -0,0 +1,44 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "boolean_engine.h"
+#include "snap_engine.h"
+#include "sdf_engine.h"
+#include <stdexcept>
+
+boolean_engine::~boolean_engine()
+{}
+
+std::vector<std::string> boolean_engine::names()
+{
+   return { "carve", "snap", "sdf" };
+}
+
+std::shared_ptr<boolean_engine> boolean_engine::create(const std::string& name)
+{
+   if(name == "carve") return std::make_shared<carve_engine>();
+   if(name == "snap")  return std::make_shared<snap_engine>();
+   if(name == "sdf")   return std::make_shared<sdf_engine>();
+
+   std::string msg = "Unknown boolean engine: " + name + ", use one of:";
+   for(auto& n : names()) msg += " " + n;
+   throw std::runtime_error(msg);
+}
+
+boolean_engine::MeshSet_ptr carve_engine::compute(const MeshSet_ptr& a, const MeshSet_ptr& b, carve::csg::CSG::OP op) const
+{
+   carve::csg::CSG csg;
+   return MeshSet_ptr(csg.compute(a.get(),b.get(),op));
+}
@@ -0,0 +1,62 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef BOOLEAN_ENGINE_H
+#define BOOLEAN_ENGINE_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <carve/csg.hpp>
+
+// boolean_engine computes one 3d boolean between two meshes, it is the backend of carve_boolean.
+// The engine is selected per run with --engine, see carve_boolean::set_engine. Engines hold
+// no state between booleans, so one engine object is shared by all worker threads.
+//
+//    carve   carve's floating point CSG, may throw carve::exception on near-coincident geometry
+//    snap    vertices of both operands are rounded to a common grid before carve runs, and
+//            the boolean is retried on a coarser grid if carve still fails
+//    sdf     approximate booleans on a voxel grid for previews, see --voxel
+
+class boolean_engine {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   virtual ~boolean_engine();
+
+   // name used with --engine
+   virtual std::string name() const = 0;
+
+   // name and settings that change the results, for keys of cached results
+   virtual std::string cache_key() const { return name(); }
+
+   // compute a op b, the operands are not modified
+   virtual MeshSet_ptr compute(const MeshSet_ptr& a, const MeshSet_ptr& b, carve::csg::CSG::OP op) const = 0;
+
+   // names of all engines
+   static std::vector<std::string> names();
+
+   // create engine by name, throws on unknown names
+   static std::shared_ptr<boolean_engine> create(const std::string& name);
+};
+
+// carve_engine runs carve's CSG as it is
+class carve_engine : public boolean_engine {
+public:
+   std::string name() const override { return "carve"; }
+   MeshSet_ptr compute(const MeshSet_ptr& a, const MeshSet_ptr& b, carve::csg::CSG::OP op) const override;
+};
+
+#endif // BOOLEAN_ENGINE_H
@@ -14,10 +14,28 @@
 // EndLicense:
 
 #include "boolean_timer.h"
+#include "thread_pool.h"
+#include "compile_context.h"
+#include "message_log.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
 #include <iomanip>
 
+boolean_timer& boolean_timer::singleton()
+{
+   compile_context* ctx = compile_context::current();
+   if(ctx) return ctx->timer();
+   static boolean_timer instance;
+   return instance;
+}
+
 boolean_timer::boolean_timer()
+: m_cost_done(0.0)
+, m_cost_elapsed(0.0)
+, m_ncost(0)
+, m_cost_planned(0.0)
+, m_nbool_planned(0)
 {}
 
 boolean_timer::~boolean_timer()
@@ -29,6 +47,17 @@ void boolean_timer::init(int nbool)
    m_nbool_tot = (nbool>0)? nbool : 1;
    m_progress = 0;
    m_progress_report = 0;
+   m_disjoint_hits = 0;
+   m_disjoint_misses = 0;
+   m_retries_recovered = 0;
+   m_retries_failed = 0;
+
+   std::lock_guard<std::mutex> lock(m_cost_mutex);
+   m_cost_done     = 0.0;
+   m_cost_elapsed  = 0.0;
+   m_ncost         = 0;
+   m_cost_planned  = 0.0;
+   m_nbool_planned = 0;
 }
 
 void boolean_timer::add_nbool(int nbool)
@@ -36,23 +65,100 @@ void boolean_timer::add_nbool(int nbool)
    m_nbool_tot += nbool;
 }
 
-void boolean_timer::add_elapsed(double esec)
+double boolean_timer::boolean_cost(size_t na, size_t nb)
+{
+   // carve and clipper both sort and intersect the elements of the inputs
+   double n = static_cast<double>(na + nb);
+   return n*(1.0 + std::log2(n + 1.0));
+}
+
+void boolean_timer::add_planned(int nbool, double cost)
+{
+   if(nbool <= 0) return;
+   std::lock_guard<std::mutex> lock(m_cost_mutex);
+   m_nbool_planned += nbool;
+   m_cost_planned  += cost;
+}
+
+void boolean_timer::add_elapsed(double esec, double cost)
 {
    int millisec        = static_cast<int>(1000*esec);
    m_elapsed_millisec += millisec;
+
+   std::lock_guard<std::mutex> lock(m_cost_mutex);
    m_nbool++;
-   m_progress = static_cast<unsigned int>((1000.0*m_nbool)/m_nbool_tot);
+   if(cost > 0.0) {
+      m_cost_done    += cost;
+      m_cost_elapsed += esec;
+      m_ncost++;
+   }
+   if(m_nbool_planned > 0) {
+      m_nbool_planned--;
+      m_cost_planned = std::max(0.0,m_cost_planned - cost);
+   }
+
+   // progress by cost when the cost model has data, otherwise by count
+   double fraction = static_cast<double>(m_nbool)/m_nbool_tot;
+   if(m_ncost > 0) {
+      fraction = m_cost_done/(m_cost_done + remaining_cost());
+   }
+   m_progress = static_cast<unsigned int>(1000.0*std::min(1.0,fraction));
 
    // report progress at every 5% progress
-   if( (m_progress - m_progress_report) >= 50) {
-      unsigned int p = m_progress;
-      m_progress_report = p;
+   if(m_progress >= m_progress_report + 50) {
+      m_progress_report = static_cast<unsigned int>(m_progress);
 
       double percent = m_progress*0.1;
-      std::cout << std::setprecision(3) << "...boolean progress: " << percent <<"% " << std::endl;
+      message_log::line msg = message_log::progress();
+      msg << std::setprecision(3) << "...boolean progress: " << percent <<"% ";
+      double spc = seconds_per_cost();
+      if(spc > 0.0) {
+         double nthreads = static_cast<double>(std::max(size_t(1),thread_pool::singleton().nthreads()));
+         msg << "(about " << std::setprecision(3) << remaining_cost()*spc/nthreads << " [sec] remaining)";
+      }
    }
 }
 
+double boolean_timer::remaining_cost() const
+{
+   // booleans without an announced cost are assumed to cost the average so far
+   double mean_cost = (m_ncost > 0)? m_cost_done/m_ncost : 0.0;
+   double nbool_done = static_cast<double>(m_nbool);
+   double unplanned  = static_cast<double>(m_nbool_tot) - nbool_done - m_nbool_planned;
+   return m_cost_planned + std::max(0.0,unplanned)*mean_cost;
+}
+
+double boolean_timer::seconds_per_cost() const
+{
+   return (m_cost_done > 0.0)? m_cost_elapsed/m_cost_done : 0.0;
+}
+
+double boolean_timer::estimate_seconds(double cost) const
+{
+   std::lock_guard<std::mutex> lock(m_cost_mutex);
+   return cost*seconds_per_cost();
+}
+
+double boolean_timer::eta() const
+{
+   std::lock_guard<std::mutex> lock(m_cost_mutex);
+   double spc = seconds_per_cost();
+   if(spc <= 0.0) return -1.0;
+   double nthreads = static_cast<double>(std::max(size_t(1),thread_pool::singleton().nthreads()));
+   return remaining_cost()*spc/nthreads;
+}
+
+void boolean_timer::add_disjoint(bool hit)
+{
+   if(hit) m_disjoint_hits++;
+   else    m_disjoint_misses++;
+}
+
+void boolean_timer::add_retry(bool recovered)
+{
+   if(recovered) m_retries_recovered++;
+   else          m_retries_failed++;
+}
 
 double boolean_timer::thread_elapsed()
 {
@@ -17,10 +17,19 @@
 #define BOOLEAN_TIMER_H
 
 #include <atomic>
+#include <cstddef>
+#include <mutex>
+
+// boolean_timer counts the booleans processed and reports progress.
+// Each boolean may be given an estimated cost from the size of its inputs,
+// see boolean_cost. Actual time measured against the cost calibrates the
+// estimates, so progress and the estimated time remaining reflect that
+// the booleans near the root of the tree are much more expensive than the leaves.
 
 class boolean_timer {
 public:
-   static boolean_timer& singleton()  { static boolean_timer instance; return instance;  }
+   // the timer of the current compile_context, or the process wide timer outside a compilation
+   static boolean_timer& singleton();
 
    // call init before starting booleans, provide estimated number of booleans
    void init(int nbool);
@@ -29,17 +38,48 @@ public:
    // so it is possible to increase the total number of booleans when it is known
    void add_nbool(int nbool);
 
-   // measure time in each boolean and add elapsed seconds by calling add_elapsed
-   void add_elapsed(double esec);
+   // estimated cost of a boolean between inputs with na and nb elements (faces or vertices).
+   // The unit is arbitrary, estimate_seconds converts it to time
+   static double boolean_cost(size_t na, size_t nb);
+
+   // schedulers that know their inputs in advance may announce the total cost
+   // of nbool booleans already counted by init or add_nbool
+   void add_planned(int nbool, double cost);
+
+   // measure time in each boolean and add elapsed seconds by calling add_elapsed.
+   // cost is the boolean_cost of the operation, or 0 when unknown
+   void add_elapsed(double esec, double cost = 0.0);
+
+   // estimated thread seconds for a boolean of the given cost, calibrated from the booleans so far
+   double estimate_seconds(double cost) const;
+
+   // estimated clock seconds remaining, or a negative value when no estimate is available yet
+   double eta() const;
 
    // return total elapsed in threads so far
    double thread_elapsed();
 
+   // count booleans resolved from disjoint bounding boxes (hit) or computed by carve (miss)
+   void add_disjoint(bool hit);
+   unsigned int disjoint_hits() const   { return m_disjoint_hits; }
+   unsigned int disjoint_misses() const { return m_disjoint_misses; }
+
+   // count booleans the engine failed on and that were retried, see carve_boolean::compute_engine
+   void add_retry(bool recovered);
+   unsigned int retries_recovered() const { return m_retries_recovered; }
+   unsigned int retries_failed() const    { return m_retries_failed; }
+
 protected:
+   friend class compile_context;
    boolean_timer();
    virtual ~boolean_timer();
 
 private:
+   // estimated cost of the booleans not yet done, caller must lock m_cost_mutex
+   double remaining_cost() const;
+
+   // seconds per cost unit, caller must lock m_cost_mutex
+   double seconds_per_cost() const;
 
 private:
 
@@ -49,6 +89,18 @@ private:
    std::atomic_uint  m_nbool;               // number of booleans processed so far
    std::atomic_uint  m_progress;            // A value from [0..1000] measuring progress, i.e. per thousand
    std::atomic_uint  m_progress_report;     // progress value for previous report
+   std::atomic_uint  m_disjoint_hits;       // booleans resolved by the disjoint bounding box fast path
+   std::atomic_uint  m_disjoint_misses;     // booleans where the bounding boxes overlapped
+   std::atomic_uint  m_retries_recovered;   // failed booleans computed by a retry
+   std::atomic_uint  m_retries_failed;      // failed booleans where every retry failed too
+
+   // cost model, protected by m_cost_mutex
+   mutable std::mutex m_cost_mutex;
+   double            m_cost_done;           // total cost of the booleans done
+   double            m_cost_elapsed;        // elapsed seconds of the booleans with known cost
+   unsigned int      m_ncost;               // number of booleans done with known cost
+   double            m_cost_planned;        // announced cost not yet done
+   unsigned int      m_nbool_planned;       // number of announced booleans not yet done
 };
 
 #endif // BOOLEAN_TIMER_H
@@ -45,12 +45,19 @@ boost_command_line::boost_command_line(int argc , char **argv)
 , m_version_shown(false)
 , m_max_bool(std::numeric_limits<size_t>::max())
 , m_export_dir(false,"")
+, m_cache_dir(false,"")
 , m_secant_tolerance(0.05)
+, m_preview_tolerance(0.0)
+, m_threads(0)
+, m_service(false)
+, m_batch(false)
 {
    generic.add_options()
         ("help,h",  "Show this help message.")
         ("version,v",  "Show program version (numeric part).")
         ("amf",   "AMF output format (Additive Manufacturing Format)")
+        ("amf_zip", "Write AMF output zip compressed")
+        ("3mf",   "3MF output format (3D Manufacturing Format)")
         ("csg",   "CSG output format (OpenSCAD)")
         ("dxf",   "DXF output format (AutoCAD DXF - 2D only)")
         ("svg",   "SVG output format (Scalar Vector Graphics - 2D only)")
@@ -58,21 +65,77 @@ boost_command_line::boost_command_line(int argc , char **argv)
         ("astl",  "STL output format (STereoLitography) - ASCII")
         ("obj",   "OBJ output format (Wavefront format)")
         ("off",   "OFF output format (Geomview Object File Format)")
+        ("xmesh", "XMESH output format (xcsg binary mesh)")
+        ("weld",  "Merge coincident vertices of all lumps in OBJ and OFF output, OFF as one file")
+        ("compress", po::value<std::string>(), "Write STL, OBJ, OFF and XMESH output compressed: gz")
+        ("float32", "Hold the final triangles with float32 vertices and release the boolean result before export, to reduce the memory peak")
+        ("spatial_order", "Order the vertices and triangles of solids along a Hilbert curve in all triangle output formats")
+        ("decimate", po::value<std::string>(), "Reduce the triangles of solids before export: target number of triangles, or max error as decimal number")
+        ("tolerances", po::value<std::string>(), "Compute the model once per secant tolerance in a comma separated list, sharing the parsed model, output files are numbered name_tol1, name_tol2, ...")
+        ("time_budget", po::value<std::string>(), "Write a coarse result first and refine it toward the model tolerance while time remains, in seconds, e.g. 5s")
+        ("stream_lumps", "Write the lumps of a top-level union3d to the STL file as they complete and release them, for models larger than memory (--stl only)")
         ("export_dir", po::value<std::string>(), "Export output files to directory")
+        ("skip_unchanged", "Do not rewrite output files whose content is unchanged since the last export, see name.xhash")
+        ("save_xcsg", "Save the .xcsg file converted from OpenSCAD .csg input")
+        ("save_xcsgb", "Save the input model as .xcsgb (xcsg binary tree)")
         ("max_bool", po::value<size_t>(),  "Max number of booleans allowed")
+        ("max_faces", po::value<size_t>(), "Max number of faces of the model and of any boolean result, checked before and during the computation")
+        ("max_memory", po::value<size_t>(), "Max memory in MB, estimated before and measured during the computation")
+        ("max_time", po::value<std::string>(), "Max wall time of the computation in seconds, e.g. 600s")
+        ("estimate", po::value<std::string>()->implicit_value(""), "Estimate booleans, boolean cost, faces and memory without computing the model, JSON to file or standard output")
         ("sec_tol", po::value<double>(),  "Secant tolerance when importing OpenSCAD csg (0.05)")
+        ("preview", po::value<double>()->implicit_value(0.02),  "Coarse preview, secant tolerance as fraction of curve radius (0.02)")
+        ("threads", po::value<size_t>(),  "Number of worker threads (default: XCSG_THREADS or hardware concurrency)")
+        ("pin_threads", "Pin worker threads to cores, grouped by NUMA node (Linux only)")
+        ("cache_dir", po::value<std::string>(), "Cache boolean results in directory")
+        ("incremental", "Incremental rebuild, reuse unchanged subtrees from previous run")
+        ("watch", "Keep running and rebuild each time the input file is saved, reusing unchanged subtrees held in memory")
+        ("checkpoint", po::value<std::string>()->implicit_value(""), "Keep completed subtrees of a long build in directory (default: next to input file)")
+        ("resume", "Resume a build from its checkpoint, computing only the outstanding subtrees")
+        ("merge_faces", po::value<double>()->implicit_value(0.01), "Merge coplanar faces of intermediate boolean results, max normal angle in radians (0.01)")
+        ("short_edges", po::value<double>(), "Collapse edges shorter than length in intermediate boolean results")
+        ("snap_vertices", po::value<int>()->implicit_value(32), "Snap vertices of intermediate boolean results to a grid of 2^-bits of the model size and merge duplicates (32)")
+        ("simplify2d", po::value<double>()->implicit_value(0.25), "Remove 2d profile vertices closer than fraction of secant tolerance to their neighbour line (0.25)")
+        ("direct_mesh", "Build the meshes of primitives and extrusions directly, without the input checks of carve (experimental)")
+        ("face_bvh", "Skip booleans whose operands have no intersecting face boxes, lumps are kept or dropped by inside/outside tests")
+        ("engine", po::value<std::string>(), "Boolean engine for solids: carve, snap or sdf (carve)")
+        ("voxel", po::value<double>(), "Grid spacing of the approximate sdf engine (default: 1/256 of the operand size)")
+        ("no_retry", "Fail on the first boolean the engine can not compute, instead of retrying it on snapped and perturbed operands")
+        ("retry_engine", po::value<std::string>(), "Boolean engine tried last for a failing boolean: carve, snap or sdf (none)")
+        ("mem_limit", po::value<size_t>(), "Limit the estimated memory of booleans running at the same time, in MB")
+        ("malloc_tuning", "Keep memory freed by booleans in the process for reuse (glibc only)")
+        ("minkowski2d", po::value<std::string>(), "minkowski2d engine for non-convex shapes: clipper or convex (clipper)")
+        ("projection2d", po::value<std::string>(), "projection2d engine: silhouette or faces (silhouette)")
+        ("extrude_caps", po::value<std::string>(), "Triangulation of extrusion caps: delaunay or monotone (delaunay)")
+        ("profile", po::value<std::string>(), "Write time and mesh sizes of every CSG node to JSON file")
+        ("capture_booleans", po::value<std::string>(), "Write the operands of booleans slower than seconds to name.xcsg_capture for xcsg_replay, e.g. 30s")
+        ("counters", "Add hardware performance counters per phase and thread to the --profile JSON (Linux)")
+        ("timing", po::value<std::string>(), "Write wall time of each phase and result sizes to JSON file")
+        ("trace", po::value<std::string>(), "Write thread timeline to JSON file in Chrome trace format")
+        ("all_objects", "Process all top-level objects concurrently, exported to numbered files")
         ("fullpath", "Show full file paths.")
+        ("quiet", "Show only warnings, errors and results, no progress and info messages")
+        ("log_json", "Write progress and diagnostic messages as JSON lines with time, level and thread")
+        ("jobs", po::value<std::string>(), "Run the jobs in file in one process, one xcsg command line per line")
+        ("serve", po::value<std::string>(), "Serve jobs on Unix domain socket path or host:port, one xcsg command line per connection")
+        ("serve_jobs", "Accept job command lines and quit on a --serve TCP port. Any peer reaching the port can then read and write files")
+        ("batch", "Process several input files, directories or wildcard patterns in one process")
+        ("remote", po::value<std::string>(), "Compute expensive subtrees on xcsg --serve workers, comma separated host:port or socket paths")
+        ("remote_min_bool", po::value<size_t>(), "Minimum number of booleans in a subtree computed by a remote worker (16)")
          ;
 
    hidden.add_options()
-        ("xcsg-file",   po::value<string>(),         "input file") ;
+        ("xcsg-file",   po::value<string>(),         "input file")
+        ("batch-file",  po::value<vector<string>>(), "more input files in batch mode") ;
 
    allowed.add(generic).add(hidden);
 
    // Declare that input-file can be specified without the "--input-file" specifier
    // declare that we require exactly 1 such parameter (-1 would mean unlimited number)
    po::positional_options_description p;
+   // in batch mode the remaining arguments are further input files
    p.add("xcsg-file", 1);
+   p.add("batch-file", -1);
 
    // Parse the command line catching and displaying any
    // parser errors
@@ -101,16 +164,35 @@ boost_command_line::boost_command_line(int argc , char **argv)
       help_count++;
    }
 
+   // in service mode the input files and output formats are given per job
+   m_service = (vm.count("jobs") + vm.count("serve")) > 0;
+   if(vm.count("jobs") > 0 && vm.count("serve") > 0) {
+      error_list.push_back("ERROR: 'jobs' and 'serve' cannot be combined");
+      error_count++;
+   }
+
+   // in batch mode an input may also be a directory or a wildcard pattern,
+   // the file extensions are checked when the inputs are expanded
+   m_batch = vm.count("batch") > 0;
+   if(m_batch && m_service) {
+      error_list.push_back("ERROR: 'batch' cannot be combined with 'jobs' or 'serve'");
+      error_count++;
+   }
+   if(vm.count("batch-file") > 0 && !m_batch) {
+      error_list.push_back("ERROR: More than one input file given, use --batch to process several files");
+      error_count++;
+   }
+
    // Check input file name
    if(vm.count("xcsg-file") == 0){
       // no message here, it is handled below
-      error_count++;
+      if(!m_service) error_count++;
    }
-   else {
+   else if(!m_batch) {
       boost::filesystem::path fullpath(get<std::string>("xcsg-file"));
-      if(fullpath.extension() != ".xcsg" && fullpath.extension() != ".csg") {
+      if(fullpath.extension() != ".xcsg" && fullpath.extension() != ".xcsgb" && fullpath.extension() != ".json" && fullpath.extension() != ".csg") {
          ostringstream sout;
-         sout << "ERROR: Input file extension must be '.xcsg', file name was " << fullpath;
+         sout << "ERROR: Input file extension must be '.xcsg', '.xcsgb', '.json' or '.csg', file name was " << fullpath;
          error_list.push_back(sout.str());
          error_count++;
       }
@@ -128,8 +210,25 @@ boost_command_line::boost_command_line(int argc , char **argv)
       }
    }
 
+   if(vm.count("cache_dir") > 0) {
+      std::string dir = get<std::string>("cache_dir");
+      if(dir.length() > 0) m_cache_dir = std::make_pair(true,dir);
+      else {
+         ostringstream sout;
+         sout << "ERROR: 'cache_dir' specified, but no directory provided";
+         error_list.push_back(sout.str());
+         error_count++;
+      }
+   }
+
+   // a checkpoint directory is a cache of its own, it is removed when the build completes
+   if((vm.count("checkpoint") + vm.count("resume")) > 0 && (vm.count("cache_dir") + vm.count("incremental")) > 0) {
+      error_list.push_back("ERROR: 'checkpoint' and 'resume' cannot be combined with 'cache_dir' or 'incremental'");
+      error_count++;
+   }
+
    // check the output format specifiers
-   size_t out_count = vm.count("amf") + vm.count("csg") + vm.count("stl") + vm.count("astl") + vm.count("obj") + vm.count("off") + vm.count("dxf") + vm.count("svg");
+   size_t out_count = vm.count("amf") + vm.count("3mf") + vm.count("csg") + vm.count("stl") + vm.count("astl") + vm.count("obj") + vm.count("off") + vm.count("xmesh") + vm.count("dxf") + vm.count("svg");
    if(out_count == 0  && vm.count("xcsg-file")>0) {
 
       // input file name specified, but no output format(s)
@@ -153,9 +252,33 @@ boost_command_line::boost_command_line(int argc , char **argv)
       m_secant_tolerance = get<double>("sec_tol");
    }
 
+   if(vm.count("preview") > 0) {
+      m_preview_tolerance = get<double>("preview");
+      if(m_preview_tolerance <= 0.0 || m_preview_tolerance >= 1.0) {
+         ostringstream sout;
+         sout << "ERROR: 'preview' tolerance must be in the range <0,1>, got " << m_preview_tolerance;
+         error_list.push_back(sout.str());
+         error_count++;
+      }
+   }
+
+   if(vm.count("simplify2d") > 0) {
+      double fraction = get<double>("simplify2d");
+      if(fraction <= 0.0 || fraction > 1.0) {
+         ostringstream sout;
+         sout << "ERROR: 'simplify2d' fraction must be in the range <0,1], got " << fraction;
+         error_list.push_back(sout.str());
+         error_count++;
+      }
+   }
+
+   if(vm.count("threads") > 0) {
+      m_threads = get<size_t>("threads");
+   }
+
    // some things are counted as errors without error message
    // this causes m_parse_ok to be false and the program stops
-   if(out_count == 0)  error_count++;
+   if(out_count == 0 && !m_service)  error_count++;
    if(help_count==0 && error_count>0) {
 
       // the user did not ask for help but still didn't provide good parameters,
@@ -183,7 +306,7 @@ void boost_command_line::show_version()
 void boost_command_line::show_help()
 {
    if(!m_help_shown) {
-      cout << generic << "  <xcsg-file>\t\tpath to input .xcsg file (required)" << endl << endl;
+      cout << generic << "  <xcsg-file>\t\tpath to input .xcsg, .xcsgb, .json or .csg file (required, several with --batch)" << endl << endl;
       m_help_shown = true;
    }
 }
@@ -193,5 +316,16 @@ size_t boost_command_line::count(const std::string& option)
    return vm.count(option);
 }
 
+std::vector<std::string> boost_command_line::input_files()
+{
+   std::vector<std::string> files;
+   if(vm.count("xcsg-file")) files.push_back(get<std::string>("xcsg-file"));
+   if(vm.count("batch-file")) {
+      std::vector<std::string> batch = get<std::vector<std::string>>("batch-file");
+      files.insert(files.end(),batch.begin(),batch.end());
+   }
+   return files;
+}
+
 boost_command_line::~boost_command_line()
 {}
@@ -19,6 +19,7 @@
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 #include <string>
+#include <vector>
 
 class boost_command_line {
 public:
@@ -40,8 +41,25 @@ public:
 
    double  secant_tolerance() { return m_secant_tolerance; }
 
+   // preview tolerance relative to curve radius, 0 means full quality
+   double  preview_tolerance() const { return m_preview_tolerance; }
+
+   // number of worker threads requested, 0 means hardware concurrency
+   size_t threads() const { return m_threads; }
+
    std::pair<bool,std::string> export_dir() { return m_export_dir; }
 
+   std::pair<bool,std::string> cache_dir() { return m_cache_dir; }
+
+   // true when --jobs or --serve is given, the jobs provide input files and output formats
+   bool service_mode() const { return m_service; }
+
+   // true when --batch is given, see input_files()
+   bool batch_mode() const { return m_batch; }
+
+   // all input arguments in the order given, more than one only in batch mode
+   std::vector<std::string> input_files();
+
 private:
    boost::program_options::options_description generic;
    boost::program_options::options_description hidden;
@@ -52,7 +70,12 @@ private:
    bool  m_version_shown;
    size_t m_max_bool;
    double m_secant_tolerance;
+   double m_preview_tolerance;
+   size_t m_threads;
    std::pair<bool,std::string> m_export_dir;
+   std::pair<bool,std::string> m_cache_dir;
+   bool   m_service;
+   bool   m_batch;
 };
 
 #endif // BOOST_COMMAND_LINE_H
@@ -22,7 +22,29 @@
 #include <carve/input.hpp>
 
 #include "boolean_timer.h"
+#include "memory_budget.h"
+#include "trace_recorder.h"
 #include "mesh_utils.h"
+#include "xbox3d.h"
+#include "thread_pool.h"
+#include "compile_context.h"
+#include "snap_engine.h"
+#include "face_bvh.h"
+#include "message_log.h"
+#include "xmesh_file.h"
+#include <boost/filesystem.hpp>
+#include <algorithm>
+#include <atomic>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <unordered_map>
+
+static const double pi = 4.0*atan(1.0);
 
 std::string carve_boolean::boolean_type(carve::csg::CSG::OP op)
 {
@@ -39,7 +61,445 @@ std::string carve_boolean::boolean_type(carve::csg::CSG::OP op)
    return retval;
 }
 
+carve::csg::CSG::OP carve_boolean::boolean_op(const std::string& type)
+{
+   for(auto op : { carve::csg::CSG::UNION, carve::csg::CSG::INTERSECTION, carve::csg::CSG::A_MINUS_B,
+                   carve::csg::CSG::B_MINUS_A, carve::csg::CSG::SYMMETRIC_DIFFERENCE }) {
+      if(boolean_type(op) == type) return op;
+   }
+   throw std::runtime_error("Unknown boolean operation: " + type);
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::concatenate(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b)
+{
+   return concatenate(std::vector<std::shared_ptr<carve::mesh::MeshSet<3>>>{ a, b });
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::concatenate(const std::vector<std::shared_ptr<carve::mesh::MeshSet<3>>>& meshsets)
+{
+   // copy vertices and faces of all meshes into a common face index list
+   size_t nverts = 0;
+   for(auto& meshset : meshsets) nverts += meshset->vertex_storage.size();
+   std::vector<carve::geom3d::Vector> points;
+   points.reserve(nverts);
+
+   std::vector<int> face_indices;
+   size_t nfaces = 0;
+
+   for(auto& meshset : meshsets) {
+      size_t offset = points.size();
+      for(auto& vertex : meshset->vertex_storage) {
+         points.push_back(vertex.v);
+      }
+
+      const carve::mesh::Face<3>::vertex_t* v0 = &meshset->vertex_storage[0];
+      std::vector<carve::mesh::Face<3>::vertex_t*> verts;
+      for(carve::mesh::Mesh<3>* mesh : meshset->meshes) {
+         for(carve::mesh::Face<3>* face : mesh->faces) {
+            face->getVertices(verts);
+            face_indices.push_back(static_cast<int>(verts.size()));
+            for(auto vertex : verts) {
+               face_indices.push_back(static_cast<int>(offset + (vertex - v0)));
+            }
+            nfaces++;
+         }
+      }
+   }
+
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,nfaces,face_indices);
+}
+
+bool carve_boolean::compute_disjoint(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op, std::shared_ptr<carve::mesh::MeshSet<3>>& result)
+{
+   switch(op) {
+      case carve::csg::CSG::UNION:
+      case carve::csg::CSG::A_MINUS_B:
+      case carve::csg::CSG::INTERSECTION:  { break; }
+      default:                             { return false; }
+   };
+
+   // touching boxes count as overlapping, so adjacent faces still go through carve
+   if(xbox3d(*a).intersects(xbox3d(*b))) return false;
+
+   switch(op) {
+      case carve::csg::CSG::UNION:         { result = concatenate(a,b); break; }
+      case carve::csg::CSG::A_MINUS_B:     { result = a; break; }
+      default:                             { result = std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>()); break; }
+   };
+   return true;
+}
+
+bool carve_boolean::compute_classified(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op, std::shared_ptr<carve::mesh::MeshSet<3>>& result)
+{
+   switch(op) {
+      case carve::csg::CSG::UNION:
+      case carve::csg::CSG::A_MINUS_B:
+      case carve::csg::CSG::INTERSECTION:  { break; }
+      default:                             { return false; }
+   };
+   if(!disjoint_lumps(*a) || !disjoint_lumps(*b)) return false;
+
+   // the tree over b finds the candidate face pairs, and classifies the lumps of a
+   trace_recorder::span span("carve_boolean::compute_classified");
+   xbox3d box_a(*a),box_b(*b);
+   face_bvh bvh_b(*b,box_b);
+   if(bvh_b.intersects(*a)) return false;
+
+   // inside[i] is true when lump i of a is inside b, or lump i-na of b is inside a.
+   // No vertex is on the other surface, since its faces would have intersecting boxes
+   size_t na = a->meshes.size();
+   size_t nb = b->meshes.size();
+   std::vector<char> inside(na+nb,0);
+   std::vector<const carve::geom3d::Vector*> points(na+nb,nullptr);
+   bool classify_b = false;
+   for(size_t i=0; i<na+nb; i++) {
+      const carve::mesh::Mesh<3>* mesh = (i < na)? a->meshes[i] : b->meshes[i-na];
+      const carve::geom3d::Vector& p = mesh->faces[0]->edge->vert->v;
+      if(!((i < na)? box_b : box_a).intersects(xbox3d(p,p))) continue;
+      points[i] = &p;
+      if(i >= na) classify_b = true;
+   }
+   std::unique_ptr<face_bvh> bvh_a;
+   if(classify_b) bvh_a.reset(new face_bvh(*a,box_a));
+
+   thread_pool::task_group group;
+   for(size_t i=0; i<na+nb; i++) {
+      if(!points[i]) continue;
+      const carve::mesh::MeshSet<3>& other = (i < na)? *b : *a;
+      const face_bvh& bvh = (i < na)? bvh_b : *bvh_a;
+      thread_pool::singleton().submit(group,[&inside,&points,&other,&bvh,i]() {
+         inside[i] = inside_point(bvh,other,*points[i])? 1 : 0;
+      });
+   }
+   thread_pool::singleton().wait(group);
+
+   std::vector<size_t> keep_a,keep_b,voids_b;
+   for(size_t ia=0; ia<na; ia++) {
+      bool in_b = inside[ia] != 0;
+      if(in_b == (op == carve::csg::CSG::INTERSECTION)) keep_a.push_back(ia);
+   }
+   for(size_t ib=0; ib<nb; ib++) {
+      bool in_a = inside[na+ib] != 0;
+      switch(op) {
+         case carve::csg::CSG::UNION:        { if(!in_a) keep_b.push_back(ib); break; }
+         case carve::csg::CSG::INTERSECTION: { if(in_a)  keep_b.push_back(ib); break; }
+         default:                            { if(in_a)  voids_b.push_back(ib); break; }
+      };
+   }
+
+   std::vector<std::shared_ptr<carve::mesh::MeshSet<3>>> meshsets;
+   if(keep_a.size() > 0) meshsets.push_back((keep_a.size() == na)? a : copy_meshes(*a,keep_a));
+   if(keep_b.size() > 0) meshsets.push_back((keep_b.size() == nb)? b : copy_meshes(*b,keep_b));
+   if(voids_b.size() > 0) meshsets.push_back(copy_meshes(*b,voids_b,true));
+   if(meshsets.size() == 0)      result = std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
+   else if(meshsets.size() == 1) result = meshsets[0];
+   else                          result = concatenate(meshsets);
+   return true;
+}
+
+bool carve_boolean::inside_point(const face_bvh& bvh, const carve::mesh::MeshSet<3>& meshset, const carve::geom3d::Vector& p)
+{
+   // ray parity in up to 3 directions not aligned with typical model geometry,
+   // the winding number decides when every ray grazes an edge or a vertex
+   static const double directions[3][3] = { { 0.5384, 0.6121, 0.5791 }, { -0.7071, 0.2853, 0.6470 }, { 0.3217, -0.8663, 0.3822 } };
+   for(size_t idir=0; idir<3; idir++) {
+      bool ambiguous = false;
+      size_t count = bvh.crossings(p,carve::geom::VECTOR(directions[idir][0],directions[idir][1],directions[idir][2]),ambiguous);
+      if(!ambiguous) return (count%2) == 1;
+   }
+   return winding_number(meshset,p) > 0.5;
+}
+
+double carve_boolean::winding_number(const carve::mesh::MeshSet<3>& meshset, const carve::geom3d::Vector& p)
+{
+   // sum of the signed solid angles of the faces seen from p (van Oosterom & Strackee),
+   // faces are split into fans of triangles
+   double angle = 0.0;
+   for(auto mesh : meshset.meshes) {
+      for(auto face : mesh->faces) {
+         const carve::mesh::Edge<3>* e0 = face->edge;
+         carve::geom3d::Vector a = e0->vert->v - p;
+         double la = a.length();
+         for(const carve::mesh::Edge<3>* e = e0->next; e->next != e0; e = e->next) {
+            carve::geom3d::Vector b = e->vert->v - p;
+            carve::geom3d::Vector c = e->next->vert->v - p;
+            double lb = b.length();
+            double lc = c.length();
+            double num = carve::geom::dot(a,carve::geom::cross(b,c));
+            double den = la*lb*lc + carve::geom::dot(a,b)*lc + carve::geom::dot(a,c)*lb + carve::geom::dot(b,c)*la;
+            angle += 2.0*std::atan2(num,den);
+         }
+      }
+   }
+   return std::fabs(angle)/(4.0*pi);
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::copy_meshes(const carve::mesh::MeshSet<3>& meshset, const std::vector<size_t>& mesh_indices, bool invert)
+{
+   typedef carve::mesh::MeshSet<3>::vertex_t vertex_t;
+
+   // the vertices used by the meshes, in order of first use
+   std::unordered_map<const vertex_t*,int> index;
+   std::vector<carve::geom3d::Vector> points;
+   std::vector<int> face_indices;
+   size_t nfaces = 0;
+   std::vector<vertex_t*> verts;
+   for(size_t imesh : mesh_indices) {
+      for(auto face : meshset.meshes[imesh]->faces) {
+         face->getVertices(verts);
+         if(invert) std::reverse(verts.begin(),verts.end());
+         face_indices.push_back(static_cast<int>(verts.size()));
+         for(auto vertex : verts) {
+            auto it = index.find(vertex);
+            if(it == index.end()) {
+               it = index.insert(std::make_pair(vertex,static_cast<int>(points.size()))).first;
+               points.push_back(vertex->v);
+            }
+            face_indices.push_back(it->second);
+         }
+         nfaces++;
+      }
+   }
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,nfaces,face_indices);
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::snap_vertices(const carve::mesh::MeshSet<3>& meshset, double spacing)
+{
+   typedef carve::mesh::MeshSet<3>::vertex_t vertex_t;
+
+   // rounded coordinates, vertices with equal coordinates get the same index
+   size_t nverts = meshset.vertex_storage.size();
+   std::vector<carve::geom3d::Vector> rounded(nverts);
+   for(size_t iv=0; iv<nverts; iv++) {
+      for(size_t i=0; i<3; i++) rounded[iv].v[i] = std::round(meshset.vertex_storage[iv].v[i]/spacing)*spacing;
+   }
+   std::vector<int> order(nverts);
+   for(size_t iv=0; iv<nverts; iv++) order[iv] = static_cast<int>(iv);
+   std::sort(order.begin(),order.end(),[&rounded](int a, int b) {
+      const carve::geom3d::Vector& pa = rounded[a];
+      const carve::geom3d::Vector& pb = rounded[b];
+      if(pa.x != pb.x) return pa.x < pb.x;
+      if(pa.y != pb.y) return pa.y < pb.y;
+      if(pa.z != pb.z) return pa.z < pb.z;
+      return a < b;
+   });
+   std::vector<carve::geom3d::Vector> points;
+   std::vector<int> index(nverts);
+   for(size_t ipos=0; ipos<nverts; ipos++) {
+      const carve::geom3d::Vector& p = rounded[order[ipos]];
+      if(points.size() == 0 || !(points.back() == p)) points.push_back(p);
+      index[order[ipos]] = static_cast<int>(points.size()-1);
+   }
+
+   // faces without the repeated vertices of collapsed edges
+   std::vector<int> face_indices;
+   std::vector<int> loop;
+   size_t nfaces = 0;
+   const vertex_t* v0 = (nverts > 0)? &meshset.vertex_storage[0] : nullptr;
+   std::vector<vertex_t*> verts;
+   for(carve::mesh::Mesh<3>* mesh : meshset.meshes) {
+      for(carve::mesh::Face<3>* face : mesh->faces) {
+         face->getVertices(verts);
+         loop.clear();
+         for(auto vertex : verts) {
+            int iv = index[vertex - v0];
+            if(loop.size() == 0 || loop.back() != iv) loop.push_back(iv);
+         }
+         while(loop.size() > 1 && loop.back() == loop.front()) loop.pop_back();
+         if(loop.size() < 3) continue;
+
+         face_indices.push_back(static_cast<int>(loop.size()));
+         face_indices.insert(face_indices.end(),loop.begin(),loop.end());
+         nfaces++;
+      }
+   }
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,nfaces,face_indices);
+}
+
+bool carve_boolean::disjoint_lumps(const carve::mesh::MeshSet<3>& meshset)
+{
+   for(auto mesh : meshset.meshes) {
+      if(mesh->isNegative() || !mesh->isClosed()) return false;
+   }
+   return true;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::compute_chunked(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op)
+{
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   switch(op) {
+      case carve::csg::CSG::UNION:
+      case carve::csg::CSG::A_MINUS_B:
+      case carve::csg::CSG::INTERSECTION:  { break; }
+      default:                             { return MeshSet_ptr(); }
+   };
+   size_t na = a->meshes.size();
+   size_t nb = b->meshes.size();
+   if(na+nb <= 2 || !disjoint_lumps(*a) || !disjoint_lumps(*b)) return MeshSet_ptr();
+
+   // lumps 0..na-1 are from a, na.. from b. Lumps of one operand are disjoint,
+   // so only overlaps between a and b join lumps into a chunk
+   std::vector<xbox3d> boxes;
+   boxes.reserve(na+nb);
+   for(auto meshset : { a, b }) {
+      for(auto mesh : meshset->meshes) {
+         xbox3d box;
+         for(auto face : mesh->faces) {
+            const carve::mesh::Edge<3>* e = face->edge;
+            do { box.enclose(e->vert->v); e = e->next; } while(e != face->edge);
+         }
+         boxes.push_back(box);
+      }
+   }
+
+   std::vector<size_t> parent(na+nb);
+   for(size_t i=0; i<parent.size(); i++) parent[i] = i;
+   std::function<size_t(size_t)> root = [&parent,&root](size_t i) { return (parent[i] == i)? i : (parent[i] = root(parent[i])); };
+   for(size_t ia=0; ia<na; ia++) {
+      for(size_t ib=na; ib<na+nb; ib++) {
+         if(boxes[ia].intersects(boxes[ib])) parent[root(ia)] = root(ib);
+      }
+   }
+
+   // chunks in order of their first lump, so the result does not depend on timing
+   std::vector<std::vector<size_t>> chunk_a,chunk_b;
+   std::vector<size_t> chunk_of(na+nb,std::numeric_limits<size_t>::max());
+   for(size_t i=0; i<na+nb; i++) {
+      size_t r = root(i);
+      if(chunk_of[r] == std::numeric_limits<size_t>::max()) {
+         chunk_of[r] = chunk_a.size();
+         chunk_a.push_back(std::vector<size_t>());
+         chunk_b.push_back(std::vector<size_t>());
+      }
+      if(i < na) chunk_a[chunk_of[r]].push_back(i);
+      else       chunk_b[chunk_of[r]].push_back(i-na);
+   }
+   if(chunk_a.size() < 2) return MeshSet_ptr();
+
+   // a lump overlapping nothing in the other operand is kept or dropped as a whole
+   trace_recorder::span span("carve_boolean::compute_chunked");
+   std::vector<MeshSet_ptr> results(chunk_a.size());
+   thread_pool::task_group group;
+   for(size_t ichunk=0; ichunk<chunk_a.size(); ichunk++) {
+      const std::vector<size_t>& ia = chunk_a[ichunk];
+      const std::vector<size_t>& ib = chunk_b[ichunk];
+      if(ia.size() > 0 && ib.size() > 0) {
+         thread_pool::singleton().submit(group,[&a,&b,&ia,&ib,&results,op,ichunk]() {
+            results[ichunk] = compute_engine(copy_meshes(*a,ia),copy_meshes(*b,ib),op);
+         });
+      }
+      else if(ia.size() > 0 && op != carve::csg::CSG::INTERSECTION) {
+         results[ichunk] = copy_meshes(*a,ia);
+      }
+      else if(ib.size() > 0 && op == carve::csg::CSG::UNION) {
+         results[ichunk] = copy_meshes(*b,ib);
+      }
+   }
+   thread_pool::singleton().wait(group);
+
+   std::vector<MeshSet_ptr> meshes;
+   for(auto& result : results) {
+      if(result && result->meshes.size() > 0) meshes.push_back(result);
+   }
+   if(meshes.size() == 0) return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
+   if(meshes.size() == 1) return meshes[0];
+   return concatenate(meshes);
+}
+
+double carve_boolean::m_simplify_angle  = 0.0;
+double carve_boolean::m_simplify_length = 0.0;
+int    carve_boolean::m_snap_bits       = 0;
+bool   carve_boolean::m_face_bvh_check  = false;
+std::shared_ptr<boolean_engine> carve_boolean::m_engine = std::make_shared<carve_engine>();
+bool   carve_boolean::m_retry           = true;
+std::shared_ptr<boolean_engine> carve_boolean::m_retry_engine;
+std::string carve_boolean::m_capture_dir;
+double carve_boolean::m_capture_sec = 0.0;
+
+void carve_boolean::capture(const std::shared_ptr<carve::mesh::MeshSet<3>>& a, const std::shared_ptr<carve::mesh::MeshSet<3>>& b, carve::csg::CSG::OP op, double elapsed_sec)
+{
+   // the captures of a run are numbered in the order they complete
+   static std::atomic<size_t> counter(0);
+   std::ostringstream name;
+   name << "boolean_" << std::setw(4) << std::setfill('0') << ++counter;
+
+   try {
+      boost::filesystem::create_directories(m_capture_dir);
+      boost::filesystem::path dir(m_capture_dir);
+      xmesh_file::write_file(*a,(dir / (name.str() + "_a.xmesh")).string());
+      xmesh_file::write_file(*b,(dir / (name.str() + "_b.xmesh")).string());
+
+      std::ofstream out((dir / (name.str() + ".txt")).string());
+      out << "operation " << boolean_type(op) << std::endl;
+      out << "operand_a " << name.str() << "_a.xmesh" << std::endl;
+      out << "operand_b " << name.str() << "_b.xmesh" << std::endl;
+      out << "faces_a "   << face_count(a) << std::endl;
+      out << "faces_b "   << face_count(b) << std::endl;
+      out << "engine "    << m_engine->name() << std::endl;
+      out << "seconds "   << elapsed_sec << std::endl;
+      if(!out) throw std::runtime_error("failed to write " + name.str() + ".txt");
+      message_log::warning() << "slow boolean of " << elapsed_sec << " [sec] captured as " << name.str() << " in " << m_capture_dir;
+   }
+   catch(std::exception& ex) {
+      // a failed capture must not fail the model
+      message_log::warning() << "boolean capture failed: " << ex.what();
+   }
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::compute_engine(const std::shared_ptr<carve::mesh::MeshSet<3>>& a, const std::shared_ptr<carve::mesh::MeshSet<3>>& b, carve::csg::CSG::OP op)
+{
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   std::string error;
+   std::exception_ptr engine_error;
+   try {
+      return m_engine->compute(a,b,op);
+   }
+   catch(carve::exception& ex) {
+      if(!m_retry) throw;
+      error = ex.str();
+      engine_error = std::current_exception();
+   }
+
+   // the first retry removing the degeneracy wins, the stages are tried in a fixed order so the result is reproducible
+   trace_recorder::span span("carve_boolean::compute_engine retry");
+   std::vector<std::pair<std::string,std::function<MeshSet_ptr()>>> stages;
+   if(m_engine->name() != "snap") {
+      stages.push_back({ "snapped operands", [&a,&b,op]() { return snap_engine().compute(a,b,op); } });
+   }
+   stages.push_back({ "perturbed operand", [&a,&b,op]() {
+      // a direction not aligned with typical model geometry, so no face plane of b stays where it was
+      double spacing = snap_engine::grid_spacing(*a,*b,perturb_bits);
+      carve::geom3d::Vector offset = carve::geom::VECTOR(0.5384*spacing,0.6121*spacing,0.5791*spacing);
+      MeshSet_ptr moved(b->clone());
+      for(auto& vertex : moved->vertex_storage) vertex.v += offset;
+      for(auto mesh : moved->meshes) {
+         for(auto face : mesh->faces) face->recalc();
+      }
+      carve::csg::CSG csg;
+      return MeshSet_ptr(csg.compute(a.get(),moved.get(),op));
+   } });
+   if(m_retry_engine) {
+      stages.push_back({ m_retry_engine->name() + " engine", [&a,&b,op]() { return m_retry_engine->compute(a,b,op); } });
+   }
+
+   for(auto& stage : stages) {
+      try {
+         MeshSet_ptr result = stage.second();
+         boolean_timer::singleton().add_retry(true);
+         message_log::warning() << ">>> Warning: " << boolean_type(op) << " boolean of " << face_count(a) << " and " << face_count(b)
+                                << " faces failed (" << error << "), recomputed with " << stage.first;
+         return result;
+      }
+      catch(carve::exception&) {}
+   }
+   boolean_timer::singleton().add_retry(false);
+   std::rethrow_exception(engine_error);
+}
+
 carve_boolean::carve_boolean()
+: m_computed(false)
 {}
 
 carve_boolean::~carve_boolean()
@@ -50,25 +510,115 @@ carve_boolean::~carve_boolean()
 void carve_boolean::clear()
 {
    m_meshset = 0;
+   m_computed = false;
+}
+
+size_t carve_boolean::face_count(const std::shared_ptr<carve::mesh::MeshSet<3>>& mesh)
+{
+   size_t nfaces = 0;
+   for(auto m : mesh->meshes) nfaces += m->faces.size();
+   return nfaces;
+}
+
+size_t carve_boolean::compact_vertices(carve::mesh::MeshSet<3>& meshset)
+{
+   typedef carve::mesh::Vertex<3> vertex_t;
+
+   const size_t nverts = meshset.vertex_storage.size();
+   if(nverts == 0) return 0;
+   vertex_t* v0 = &meshset.vertex_storage[0];
+
+   // new index of each referenced vertex, in storage order
+   const size_t unused = std::numeric_limits<size_t>::max();
+   std::vector<size_t> index(nverts,unused);
+   for(auto mesh : meshset.meshes) {
+      for(auto face : mesh->faces) {
+         carve::mesh::Edge<3>* e = face->edge;
+         do {
+            index[e->vert - v0] = 0;
+            e = e->next;
+         } while(e != face->edge);
+      }
+   }
+   size_t nused = 0;
+   for(size_t iv=0; iv<nverts; iv++) {
+      if(index[iv] != unused) index[iv] = nused++;
+   }
+   if(nused == nverts) return 0;
+
+   std::vector<vertex_t> storage;
+   storage.reserve(nused);
+   for(size_t iv=0; iv<nverts; iv++) {
+      if(index[iv] != unused) storage.push_back(meshset.vertex_storage[iv]);
+   }
+   for(auto mesh : meshset.meshes) {
+      for(auto face : mesh->faces) {
+         carve::mesh::Edge<3>* e = face->edge;
+         do {
+            e->vert = &storage[index[e->vert - v0]];
+            e = e->next;
+         } while(e != face->edge);
+      }
+   }
+   meshset.vertex_storage.swap(storage);
+   return nverts - nused;
 }
 
 size_t carve_boolean::compute( std::shared_ptr<carve::mesh::MeshSet<3>> b,  carve::csg::CSG::OP op)
 {
    try {
       if(!m_meshset.get()) {
-         m_meshset = b;
+         m_meshset = std::move(b);
+         m_computed = false;
       }
       else {
          // the time runs only when an actual boolean is taking place
+         trace_recorder::span span("carve_boolean::compute");
          boost::posix_time::ptime p1 = boost::posix_time::microsec_clock::universal_time();
 
-         carve::csg::CSG  csg;
-         m_meshset = std::shared_ptr<carve::mesh::MeshSet<3>>(csg.compute(m_meshset.get(),b.get(),op));
+         // disjoint booleans are not representative for the cost model and get no cost
+         double cost = 0.0;
+         std::shared_ptr<carve::mesh::MeshSet<3>> result;
+         bool disjoint = compute_disjoint(m_meshset,b,op,result) || (m_face_bvh_check && compute_classified(m_meshset,b,op,result));
+         if(disjoint) {
+            m_meshset = result;
+            m_computed = false;
+         }
+         else {
+            size_t na = face_count(m_meshset);
+            size_t nb = face_count(b);
+            cost = boolean_timer::boolean_cost(na,nb);
+
+            // with a memory limit the boolean may wait here for others to complete, the wait is not timed
+            memory_budget::reservation budget(memory_budget::boolean_bytes(na,nb));
+            p1 = boost::posix_time::microsec_clock::universal_time();
+            // the first operand is kept for a capture of a slow boolean
+            std::shared_ptr<carve::mesh::MeshSet<3>> a = (m_capture_dir.length() > 0)? m_meshset : nullptr;
+            // operands made of several lumps are split in chunks computed in parallel
+            std::shared_ptr<carve::mesh::MeshSet<3>> chunked = compute_chunked(m_meshset,b,op);
+            m_meshset = (chunked)? chunked : compute_engine(m_meshset,b,op);
+            m_computed = true;
+
+            if(a) {
+               double sec = 1.0E-6*(boost::posix_time::microsec_clock::universal_time() - p1).total_microseconds();
+               if(sec >= m_capture_sec) capture(a,b,op,sec);
+            }
+         }
 
          boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - p1;
          double elapsed_sec = 0.001*ptime_diff.total_milliseconds();
 
-         boolean_timer::singleton().add_elapsed(elapsed_sec);
+         boolean_timer::singleton().add_disjoint(disjoint);
+         boolean_timer::singleton().add_elapsed(elapsed_sec,cost);
+
+         // a runaway model is stopped at the first result above the face limit
+         compile_context* ctx = compile_context::current();
+         if(ctx && ctx->max_faces() > 0) {
+            size_t nfaces = face_count(m_meshset);
+            if(nfaces > ctx->max_faces()) {
+               throw std::logic_error("Boolean result of " + std::to_string(nfaces) + " faces exceeds the limit of " + std::to_string(ctx->max_faces()) + " faces");
+            }
+         }
       }
    }
    catch (std::exception& ex)
@@ -92,47 +642,47 @@ std::shared_ptr<xpolyhedron> carve_boolean::create_manifold(size_t manifold_id)
 
    if(manifold_id<m_meshset->meshes.size()) {
 
+      typedef carve::mesh::Face<3>::vertex_t vertex_t;
+
       carve::mesh::Mesh<3>* mesh = m_meshset->meshes[manifold_id];
       size_t nfaces = mesh->faces.size();
 
-      // find the vertices referenced by the selected manifold
-      std::map<carve::mesh::Face<3>::vertex_t*,size_t> vi_map;
-      std::map<size_t,carve::mesh::Face<3>::vertex_t*> iv_map;
+      // collect the face vertices of the selected manifold in one flat array,
+      // with the face sizes in a separate array. The scratch buffer is reused for all faces
+      std::vector<vertex_t*> face_verts;
+      std::vector<size_t>    face_sizes;
+      face_sizes.reserve(nfaces);
+      face_verts.reserve(3*nfaces);
+      std::vector<vertex_t*> verts;
       for (size_t iface=0; iface<nfaces; iface++) {
-         carve::mesh::Face<3>* face = mesh->faces[iface];
-         std::vector<carve::mesh::Face<3>::vertex_t*> verts;
-         face->getVertices(verts);
-         for(size_t i=0;i<verts.size();i++) {
-            carve::mesh::Face<3>::vertex_t* vertex = verts[i];
-            if(vi_map.find(vertex) == vi_map.end()) {
-               size_t index = vi_map.size();
-               vi_map.insert(std::make_pair(vertex,index));
-               iv_map.insert(std::make_pair(index,vertex));
-            }
-         }
+         mesh->faces[iface]->getVertices(verts);
+         face_sizes.push_back(verts.size());
+         face_verts.insert(face_verts.end(),verts.begin(),verts.end());
       }
 
+      // the unique vertices referenced by the manifold, sorted by address
+      std::vector<vertex_t*> unique_verts(face_verts);
+      std::sort(unique_verts.begin(),unique_verts.end());
+      unique_verts.erase(std::unique(unique_verts.begin(),unique_verts.end()),unique_verts.end());
+
       // create polyhedron referencing only the relevant vertices
       poly = std::shared_ptr<xpolyhedron>(new xpolyhedron());
-      poly->v_reserve(vi_map.size());
-      poly->f_reserve(nfaces);
-      for(auto i=iv_map.begin(); i!=iv_map.end();i++) {
-        carve::mesh::Face<3>::vertex_t* vtx = i->second;
-        poly->v_add(vtx->v);
+      poly->v_reserve(unique_verts.size());
+      poly->f_reserve(nfaces,face_verts.size()/std::max(nfaces,size_t(1)));
+      for(vertex_t* vtx : unique_verts) {
+         poly->v_add(vtx->v);
       }
 
       // recompute face vertex indices
+      size_t pos = 0;
+      std::vector<size_t> indices;
       for (size_t iface=0; iface<nfaces; iface++) {
-         carve::mesh::Face<3>* face = mesh->faces[iface];
-         std::vector<carve::mesh::Face<3>::vertex_t*> verts;
-         face->getVertices(verts);
-         std::vector<size_t> indices;
-         indices.reserve(verts.size());
-         for(size_t i=0;i<verts.size();i++) {
-            carve::mesh::Face<3>::vertex_t* vertex = verts[i];
-            indices.push_back(vi_map[vertex]);
+         indices.clear();
+         for(size_t i=0; i<face_sizes[iface]; i++, pos++) {
+            auto it = std::lower_bound(unique_verts.begin(),unique_verts.end(),face_verts[pos]);
+            indices.push_back(it - unique_verts.begin());
          }
-         poly->f_add(xface(indices),false);
+         poly->f_add(indices.begin(),indices.end(),false);
       }
    }
    return poly;
@@ -143,18 +693,53 @@ std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::mesh_set()
    return m_meshset;
 }
 
-bool carve_boolean::merge_faces(double min_normal_angle)
+std::shared_ptr<carve::mesh::MeshSet<3>> carve_boolean::release()
 {
- //   carve::mesh::MeshSimplifier simplifier;
- //   simplifier.mergeCoplanarFaces(m_meshset.get(), min_normal_angle);
-    return true;
+   m_computed = false;
+   return std::move(m_meshset);
+}
+
+size_t carve_boolean::merge_faces(double min_normal_angle)
+{
+   if(!m_meshset.get()) return 0;
+   carve::mesh::MeshSimplifier simplifier;
+   return simplifier.mergeCoplanarFaces(m_meshset.get(), min_normal_angle);
 }
 
 size_t  carve_boolean::eliminate_short_edges(double min_length)
 {
-   // carve::mesh::MeshSimplifier simplifier;
-   // return simplifier.eliminateShortEdges(m_meshset.get(),min_length);
-   return 0;
+   if(!m_meshset.get()) return 0;
+   carve::mesh::MeshSimplifier simplifier;
+   return simplifier.eliminateShortEdges(m_meshset.get(),min_length);
+}
+
+size_t carve_boolean::simplify()
+{
+   if(!m_computed) return 0;
+
+   // carve results may keep vertices no face refers to, the next boolean and the bounding boxes would still see them
+   compact_vertices(*m_meshset);
+
+   bool snap   = (m_snap_bits > 0);
+   bool reduce = (m_simplify_angle > 0.0 || m_simplify_length > 0.0);
+   if(!(snap || reduce)) return 0;
+
+   size_t nfaces = face_count(m_meshset);
+   reduce = reduce && (nfaces >= simplify_min_faces);
+   if(!(snap || reduce)) return 0;
+
+   trace_recorder::span span("carve_boolean::simplify");
+
+   // near-coincident vertices from accumulated transforms are welded on the model grid,
+   // or on a grid relative to the mesh itself outside a compilation
+   if(snap) {
+      compile_context* ctx = compile_context::current();
+      double spacing = (ctx && ctx->snap_spacing() > 0.0)? ctx->snap_spacing() : snap_engine::grid_spacing(xbox3d(*m_meshset),m_snap_bits);
+      m_meshset = snap_vertices(*m_meshset,spacing);
+   }
+   if(reduce && m_simplify_length > 0.0) eliminate_short_edges(m_simplify_length);
+   if(reduce && m_simplify_angle  > 0.0) merge_faces(m_simplify_angle);
+   return nfaces - face_count(m_meshset);
 }
 
 size_t carve_boolean::compute(qhull3d& qhull)
@@ -169,18 +754,15 @@ size_t carve_boolean::compute(qhull3d& qhull)
    // vertices
    carve::input::PolyhedronData data;
    data.reserveVertices(static_cast<int>(qhull.nvertices()));
-   for(auto iv=qhull.vertex_begin();iv!=qhull.vertex_end(); iv++) {
-      qhull3d::xyz& v = iv->second;
+   for(auto& v : qhull.vertices()) {
       data.addVertex(carve::geom::VECTOR(v.x,v.y,v.z));
    }
 
-   // faces
+   // faces, all triangles already oriented with normals out
+   const qhull3d::face_vector& faces = qhull.faces();
    data.reserveFaces(static_cast<int>(qhull.nfaces()),3);
-   for(auto iface=qhull.face_begin(); iface!=qhull.face_end(); iface++) {
-
-      // face vertices have already been oriented with normals out
-      qhull3d::face_vertices& fv = iface->second;
-      data.addFace(fv.begin(),fv.end());
+   for(size_t i=0; i<faces.size(); i+=3) {
+      data.addFace(faces.begin()+i,faces.begin()+i+3);
    }
 
    // create the mesh
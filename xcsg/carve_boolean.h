@@ -18,9 +18,12 @@
 
 #include <vector>
 #include <memory>
+#include <string>
 class xpolyhedron;
+class face_bvh;
 #include <carve/csg.hpp>
 #include "qhull/qhull3d.h"
+#include "boolean_engine.h"
 
 class carve_boolean {
 public:
@@ -39,13 +42,111 @@ public:
 
    static std::string boolean_type(carve::csg::CSG::OP op);
 
+   // operation named by boolean_type, throws on unknown names
+   static carve::csg::CSG::OP boolean_op(const std::string& type);
+
+   // concatenate meshes known to be disjoint. The result equals
+   // their union, but is computed without running any boolean
+   static std::shared_ptr<carve::mesh::MeshSet<3>> concatenate(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b);
+   static std::shared_ptr<carve::mesh::MeshSet<3>> concatenate(const std::vector<std::shared_ptr<carve::mesh::MeshSet<3>>>& meshsets);
+
+   // try to compute the boolean without carve when the bounding boxes of a and b are disjoint.
+   // Returns false if the boxes overlap or the operation has no such shortcut
+   static bool compute_disjoint(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op, std::shared_ptr<carve::mesh::MeshSet<3>>& result);
+
+   // try to compute the boolean without carve when no face boxes of a and b intersect, found with a face_bvh.
+   // The surfaces are then disjoint, and each lump is entirely inside or outside the other operand, see
+   // inside_point. Lumps are kept or dropped, and lumps of b inside a become voids of a difference.
+   // Returns false if face boxes intersect or the operands are not disjoint lumps
+   static bool compute_classified(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op, std::shared_ptr<carve::mesh::MeshSet<3>>& result);
+
+   // true if p is inside the closed meshes of meshset, bvh is the face_bvh of meshset. Decided by the parity
+   // of ray crossings, or by the winding number when the rays graze edges. p must not be on the surface
+   static bool inside_point(const face_bvh& bvh, const carve::mesh::MeshSet<3>& meshset, const carve::geom3d::Vector& p);
+
+   // generalised winding number of the closed meshes of meshset around p, 1 inside a lump and 0 outside
+   static double winding_number(const carve::mesh::MeshSet<3>& meshset, const carve::geom3d::Vector& p);
+
+   // copy the selected meshes of a mesh set into a new mesh set, with only the vertices they use.
+   // With invert, the faces are reversed, turning lumps into voids
+   static std::shared_ptr<carve::mesh::MeshSet<3>> copy_meshes(const carve::mesh::MeshSet<3>& meshset, const std::vector<size_t>& mesh_indices, bool invert = false);
+
+   // true if the meshes of the mesh set are closed and none of them is the inside of a void,
+   // the meshes are then disjoint solids that may be processed independently
+   static bool disjoint_lumps(const carve::mesh::MeshSet<3>& meshset);
+
+   // compute a boolean as independent chunks when a and b consist of several lumps. Lumps of a and b
+   // with overlapping boxes form a chunk, the chunks are computed in parallel and concatenated.
+   // Returns nullptr if there is only one chunk, or the operands are not disjoint lumps
+   static std::shared_ptr<carve::mesh::MeshSet<3>> compute_chunked(std::shared_ptr<carve::mesh::MeshSet<3>> a, std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op);
+
+   // total number of faces in all meshes of the mesh set
+   static size_t face_count(const std::shared_ptr<carve::mesh::MeshSet<3>>& mesh);
+
+   // true if the mesh set has no faces. Its vertex storage may still hold unreferenced vertices
+   static bool is_empty(const std::shared_ptr<carve::mesh::MeshSet<3>>& mesh) { return face_count(mesh) == 0; }
+
+   // remove the vertices not referenced by any face from the vertex storage, keeping the order of the
+   // others, and shrink the storage to fit. Returns the number of vertices removed
+   static size_t compact_vertices(carve::mesh::MeshSet<3>& meshset);
+
+   // simplification of boolean results at intermediate CSG nodes, see simplify().
+   // min_normal_angle [rad] for merging coplanar faces and min_edge_length for collapsing
+   // short edges, 0 disables the step. Both are 0 by default
+   static void set_simplify(double min_normal_angle, double min_edge_length) { m_simplify_angle = min_normal_angle; m_simplify_length = min_edge_length; }
+   static double simplify_angle()  { return m_simplify_angle; }
+   static double simplify_length() { return m_simplify_length; }
+
+   // snapping of boolean results at intermediate CSG nodes, see simplify(). The vertices are rounded to
+   // a power of 2 grid of 2^-bits of the model size (compile_context::snap_spacing), 0 disables the step
+   static void set_snap_bits(int bits) { m_snap_bits = bits; }
+   static int snap_bits() { return m_snap_bits; }
+
+   // copy of meshset with the vertex coordinates rounded to multiples of spacing. Vertices that become
+   // equal are merged, and faces left with fewer than 3 distinct vertices are removed
+   static std::shared_ptr<carve::mesh::MeshSet<3>> snap_vertices(const carve::mesh::MeshSet<3>& meshset, double spacing);
+
+   // test the face boxes of overlapping operands with compute_classified before running the engine. Off by default
+   static void set_face_bvh_check(bool enable) { m_face_bvh_check = enable; }
+   static bool face_bvh_check() { return m_face_bvh_check; }
+
+   // backend computing the booleans, a carve_engine by default. The engine is
+   // shared by all threads and must be set before the booleans of a run start
+   static void set_engine(std::shared_ptr<boolean_engine> engine) { m_engine = engine; }
+   static std::shared_ptr<boolean_engine> engine() { return m_engine; }
+
+   // retry of the booleans the engine fails on, see compute_engine. On by default. The retry engine
+   // is tried last when set, e.g. the approximate sdf engine, nullptr by default
+   static void set_retry(bool retry) { m_retry = retry; }
+   static bool retry() { return m_retry; }
+   static void set_retry_engine(std::shared_ptr<boolean_engine> engine) { m_retry_engine = engine; }
+   static std::shared_ptr<boolean_engine> retry_engine() { return m_retry_engine; }
+
+   // capture of slow booleans for xcsg_replay: the operands of each boolean taking at least min_sec are
+   // written to dir as xmesh files, with a text file naming the operation, see capture(). An empty dir
+   // disables capture, the default
+   static void set_capture(const std::string& dir, double min_sec) { m_capture_dir = dir; m_capture_sec = min_sec; }
+   static const std::string& capture_dir() { return m_capture_dir; }
+
+   // bits of the grid relative to the operand size giving the offset of b in a perturbed retry
+   static const int perturb_bits = 24;
+
+   // compute a op b with the engine. When it throws carve::exception, only this pair is retried: with both
+   // operands snapped to a common grid, then with b moved by a tiny fixed offset, then with the retry engine.
+   // Retries are counted by boolean_timer. The error of the engine is thrown if every retry fails
+   static std::shared_ptr<carve::mesh::MeshSet<3>> compute_engine(const std::shared_ptr<carve::mesh::MeshSet<3>>& a, const std::shared_ptr<carve::mesh::MeshSet<3>>& b, carve::csg::CSG::OP op);
+
+   // meshes with fewer faces are not simplified, they are cheap in later booleans
+   static const size_t simplify_min_faces = 256;
+
    carve_boolean();
    virtual ~carve_boolean();
 
    // empty m_meshset
    void clear();
 
-   // compute boolean against current mesh using a MeshSet as "b"
+   // compute boolean against current mesh using a MeshSet as "b". Pass b with std::move when it
+   // is not used afterwards, the operands are then freed as soon as the boolean is complete
    size_t compute(std::shared_ptr<carve::mesh::MeshSet<3>> b, carve::csg::CSG::OP op);
 
    // special 3d hull computation
@@ -54,18 +155,46 @@ public:
    // number of resulting manifolds
    size_t size() const;
 
-   bool merge_faces(double min_normal_angle = 1.0e-2);
+   // merge adjacent faces with normals differing less than min_normal_angle [rad], returns number of faces merged.
+   // The mesh is modified in place
+   size_t merge_faces(double min_normal_angle = 1.0e-2);
 
+   // collapse edges shorter than min_length, returns number of edges removed. The mesh is modified in place
    size_t eliminate_short_edges(double min_length = 1.0e-1);
 
+   // remove unreferenced vertices from a mesh computed by a boolean in this object, then apply the
+   // snapping and simplification set by set_snap_bits and set_simplify.
+   // Meshes taken as they are from an operand are never modified, since they may be shared.
+   // Returns number of faces removed
+   size_t simplify();
+
    // create result manifolds from mesh
    std::shared_ptr<xpolyhedron>  create_manifold(size_t imani) const;
 
    // return the current mesh
    std::shared_ptr<carve::mesh::MeshSet<3>> mesh_set();
 
+   // move the current mesh out and empty this object, so the caller holds the only reference
+   std::shared_ptr<carve::mesh::MeshSet<3>> release();
+
+protected:
+   // write the operands of a boolean that took elapsed_sec to the capture directory as
+   // boolean_<n>_a.xmesh, boolean_<n>_b.xmesh and boolean_<n>.txt. Failures are reported as warnings
+   static void capture(const std::shared_ptr<carve::mesh::MeshSet<3>>& a, const std::shared_ptr<carve::mesh::MeshSet<3>>& b, carve::csg::CSG::OP op, double elapsed_sec);
+
 private:
    std::shared_ptr<carve::mesh::MeshSet<3>> m_meshset;
+   bool                                     m_computed;  // true if m_meshset was created by carve in compute
+
+   static double m_simplify_angle;
+   static double m_simplify_length;
+   static int    m_snap_bits;
+   static bool   m_face_bvh_check;
+   static std::shared_ptr<boolean_engine> m_engine;
+   static bool   m_retry;
+   static std::shared_ptr<boolean_engine> m_retry_engine;
+   static std::string m_capture_dir;
+   static double m_capture_sec;
 };
 
 #endif // CARVE_BOOLEAN_H
@@ -16,54 +16,124 @@
 
 #include "carve_boolean_thread.h"
 #include "carve_boolean.h"
+#include "carve_union_tree.h"
+#include "boolean_timer.h"
+#include "xbox3d.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
 
-carve_boolean_thread::carve_boolean_thread(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op, safe_queue<std::string>& exception_queue)
-: m_op(op)
-, m_mesh_queue(mesh_queue)
-, m_exception_queue(exception_queue)
-{}
+void carve_boolean_thread::reduce(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op)
+{
+   if(op == carve::csg::CSG::UNION && mesh_queue.size() > 2) {
+      // unions are evaluated in spatial order, merging neighbours first
+      carve_union_tree tree(mesh_queue);
+      mesh_queue.enqueue(tree.compute());
+      return;
+   }
 
-carve_boolean_thread::~carve_boolean_thread()
-{}
+   std::vector<MeshSet_ptr> meshes;
+   mesh_queue.dequeue_all(meshes);
 
+   // announce the estimated cost of the reduction, a pairwise reduction
+   // processes roughly all faces once per level of pairing
+   if(meshes.size() > 1) {
+      size_t nfaces = 0;
+      for(auto& mesh : meshes) nfaces += carve_boolean::face_count(mesh);
+      double nlevels = std::ceil(std::log2(static_cast<double>(meshes.size())));
+      boolean_timer::singleton().add_planned(static_cast<int>(meshes.size()-1),nlevels*boolean_timer::boolean_cost(nfaces/2,nfaces-nfaces/2));
+   }
 
-void carve_boolean_thread::run()
-{
-   // pick work from mesh queue as long as there are at least 2 meshes
+   if(op == carve::csg::CSG::INTERSECTION && meshes.size() > 1) {
+      mesh_queue.enqueue(reduce_intersection(meshes));
+      return;
+   }
 
+   // at most two operands are left, unions of more are reduced by the union tree above
+   thread_pool::singleton().throw_if_cancelled();
+   if(meshes.size() == 1) {
+      mesh_queue.enqueue(std::move(meshes[0]));
+      return;
+   }
    try {
-      while(m_mesh_queue.size() > 1) {
-
-         MeshSet_ptr a,b;
-         if(m_mesh_queue.try_dequeue(a)) {
-            if(m_mesh_queue.try_dequeue(b)) {
-
-               size_t nva = a->vertex_storage.size();
-               size_t nvb = b->vertex_storage.size();
-               if(nva>0 && nvb>0) {
-                  carve_boolean csg;
-                  csg.compute(a,m_op);
-                  csg.compute(b,m_op);
-                  m_mesh_queue.enqueue(csg.mesh_set());
-               }
-               else {
-                  throw std::runtime_error("ERROR: empty mesh component in boolean operation " + carve_boolean::boolean_type(m_op));
-               }
-            }
-            else {
-               m_mesh_queue.enqueue(a);
-            }
+      carve_boolean csg;
+      for(auto& mesh : meshes) {
+         if(carve_boolean::is_empty(mesh)) {
+            throw std::runtime_error("ERROR: empty mesh component in boolean operation " + carve_boolean::boolean_type(op));
          }
+         // moved in, so the input is released as soon as the boolean using it is done
+         csg.compute(std::move(mesh),op);
       }
+      csg.simplify();
+      if(meshes.size() > 0) mesh_queue.enqueue(csg.release());
    }
    catch(carve::exception& ex) {
-      std::string msg("(carve error): ");
-      msg += ex.str();
-      m_exception_queue.enqueue(msg);
-   }
-   catch(std::exception& ex) {
-      m_exception_queue.enqueue(ex.what());
+      throw std::runtime_error("(carve error): " + ex.str());
    }
 }
 
+carve_boolean_thread::MeshSet_ptr carve_boolean_thread::reduce_intersection(std::vector<MeshSet_ptr>& meshes)
+{
+   const carve::csg::CSG::OP op = carve::csg::CSG::INTERSECTION;
+
+   std::vector<xbox3d> boxes;
+   std::vector<double> volumes;
+   boxes.reserve(meshes.size());
+   volumes.reserve(meshes.size());
+   for(auto& mesh : meshes) {
+      if(carve_boolean::is_empty(mesh)) {
+         throw std::runtime_error("ERROR: empty mesh component in boolean operation " + carve_boolean::boolean_type(op));
+      }
+      boxes.push_back(xbox3d(*mesh));
+      xvertex extent = boxes.back().p2() - boxes.back().p1();
+      volumes.push_back(extent[0]*extent[1]*extent[2]);
+   }
+
+   // the smallest operand constrains the result the most, ties are kept in input order
+   std::vector<size_t> order(meshes.size());
+   std::iota(order.begin(),order.end(),size_t(0));
+   std::stable_sort(order.begin(),order.end(),[&volumes](size_t a, size_t b) { return volumes[a] < volumes[b]; });
+
+   // skipped booleans are counted for progress reporting, like disjoint ones
+   size_t nleft = meshes.size()-1;
+   auto empty_result = [&nleft]() {
+      for(; nleft>0; nleft--) {
+         boolean_timer::singleton().add_disjoint(true);
+         boolean_timer::singleton().add_elapsed(0.0);
+      }
+      return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
+   };
+
+   // the result lies within the box common to all operands, touching boxes are left to carve
+   xvertex lo = boxes[order[0]].p1();
+   xvertex hi = boxes[order[0]].p2();
+   for(size_t i : order) {
+      for(size_t axis=0; axis<3; axis++) {
+         lo[axis] = std::max(lo[axis],boxes[i].p1()[axis]);
+         hi[axis] = std::min(hi[axis],boxes[i].p2()[axis]);
+         if(lo[axis] > hi[axis]) return empty_result();
+      }
+   }
+
+   try {
+      carve_boolean csg;
+      csg.compute(std::move(meshes[order[0]]),op);
+      xbox3d box = boxes[order[0]];
+      for(size_t k=1; k<order.size(); k++) {
+         size_t i = order[k];
+         if(!box.intersects(boxes[i])) return empty_result();
+
+         csg.compute(std::move(meshes[i]),op);
+         nleft--;
+         if(csg.size() == 0) return empty_result();
+         box = xbox3d(*csg.mesh_set());
+      }
+      csg.simplify();
+      return csg.release();
+   }
+   catch(carve::exception& ex) {
+      throw std::runtime_error("(carve error): " + ex.str());
+   }
+}
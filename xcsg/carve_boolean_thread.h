@@ -18,37 +18,33 @@
 #define CARVE_BOOLEAN_THREAD_H
 
 #include <memory>
-#include <string>
+#include <vector>
 #include <carve/csg.hpp>
 #include "safe_queue.h"
+#include "thread_pool.h"
 
-#include <boost/thread.hpp>
-
-// carve_boolean_thread allows boolean operations to be performed in boost::threads
-// meshes to be processed must be placed in mesh_queue before launching the threads.
+// carve_boolean_thread reduces a queue of meshes to a single mesh with one boolean operation,
+// using thread_pool tasks. Unions of many meshes follow the fixed merge tree of carve_union_tree
+// and intersections a fixed order, so the result does not depend on the timing of the tasks.
 
 class carve_boolean_thread {
 public:
 
-   // default hard coded until we have something more sophisticated
-   static size_t default_nthreads() { return 12; }
+   // maximum number of boolean tasks running in parallel, follows the thread_pool size
+   static size_t default_nthreads() { return thread_pool::singleton().nthreads(); }
 
    typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
 
-   carve_boolean_thread(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op, safe_queue<std::string>& exception_queue);
-   virtual ~carve_boolean_thread();
-
-   // allow this class to run as a boost::thread
-   void operator()() { run(); }
+   // reduce the meshes in mesh_queue to a single mesh using thread_pool tasks.
+   // The result is left in mesh_queue.
+   static void reduce(safe_queue<MeshSet_ptr>& mesh_queue, carve::csg::CSG::OP op);
 
 protected:
-   // run does the actual calculation work
-   void run();
-
-private:
-   carve::csg::CSG::OP m_op;
-   safe_queue<MeshSet_ptr>& m_mesh_queue;
-   safe_queue<std::string>& m_exception_queue;
+   // intersect the meshes one at a time, the one with the smallest bounding box first.
+   // The box of the running result only shrinks, so an operand outside it, or an empty
+   // intermediate result, makes the whole result empty and the remaining booleans are skipped.
+   // The meshes are moved out of the vector as they are used
+   static MeshSet_ptr reduce_intersection(std::vector<MeshSet_ptr>& meshes);
 };
 
 #endif // CARVE_BOOLEAN_THREAD_H
@@ -1,16 +1,26 @@
 #include "carve_mesh_thread.h"
+#include <algorithm>
+#include <future>
 #include <list>
+#include <utility>
+#include <vector>
 #include "boolean_timer.h"
+#include "carve_boolean.h"
+#include "trace_recorder.h"
+#include "remote_executor.h"
+#include "compile_context.h"
+#include "mesh_utils.h"
+#include <boost/date_time/posix_time/posix_time.hpp>
 #include <typeinfo>
 #include <stdexcept>
 
 carve_mesh_thread::carve_mesh_thread(const carve::math::Matrix& t,
-                                     const std::unordered_set<std::shared_ptr<xsolid>>& solids,
-                                     safe_queue<MeshSet_ptr>&   mesh_queue,
+                                     std::shared_ptr<xsolid>    solid,
+                                     MeshSet_ptr&               mesh,
                                      safe_queue<std::string>&   exception_queue)
 : m_t(t)
-, m_solids(solids)
-, m_mesh_queue(mesh_queue)
+, m_solid(solid)
+, m_mesh(mesh)
 , m_exception_queue(exception_queue)
 {}
 
@@ -19,66 +29,124 @@ carve_mesh_thread::~carve_mesh_thread()
 
 void carve_mesh_thread::run()
 {
+   trace_recorder::span span("carve_mesh_thread::run");
    try {
-      for(auto& solid : m_solids) {
-         std::shared_ptr<carve::mesh::MeshSet<3>> mesh = solid->create_carve_mesh(m_t);
+      boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+      std::shared_ptr<carve::mesh::MeshSet<3>> mesh = m_solid->create_carve_mesh(m_t);
+      boost::posix_time::time_duration elapsed = boost::posix_time::microsec_clock::universal_time() - time_0;
+      m_solid->record_cost(1.0E-6*elapsed.total_microseconds());
 
-         size_t nv = mesh->vertex_storage.size();
-         if(nv == 0) {
-            std::string type = typeid(*solid.get()).name();
-            throw std::runtime_error("ERROR: Solid of type '" + type + "' created empty mesh");
-         }
-
-         m_mesh_queue.enqueue(mesh);
+      if(carve_boolean::is_empty(mesh)) {
+         std::string type = typeid(*m_solid.get()).name();
+         throw std::runtime_error("ERROR: Solid of type '" + type + "' created empty mesh");
       }
+
+      m_mesh = std::move(mesh);
    }
    catch(carve::exception& ex) {
       std::string msg("(carve error): ");
       msg += ex.str();
       m_exception_queue.enqueue(msg);
+      thread_pool::singleton().cancel(msg);
    }
    catch(std::exception& ex) {
       m_exception_queue.enqueue(ex.what());
+      thread_pool::singleton().cancel(ex.what());
    }
 }
 
-void carve_mesh_thread::create_mesh_queue(const carve::math::Matrix& t, std::unordered_set<std::shared_ptr<xsolid>> objects, safe_queue<MeshSet_ptr>& mesh_queue)
+void carve_mesh_thread::run_remote()
+{
+   trace_recorder::span span("carve_mesh_thread::run_remote");
+   try {
+      m_mesh = remote_executor::singleton().compute(m_solid->fragment(),m_t,mesh_utils::secant_tolerance());
+   }
+   catch(std::exception& ex) {
+      m_exception_queue.enqueue(ex.what());
+      thread_pool::singleton().cancel(ex.what());
+      return;
+   }
+
+   // no worker could be reached, the subtree is computed here
+   if(!m_mesh) run();
+}
+
+// objects with a total estimated cost up to this limit are meshed in the calling thread
+static const double serial_cost_limit = 4;
+
+void carve_mesh_thread::create_mesh_queue(const carve::math::Matrix& t, const std::vector<std::shared_ptr<xsolid>>& objects, safe_queue<MeshSet_ptr>& mesh_queue)
+{
+   create_mesh_queue(std::vector<carve::math::Matrix>(objects.size(),t),objects,mesh_queue);
+}
+
+void carve_mesh_thread::create_mesh_queue(const std::vector<carve::math::Matrix>& transforms, const std::vector<std::shared_ptr<xsolid>>& objects, safe_queue<MeshSet_ptr>& mesh_queue)
 {
    safe_queue<std::string> exception_queue;
-   std::list<boost::thread>  mesh_threads;
+   thread_pool::task_group group;
 
    if(objects.size() > 0) {
 
-      size_t max_threads = 20;
-      size_t num_threads = std::min(objects.size(),max_threads);
-
-      size_t num_obj_thread = 1 + objects.size()/num_threads;
-      while(objects.size() > 0) {
-         std::unordered_set<std::shared_ptr<xsolid>> thread_objects;
-         size_t num_obj =std::min(num_obj_thread,objects.size());
-         for(size_t iobj=0; iobj<num_obj; iobj++) {
-            if(objects.size()==0)break;
-            auto i = objects.begin();
-            thread_objects.insert(*i);
-            objects.erase(i);
+      // each object has its own result slot, so the queue order is independent of timing
+      std::vector<MeshSet_ptr> meshes(objects.size());
+
+      // estimate the cost from the number of booleans below each object, or from the measured
+      // time of an earlier evaluation of the same subtree. Objects without booleans are
+      // primitives (often cached), a few of them are cheaper to mesh serially
+      std::vector<std::pair<double,size_t>> costs;
+      costs.reserve(objects.size());
+      double cost = 0;
+      std::vector<std::future<void>> remote_tasks;
+      for(size_t iobj=0; iobj<objects.size(); iobj++) {
+
+         // subtrees with a fragment go to the remote workers, each request waits in a thread of its own
+         // so the workers are extra executors next to the thread pool
+         if(objects[iobj]->fragment().size() > 0 && remote_executor::singleton().enabled()) {
+            compile_context* ctx = compile_context::current();
+            carve_mesh_thread remote_task(transforms[iobj],objects[iobj],meshes[iobj],exception_queue);
+            remote_tasks.push_back(std::async(std::launch::async,[ctx,remote_task]() mutable {
+               compile_context::scope scope(ctx);
+               remote_task.run_remote();
+            }));
+            continue;
          }
-         mesh_threads.push_back(boost::thread(carve_mesh_thread(t,thread_objects,mesh_queue,exception_queue)));
+         costs.push_back(std::make_pair(objects[iobj]->cost(),iobj));
+         cost += costs.back().first;
       }
 
-      // wait for the threads to finish
-      for(auto ithread=mesh_threads.begin(); ithread!=mesh_threads.end(); ithread++) {
-         ithread->join();
+      if(costs.size() <= 1 || cost <= serial_cost_limit) {
+         for(auto& c : costs) {
+            size_t iobj = c.second;
+            carve_mesh_thread(transforms[iobj],objects[iobj],meshes[iobj],exception_queue)();
+         }
+      }
+      else {
+         // critical path first: the most expensive object is meshed in this thread, which would
+         // otherwise wait for it. The others are submitted in decreasing cost, so idle workers
+         // steal the expensive ones first while this thread picks up the cheap ones afterwards
+         std::stable_sort(costs.begin(),costs.end(),[](const std::pair<double,size_t>& a, const std::pair<double,size_t>& b) { return a.first > b.first; });
+         for(size_t i=1; i<costs.size(); i++) {
+            size_t iobj = costs[i].second;
+            thread_pool::singleton().submit(group,carve_mesh_thread(transforms[iobj],objects[iobj],meshes[iobj],exception_queue));
+         }
+         size_t iobj = costs[0].second;
+         carve_mesh_thread(transforms[iobj],objects[iobj],meshes[iobj],exception_queue)();
       }
 
+      // wait for the tasks to finish, child nodes may submit their own tasks meanwhile
+      thread_pool::singleton().wait(group);
+      for(auto& remote_task : remote_tasks) remote_task.get();
+
       if(exception_queue.size() > 0) {
          throw std::logic_error(exception_queue.dequeue());
       }
+      thread_pool::singleton().throw_if_cancelled();
+
+      for(auto& mesh : meshes) mesh_queue.enqueue(std::move(mesh));
    }
 }
 
 void carve_mesh_thread::create_mesh_queue(const carve::math::Matrix& t, std::list<std::shared_ptr<xsolid>> objects, safe_queue<MeshSet_ptr>& mesh_queue)
 {
-   std::unordered_set<std::shared_ptr<xsolid>> objects_set;
-   std::copy(objects.begin(),objects.end(),std::inserter(objects_set,objects_set.begin()));
-   create_mesh_queue(t,objects_set,mesh_queue);
+   std::vector<std::shared_ptr<xsolid>> objects_vector(objects.begin(),objects.end());
+   create_mesh_queue(t,objects_vector,mesh_queue);
 }
@@ -4,8 +4,9 @@
 #include <memory>
 #include <string>
 #include <list>
-#include <boost/thread.hpp>
+#include <vector>
 #include "safe_queue.h"
+#include "thread_pool.h"
 
 #include "xsolid.h"
 
@@ -13,22 +14,29 @@ class carve_mesh_thread {
 public:
   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
 
+   // create the mesh of solid transformed by t and store it in mesh
    carve_mesh_thread(const carve::math::Matrix& t,
-                     const std::unordered_set<std::shared_ptr<xsolid>>& solids,
-                     safe_queue<MeshSet_ptr>&   mesh_queue,
+                     std::shared_ptr<xsolid>    solid,
+                     MeshSet_ptr&               mesh,
                      safe_queue<std::string>&   exception_queue);
 
    virtual ~carve_mesh_thread();
 
-   // allow this class to run as a boost::thread
+   // allow this class to run as a thread_pool task
    void operator()() { run(); }
 
-   // build the mesh queue in threads
+   // build the mesh queue in thread_pool tasks.
+   // The meshes are queued in the order of objects, regardless of completion order
    static void create_mesh_queue(const carve::math::Matrix& t,
-                                 std::unordered_set<std::shared_ptr<xsolid>> objects,
+                                 const std::vector<std::shared_ptr<xsolid>>& objects,
                                  safe_queue<MeshSet_ptr>& mesh_queue);
 
-   // build the mesh queue in threads
+   // build the mesh queue in thread_pool tasks, object i is transformed by transforms[i]
+   static void create_mesh_queue(const std::vector<carve::math::Matrix>& transforms,
+                                 const std::vector<std::shared_ptr<xsolid>>& objects,
+                                 safe_queue<MeshSet_ptr>& mesh_queue);
+
+   // build the mesh queue in thread_pool tasks
    static void create_mesh_queue(const carve::math::Matrix& t,
                                  std::list<std::shared_ptr<xsolid>> objects,
                                  safe_queue<MeshSet_ptr>& mesh_queue);
@@ -36,10 +44,13 @@ public:
 protected:
    void run();
 
+   // compute the mesh on a remote worker, or locally if no worker can be reached
+   void run_remote();
+
 private:
    carve::math::Matrix                           m_t;
-   std::unordered_set<std::shared_ptr<xsolid>>   m_solids;
-   safe_queue<MeshSet_ptr>&                      m_mesh_queue;
+   std::shared_ptr<xsolid>                       m_solid;
+   MeshSet_ptr&                                  m_mesh;
    safe_queue<std::string>&                      m_exception_queue;
 };
 
@@ -1,15 +1,21 @@
 #include "carve_minkowski_hull.h"
 #include "qhull/qhull3d.h"
 #include "carve_boolean.h"
+#include "trace_recorder.h"
+#include "thread_pool.h"
 #include <carve/matrix.hpp>
 #include "xshape.h"
 
-carve_minkowski_hull::carve_minkowski_hull(safe_queue<hull_pair>&  hull_queue,
-                                          safe_queue<MeshSet_ptr>& mesh_queue,
-                                          safe_queue<std::string>& exception_queue)
-: m_hull_queue(hull_queue)
-, m_mesh_queue(mesh_queue)
+carve_minkowski_hull::carve_minkowski_hull(const std::vector<hull_pair>&          hulls,
+                                           std::atomic<size_t>&                   next_hull,
+                                           std::vector<MeshSet_ptr>&              meshes,
+                                           safe_queue<std::string>&               exception_queue,
+                                           std::shared_ptr<const minkowski_brush> brush)
+: m_hulls(hulls)
+, m_next_hull(next_hull)
+, m_meshes(meshes)
 , m_exception_queue(exception_queue)
+, m_brush(brush)
 {}
 
 carve_minkowski_hull::~carve_minkowski_hull()
@@ -18,50 +24,85 @@ carve_minkowski_hull::~carve_minkowski_hull()
 
 void carve_minkowski_hull::run()
 {
-   // compute hull meshes as long as the hull queue is non-empty
+   // compute hull meshes as long as there are hulls left
    try {
-      while(m_hull_queue.size() > 0) {
-         hull_pair hp;
-         if(m_hull_queue.try_dequeue(hp)) {
-            m_mesh_queue.enqueue(compute_hull(hp));
-         }
+      qhull3d qhull;
+      for(size_t ihull=m_next_hull++; ihull<m_hulls.size() && !thread_pool::singleton().cancelled(); ihull=m_next_hull++) {
+         m_meshes[ihull] = compute_hull(m_hulls[ihull],qhull);
       }
    }
    catch(carve::exception& ex) {
       std::string msg("(carve error): ");
       msg += ex.str();
       m_exception_queue.enqueue(msg);
+      thread_pool::singleton().cancel(msg);
    }
    catch(std::exception& ex) {
       m_exception_queue.enqueue(ex.what());
+      thread_pool::singleton().cancel(ex.what());
    }
 
 }
 
-carve_minkowski_hull::MeshSet_ptr carve_minkowski_hull::compute_hull(hull_pair& hp)
+carve_minkowski_hull::MeshSet_ptr carve_minkowski_hull::compute_hull(const hull_pair& hp, qhull3d& qhull)
 {
-   std::vector<xvertex>& coord = hp.first;
-   MeshSet_ptr meshB           = hp.second;
+   trace_recorder::span span("carve_minkowski_hull::compute_hull");
+
+   const std::vector<xvertex>& coord = hp.first;
+   MeshSet_ptr meshB                 = hp.second;
 
-   qhull3d qhull;
+   qhull.clear();
    size_t nvert =  meshB->vertex_storage.size();
    qhull.reserve(nvert*coord.size());
+
+   if(m_brush) {
+      // convex B: v+b is skipped when every normal around b points away from the
+      // directions where face vertex v is extreme, i.e. another face vertex is further out
+      const std::vector<xvertex>& bvert = m_brush->vertices;
+      const double tol = m_brush->tol;
+      for(size_t i=0; i<coord.size(); i++) {
+         const xvertex& d = coord[i];
+         for(size_t iv=0; iv<bvert.size(); iv++) {
+            bool keep = true;
+            for(size_t j=0; j<coord.size() && keep; j++) {
+               if(j == i) continue;
+               xvertex e = d - coord[j];
+               bool reaches = false;
+               for(auto& n : m_brush->normals[iv]) {
+                  if(carve::geom::dot(n,e) >= -tol) { reaches = true; break; }
+               }
+               keep = reaches;
+            }
+            if(keep) qhull.push_back(bvert[iv].x+d.x,bvert[iv].y+d.y,bvert[iv].z+d.z);
+         }
+      }
+      carve_boolean csg;
+      csg.compute(qhull);
+      return csg.release();
+   }
+
+   // the B coordinates are gathered once into a flat block
+   std::vector<double> bxyz(3*nvert);
+   for(size_t iv=0;iv<nvert;iv++) {
+      const carve::geom3d::Vector& v = meshB->vertex_storage[iv].v;
+      bxyz[3*iv] = v.x; bxyz[3*iv+1] = v.y; bxyz[3*iv+2] = v.z;
+   }
+
    for(size_t i=0; i<coord.size(); i++) {
-      // use perturbation point to establish translation matrix
-      // and then translate all vertex coordinates in the B mesh
-      carve::math::Matrix t;
-      t.m[3][0] = coord[i].x;
-      t.m[3][1] = coord[i].y;
-      t.m[3][2] = coord[i].z;
-      for(size_t i=0;i<nvert;i++) {
-         carve::mesh::MeshSet<3>::vertex_t vertex = meshB->vertex_storage[i];
-         xvertex pos = t*vertex.v;
-         qhull.push_back(pos[0],pos[1],pos[2]);
+      // translate all vertex coordinates in the B mesh by the perturbation point,
+      // written directly into the qhull input
+      const double dx = coord[i].x, dy = coord[i].y, dz = coord[i].z;
+      const double* b = bxyz.data();
+      double* out = qhull.append(nvert);
+      for(size_t iv=0;iv<nvert;iv++) {
+         out[3*iv]   = b[3*iv]   + dx;
+         out[3*iv+1] = b[3*iv+1] + dy;
+         out[3*iv+2] = b[3*iv+2] + dz;
       }
    }
 
    // compute the hull mesh and return it as carve mesh
    carve_boolean csg;
    csg.compute(qhull);
-   return csg.mesh_set();
+   return csg.release();
 }
@@ -1,40 +1,58 @@
 #ifndef CARVE_MINKOWSKI_HULL_H
 #define CARVE_MINKOWSKI_HULL_H
 
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
-#include <boost/thread.hpp>
+#include "thread_pool.h"
 #include "safe_queue.h"
 #include "xshape.h"
+#include "qhull/qhull3d.h"
+
+// support data of a convex B mesh. A hull point v+b of a face vertex v can only be
+// on the hull if the outward normals around b reach the directions where v is extreme
+struct minkowski_brush {
+   std::vector<xvertex>              vertices;  // B vertex coordinates
+   std::vector<std::vector<xvertex>> normals;   // unit normals of the faces around each vertex
+   double                            tol;       // distance tolerance for the normal tests
+};
 
-// carve_minkowski_hull translates the "hull_queue" into the "mesh_queue"
-// by computing convex hull meshes for all entries in the hull queue
-// Each hull_pair contains a mesh and associated perturbation coordinates for computing a hull
+// carve_minkowski_hull translates the "hulls" into "meshes"
+// by computing convex hull meshes for all entries in the hull vector.
+// Each hull_pair contains a mesh and associated perturbation coordinates for computing a hull.
+// Several tasks share the work by picking the next hull index, and each result
+// is stored at the index of its hull, so the result order is independent of timing
 
 class carve_minkowski_hull {
 public:
    typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
    typedef std::pair<std::vector<xvertex>,MeshSet_ptr>  hull_pair;
 
-   carve_minkowski_hull(safe_queue<hull_pair>&   hull_queue,
-                        safe_queue<MeshSet_ptr>& mesh_queue,
-                        safe_queue<std::string>& exception_queue);
+   // meshes must have the same size as hulls. brush is given when B is convex, null otherwise
+   carve_minkowski_hull(const std::vector<hull_pair>&          hulls,
+                        std::atomic<size_t>&                   next_hull,
+                        std::vector<MeshSet_ptr>&              meshes,
+                        safe_queue<std::string>&               exception_queue,
+                        std::shared_ptr<const minkowski_brush> brush = std::shared_ptr<const minkowski_brush>());
 
    virtual ~carve_minkowski_hull();
 
-   // allow this class to run as a boost::thread
+   // allow this class to run as a thread_pool task
    void operator()() { run(); }
 
 protected:
    void run();
 
-   MeshSet_ptr compute_hull(hull_pair& hp);
+   // compute one hull. qhull is reused between hulls, so its buffers are allocated once per task
+   MeshSet_ptr compute_hull(const hull_pair& hp, qhull3d& qhull);
 
 private:
-   safe_queue<hull_pair>&   m_hull_queue;
-   safe_queue<MeshSet_ptr>& m_mesh_queue;
-   safe_queue<std::string>& m_exception_queue;
+   const std::vector<hull_pair>& m_hulls;
+   std::atomic<size_t>&          m_next_hull;
+   std::vector<MeshSet_ptr>&     m_meshes;
+   safe_queue<std::string>&      m_exception_queue;
+   std::shared_ptr<const minkowski_brush> m_brush;
 };
 
 #endif // CARVE_MINKOWSKI_HULL_H
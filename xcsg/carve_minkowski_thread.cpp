@@ -1,10 +1,13 @@
 #include "carve_minkowski_thread.h"
 #include "carve_minkowski_hull.h"
 #include "carve_boolean.h"
-#include "carve_triangulate.h"
 #include "carve_boolean_thread.h"
-#include "xpolyhedron.h"
+#include <carve/triangulator.hpp>
+#include "boolean_timer.h"
+#include "geom_kernel.h"
 
+#include <algorithm>
+#include <utility>
 #include <map>
 
 carve_minkowski_thread::carve_minkowski_thread()
@@ -13,28 +16,132 @@ carve_minkowski_thread::carve_minkowski_thread()
 carve_minkowski_thread::~carve_minkowski_thread()
 {}
 
-void carve_minkowski_thread::add_faces(std::shared_ptr<carve::poly::Polyhedron> poly, MeshSet_ptr meshB, safe_queue<hull_pair>& hull_queue)
+std::shared_ptr<minkowski_brush> carve_minkowski_thread::convex_brush(MeshSet_ptr mesh)
 {
-   size_t nfaces = poly->faces.size();
-   std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
-
-   // one hull pair per face
-   for(size_t iface=0; iface< nfaces; iface++) {
-
-      hull_pair hp;
-
-      // the face should always be triangular at this point
-      size_t nv = poly->faces[iface].nVertices();
-      std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-      poly->faces[iface].getVertexLoop(vloop);
-      for(size_t ivert=0; ivert<nv; ivert++) {
-         size_t index = poly->vertexToIndex(vloop[ivert]);
-         carve::poly::Geometry<3>::vertex_t& vtx = vertices[index];
-         hp.first.push_back(carve::geom::VECTOR(vtx.v[0],vtx.v[1],vtx.v[2]));
+   std::shared_ptr<minkowski_brush> brush;
+   if(mesh->meshes.size() != 1 || !mesh->meshes[0]->isClosed()) return brush;
+   const std::vector<carve::mesh::Face<3>*>& faces = mesh->meshes[0]->faces;
+   const size_t nvert = mesh->vertex_storage.size();
+   if(nvert == 0) return brush;
+   const carve::mesh::MeshSet<3>::vertex_t* vbase = &mesh->vertex_storage[0];
+
+   // tolerance relative to the mesh size
+   xvertex vmin = vbase[0].v, vmax = vbase[0].v;
+   for(size_t iv=1; iv<nvert; iv++) {
+      const xvertex& p = vbase[iv].v;
+      for(size_t k=0; k<3; k++) {
+         vmin[k] = std::min(vmin[k],p[k]);
+         vmax[k] = std::max(vmax[k],p[k]);
       }
+   }
+   const double tol = 1.0E-7*(vmax-vmin).length();
+
+   // unit face normals using Newell's method, zero area faces get a zero normal
+   std::vector<xvertex> normals(faces.size());
+   std::vector<xvertex> loop;
+   for(size_t iface=0; iface<faces.size(); iface++) {
+      const carve::mesh::Face<3>* face = faces[iface];
+      loop.clear();
+      const carve::mesh::Edge<3>* e = face->edge;
+      do {
+         loop.push_back(e->vert->v);
+         e = e->next;
+      } while(e != face->edge);
+      xvertex n;
+      geom_kernel::newell_normal(loop[0].v,loop.size(),n.v);
+      double len = n.length();
+      normals[iface] = (len > 0.0)? n/len : n;
+   }
+
+   brush = std::make_shared<minkowski_brush>();
+   brush->vertices.reserve(nvert);
+   for(size_t iv=0; iv<nvert; iv++) brush->vertices.push_back(vbase[iv].v);
+   brush->normals.resize(nvert);
+   brush->tol = tol;
+
+   for(size_t iface=0; iface<faces.size(); iface++) {
+      const carve::mesh::Face<3>* face = faces[iface];
+      const xvertex& n  = normals[iface];
+      const xvertex& p0 = face->edge->vert->v;
+      const bool has_normal = (n.length2() > 0.0);
+      const carve::mesh::Edge<3>* e = face->edge;
+      do {
+         if(!e->rev) return std::shared_ptr<minkowski_brush>();
+         if(has_normal) {
+            brush->normals[e->vert - vbase].push_back(n);
 
-      hp.second = meshB;
-      hull_queue.enqueue(hp);
+            // the vertices of the neighbour face across this edge must not be in front of the face
+            const carve::mesh::Edge<3>* r = e->rev;
+            do {
+               if(carve::geom::dot(n,r->vert->v - p0) > tol) return std::shared_ptr<minkowski_brush>();
+               r = r->next;
+            } while(r != e->rev);
+         }
+         e = e->next;
+      } while(e != face->edge);
+   }
+   return brush;
+}
+
+bool carve_minkowski_thread::is_convex_face(const carve::mesh::Face<3>* face, const std::vector<const carve::mesh::MeshSet<3>::vertex_t*>& vloop)
+{
+   // all turns in the face projection must have the same sign, collinear vertices are allowed
+   const size_t nv = vloop.size();
+   int sign = 0;
+   for(size_t i=0; i<nv; i++) {
+      carve::geom2d::P2 p0 = face->project(vloop[i]->v);
+      carve::geom2d::P2 p1 = face->project(vloop[(i+1)%nv]->v);
+      carve::geom2d::P2 p2 = face->project(vloop[(i+2)%nv]->v);
+      double cross = (p1.x-p0.x)*(p2.y-p1.y) - (p1.y-p0.y)*(p2.x-p1.x);
+      int s = (cross > 0.0)? 1 : ((cross < 0.0)? -1 : 0);
+      if(s == 0) continue;
+      if(sign != 0 && s != sign) return false;
+      sign = s;
+   }
+   return sign != 0;
+}
+
+void carve_minkowski_thread::add_faces(MeshSet_ptr meshA, MeshSet_ptr meshB, std::vector<hull_pair>& hulls)
+{
+   std::vector<const carve::mesh::MeshSet<3>::vertex_t*> vloop;
+   std::vector<carve::triangulate::tri_idx> tris;
+
+   // one hull pair per convex face or triangle, read directly from the mesh faces
+   for(auto mesh : meshA->meshes) {
+      for(auto face : mesh->faces) {
+
+         vloop.clear();
+         const carve::mesh::Edge<3>* e = face->edge;
+         do {
+            vloop.push_back(e->vert);
+            e = e->next;
+         } while(e != face->edge);
+
+         if(vloop.size() < 3) continue;
+
+         // a convex face gives a single hull piece, its sum with B is the hull of all vertex sums
+         if(vloop.size() == 3 || is_convex_face(face,vloop)) {
+            hull_pair hp;
+            hp.first.reserve(vloop.size());
+            for(auto v : vloop) hp.first.push_back(v->v);
+            hp.second = meshB;
+            hulls.push_back(hp);
+            continue;
+         }
+
+         // larger faces may be non-convex, triangulate them in the face projection
+         tris.clear();
+         carve::triangulate::triangulate([face](const carve::mesh::MeshSet<3>::vertex_t* v) { return face->project(v->v); },vloop,tris);
+         for(auto& tri : tris) {
+            hull_pair hp;
+            hp.first.reserve(3);
+            hp.first.push_back(vloop[tri.a]->v);
+            hp.first.push_back(vloop[tri.b]->v);
+            hp.first.push_back(vloop[tri.c]->v);
+            hp.second = meshB;
+            hulls.push_back(hp);
+         }
+      }
    }
 }
 
@@ -52,79 +159,100 @@ void carve_minkowski_thread::create_mesh_queue(const carve::math::Matrix& t,
    MeshSet_ptr meshA = (*i++)->create_carve_mesh(t);
    MeshSet_ptr meshB = (*i++)->create_carve_mesh(t);
 
-   // meshA goes straight into the mesh queue as it will be unioned
+   // a convex B allows the face hulls to skip B vertices. The sum is symmetric, so when
+   // only A is convex the operands are swapped and the faces of the original B are used
+   std::shared_ptr<const minkowski_brush> brush = convex_brush(meshB);
+   if(!brush) {
+      std::shared_ptr<const minkowski_brush> brushA = convex_brush(meshA);
+      if(brushA) {
+         std::swap(meshA,meshB);
+         brush = brushA;
+      }
+   }
+
+   // with a convex B, every convex lump of A gives a single hull of all vertex sums.
+   // Only the remaining lumps are split into face hulls, which must be unioned with A
+   std::vector<hull_pair> lump_hulls;
+   if(brush) {
+      std::vector<size_t> other_lumps;
+      for(size_t imesh=0; imesh<meshA->meshes.size(); imesh++) {
+         MeshSet_ptr lump = (meshA->meshes.size() == 1)? meshA : carve_boolean::copy_meshes(*meshA,std::vector<size_t>(1,imesh));
+         if(convex_brush(lump)) {
+            hull_pair hp;
+            hp.first.reserve(lump->vertex_storage.size());
+            for(auto& v : lump->vertex_storage) hp.first.push_back(v.v);
+            hp.second = meshB;
+            lump_hulls.push_back(hp);
+         }
+         else {
+            other_lumps.push_back(imesh);
+         }
+      }
+      if(lump_hulls.size() > 0) {
+         if(other_lumps.size() == 0) meshA.reset();
+         else                        meshA = carve_boolean::copy_meshes(*meshA,other_lumps);
+      }
+   }
+
+   // the non-convex part of A goes straight into the mesh queue as it will be unioned
    // with the hull meshes
-   mesh_queue.enqueue(meshA);
+   if(meshA) mesh_queue.enqueue(meshA);
 
-   // extract coordinates for all faces in A and build the hull queue.
-   // The hull queue contains the B mesh pluss perturbation coordinates
+   // extract coordinates for all faces in A and build the hulls.
+   // Each hull contains the B mesh pluss perturbation coordinates
    // for computing a hull mesh, based on A faces
-   safe_queue<hull_pair> hull_queue;
-
-   // triangulate meshA so we are sure it contains only triangular (i.e. convex) faces
-   // then add all faces to the hull_queue
-   auto polyA = triangulate(meshA);
-   for(size_t ipoly=0; ipoly<polyA->size(); ipoly++) {
-      std::shared_ptr<carve::poly::Polyhedron> poly = (*polyA)[ipoly];
-      add_faces(poly,meshB,hull_queue);
-   }
+   std::vector<hull_pair> hulls;
+
+   // add all faces of meshA to the hulls, split into convex faces
+   if(meshA) add_faces(meshA,meshB,hulls);
 
-   // compute the hull meshes and store them in the mesh queue
-   const size_t nthreads = std::min(carve_boolean_thread::default_nthreads(),hull_queue.size());
+   // compute the hull meshes and store them in the mesh queue. The lump hulls are not
+   // filtered with the brush, their vertex sets are complete convex polyhedra
+   std::vector<MeshSet_ptr>  lump_meshes(lump_hulls.size());
+   std::vector<MeshSet_ptr>  face_meshes(hulls.size());
+   std::atomic<size_t>       next_lump(0);
+   std::atomic<size_t>       next_hull(0);
    safe_queue<std::string>   exception_queue;
-   std::list<boost::thread>  hull_threads;
+   thread_pool::task_group   group;
+   const size_t nlump_threads = std::min(carve_boolean_thread::default_nthreads(),lump_hulls.size());
+   for(size_t i=0; i<nlump_threads; i++) {
+      thread_pool::singleton().submit(group,carve_minkowski_hull(lump_hulls,next_lump,lump_meshes,exception_queue));
+   }
+   const size_t nthreads = std::min(carve_boolean_thread::default_nthreads(),hulls.size());
    for(size_t i=0; i<nthreads; i++) {
-      hull_threads.push_back(boost::thread(carve_minkowski_hull(hull_queue,mesh_queue,exception_queue)));
+      thread_pool::singleton().submit(group,carve_minkowski_hull(hulls,next_hull,face_meshes,exception_queue,brush));
    }
 
-   // wait for the threads to finish
-   for(auto ithread=hull_threads.begin(); ithread!=hull_threads.end(); ithread++) {
-      ithread->join();
-   }
+   // wait for the tasks to finish
+   thread_pool::singleton().wait(group);
 
    if(exception_queue.size() > 0) {
       throw std::logic_error(exception_queue.dequeue());
    }
+   thread_pool::singleton().throw_if_cancelled();
 
-   // the mesh queue is now complete
-}
-
-std::shared_ptr<std::vector<std::shared_ptr<carve::poly::Polyhedron>>> carve_minkowski_thread::triangulate(MeshSet_ptr mesh_set)
-{
-   // the triangulator needs a carve polyhedron.
-   // we can convert to such polyhedra using carve_boolean
-   carve_boolean csg;
-   csg.compute(mesh_set,carve::csg::CSG::OP::UNION);
-
-   carve_triangulate triangulator;
-
-   size_t nmani = csg.size();
-   for(size_t imani=0; imani<nmani; imani++) {
-      std::shared_ptr<xpolyhedron> poly = csg.create_manifold(imani);
-
-      // check if there are any non-triangular faces
-      bool must_triangulate = false;
-      size_t nfaces = poly->f_size();
-      for(size_t iface=0;iface<nfaces; iface++) {
-         const xface& face = poly->f_get(iface);
-         if(face.size() > 3) {
-            must_triangulate = true;
-            break;
-         }
-      }
+   std::vector<MeshSet_ptr> meshes;
+   meshes.reserve(lump_meshes.size()+face_meshes.size());
+   meshes.insert(meshes.end(),std::make_move_iterator(lump_meshes.begin()),std::make_move_iterator(lump_meshes.end()));
+   meshes.insert(meshes.end(),std::make_move_iterator(face_meshes.begin()),std::make_move_iterator(face_meshes.end()));
 
-      if(must_triangulate) {
-         bool improve = false;
-         bool canonicalize = false;
-         bool degen_check = false;
-         triangulator.compute(poly->create_carve_polyhedron(),improve,canonicalize,degen_check);
-      }
-      else {
-         // triangulation not required
-         triangulator.add(poly->create_carve_polyhedron());
-      }
+   // a single convex lump with a convex B is the complete sum
+   if(!meshA && meshes.size() == 1) {
+      mesh_queue.enqueue(std::move(meshes[0]));
+      boolean_timer::singleton().add_nbool(1);
+      return;
    }
-   return triangulator.carve_polyset();
-}
 
+   // improve the timer estimate now that the number of booleans is known for this operation
+   boolean_timer::singleton().add_nbool(static_cast<int>(meshes.size()+1));
 
+   // the hull pieces are unioned among themselves first, spatial neighbours merged early.
+   // meshA overlaps all pieces, in the same union tree it would be carried up through
+   // every level, so it only joins the complete hull union in the mesh queue
+   if(meshes.size() > 0) {
+      safe_queue<MeshSet_ptr> hull_queue;
+      for(auto& mesh : meshes) hull_queue.enqueue(std::move(mesh));
+      carve_boolean_thread::reduce(hull_queue,carve::csg::CSG::UNION);
+      mesh_queue.enqueue(hull_queue.dequeue());
+   }
+}
@@ -3,10 +3,12 @@
 
 #include <memory>
 #include <string>
-#include <boost/thread.hpp>
+#include <vector>
+#include "thread_pool.h"
 #include "safe_queue.h"
 #include <carve/poly.hpp>
 #include "xsolid.h"
+#include "carve_minkowski_hull.h"
 
 // carve_minkowski_thread fills the mesh queue.
 // it also does the main logic for minkowski
@@ -19,16 +21,24 @@ public:
    carve_minkowski_thread();
    virtual ~carve_minkowski_thread();
 
-   // build the mesh queue
+   // build the mesh queue, it receives the non-convex lumps of A and the union of the hull pieces:
+   // one per convex lump of A when B is convex, and one per face of the other lumps
+   // (or the single hull when both A and B are convex)
    static void create_mesh_queue(const carve::math::Matrix& t,
                                  std::list<std::shared_ptr<xsolid>> objects,
                                  safe_queue<MeshSet_ptr>& mesh_queue);
 
 protected:
-   static void add_faces(std::shared_ptr<carve::poly::Polyhedron> poly, MeshSet_ptr meshB, safe_queue<hull_pair>& hull_queue);
+   // return support data for a convex mesh, or null if the mesh is not a single closed convex mesh.
+   // The mesh is convex when the vertices of each face neighbour are on or behind the face plane
+   static std::shared_ptr<minkowski_brush> convex_brush(MeshSet_ptr mesh);
 
-   // create triangulated polyhedra from mesh
-   static std::shared_ptr<std::vector<std::shared_ptr<carve::poly::Polyhedron>>>  triangulate(MeshSet_ptr mesh);
+   // true if the face polygon is convex in its own projection plane
+   static bool is_convex_face(const carve::mesh::Face<3>* face, const std::vector<const carve::mesh::MeshSet<3>::vertex_t*>& vloop);
+
+   // add one hull pair per convex face of meshA, taken directly from the mesh faces.
+   // Non-convex faces are triangulated in their own projection plane, one hull pair per triangle
+   static void add_faces(MeshSet_ptr meshA, MeshSet_ptr meshB, std::vector<hull_pair>& hulls);
 
 private:
 };
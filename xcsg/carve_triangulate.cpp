@@ -18,7 +18,10 @@
 #include <carve/csg_triangulator.hpp>
 
 #include "carve_triangulate_face.h"
-#include <forward_list>
+#include "trace_recorder.h"
+#include "thread_pool.h"
+#include "message_log.h"
+#include <atomic>
 
 // #include <boost/filesystem.hpp>
 // #include <boost/filesystem/convenience.hpp>
@@ -68,53 +71,69 @@ static double polyhedron_face_area( const carve::poly::Polyhedron::vertex_t* va,
 
 size_t carve_triangulate::compute(std::shared_ptr<carve::poly::Polyhedron> poly, bool improve, bool canonicalize, bool degen_check)
 {
+   trace_recorder::span span("carve_triangulate::compute");
+
    // copy all vertices from onput polyhedron
    std::vector<carve::poly::Vertex<3> > out_vertices = poly->vertices;
 
-   // storage for triangulated vertices
-   std::vector<carve::poly::Face<3> > out_faces;
+   // each face gets a preallocated range of nv-2 triangles, the chunks of faces
+   // are triangulated in parallel and fill their own ranges
+   std::vector<size_t> offset;
+   std::vector<std::pair<size_t,size_t>> chunks;
+   face_chunks(*poly,offset,chunks);
+   std::vector<tri_vind> tris(offset.back());
+   std::vector<size_t>   ntris(poly->faces.size(),0);
 
-   // compute number of output faces
-   size_t N = 0;
-   for (size_t i = 0; i < poly->faces.size(); ++i) {
-      carve::poly::Face<3> &f = poly->faces[i];
-      N += f.nVertices() - 2;
-   }
-   out_faces.reserve(N);
-
-   // triangulate each face
-   size_t nzero_dropped = 0;
-   for(size_t i = 0; i < poly->faces.size(); ++i) {
-      carve::poly::Face<3> &f = poly->faces[i];
+   std::atomic<size_t> nzero_dropped(0);
+   for_each_chunk(chunks.size(),[&](size_t ichunk) {
       std::vector<carve::triangulate::tri_idx> result;
-
       std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-      f.getVertexLoop(vloop);
+      size_t ndropped = 0;
+      for(size_t i=chunks[ichunk].first; i<chunks[ichunk].second; i++) {
+         carve::poly::Face<3> &f = poly->faces[i];
+         result.clear();
+         vloop.clear();
+         f.getVertexLoop(vloop);
+
+         // only faces that are not strictly convex need the general triangulation
+         if(!triangulate_convex(vloop,carve::poly::p2_adapt_project<3>(f.project),result)) {
+            carve::triangulate::triangulate(carve::poly::p2_adapt_project<3>(f.project), vloop, result);
+            if(improve && vloop.size()>3) {
+               carve::triangulate::improve(carve::poly::p2_adapt_project<3>(f.project), vloop, result);
+            }
+         }
 
-      carve::triangulate::triangulate(carve::poly::p2_adapt_project<3>(f.project), vloop, result);
-      if(improve && vloop.size()>3) {
-         carve::triangulate::improve(carve::poly::p2_adapt_project<3>(f.project), vloop, result);
+         // add triangle faces to the range of the face
+         size_t ntri = 0;
+         for (size_t j = 0; j < result.size() && offset[i]+ntri < offset[i+1]; ++j) {
+
+            // check the area of the triangulated face, ignore if degenerate
+            double face_area = (degen_check)? polyhedron_face_area( vloop[result[j].a], vloop[result[j].b], vloop[result[j].c] ) : 1.0;
+
+            if(0 <  face_area ) {
+               tri_vind& tri = tris[offset[i]+ntri++];
+               tri[0] = poly->vertexToIndex_fast(vloop[result[j].a]);
+               tri[1] = poly->vertexToIndex_fast(vloop[result[j].b]);
+               tri[2] = poly->vertexToIndex_fast(vloop[result[j].c]);
+            }
+            else {
+               ndropped++;
+            }
+         }
+         ntris[i] = ntri;
       }
+      nzero_dropped += ndropped;
+   });
+   if(nzero_dropped>0) message_log::warning() << ">>> Warning: dropped "<<nzero_dropped.load() <<" zero area triangles(s) during triangulation.";
 
-      // add triangle faces to output
-      for (size_t j = 0; j < result.size(); ++j) {
-
-         // check the area of the triangulated face, ignore if degenerate
-        double face_area = (degen_check)? polyhedron_face_area( vloop[result[j].a], vloop[result[j].b], vloop[result[j].c] ) : 1.0;
-
-        if(0 <  face_area ) {
-            out_faces.push_back(carve::poly::Face<3>(
-               &out_vertices[poly->vertexToIndex_fast(vloop[result[j].a])],
-               &out_vertices[poly->vertexToIndex_fast(vloop[result[j].b])],
-               &out_vertices[poly->vertexToIndex_fast(vloop[result[j].c])]
-            ));
-        }
-        else {
-           nzero_dropped++;
-        }
+   // assemble the output faces once
+   std::vector<carve::poly::Face<3> > out_faces;
+   out_faces.reserve(tris.size());
+   for(size_t i=0; i<poly->faces.size(); i++) {
+      for(size_t j=offset[i]; j<offset[i]+ntris[i]; j++) {
+         out_faces.push_back(carve::poly::Face<3>(&out_vertices[tris[j][0]],&out_vertices[tris[j][1]],&out_vertices[tris[j][2]]));
       }
    }
-   if(nzero_dropped>0) std::cout << ">>> Warning: dropped "<<nzero_dropped <<" zero area triangles(s) during triangulation." << std::endl;
 
    // create the new polyhedron
    std::shared_ptr<carve::poly::Polyhedron> poly_triangle(new carve::poly::Polyhedron(out_faces, out_vertices));
@@ -129,6 +148,39 @@ size_t carve_triangulate::compute(std::shared_ptr<carve::poly::Polyhedron> poly,
    return poly_triangle->faces.size();
 }
 
+void carve_triangulate::face_chunks(const carve::poly::Polyhedron& poly, std::vector<size_t>& offset, std::vector<std::pair<size_t,size_t>>& chunks)
+{
+   const size_t nfaces = poly.faces.size();
+   offset.assign(nfaces+1,0);
+   for(size_t i=0; i<nfaces; i++) {
+      size_t nv = poly.faces[i].nVertices();
+      offset[i+1] = offset[i] + ((nv > 2)? nv-2 : 0);
+   }
+
+   chunks.clear();
+   size_t ifirst = 0;
+   for(size_t i=0; i<nfaces; i++) {
+      if(offset[i+1]-offset[ifirst] >= chunk_triangles || i+1 == nfaces) {
+         chunks.push_back(std::make_pair(ifirst,i+1));
+         ifirst = i+1;
+      }
+   }
+}
+
+void carve_triangulate::for_each_chunk(size_t nchunks, const std::function<void(size_t ichunk)>& f)
+{
+   if(nchunks == 1) {
+      f(0);
+      return;
+   }
+
+   thread_pool::task_group group;
+   for(size_t ichunk=0; ichunk<nchunks; ichunk++) {
+      thread_pool::singleton().submit(group,[&f,ichunk]() { f(ichunk); });
+   }
+   thread_pool::singleton().wait(group);
+}
+
 void carve_triangulate::add(std::shared_ptr<carve::poly::Polyhedron> poly)
 {
    m_polyset->push_back(poly);
@@ -136,87 +188,95 @@ void carve_triangulate::add(std::shared_ptr<carve::poly::Polyhedron> poly)
 
 size_t carve_triangulate::compute2d(std::shared_ptr<carve::poly::Polyhedron> poly)
 {
-   typedef std::vector<const carve::poly::Vertex<3> *> VertexLoop;
+   trace_recorder::span span("carve_triangulate::compute2d");
 
-   // triangulated faces will temporarily be stored in tri_faces (as vertex loops)
-   std::forward_list<VertexLoop> tri_faces;
+   // the faces are triangulated in parallel chunks, each with its own face triangulator
+   // so that the libtess2 tesselator is reused for all faces of the chunk. libtess2 may
+   // return another number of triangles than nv-2, so each chunk collects its own triangles
+   std::vector<size_t> offset;
+   std::vector<std::pair<size_t,size_t>> chunks;
+   face_chunks(*poly,offset,chunks);
+   std::vector<std::vector<tri_vind>> chunk_tris(chunks.size());
 
-   // unfortunately, std::forward_list has no size() member, so we must keep track of the triangle count ourselves
-   size_t tri_faces_size = 0;
+   for_each_chunk(chunks.size(),[&](size_t ic) {
+      std::vector<tri_vind>& tris = chunk_tris[ic];
+      tris.reserve(offset[chunks[ic].second] - offset[chunks[ic].first]);
 
-   // Traverse the input faces
-   for (size_t i = 0; i < poly->faces.size(); ++i) {
+      carve_triangulate_face triangulator(nullptr);
+      std::vector<const carve::poly::Vertex<3> *> vloop;
+      std::vector<carve::triangulate::tri_idx> convex_tris;
+      for(size_t i=chunks[ic].first; i<chunks[ic].second; i++) {
 
-      carve::poly::Face<3>& f = poly->faces[i];
-      size_t nv  = f.nVertices();
-
-      if(nv > 2) {
+         carve::poly::Face<3>& f = poly->faces[i];
+         size_t nv  = f.nVertices();
+         if(nv < 3) continue;
 
          // get the face vertex loop
-         VertexLoop vloop;
+         vloop.clear();
          f.getVertexLoop(vloop);
 
          if(nv == 3) {
             // already a triangle
-            tri_faces.push_front(vloop);
-            tri_faces_size++;
+            tris.push_back({ poly->vertexToIndex_fast(vloop[0]), poly->vertexToIndex_fast(vloop[1]), poly->vertexToIndex_fast(vloop[2]) });
          }
          else if(nv == 4) {
 
             // just split the quad face into 2 triangles
             // make sure to split along shortest diagonal
+            size_t vi[4];
+            for(size_t iv=0; iv<4; iv++) vi[iv] = poly->vertexToIndex_fast(vloop[iv]);
 
             double d02 = distance(vloop[0],vloop[2]);
             double d13 = distance(vloop[1],vloop[3]);
             if(d02 <= d13) {
-               VertexLoop tri_vloop1 =  { vloop[0], vloop[1], vloop[2]};
-               VertexLoop tri_vloop2 =  { vloop[0], vloop[2], vloop[3]};
-               tri_faces.push_front(tri_vloop1);
-               tri_faces.push_front(tri_vloop2);
+               tris.push_back({ vi[0], vi[1], vi[2] });
+               tris.push_back({ vi[0], vi[2], vi[3] });
             }
             else {
-               VertexLoop tri_vloop1 =  { vloop[0], vloop[1], vloop[3]};
-               VertexLoop tri_vloop2 =  { vloop[1], vloop[2], vloop[3]};
-               tri_faces.push_front(tri_vloop1);
-               tri_faces.push_front(tri_vloop2);
+               tris.push_back({ vi[0], vi[1], vi[3] });
+               tris.push_back({ vi[1], vi[2], vi[3] });
             }
-            tri_faces_size += 2;
-
+         }
+         else if(triangulate_convex(vloop,carve::poly::p2_adapt_project<3>(f.project),convex_tris)) {
+            // convex faces are fanned without the tesselator
+            for(auto& tri : convex_tris) {
+               tris.push_back({ poly->vertexToIndex_fast(vloop[tri.a]), poly->vertexToIndex_fast(vloop[tri.b]), poly->vertexToIndex_fast(vloop[tri.c]) });
+            }
+            convex_tris.clear();
          }
          else {
-            // 5 or more vertices, this face must be triangulated
+            // 5 or more vertices in a non-convex face, this face must be triangulated
 
             auto spec  = std::make_shared<carve_triangulate_face::spec>();
             spec->vxy  = f.projectedVertices();
 
             // convert the face vertex loop to vector of vertex indices: vind refers to poly->vertices
-            // and also compute vector of projected 2d coordinates for the same face vertices
             spec->vind.reserve(nv);
             for(size_t iv=0; iv<nv; iv++) {
                spec->vind.push_back(poly->vertexToIndex_fast(vloop[iv]));
             }
 
-            // use the face triangulator to create a triangle mesh.
-            // it is done in 3 steps to be prepared for threading later
-            carve_triangulate_face triangulator(spec);
-            triangulator.compute();
+            // use the face triangulator to create a triangle mesh
+            triangulator.compute(spec);
             std::vector<std::vector<size_t>> tri_vinds = triangulator.move_triangles();
 
             // extract the triangles
-            for(auto& tri_vind : tri_vinds) {
-              VertexLoop tri_vloop =  { &poly->vertices[tri_vind[0]], &poly->vertices[tri_vind[1]], &poly->vertices[tri_vind[2]] };
-              tri_faces.push_front(tri_vloop);
-              tri_faces_size++;
+            for(auto& vind : tri_vinds) {
+               if(vind.size() == 3) tris.push_back({ vind[0], vind[1], vind[2] });
             }
          }
       }
-   }
+   });
 
-   // convert the forward_list of vertex loops into a vector of faces
+   // assemble the faces once, in face order
+   size_t ntris = 0;
+   for(auto& tris : chunk_tris) ntris += tris.size();
    std::vector<carve::poly::Face<3>> faces;
-   faces.reserve(tri_faces_size);
-   for(auto& tri_vloop : tri_faces) {
-      faces.push_back(carve::poly::Face<3>(tri_vloop));
+   faces.reserve(ntris);
+   for(auto& tris : chunk_tris) {
+      for(auto& tri : tris) {
+         faces.push_back(carve::poly::Face<3>(&poly->vertices[tri[0]],&poly->vertices[tri[1]],&poly->vertices[tri[2]]));
+      }
    }
 
    // create the triangulated polyhedron
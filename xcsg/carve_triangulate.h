@@ -16,9 +16,12 @@
 #ifndef CARVE_TRIANGULATE_H
 #define CARVE_TRIANGULATE_H
 
+#include <array>
+#include <functional>
 #include <vector>
 #include <memory>
 #include <carve/csg.hpp>
+#include <carve/triangulator.hpp>
 #include <ostream>
 
 class carve_triangulate {
@@ -39,8 +42,66 @@ public:
 
    std::shared_ptr<poly_vector> carve_polyset() { return m_polyset; }
 
+   // triangulate a strictly convex face directly: quads are split along the shorter diagonal
+   // and larger faces are fanned. project(v) maps a vertex pointer to the face plane.
+   // Returns false, with result untouched, if the face is not strictly convex
+   template <typename vertex_t, typename project_t>
+   static bool triangulate_convex(const std::vector<const vertex_t*>& vloop, project_t project, std::vector<carve::triangulate::tri_idx>& result);
+
+   // faces are triangulated in parallel chunks of about this many triangles
+   static const size_t chunk_triangles = 2048;
+
+protected:
+   typedef std::array<size_t,3> tri_vind;  // triangle as indices into the polyhedron vertices
+
+   // offset[i] is the first of the nv-2 triangles of face i, offset[nfaces] the total.
+   // chunks are the face ranges [first,end) triangulated as one task
+   static void face_chunks(const carve::poly::Polyhedron& poly, std::vector<size_t>& offset, std::vector<std::pair<size_t,size_t>>& chunks);
+
+   // call f(ichunk) for each chunk as thread_pool tasks and wait for them
+   static void for_each_chunk(size_t nchunks, const std::function<void(size_t ichunk)>& f);
+
 private:
    std::shared_ptr<poly_vector> m_polyset;
 };
 
+template <typename vertex_t, typename project_t>
+bool carve_triangulate::triangulate_convex(const std::vector<const vertex_t*>& vloop, project_t project, std::vector<carve::triangulate::tri_idx>& result)
+{
+   const size_t nv = vloop.size();
+   if(nv < 4) return false;
+
+   // all turns in the face plane must have the same sign. Collinear vertices are not
+   // accepted, a fan over them would create zero area triangles
+   carve::geom2d::P2 p0 = project(vloop[nv-2]);
+   carve::geom2d::P2 p1 = project(vloop[nv-1]);
+   int sign = 0;
+   for(size_t i=0; i<nv; i++) {
+      carve::geom2d::P2 p2 = project(vloop[i]);
+      double cross = (p1.x-p0.x)*(p2.y-p1.y) - (p1.y-p0.y)*(p2.x-p1.x);
+      int s = (cross > 0.0)? 1 : ((cross < 0.0)? -1 : 0);
+      if(s == 0 || (sign != 0 && s != sign)) return false;
+      sign = s;
+      p0 = p1;
+      p1 = p2;
+   }
+
+   if(nv == 4) {
+      if((vloop[0]->v - vloop[2]->v).length2() <= (vloop[1]->v - vloop[3]->v).length2()) {
+         result.push_back(carve::triangulate::tri_idx(0,1,2));
+         result.push_back(carve::triangulate::tri_idx(0,2,3));
+      }
+      else {
+         result.push_back(carve::triangulate::tri_idx(0,1,3));
+         result.push_back(carve::triangulate::tri_idx(1,2,3));
+      }
+      return true;
+   }
+
+   for(size_t i=1; i+1<nv; i++) {
+      result.push_back(carve::triangulate::tri_idx(0,i,i+1));
+   }
+   return true;
+}
+
 #endif // CARVE_TRIANGULATE_H
@@ -54,7 +54,7 @@ std::vector<std::vector<size_t>> carve_triangulate_face::compute2d(const std::ve
    const int polySize   = 3; // defines maximum vertices per polygon (i.e. triangle)
    const int vertexSize = 2; // defines the number of coordinates in tesselation result vertex, must be 2 or 3.
 
-   create_tess();
+   if(!m_tess) create_tess();
 
    std::vector<std::vector<size_t>> tri_faces;
 
@@ -70,7 +70,10 @@ std::vector<std::vector<size_t>> carve_triangulate_face::compute2d(const std::ve
    // compute the Constrained Delaunay mesh for the face
    TESSreal* normalvec = 0; // normal automatically calculated
    bool success = (1 == tessTesselate(m_tess,TESS_WINDING_ODD,TESS_CONSTRAINED_DELAUNAY_TRIANGLES, polySize, vertexSize, normalvec));
-   if(!success) throw std::logic_error("carve_triangulate_face failed");
+   if(!success) {
+      delete_tess();
+      throw std::logic_error("carve_triangulate_face failed");
+   }
 
    // get the tesselation results
    const TESSreal* verts = tessGetVertices(m_tess);
@@ -113,9 +116,6 @@ std::vector<std::vector<size_t>> carve_triangulate_face::compute2d(const std::ve
 
    }
 
-   // cleanup
-   delete_tess();
-
    return std::move(tri_faces);
 }
 
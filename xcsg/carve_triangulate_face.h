@@ -17,6 +17,10 @@ public:
 
    void compute();
 
+   // triangulate another face. The tesselator is kept between faces, so one
+   // carve_triangulate_face can serve all faces handled by a thread
+   void compute(std::shared_ptr<spec> spec) { m_spec = spec; compute(); }
+
    // move_triangles is a destructive read
    std::vector<std::vector<size_t>> move_triangles() { return std::move(m_tri); }
 
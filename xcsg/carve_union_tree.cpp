@@ -0,0 +1,288 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "carve_union_tree.h"
+#include "carve_boolean.h"
+#include "boolean_timer.h"
+#include "thread_pool.h"
+#include <algorithm>
+
+carve_union_tree::carve_union_tree(safe_queue<MeshSet_ptr>& mesh_queue)
+{
+   std::vector<MeshSet_ptr> meshes;
+   mesh_queue.dequeue_all(meshes);
+   m_nodes.reserve(meshes.size());
+   for(auto& mesh : meshes) {
+      if(carve_boolean::is_empty(mesh)) {
+         throw std::runtime_error("ERROR: empty mesh component in boolean operation " + carve_boolean::boolean_type(carve::csg::CSG::UNION));
+      }
+      part p;
+      p.box    = xbox3d(*mesh);
+      p.nfaces = carve_boolean::face_count(mesh);
+      p.mesh   = std::move(mesh);
+      node n;
+      n.box    = p.box;
+      n.nfaces = p.nfaces;
+      n.parts.push_back(p);
+      m_nodes.push_back(std::move(n));
+   }
+}
+
+carve_union_tree::~carve_union_tree()
+{}
+
+carve_union_tree::MeshSet_ptr carve_union_tree::compute()
+{
+   if(m_nodes.size() == 0) return MeshSet_ptr();
+
+   // announce the estimated cost so progress and time estimates account for the larger booleans near the root
+   xbox3d box;
+   size_t nfaces = 0;
+   double cost = plan(m_nodes.begin(),m_nodes.end(),box,nfaces);
+   boolean_timer::singleton().add_planned(static_cast<int>(m_nodes.size()-1),cost);
+
+   // the parts are disjoint, so their union is their concatenation
+   node root = merge(m_nodes.begin(),m_nodes.end(),std::vector<xbox3d>());
+   if(root.parts.size() == 0) return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
+   if(root.parts.size() == 1) return root.parts[0].mesh;
+
+   std::vector<MeshSet_ptr> meshes;
+   meshes.reserve(root.parts.size());
+   for(auto& p : root.parts) meshes.push_back(p.mesh);
+   return carve_boolean::concatenate(meshes);
+}
+
+carve_union_tree::node_iterator carve_union_tree::split(node_iterator begin, node_iterator end)
+{
+   // split along the longest axis of the box centers
+   xbox3d centers;
+   size_t nfaces = 0;
+   for(auto it=begin; it!=end; it++) {
+      centers.enclose(it->box.center());
+      nfaces += it->nfaces;
+   }
+   xvertex extent = centers.p2() - centers.p1();
+   int axis = 0;
+   if(extent[1] > extent[axis]) axis = 1;
+   if(extent[2] > extent[axis]) axis = 2;
+
+   // plan and merge split the same ranges, the stable sort makes them agree
+   std::stable_sort(begin,end,[axis](const node& a, const node& b) { return a.box.center()[axis] < b.box.center()[axis]; });
+
+   // at the weighted median, both halves non-empty. With equal face counts this is the plain median
+   node_iterator middle = begin + 1;
+   size_t left = begin->nfaces;
+   while(middle+1 != end && 2*(left + middle->nfaces) <= nfaces) {
+      left += middle->nfaces;
+      middle++;
+   }
+   if(middle+1 != end && 2*left < nfaces && nfaces - 2*left > 2*(left + middle->nfaces) - nfaces) middle++;
+   return middle;
+}
+
+double carve_union_tree::plan(node_iterator begin, node_iterator end, xbox3d& box, size_t& nfaces)
+{
+   if(end - begin == 1) {
+      box    = begin->box;
+      nfaces = begin->nfaces;
+      return 0.0;
+   }
+
+   node_iterator middle = split(begin,end);
+   xbox3d left_box,right_box;
+   size_t left_faces=0,right_faces=0;
+   double cost = plan(begin,middle,left_box,left_faces) + plan(middle,end,right_box,right_faces);
+
+   // disjoint subtrees are concatenated at no boolean cost
+   if(left_box.intersects(right_box)) cost += boolean_timer::boolean_cost(left_faces,right_faces);
+
+   box = left_box;
+   box.enclose(right_box);
+   nfaces = left_faces + right_faces;
+   return cost;
+}
+
+carve_union_tree::node carve_union_tree::merge(node_iterator begin, node_iterator end, const std::vector<xbox3d>& outside) const
+{
+   // leaves are moved out of the tree, so each input mesh is released once it has been merged
+   size_t nnodes = end - begin;
+   if(nnodes == 1) {
+      node leaf = std::move(*begin);
+      release_final(leaf,outside);
+      return leaf;
+   }
+
+   node_iterator middle = split(begin,end);
+
+   // the half with fewer faces runs as a pool task, the larger half starts at once in this thread
+   size_t left_faces=0,right_faces=0;
+   xbox3d left_box,right_box;
+   for(auto it=begin; it!=middle; it++) { left_faces  += it->nfaces; left_box.enclose(it->box);  }
+   for(auto it=middle; it!=end; it++)   { right_faces += it->nfaces; right_box.enclose(it->box); }
+   node_iterator task_begin = begin,  task_end = middle;
+   node_iterator this_begin = middle, this_end = end;
+   std::vector<xbox3d> task_outside(outside),this_outside(outside);
+   if(m_part_function) {
+      task_outside.push_back(right_box);
+      this_outside.push_back(left_box);
+   }
+   if(left_faces > right_faces) {
+      std::swap(task_begin,this_begin);
+      std::swap(task_end,this_end);
+      std::swap(task_outside,this_outside);
+   }
+
+   node task_node,this_node;
+   thread_pool::task_group group;
+   thread_pool::singleton().submit(group,[this,&task_node,&task_outside,task_begin,task_end]() { task_node = merge(task_begin,task_end,task_outside); });
+   try {
+      this_node = merge(this_begin,this_end,this_outside);
+   }
+   catch(...) {
+      // the task refers to this stack frame, so it must complete first
+      try { thread_pool::singleton().wait(group); } catch(...) {}
+      throw;
+   }
+   thread_pool::singleton().wait(group);
+
+   node result = merge_pair(task_node,this_node);
+   release_final(result,outside);
+   return result;
+}
+
+void carve_union_tree::release_final(node& n, const std::vector<xbox3d>& outside) const
+{
+   if(!m_part_function) return;
+
+   std::vector<part> parts;
+   parts.swap(n.parts);
+   n.box    = xbox3d();
+   n.nfaces = 0;
+   for(part& p : parts) {
+      bool touched = false;
+      for(const xbox3d& box : outside) {
+         if(p.box.intersects(box)) { touched = true; break; }
+      }
+      if(touched) {
+         n.box.enclose(p.box);
+         n.nfaces += p.nfaces;
+         n.parts.push_back(std::move(p));
+      }
+      else m_part_function(std::move(p.mesh));
+   }
+}
+
+void carve_union_tree::find_overlaps(const std::vector<part>& a, const std::vector<part>& b, std::vector<bool>& a_hit, std::vector<bool>& b_hit)
+{
+   a_hit.assign(a.size(),false);
+   b_hit.assign(b.size(),false);
+
+   // sweep along x over the boxes of both lists, sorted by minimum x. Only boxes
+   // still open at the sweep position are tested against each other
+   struct item { double x; size_t index; bool in_a; };
+   std::vector<item> items;
+   items.reserve(a.size() + b.size());
+   for(size_t i=0; i<a.size(); i++) items.push_back({a[i].box.p1()[0],i,true});
+   for(size_t i=0; i<b.size(); i++) items.push_back({b[i].box.p1()[0],i,false});
+   std::sort(items.begin(),items.end(),[](const item& p, const item& q) { return p.x < q.x; });
+
+   std::vector<size_t> a_open,b_open;
+   for(const item& it : items) {
+      const std::vector<part>& mine   = (it.in_a)? a : b;
+      const std::vector<part>& others = (it.in_a)? b : a;
+      std::vector<size_t>&     open   = (it.in_a)? b_open : a_open;
+      std::vector<bool>&       hit    = (it.in_a)? a_hit : b_hit;
+      std::vector<bool>&       ohit   = (it.in_a)? b_hit : a_hit;
+
+      const xbox3d& box = mine[it.index].box;
+      size_t nopen = 0;
+      for(size_t j : open) {
+         if(others[j].box.p2()[0] < it.x) continue;   // closed, drop it
+         open[nopen++] = j;
+         if(box.intersects(others[j].box)) {
+            hit[it.index] = true;
+            ohit[j]       = true;
+         }
+      }
+      open.resize(nopen);
+      ((it.in_a)? a_open : b_open).push_back(it.index);
+   }
+}
+
+carve_union_tree::node carve_union_tree::merge_pair(node& a, node& b)
+{
+   node result;
+   result.box = a.box;
+   result.box.enclose(b.box);
+   result.nfaces = a.nfaces + b.nfaces;
+
+   std::vector<bool> a_hit,b_hit;
+   if(a.box.intersects(b.box)) find_overlaps(a.parts,b.parts,a_hit,b_hit);
+   else {
+      a_hit.assign(a.parts.size(),false);
+      b_hit.assign(b.parts.size(),false);
+   }
+
+   // parts overlapping nothing in the other node are carried over,
+   // the overlapping parts of each side go into one boolean
+   std::vector<MeshSet_ptr> a_meshes,b_meshes;
+   xbox3d hit_box;
+   result.parts.reserve(a.parts.size() + b.parts.size());
+   auto take_parts = [&result,&hit_box](std::vector<part>& parts, const std::vector<bool>& hit, std::vector<MeshSet_ptr>& meshes) {
+      for(size_t i=0; i<parts.size(); i++) {
+         if(hit[i]) {
+            hit_box.enclose(parts[i].box);
+            meshes.push_back(std::move(parts[i].mesh));
+         }
+         else {
+            result.parts.push_back(std::move(parts[i]));
+         }
+      }
+   };
+   take_parts(a.parts,a_hit,a_meshes);
+   take_parts(b.parts,b_hit,b_meshes);
+   a.parts.clear();
+   b.parts.clear();
+
+   if(a_meshes.empty()) {
+      // disjoint, no boolean required, but count it for progress reporting
+      boolean_timer::singleton().add_disjoint(true);
+      boolean_timer::singleton().add_elapsed(0.0);
+   }
+   else {
+      try {
+         carve_boolean csg;
+         csg.compute((a_meshes.size() == 1)? std::move(a_meshes[0]) : carve_boolean::concatenate(a_meshes),carve::csg::CSG::UNION);
+         csg.compute((b_meshes.size() == 1)? std::move(b_meshes[0]) : carve_boolean::concatenate(b_meshes),carve::csg::CSG::UNION);
+         a_meshes.clear();
+         b_meshes.clear();
+         csg.simplify();
+
+         // the result lies within the boxes of the parts that went into the boolean
+         part p;
+         p.box    = hit_box;
+         p.mesh   = csg.release();
+         p.nfaces = carve_boolean::face_count(p.mesh);
+         result.parts.push_back(std::move(p));
+
+         result.nfaces = 0;
+         for(auto& q : result.parts) result.nfaces += q.nfaces;
+      }
+      catch(carve::exception& ex) {
+         throw std::runtime_error("(carve error): " + ex.str());
+      }
+   }
+   return result;
+}
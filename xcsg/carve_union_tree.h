@@ -0,0 +1,101 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef CARVE_UNION_TREE_H
+#define CARVE_UNION_TREE_H
+
+#include <functional>
+#include <memory>
+#include <vector>
+#include <carve/csg.hpp>
+#include "safe_queue.h"
+#include "xbox3d.h"
+
+// carve_union_tree computes the union of many meshes in a spatially aware order.
+// The meshes are arranged in a bounding volume hierarchy, built by splitting along the longest
+// axis so that both halves hold about the same number of faces, so neighbouring meshes are merged
+// first and intermediate results stay small. As in Huffman coding, small meshes end up deep in the
+// tree and are merged with each other first, while a mesh much larger than the rest sits near the
+// root and goes into a single boolean instead of being merged again at every level.
+//
+// A merged subtree is kept as a list of disjoint parts rather than one mesh. When two subtrees
+// are merged, only the parts whose bounding boxes overlap a part of the other subtree go into
+// the boolean, the other parts are carried over unchanged. The parts are concatenated into one
+// mesh once, at the root, instead of at every level of the tree.
+// Independent subtrees are evaluated as thread_pool tasks, the subtree
+// with the most faces runs first in the calling thread as it is likely on the critical path.
+//
+// With a part function, the union is streamed: a part whose box touches no mesh outside its
+// subtree can not change any more, so it is passed to the function and released as soon as its
+// subtree is merged. Isolated meshes are passed on before any boolean runs. The root then keeps
+// no parts, and compute returns an empty mesh set.
+
+class carve_union_tree {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   // receives a final part of a streamed union, called from thread_pool tasks, possibly concurrently
+   typedef std::function<void(MeshSet_ptr part)> part_function;
+
+   // the meshes are taken from mesh_queue, which is empty afterwards
+   carve_union_tree(safe_queue<MeshSet_ptr>& mesh_queue);
+   virtual ~carve_union_tree();
+
+   // stream the final parts to f, see above. Must be set before compute
+   void set_part_function(part_function f) { m_part_function = f; }
+
+   // compute the union of all meshes
+   MeshSet_ptr compute();
+
+private:
+   // a part does not share any volume with the other parts of its node
+   struct part {
+      xbox3d      box;
+      MeshSet_ptr mesh;
+      size_t      nfaces;
+   };
+
+   struct node {
+      xbox3d            box;      // box of all parts
+      size_t            nfaces;   // faces of all parts
+      std::vector<part> parts;
+   };
+   typedef std::vector<node>::iterator node_iterator;
+
+   // order [begin,end) along the longest axis and return the middle, splitting the faces evenly
+   static node_iterator split(node_iterator begin, node_iterator end);
+
+   // estimate the boolean cost of merging [begin,end), returning the box and face count of the result
+   static double plan(node_iterator begin, node_iterator end, xbox3d& box, size_t& nfaces);
+
+   // merge the nodes in [begin,end) and return the merged node. outside holds the
+   // boxes of the sibling subtrees on the path to the root, when streaming
+   node merge(node_iterator begin, node_iterator end, const std::vector<xbox3d>& outside) const;
+
+   // pass the parts of n touching none of the outside boxes to the part function and remove them from n
+   void release_final(node& n, const std::vector<xbox3d>& outside) const;
+
+   // merge two nodes, the parts of a and b are moved to the result
+   static node merge_pair(node& a, node& b);
+
+   // flag the parts of a and b whose boxes overlap a part of the other list
+   static void find_overlaps(const std::vector<part>& a, const std::vector<part>& b, std::vector<bool>& a_hit, std::vector<bool>& b_hit);
+
+private:
+   std::vector<node> m_nodes;
+   part_function     m_part_function;
+};
+
+#endif // CARVE_UNION_TREE_H
@@ -0,0 +1,175 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "char_buffer.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <cstring>
+
+// std::to_chars requires C++17, floating point support came later in some standard libraries
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <charconv>
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+#define CHAR_BUFFER_FLOAT_TO_CHARS
+#endif
+#endif
+
+char_buffer::char_buffer(size_t capacity)
+{
+   m_buf.reserve(capacity);
+}
+
+char_buffer::~char_buffer()
+{}
+
+char_buffer& char_buffer::append(const char* s)
+{
+   m_buf.insert(m_buf.end(),s,s+std::strlen(s));
+   return *this;
+}
+
+char_buffer& char_buffer::append(size_t value)
+{
+   // digits are produced in reverse order
+   char tmp[24];
+   char* p = tmp+sizeof(tmp);
+   do {
+      *--p = static_cast<char>('0' + value%10);
+      value /= 10;
+   } while(value > 0);
+   m_buf.insert(m_buf.end(),p,tmp+sizeof(tmp));
+   return *this;
+}
+
+char_buffer& char_buffer::append(int value)
+{
+   if(value < 0) {
+      m_buf.push_back('-');
+      return append(static_cast<size_t>(-static_cast<long long>(value)));
+   }
+   return append(static_cast<size_t>(value));
+}
+
+char* char_buffer::format(char* first, char* last, double value)
+{
+#ifdef CHAR_BUFFER_FLOAT_TO_CHARS
+   return std::to_chars(first,last,value).ptr;
+#else
+   // 17 significant digits always round-trip
+   int n = std::snprintf(first,last-first,"%.17g",value);
+   return first + n;
+#endif
+}
+
+std::string char_buffer::to_string(double value)
+{
+   char tmp[32];
+   return std::string(tmp,format(tmp,tmp+sizeof(tmp),value));
+}
+
+char_buffer& char_buffer::append(double value)
+{
+   char tmp[32];
+   m_buf.insert(m_buf.end(),tmp,format(tmp,tmp+sizeof(tmp),value));
+   return *this;
+}
+
+char_buffer& char_buffer::append_xml(const std::string& text)
+{
+   for(char c : text) {
+      switch(c) {
+         case '&':  { append("&amp;"); break; }
+         case '<':  { append("&lt;"); break; }
+         case '>':  { append("&gt;"); break; }
+         case '"':  { append("&quot;"); break; }
+         case '\'': { append("&apos;"); break; }
+         default:   { m_buf.push_back(c); break; }
+      };
+   }
+   return *this;
+}
+
+char_buffer& char_buffer::append(const void* data, size_t nbytes)
+{
+   const char* p = static_cast<const char*>(data);
+   m_buf.insert(m_buf.end(),p,p+nbytes);
+   return *this;
+}
+
+char_buffer& char_buffer::append(double value, int precision)
+{
+   char tmp[32];
+#ifdef CHAR_BUFFER_FLOAT_TO_CHARS
+   std::to_chars_result res = std::to_chars(tmp,tmp+sizeof(tmp),value,std::chars_format::general,precision);
+   m_buf.insert(m_buf.end(),tmp,res.ptr);
+#else
+   // standard library without floating point to_chars
+   int n = std::snprintf(tmp,sizeof(tmp),"%.*g",precision,value);
+   m_buf.insert(m_buf.end(),tmp,tmp+n);
+#endif
+   return *this;
+}
+
+bool char_buffer::flush(FILE* file)
+{
+   size_t nbytes = m_buf.size();
+   bool ok = (nbytes == 0) || (std::fwrite(m_buf.data(),1,nbytes,file) == nbytes);
+   m_buf.clear();
+   return ok;
+}
+
+bool char_buffer::flush(std::ostream& out)
+{
+   out.write(m_buf.data(),m_buf.size());
+   m_buf.clear();
+   return out.good();
+}
+
+bool char_buffer::write_ordered(size_t nchunks,
+                                std::function<void(size_t ichunk, char_buffer& out)> encode,
+                                std::function<bool(char_buffer& out)> write)
+{
+   // a single chunk is encoded by the caller
+   if(nchunks == 1) {
+      char_buffer out;
+      encode(0,out);
+      return write(out);
+   }
+
+   bool ok = true;
+   const size_t nbatch = 2*thread_pool::singleton().nthreads();
+   std::vector<char_buffer> buffers(std::min(nbatch,nchunks));
+   for(size_t ibegin=0; ibegin<nchunks; ibegin+=nbatch) {
+      size_t iend = std::min(nchunks,ibegin+nbatch);
+
+      thread_pool::task_group group;
+      for(size_t ichunk=ibegin; ichunk<iend; ichunk++) {
+         char_buffer& buffer = buffers[ichunk-ibegin];
+         thread_pool::singleton().submit(group,[&encode,&buffer,ichunk]() { encode(ichunk,buffer); });
+      }
+      thread_pool::singleton().wait(group);
+
+      for(size_t ichunk=ibegin; ichunk<iend; ichunk++) {
+         ok = write(buffers[ichunk-ibegin]) && ok;
+      }
+   }
+   return ok;
+}
+
+std::ostream& operator<<(std::ostream& out, const format_double& f)
+{
+   char tmp[32];
+   return out.write(tmp,char_buffer::format(tmp,tmp+sizeof(tmp),f.value)-tmp);
+}
@@ -0,0 +1,88 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef CHAR_BUFFER_H
+#define CHAR_BUFFER_H
+
+#include <cstdio>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// char_buffer is a growable character buffer for text export, shared by all text exporters.
+// Numbers are formatted without iostreams and independent of the current locale.
+// Doubles are by default written in the shortest form that reads back to the same value.
+// The buffer is written to file in one call to fwrite.
+
+class char_buffer {
+public:
+   char_buffer(size_t capacity = 0);
+   virtual ~char_buffer();
+
+   char_buffer& append(char c)                { m_buf.push_back(c); return *this; }
+   char_buffer& append(const char* s);
+   char_buffer& append(const std::string& s)  { m_buf.insert(m_buf.end(),s.begin(),s.end()); return *this; }
+   char_buffer& append(size_t value);
+   char_buffer& append(int value);
+
+   // append double in shortest round-trip form
+   char_buffer& append(double value);
+
+   // append text with the characters that have special meaning in xml escaped
+   char_buffer& append_xml(const std::string& text);
+
+   // append raw bytes, for binary formats
+   char_buffer& append(const void* data, size_t nbytes);
+
+   // append double with given number of significant digits, same as printf "%.*g"
+   char_buffer& append(double value, int precision);
+
+   size_t      size() const { return m_buf.size(); }
+   const char* data() const { return m_buf.data(); }
+   void        clear()      { m_buf.clear(); }
+
+   // write buffer contents to file and clear the buffer. Returns false on write error
+   bool flush(FILE* file);
+   bool flush(std::ostream& out);
+
+   // format double in shortest round-trip form into [first,last), returns end of written text
+   static char* format(char* first, char* last, double value);
+
+   // return double in shortest round-trip form as string
+   static std::string to_string(double value);
+
+   // encode chunks [0,nchunks) in parallel on the thread pool, a batch at a time, and pass the
+   // buffers to write in chunk order. write must clear the buffer, returns false on write error
+   static bool write_ordered(size_t nchunks,
+                             std::function<void(size_t ichunk, char_buffer& out)> encode,
+                             std::function<bool(char_buffer& out)> write);
+
+   // buffer size at which large files are written, so they are written in big blocks
+   static const size_t flush_size = 1<<20;
+
+private:
+   std::vector<char> m_buf;
+};
+
+// allows a double to be written to a std::ostream using char_buffer formatting
+//    out << format_double(value);
+struct format_double {
+   explicit format_double(double v) : value(v) {}
+   double value;
+};
+std::ostream& operator<<(std::ostream& out, const format_double& f);
+
+#endif // CHAR_BUFFER_H
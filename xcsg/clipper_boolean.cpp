@@ -16,7 +16,16 @@
 #include "clipper_boolean.h"
 
 #include "boolean_timer.h"
+#include "thread_pool.h"
+#include "mesh_utils.h"
+#include "clipper_csg/tmesh_adapter.h"
 #include <boost/date_time.hpp>
+#include <algorithm>
+#include <cmath>
+#include <map>
+
+clipper_boolean::minkowski_strategy clipper_boolean::m_minkowski_strategy = clipper_boolean::minkowski_clipper;
+double clipper_boolean::m_simplify_fraction = 0.0;
 
 clipper_boolean::clipper_boolean()
 {}
@@ -68,8 +77,17 @@ bool clipper_boolean::minkowski_sum(std::shared_ptr<clipper_profile> a, std::sha
 
    ClipperLib::Path& pattern = b_paths[0];
    std::shared_ptr<clipper_profile> result(new clipper_profile);
-   bool pathIsClosed = true;
-   ClipperLib::MinkowskiSum(pattern,a_paths,result->paths(),pathIsClosed);
+   if(a_paths.size() == 1 && is_convex(a_paths[0]) && is_convex(pattern)) {
+      result->paths().resize(1);
+      convex_minkowski_sum(a_paths[0],pattern,result->paths()[0]);
+   }
+   else if(m_minkowski_strategy == minkowski_convex) {
+      decomposed_minkowski_sum(a,b_brush,result->paths());
+   }
+   else {
+      bool pathIsClosed = true;
+      ClipperLib::MinkowskiSum(pattern,a_paths,result->paths(),pathIsClosed);
+   }
    bool success = result->paths().size() > 0;
    if(success) {
       ClipperLib::CleanPolygons(result->paths());
@@ -84,6 +102,332 @@ bool clipper_boolean::minkowski_sum(std::shared_ptr<clipper_profile> a, std::sha
    return success;
 }
 
+bool clipper_boolean::is_convex(const ClipperLib::Path& path)
+{
+   const size_t n = path.size();
+   if(n < 3) return false;
+
+   // all turns must have the same sign, and the edge directions may
+   // change sign in x at most twice, otherwise the polygon winds more than once
+   int turn = 0;
+   int xsign_changes = 0;
+   int prev_xsign = 0;
+   int first_xsign = 0;
+   for(size_t i=0; i<n; i++) {
+      const ClipperLib::IntPoint& p0 = path[i];
+      const ClipperLib::IntPoint& p1 = path[(i+1)%n];
+      const ClipperLib::IntPoint& p2 = path[(i+2)%n];
+      double cross = double(p1.X-p0.X)*double(p2.Y-p1.Y) - double(p1.Y-p0.Y)*double(p2.X-p1.X);
+      int sign = (cross > 0.0)? 1 : ((cross < 0.0)? -1 : 0);
+      if(sign != 0) {
+         if(turn == 0) turn = sign;
+         else if(sign != turn) return false;
+      }
+
+      ClipperLib::cInt dx = p1.X-p0.X;
+      int xsign = (dx > 0)? 1 : ((dx < 0)? -1 : 0);
+      if(xsign != 0) {
+         if(first_xsign == 0) first_xsign = xsign;
+         else if(xsign != prev_xsign) xsign_changes++;
+         prev_xsign = xsign;
+      }
+   }
+   if(prev_xsign != first_xsign) xsign_changes++;
+
+   return turn != 0 && xsign_changes <= 2;
+}
+
+void clipper_boolean::convex_minkowski_sum(const ClipperLib::Path& a, const ClipperLib::Path& b, ClipperLib::Path& result)
+{
+   // both paths in positive orientation without repeated points, starting at the lowest point
+   auto prepare = [](const ClipperLib::Path& path) {
+      ClipperLib::Path p(path);
+      p.erase(std::unique(p.begin(),p.end()),p.end());
+      while(p.size() > 1 && p.front() == p.back()) p.pop_back();
+      if(!ClipperLib::Orientation(p)) std::reverse(p.begin(),p.end());
+      size_t ilow = 0;
+      for(size_t i=1; i<p.size(); i++) {
+         if(p[i].Y < p[ilow].Y || (p[i].Y == p[ilow].Y && p[i].X < p[ilow].X)) ilow = i;
+      }
+      std::rotate(p.begin(),p.begin()+ilow,p.end());
+      p.push_back(p[0]);
+      p.push_back(p[1]);
+      return p;
+   };
+   ClipperLib::Path p = prepare(a);
+   ClipperLib::Path q = prepare(b);
+   const size_t n = p.size()-2;
+   const size_t m = q.size()-2;
+
+   result.clear();
+   result.reserve(n+m);
+   size_t i=0,j=0;
+   while(i<n || j<m) {
+      result.push_back(ClipperLib::IntPoint(p[i].X+q[j].X, p[i].Y+q[j].Y));
+      double cross = double(p[i+1].X-p[i].X)*double(q[j+1].Y-q[j].Y) - double(p[i+1].Y-p[i].Y)*double(q[j+1].X-q[j].X);
+      if(cross >= 0.0 && i<n) i++;
+      if(cross <= 0.0 && j<m) j++;
+   }
+}
+
+void clipper_boolean::convex_pieces(std::shared_ptr<clipper_profile> profile, std::vector<ClipperLib::Path>& pieces)
+{
+   pieces.clear();
+   tmesh_adapter tess;
+   if(!tess.tesselate(profile->create_polyset())) {
+      throw std::logic_error("clipper_boolean::convex_pieces, triangulation failed");
+   }
+   std::shared_ptr<polymesh2d> mesh = tess.mesh();
+
+   std::vector<ClipperLib::IntPoint> vert(mesh->nvertices());
+   for(size_t i=0; i<vert.size(); i++) {
+      const dpos2d& p = mesh->vertex(i);
+      vert[i] = ClipperLib::IntPoint(ClipperLib::cInt(std::llround(p.x()*TO_CLIPPER)),ClipperLib::cInt(std::llround(p.y()*TO_CLIPPER)));
+   }
+   auto cross = [&vert](size_t i0, size_t i1, size_t i2) {
+      const ClipperLib::IntPoint& p0 = vert[i0];
+      const ClipperLib::IntPoint& p1 = vert[i1];
+      const ClipperLib::IntPoint& p2 = vert[i2];
+      return double(p1.X-p0.X)*double(p2.Y-p1.Y) - double(p1.Y-p0.Y)*double(p2.X-p1.X);
+   };
+
+   // triangles in positive orientation, and the owner of each directed edge
+   std::vector<std::vector<size_t>> polys;
+   std::map<std::pair<size_t,size_t>,size_t> edge_owner;
+   for(auto& face : mesh->faces()) {
+      std::vector<size_t> poly(face);
+      double c = cross(poly[0],poly[1],poly[2]);
+      if(c == 0.0) continue;
+      if(c < 0.0) std::reverse(poly.begin(),poly.end());
+      for(size_t k=0; k<poly.size(); k++) edge_owner[std::make_pair(poly[k],poly[(k+1)%poly.size()])] = polys.size();
+      polys.push_back(poly);
+   }
+
+   // merge polygons across shared edges while both edge end points stay convex
+   std::vector<bool> alive(polys.size(),true);
+   for(size_t ip=0; ip<polys.size(); ip++) {
+      bool merged = true;
+      while(merged) {
+         merged = false;
+         std::vector<size_t>& p = polys[ip];
+         for(size_t k=0; k<p.size() && !merged; k++) {
+            size_t u = p[k];
+            size_t v = p[(k+1)%p.size()];
+            auto it = edge_owner.find(std::make_pair(v,u));
+            if(it == edge_owner.end() || it->second == ip) continue;
+            size_t iq = it->second;
+            std::vector<size_t>& q = polys[iq];
+            size_t kq = std::find(q.begin(),q.end(),v) - q.begin();
+
+            // p from v around to u, then q from u around to v excluding both
+            std::vector<size_t> m;
+            m.reserve(p.size()+q.size()-2);
+            for(size_t i=0; i<p.size(); i++) m.push_back(p[(k+1+i)%p.size()]);
+            for(size_t i=2; i<q.size(); i++) m.push_back(q[(kq+i)%q.size()]);
+
+            // the turns at u and v are the only ones changed, u is at p.size()-1 and v at 0
+            size_t nm = m.size();
+            size_t iu = p.size()-1;
+            if(cross(m[iu-1],m[iu],m[(iu+1)%nm]) < 0.0) continue;
+            if(cross(m[nm-1],m[0],m[1]) < 0.0) continue;
+
+            edge_owner.erase(std::make_pair(u,v));
+            edge_owner.erase(it);
+            for(size_t i=0; i<q.size(); i++) {
+               auto jt = edge_owner.find(std::make_pair(q[i],q[(i+1)%q.size()]));
+               if(jt != edge_owner.end() && jt->second == iq) jt->second = ip;
+            }
+            q.clear();
+            alive[iq] = false;
+            p.swap(m);
+            merged = true;
+         }
+      }
+   }
+
+   for(size_t ip=0; ip<polys.size(); ip++) {
+      if(!alive[ip]) continue;
+      ClipperLib::Path path;
+      path.reserve(polys[ip].size());
+      for(size_t i : polys[ip]) path.push_back(vert[i]);
+      pieces.push_back(std::move(path));
+   }
+}
+
+void clipper_boolean::decomposed_minkowski_sum(std::shared_ptr<clipper_profile> a, std::shared_ptr<clipper_profile> b, ClipperLib::Paths& result)
+{
+   std::vector<ClipperLib::Path> a_pieces,b_pieces;
+   convex_pieces(a,a_pieces);
+   convex_pieces(b,b_pieces);
+
+   // pairwise sums of pieces, computed per piece of a
+   std::vector<ClipperLib::Paths> sums(a_pieces.size());
+   thread_pool::task_group group;
+   for(size_t i=0; i<a_pieces.size(); i++) {
+      thread_pool::singleton().submit(group,[&a_pieces,&b_pieces,&sums,i]() {
+         sums[i].resize(b_pieces.size());
+         for(size_t j=0; j<b_pieces.size(); j++) convex_minkowski_sum(a_pieces[i],b_pieces[j],sums[i][j]);
+      });
+   }
+   thread_pool::singleton().wait(group);
+
+   // all sums have positive orientation
+   ClipperLib::Clipper clipper;
+   for(auto& s : sums) clipper.AddPaths(s,ClipperLib::ptSubject,true);
+   result.clear();
+   if(!clipper.Execute(ClipperLib::ctUnion, result, ClipperLib::pftNonZero, ClipperLib::pftNonZero)) {
+      throw std::logic_error("clipper_boolean::minkowski_sum, union of convex sums failed");
+   }
+}
+
+ClipperLib::Paths clipper_boolean::normalized_paths(std::shared_ptr<clipper_profile> profile)
+{
+   ClipperLib::Paths paths;
+   ClipperLib::SimplifyPolygons(profile->paths(),paths,ClipperLib::pftNonZero);
+   return paths;
+}
+
+std::shared_ptr<clipper_profile> clipper_boolean::union_normalized(const std::vector<ClipperLib::Paths>& paths)
+{
+   boost::posix_time::ptime p1 = boost::posix_time::microsec_clock::universal_time();
+
+   // with normalized inputs the winding number counts the profiles covering a point
+   ClipperLib::Clipper clipper;
+   for(auto& p : paths) clipper.AddPaths(p,ClipperLib::ptSubject,true);
+   std::shared_ptr<clipper_profile> result(new clipper_profile);
+   if(!clipper.Execute(ClipperLib::ctUnion, result->paths(), ClipperLib::pftNonZero, ClipperLib::pftNonZero)) {
+      throw std::logic_error("clipper_boolean::union_all, operation failed");
+   }
+   ClipperLib::CleanPolygons(result->paths());
+
+   boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - p1;
+   double elapsed_sec = 0.001*ptime_diff.total_milliseconds();
+
+   // one execute replaces paths.size()-1 booleans, count them all for progress reporting
+   boolean_timer::singleton().add_elapsed(elapsed_sec);
+   for(size_t i=2; i<paths.size(); i++) boolean_timer::singleton().add_elapsed(0.0);
+
+   return result;
+}
+
+std::shared_ptr<clipper_profile> clipper_boolean::union_all(const std::vector<std::shared_ptr<clipper_profile>>& profiles)
+{
+   if(profiles.size() == 0) return std::shared_ptr<clipper_profile>();
+   if(profiles.size() == 1) return profiles[0];
+
+   std::vector<ClipperLib::Paths> paths;
+   paths.reserve(profiles.size());
+   for(auto& p : profiles) paths.push_back(normalized_paths(p));
+   return union_normalized(paths);
+}
+
+std::shared_ptr<clipper_profile> clipper_boolean::fill_all(const std::vector<std::shared_ptr<clipper_profile>>& profiles)
+{
+   if(profiles.size() == 0) return std::shared_ptr<clipper_profile>();
+
+   std::vector<ClipperLib::Paths> paths;
+   paths.reserve(profiles.size());
+   bool holes = false;
+   for(auto& profile : profiles) {
+      ClipperLib::Paths& pp = profile->paths();
+
+      // the largest path is an outer path, holes have the opposite orientation
+      std::vector<double> area(pp.size());
+      size_t ilargest = 0;
+      for(size_t i=0; i<pp.size(); i++) {
+         area[i] = ClipperLib::Area(pp[i]);
+         if(std::fabs(area[i]) > std::fabs(area[ilargest])) ilargest = i;
+      }
+      bool positive = (pp.size() == 0) || area[ilargest] >= 0.0;
+
+      // outer paths are given positive orientation, so that they add up in the union
+      ClipperLib::Paths outer;
+      outer.reserve(pp.size());
+      for(size_t i=0; i<pp.size(); i++) {
+         if((area[i] >= 0.0) != positive) { holes = true; continue; }
+         outer.push_back(pp[i]);
+         if(!positive) std::reverse(outer.back().begin(),outer.back().end());
+      }
+      paths.push_back(std::move(outer));
+   }
+
+   // islands inside holes are contained in an outer path, the union removes them
+   if(profiles.size() == 1 && !holes) return profiles[0];
+   return union_normalized(paths);
+}
+
+void clipper_boolean::for_each(size_t n, const std::function<void(size_t i)>& f, weight_function weight)
+{
+   thread_pool::task_group group;
+   for(size_t begin=0; begin<n; ) {
+      // light items are grouped until the group is worth a task
+      size_t end = begin+1;
+      if(weight) {
+         size_t sum = weight(begin);
+         while(end < n && sum < task_weight) sum += weight(end++);
+      }
+      thread_pool::singleton().submit(group,[&f,begin,end]() { for(size_t i=begin; i<end; i++) f(i); });
+      begin = end;
+   }
+   thread_pool::singleton().wait(group);
+}
+
+std::vector<std::shared_ptr<clipper_profile>> clipper_boolean::create_all(size_t n, profile_function profile, weight_function weight)
+{
+   std::vector<std::shared_ptr<clipper_profile>> profiles(n);
+   for_each(n,[&profiles,&profile](size_t i) { profiles[i] = profile(i); },weight);
+   return profiles;
+}
+
+std::shared_ptr<clipper_profile> clipper_boolean::reduce(size_t n, profile_function profile, ClipperLib::ClipType op, weight_function weight)
+{
+   if(n == 0) return std::shared_ptr<clipper_profile>();
+   if(n == 1) return profile(0);
+
+   if(op == ClipperLib::ctUnion) {
+      // create and normalize the profiles in parallel, then union them in one pass
+      std::vector<ClipperLib::Paths> paths(n);
+      for_each(n,[&paths,&profile](size_t i) { paths[i] = normalized_paths(profile(i)); },weight);
+      return union_normalized(paths);
+   }
+
+   std::vector<size_t> weight_sum(n+1,0);
+   for(size_t i=0; i<n; i++) weight_sum[i+1] = weight_sum[i] + ((weight)? weight(i) : task_weight);
+   return reduce(0,n,profile,op,weight_sum);
+}
+
+std::shared_ptr<clipper_profile> clipper_boolean::reduce(size_t begin, size_t end, const profile_function& profile, ClipperLib::ClipType op, const std::vector<size_t>& weight_sum)
+{
+   if(end - begin == 1) return profile(begin);
+
+   // a light range is combined in order in this thread
+   if(weight_sum[end] - weight_sum[begin] < task_weight) {
+      clipper_boolean csg;
+      for(size_t i=begin; i<end; i++) csg.compute(profile(i),op);
+      return csg.profile();
+   }
+
+   // the left half runs as a pool task, the right half in this thread
+   size_t middle = begin + (end - begin)/2;
+   std::shared_ptr<clipper_profile> a,b;
+   thread_pool::task_group group;
+   thread_pool::singleton().submit(group,[&a,&profile,&weight_sum,begin,middle,op]() { a = reduce(begin,middle,profile,op,weight_sum); });
+   try {
+      b = reduce(middle,end,profile,op,weight_sum);
+   }
+   catch(...) {
+      // the left task refers to this stack frame, so it must complete first
+      try { thread_pool::singleton().wait(group); } catch(...) {}
+      throw;
+   }
+   thread_pool::singleton().wait(group);
+
+   clipper_boolean csg;
+   csg.compute(a,op);
+   csg.compute(b,op);
+   return csg.profile();
+}
+
 void clipper_boolean::sort()
 {
    m_profile->sort();
@@ -93,3 +437,11 @@ std::shared_ptr<clipper_profile> clipper_boolean::profile()
 {
    return m_profile;
 }
+
+std::shared_ptr<clipper_profile> clipper_boolean::simplify(std::shared_ptr<clipper_profile> profile)
+{
+   if(m_simplify_fraction <= 0.0 || !profile.get()) return profile;
+
+   profile->simplify(m_simplify_fraction*mesh_utils::secant_tolerance()*TO_CLIPPER);
+   return profile;
+}
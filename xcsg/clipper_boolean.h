@@ -17,10 +17,37 @@
 #define CLIPPER_BOOLEAN_H
 
 #include "clipper_csg/clipper_profile.h"
+#include <functional>
 #include <memory>
+#include <vector>
 
 class clipper_boolean {
 public:
+   typedef std::function<std::shared_ptr<clipper_profile>(size_t i)> profile_function;
+
+   // relative cost of creating profile i, normally the number of booleans in its subtree plus one
+   typedef std::function<size_t(size_t i)> weight_function;
+
+   // items of less total weight than this are evaluated in one task or in the calling thread
+   static const size_t task_weight = 8;
+
+   // engine used by minkowski_sum when an operand is not convex
+   enum minkowski_strategy {
+      minkowski_clipper,  // ClipperLib::MinkowskiSum, one quad per edge pair
+      minkowski_convex    // sum of convex pieces from a triangulation of both operands
+   };
+   static void set_minkowski_strategy(minkowski_strategy strategy) { m_minkowski_strategy = strategy; }
+   static minkowski_strategy get_minkowski_strategy() { return m_minkowski_strategy; }
+
+   // simplification of 2d boolean results, see simplify(). The arrow tolerance is given as a
+   // fraction of the secant tolerance, so that curves keep their accuracy. 0 (default) disables it
+   static void set_simplify(double fraction) { m_simplify_fraction = fraction; }
+   static double simplify_fraction() { return m_simplify_fraction; }
+
+   // remove vertices that are closer than the simplify tolerance to the line between their
+   // neighbours, in place. Returns profile, unchanged if simplification is disabled
+   static std::shared_ptr<clipper_profile> simplify(std::shared_ptr<clipper_profile> profile);
+
    clipper_boolean();
    virtual ~clipper_boolean();
 
@@ -34,10 +61,58 @@ public:
    std::shared_ptr<clipper_profile> profile();
 
    // compute minkowski sum of a and b_brush
-   // a is assumed to be the main object and "b_brush" is "brushed" along the a path
+   // a is assumed to be the main object and "b_brush" is "brushed" along the a path.
+   // When both are single convex paths the sum is computed directly by merging their edges
    bool minkowski_sum(std::shared_ptr<clipper_profile> a, std::shared_ptr<clipper_profile> b_brush );
 
+   // union of all profiles in a single Clipper execute
+   static std::shared_ptr<clipper_profile> union_all(const std::vector<std::shared_ptr<clipper_profile>>& profiles);
+
+   // union of the outer paths of all profiles with their holes removed, in a single Clipper execute.
+   // The outer paths of a profile are those with the orientation of its largest path, so the
+   // paths of each profile are only filtered, not resolved by a Clipper execute of their own
+   static std::shared_ptr<clipper_profile> fill_all(const std::vector<std::shared_ptr<clipper_profile>>& profiles);
+
+   // call f(i) for i in [0,n) as thread_pool tasks and wait for them. Consecutive items with
+   // a total weight below task_weight share one task. Without weight every item is a task
+   static void for_each(size_t n, const std::function<void(size_t i)>& f, weight_function weight = weight_function());
+
+   // create n profiles concurrently, see for_each
+   static std::vector<std::shared_ptr<clipper_profile>> create_all(size_t n, profile_function profile, weight_function weight = weight_function());
+
+   // combine n profiles with op. profile(i) creates profile i, it is called from thread_pool tasks.
+   // Unions are computed in a single pass by union_all, other operations in a balanced
+   // tree where subtrees are evaluated as thread_pool tasks, unless they weigh less than task_weight
+   static std::shared_ptr<clipper_profile> reduce(size_t n, profile_function profile, ClipperLib::ClipType op, weight_function weight = weight_function());
+
+private:
+   // true if path is a simple convex polygon, collinear points allowed
+   static bool is_convex(const ClipperLib::Path& path);
+
+   // minkowski sum of two convex paths, merging the edges in angular order
+   static void convex_minkowski_sum(const ClipperLib::Path& a, const ClipperLib::Path& b, ClipperLib::Path& result);
+
+   // decompose a profile into convex pieces by triangulating it and merging
+   // adjacent triangles as long as the result stays convex
+   static void convex_pieces(std::shared_ptr<clipper_profile> profile, std::vector<ClipperLib::Path>& pieces);
+
+   // minkowski sum as the union of pairwise sums of convex pieces
+   static void decomposed_minkowski_sum(std::shared_ptr<clipper_profile> a, std::shared_ptr<clipper_profile> b, ClipperLib::Paths& result);
+
+   // weight_sum[i] is the total weight of profiles [0,i)
+   static std::shared_ptr<clipper_profile> reduce(size_t begin, size_t end, const profile_function& profile, ClipperLib::ClipType op, const std::vector<size_t>& weight_sum);
+
+   // return the paths of profile resolved with the non-zero fill rule, so that outer paths
+   // have positive orientation and holes negative. Profiles in this form can share
+   // one union execute without their winding numbers cancelling each other
+   static ClipperLib::Paths normalized_paths(std::shared_ptr<clipper_profile> profile);
+
+   // union of paths already normalized
+   static std::shared_ptr<clipper_profile> union_normalized(const std::vector<ClipperLib::Paths>& paths);
+
 private:
+   static minkowski_strategy         m_minkowski_strategy;
+   static double                     m_simplify_fraction;
    std::shared_ptr<clipper_profile>  m_profile;
 };
 
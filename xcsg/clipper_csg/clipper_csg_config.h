@@ -17,6 +17,12 @@
 #define CLIPPER_CSG_CONFIG_H_INCLUDED
 
 #include "clipper.hpp"
+
+// Scale from model units to Clipper integer coordinates, a resolution of 1/65536 unit.
+// Each Clipper operation range tests its input: while all coordinates are within
+// ClipperLib::loRange (0x3FFFFFFF, about 16384 model units at this scale) the slope tests
+// use 64-bit products, and only operations on larger coordinates fall back to Int128.
+// The scale is the same for all operations, since profiles are passed between them unconverted
 const ClipperLib::cInt TO_CLIPPER = (1 << 16);
 
 #ifdef _MSC_VER
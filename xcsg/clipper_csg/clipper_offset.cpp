@@ -14,8 +14,140 @@
 // EndLicense:
 
 #include "clipper_offset.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <numeric>
+#include <unordered_map>
 using namespace std;
 
+namespace {
+
+   struct offset_box {
+      offset_box() : x1(0), y1(0), x2(0), y2(0), empty(true) {}
+      explicit offset_box(const ClipperLib::Paths& paths) : x1(0), y1(0), x2(0), y2(0), empty(true)
+      {
+         for(auto& path : paths) {
+            for(auto& p : path) {
+               if(empty) { x1 = x2 = p.X; y1 = y2 = p.Y; empty = false; }
+               else {
+                  x1 = std::min(x1,p.X); x2 = std::max(x2,p.X);
+                  y1 = std::min(y1,p.Y); y2 = std::max(y2,p.Y);
+               }
+            }
+         }
+      }
+      bool overlaps_y(const offset_box& b) const { return y1<=b.y2 && b.y1<=y2; }
+
+      ClipperLib::cInt x1,y1,x2,y2;
+      bool empty;
+   };
+
+   // offset_cache holds recent offset results. Entries are found by hash and confirmed by
+   // comparing the input paths, the oldest entries are dropped when the point limit is exceeded
+   struct offset_cache {
+      struct entry {
+         ClipperLib::Paths    input;
+         double               delta;
+         ClipperLib::JoinType op;
+         ClipperLib::Paths    result;
+         size_t               npoints;
+      };
+
+      static const size_t max_points = size_t(1)<<22;
+
+      static size_t count_points(const ClipperLib::Paths& paths)
+      {
+         size_t n = 0;
+         for(auto& path : paths) n += path.size();
+         return n;
+      }
+
+      static uint64_t key(const ClipperLib::Paths& paths, double delta, ClipperLib::JoinType op)
+      {
+         // FNV-1a over path sizes and coordinates
+         uint64_t h = 14695981039346656037ULL;
+         auto mix = [&h](uint64_t v) { for(int i=0; i<8; i++) { h ^= (v >> (8*i)) & 0xff; h *= 1099511628211ULL; } };
+         for(auto& path : paths) {
+            mix(path.size());
+            for(auto& p : path) { mix(static_cast<uint64_t>(p.X)); mix(static_cast<uint64_t>(p.Y)); }
+         }
+         uint64_t bits = 0;
+         std::memcpy(&bits,&delta,sizeof(bits));
+         mix(bits);
+         mix(static_cast<uint64_t>(op));
+         return h;
+      }
+
+      bool find(uint64_t k, const ClipperLib::Paths& input, double delta, ClipperLib::JoinType op, ClipperLib::Paths& result)
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         auto range = m_map.equal_range(k);
+         for(auto it=range.first; it!=range.second; it++) {
+            const entry& e = *it->second;
+            if(e.delta == delta && e.op == op && e.input == input) {
+               result = e.result;
+               m_hits++;
+               return true;
+            }
+         }
+         return false;
+      }
+
+      void insert(uint64_t k, const ClipperLib::Paths& input, double delta, ClipperLib::JoinType op, const ClipperLib::Paths& result)
+      {
+         size_t npoints = count_points(input) + count_points(result);
+         if(npoints > max_points/4) return;
+
+         auto e = std::make_shared<entry>(entry{input,delta,op,result,npoints});
+         std::lock_guard<std::mutex> lock(m_mutex);
+         m_map.insert(std::make_pair(k,e));
+         m_order.push_back(std::make_pair(k,e));
+         m_points += npoints;
+         while(m_points > max_points) {
+            auto oldest = m_order.front();
+            m_order.pop_front();
+            m_points -= oldest.second->npoints;
+            auto range = m_map.equal_range(oldest.first);
+            for(auto it=range.first; it!=range.second; it++) {
+               if(it->second == oldest.second) { m_map.erase(it); break; }
+            }
+         }
+      }
+
+      void clear()
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         m_map.clear();
+         m_order.clear();
+         m_points = 0;
+         m_hits   = 0;
+      }
+
+      std::mutex                                                        m_mutex;
+      std::unordered_multimap<uint64_t,std::shared_ptr<entry>>          m_map;
+      std::deque<std::pair<uint64_t,std::shared_ptr<entry>>>            m_order;   // insertion order
+      size_t                                                            m_points = 0;
+      std::atomic<size_t>                                               m_hits{0};
+   };
+
+   offset_cache& the_cache() { static offset_cache cache; return cache; }
+
+   size_t find_root(std::vector<size_t>& parent, size_t i)
+   {
+      while(parent[i] != i) {
+         parent[i] = parent[parent[i]];
+         i = parent[i];
+      }
+      return i;
+   }
+}
+
 clipper_offset::clipper_offset()
 {}
 
@@ -41,18 +173,115 @@ bool clipper_offset::compute(std::shared_ptr<clipper_profile> profile, double de
 // compute offset, store resut in member (input also affected)
 bool clipper_offset::compute(std::shared_ptr<clipper_profile> profile, double delta, ClipperLib::JoinType op)
 {
-   double miterLimit = 1000000;
-   ClipperLib::ClipperOffset offset(miterLimit);
-   offset.ArcTolerance = 0.005* TO_CLIPPER;
-   offset.AddPaths(profile->paths(),op,ClipperLib::etClosedPolygon);
    std::shared_ptr<clipper_profile> result(new clipper_profile);
-   offset.Execute(result->paths(), delta * TO_CLIPPER);
-   ClipperLib::CleanPolygons(result->paths());
+   const ClipperLib::Paths& input = profile->paths();
+   uint64_t key = offset_cache::key(input,delta,op);
+   if(the_cache().find(key,input,delta,op,result->paths())) {
+      m_profile = result;
+      return true;
+   }
+
+   std::vector<ClipperLib::Paths> comps;
+   profile->components(comps);
+
+   if(comps.size() < 2) {
+      offset_paths(input,delta,op,result->paths());
+      the_cache().insert(key,input,delta,op,result->paths());
+      m_profile = result;
+      return true;
+   }
+
+   // offset each component separately
+   std::vector<ClipperLib::Paths> offsets(comps.size());
+   thread_pool::task_group group;
+   for(size_t i=0; i<comps.size(); i++) {
+      thread_pool::singleton().submit(group,[&comps,&offsets,delta,op,i]() { offset_paths(comps[i],delta,op,offsets[i]); });
+   }
+   thread_pool::singleton().wait(group);
+
+   // components whose offsets may touch are unioned, the others are just collected
+   std::vector<std::vector<size_t>> clusters;
+   overlap_clusters(offsets,clusters);
+
+   ClipperLib::Paths& paths = result->paths();
+   for(auto& cluster : clusters) {
+      if(cluster.size() == 1) {
+         ClipperLib::Paths& p = offsets[cluster[0]];
+         std::move(p.begin(),p.end(),std::back_inserter(paths));
+         continue;
+      }
+      ClipperLib::Clipper clipper;
+      for(size_t i : cluster) clipper.AddPaths(offsets[i],ClipperLib::ptSubject,true);
+      ClipperLib::Paths merged;
+      clipper.Execute(ClipperLib::ctUnion,merged,ClipperLib::pftNonZero,ClipperLib::pftNonZero);
+      ClipperLib::CleanPolygons(merged);
+      std::move(merged.begin(),merged.end(),std::back_inserter(paths));
+   }
+   the_cache().insert(key,input,delta,op,paths);
    m_profile = result;
 
    return true;
 }
 
+void clipper_offset::offset_paths(const ClipperLib::Paths& paths, double delta, ClipperLib::JoinType op, ClipperLib::Paths& result)
+{
+   double miterLimit = 1000000;
+   ClipperLib::ClipperOffset offset(miterLimit);
+   offset.ArcTolerance = 0.005* TO_CLIPPER;
+   offset.AddPaths(paths,op,ClipperLib::etClosedPolygon);
+   offset.Execute(result, delta * TO_CLIPPER);
+   ClipperLib::CleanPolygons(result);
+}
+
+void clipper_offset::overlap_clusters(const std::vector<ClipperLib::Paths>& comps, std::vector<std::vector<size_t>>& clusters)
+{
+   const size_t n = comps.size();
+   std::vector<offset_box> boxes(n);
+   for(size_t i=0; i<n; i++) boxes[i] = offset_box(comps[i]);
+
+   // sweep the boxes in x order, keeping the boxes whose x interval is still open
+   std::vector<size_t> order(n);
+   std::iota(order.begin(),order.end(),0);
+   std::sort(order.begin(),order.end(),[&boxes](size_t a, size_t b) { return boxes[a].x1 < boxes[b].x1; });
+
+   std::vector<size_t> parent(n);
+   std::iota(parent.begin(),parent.end(),0);
+   std::vector<size_t> active;
+   for(size_t i : order) {
+      if(boxes[i].empty) continue;
+      size_t k = 0;
+      for(size_t j : active) {
+         if(boxes[j].x2 < boxes[i].x1) continue;
+         active[k++] = j;
+         if(boxes[i].overlaps_y(boxes[j])) parent[find_root(parent,i)] = find_root(parent,j);
+      }
+      active.resize(k);
+      active.push_back(i);
+   }
+
+   // collect clusters in component order
+   std::vector<size_t> cluster_index(n,n);
+   clusters.clear();
+   for(size_t i=0; i<n; i++) {
+      size_t root = find_root(parent,i);
+      if(cluster_index[root] == n) {
+         cluster_index[root] = clusters.size();
+         clusters.push_back(std::vector<size_t>());
+      }
+      clusters[cluster_index[root]].push_back(i);
+   }
+}
+
+void clipper_offset::clear_cache()
+{
+   the_cache().clear();
+}
+
+size_t clipper_offset::cache_hits()
+{
+   return the_cache().m_hits;
+}
+
 // return the current profile
 std::shared_ptr<clipper_profile> clipper_offset::profile()
 {
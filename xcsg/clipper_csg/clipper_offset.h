@@ -18,6 +18,7 @@
 
 #include "clipper_profile.h"
 #include <memory>
+#include <vector>
 
 class clipper_offset {
 public:
@@ -29,10 +30,22 @@ public:
    // return the offset profile
    std::shared_ptr<clipper_profile> profile();
 
+   // Offset results are cached by the input paths, delta and join type, so that the same offset
+   // of a shared profile is computed once. The cache is bounded by its number of points
+   static void   clear_cache();
+   static size_t cache_hits();
+
 protected:
-   // compute offset, store resut in member (input not affected)
+   // compute offset, store resut in member (input not affected).
+   // Connected components are offset in parallel, only results with overlapping bounding boxes are unioned
    bool compute(std::shared_ptr<clipper_profile> profile, double delta, ClipperLib::JoinType op);
 
+   // offset a single set of paths
+   static void offset_paths(const ClipperLib::Paths& paths, double delta, ClipperLib::JoinType op, ClipperLib::Paths& result);
+
+   // group the offset components into clusters of overlapping bounding boxes
+   static void overlap_clusters(const std::vector<ClipperLib::Paths>& comps, std::vector<std::vector<size_t>>& clusters);
+
 private:
    std::shared_ptr<clipper_profile>  m_profile;
 };
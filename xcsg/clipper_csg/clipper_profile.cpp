@@ -14,10 +14,85 @@
 // EndLicense:
 
 #include "clipper_profile.h"
-#include <map>
+#include "dmesh/dloop_optimizer.h"
+#include <algorithm>
+#include <utility>
+#include <vector>
 #include <iostream>
+#include <cmath>
+#include <limits>
 using namespace std;
 
+namespace {
+
+   // integer bounding box of a Clipper path
+   struct path_box {
+      ClipperLib::cInt x1,y1,x2,y2;
+
+      path_box(const ClipperLib::Path& path)
+      : x1(path[0].X), y1(path[0].Y), x2(path[0].X), y2(path[0].Y)
+      {
+         for(auto& p : path) {
+            x1 = std::min(x1,p.X); y1 = std::min(y1,p.Y);
+            x2 = std::max(x2,p.X); y2 = std::max(y2,p.Y);
+         }
+      }
+
+      bool covers(const path_box& b) const { return x1<=b.x1 && y1<=b.y1 && x2>=b.x2 && y2>=b.y2; }
+   };
+
+   // uniform grid over outer path bounding boxes. Each cell lists the outer
+   // paths whose box overlaps the cell, so a hole only tests the outers of its cell
+   class path_grid {
+   public:
+      path_grid(const std::vector<std::pair<path_box,size_t>>& boxes)
+      : m_boxes(boxes)
+      , m_box(boxes[0].first)
+      {
+         for(auto& b : boxes) {
+            m_box.x1 = std::min(m_box.x1,b.first.x1); m_box.y1 = std::min(m_box.y1,b.first.y1);
+            m_box.x2 = std::max(m_box.x2,b.first.x2); m_box.y2 = std::max(m_box.y2,b.first.y2);
+         }
+         m_n = std::max(size_t(1),static_cast<size_t>(std::sqrt(double(boxes.size()))));
+         m_cells.resize(m_n*m_n);
+         for(size_t ib=0; ib<boxes.size(); ib++) {
+            const path_box& b = boxes[ib].first;
+            for(size_t iy=cell(b.y1,m_box.y1,m_box.y2); iy<=cell(b.y2,m_box.y1,m_box.y2); iy++) {
+               for(size_t ix=cell(b.x1,m_box.x1,m_box.x2); ix<=cell(b.x2,m_box.x1,m_box.x2); ix++) {
+                  m_cells[iy*m_n+ix].push_back(ib);
+               }
+            }
+         }
+      }
+
+      // return the path indices of outer boxes covering box
+      void query(const path_box& box, std::vector<size_t>& result) const
+      {
+         result.clear();
+         if(!m_box.covers(box)) return;
+         size_t ix = cell(box.x1,m_box.x1,m_box.x2);
+         size_t iy = cell(box.y1,m_box.y1,m_box.y2);
+         for(size_t ib : m_cells[iy*m_n+ix]) {
+            if(m_boxes[ib].first.covers(box)) result.push_back(m_boxes[ib].second);
+         }
+      }
+
+   private:
+      size_t cell(ClipperLib::cInt v, ClipperLib::cInt v1, ClipperLib::cInt v2) const
+      {
+         if(v2 <= v1) return 0;
+         double f = double(v - v1)/double(v2 - v1);
+         return std::min(m_n-1,static_cast<size_t>(f*m_n));
+      }
+
+   private:
+      const std::vector<std::pair<path_box,size_t>>& m_boxes;
+      path_box                                       m_box;
+      size_t                                         m_n;
+      std::vector<std::vector<size_t>>               m_cells;
+   };
+}
+
 clipper_profile::clipper_profile()
 {}
 
@@ -26,43 +101,144 @@ clipper_profile::~clipper_profile()
 
 ClipperLib::Paths& clipper_profile::paths()
 {
+   m_polyset.reset();
    return m_paths;
 }
 
 void clipper_profile::AddPaths(std::shared_ptr<ClipperLib::Paths> paths)
 {
+   m_polyset.reset();
+   if(paths.use_count() == 1) {
+      AddPaths(std::move(*paths));
+      return;
+   }
    m_paths.reserve(m_paths.size()+paths->size());
    for(size_t i=0;i<paths->size(); i++) {
       m_paths.push_back((*paths)[i]);
    }
 }
 
+void clipper_profile::AddPaths(ClipperLib::Paths&& paths)
+{
+   m_polyset.reset();
+   if(m_paths.empty()) {
+      // take over the storage, including its capacity
+      m_paths.swap(paths);
+   }
+   else {
+      m_paths.reserve(m_paths.size()+paths.size());
+      for(auto& path : paths) m_paths.push_back(std::move(path));
+   }
+   paths.clear();
+}
+
 void clipper_profile::AddPath(const ClipperLib::Path& path)
 {
+   m_polyset.reset();
    m_paths.push_back(path);
 }
 
 std::shared_ptr<polyset2d> clipper_profile::polyset()
 {
-   std::shared_ptr<polyset2d> pset(new polyset2d());
+   std::lock_guard<std::mutex> lock(m_polyset_mutex);
+   if(!m_polyset) m_polyset = create_polyset();
+   return m_polyset;
+}
 
-   // check orientation of 1st path
-   bool positive = Orientation(m_paths[0]);
+void clipper_profile::group_paths(std::vector<std::vector<size_t>>& groups, bool& reverse_all) const
+{
+   groups.clear();
+   reverse_all = false;
+   if(m_paths.size() == 0) return;
 
-   // if negative, reverse all paths
-   bool reverse_all = !positive;
+   // outer paths have the orientation of the largest path, the others are holes.
+   // If the outer orientation is negative, all contours must be reversed
+   const size_t npaths = m_paths.size();
+   std::vector<double> area(npaths);
+   size_t ilargest = 0;
+   for(size_t i=0; i<npaths; i++) {
+      area[i] = ClipperLib::Area(m_paths[i]);
+      if(fabs(area[i]) > fabs(area[ilargest])) ilargest = i;
+   }
+   bool positive = (area[ilargest] >= 0.0);
+   reverse_all   = !positive;
 
-   std::shared_ptr<polygon2d> polygon;
-   for(size_t i=0; i<m_paths.size(); i++) {
-      polygon = std::shared_ptr<polygon2d>(new polygon2d());
+   // one group per outer path, indexed by bounding box
+   std::vector<std::vector<size_t>> path_groups(npaths);
+   std::vector<std::pair<path_box,size_t>> outer_boxes;
+   std::vector<size_t> holes;
+   for(size_t i=0; i<npaths; i++) {
+      if(m_paths[i].size() > 0 && area[i] != 0.0 && (area[i] > 0.0) != positive) {
+         holes.push_back(i);
+      }
+      else {
+         path_groups[i].push_back(i);
+         if(m_paths[i].size() > 0) outer_boxes.push_back(std::make_pair(path_box(m_paths[i]),i));
+      }
+   }
+
+   // assign each hole to the smallest outer path containing it. Only outer paths
+   // whose bounding box covers the hole are tested, holes without outer form their own group
+   if(holes.size() > 0) {
+      std::unique_ptr<path_grid> grid;
+      if(outer_boxes.size() > 0) grid.reset(new path_grid(outer_boxes));
+      std::vector<size_t> candidates;
+      for(size_t ihole : holes) {
+         const ClipperLib::Path& hole = m_paths[ihole];
+         if(grid) grid->query(path_box(hole),candidates);
+
+         size_t iouter = npaths;
+         for(size_t i : candidates) {
+            if(iouter < npaths && fabs(area[i]) >= fabs(area[iouter])) continue;
+            if(ClipperLib::PointInPolygon(hole[0],m_paths[i]) != 0) iouter = i;
+         }
+
+         if(iouter < npaths) path_groups[iouter].push_back(ihole);
+         else                path_groups[ihole].push_back(ihole);
+      }
+   }
+
+   for(auto& g : path_groups) {
+      if(g.size() > 0) groups.push_back(std::move(g));
+   }
+}
+
+std::shared_ptr<polyset2d> clipper_profile::create_polyset() const
+{
+   std::shared_ptr<polyset2d> pset(new polyset2d());
+
+   std::vector<std::vector<size_t>> groups;
+   bool reverse_all = false;
+   group_paths(groups,reverse_all);
+
+   for(auto& g : groups) {
+      std::shared_ptr<polygon2d> polygon = std::make_shared<polygon2d>();
+      for(size_t i : g) {
+         polygon->push_back(std::make_shared<contour2d>(m_paths[i]));
+         if(reverse_all) polygon->get_contour(polygon->size()-1)->reverse();
+      }
       pset->push_back(polygon);
-      polygon->push_back(std::shared_ptr<contour2d>(new contour2d(m_paths[i])));
-      if(reverse_all)polygon->get_contour(0)->reverse();
    }
 
    return pset;
 }
 
+void clipper_profile::components(std::vector<ClipperLib::Paths>& comps) const
+{
+   std::vector<std::vector<size_t>> groups;
+   bool reverse_all = false;
+   group_paths(groups,reverse_all);
+
+   comps.clear();
+   comps.reserve(groups.size());
+   for(auto& g : groups) {
+      ClipperLib::Paths paths;
+      paths.reserve(g.size());
+      for(size_t i : g) paths.push_back(m_paths[i]);
+      comps.push_back(std::move(paths));
+   }
+}
+
 void clipper_profile::positive_profiles(std::list<std::shared_ptr<clipper_profile>>& profiles )
 {
    for(size_t i=0; i<m_paths.size(); i++) {
@@ -75,17 +251,54 @@ void clipper_profile::positive_profiles(std::list<std::shared_ptr<clipper_profil
    }
 }
 
+size_t clipper_profile::simplify(double arrow_max)
+{
+   m_polyset.reset();
+
+   // no limit on the distance between remaining vertices
+   dloop_optimizer optimizer(arrow_max,std::numeric_limits<double>::max());
+
+   size_t nremoved = 0;
+   std::vector<dpos2d> points;
+   ClipperLib::Paths simplified;
+   simplified.reserve(m_paths.size());
+   for(auto& path : m_paths) {
+      points.clear();
+      points.reserve(path.size());
+      for(auto& p : path) points.push_back(dpos2d(double(p.X),double(p.Y)));
+
+      std::vector<dpos2d> opt = optimizer.optimize(points);
+      nremoved += path.size() - opt.size();
+      if(opt.size() == path.size()) {
+         simplified.push_back(std::move(path));
+      }
+      else if(opt.size() > 2) {
+         ClipperLib::Path opt_path;
+         opt_path.reserve(opt.size());
+         for(auto& p : opt) opt_path.push_back(ClipperLib::IntPoint(ClipperLib::cInt(p.x()),ClipperLib::cInt(p.y())));
+         simplified.push_back(std::move(opt_path));
+      }
+   }
+   m_paths.swap(simplified);
+   return nremoved;
+}
+
 void clipper_profile::sort()
 {
 //   cout << "   DEBUG: clipper_profile::sort(), number of paths= " << m_paths.size() << endl;
 
-   // build a sorted map of paths, largest positive areas first
-   std::multimap<double,ClipperLib::Path> path_map;
+   // sort path indices, largest positive areas first, keeping the order of equal areas.
+   // The paths are then moved into place, so no point vectors are copied
+   std::vector<std::pair<double,size_t>> order;
+   order.reserve(m_paths.size());
    for(size_t i=0; i<m_paths.size(); i++) {
-      double area = ClipperLib::Area(m_paths[i]);
-      path_map.insert(std::make_pair(-area,m_paths[i]));
+      order.push_back(std::make_pair(-ClipperLib::Area(m_paths[i]),i));
    }
-   m_paths.clear();
-   m_paths.reserve(path_map.size());
-   for(auto p : path_map) m_paths.push_back(p.second);
+   std::stable_sort(order.begin(),order.end(),[](const std::pair<double,size_t>& a, const std::pair<double,size_t>& b) { return a.first < b.first; });
+
+   ClipperLib::Paths sorted;
+   sorted.reserve(m_paths.size());
+   for(auto& p : order) sorted.push_back(std::move(m_paths[p.second]));
+   m_paths.swap(sorted);
+   m_polyset.reset();
 }
@@ -20,6 +20,9 @@
 #include "clipper.hpp"
 #include "polyset2d.h"
 #include <list>
+#include <memory>
+#include <mutex>
+#include <vector>
 
 // A clipper_profile represents the result of successive 2d booleans
 // It can represent any complex 2d profile, possibly multiple polygons with holes.
@@ -29,18 +32,36 @@ public:
    clipper_profile();
    virtual ~clipper_profile();
 
-   // add a number of paths to the profile, following the rules of Clipper
+   // add a number of paths to the profile, following the rules of Clipper.
+   // When this is the only reference to paths, the paths are moved instead of copied
    void AddPaths( std::shared_ptr<ClipperLib::Paths> paths);
 
+   // add a number of paths to the profile by moving them, paths is left empty
+   void AddPaths( ClipperLib::Paths&& paths);
+
    // sort contained profile paths according to area, with positive areas first
    void sort();
 
-   // return access to the Clipper paths
+   // remove vertices deviating less than arrow_max (Clipper units) from the line between
+   // their neighbours, using dloop_optimizer. Paths left with less than 3 vertices are removed.
+   // Returns the number of vertices removed
+   size_t simplify(double arrow_max);
+
+   // return access to the Clipper paths.
+   // The caller may modify the paths, so the cached polyset is discarded
    ClipperLib::Paths& paths();
 
-   // return a set of polygons for this profile
+   // return a set of polygons for this profile. The polyset is created on first use and
+   // cached until the paths change, so the caller must not modify it
    std::shared_ptr<polyset2d> polyset();
 
+   // return a new set of polygons for this profile, which the caller may modify
+   std::shared_ptr<polyset2d> create_polyset() const;
+
+   // split this profile into connected components, each containing an outer path followed by its holes.
+   // The path orientations are kept as they are
+   void components(std::vector<ClipperLib::Paths>& comps) const;
+
    // split this profile into a number of single contour profiles containing only positive winding order paths
    // negative winding order paths are discareded
    void positive_profiles(std::list<std::shared_ptr<clipper_profile>>& profiles );
@@ -48,8 +69,14 @@ public:
 protected:
    void AddPath(  const ClipperLib::Path& path);
 
+   // group path indices into components, the first index of each group is the outer path
+   // and the others its holes. reverse_all is set when the outer paths have negative orientation
+   void group_paths(std::vector<std::vector<size_t>>& groups, bool& reverse_all) const;
+
 private:
-   ClipperLib::Paths m_paths;
+   ClipperLib::Paths          m_paths;
+   std::mutex                 m_polyset_mutex;
+   std::shared_ptr<polyset2d> m_polyset;   // cached result of polyset()
 };
 
 #endif // CLIPPER_PROFILE_H
@@ -15,10 +15,58 @@
 
 #include "contour2d.h"
 #include "vmap2d.h"
+#include "geom_kernel.h"
 #include <utility>
 #include <map>
 #include <limits>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+// make_compatible results, kept for the same contour pairs reappearing in instanced subtrees
+namespace {
+   struct compatible_entry {
+      double              epspnt;
+      std::vector<dpos2d> a_in,b_in;    // input contours
+      std::vector<dpos2d> a_out,b_out;  // compatible contours
+   };
+
+   const size_t max_compatible_entries = 256;
+   std::mutex                                      compatible_mutex;
+   std::multimap<uint64_t,compatible_entry>        compatible_cache;
+
+   void hash_double(uint64_t& h, double v)
+   {
+      // FNV-1a over the bytes of the value
+      unsigned char bytes[sizeof(double)];
+      std::memcpy(bytes,&v,sizeof(double));
+      for(size_t i=0; i<sizeof(double); i++) {
+         h ^= bytes[i];
+         h *= 1099511628211ULL;
+      }
+   }
+
+   uint64_t compatible_hash(const std::vector<dpos2d>& a, const std::vector<dpos2d>& b, double epspnt)
+   {
+      uint64_t h = 14695981039346656037ULL;
+      hash_double(h,epspnt);
+      hash_double(h,double(a.size()));
+      for(auto& v : a) { hash_double(h,v.x()); hash_double(h,v.y()); }
+      for(auto& v : b) { hash_double(h,v.x()); hash_double(h,v.y()); }
+      return h;
+   }
+
+   bool same_vertices(const std::vector<dpos2d>& a, const std::vector<dpos2d>& b)
+   {
+      if(a.size() != b.size()) return false;
+      for(size_t i=0; i<a.size(); i++) {
+         if(a[i].x() != b[i].x() || a[i].y() != b[i].y()) return false;
+      }
+      return true;
+   }
+}
 
 contour2d::contour2d()
 {}
@@ -68,7 +116,7 @@ ClipperLib::Path  contour2d::path() const
       const dpos2d& v = m_vert[i];
       cpath.push_back(ClipperLib::IntPoint(ClipperLib::cInt(v.x()*TO_CLIPPER),ClipperLib::cInt(v.y()*TO_CLIPPER)));
    }
-   return std::move(cpath);
+   return cpath;
 }
 
 double contour2d::length() const
@@ -101,16 +149,69 @@ dpos2d contour2d::geometric_center() const
 
 bool contour2d::make_compatible(contour2d& a, contour2d& b, double epspnt)
 {
-   vmap2d vma(a),vmb(b);
+   const uint64_t hash = compatible_hash(a.m_vert,b.m_vert,epspnt);
+   {
+      std::lock_guard<std::mutex> lock(compatible_mutex);
+      auto range = compatible_cache.equal_range(hash);
+      for(auto i=range.first; i!=range.second; i++) {
+         const compatible_entry& e = i->second;
+         if(e.epspnt==epspnt && same_vertices(e.a_in,a.m_vert) && same_vertices(e.b_in,b.m_vert)) {
+            a.m_vert = e.a_out;
+            b.m_vert = e.b_out;
+            return true;
+         }
+      }
+   }
 
-   // compute vertex lines fromm both contours and put them all in the same list
-   // this will be the basis for computing compatible vertices
-   vmap2d::Vlines vlines;
-   vma.append_vlines(vlines);
-   vmb.append_vlines(vlines);
+   compatible_entry entry;
+   entry.epspnt = epspnt;
+   entry.a_in   = a.m_vert;
+   entry.b_in   = b.m_vert;
+
+   compute_compatible(a,b,epspnt);
+
+   entry.a_out  = a.m_vert;
+   entry.b_out  = b.m_vert;
+   std::lock_guard<std::mutex> lock(compatible_mutex);
+   if(compatible_cache.size() >= max_compatible_entries) compatible_cache.clear();
+   compatible_cache.insert(std::make_pair(hash,entry));
+   return true;
+}
+
+void contour2d::compute_compatible(contour2d& a, contour2d& b, double epspnt)
+{
+   vmap2d vma(a),vmb(b);
 
-   size_t na = vma.imprint(vlines,epspnt);
-   size_t nb = vmb.imprint(vlines,epspnt);
+   size_t na = 0;
+   size_t nb = 0;
+   std::vector<double> angles_a,angles_b;
+   if(vmap2d::vertex_angles(a,angles_a) && vmap2d::vertex_angles(b,angles_b)) {
+      // both contours are star shaped around their centers: merge the vertex directions
+      // of both into one sorted sweep, each line through the center hits each contour twice
+      const double pi = 4.0*atan(1.0);
+      std::vector<double> dirs;
+      dirs.reserve(2*(angles_a.size()+angles_b.size()));
+      for(auto angles : { &angles_a, &angles_b }) {
+         for(double phi : *angles) {
+            dirs.push_back(phi);
+            dirs.push_back((phi < pi)? phi+pi : phi-pi);
+         }
+      }
+      std::sort(dirs.begin(),dirs.end());
+      dirs.erase(std::unique(dirs.begin(),dirs.end()),dirs.end());
+
+      na = vma.imprint_sweep(angles_a,dirs,epspnt);
+      nb = vmb.imprint_sweep(angles_b,dirs,epspnt);
+   }
+   else {
+      // general contours: imprint every vertex line of both contours into every edge
+      vmap2d::Vlines vlines;
+      vma.append_vlines(vlines);
+      vmb.append_vlines(vlines);
+
+      na = vma.imprint(vlines,epspnt);
+      nb = vmb.imprint(vlines,epspnt);
+   }
    if(na != nb) {
       // the imprint caused slightly different topology
       // increase the one with smallest number by simple interpolation
@@ -127,8 +228,6 @@ bool contour2d::make_compatible(contour2d& a, contour2d& b, double epspnt)
 
    // extract the b contour
    b = vmb.contour();
-
-   return true;
 }
 
 double contour2d::signed_area() const
@@ -154,39 +253,11 @@ double contour2d::signed_area() const
                                               -44  counter-clockwise
    */
 
-   size_t np  = m_vert.size();
-   double sum = 0.0;
-
-   for (size_t ip = 1; ip < np; ip++)    {
-      const dpos2d& prev = m_vert[ip-1];
-      const dpos2d& pcur = m_vert[ip];
-
-      double x1 = prev.x();
-      double y1 = prev.y();
-
-      double x2 = pcur.x();
-      double y2 = pcur.y();
-
-      sum += (x2 - x1)*(y2 + y1);
-   }
-
-   // close the polygon: account for the final edge from last to first point
-   const dpos2d& prev = m_vert[np-1];
-   const dpos2d& pcur = m_vert[0];
-
-   double x1 = prev.x();
-   double y1 = prev.y();
-
-   double x2 = pcur.x();
-   double y2 = pcur.y();
-
-   sum += (x2 - x1)*(y2 + y1);
-
-   // we reverse the sign here as positive areas shall correspond to CCW loops
-   // whereas the above formula gives a negative result for CCW.
-
-   double s_area = -0.5*sum;
-   return s_area;
+   // the points are contiguous x,y pairs. geom_kernel reverses the sign of the sum above,
+   // so positive areas correspond to CCW loops
+   static_assert(sizeof(dpos2d) == 2*sizeof(double),"dpos2d must be an x,y pair");
+   if(m_vert.size() == 0) return 0.0;
+   return geom_kernel::signed_area(reinterpret_cast<const double*>(m_vert.data()),m_vert.size());
 }
 
 dbox2d contour2d::bounding_box() const
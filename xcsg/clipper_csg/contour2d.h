@@ -41,7 +41,8 @@ public:
    // compute geometric center
    dpos2d geometric_center() const;
 
-   // make_compatible recomputes a and b to be compatible for use in "transform_extrude"
+   // make_compatible recomputes a and b to be compatible for use in "transform_extrude".
+   // Results are memoized, so repeated pairs are not recomputed
    static bool make_compatible(contour2d& a, contour2d& b, double epspnt);
 
    // compute the signed area of the contour
@@ -55,6 +56,11 @@ public:
    dbox2d bounding_box() const;
 
    ClipperLib::Path path() const;
+
+protected:
+   // the uncached computation behind make_compatible
+   static void compute_compatible(contour2d& a, contour2d& b, double epspnt);
+
 private:
    std::vector<dpos2d> m_vert;
 };
@@ -18,6 +18,12 @@
 #include "dmesh/dmesh.h"
 #include "dmesh/dvertex.h"
 #include "dmesh/dtriangle.h"
+#include "thread_pool.h"
+
+// polysets with fewer vertices are meshed in one pass, the polygons of larger
+// ones are meshed concurrently in tasks of at least task_vertices vertices
+static const size_t parallel_vertices = 2048;
+static const size_t task_vertices     = 512;
 
 dmesh_adapter::dmesh_adapter(double maxlen)
 : m_maxlen(maxlen)
@@ -29,6 +35,14 @@ dmesh_adapter::~dmesh_adapter()
 
 bool dmesh_adapter::tesselate(std::shared_ptr<polyset2d> polyset)
 {
+   if(polyset->size() > 1) {
+      size_t nvert = 0;
+      for(auto i=polyset->begin(); i!=polyset->end(); i++) {
+         for(size_t ic=0; ic<(*i)->size(); ic++) nvert += (*i)->get_contour(ic)->size();
+      }
+      if(nvert >= parallel_vertices) return tesselate_polygons(polyset);
+   }
+
    dmesh dmesher;
 
    // transfer the contours from polyset to dmesher
@@ -87,6 +101,37 @@ bool dmesh_adapter::tesselate(std::shared_ptr<polyset2d> polyset)
    return false;
 }
 
+bool dmesh_adapter::tesselate_polygons(std::shared_ptr<polyset2d> polyset)
+{
+   std::vector<std::shared_ptr<polygon2d>> polys(polyset->begin(),polyset->end());
+   std::vector<std::shared_ptr<polymesh2d>> meshes(polys.size());
+
+   // each task meshes consecutive polygons, a failure is rethrown by wait
+   thread_pool::task_group group;
+   for(size_t begin=0; begin<polys.size(); ) {
+      size_t end = begin, nvert = 0;
+      while(end < polys.size() && nvert < task_vertices) {
+         for(size_t ic=0; ic<polys[end]->size(); ic++) nvert += polys[end]->get_contour(ic)->size();
+         end++;
+      }
+      double maxlen = m_maxlen;
+      thread_pool::singleton().submit(group,[&polys,&meshes,maxlen,begin,end]() {
+         for(size_t i=begin; i<end; i++) {
+            std::shared_ptr<polyset2d> single(new polyset2d());
+            single->push_back(polys[i]);
+            dmesh_adapter tess(maxlen);
+            tess.tesselate(single);
+            meshes[i] = tess.mesh();
+         }
+      });
+      begin = end;
+   }
+   thread_pool::singleton().wait(group);
+
+   for(auto& mesh : meshes) m_mesh->append(*mesh);
+   return true;
+}
+
 bool dmesh_adapter::add_contour(std::shared_ptr<polygon2d> poly, dmesh& dmesher)
 {
    size_t ncontour = poly->size();
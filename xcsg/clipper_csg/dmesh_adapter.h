@@ -20,7 +20,9 @@
 #include "polymesh2d.h"
 class dmesh;
 
-// dmesh_adapter (replaces tmesh_adapter) manages meshing of 2d polygons and stores the result in a polymesh2d
+// dmesh_adapter (replaces tmesh_adapter) manages meshing of 2d polygons and stores the result in a polymesh2d.
+// The polygons of a polyset are disjoint, so a large polyset with several polygons is meshed per polygon
+// as thread_pool tasks, each with a dmesh of its own, and the polygon meshes are appended in polyset order
 
 class dmesh_adapter {
 public:
@@ -40,6 +42,9 @@ protected:
 
    std::vector<dpos2d> build_loop_points(std::shared_ptr<const contour2d> contour);
 
+   // mesh each polygon into a mesh of its own and append them to m_mesh
+   bool tesselate_polygons(std::shared_ptr<polyset2d> polyset);
+
 private:
    double                      m_maxlen; // if positive: maximum allowable distance between points on a contour
    std::shared_ptr<polymesh2d> m_mesh;
@@ -0,0 +1,354 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "monotone_adapter.h"
+#include <algorithm>
+#include <cmath>
+#include <set>
+
+// p is above q in the sweep order: higher y first, then lower x
+static bool above(const dpos2d& p, const dpos2d& q)
+{
+   return (p.y() > q.y()) || (p.y() == q.y() && p.x() < q.x());
+}
+
+// twice the signed area of triangle abc, positive when counterclockwise
+static double orient(const dpos2d& a, const dpos2d& b, const dpos2d& c)
+{
+   return (b.x()-a.x())*(c.y()-a.y()) - (b.y()-a.y())*(c.x()-a.x());
+}
+
+monotone_adapter::monotone_adapter()
+: m_mesh(new polymesh2d())
+{}
+
+monotone_adapter::~monotone_adapter()
+{}
+
+bool monotone_adapter::tesselate(std::shared_ptr<polyset2d> polyset)
+{
+   for(auto i=polyset->begin(); i!=polyset->end(); i++) {
+      if(!tesselate_polygon(*i)) return false;
+   }
+   return true;
+}
+
+bool monotone_adapter::tesselate_polygon(std::shared_ptr<polygon2d> poly)
+{
+   // the contours are added to the mesh as they are, the loops are oriented
+   // with the interior to the left: outer contour counterclockwise, holes clockwise
+   vertex_vector vert;
+   for(size_t ic=0; ic<poly->size(); ic++) {
+      std::shared_ptr<contour2d> contour = poly->get_contour(ic);
+      double area = contour->signed_area();
+      if(contour->size() < 3 || area == 0.0) continue;
+
+      size_t offset = m_mesh->nvertices();
+      m_mesh->add_contour(contour);
+
+      size_t first = vert.size();
+      size_t n = contour->size();
+      bool reverse = (ic == 0)? (area < 0.0) : (area > 0.0);
+      for(size_t i=0; i<n; i++) {
+         vertex v;
+         v.p     = (*contour)[i];
+         v.index = offset + i;
+         v.prev  = first + (i+n-1)%n;
+         v.next  = first + (i+1)%n;
+         if(reverse) std::swap(v.prev,v.next);
+         vert.push_back(v);
+      }
+   }
+   if(vert.size() < 3) return true;
+
+   std::vector<std::pair<size_t,size_t>> diagonals;
+   monotone_diagonals(vert,diagonals);
+
+   std::vector<std::vector<size_t>> faces;
+   split_faces(vert,diagonals,faces);
+   for(auto& face : faces) triangulate_monotone(vert,face);
+   return true;
+}
+
+void monotone_adapter::monotone_diagonals(const vertex_vector& vert, std::vector<std::pair<size_t,size_t>>& diagonals)
+{
+   enum vertex_type { start_vertex, end_vertex, split_vertex, merge_vertex, regular_vertex };
+
+   size_t n = vert.size();
+   std::vector<size_t> order(n);
+   for(size_t i=0; i<n; i++) order[i] = i;
+   std::sort(order.begin(),order.end(),[&vert](size_t a, size_t b) {
+      if(above(vert[a].p,vert[b].p)) return true;
+      if(above(vert[b].p,vert[a].p)) return false;
+      return a < b;
+   });
+   std::vector<size_t> rank(n);
+   for(size_t i=0; i<n; i++) rank[order[i]] = i;
+
+   std::vector<vertex_type> type(n);
+   for(size_t i=0; i<n; i++) {
+      size_t ip = vert[i].prev;
+      size_t in = vert[i].next;
+      bool prev_below = rank[ip] > rank[i];
+      bool next_below = rank[in] > rank[i];
+      bool convex     = orient(vert[ip].p,vert[i].p,vert[in].p) > 0.0;
+      if(prev_below && next_below)        type[i] = (convex)? start_vertex : split_vertex;
+      else if(!prev_below && !next_below) type[i] = (convex)? end_vertex   : merge_vertex;
+      else                                type[i] = regular_vertex;
+   }
+
+   // the sweep status holds the edges i -> next(i) that have the polygon interior to their right,
+   // ordered by their x coordinate at the sweep line. The edges do not cross, so the order only
+   // changes by insertion and removal. npos is a probe at the sweep point
+   const size_t npos = static_cast<size_t>(-1);
+   dpos2d sweep;
+   auto x_at = [&vert,&sweep,npos](size_t e) {
+      if(e == npos) return sweep.x();
+      const dpos2d& a = vert[e].p;
+      const dpos2d& b = vert[vert[e].next].p;
+      if(a.y() == b.y()) return std::max(std::min(a.x(),b.x()),std::min(std::max(a.x(),b.x()),sweep.x()));
+      double t = (sweep.y() - a.y())/(b.y() - a.y());
+      return a.x() + t*(b.x() - a.x());
+   };
+   auto less = [&x_at,npos](size_t a, size_t b) {
+      double xa = x_at(a);
+      double xb = x_at(b);
+      if(xa != xb) return xa < xb;
+      if(a == npos || b == npos) return b == npos;   // an edge through the sweep point is left of it
+      return a < b;
+   };
+   std::set<size_t,decltype(less)> status(less);
+   std::vector<decltype(status)::iterator> in_status(n,status.end());
+   std::vector<size_t> helper(n,npos);
+
+   auto insert = [&](size_t e, size_t h) {
+      in_status[e] = status.insert(e).first;
+      helper[e] = h;
+   };
+   auto erase = [&](size_t e) {
+      if(in_status[e] != status.end()) {
+         status.erase(in_status[e]);
+         in_status[e] = status.end();
+      }
+   };
+   auto left_of = [&]() {
+      auto it = status.lower_bound(npos);
+      return (it == status.begin())? npos : *(--it);
+   };
+   auto connect_merge = [&](size_t v, size_t e) {
+      if(e != npos && helper[e] != npos && type[helper[e]] == merge_vertex) diagonals.push_back(std::make_pair(v,helper[e]));
+   };
+
+   for(size_t v : order) {
+      sweep = vert[v].p;
+      size_t ep = vert[v].prev;   // edge prev(v) -> v
+      switch(type[v]) {
+         case start_vertex: {
+            insert(v,v);
+            break;
+         }
+         case end_vertex: {
+            connect_merge(v,ep);
+            erase(ep);
+            break;
+         }
+         case split_vertex: {
+            size_t ej = left_of();
+            if(ej != npos) {
+               diagonals.push_back(std::make_pair(v,helper[ej]));
+               helper[ej] = v;
+            }
+            insert(v,v);
+            break;
+         }
+         case merge_vertex: {
+            connect_merge(v,ep);
+            erase(ep);
+            size_t ej = left_of();
+            if(ej != npos) {
+               connect_merge(v,ej);
+               helper[ej] = v;
+            }
+            break;
+         }
+         case regular_vertex: {
+            if(rank[vert[v].next] > rank[v]) {
+               // the boundary goes down at v, the interior is to the right
+               connect_merge(v,ep);
+               erase(ep);
+               insert(v,v);
+            }
+            else {
+               size_t ej = left_of();
+               if(ej != npos) {
+                  connect_merge(v,ej);
+                  helper[ej] = v;
+               }
+            }
+            break;
+         }
+      }
+   }
+}
+
+void monotone_adapter::split_faces(const vertex_vector& vert, const std::vector<std::pair<size_t,size_t>>& diagonals, std::vector<std::vector<size_t>>& faces)
+{
+   size_t n = vert.size();
+   if(diagonals.empty()) {
+      // already monotone, one loop per contour
+      std::vector<char> used(n,0);
+      for(size_t i=0; i<n; i++) {
+         if(used[i]) continue;
+         std::vector<size_t> face;
+         for(size_t v=i; !used[v]; v=vert[v].next) {
+            used[v] = 1;
+            face.push_back(v);
+         }
+         faces.push_back(face);
+      }
+      return;
+   }
+
+   // outgoing half edges of each vertex: the boundary edge to next(v) and both directions of the
+   // diagonals, stored from first[v] and sorted counterclockwise by angle
+   std::vector<size_t> first(n+1,0);
+   for(size_t i=0; i<n; i++) first[i+1] = 1;
+   for(auto& d : diagonals) {
+      first[d.first+1]++;
+      first[d.second+1]++;
+   }
+   for(size_t i=0; i<n; i++) first[i+1] += first[i];
+   std::vector<size_t> to(first[n]);
+   std::vector<size_t> fill(first.begin(),first.end()-1);
+   for(size_t i=0; i<n; i++) to[fill[i]++] = vert[i].next;
+   for(auto& d : diagonals) {
+      to[fill[d.first]++]  = d.second;
+      to[fill[d.second]++] = d.first;
+   }
+   auto angle = [&vert](size_t from, size_t too) {
+      return std::atan2(vert[too].p.y()-vert[from].p.y(),vert[too].p.x()-vert[from].p.x());
+   };
+   std::vector<double> to_angle(to.size(),0.0);
+   for(size_t i=0; i<n; i++) {
+      if(first[i+1] - first[i] < 2) continue;
+      std::sort(to.begin()+first[i],to.begin()+first[i+1],[i,&angle](size_t a, size_t b) { return angle(i,a) < angle(i,b); });
+      for(size_t k=first[i]; k<first[i+1]; k++) to_angle[k] = angle(i,to[k]);
+   }
+
+   // walk the faces keeping them to the left: arriving at w from u, leave along the first
+   // outgoing edge clockwise from the direction back to u
+   std::vector<char> used(to.size(),0);
+   for(size_t k0=0; k0<to.size(); k0++) {
+      if(used[k0]) continue;
+      std::vector<size_t> face;
+      size_t u = std::upper_bound(first.begin(),first.end(),k0) - first.begin() - 1;
+      size_t k = k0;
+      while(!used[k]) {
+         used[k] = 1;
+         face.push_back(u);
+         size_t w = to[k];
+         size_t kw = first[w];
+         size_t nw = first[w+1] - first[w];
+         if(nw > 1) {
+            double back = angle(w,u);
+            size_t pos = std::lower_bound(to_angle.begin()+first[w],to_angle.begin()+first[w+1],back) - (to_angle.begin()+first[w]);
+            pos = (pos == 0)? nw-1 : pos-1;
+            if(to[first[w]+pos] == u) pos = (pos == 0)? nw-1 : pos-1;
+            kw += pos;
+         }
+         u = w;
+         k = kw;
+      }
+      if(face.size() >= 3) faces.push_back(face);
+   }
+}
+
+void monotone_adapter::triangulate_monotone(const vertex_vector& vert, const std::vector<size_t>& face)
+{
+   size_t n = face.size();
+   if(n == 3) {
+      add_triangle(vert,face[0],face[1],face[2]);
+      return;
+   }
+
+   // the loop runs counterclockwise, so from the top it descends along the left chain and
+   // returns along the right chain. The chains are merged into sweep order
+   size_t itop = 0, ibot = 0;
+   for(size_t i=1; i<n; i++) {
+      if(above(vert[face[i]].p,vert[face[itop]].p)) itop = i;
+      if(above(vert[face[ibot]].p,vert[face[i]].p)) ibot = i;
+   }
+   std::vector<std::pair<size_t,bool>> sorted;   // vertex, on left chain
+   sorted.reserve(n);
+   size_t il = itop;            // left chain: top to bottom, forward along the loop
+   size_t ir = (itop+n-1)%n;    // right chain: backward from the top, without top and bottom
+   bool left_done = false;
+   while(sorted.size() < n) {
+      bool right_done = (ir == ibot);
+      if(!left_done && (right_done || above(vert[face[il]].p,vert[face[ir]].p))) {
+         sorted.push_back(std::make_pair(face[il],true));
+         left_done = (il == ibot);
+         il = (il+1)%n;
+      }
+      else {
+         sorted.push_back(std::make_pair(face[ir],false));
+         ir = (ir+n-1)%n;
+      }
+   }
+
+   std::vector<std::pair<size_t,bool>> stack;
+   stack.push_back(sorted[0]);
+   stack.push_back(sorted[1]);
+   for(size_t j=2; j+1<n; j++) {
+      size_t u = sorted[j].first;
+      bool   left = sorted[j].second;
+      if(left != stack.back().second) {
+         // u sees all vertices on the stack, which are on the other chain
+         while(stack.size() > 1) {
+            size_t a = stack.back().first; stack.pop_back();
+            add_triangle(vert,u,a,stack.back().first);
+         }
+         stack.clear();
+         stack.push_back(sorted[j-1]);
+         stack.push_back(sorted[j]);
+      }
+      else {
+         std::pair<size_t,bool> last = stack.back(); stack.pop_back();
+         while(stack.size() > 0) {
+            double o = orient(vert[u].p,vert[stack.back().first].p,vert[last.first].p);
+            bool inside = (left)? (o > 0.0) : (o < 0.0);
+            if(!inside) break;
+            add_triangle(vert,u,last.first,stack.back().first);
+            last = stack.back(); stack.pop_back();
+         }
+         stack.push_back(last);
+         stack.push_back(sorted[j]);
+      }
+   }
+   size_t u = sorted[n-1].first;
+   while(stack.size() > 1) {
+      size_t a = stack.back().first; stack.pop_back();
+      add_triangle(vert,u,a,stack.back().first);
+   }
+}
+
+void monotone_adapter::add_triangle(const vertex_vector& vert, size_t a, size_t b, size_t c)
+{
+   double o = orient(vert[a].p,vert[b].p,vert[c].p);
+   if(o == 0.0) return;
+   if(o < 0.0) std::swap(b,c);
+   polymesh2d::index_vector face = { vert[a].index, vert[b].index, vert[c].index };
+   m_mesh->add_face(face);
+}
@@ -0,0 +1,69 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MONOTONE_ADAPTER_H
+#define MONOTONE_ADAPTER_H
+
+#include <vector>
+#include "polyset2d.h"
+#include "polymesh2d.h"
+
+// monotone_adapter triangulates 2d polygons with holes by monotone decomposition and stores the result
+// in a polymesh2d, like tmesh_adapter. A plane sweep inserts the diagonals that split each polygon
+// into y-monotone pieces, which are then triangulated in linear time, O(n log n) in total.
+// No vertices are added and the triangles are not optimised, so this is meant for faces where any
+// valid triangulation does, such as the caps of linear extrusions, see extrude_mesh::cap_strategy.
+
+class monotone_adapter {
+public:
+   monotone_adapter();
+   virtual ~monotone_adapter();
+
+   // tesselate all polygons in the polyset into the same mesh
+   bool tesselate(std::shared_ptr<polyset2d> polyset);
+
+   // return the contained mesh
+   std::shared_ptr<polymesh2d> mesh() { return m_mesh; }
+
+protected:
+   // the vertices of one polygon, each contour a closed loop with the interior to the left
+   struct vertex {
+      dpos2d p;
+      size_t prev;
+      size_t next;
+      size_t index;   // in m_mesh
+   };
+   typedef std::vector<vertex> vertex_vector;
+
+   // triangulate one polygon, its contours are already added to m_mesh from index offset
+   bool tesselate_polygon(std::shared_ptr<polygon2d> poly);
+
+   // sweep the vertices top to bottom and add diagonals splitting the polygon into monotone pieces
+   static void monotone_diagonals(const vertex_vector& vert, std::vector<std::pair<size_t,size_t>>& diagonals);
+
+   // split the polygon along the diagonals into faces, each a loop of vertex indices
+   static void split_faces(const vertex_vector& vert, const std::vector<std::pair<size_t,size_t>>& diagonals, std::vector<std::vector<size_t>>& faces);
+
+   // triangulate a y-monotone face given as a loop with the interior to the left
+   void triangulate_monotone(const vertex_vector& vert, const std::vector<size_t>& face);
+
+   // add triangle with counterclockwise orientation, degenerate triangles are skipped
+   void add_triangle(const vertex_vector& vert, size_t a, size_t b, size_t c);
+
+private:
+   std::shared_ptr<polymesh2d> m_mesh;
+};
+
+#endif // MONOTONE_ADAPTER_H
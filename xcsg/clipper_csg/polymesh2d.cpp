@@ -45,9 +45,7 @@ void polymesh2d::add_contour(std::shared_ptr<const contour2d> contour)
    size_t icv_offset = m_vert.size();
    size_t ncv        = contour->size();
 
-   // reserve space for more vertices
-   m_vert.reserve(icv_offset+ncv);
-
+   // the vertices grow geometrically, reserving the exact size here would copy them for every contour
    // reserve space in contour index vector
    index_vector index_contour;
    index_contour.reserve(ncv);
@@ -71,6 +69,24 @@ void polymesh2d::add_face(const index_vector& face)
    m_face.push_back(face);
 }
 
+void polymesh2d::append(const polymesh2d& other)
+{
+   size_t offset = m_vert.size();
+   m_vert.insert(m_vert.end(),other.m_vert.begin(),other.m_vert.end());
+
+   m_face.reserve(m_face.size() + other.m_face.size());
+   for(auto& face : other.m_face) {
+      m_face.push_back(face);
+      for(auto& iv : m_face.back()) iv += offset;
+   }
+
+   m_contour.reserve(m_contour.size() + other.m_contour.size());
+   for(auto& contour : other.m_contour) {
+      m_contour.push_back(contour);
+      for(auto& iv : m_contour.back()) iv += offset;
+   }
+}
+
 const dpos2d& polymesh2d::vertex(size_t ivertex) const
 {
    return m_vert[ivertex];
@@ -29,6 +29,7 @@ class polymesh2d {
 public:
    friend class dmesh_adapter;
    friend class tmesh_adapter;
+   friend class monotone_adapter;
 
    typedef std::vector<dpos2d>      vertex_vector;
    typedef std::vector<size_t>        index_vector;    // a vector of indices into m_vert
@@ -68,6 +69,9 @@ protected:
    // The indicies must properly refer to vertexes in this mesh
    void add_face(const index_vector& face);
 
+   // append the vertices, faces and contours of another mesh, offsetting its vertex indices
+   void append(const polymesh2d& other);
+
 private:
     vertex_vector   m_vert;    // vertices
     face_vector     m_face;    // faces    , each entry contains N indices into m_vert (not limited to 3)
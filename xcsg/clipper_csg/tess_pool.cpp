@@ -0,0 +1,135 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "tess_pool.h"
+#include "tmesh/libtess2/Include/tesselator.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+
+// each block starts with a header holding its size class and size, this also keeps the user data aligned
+static const size_t header_size = 2*sizeof(size_t);
+
+static size_t size_class(size_t size)
+{
+   size_t ic = 0;
+   while((size_t(16)<<ic) < size) ic++;
+   return ic;
+}
+
+tess_pool::lease::lease()
+: m_tess(0)
+, m_pooled(false)
+, m_completed(false)
+{
+   tess_pool& pool = tess_pool::local();
+   if(!pool.m_leased) {
+      if(!pool.m_tess) pool.m_tess = pool.create();
+      m_tess   = pool.m_tess;
+      m_pooled = true;
+      pool.m_leased = true;
+   }
+   else {
+      m_tess = pool.create();
+   }
+   if(!m_tess) throw std::bad_alloc();
+}
+
+tess_pool::lease::~lease()
+{
+   tess_pool& pool = tess_pool::local();
+   if(m_pooled) {
+      pool.m_leased = false;
+      if(m_completed) return;
+      pool.m_tess = 0;
+   }
+   tessDeleteTess(m_tess);
+}
+
+tess_pool& tess_pool::local()
+{
+   static thread_local tess_pool pool;
+   return pool;
+}
+
+tess_pool::tess_pool()
+: m_tess(0)
+, m_leased(false)
+{}
+
+tess_pool::~tess_pool()
+{
+   if(m_tess) tessDeleteTess(m_tess);
+   for(size_t ic=0; ic<nclass; ic++) {
+      for(void* block : m_free[ic]) std::free(block);
+   }
+}
+
+TESStesselator* tess_pool::create()
+{
+   TESSalloc ma;
+   memset(&ma, 0, sizeof(ma));
+   ma.memalloc   = tess_pool::memalloc;
+   ma.memrealloc = tess_pool::memrealloc;
+   ma.memfree    = tess_pool::memfree;
+   ma.userData   = this;
+   ma.extraVertices = 256;
+   return tessNewTess(&ma);
+}
+
+void* tess_pool::memalloc(void* userData, unsigned int size)
+{
+   tess_pool* pool = static_cast<tess_pool*>(userData);
+   size_t ic = size_class(size);
+   char* block = 0;
+   if(ic < nclass && pool->m_free[ic].size() > 0) {
+      block = static_cast<char*>(pool->m_free[ic].back());
+      pool->m_free[ic].pop_back();
+   }
+   else {
+      size_t bytes = (ic < nclass)? (size_t(16)<<ic) : size;
+      block = static_cast<char*>(std::malloc(header_size + bytes));
+      if(!block) return 0;
+      reinterpret_cast<size_t*>(block)[0] = ic;
+      reinterpret_cast<size_t*>(block)[1] = bytes;
+   }
+   return block + header_size;
+}
+
+void* tess_pool::memrealloc(void* userData, void* ptr, unsigned int size)
+{
+   if(!ptr) return memalloc(userData,size);
+
+   // the block may already be large enough
+   const size_t* header = reinterpret_cast<const size_t*>(static_cast<char*>(ptr) - header_size);
+   const size_t bytes = header[1];
+   if(size <= bytes) return ptr;
+
+   void* p = memalloc(userData,size);
+   if(!p) return 0;
+   std::memcpy(p,ptr,bytes);
+   memfree(userData,ptr);
+   return p;
+}
+
+void tess_pool::memfree(void* userData, void* ptr)
+{
+   if(!ptr) return;
+   tess_pool* pool = static_cast<tess_pool*>(userData);
+   char* block = static_cast<char*>(ptr) - header_size;
+   size_t ic = *reinterpret_cast<size_t*>(block);
+   if(ic < nclass) pool->m_free[ic].push_back(block);
+   else            std::free(block);
+}
@@ -0,0 +1,76 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef TESS_POOL_H
+#define TESS_POOL_H
+
+#include <cstddef>
+#include <vector>
+struct TESStesselator;
+
+// tess_pool keeps one libtess2 tesselator per thread, reused by all tmesh_adapter instances on that thread.
+// libtess2 allocates mesh edges, vertices, faces and sweep regions in buckets through its TESSalloc
+// interface. The pool serves these requests from free lists per size class, so the blocks
+// released by one tesselation are reused by the next instead of returning to the system allocator.
+
+class tess_pool {
+public:
+   // lease gives exclusive use of the tesselator of the calling thread during its lifetime.
+   // A nested lease on the same thread gets a private tesselator using the same allocator
+   class lease {
+   public:
+      lease();
+      virtual ~lease();
+
+      TESStesselator* tess() { return m_tess; }
+
+      // mark the tesselation as completed, so the tesselator is kept for the next lease.
+      // Otherwise it may still hold a partial mesh and is deleted with the lease
+      void completed() { m_completed = true; }
+
+   private:
+      lease(const lease&) = delete;
+      lease& operator=(const lease&) = delete;
+
+      TESStesselator* m_tess;
+      bool            m_pooled;
+      bool            m_completed;
+   };
+
+   virtual ~tess_pool();
+
+   // the pool of the calling thread
+   static tess_pool& local();
+
+protected:
+   tess_pool();
+
+   // create a tesselator using the pool allocator
+   TESStesselator* create();
+
+   // TESSalloc callbacks, userData is the tess_pool
+   static void* memalloc(void* userData, unsigned int size);
+   static void* memrealloc(void* userData, void* ptr, unsigned int size);
+   static void  memfree(void* userData, void* ptr);
+
+private:
+   static const size_t nclass = 24;   // size classes 16 bytes .. 128 MB, larger blocks are not pooled
+
+   std::vector<void*> m_free[nclass]; // free blocks per power of two size class
+   TESStesselator*    m_tess;         // the pooled tesselator, or null
+   bool               m_leased;       // true while m_tess is in use
+};
+
+#endif // TESS_POOL_H
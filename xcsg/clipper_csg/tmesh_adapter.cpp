@@ -4,46 +4,31 @@
 #include <map>
 #include <cmath>
 #include "tmesh/libtess2/Include/tesselator.h"
+#include "tess_pool.h"
+#include "thread_pool.h"
 
-static void *stdAlloc(void* userData, unsigned int size) {
-	TESS_NOTUSED(userData);
-	return malloc(size);
-}
-
-static void stdFree(void* userData, void* ptr) {
-	TESS_NOTUSED(userData);
-	free(ptr);
-}
+// polysets with fewer vertices are tesselated in one pass, the polygons of larger
+// ones are tesselated concurrently in tasks of at least task_vertices vertices
+static const size_t parallel_vertices = 2048;
+static const size_t task_vertices     = 512;
 
 tmesh_adapter::tmesh_adapter()
-: m_tess(0)
-, m_mesh(new polymesh2d())
+: m_mesh(new polymesh2d())
 {}
 
 tmesh_adapter::~tmesh_adapter()
-{
-   delete_tess();
-}
-
-void tmesh_adapter::create_tess()
-{
-   delete_tess();
-   TESSalloc ma;
-   memset(&ma, 0, sizeof(ma));
-   ma.memalloc = stdAlloc;
-   ma.memfree = stdFree;
-   ma.extraVertices = 256; // realloc not provided, allow 256 extra vertices.
-   m_tess = tessNewTess(&ma);
-}
-
-void tmesh_adapter::delete_tess()
-{
-   if(m_tess)tessDeleteTess(m_tess);
-   m_tess = 0;
-}
+{}
 
 bool tmesh_adapter::tesselate(std::shared_ptr<polyset2d> polyset)
 {
+   if(polyset->size() > 1) {
+      size_t nvert = 0;
+      for(auto i=polyset->begin(); i!=polyset->end(); i++) {
+         for(size_t ic=0; ic<(*i)->size(); ic++) nvert += (*i)->get_contour(ic)->size();
+      }
+      if(nvert >= parallel_vertices) return tesselate_polygons(polyset);
+   }
+
    // build a sorted map of contours, largest areas first
    std::multimap<double,std::shared_ptr<contour2d>> sorted_contours;
    for(auto i=polyset->begin(); i!=polyset->end(); i++) {
@@ -61,6 +46,40 @@ bool tmesh_adapter::tesselate(std::shared_ptr<polyset2d> polyset)
    // then tesselate the contours
    return tesselate_contours(sorted_contours);
 
+}
+
+bool tmesh_adapter::tesselate_polygons(std::shared_ptr<polyset2d> polyset)
+{
+   std::vector<std::shared_ptr<polygon2d>> polys(polyset->begin(),polyset->end());
+   std::vector<std::shared_ptr<polymesh2d>> meshes(polys.size());
+   std::vector<char> ok(polys.size(),0);
+
+   // each task tesselates consecutive polygons with the tesselator of its thread
+   thread_pool::task_group group;
+   for(size_t begin=0; begin<polys.size(); ) {
+      size_t end = begin, nvert = 0;
+      while(end < polys.size() && nvert < task_vertices) {
+         for(size_t ic=0; ic<polys[end]->size(); ic++) nvert += polys[end]->get_contour(ic)->size();
+         end++;
+      }
+      thread_pool::singleton().submit(group,[&polys,&meshes,&ok,begin,end]() {
+         for(size_t i=begin; i<end; i++) {
+            std::shared_ptr<polyset2d> single(new polyset2d());
+            single->push_back(polys[i]);
+            tmesh_adapter tess;
+            ok[i] = tess.tesselate(single);
+            meshes[i] = tess.mesh();
+         }
+      });
+      begin = end;
+   }
+   thread_pool::singleton().wait(group);
+
+   for(size_t i=0; i<polys.size(); i++) {
+      if(!ok[i]) return false;
+      m_mesh->append(*meshes[i]);
+   }
+   return true;
 }
 
 bool tmesh_adapter::tesselate_contours(ContourMap& contours)
@@ -68,8 +87,9 @@ bool tmesh_adapter::tesselate_contours(ContourMap& contours)
    const int polySize   = 3; // defines maximum vertices per polygon (i.e. triangle)
    const int vertexSize = 2; // defines the number of coordinates in tesselation result vertex, must be 2 or 3.
 
-   // make sure tess is initialised
-   create_tess();
+   // the tesselator of this thread, reused between calls
+   tess_pool::lease lease;
+   TESStesselator* tess = lease.tess();
 
    // number of vertices along polygon contours
    int n_input_vertices = 0;
@@ -94,21 +114,24 @@ bool tmesh_adapter::tesselate_contours(ContourMap& contours)
       }
 
       // add the contour vertices to the tesselator
-      tessAddContour(m_tess,2,&coords[0],sizeof(TESSreal)*vertexSize,static_cast<int>(contour->size()));
+      tessAddContour(tess,2,&coords[0],sizeof(TESSreal)*vertexSize,static_cast<int>(contour->size()));
    }
 
    // compute the Constrained Delaunay mesh for the whole profile
    TESSreal* normalvec = 0; // normal automatically calculated
-   bool success = (1 == tessTesselate(m_tess,TESS_WINDING_ODD,TESS_CONSTRAINED_DELAUNAY_TRIANGLES, polySize, vertexSize, normalvec));
+   bool success = (1 == tessTesselate(tess,TESS_WINDING_ODD,TESS_CONSTRAINED_DELAUNAY_TRIANGLES, polySize, vertexSize, normalvec));
    if(!success) return false;
 
+   // the tesselator has released its mesh and can be reused
+   lease.completed();
+
    // get the tesselation results
-   const TESSreal* verts = tessGetVertices(m_tess);
-   const int* elems      = tessGetElements(m_tess);
-   const int nelems      = tessGetElementCount(m_tess);
+   const TESSreal* verts = tessGetVertices(tess);
+   const int* elems      = tessGetElements(tess);
+   const int nelems      = tessGetElementCount(tess);
 
-   const int nverts      = tessGetVertexCount(m_tess);
-   const int* vinds      = tessGetVertexIndices(m_tess);
+   const int nverts      = tessGetVertexCount(tess);
+   const int* vinds      = tessGetVertexIndices(tess);
 
    if(n_input_vertices < nverts) {
       // extra vertices have been created
@@ -147,9 +170,6 @@ bool tmesh_adapter::tesselate_contours(ContourMap& contours)
       if(face.size() == polySize)m_mesh->add_face(face);
    }
 
-   // tess data structure no longer needed
-   delete_tess();
-
    return true;
 }
 
@@ -5,11 +5,13 @@
 #include <map>
 #include "polyset2d.h"
 #include "polymesh2d.h"
-struct TESStesselator;
 
 // tmesh_adapter manages meshing of 2d polygons and stores the result in a polymesh2d
 // This class uses libtess2 to create a constrained delaunay triangle mesh.
 // The libtess2 version used here is the modified version found in https://github.com/openscad/openscad/
+// The tesselator and its memory are reused through the thread local tess_pool.
+// The polygons of a polyset are disjoint, so a large polyset with several polygons is tesselated
+// per polygon as thread_pool tasks, and the polygon meshes are appended in polyset order
 
 class tmesh_adapter {
 public:
@@ -26,11 +28,10 @@ private:
    typedef std::multimap<double,std::shared_ptr<contour2d>>  ContourMap;
    bool tesselate_contours(ContourMap& contours);
 
+   // tesselate each polygon into a mesh of its own and append them to m_mesh
+   bool tesselate_polygons(std::shared_ptr<polyset2d> polyset);
+
 private:
-   void create_tess();
-   void delete_tess();
-   TESStesselator* m_tess;
-
    std::shared_ptr<polymesh2d> m_mesh;
 };
 
@@ -15,6 +15,13 @@
 
 #include "vmap2d.h"
 #include "contour2d.h"
+#include <algorithm>
+#include <cmath>
+
+static bool param_less(const std::pair<double,dpos2d>& a, const std::pair<double,dpos2d>& b)
+{
+   return a.first < b.first;
+}
 
 vmap2d::vmap2d(const contour2d& c)
 : m_contour(c)
@@ -25,13 +32,45 @@ vmap2d::vmap2d(const contour2d& c)
 
 void vmap2d::compute_map()
 {
+   // parameters are increasing along the contour, coincident vertices share a parameter
    m_vmap.clear();
-   m_vmap[0.0] = m_contour[0];
+   m_vmap.reserve(m_contour.size());
+   m_vmap.push_back(std::make_pair(0.0,m_contour[0]));
    double dist = 0.0;
    for(size_t i=1; i<m_contour.size(); i++) {
       dist += m_contour[i].dist(m_contour[i-1]);
-      m_vmap[dist/m_len] = m_contour[i];
+      double p = dist/m_len;
+      if(p == m_vmap.back().first) m_vmap.back().second = m_contour[i];
+      else                         m_vmap.push_back(std::make_pair(p,m_contour[i]));
+   }
+}
+
+void vmap2d::merge(Vmap& added)
+{
+   if(added.size() == 0) return;
+
+   // sort the added vertices, keeping the last of equal parameters
+   std::stable_sort(added.begin(),added.end(),param_less);
+   Vmap unique_added;
+   unique_added.reserve(added.size());
+   for(size_t i=0; i<added.size(); i++) {
+      if(i+1<added.size() && added[i+1].first == added[i].first) continue;
+      unique_added.push_back(added[i]);
    }
+
+   // linear merge of the two sorted sequences
+   Vmap merged;
+   merged.reserve(m_vmap.size()+unique_added.size());
+   auto iv = m_vmap.begin();
+   auto ia = unique_added.begin();
+   while(iv!=m_vmap.end() || ia!=unique_added.end()) {
+      if(ia==unique_added.end())         merged.push_back(*iv++);
+      else if(iv==m_vmap.end())          merged.push_back(*ia++);
+      else if(iv->first < ia->first)     merged.push_back(*iv++);
+      else if(ia->first < iv->first)     merged.push_back(*ia++);
+      else                             { merged.push_back(*ia++); iv++; }
+   }
+   m_vmap.swap(merged);
 }
 
 void vmap2d::compute_contour()
@@ -73,6 +112,9 @@ size_t  vmap2d::imprint(Vlines& lines, double epspnt)
    // dist is the distance along contour before current edge
    double dist = 0.0;
 
+   // intersection vertices, merged with the contour vertices after all edges are done
+   Vmap added;
+
    // traverse contour edges
    for(size_t iedge=0; iedge<edges.size(); iedge++) {
       auto& p = edges[iedge];
@@ -96,7 +138,7 @@ size_t  vmap2d::imprint(Vlines& lines, double epspnt)
                if((dist1>epspnt) && (dist2>epspnt)) {
                   // compute intersection parameter
                   double p = (dist + dist1)/m_len;
-                  m_vmap[p] = xpos;
+                  added.push_back(std::make_pair(p,xpos));
                }
             }
          }
@@ -107,10 +149,93 @@ size_t  vmap2d::imprint(Vlines& lines, double epspnt)
    }
 
    // update the contour
+   merge(added);
    compute_contour();
    return m_contour.size();
 }
 
+bool vmap2d::vertex_angles(const contour2d& c, std::vector<double>& angles)
+{
+   const double two_pi = 8.0*atan(1.0);
+   dpos2d gcen = c.geometric_center();
+   size_t nv = c.size();
+   angles.clear();
+   angles.reserve(nv);
+
+   int sign = 0;
+   for(size_t i=0; i<nv; i++) {
+      const dpos2d& v1 = c[i];
+      const dpos2d& v2 = c[(i+1)%nv];
+      double dx1 = v1.x()-gcen.x(), dy1 = v1.y()-gcen.y();
+      double dx2 = v2.x()-gcen.x(), dy2 = v2.y()-gcen.y();
+      double cross = dx1*dy2 - dy1*dx2;
+      int s = (cross > 0.0)? 1 : ((cross < 0.0)? -1 : 0);
+      if(s == 0 || (sign != 0 && s != sign)) return false;
+      sign = s;
+
+      double a = atan2(dy1,dx1);
+      if(a < 0.0) a += two_pi;
+      if(a >= two_pi) a = 0.0;
+      angles.push_back(a);
+   }
+   return true;
+}
+
+size_t vmap2d::imprint_sweep(const std::vector<double>& angles, const std::vector<double>& dirs, double epspnt)
+{
+   const double two_pi = 8.0*atan(1.0);
+   dpos2d gcen = m_contour.geometric_center();
+   size_t nv   = m_contour.size();
+   size_t nd   = dirs.size();
+
+   // star shaped contours turn monotonically around the center, the orientation gives the direction
+   bool ccw = m_contour.signed_area() > 0.0;
+
+   double dist = 0.0;
+   Vmap added;
+   for(size_t i=0; i<nv && nd>0; i++) {
+      const dpos2d& pos1 = m_contour[i];
+      const dpos2d& pos2 = m_contour[(i+1)%nv];
+      double ex  = pos2.x()-pos1.x();
+      double ey  = pos2.y()-pos1.y();
+      double len = pos1.dist(pos2);
+
+      // angular span of the edge as seen from the center
+      double a1   = angles[i];
+      double span = ccw? angles[(i+1)%nv]-a1 : a1-angles[(i+1)%nv];
+      if(span < 0.0) span += two_pi;
+
+      // first direction past a1 in the sweep direction
+      size_t k = ccw? std::upper_bound(dirs.begin(),dirs.end(),a1) - dirs.begin()
+                    : std::lower_bound(dirs.begin(),dirs.end(),a1) - dirs.begin() + nd - 1;
+      for(size_t step=0; step<nd; step++) {
+         double phi = ccw? dirs[(k+step)%nd] : dirs[(k+nd-step)%nd];
+         double off = ccw? phi-a1 : a1-phi;
+         if(off < 0.0) off += two_pi;
+         if(off >= span) break;
+         if(off <= 0.0) continue;
+
+         // intersection of the direction line with the edge: gcen + s*u = pos1 + t*e
+         double ux = cos(phi), uy = sin(phi);
+         double below = ux*ey - uy*ex;
+         if(below == 0.0) continue;
+         double t = (uy*(pos1.x()-gcen.x()) - ux*(pos1.y()-gcen.y()))/below;
+         if((t>0.0) && (t<1.0)) {
+            double dist1 = t*len;
+            double dist2 = len - dist1;
+            if((dist1>epspnt) && (dist2>epspnt)) {
+               double p = (dist + dist1)/m_len;
+               added.push_back(std::make_pair(p,dpos2d(pos1.x()+t*ex,pos1.y()+t*ey)));
+            }
+         }
+      }
+      dist += len;
+   }
+
+   merge(added);
+   compute_contour();
+   return m_contour.size();
+}
 
 void vmap2d::add_vertices(size_t nv)
 {
@@ -119,14 +244,17 @@ void vmap2d::add_vertices(size_t nv)
       double p0 = dp/2.0;
       double par = p0;
       for(size_t i=0; i<nv; i++) {
-         Vmap::const_iterator ip2 = m_vmap.upper_bound(par);
-         Vmap::const_iterator ip1 = ip2; ip1--;
-         double p = 0.5*(ip1->first + ip2->first);
-         const dpos2d& p1 = ip1->second;
-         const dpos2d& p2 = ip2->second;
-         double x = 0.5*(p1.x() + p2.x());
-         double y = 0.5*(p1.y() + p2.y());
-         m_vmap[p] = dpos2d(x,y);
+         // the vertex interval containing par, past the last vertex it is the closing edge
+         Vmap::iterator ip2 = std::upper_bound(m_vmap.begin(),m_vmap.end(),std::make_pair(par,dpos2d()),param_less);
+         Vmap::iterator ip1 = ip2; ip1--;
+         double p2 = (ip2==m_vmap.end())? 1.0 : ip2->first;
+         const dpos2d& v2 = (ip2==m_vmap.end())? m_vmap.begin()->second : ip2->second;
+         double p = 0.5*(ip1->first + p2);
+         const dpos2d& v1 = ip1->second;
+         double x = 0.5*(v1.x() + v2.x());
+         double y = 0.5*(v1.y() + v2.y());
+         if(p == ip1->first) ip1->second = dpos2d(x,y);
+         else                m_vmap.insert(ip2,std::make_pair(p,dpos2d(x,y)));
          par += dp;
       }
 
@@ -19,15 +19,15 @@
 #include "dmesh/dpos2d.h"
 #include "dmesh/dline2d.h"
 #include "contour2d.h"
-#include <map>
 #include <vector>
 // vmap2d implements a closed contour where the vertices have parameters [0,1]
 // The lowest  parameter value is always = 0.0
 // The highest parameter value is always < 1.0, since the last vertex is the same as the first
+// The vertices are kept in a vector sorted by parameter, with unique parameter values
 
 class vmap2d {
 public:
-   typedef std::map<double,dpos2d> Vmap;
+   typedef std::vector<std::pair<double,dpos2d>> Vmap;
    typedef Vmap::iterator iterator;
 
    typedef std::vector<std::pair<int,int>> EdgeVec; // indices into m_contour
@@ -42,6 +42,16 @@ public:
    // imprint all lines into this contour, returns number of contour vertices after imprint
    size_t imprint(Vlines& lines, double epspnt);
 
+   // compute the angles of the contour vertices around the geometric center, in [0,2*pi).
+   // Returns false unless the contour is star shaped around its center, i.e. every
+   // edge turns the same way as seen from the center
+   static bool vertex_angles(const contour2d& c, std::vector<double>& angles);
+
+   // sweep alternative to imprint for star shaped contours: imprint the lines through the
+   // geometric center with the given directions (sorted, in [0,2*pi)). Each edge only visits
+   // the directions within its own angular span, returns number of contour vertices after imprint
+   size_t imprint_sweep(const std::vector<double>& angles, const std::vector<double>& dirs, double epspnt);
+
    void add_vertices(size_t nv);
 
    // force the vertex position defined by intersection libe to become first point on contour (or any point being close to it)
@@ -56,6 +66,10 @@ protected:
    void compute_contour();
    void get_edges(EdgeVec& edges) const;
 
+   // merge added vertices into m_vmap. For equal parameters the added vertex replaces
+   // the existing, and the last of several added vertices is used
+   void merge(Vmap& added);
+
 private:
    contour2d m_contour;
    double    m_len;
@@ -0,0 +1,76 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "compile_context.h"
+#include "boolean_timer.h"
+#include "instance_cache.h"
+#include "mesh_utils.h"
+#include <stdexcept>
+
+// the context current in this thread
+static thread_local compile_context* tl_context = nullptr;
+
+compile_context::compile_context()
+: m_secant_tolerance(mesh_utils::default_secant_tolerance())
+, m_snap_spacing(0.0)
+, m_max_faces(0)
+, m_timer(new boolean_timer())
+, m_instances(new instance_cache())
+, m_cancelled(false)
+{}
+
+compile_context::~compile_context()
+{
+   delete m_instances;
+   delete m_timer;
+}
+
+compile_context* compile_context::current()
+{
+   return tl_context;
+}
+
+compile_context::scope::scope(compile_context* ctx)
+: m_prev(tl_context)
+{
+   tl_context = ctx;
+}
+
+compile_context::scope::~scope()
+{
+   tl_context = m_prev;
+}
+
+void compile_context::cancel(const std::string& msg)
+{
+   std::lock_guard<std::mutex> lock(m_cancel_mutex);
+   if(!m_cancelled) m_cancel_msg = msg;
+   m_cancelled = true;
+}
+
+void compile_context::throw_if_cancelled() const
+{
+   if(!m_cancelled) return;
+   std::lock_guard<std::mutex> lock(m_cancel_mutex);
+   throw std::logic_error(m_cancel_msg);
+}
+
+void compile_context::reset_cancel()
+{
+   std::lock_guard<std::mutex> lock(m_cancel_mutex);
+   m_cancelled = false;
+   m_cancel_msg.clear();
+}
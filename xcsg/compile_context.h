@@ -0,0 +1,101 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef COMPILE_CONTEXT_H
+#define COMPILE_CONTEXT_H
+
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+class boolean_timer;
+class instance_cache;
+class xsolid;
+
+// compile_context holds the state belonging to one compilation: the secant tolerance, the boolean
+// timer, the instance cache, the subtrees shared by the factory and the cancellation after a failure.
+// Each xcsg_compiler owns a context, so several models can be compiled concurrently in one process.
+//
+// The context is current in the thread running the compilation, and thread_pool tasks run with the
+// context of the thread that submitted them. CSG nodes reach it through current(), it is not passed
+// through create_carve_mesh. The content keyed mesh and primitive caches, the thread pool and the
+// diagnostics (phase_timer, node_profiler, trace_recorder) remain process wide.
+
+class compile_context {
+public:
+   compile_context();
+   virtual ~compile_context();
+
+   // the context current in this thread, nullptr outside a compilation
+   static compile_context* current();
+
+   // makes a context current in this thread while in scope. A null context is allowed
+   class scope {
+   public:
+      scope(compile_context* ctx);
+      ~scope();
+   private:
+      scope(const scope&) = delete;
+      scope& operator=(const scope&) = delete;
+      compile_context* m_prev;
+   };
+
+   // secant tolerance of the model, see mesh_utils::secant_tolerance
+   double secant_tolerance() const          { return m_secant_tolerance; }
+   void   set_secant_tolerance(double tol)  { m_secant_tolerance = tol; }
+
+   // grid spacing for snapping intermediate boolean results, see carve_boolean::set_snap_bits. 0 if not set
+   double snap_spacing() const              { return m_snap_spacing; }
+   void   set_snap_spacing(double spacing)  { m_snap_spacing = spacing; }
+
+   boolean_timer&  timer()     { return *m_timer; }
+   instance_cache& instances() { return *m_instances; }
+
+   // instance hash -> first solid built, for xcsg_factory::make_shared_solid
+   std::map<std::string,std::shared_ptr<xsolid>>& shared_solids() { return m_shared_solids; }
+
+   // faces allowed in a boolean result, 0 means no limit, see xcsg_compiler::set_limits
+   size_t max_faces() const                 { return m_max_faces; }
+   void   set_max_faces(size_t nfaces)      { m_max_faces = nfaces; }
+
+   // cancel the compilation after a failure with message msg. Only the first message is kept
+   void cancel(const std::string& msg);
+   bool cancelled() const { return m_cancelled; }
+
+   // throw the first failure as std::logic_error if cancelled
+   void throw_if_cancelled() const;
+
+   // clear the cancellation before a new compilation
+   void reset_cancel();
+
+private:
+   compile_context(const compile_context&) = delete;
+   compile_context& operator=(const compile_context&) = delete;
+
+   std::atomic<double>                           m_secant_tolerance;
+   std::atomic<double>                           m_snap_spacing;
+   std::atomic<size_t>                           m_max_faces;
+   boolean_timer*                                m_timer;       // owned
+   instance_cache*                               m_instances;   // owned
+   std::map<std::string,std::shared_ptr<xsolid>> m_shared_solids;
+
+   std::atomic<bool>                             m_cancelled;
+   mutable std::mutex                            m_cancel_mutex;
+   std::string                                   m_cancel_msg;  // the first failure
+};
+
+#endif // COMPILE_CONTEXT_H
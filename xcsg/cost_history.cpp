@@ -0,0 +1,57 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "cost_history.h"
+#include <algorithm>
+
+// the history is cleared when it grows beyond this number of subtrees
+static const size_t max_subtrees = 100000;
+
+cost_history::cost_history()
+: m_total_units(0)
+, m_total_seconds(0)
+{}
+
+cost_history::~cost_history()
+{}
+
+void cost_history::record(const std::string& key, double units, double seconds)
+{
+   if(key.length() == 0) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(m_seconds.size() >= max_subtrees) {
+      m_seconds.clear();
+      m_total_units   = 0;
+      m_total_seconds = 0;
+   }
+
+   // later evaluations may be instance or cache hits, keep the longest time as the cost of the subtree
+   double& sec = m_seconds[key];
+   sec = std::max(sec,seconds);
+   m_total_units   += units;
+   m_total_seconds += seconds;
+}
+
+double cost_history::estimate(const std::string& key, double units) const
+{
+   if(key.length() == 0) return units;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   auto it = m_seconds.find(key);
+   if(it == m_seconds.end() || m_total_seconds <= 0) return units;
+   return it->second*m_total_units/m_total_seconds;
+}
@@ -0,0 +1,53 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef COST_HISTORY_H
+#define COST_HISTORY_H
+
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+// cost_history remembers how long CSG subtrees took to compute, so that later evaluations of
+// the same subtree can be scheduled by measured rather than estimated cost. Subtrees are
+// identified by their mesh_cache subtree hash, the history is process wide and is kept
+// between compilations, e.g. in server mode.
+//
+// Costs are expressed in units of the static estimate (booleans in the subtree + 1). Measured
+// times are converted to units with the average seconds per unit of all recorded subtrees.
+
+class cost_history {
+public:
+   static cost_history& singleton()  { static cost_history instance; return instance;  }
+
+   // record that subtree key, estimated at units, took seconds to compute
+   void record(const std::string& key, double units, double seconds);
+
+   // cost of subtree key in units, from its measured time when known, otherwise units
+   double estimate(const std::string& key, double units) const;
+
+protected:
+   cost_history();
+   virtual ~cost_history();
+
+private:
+   mutable std::mutex                      m_mutex;
+   std::unordered_map<std::string,double>  m_seconds;        // longest time seen per subtree
+   double                                  m_total_units;
+   double                                  m_total_seconds;
+};
+
+#endif // COST_HISTORY_H
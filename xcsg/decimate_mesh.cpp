@@ -0,0 +1,275 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "decimate_mesh.h"
+#include "trace_recorder.h"
+#include <algorithm>
+#include <cmath>
+#include <queue>
+#include <tuple>
+#include <vector>
+
+typedef carve::geom3d::Vector vec3;
+
+// symmetric 4x4 quadric, upper triangle of [A b; b c]
+struct quadric {
+   double q[10] = {0,0,0,0,0,0,0,0,0,0};
+
+   void add_plane(const vec3& n, double d, double w)
+   {
+      q[0] += w*n.x*n.x; q[1] += w*n.x*n.y; q[2] += w*n.x*n.z; q[3] += w*n.x*d;
+      q[4] += w*n.y*n.y; q[5] += w*n.y*n.z; q[6] += w*n.y*d;
+      q[7] += w*n.z*n.z; q[8] += w*n.z*d;
+      q[9] += w*d*d;
+   }
+
+   quadric& operator+=(const quadric& other)
+   {
+      for(int i=0; i<10; i++) q[i] += other.q[i];
+      return *this;
+   }
+
+   double error(const vec3& v) const
+   {
+      return      q[0]*v.x*v.x + 2*q[1]*v.x*v.y + 2*q[2]*v.x*v.z + 2*q[3]*v.x
+                + q[4]*v.y*v.y + 2*q[5]*v.y*v.z + 2*q[6]*v.y
+                + q[7]*v.z*v.z + 2*q[8]*v.z
+                + q[9];
+   }
+
+   // position of least error, false if A is singular
+   bool optimum(vec3& v) const
+   {
+      double det =  q[0]*(q[4]*q[7]-q[5]*q[5]) - q[1]*(q[1]*q[7]-q[5]*q[2]) + q[2]*(q[1]*q[5]-q[4]*q[2]);
+      double tr  =  q[0] + q[4] + q[7];
+      if(!(std::fabs(det) > 1.0E-10*tr*tr*tr)) return false;
+
+      // Cramer's rule for A v = -b
+      double bx = -q[3], by = -q[6], bz = -q[8];
+      v.x = (bx*(q[4]*q[7]-q[5]*q[5]) - q[1]*(by*q[7]-q[5]*bz) + q[2]*(by*q[5]-q[4]*bz))/det;
+      v.y = (q[0]*(by*q[7]-bz*q[5]) - bx*(q[1]*q[7]-q[5]*q[2]) + q[2]*(q[1]*bz-by*q[2]))/det;
+      v.z = (q[0]*(q[4]*bz-q[5]*by) - q[1]*(q[1]*bz-by*q[2]) + bx*(q[1]*q[5]-q[4]*q[2]))/det;
+      return true;
+   }
+};
+
+// candidate collapse of edge (v0,v1) to pos, valid while the vertex stamps are unchanged
+struct collapse {
+   double   cost;
+   uint32_t v0,v1;
+   uint32_t stamp0,stamp1;
+   vec3     pos;
+
+   // least cost on top, ties by vertex index for a deterministic order
+   bool operator<(const collapse& other) const { return std::tie(cost,v0,v1) > std::tie(other.cost,other.v0,other.v1); }
+};
+
+class decimator {
+public:
+   decimator(const triangle_mesh& mesh)
+   : m_vert(mesh.v_size())
+   , m_tri(3*mesh.t_size())
+   , m_quadric(mesh.v_size())
+   , m_vtri(mesh.v_size())
+   , m_stamp(mesh.v_size(),0)
+   , m_vdead(mesh.v_size(),false)
+   , m_tdead(mesh.t_size(),false)
+   , m_live(mesh.t_size())
+   {
+      for(size_t iv=0; iv<mesh.v_size(); iv++) m_vert[iv] = mesh.v_get(iv);
+      for(uint32_t it=0; it<mesh.t_size(); it++) {
+         const uint32_t* tri = mesh.t_get(it);
+         for(size_t k=0; k<3; k++) {
+            m_tri[3*it+k] = tri[k];
+            m_vtri[tri[k]].push_back(it);
+         }
+         vec3 n = normal(it);
+         double area2 = n.length();
+         if(area2 > 0) {
+            n /= area2;
+            quadric q;
+            q.add_plane(n,-carve::geom::dot(n,m_vert[tri[0]]),0.5*area2);
+            for(size_t k=0; k<3; k++) m_quadric[tri[k]] += q;
+         }
+      }
+   }
+
+   void run(size_t target_faces, double max_error)
+   {
+      // each edge is shared by 2 triangles in opposite directions, so it is pushed once
+      for(uint32_t it=0; it<m_tdead.size(); it++) {
+         for(size_t k=0; k<3; k++) {
+            uint32_t a = m_tri[3*it+k], b = m_tri[3*it+(k+1)%3];
+            if(a < b) push(a,b);
+         }
+      }
+
+      double max_cost = max_error*max_error;
+      while(!m_heap.empty() && m_live > 4 && (target_faces == 0 || m_live > target_faces)) {
+         collapse c = m_heap.top();
+         m_heap.pop();
+         if(m_vdead[c.v0] || m_vdead[c.v1] || m_stamp[c.v0] != c.stamp0 || m_stamp[c.v1] != c.stamp1) continue;
+         if(max_error > 0 && c.cost > max_cost) break;
+         if(!can_collapse(c.v0,c.v1,c.pos)) continue;
+         apply(c);
+      }
+   }
+
+   std::shared_ptr<triangle_mesh> result() const
+   {
+      // remaining vertices keep their relative order
+      std::vector<uint32_t> index(m_vert.size(),0);
+      std::vector<vec3> vert;
+      for(size_t iv=0; iv<m_vert.size(); iv++) {
+         if(m_vdead[iv]) continue;
+         index[iv] = static_cast<uint32_t>(vert.size());
+         vert.push_back(m_vert[iv]);
+      }
+      std::vector<uint32_t> tri;
+      tri.reserve(3*m_live);
+      for(size_t it=0; it<m_tdead.size(); it++) {
+         if(m_tdead[it]) continue;
+         for(size_t k=0; k<3; k++) tri.push_back(index[m_tri[3*it+k]]);
+      }
+      return triangle_mesh::create(std::move(vert),std::move(tri));
+   }
+
+private:
+   // twice the area times the unit normal
+   vec3 normal(uint32_t it) const
+   {
+      const uint32_t* tri = &m_tri[3*it];
+      return carve::geom::cross(m_vert[tri[1]]-m_vert[tri[0]],m_vert[tri[2]]-m_vert[tri[0]]);
+   }
+
+   void push(uint32_t a, uint32_t b)
+   {
+      quadric q = m_quadric[a];
+      q += m_quadric[b];
+
+      // the optimum may not exist (flat or straight neighbourhood), then the best of the end points and the mid point is used
+      collapse c;
+      if(!q.optimum(c.pos)) {
+         vec3 mid = 0.5*(m_vert[a]+m_vert[b]);
+         double ea = q.error(m_vert[a]), eb = q.error(m_vert[b]), em = q.error(mid);
+         c.pos = (ea <= eb && ea <= em)? m_vert[a] : ((eb <= em)? m_vert[b] : mid);
+      }
+      c.cost   = std::max(0.0,q.error(c.pos));
+      c.v0     = a;
+      c.v1     = b;
+      c.stamp0 = m_stamp[a];
+      c.stamp1 = m_stamp[b];
+      m_heap.push(c);
+   }
+
+   // the sorted vertices sharing a live triangle with v
+   void neighbours(uint32_t v, std::vector<uint32_t>& nb) const
+   {
+      nb.clear();
+      for(uint32_t it : m_vtri[v]) {
+         if(m_tdead[it]) continue;
+         for(size_t k=0; k<3; k++) if(m_tri[3*it+k] != v) nb.push_back(m_tri[3*it+k]);
+      }
+      std::sort(nb.begin(),nb.end());
+      nb.erase(std::unique(nb.begin(),nb.end()),nb.end());
+   }
+
+   bool can_collapse(uint32_t a, uint32_t b, const vec3& pos)
+   {
+      // link condition: a and b are joined by 2 triangles, and share no other neighbours
+      size_t nshared = 0;
+      for(uint32_t it : m_vtri[a]) {
+         if(m_tdead[it]) continue;
+         const uint32_t* tri = &m_tri[3*it];
+         if(tri[0]==b || tri[1]==b || tri[2]==b) nshared++;
+      }
+      if(nshared != 2) return false;
+      neighbours(a,m_nb0);
+      neighbours(b,m_nb1);
+      m_common.clear();
+      std::set_intersection(m_nb0.begin(),m_nb0.end(),m_nb1.begin(),m_nb1.end(),std::back_inserter(m_common));
+      if(m_common.size() != 2) return false;
+
+      // the remaining triangles of a and b must not flip or degenerate when moved to pos
+      for(uint32_t v : {a,b}) {
+         for(uint32_t it : m_vtri[v]) {
+            if(m_tdead[it]) continue;
+            const uint32_t* tri = &m_tri[3*it];
+            bool has_a = (tri[0]==a || tri[1]==a || tri[2]==a);
+            bool has_b = (tri[0]==b || tri[1]==b || tri[2]==b);
+            if(has_a && has_b) continue;
+
+            vec3 p[3];
+            for(size_t k=0; k<3; k++) p[k] = (tri[k]==v)? pos : m_vert[tri[k]];
+            vec3 n0 = normal(it);
+            vec3 n1 = carve::geom::cross(p[1]-p[0],p[2]-p[0]);
+            double len0 = n0.length(), len1 = n1.length();
+            if(!(len1 > 0.0) || carve::geom::dot(n0,n1) < 0.2*len0*len1) return false;
+         }
+      }
+      return true;
+   }
+
+   // collapse b into a at c.pos
+   void apply(const collapse& c)
+   {
+      uint32_t a = c.v0, b = c.v1;
+      for(uint32_t it : m_vtri[b]) {
+         if(m_tdead[it]) continue;
+         uint32_t* tri = &m_tri[3*it];
+         if(tri[0]==a || tri[1]==a || tri[2]==a) {
+            m_tdead[it] = true;
+            m_live--;
+         }
+         else {
+            for(size_t k=0; k<3; k++) if(tri[k]==b) tri[k] = a;
+            m_vtri[a].push_back(it);
+         }
+      }
+      std::vector<uint32_t>().swap(m_vtri[b]);
+      m_vdead[b] = true;
+
+      std::vector<uint32_t>& vtri = m_vtri[a];
+      vtri.erase(std::remove_if(vtri.begin(),vtri.end(),[this](uint32_t it) { return m_tdead[it]; }),vtri.end());
+
+      m_vert[a] = c.pos;
+      m_quadric[a] += m_quadric[b];
+      m_stamp[a]++;
+      neighbours(a,m_nb0);
+      for(uint32_t n : m_nb0) push(std::min(a,n),std::max(a,n));
+   }
+
+private:
+   std::vector<vec3>                  m_vert;
+   std::vector<uint32_t>              m_tri;
+   std::vector<quadric>               m_quadric;
+   std::vector<std::vector<uint32_t>> m_vtri;    // live and dead triangles of each vertex
+   std::vector<uint32_t>              m_stamp;   // changed when the vertex is moved
+   std::vector<bool>                  m_vdead;
+   std::vector<bool>                  m_tdead;
+   size_t                             m_live;    // triangles remaining
+   std::priority_queue<collapse>      m_heap;
+   std::vector<uint32_t>              m_nb0,m_nb1,m_common;
+};
+
+std::shared_ptr<triangle_mesh> decimate_mesh::decimate(const triangle_mesh& mesh, size_t target_faces, double max_error)
+{
+   trace_recorder::span span("decimate_mesh::decimate");
+
+   decimator dec(mesh);
+   dec.run(target_faces,max_error);
+   return dec.result();
+}
@@ -0,0 +1,38 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef DECIMATE_MESH_H
+#define DECIMATE_MESH_H
+
+#include <memory>
+#include "triangle_mesh.h"
+
+// decimate_mesh reduces the triangles of a closed lump by quadric error edge collapse
+// (Garland & Heckbert). Each vertex has the sum of the area weighted plane quadrics of its
+// triangles, and the edge whose collapse to the position of least quadric error costs the
+// least is collapsed first. A collapse is rejected when it would make the mesh non-manifold
+// (the edge end points must share exactly the 2 vertices opposite the edge), when it would flip
+// or degenerate a triangle, or when fewer than 4 triangles would remain, so a water-tight lump
+// stays water-tight. Collapsing stops at target_faces triangles, or when the least cost exceeds
+// max_error squared (the quadric error is a sum of squared distances). A limit of 0 is not used.
+// One lump is decimated sequentially and deterministically, separate lumps may run concurrently.
+
+class decimate_mesh {
+public:
+   static std::shared_ptr<triangle_mesh> decimate(const triangle_mesh& mesh, size_t target_faces, double max_error);
+};
+
+#endif // DECIMATE_MESH_H
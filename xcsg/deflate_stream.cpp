@@ -0,0 +1,130 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "deflate_stream.h"
+#include <algorithm>
+#include <stdexcept>
+#include <zlib.h>
+
+static const size_t dict_size = 32768;   // deflate window
+
+deflate_stream::deflate_stream(FILE* file, int level)
+: m_file(file)
+, m_level(level)
+, m_crc(0)
+, m_size(0)
+, m_csize(0)
+, m_current(new block)
+{
+   m_current->in.reserve(block_size);
+}
+
+deflate_stream::~deflate_stream()
+{
+   // the running blocks are referenced by the compression tasks
+   try { thread_pool::singleton().wait(m_group); }
+   catch(...) {}
+}
+
+void deflate_stream::write(const char* data, size_t nbytes)
+{
+   if(!m_current) throw std::logic_error("deflate_stream: stream is finished");
+   while(nbytes > 0) {
+      size_t n = std::min(nbytes,block_size - m_current->in.size());
+      m_current->in.insert(m_current->in.end(),data,data+n);
+      data   += n;
+      nbytes -= n;
+      if(m_current->in.size() == block_size) push_block(false);
+   }
+}
+
+void deflate_stream::compress(block& b, int level)
+{
+   b.crc = static_cast<uint32_t>(crc32(0,reinterpret_cast<const Bytef*>(b.in.data()),static_cast<uInt>(b.in.size())));
+
+   // raw deflate. All blocks but the last end with a sync flush on a byte boundary,
+   // so the blocks concatenate to one deflate stream
+   z_stream zs = {};
+   if(deflateInit2(&zs,level,Z_DEFLATED,-15,8,Z_DEFAULT_STRATEGY) != Z_OK) throw std::runtime_error("deflate_stream: deflateInit2 failed");
+   if(b.dict.size() > 0) deflateSetDictionary(&zs,reinterpret_cast<const Bytef*>(b.dict.data()),static_cast<uInt>(b.dict.size()));
+
+   b.out.resize(deflateBound(&zs,static_cast<uLong>(b.in.size())) + 16);
+   zs.next_in   = reinterpret_cast<Bytef*>(b.in.data());
+   zs.avail_in  = static_cast<uInt>(b.in.size());
+   int flush    = (b.last)? Z_FINISH : Z_SYNC_FLUSH;
+   size_t done  = 0;
+   int status   = Z_OK;
+   do {
+      if(done == b.out.size()) b.out.resize(2*b.out.size());
+      zs.next_out  = b.out.data() + done;
+      zs.avail_out = static_cast<uInt>(b.out.size() - done);
+      status = deflate(&zs,flush);
+      done   = b.out.size() - zs.avail_out;
+   } while(status == Z_OK && (zs.avail_out == 0 || (b.last && status != Z_STREAM_END)));
+   deflateEnd(&zs);
+   if(status != Z_OK && status != Z_STREAM_END && status != Z_BUF_ERROR) throw std::runtime_error("deflate_stream: deflate failed");
+   b.out.resize(done);
+
+   b.size = b.in.size();
+   std::vector<char>().swap(b.in);
+   std::vector<char>().swap(b.dict);
+}
+
+void deflate_stream::push_block(bool last)
+{
+   m_current->last = last;
+   std::unique_ptr<block> next;
+   if(!last) {
+      next.reset(new block);
+      next->in.reserve(block_size);
+      size_t n = std::min(dict_size,m_current->in.size());
+      next->dict.assign(m_current->in.end()-n,m_current->in.end());
+   }
+   m_pending.push_back(std::move(m_current));
+   m_current = std::move(next);
+
+   // one batch is compressed while the next is filled
+   if(last || m_pending.size() >= std::max<size_t>(thread_pool::singleton().nthreads(),1)) {
+      drain();
+      m_running.swap(m_pending);
+      for(auto& b : m_running) {
+         block* pb  = b.get();
+         int level  = m_level;
+         thread_pool::singleton().submit(m_group,[pb,level]() { compress(*pb,level); });
+      }
+   }
+}
+
+void deflate_stream::drain()
+{
+   thread_pool::singleton().wait(m_group);
+   for(auto& b : m_running) {
+      if(b->out.size() > 0 && std::fwrite(b->out.data(),1,b->out.size(),m_file) != b->out.size()) throw std::runtime_error("deflate_stream: write error");
+      m_crc    = static_cast<uint32_t>(crc32_combine(m_crc,b->crc,static_cast<z_off_t>(b->size)));
+      m_size  += b->size;
+      m_csize += b->out.size();
+   }
+   m_running.clear();
+}
+
+void deflate_stream::finish()
+{
+   if(!m_current) return;
+
+   // the last block may be empty, it still ends the deflate stream
+   push_block(true);
+   drain();
+}
@@ -0,0 +1,82 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef DEFLATE_STREAM_H
+#define DEFLATE_STREAM_H
+
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "thread_pool.h"
+
+// deflate_stream writes one raw deflate stream to an open file, for the compressed file formats
+// (zip_file, gz_file). The data is deflated in blocks of block_size bytes. The blocks are compressed
+// in parallel on the thread pool while the caller produces the next blocks, each block primed with
+// the end of the previous one, and are written in order. The crc32 and sizes are available after finish.
+//
+// Write errors are thrown as std::runtime_error
+
+class deflate_stream {
+public:
+   deflate_stream(FILE* file, int level = -1);
+   virtual ~deflate_stream();
+
+   // append uncompressed data
+   void write(const char* data, size_t nbytes);
+
+   // end the deflate stream, waiting for its blocks to be compressed and written
+   void finish();
+
+   // crc32 and size of the uncompressed data, size of the compressed data
+   uint32_t crc() const   { return m_crc; }
+   uint64_t size() const  { return m_size; }
+   uint64_t csize() const { return m_csize; }
+
+   static const size_t block_size = 1<<20;
+
+protected:
+   struct block {
+      std::vector<char>          in;      // uncompressed data
+      std::vector<char>          dict;    // end of previous block
+      std::vector<unsigned char> out;     // deflated data
+      size_t                     size = 0;    // of in, after compression
+      uint32_t                   crc = 0;
+      bool                       last = false;
+   };
+
+   // deflate one block, run on the thread pool
+   static void compress(block& b, int level);
+
+   // move the current block to the pending batch, starting compression when the batch is full
+   void push_block(bool last);
+
+   // wait for the batch being compressed and write it
+   void drain();
+
+private:
+   FILE*                                m_file;
+   int                                  m_level;
+   uint32_t                             m_crc;
+   uint64_t                             m_size;
+   uint64_t                             m_csize;
+   std::unique_ptr<block>               m_current;
+   std::vector<std::unique_ptr<block>>  m_pending;     // filled blocks not yet submitted
+   std::vector<std::unique_ptr<block>>  m_running;     // blocks being compressed
+   thread_pool::task_group              m_group;
+};
+
+#endif // DEFLATE_STREAM_H
@@ -0,0 +1,164 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "difference_planner.h"
+#include "carve_boolean.h"
+#include "carve_boolean_thread.h"
+#include "boolean_timer.h"
+#include "thread_pool.h"
+#include "trace_recorder.h"
+#include <algorithm>
+#include <cmath>
+
+std::string difference_planner::strategy_name(strategy s)
+{
+   switch(s) {
+      case subtract_union:   return "union";
+      case subtract_regions: return "regions";
+   };
+   return "unknown";
+}
+
+double difference_planner::union_cost(const std::vector<const cutter*>& cutters)
+{
+   if(cutters.size() < 2) return 0.0;
+   size_t nfaces = 0;
+   for(auto c : cutters) nfaces += c->nfaces;
+   double nlevels = std::ceil(std::log2(static_cast<double>(cutters.size())));
+   return nlevels*boolean_timer::boolean_cost(nfaces/2,nfaces-nfaces/2);
+}
+
+std::vector<difference_planner::MeshSet_ptr> difference_planner::split_lumps(const MeshSet_ptr& a)
+{
+   std::vector<MeshSet_ptr> lumps;
+   if(!carve_boolean::disjoint_lumps(*a)) return lumps;
+
+   lumps.reserve(a->meshes.size());
+   for(size_t imesh=0; imesh<a->meshes.size(); imesh++) {
+      lumps.push_back(carve_boolean::copy_meshes(*a,std::vector<size_t>{imesh}));
+   }
+   return lumps;
+}
+
+difference_planner::MeshSet_ptr difference_planner::compute_union(std::vector<MeshSet_ptr> meshes)
+{
+   safe_queue<MeshSet_ptr> mesh_queue;
+   for(auto& mesh : meshes) mesh_queue.enqueue(std::move(mesh));
+   meshes.clear();
+   carve_boolean_thread::reduce(mesh_queue,carve::csg::CSG::UNION);
+   return mesh_queue.dequeue();
+}
+
+difference_planner::MeshSet_ptr difference_planner::subtract_one(MeshSet_ptr a, std::vector<MeshSet_ptr> cutters)
+{
+   MeshSet_ptr b = compute_union(std::move(cutters));
+   try {
+      carve_boolean csg;
+      csg.compute(std::move(a),carve::csg::CSG::UNION);
+      csg.compute(std::move(b),carve::csg::CSG::A_MINUS_B);
+      csg.simplify();
+      return csg.release();
+   }
+   catch(carve::exception& ex) {
+      throw std::runtime_error("(carve error): " + ex.str());
+   }
+}
+
+difference_planner::MeshSet_ptr difference_planner::subtract(MeshSet_ptr a, std::vector<MeshSet_ptr>& meshes)
+{
+   trace_recorder::span span("difference_planner::subtract");
+
+   if(carve_boolean::is_empty(a)) return a;
+
+   // empty cutters and cutters outside the box of a remove nothing, their booleans are counted as disjoint
+   xbox3d abox(*a);
+   std::vector<cutter> cutters;
+   cutters.reserve(meshes.size());
+   for(auto& mesh : meshes) {
+      xbox3d box(*mesh);
+      if(box.initialised() && box.intersects(abox)) {
+         size_t nfaces = carve_boolean::face_count(mesh);
+         cutters.push_back({std::move(mesh),box,nfaces});
+      }
+      else {
+         boolean_timer::singleton().add_disjoint(true);
+         boolean_timer::singleton().add_elapsed(0.0);
+      }
+   }
+   meshes.clear();
+   if(cutters.size() == 0) return a;
+
+   // cost of one union of all cutters and one subtraction
+   std::vector<const cutter*> all;
+   size_t nfaces_cut = 0;
+   for(auto& c : cutters) {
+      all.push_back(&c);
+      nfaces_cut += c.nfaces;
+   }
+   size_t nfaces_a = carve_boolean::face_count(a);
+   double nthreads = static_cast<double>(std::max(size_t(1),thread_pool::singleton().nthreads()));
+   double cost_union = union_cost(all)/nthreads + boolean_timer::boolean_cost(nfaces_a,nfaces_cut);
+
+   // cost of subtracting per lump, cutters overlapping several lumps count in each.
+   // The lumps run in parallel, so the largest one may dominate
+   strategy choice = subtract_union;
+   std::vector<MeshSet_ptr> lumps;
+   std::vector<std::vector<const cutter*>> lump_cutters;
+   if(a->meshes.size() > 1 && cutters.size() > 1) {
+      lumps = split_lumps(a);
+      double total = 0.0, largest = 0.0;
+      for(auto& lump : lumps) {
+         xbox3d box(*lump);
+         std::vector<const cutter*> hits;
+         for(auto& c : cutters) if(c.box.intersects(box)) hits.push_back(&c);
+         size_t nfaces_hit = 0;
+         for(auto c : hits) nfaces_hit += c->nfaces;
+         double cost = (hits.size() > 0)? union_cost(hits) + boolean_timer::boolean_cost(carve_boolean::face_count(lump),nfaces_hit) : 0.0;
+         total  += cost;
+         largest = std::max(largest,cost);
+         lump_cutters.push_back(hits);
+      }
+      double cost_regions = std::max(total/nthreads,largest);
+      if(lumps.size() > 1 && cost_regions < cost_union) choice = subtract_regions;
+   }
+
+   if(choice == subtract_union) {
+      std::vector<MeshSet_ptr> b;
+      b.reserve(cutters.size());
+      for(auto& c : cutters) b.push_back(std::move(c.mesh));
+      cutters.clear();
+      return subtract_one(std::move(a),std::move(b));
+   }
+
+   // regions: lumps without cutters are kept as they are
+   a.reset();
+   thread_pool::task_group group;
+   for(size_t ilump=0; ilump<lumps.size(); ilump++) {
+      if(lump_cutters[ilump].size() == 0) continue;
+      thread_pool::singleton().submit(group,[&lumps,&lump_cutters,ilump]() {
+         std::vector<MeshSet_ptr> b;
+         for(auto c : lump_cutters[ilump]) b.push_back(c->mesh);
+         lumps[ilump] = subtract_one(std::move(lumps[ilump]),std::move(b));
+      });
+   }
+   thread_pool::singleton().wait(group);
+
+   // the lumps were disjoint, and subtracting only removes material
+   std::vector<MeshSet_ptr> results;
+   for(auto& lump : lumps) if(lump->meshes.size() > 0) results.push_back(lump);
+   if(results.size() == 1) return results[0];
+   if(results.size() == 0) return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
+   return carve_boolean::concatenate(results);
+}
@@ -0,0 +1,66 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef DIFFERENCE_PLANNER_H
+#define DIFFERENCE_PLANNER_H
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <carve/csg.hpp>
+#include "xbox3d.h"
+
+// difference_planner subtracts many cutters from a mesh, choosing how per difference3d node.
+// Cutters whose bounding box misses the mesh are dropped first. Then the cheaper of two
+// strategies is chosen from the bounding box overlaps, using the boolean cost model of boolean_timer:
+//
+//    subtract_union    union all cutters, then subtract the union in one boolean
+//    subtract_regions  split the mesh into its lumps and subtract from each lump only the cutters
+//                      overlapping it, the lumps are processed in parallel. This pays off when
+//                      scattered cutters each hit a small part of a mesh with many lumps
+//
+// A mesh with internal voids, or one that is not closed, is always handled as one region.
+
+class difference_planner {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   enum strategy {
+      subtract_union,
+      subtract_regions
+   };
+   static std::string strategy_name(strategy s);
+
+   // compute a minus the union of cutters. The cutters are moved out of the vector
+   static MeshSet_ptr subtract(MeshSet_ptr a, std::vector<MeshSet_ptr>& cutters);
+
+   // split a into one mesh set per lump, empty if a has voids or open meshes
+   static std::vector<MeshSet_ptr> split_lumps(const MeshSet_ptr& a);
+
+private:
+   struct cutter {
+      MeshSet_ptr mesh;
+      xbox3d      box;
+      size_t      nfaces;
+   };
+
+   // estimated cost of unioning the cutters, pairwise in a balanced tree
+   static double union_cost(const std::vector<const cutter*>& cutters);
+
+   static MeshSet_ptr compute_union(std::vector<MeshSet_ptr> meshes);
+   static MeshSet_ptr subtract_one(MeshSet_ptr a, std::vector<MeshSet_ptr> cutters);
+};
+
+#endif // DIFFERENCE_PLANNER_H
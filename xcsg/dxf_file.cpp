@@ -15,6 +15,9 @@
 
 #include "dxf_file.h"
 #include "clipper_csg/polyset2d.h"
+#include "char_buffer.h"
+#include <cstdio>
+#include <stdexcept>
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
 
@@ -24,19 +27,19 @@ dxf_file::dxf_file()
 dxf_file::~dxf_file()
 {}
 
-void dxf_file::write_item(int gc, const std::string& value)
+void dxf_file::write_item(char_buffer& out, int gc, const char* value)
 {
-   m_out << "  " << gc <<  std::endl << value <<  std::endl;
+   out.append("  ").append(gc).append('\n').append(value).append('\n');
 }
 
-void dxf_file::write_item(int gc, double value)
+void dxf_file::write_item(char_buffer& out, int gc, double value)
 {
-   m_out << "  " << gc <<  std::endl << value <<  std::endl;
+   out.append("  ").append(gc).append('\n').append(value).append('\n');
 }
 
-void dxf_file::write_item(int gc, int value)
+void dxf_file::write_item(char_buffer& out, int gc, int value)
 {
-   m_out << "  " << gc <<  std::endl << value <<  std::endl;
+   out.append("  ").append(gc).append('\n').append(value).append('\n');
 }
 
 
@@ -49,44 +52,80 @@ std::string dxf_file::write( std::shared_ptr<polyset2d> polyset, const std::stri
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
-   m_out.open(path);
-   if(!m_out.is_open())  throw std::runtime_error("Could not open file: " + path);
+   FILE* file = std::fopen(path.c_str(),"w");
+   if(!file)  throw std::runtime_error("Could not open file: " + path);
+   bool ok = false;
+   try {
+      ok = encode(polyset,[file](char_buffer& buf) { return buf.flush(file); });
+   }
+   catch(...) {
+      std::fclose(file);
+      throw;
+   }
+   ok = (std::fclose(file) == 0) && ok;
+   if(!ok) throw std::runtime_error("Could not write file: " + path);
+
+   return path;
+}
+
+void dxf_file::write( std::shared_ptr<polyset2d> polyset, std::ostream& out)
+{
+   if(!encode(polyset,[&out](char_buffer& buf) { return buf.flush(out); })) throw std::runtime_error("Could not write DXF to stream");
+}
+
+bool dxf_file::encode(std::shared_ptr<polyset2d> polyset, std::function<bool(char_buffer&)> write)
+{
+   char_buffer out;
 
    // write header
-   write_item(999,"DXF file created by xcsg (https://github.com/arnholm/xcsg)");
-   write_item(0,"SECTION");
-   write_item(2,"BLOCKS");
-   write_item(0,"ENDSEC");
+   write_item(out,999,"DXF file created by xcsg (https://github.com/arnholm/xcsg)");
+   write_item(out,0,"SECTION");
+   write_item(out,2,"BLOCKS");
+   write_item(out,0,"ENDSEC");
 
    // write entities, only LWPOLYLINE written
-   write_item(0,"SECTION");
-   write_item(2,"ENTITIES");
+   write_item(out,0,"SECTION");
+   write_item(out,2,"ENTITIES");
+   bool ok = write(out);
+
+   // the polylines are encoded in parallel chunks of about chunk_points points, and written in order
+   const size_t chunk_points = 1<<14;
+   std::vector<std::shared_ptr<contour2d>> contours;
+   std::vector<size_t> chunks(1,0);
+   size_t npoints = 0;
    for(auto i=polyset->begin(); i!=polyset->end(); i++) {
       std::shared_ptr<polygon2d> poly = *i;
       size_t nc = poly->size();
       for(size_t ic=0;ic<nc;ic++) {
-         write_lwpolyline(poly->get_contour(ic));
+         contours.push_back(poly->get_contour(ic));
+         npoints += contours.back()->size();
+         if(npoints >= chunk_points) { chunks.push_back(contours.size()); npoints = 0; }
       }
    }
-   write_item(0,"ENDSEC");
+   if(chunks.back() != contours.size()) chunks.push_back(contours.size());
 
-   // write footer
-   write_item(0,"SECTION");
-   write_item(2,"OBJECTS");
-   write_item(0,"ENDSEC");
-   write_item(0,"EOF");
+   ok = char_buffer::write_ordered(chunks.size()-1,[this,&contours,&chunks](size_t ichunk, char_buffer& buf) {
+      for(size_t ic=chunks[ichunk]; ic<chunks[ichunk+1]; ic++) write_lwpolyline(buf,contours[ic]);
+   },write) && ok;
 
-   return path;
+   write_item(out,0,"ENDSEC");
+
+   // write footer
+   write_item(out,0,"SECTION");
+   write_item(out,2,"OBJECTS");
+   write_item(out,0,"ENDSEC");
+   write_item(out,0,"EOF");
+   return write(out) && ok;
 }
 
-void dxf_file::write_lwpolyline(std::shared_ptr<contour2d> contour)
+void dxf_file::write_lwpolyline(char_buffer& out, std::shared_ptr<contour2d> contour)
 {
-   write_item(0,"LWPOLYLINE");
-   write_item(8,0);  // layer 0
-   write_item(70,1); // closed polyline
+   write_item(out,0,"LWPOLYLINE");
+   write_item(out,8,0);  // layer 0
+   write_item(out,70,1); // closed polyline
    for(size_t i=0; i<contour->size();i++) {
       const dpos2d& vtx = (*contour)[i];
-      write_item(10,vtx.x());
-      write_item(20,vtx.y());
+      write_item(out,10,vtx.x());
+      write_item(out,20,vtx.y());
    }
 }
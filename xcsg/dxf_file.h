@@ -16,9 +16,11 @@
 #ifndef DXF_FILE_H
 #define DXF_FILE_H
 
+#include <functional>
 #include <memory>
 #include <string>
-#include <fstream>
+#include <ostream>
+class char_buffer;
 class polyset2d;
 class contour2d;
 
@@ -31,14 +33,17 @@ public:
    // input is full path to file, file extension will be replaced to ".dxf"
    std::string  write( std::shared_ptr<polyset2d> polyset, const std::string& file_path);
 
+   // export to DXF on a caller supplied stream
+   void  write( std::shared_ptr<polyset2d> polyset, std::ostream& out);
+
 protected:
-   void write_item(int gc, const std::string& value);
-   void write_item(int gc, double value);
-   void write_item(int gc, int value);
-   void write_lwpolyline(std::shared_ptr<contour2d> contour);
+   // encode the DXF document, passing the text to write in order. Returns false on write error
+   bool encode(std::shared_ptr<polyset2d> polyset, std::function<bool(char_buffer&)> write);
 
-private:
-   std::ofstream m_out;
+   static void write_item(char_buffer& out, int gc, const char* value);
+   static void write_item(char_buffer& out, int gc, double value);
+   static void write_item(char_buffer& out, int gc, int value);
+   void write_lwpolyline(char_buffer& out, std::shared_ptr<contour2d> contour);
 };
 
 #endif // DXF_FILE_H
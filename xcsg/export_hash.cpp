@@ -0,0 +1,70 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "export_hash.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <boost/filesystem.hpp>
+
+export_hash::export_hash(const std::string& xcsg_path)
+{
+   boost::filesystem::path path(xcsg_path);
+   path.replace_extension(".xhash");
+   m_path = path.string();
+
+   std::ifstream in(m_path);
+   std::string line;
+   while(std::getline(in,line)) {
+      std::istringstream sin(line);
+      std::string format;
+      entry e;
+      if(!(sin >> format >> e.hash)) continue;
+      std::getline(sin >> std::ws,e.path);
+      if(e.path.length() > 0) m_entries[format] = e;
+   }
+}
+
+export_hash::~export_hash()
+{}
+
+bool export_hash::unchanged(const std::string& format, const std::string& hash, std::string& path) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   auto it = m_entries.find(format);
+   if(it == m_entries.end() || it->second.hash != hash) return false;
+
+   boost::system::error_code ec;
+   if(!boost::filesystem::exists(it->second.path,ec)) return false;
+   path = it->second.path;
+   return true;
+}
+
+void export_hash::set(const std::string& format, const std::string& hash, const std::string& path)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_entries[format] = entry{hash,path};
+}
+
+void export_hash::write() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   std::ofstream out(m_path);
+   for(auto& e : m_entries) {
+      out << e.first << ' ' << e.second.hash << ' ' << e.second.path << std::endl;
+   }
+   if(!out) throw std::logic_error("export_hash:: Failed to write: " + m_path);
+}
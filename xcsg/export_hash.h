@@ -0,0 +1,59 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef EXPORT_HASH_H
+#define EXPORT_HASH_H
+
+#include <map>
+#include <mutex>
+#include <string>
+
+// export_hash is the sidecar file next to an .xcsg file that records, per output format, the content
+// hash of the exported geometry and the file written. When an export would write the same content to
+// a file that still exists, it is skipped, so the file keeps its modification time and downstream
+// tools (slicers) watching it do not process it again. The sidecar is name.xhash, one line per format:
+//
+//    stl 9a3f0c27d81e4b65 /path/name.stl
+//
+// Lookups and updates may be called concurrently from the export tasks
+
+class export_hash {
+public:
+   // read the sidecar of xcsg_path, if it exists
+   export_hash(const std::string& xcsg_path);
+   virtual ~export_hash();
+
+   // true if format was last exported with content hash and its file still exists, the file is returned in path
+   bool unchanged(const std::string& format, const std::string& hash, std::string& path) const;
+
+   // record that format was exported with content hash to path
+   void set(const std::string& format, const std::string& hash, const std::string& path);
+
+   // write the sidecar
+   void write() const;
+
+private:
+   struct entry {
+      std::string hash;
+      std::string path;
+   };
+
+   std::string                  m_path;     // the sidecar file
+   mutable std::mutex           m_mutex;
+   std::map<std::string,entry>  m_entries;  // format -> last export
+};
+
+#endif // EXPORT_HASH_H
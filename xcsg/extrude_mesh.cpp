@@ -20,12 +20,31 @@
 #include "sweep_path_rotate.h"
 #include "sweep_path_transform.h"
 #include "sweep_path_spline.h"
+#include "message_log.h"
 #include "clipper_csg/dmesh_adapter.h"
 #include "clipper_csg/tmesh_adapter.h"
+#include "clipper_csg/monotone_adapter.h"
 #include "carve/mesh_simplify.hpp"
+#include <algorithm>
+#include <array>
+#include <limits>
 
 static const double pi = 4.0*atan(1.0);
 
+extrude_mesh::cap_strategy extrude_mesh::m_cap_strategy = extrude_mesh::cap_delaunay;
+
+std::shared_ptr<polymesh2d> extrude_mesh::tesselate(std::shared_ptr<polyset2d> polyset)
+{
+   if(m_cap_strategy == cap_monotone) {
+      monotone_adapter tess;
+      tess.tesselate(polyset);
+      return tess.mesh();
+   }
+   tmesh_adapter tess;
+   tess.tesselate(polyset);
+   return tess.mesh();
+}
+
 double extrude_mesh::evaluate_max_x(std::shared_ptr<carve::mesh::MeshSet<3>> meshset)
 {
    double max_x = -1.0;
@@ -45,12 +64,7 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::linear_extrude(std::share
    double maxlen = mesh_utils::maxlen_factor()*polyset->greatest_extent();
 
  //  dmesh_adapter tess(maxlen);
-   tmesh_adapter tess;
-   tess.tesselate(polyset);
-
-   std::shared_ptr<sweep_path_linear>  path(new sweep_path_linear(tess.mesh(),h));
-   std::shared_ptr<xpolyhedron> poly = sweep_mesh(path,false).polyhedron();
-   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh(t);
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = linear_extrude(tesselate(polyset),h,t);
 
 
    carve::mesh::MeshSimplifier simplifier;
@@ -60,6 +74,59 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::linear_extrude(std::share
    return meshset;
 }
 
+std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::linear_extrude(std::shared_ptr<const polymesh2d> pm2d, double h, const carve::math::Matrix& t)
+{
+   // The bottom and top layers are the profile vertices at z=0 and z=h. The faces are
+   // written straight into the face index list used by the meshset constructor, in the
+   // same order as sweep_mesh: bottom faces, side quads, top faces
+   const bool reverse_face = mesh_utils::is_left_hand(t);
+   const size_t nv = pm2d->nvertices();
+
+   std::vector<carve::geom3d::Vector> points(2*nv);
+   const carve::math::Matrix t_top = t*carve::math::Matrix::TRANS(0.0,0.0,h);
+   polymesh3d::transform_vertices(*pm2d,t,points.begin());
+   polymesh3d::transform_vertices(*pm2d,t_top,points.begin()+nv);
+
+   size_t nindex = 0;
+   for(size_t i=0; i<pm2d->nfaces(); i++) nindex += 1 + pm2d->face(i).size();
+   nindex *= 2;
+   size_t nside = 0;
+   for(size_t i=0; i<pm2d->ncontours(); i++) nside += pm2d->contour(i).size();
+   nindex += 5*nside;
+
+   std::vector<int> face_indices(nindex);
+   int* out = face_indices.empty()? 0 : &face_indices[0];
+
+   // bottom faces are flipped, top faces normally oriented
+   for(size_t ilayer=0; ilayer<2; ilayer++) {
+      const bool reverse = (ilayer==0) != reverse_face;
+      const int  offset  = static_cast<int>(ilayer*nv);
+      if(ilayer==1) {
+         // side quads between the layers
+         for(size_t ic=0; ic<pm2d->ncontours(); ic++) {
+            const polymesh2d::index_vector& vinds = pm2d->contour(ic);
+            const size_t nvc = vinds.size();
+            for(size_t ivc=0; ivc<nvc; ivc++) {
+               const int iv0 = static_cast<int>(vinds[ivc]);
+               const int iv1 = static_cast<int>((ivc==(nvc-1))? vinds[0] : vinds[ivc+1]);
+               const int nvi = static_cast<int>(nv);
+               *out++ = 4;
+               if(reverse_face) { *out++ = iv0+nvi; *out++ = iv1+nvi; *out++ = iv1; *out++ = iv0; }
+               else             { *out++ = iv0; *out++ = iv1; *out++ = iv1+nvi; *out++ = iv0+nvi; }
+            }
+         }
+      }
+      for(size_t i=0; i<pm2d->nfaces(); i++) {
+         const polymesh2d::index_vector& face = pm2d->face(i);
+         *out++ = static_cast<int>(face.size());
+         if(reverse) for(auto iv=face.rbegin(); iv!=face.rend(); iv++) *out++ = offset + static_cast<int>(*iv);
+         else        for(auto iv=face.begin(); iv!=face.end(); iv++)   *out++ = offset + static_cast<int>(*iv);
+      }
+   }
+
+   const size_t nfaces = 2*pm2d->nfaces() + nside;
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,nfaces,face_indices);
+}
 
 std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::rotate_extrude(std::shared_ptr<clipper_profile> profile, double angle, double pitch, const carve::math::Matrix& t)
 {
@@ -68,7 +135,7 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::rotate_extrude(std::share
    bool torus = ((fabs(angle) < 2*pi) || (fabs(pitch) > 0))? false : true;
    if(torus) {
       angle = -2*pi;
-      cout << "...Info: rotate_extrude angle>=2*PI implies a torus" << endl;
+      message_log::info() << "...Info: rotate_extrude angle>=2*PI implies a torus";
    }
 
    std::shared_ptr<polyset2d> polyset = profile->polyset();
@@ -76,15 +143,25 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::rotate_extrude(std::share
 
    // first tesselate the 2d mesh
   // dmesh_adapter tess(maxlen);
-   tmesh_adapter tess;
-   tess.tesselate(polyset);
+   std::shared_ptr<polymesh2d> pm2d = tesselate(polyset);
 
    // then use the 2d mesh as basis for sweep
-   std::shared_ptr<sweep_path_rotate>  path(new sweep_path_rotate(tess.mesh(),angle,pitch));
+   std::shared_ptr<sweep_path_rotate>  path(new sweep_path_rotate(pm2d,angle,pitch));
 
-   // extract the resulting polyhedron and turn it into a carve mesh
-   std::shared_ptr<xpolyhedron> poly = sweep_mesh(path, torus).polyhedron();
-   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh(t);
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset;
+   if(torus) {
+      // surface of revolution, the rings are computed directly
+      meshset = revolve(pm2d,path->nseg(),t);
+   }
+   else if(fabs(pitch) > 0) {
+      // helical sweep, the rings are computed directly
+      meshset = helix(path,pm2d,t);
+   }
+   else {
+      // extract the resulting polyhedron and turn it into a carve mesh
+      std::shared_ptr<xpolyhedron> poly = sweep_mesh(path, torus).polyhedron();
+      meshset = poly->create_carve_mesh(t);
+   }
 
    // cleanup
    carve::mesh::MeshSimplifier simplifier;
@@ -94,14 +171,299 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::rotate_extrude(std::share
    return meshset;
 }
 
+std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::revolve(std::shared_ptr<const polymesh2d> pm2d, size_t nseg, const carve::math::Matrix& t)
+{
+   const bool reverse_face = mesh_utils::is_left_hand(t);
+   const size_t nv = pm2d->nvertices();
+
+   // ring angles as in sweep_path_rotate, a profile point (x,y) is rotated to (x*cos,y,x*sin)
+   std::vector<double> cos_a(nseg),sin_a(nseg);
+   for(size_t iseg=0; iseg<nseg; iseg++) {
+      double angle = 2*pi*double(iseg)/double(nseg);
+      cos_a[iseg] = cos(angle);
+      sin_a[iseg] = sin(angle);
+   }
+
+   std::vector<carve::geom3d::Vector> points;
+   points.reserve(nseg*nv);
+   for(size_t iseg=0; iseg<nseg; iseg++) {
+      for(size_t iv=0; iv<nv; iv++) {
+         const dpos2d& p = pm2d->vertex(iv);
+         points.push_back(t*carve::geom::VECTOR(p.x()*cos_a[iseg],p.y(),p.x()*sin_a[iseg]));
+      }
+   }
+
+   // side quads only, the last ring connects to the first so the seam shares its vertices
+   size_t nside = 0;
+   for(size_t i=0; i<pm2d->ncontours(); i++) nside += pm2d->contour(i).size();
+
+   std::vector<int> face_indices;
+   face_indices.reserve(5*nseg*nside);
+   for(size_t iseg=0; iseg<nseg; iseg++) {
+      const int off0 = static_cast<int>(iseg*nv);
+      const int off1 = static_cast<int>(((iseg+1<nseg)? iseg+1 : 0)*nv);
+      for(size_t ic=0; ic<pm2d->ncontours(); ic++) {
+         const polymesh2d::index_vector& vinds = pm2d->contour(ic);
+         const size_t nvc = vinds.size();
+         for(size_t ivc=0; ivc<nvc; ivc++) {
+            const int iv0 = static_cast<int>(vinds[ivc]);
+            const int iv1 = static_cast<int>((ivc==(nvc-1))? vinds[0] : vinds[ivc+1]);
+            const int quad[4] = { off0+iv0, off0+iv1, off1+iv1, off1+iv0 };
+            face_indices.push_back(4);
+            for(size_t k=0; k<4; k++) face_indices.push_back(quad[(reverse_face)? 3-k : k]);
+         }
+      }
+   }
+
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,nseg*nside,face_indices);
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::helix(std::shared_ptr<const sweep_path_rotate> path, std::shared_ptr<const polymesh2d> pm2d, const carve::math::Matrix& t)
+{
+   const bool reverse_face = mesh_utils::is_left_hand(t);
+   const size_t nv   = pm2d->nvertices();
+   const size_t nseg = path->nseg();
+
+   // one ring of profile vertices per layer, as in sweep_mesh
+   std::vector<carve::geom3d::Vector> points(nv*(nseg+1));
+   for(size_t ilayer=0; ilayer<=nseg; ilayer++) {
+      polymesh3d::transform_vertices(*pm2d,t*path->layer_transform(ilayer),points.begin()+ilayer*nv);
+   }
+
+   size_t nside = 0;
+   for(size_t i=0; i<pm2d->ncontours(); i++) nside += pm2d->contour(i).size();
+   size_t ncap = 0;
+   for(size_t i=0; i<pm2d->nfaces(); i++) ncap += 1 + pm2d->face(i).size();
+
+   std::vector<int> face_indices;
+   face_indices.reserve(5*nseg*nside + 2*ncap);
+
+   // side quads between consecutive rings
+   for(size_t iseg=0; iseg<nseg; iseg++) {
+      const int off0 = static_cast<int>(iseg*nv);
+      const int off1 = static_cast<int>((iseg+1)*nv);
+      for(size_t ic=0; ic<pm2d->ncontours(); ic++) {
+         const polymesh2d::index_vector& vinds = pm2d->contour(ic);
+         const size_t nvc = vinds.size();
+         for(size_t ivc=0; ivc<nvc; ivc++) {
+            const int iv0 = static_cast<int>(vinds[ivc]);
+            const int iv1 = static_cast<int>((ivc==(nvc-1))? vinds[0] : vinds[ivc+1]);
+            const int quad[4] = { off0+iv0, off0+iv1, off1+iv1, off1+iv0 };
+            face_indices.push_back(4);
+            for(size_t k=0; k<4; k++) face_indices.push_back(quad[(reverse_face)? 3-k : k]);
+         }
+      }
+   }
+
+   // flipped profile faces on the first ring, normally oriented faces on the last
+   for(size_t ilayer : { size_t(0), nseg }) {
+      const bool reverse = (ilayer==0) != reverse_face;
+      const int  offset  = static_cast<int>(ilayer*nv);
+      for(size_t i=0; i<pm2d->nfaces(); i++) {
+         const polymesh2d::index_vector& face = pm2d->face(i);
+         face_indices.push_back(static_cast<int>(face.size()));
+         if(reverse) for(auto iv=face.rbegin(); iv!=face.rend(); iv++) face_indices.push_back(offset + static_cast<int>(*iv));
+         else        for(auto iv=face.begin(); iv!=face.end(); iv++)   face_indices.push_back(offset + static_cast<int>(*iv));
+      }
+   }
+
+   const size_t nfaces = nseg*nside + 2*pm2d->nfaces();
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,nfaces,face_indices);
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::thread(std::shared_ptr<clipper_profile> profile, double angle, double pitch, double core, const carve::math::Matrix& t)
+{
+   if(!(fabs(pitch) > 0)) throw logic_error("extrude_mesh::thread: a thread requires a pitch");
+   const double period = fabs(pitch);
+
+   // the trimming planes are at the start and end height of the sweep
+   const double height = pitch*fabs(angle)/(2*pi);
+   const double ylo = std::min(0.0,height);
+   const double yhi = std::max(0.0,height);
+   if(!(yhi > ylo)) throw logic_error("extrude_mesh::thread: the thread has no height");
+
+   tmesh_adapter tess;
+   tess.tesselate(profile->polyset());
+   std::shared_ptr<const polymesh2d> pm2d = tess.mesh();
+   if(pm2d->nvertices() == 0) throw logic_error("extrude_mesh::thread: empty profile");
+
+   // profile edges as (x0,y0,x1,y1) and the phase of each profile vertex within one period
+   double ymin = std::numeric_limits<double>::max();
+   double ymax = std::numeric_limits<double>::lowest();
+   double xmin = std::numeric_limits<double>::max();
+   std::vector<std::array<double,4>> edges;
+   std::vector<double> phases;
+   for(size_t ic=0; ic<pm2d->ncontours(); ic++) {
+      const polymesh2d::index_vector& vinds = pm2d->contour(ic);
+      for(size_t ivc=0; ivc<vinds.size(); ivc++) {
+         const dpos2d& p0 = pm2d->vertex(vinds[ivc]);
+         const dpos2d& p1 = pm2d->vertex(vinds[(ivc+1)%vinds.size()]);
+         edges.push_back({p0.x(),p0.y(),p1.x(),p1.y()});
+         phases.push_back(p0.y() - period*floor(p0.y()/period));
+         ymin = std::min(ymin,p0.y());
+         ymax = std::max(ymax,p0.y());
+         xmin = std::min(xmin,p0.x());
+      }
+   }
+   if(ymax-ymin > period) throw logic_error("extrude_mesh::thread: self intersection detected! Please make sure pitch is wider than swept profile");
+   if(core < 0.0) core = xmin;
+
+   // outermost profile radius at phase u, approached from below (side<0) or above (side>0).
+   // Returns lowest() where the profile is absent
+   const double eps = 1.0E-9*period;
+   auto profile_radius = [&edges,period,ymin,eps](double u, int side) {
+      double r = std::numeric_limits<double>::lowest();
+      const double h = u + period*ceil((ymin-u)/period - 1.0E-12);
+      for(double y : { h, h+period }) {
+         for(auto& e : edges) {
+            double y0 = std::min(e[1],e[3]);
+            double y1 = std::max(e[1],e[3]);
+            if(!(y1 > y0)) continue;
+            bool crosses = (side < 0)? (y0 < y-eps && y <= y1+eps) : (y0-eps <= y && y < y1-eps);
+            if(crosses) r = std::max(r,e[0] + (e[2]-e[0])*(y-e[1])/(e[3]-e[1]));
+         }
+      }
+      return r;
+   };
+
+   // the rows of one period: the surface radius is linear in the phase between the profile
+   // vertices, and where the profile crosses the core. A jump in radius gives two rows at one phase
+   std::sort(phases.begin(),phases.end());
+   phases.erase(std::unique(phases.begin(),phases.end(),[eps](double a, double b) { return b-a < eps; }),phases.end());
+   if(phases.size() > 1 && phases.back() - phases.front() > period - eps) phases.pop_back();
+
+   std::vector<std::pair<double,double>> rows; // (phase,radius)
+   for(size_t k=0; k<phases.size(); k++) {
+      const double u0 = phases[k];
+      const double u1 = (k+1 < phases.size())? phases[k+1] : phases[0]+period;
+      const double r_below = profile_radius(u0,-1);
+      const double r_above = profile_radius(u0,+1);
+      const double r0 = std::max(core,r_below);
+      const double r1 = std::max(core,r_above);
+      rows.push_back(std::make_pair(u0,r0));
+      if(fabs(r1-r0) > eps) rows.push_back(std::make_pair(u0,r1));
+
+      const double r_next = profile_radius(u1,-1);
+      if(r_above > std::numeric_limits<double>::lowest() && r_next > std::numeric_limits<double>::lowest()) {
+         if((r_above-core)*(r_next-core) < 0.0) {
+            const double u = u0 + (u1-u0)*(core-r_above)/(r_next-r_above);
+            if(u < period) rows.push_back(std::make_pair(u,core));
+            else           rows.insert(rows.begin(),std::make_pair(u-period,core));
+         }
+      }
+   }
+   const long nrow = static_cast<long>(rows.size());
+   double rmax = core;
+   for(auto& row : rows) rmax = std::max(rmax,row.second);
+
+   // angular steps per turn as for other surfaces of revolution
+   size_t ncol = 3;
+   double alpha = 2*pi/ncol;
+   while(rmax*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance(rmax)) {
+      ncol += 1;
+      alpha = 2*pi/ncol;
+   }
+
+   // row j is at v = phase + turn*period, its height in column i is v + pitch*theta/(2*pi)
+   auto row_v = [&rows,nrow,period](long j) {
+      long m = (j >= 0)? j/nrow : -((-j+nrow-1)/nrow);
+      return rows[j - m*nrow].first + m*period;
+   };
+   auto row_r = [&rows,nrow](long j) {
+      long m = (j >= 0)? j/nrow : -((-j+nrow-1)/nrow);
+      return rows[j - m*nrow].second;
+   };
+
+   // each column runs from a vertex on the bottom plane, through the rows between the planes, to
+   // a vertex on the top plane. The keys order the column vertices for stitching to the next column
+   std::vector<carve::geom3d::Vector> points;
+   std::vector<std::vector<int>>      col_vertex(ncol);
+   std::vector<std::vector<double>>   col_key(ncol);
+   for(size_t i=0; i<ncol; i++) {
+      const double theta = 2*pi*double(i)/double(ncol);
+      const double shift = pitch*theta/(2*pi);
+      const double c = cos(theta);
+      const double s = sin(theta);
+      auto add_vertex = [&points,&col_vertex,&col_key,i,c,s](double r, double y, double key) {
+         col_vertex[i].push_back(static_cast<int>(points.size()));
+         col_key[i].push_back(key);
+         points.push_back(carve::geom::VECTOR(r*c,y,r*s));
+      };
+
+      // first row above the bottom plane
+      const double vlo = ylo - shift;
+      const double vhi = yhi - shift;
+      long j = static_cast<long>(floor(vlo/period))*nrow - 1;
+      while(row_v(j) <= vlo + eps) j++;
+
+      // the bottom plane vertex is interpolated between the rows around it
+      auto boundary_radius = [&row_v,&row_r](long j, double v) {
+         const double v0 = row_v(j-1);
+         const double v1 = row_v(j);
+         return (v1 > v0)? row_r(j-1) + (row_r(j)-row_r(j-1))*(v-v0)/(v1-v0) : row_r(j);
+      };
+      add_vertex(boundary_radius(j,vlo),ylo,j-0.5);
+      for(; row_v(j) < vhi - eps; j++) add_vertex(row_r(j),row_v(j)+shift,double(j));
+      add_vertex(boundary_radius(j,vhi),yhi,j-0.5);
+   }
+   const int bottom_centre = static_cast<int>(points.size());
+   points.push_back(carve::geom::VECTOR(0.0,ylo,0.0));
+   const int top_centre = static_cast<int>(points.size());
+   points.push_back(carve::geom::VECTOR(0.0,yhi,0.0));
+
+   for(auto& p : points) p = t*p;
+   const bool reverse_face = mesh_utils::is_left_hand(t);
+
+   size_t nfaces = 0;
+   std::vector<int> face_indices;
+   auto add_triangle = [&face_indices,&nfaces,reverse_face](int a, int b, int c) {
+      face_indices.push_back(3);
+      if(reverse_face) { face_indices.push_back(c); face_indices.push_back(b); face_indices.push_back(a); }
+      else             { face_indices.push_back(a); face_indices.push_back(b); face_indices.push_back(c); }
+      nfaces++;
+   };
+
+   // stitch each column to the next by advancing along the lower key. The last column is stitched to
+   // the first, which is one turn further along the rows, so the seam shares the vertices of the first column
+   const double seam_shift = (pitch > 0)? -double(nrow) : double(nrow);
+   for(size_t i=0; i<ncol; i++) {
+      const size_t inext = (i+1 < ncol)? i+1 : 0;
+      const double shift = (i+1 < ncol)? 0.0 : seam_shift;
+      const std::vector<int>&    va = col_vertex[i];
+      const std::vector<int>&    vb = col_vertex[inext];
+      const std::vector<double>& ka = col_key[i];
+      const std::vector<double>& kb = col_key[inext];
+      size_t a = 0;
+      size_t b = 0;
+      while(a+1 < va.size() || b+1 < vb.size()) {
+         bool advance_a = (b+1 == vb.size()) || (a+1 < va.size() && ka[a+1] <= kb[b+1]+shift);
+         if(advance_a) { add_triangle(va[a],va[a+1],vb[b]); a++; }
+         else          { add_triangle(va[a],vb[b+1],vb[b]); b++; }
+      }
+
+      // the plane caps are fans around the axis
+      add_triangle(bottom_centre,va.front(),vb.front());
+      add_triangle(top_centre,vb.back(),va.back());
+   }
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = std::make_shared<carve::mesh::MeshSet<3>>(points,nfaces,face_indices);
+
+   carve::mesh::MeshSimplifier simplifier;
+   double min_normal_angle=(pi/180.)*1E-4;  // 1E-4 degrees
+   simplifier.mergeCoplanarFaces(meshset.get(),min_normal_angle);
+
+   return meshset;
+}
+
 std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::transform_extrude(const carve::math::Matrix& t_bot,         // bottom profile transform
                                                                          std::shared_ptr<clipper_profile> bottom,  // bottom profile
                                                                          const carve::math::Matrix& t_top,         // top profile transform
                                                                          std::shared_ptr<clipper_profile> top,     // top profile
                                                                          const carve::math::Matrix& t)             // final solid transform
 {
-   std::shared_ptr<polyset2d> pset_bot = bottom->polyset();
-   std::shared_ptr<polyset2d> pset_top = top->polyset();
+   // the polygons are modified by make_compatible below, so they must not be the cached polysets
+   std::shared_ptr<polyset2d> pset_bot = bottom->create_polyset();
+   std::shared_ptr<polyset2d> pset_top = top->create_polyset();
 
    if((pset_bot->size() != 1) || (pset_top->size() != 1)) {
       throw logic_error("disjoint profiles not supported for 'transform_extrude' ");
@@ -123,11 +485,10 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::transform_extrude(const c
    polygon2d::make_compatible(*poly_bot,*poly_top,epspnt);
 
 //   dmesh_adapter tess_bot(maxlen_bot),tess_top(maxlen_top);
-   tmesh_adapter tess_bot,tess_top;
-   tess_bot.tesselate(pset_bot);
-   tess_top.tesselate(pset_top);
+   std::shared_ptr<polymesh2d> mesh_bot = tesselate(pset_bot);
+   std::shared_ptr<polymesh2d> mesh_top = tesselate(pset_top);
 
-   std::shared_ptr<sweep_path_transform>  path(new sweep_path_transform(t_bot, tess_bot.mesh(),t_top,tess_top.mesh()));
+   std::shared_ptr<sweep_path_transform>  path(new sweep_path_transform(t_bot,mesh_bot,t_top,mesh_top));
    std::shared_ptr<xpolyhedron> poly = sweep_mesh(path,false).polyhedron();
    std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh(t);
 
@@ -147,12 +508,10 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::sweep_extrude(std::shared
 
    // tesselate the profile
 //   dmesh_adapter tess(maxlen);
-   tmesh_adapter tess;
-   tess.tesselate(polyset);
 
    // use the 2d mesh as basis for sweep
    int nseg = -1;
-   std::shared_ptr<sweep_path_spline>  path(new sweep_path_spline(tess.mesh(),spath,nseg));
+   std::shared_ptr<sweep_path_spline>  path(new sweep_path_spline(tesselate(polyset),spath,nseg));
    std::shared_ptr<xpolyhedron> poly = sweep_mesh(path,false).polyhedron();
    std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh(t);
 
@@ -167,13 +526,14 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::clone_extrude(std::shared
 {
    std::shared_ptr<carve::mesh::MeshSet<3>> mesh(meshset->clone());
 
-   size_t nvert =  mesh->vertex_storage.size();
-   for(size_t i=0;i<nvert;i++) {
-      carve::mesh::MeshSet<3>::vertex_t& vertex = mesh->vertex_storage[i];
-      if(vertex.v[2] > 0.0) {
-         vertex = t * carve::geom::VECTOR(vertex.v[0],vertex.v[1],vertex.v[2]);
-      }
+   // only the vertices above the bottom are transformed, they are collected for one batch transform
+   auto& vertex_storage = mesh->vertex_storage;
+   std::vector<carve::geom3d::Vector*> top;
+   top.reserve(vertex_storage.size());
+   for(auto& vertex : vertex_storage) {
+      if(vertex.v[2] > 0.0) top.push_back(&vertex.v);
    }
+   mesh_utils::transform_points(t,top.size(),[&top](size_t i) -> carve::geom3d::Vector& { return *top[i]; });
    return mesh;
 }
 
@@ -182,11 +542,8 @@ std::shared_ptr<carve::mesh::MeshSet<3>> extrude_mesh::clone_transform(std::shar
 {
    std::shared_ptr<carve::mesh::MeshSet<3>> mesh(meshset->clone());
 
-   size_t nvert =  mesh->vertex_storage.size();
-   for(size_t i=0;i<nvert;i++) {
-      carve::mesh::MeshSet<3>::vertex_t& vertex = mesh->vertex_storage[i];
-      vertex = t * carve::geom::VECTOR(vertex.v[0],vertex.v[1],vertex.v[2]);
-   }
+   auto& vertex_storage = mesh->vertex_storage;
+   mesh_utils::transform_points(t,vertex_storage.size(),[&vertex_storage](size_t i) -> carve::geom3d::Vector& { return vertex_storage[i].v; });
    return mesh;
 }
 
@@ -21,11 +21,26 @@
 #include "clipper_csg/clipper_profile.h"
 #include <carve/matrix.hpp>
 #include "csplines/spline_path.h"
+#include "clipper_csg/polymesh2d.h"
+class sweep_path_rotate;
 
 // extrude 2d to 3d
 
 class extrude_mesh {
 public:
+   // triangulation of the profiles for the caps of extrusions: constrained Delaunay by libtess2
+   // (tmesh_adapter), or monotone decomposition (monotone_adapter), which is faster and gives
+   // valid but thinner triangles. Linear extrusion caps are merged into polygons afterwards
+   enum cap_strategy {
+      cap_delaunay,
+      cap_monotone
+   };
+   static void set_cap_strategy(cap_strategy strategy) { m_cap_strategy = strategy; }
+   static cap_strategy get_cap_strategy() { return m_cap_strategy; }
+
+   // tesselate a profile for extrusion using the cap strategy
+   static std::shared_ptr<polymesh2d> tesselate(std::shared_ptr<polyset2d> polyset);
+
    // returns a linear 3d extrusion of the 2d input profile
    static std::shared_ptr<carve::mesh::MeshSet<3>> linear_extrude(std::shared_ptr<clipper_profile> profile, double h, const carve::math::Matrix& t);
 
@@ -43,6 +58,23 @@ public:
                                                                  std::shared_ptr<const csplines::spline_path> path,
                                                                  const carve::math::Matrix& t);
 
+   // returns a linear 3d extrusion of a tesselated 2d profile, built directly as a carve mesh
+   static std::shared_ptr<carve::mesh::MeshSet<3>> linear_extrude(std::shared_ptr<const polymesh2d> pm2d, double h, const carve::math::Matrix& t);
+
+   // returns a full revolution of a tesselated 2d profile around the Y axis, built directly as a carve mesh.
+   // The result is a topological torus of nseg rings with no end caps
+   static std::shared_ptr<carve::mesh::MeshSet<3>> revolve(std::shared_ptr<const polymesh2d> pm2d, size_t nseg, const carve::math::Matrix& t);
+
+   // returns a helical extrusion along a rotate path with pitch, built directly as a carve mesh.
+   // The rings are the path layers, consecutive segments share the ring vertices
+   static std::shared_ptr<carve::mesh::MeshSet<3>> helix(std::shared_ptr<const sweep_path_rotate> path, std::shared_ptr<const polymesh2d> pm2d, const carve::math::Matrix& t);
+
+   // returns a threaded rod: a core of radius core with the profile swept helically around the Y axis,
+   // trimmed to the planes at the start and end height of the sweep. The profile is used in the axial
+   // plane, the surface radius at each height is the outermost profile boundary or the core radius.
+   // A negative core is taken as the smallest profile radius
+   static std::shared_ptr<carve::mesh::MeshSet<3>> thread(std::shared_ptr<clipper_profile> profile, double angle, double pitch, double core, const carve::math::Matrix& t);
+
    static double evaluate_max_x(std::shared_ptr<carve::mesh::MeshSet<3>> meshset);
 
    // returns an extruded clone of the input mesh, i.e. transform only the 2nd level of vertices
@@ -51,6 +83,8 @@ public:
    // transforms a clone of the input mesh, i.e. transform all vertices
    static std::shared_ptr<carve::mesh::MeshSet<3>> clone_transform(std::shared_ptr<carve::mesh::MeshSet<3>> meshset, const carve::math::Matrix& t);
 
+private:
+   static cap_strategy m_cap_strategy;
 };
 
 #endif // EXTRUDE_MESH_H
@@ -0,0 +1,260 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "face_bvh.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <limits>
+
+namespace {
+
+   double surface_area(const xbox3d& box)
+   {
+      if(!box.initialised()) return 0.0;
+      double dx = box.p2().x - box.p1().x;
+      double dy = box.p2().y - box.p1().y;
+      double dz = box.p2().z - box.p1().z;
+      return 2.0*(dx*dy + dy*dz + dz*dx);
+   }
+
+   // true if the ray origin + t*dir for t>=0 passes through box (slab test), inv_dir is 1/dir
+   bool ray_hits(const xbox3d& box, const xvertex& origin, const xvertex& inv_dir)
+   {
+      double tmin = 0.0;
+      double tmax = std::numeric_limits<double>::max();
+      for(size_t i=0; i<3; i++) {
+         double t1 = (box.p1()[i] - origin[i])*inv_dir[i];
+         double t2 = (box.p2()[i] - origin[i])*inv_dir[i];
+         tmin = std::max(tmin,std::min(t1,t2));
+         tmax = std::min(tmax,std::max(t1,t2));
+      }
+      return tmin <= tmax;
+   }
+}
+
+face_bvh::face_bvh(const carve::mesh::MeshSet<3>& meshset, const xbox3d& clip)
+{
+   for(auto mesh : meshset.meshes) {
+      for(const face_t* face : mesh->faces) {
+         xbox3d box = face_box(face);
+         if(!box.intersects(clip)) continue;
+         m_faces.push_back(face);
+         m_boxes.push_back(box);
+         m_centers.push_back(box.center());
+      }
+   }
+   m_order.resize(m_faces.size());
+   for(size_t i=0; i<m_order.size(); i++) m_order[i] = i;
+   if(m_faces.size() > 0) m_root = build(0,m_faces.size());
+}
+
+face_bvh::~face_bvh()
+{}
+
+xbox3d face_bvh::face_box(const face_t* face)
+{
+   xbox3d box;
+   const carve::mesh::Edge<3>* e = face->edge;
+   do { box.enclose(e->vert->v); e = e->next; } while(e != face->edge);
+   return box;
+}
+
+std::unique_ptr<face_bvh::node> face_bvh::build(size_t begin, size_t end)
+{
+   std::unique_ptr<node> n(new node);
+   xbox3d centers;
+   for(size_t i=begin; i<end; i++) {
+      n->box.enclose(m_boxes[m_order[i]]);
+      centers.enclose(m_centers[m_order[i]]);
+   }
+   n->begin = begin;
+   n->end   = end;
+   size_t count = end-begin;
+   if(count <= leaf_size) return n;
+
+   // split along the longest axis of the face centers
+   size_t axis = 0;
+   double extent = 0.0;
+   for(size_t i=0; i<3; i++) {
+      double d = centers.p2()[i] - centers.p1()[i];
+      if(d > extent) { extent = d; axis = i; }
+   }
+   if(extent <= 0.0) return n;   // all centers coincide
+
+   // surface area heuristic evaluated at the bin boundaries
+   double c0 = centers.p1()[axis];
+   auto bin_of = [this,axis,c0,extent](size_t iface) {
+      size_t ibin = static_cast<size_t>(nbins*(m_centers[iface][axis]-c0)/extent);
+      return std::min(ibin,nbins-1);
+   };
+   std::vector<size_t> bin_count(nbins,0);
+   std::vector<xbox3d> bin_box(nbins);
+   for(size_t i=begin; i<end; i++) {
+      size_t ibin = bin_of(m_order[i]);
+      bin_count[ibin]++;
+      bin_box[ibin].enclose(m_boxes[m_order[i]]);
+   }
+   std::vector<double> right_cost(nbins,0.0);
+   xbox3d right_box;
+   size_t right_count = 0;
+   for(size_t ibin=nbins-1; ibin>0; ibin--) {
+      right_box.enclose(bin_box[ibin]);
+      right_count += bin_count[ibin];
+      right_cost[ibin] = surface_area(right_box)*right_count;
+   }
+   double best_cost = std::numeric_limits<double>::max();
+   size_t best_split = 0;
+   xbox3d left_box;
+   size_t left_count = 0;
+   for(size_t ibin=1; ibin<nbins; ibin++) {
+      left_box.enclose(bin_box[ibin-1]);
+      left_count += bin_count[ibin-1];
+      if(left_count == 0 || left_count == count) continue;
+      double cost = surface_area(left_box)*left_count + right_cost[ibin];
+      if(cost < best_cost) { best_cost = cost; best_split = ibin; }
+   }
+   if(best_split == 0) return n;
+   if(count <= max_leaf_size && best_cost >= surface_area(n->box)*count) return n;
+
+   auto first = m_order.begin();
+   size_t mid = std::partition(first+begin,first+end,[&bin_of,best_split](size_t iface) { return bin_of(iface) < best_split; }) - first;
+
+   // the two halves own disjoint ranges of m_order, so they can be built concurrently
+   if(count > parallel_size) {
+      thread_pool::task_group group;
+      thread_pool::singleton().submit(group,[this,&n,begin,mid]() { n->left = build(begin,mid); });
+      n->right = build(mid,end);
+      thread_pool::singleton().wait(group);
+   }
+   else {
+      n->left  = build(begin,mid);
+      n->right = build(mid,end);
+   }
+   return n;
+}
+
+bool face_bvh::intersects(const xbox3d& box) const
+{
+   if(!m_root) return false;
+   std::vector<const node*> stack;
+   stack.push_back(m_root.get());
+   while(stack.size() > 0) {
+      const node* n = stack.back();
+      stack.pop_back();
+      if(!n->box.intersects(box)) continue;
+      if(n->left) {
+         stack.push_back(n->left.get());
+         stack.push_back(n->right.get());
+         continue;
+      }
+      for(size_t i=n->begin; i<n->end; i++) {
+         if(m_boxes[m_order[i]].intersects(box)) return true;
+      }
+   }
+   return false;
+}
+
+bool face_bvh::intersects(const carve::mesh::MeshSet<3>& meshset) const
+{
+   if(!m_root) return false;
+
+   // only faces overlapping the tree can have candidates
+   std::vector<xbox3d> boxes;
+   for(auto mesh : meshset.meshes) {
+      for(const face_t* face : mesh->faces) {
+         xbox3d box = face_box(face);
+         if(box.intersects(m_root->box)) boxes.push_back(box);
+      }
+   }
+
+   // the search stops in all tasks at the first candidate pair
+   const size_t chunk_size = 1024;
+   std::atomic<bool> found(false);
+   thread_pool::task_group group;
+   for(size_t begin=0; begin<boxes.size(); begin+=chunk_size) {
+      size_t end = std::min(begin+chunk_size,boxes.size());
+      thread_pool::singleton().submit(group,[this,&boxes,&found,begin,end]() {
+         for(size_t i=begin; i<end && !found; i++) {
+            if(intersects(boxes[i])) found = true;
+         }
+      });
+   }
+   thread_pool::singleton().wait(group);
+   return found;
+}
+
+size_t face_bvh::crossings(const xvertex& origin, const xvertex& dir, bool& ambiguous) const
+{
+   // relative tolerance of the barycentric coordinates and the ray parameter
+   const double eps = 1.0e-9;
+
+   ambiguous = false;
+   size_t count = 0;
+   if(!m_root) return count;
+
+   xvertex inv_dir;
+   for(size_t i=0; i<3; i++) inv_dir[i] = (dir[i] != 0.0)? 1.0/dir[i] : std::numeric_limits<double>::max();
+
+   std::vector<const node*> stack;
+   stack.push_back(m_root.get());
+   while(stack.size() > 0 && !ambiguous) {
+      const node* n = stack.back();
+      stack.pop_back();
+      if(!ray_hits(n->box,origin,inv_dir)) continue;
+      if(n->left) {
+         stack.push_back(n->left.get());
+         stack.push_back(n->right.get());
+         continue;
+      }
+      for(size_t i=n->begin; i<n->end && !ambiguous; i++) {
+         if(!ray_hits(m_boxes[m_order[i]],origin,inv_dir)) continue;
+
+         // Moller-Trumbore intersection with each triangle of the face fan
+         const face_t* face = m_faces[m_order[i]];
+         const carve::mesh::Edge<3>* e0 = face->edge;
+         const xvertex& p0 = e0->vert->v;
+         for(const carve::mesh::Edge<3>* e = e0->next; e->next != e0; e = e->next) {
+            xvertex e1 = e->vert->v - p0;
+            xvertex e2 = e->next->vert->v - p0;
+            xvertex pv = carve::geom::cross(dir,e2);
+            double det = carve::geom::dot(e1,pv);
+            double scale = e1.length()*e2.length()*dir.length();
+            if(std::fabs(det) <= eps*scale) {
+               // ray parallel to the triangle, ambiguous only if it lies in its plane
+               if(std::fabs(carve::geom::dot(origin-p0,carve::geom::cross(e1,e2))) <= eps*scale*(origin-p0).length()) ambiguous = true;
+               continue;
+            }
+            xvertex tv = origin - p0;
+            double u = carve::geom::dot(tv,pv)/det;
+            if(u < -eps || u > 1.0+eps) continue;
+            xvertex qv = carve::geom::cross(tv,e1);
+            double v = carve::geom::dot(dir,qv)/det;
+            if(v < -eps || u+v > 1.0+eps) continue;
+            double t = carve::geom::dot(e2,qv)/det;
+            if(t < -eps*tv.length()) continue;
+            if(u <= eps || v <= eps || u+v >= 1.0-eps || t <= eps*tv.length()) {
+               // on a triangle edge or vertex, the inner fan edges included
+               ambiguous = true;
+               break;
+            }
+            count++;
+         }
+      }
+   }
+   return count;
+}
@@ -0,0 +1,81 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef FACE_BVH_H
+#define FACE_BVH_H
+
+#include <memory>
+#include <vector>
+#include <carve/mesh.hpp>
+#include "xbox3d.h"
+
+// face_bvh is a bounding volume hierarchy over the face boxes of a carve mesh set, used to find
+// candidate face pairs of two boolean operands. Only faces whose box intersects the clip box are
+// included. The tree is split by the surface area heuristic evaluated in bins along the longest
+// axis of the face centers. Large subtrees are built as parallel thread_pool tasks.
+// The tree also counts ray crossings for inside/outside tests of points against closed meshes.
+
+class face_bvh {
+public:
+   typedef carve::mesh::MeshSet<3>::face_t face_t;
+
+   face_bvh(const carve::mesh::MeshSet<3>& meshset, const xbox3d& clip);
+   virtual ~face_bvh();
+
+   // box of a face
+   static xbox3d face_box(const face_t* face);
+
+   // number of faces in the tree
+   size_t size() const { return m_faces.size(); }
+
+   // true if the box of any face in the tree intersects box, touching boxes count as intersecting
+   bool intersects(const xbox3d& box) const;
+
+   // true if the box of any face of meshset intersects the box of any face in the tree.
+   // The faces of meshset are tested in parallel
+   bool intersects(const carve::mesh::MeshSet<3>& meshset) const;
+
+   // number of faces crossed by the ray from origin in direction dir, faces are split into fans of triangles.
+   // ambiguous is set when the ray passes too close to an edge or a vertex, or starts on a face,
+   // the parity of the count is then unreliable and another direction should be tried
+   size_t crossings(const xvertex& origin, const xvertex& dir, bool& ambiguous) const;
+
+protected:
+   struct node {
+      xbox3d                box;
+      size_t                begin = 0;   // face range of a leaf
+      size_t                end   = 0;
+      std::unique_ptr<node> left;
+      std::unique_ptr<node> right;
+   };
+
+   // build the subtree of faces [begin,end)
+   std::unique_ptr<node> build(size_t begin, size_t end);
+
+private:
+   static const size_t leaf_size     = 4;     // leaves are never split below this size
+   static const size_t max_leaf_size = 16;    // leaves are split above this size, even when the SAH would not
+   static const size_t nbins         = 16;
+   static const size_t parallel_size = 4096;  // subtrees with more faces are built as separate tasks
+
+   std::vector<const face_t*> m_faces;
+   std::vector<xbox3d>        m_boxes;    // box of each face
+   std::vector<xvertex>       m_centers;  // box center of each face
+   std::vector<size_t>        m_order;    // face indices in leaf order
+   std::unique_ptr<node>      m_root;
+};
+
+#endif // FACE_BVH_H
@@ -0,0 +1,123 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "file_watch.h"
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+// quiet time after the last event before the file is considered saved
+static const int settle_ms = 100;
+
+// interval of polling the file when inotify is not available
+static const int poll_ms = 250;
+
+file_watch::file_watch(const std::string& path)
+: m_path(path)
+, m_fd(-1)
+, m_time(0)
+, m_size(0)
+{
+   boost::filesystem::path p(path);
+   m_name = p.filename().string();
+
+#ifdef __linux__
+   std::string dir = p.parent_path().string();
+   if(dir.length() == 0) dir = ".";
+   m_fd = inotify_init1(IN_CLOEXEC);
+   if(m_fd >= 0 && inotify_add_watch(m_fd,dir.c_str(),IN_CLOSE_WRITE|IN_MOVED_TO|IN_CREATE) < 0) {
+      close(m_fd);
+      m_fd = -1;
+   }
+#endif
+
+   stat(m_time,m_size);
+}
+
+file_watch::~file_watch()
+{
+#ifdef __linux__
+   if(m_fd >= 0) close(m_fd);
+#endif
+}
+
+void file_watch::stat(std::time_t& time, uintmax_t& size) const
+{
+   boost::system::error_code ec;
+   time = boost::filesystem::last_write_time(m_path,ec);
+   if(ec) time = 0;
+   size = boost::filesystem::file_size(m_path,ec);
+   if(ec) size = 0;
+}
+
+bool file_watch::next_event(int timeout_ms)
+{
+#ifdef __linux__
+   struct pollfd pfd;
+   pfd.fd     = m_fd;
+   pfd.events = POLLIN;
+   if(poll(&pfd,1,timeout_ms) <= 0) return false;
+
+   alignas(struct inotify_event) char buffer[16*(sizeof(struct inotify_event) + NAME_MAX + 1)];
+   ssize_t nread = read(m_fd,buffer,sizeof(buffer));
+   bool found = false;
+   for(ssize_t pos=0; pos<nread; ) {
+      const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(buffer + pos);
+      if(event->len > 0 && m_name == event->name) found = true;
+      pos += sizeof(struct inotify_event) + event->len;
+   }
+   return found;
+#else
+   (void)timeout_ms;
+   return false;
+#endif
+}
+
+void file_watch::wait()
+{
+   std::time_t time = m_time;
+   uintmax_t   size = m_size;
+   while(true) {
+      if(m_fd >= 0) {
+         // block until the file is touched, then until the events stop
+         while(!next_event(-1)) {}
+         while(next_event(settle_ms)) {}
+      }
+      else {
+         boost::this_thread::sleep(boost::posix_time::milliseconds(poll_ms));
+      }
+
+      // an event without a change, e.g. a save of identical content by some editors, is still a save.
+      // When polling, only a change of time or size is seen
+      stat(time,size);
+      if(time == 0) continue;  // the file is being replaced
+      if(m_fd >= 0) break;
+      if(time != m_time || size != m_size) {
+         // let the writer finish
+         boost::this_thread::sleep(boost::posix_time::milliseconds(settle_ms));
+         stat(time,size);
+         break;
+      }
+   }
+   m_time = time;
+   m_size = size;
+}
@@ -0,0 +1,55 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef FILE_WATCH_H
+#define FILE_WATCH_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+
+// file_watch waits for a file to be saved. On Linux the directory of the file is monitored
+// with inotify, so editors that save by writing a new file and renaming it are seen as well.
+// Other platforms poll the modification time and size of the file.
+// A save often arrives as several events, wait returns once the file has been quiet for a moment
+
+class file_watch {
+public:
+   file_watch(const std::string& path);
+   virtual ~file_watch();
+
+   // block until the file has changed since construction or the previous call
+   void wait();
+
+private:
+   file_watch(const file_watch&) = delete;
+   file_watch& operator=(const file_watch&) = delete;
+
+   // modification time and size of the file, zero if it does not exist
+   void stat(std::time_t& time, uintmax_t& size) const;
+
+   // true if an event for the file arrives within timeout_ms, inotify only
+   bool next_event(int timeout_ms);
+
+private:
+   std::string m_path;
+   std::string m_name;  // file name without directory
+   int         m_fd;    // inotify descriptor, -1 when polling
+   std::time_t m_time;
+   uintmax_t   m_size;
+};
+
+#endif // FILE_WATCH_H
@@ -14,12 +14,14 @@
 // EndLicense:
 
 #include "geodesic_sphere.h"
+#include <map>
+#include <memory>
+#include <mutex>
 
 geodesic_sphere::geodesic_sphere(size_t idepth)
 {
    init(idepth);
-   m_vert.shrink_to_fit();
-   m_faces.shrink_to_fit();
+   m_vmap = std::unordered_map<uint64_t,size_t>();
 }
 
 geodesic_sphere::~geodesic_sphere()
@@ -27,31 +29,26 @@ geodesic_sphere::~geodesic_sphere()
    //dtor
 }
 
-size_t  geodesic_sphere::v_size() const
+const geodesic_sphere& geodesic_sphere::unit(size_t idepth)
 {
-   return m_vert.size();
-}
-
-const xvertex& geodesic_sphere::v_get(size_t v_ind) const
-{
-   return m_vert.at(v_ind);
-}
-
-size_t geodesic_sphere::f_size() const
-{
-   return m_faces.size();
-}
-
-const xface& geodesic_sphere::f_get(size_t f_ind) const
-{
-   return m_faces.at(f_ind);
+   static std::mutex mutex;
+   static std::map<size_t,std::unique_ptr<geodesic_sphere>> templates;
+
+   // templates are never removed, so the reference stays valid after the lock is released
+   std::lock_guard<std::mutex> lock(mutex);
+   std::unique_ptr<geodesic_sphere>& sphere = templates[idepth];
+   if(!sphere) sphere.reset(new geodesic_sphere(idepth));
+   return *sphere;
 }
 
 void geodesic_sphere::init(size_t idepth)
 {
-   // just reserve some
-   m_vert.reserve(12*3*3);
-   m_faces.reserve(20*3*3);
+   // each depth level multiplies the number of faces by 4, V = F/2 + 2
+   size_t nface = 20;
+   for(size_t i=0; i<idepth; i++) nface *= 4;
+   m_vert.reserve(nface/2 + 2);
+   m_tri.reserve(3*nface);
+   m_vmap.reserve(3*nface/2);
 
    // start with an Icosahedron
    // The magic numbers X and Z are chosen so that the distance from the origin to any of the vertices of the icosahedron is 1.0.
@@ -94,7 +91,7 @@ size_t geodesic_sphere::sub_vertex(size_t iv1, size_t iv2)
 {
    size_t vmin = std::min(iv1,iv2);
    size_t vmax = std::max(iv1,iv2);
-   size_t key = vmin*1000000 + vmax;
+   uint64_t key = (uint64_t(vmin)<<32) | uint64_t(vmax);
    auto i = m_vmap.find(key);
    if(i != m_vmap.end()) {
       return i->second;
@@ -110,7 +107,7 @@ void geodesic_sphere::subdivide(size_t iv1, size_t iv2, size_t iv3, size_t idept
 {
    if(idepth == 0) {
       // create one new face and stop recursion
-      m_faces.push_back(xface(iv3,iv2,iv1));
+      m_tri.insert(m_tri.end(),{iv3,iv2,iv1});
       return;
    }
 
@@ -17,27 +17,33 @@
 #define GEODESIC_SPHERE_H
 
 #include "xshape.h"
-#include "xface.h"
+#include <cstdint>
 #include <vector>
-#include <map>
+#include <unordered_map>
 
 // inspired by http://stackoverflow.com/questions/17705621/algorithm-for-a-geodesic-sphere
 // rewritten and extended with topology
 
-// geodesic_sphere generates a unit radius geodesic sphere using depth recursion
+// geodesic_sphere generates a unit radius geodesic sphere using depth recursion.
+// The sphere depends on idepth only, so unit() returns a process wide template
+// per depth that is built once and shared by all spheres of that depth
 
 class geodesic_sphere {
 public:
    geodesic_sphere(size_t idepth);
    virtual ~geodesic_sphere();
 
-   // access vertices
-   size_t         v_size() const;
-   const xvertex& v_get(size_t v_ind) const;
+   // shared unit sphere template of the given depth, thread safe
+   static const geodesic_sphere& unit(size_t idepth);
 
-   // access faces
-   size_t         f_size() const;
-   const xface&   f_get(size_t f_ind) const;
+   // access vertices, stored contiguously
+   size_t         v_size() const { return m_vert.size(); }
+   const xvertex& v_get(size_t v_ind) const { return m_vert[v_ind]; }
+   const xvertex* v_data() const { return m_vert.data(); }
+
+   // access triangle faces, 3 vertex indices per face stored contiguously
+   size_t         f_size() const { return m_tri.size()/3; }
+   const size_t*  f_get(size_t f_ind) const { return &m_tri[3*f_ind]; }
 
 protected:
    void init(size_t idepth);
@@ -46,9 +52,9 @@ protected:
    size_t sub_vertex(size_t iv1, size_t iv2);
 
 private:
-   std::map<size_t,size_t>  m_vmap;    // <key,vertex_index>
-   std::vector<xvertex>     m_vert;    // vertex coordinates
-   std::vector<xface>       m_faces;   // vertex indices for faces
+   std::unordered_map<uint64_t,size_t> m_vmap;    // <edge key,vertex_index>, used during init only
+   std::vector<xvertex>                m_vert;    // vertex coordinates
+   std::vector<size_t>                 m_tri;     // vertex indices for triangle faces
 };
 
 #endif // GEODESIC_SPHERE_H
@@ -0,0 +1,173 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "geom_kernel.h"
+#include "mesh_utils.h"
+#include <algorithm>
+#include <cmath>
+
+// points per block, each lane loop has a fixed length and no dependencies between its elements
+static const size_t block = 8;
+
+void geom_kernel::transform_xyz(const carve::math::Matrix& t, double* xyz, size_t n)
+{
+   if(mesh_utils::is_identity(t)) return;
+
+   const double xx = t.m[0][0], xy = t.m[1][0], xz = t.m[2][0], xw = t.m[3][0];
+   const double yx = t.m[0][1], yy = t.m[1][1], yz = t.m[2][1], yw = t.m[3][1];
+   const double zx = t.m[0][2], zy = t.m[1][2], zz = t.m[2][2], zw = t.m[3][2];
+
+   size_t i = 0;
+   for(; i+block<=n; i+=block) {
+      double* p = xyz + 3*i;
+      double x[block],y[block],z[block];
+      for(size_t k=0; k<block; k++) { x[k] = p[3*k]; y[k] = p[3*k+1]; z[k] = p[3*k+2]; }
+      for(size_t k=0; k<block; k++) {
+         p[3*k]   = xx*x[k] + xy*y[k] + xz*z[k] + xw;
+         p[3*k+1] = yx*x[k] + yy*y[k] + yz*z[k] + yw;
+         p[3*k+2] = zx*x[k] + zy*y[k] + zz*z[k] + zw;
+      }
+   }
+
+   // remaining points
+   for(; i<n; i++) {
+      double* p = xyz + 3*i;
+      const double x = p[0], y = p[1], z = p[2];
+      p[0] = xx*x + xy*y + xz*z + xw;
+      p[1] = yx*x + yy*y + yz*z + yw;
+      p[2] = zx*x + zy*y + zz*z + zw;
+   }
+}
+
+void geom_kernel::bounds(const double* xyz, size_t n, double pmin[3], double pmax[3])
+{
+   // one running minimum and maximum per lane, merged at the end
+   double lmin[3][block],lmax[3][block];
+   for(size_t c=0; c<3; c++) {
+      for(size_t k=0; k<block; k++) lmin[c][k] = lmax[c][k] = xyz[c];
+   }
+
+   size_t i = 0;
+   for(; i+block<=n; i+=block) {
+      const double* p = xyz + 3*i;
+      for(size_t c=0; c<3; c++) {
+         for(size_t k=0; k<block; k++) {
+            lmin[c][k] = std::min(lmin[c][k],p[3*k+c]);
+            lmax[c][k] = std::max(lmax[c][k],p[3*k+c]);
+         }
+      }
+   }
+   for(size_t c=0; c<3; c++) {
+      pmin[c] = *std::min_element(lmin[c],lmin[c]+block);
+      pmax[c] = *std::max_element(lmax[c],lmax[c]+block);
+   }
+
+   // remaining points
+   for(; i<n; i++) {
+      const double* p = xyz + 3*i;
+      for(size_t c=0; c<3; c++) {
+         pmin[c] = std::min(pmin[c],p[c]);
+         pmax[c] = std::max(pmax[c],p[c]);
+      }
+   }
+}
+
+// cross products (b-a)x(c-a) of the m <= block triangles at corners, into the lanes nx,ny,nz
+static inline void triangle_cross(const double* corners, size_t m, double* nx, double* ny, double* nz)
+{
+   for(size_t k=0; k<m; k++) {
+      const double* p = corners + 9*k;
+      const double ux = p[3]-p[0], uy = p[4]-p[1], uz = p[5]-p[2];
+      const double vx = p[6]-p[0], vy = p[7]-p[1], vz = p[8]-p[2];
+      nx[k] = uy*vz - uz*vy;
+      ny[k] = uz*vx - ux*vz;
+      nz[k] = ux*vy - uy*vx;
+   }
+}
+
+void geom_kernel::triangle_normals(const double* corners, size_t n, double* normals)
+{
+   double nx[block],ny[block],nz[block];
+   for(size_t i=0; i<n; i+=block) {
+      const size_t m = std::min(block,n-i);
+      triangle_cross(corners + 9*i,m,nx,ny,nz);
+      double* out = normals + 3*i;
+      for(size_t k=0; k<m; k++) {
+         const double len = std::sqrt(nx[k]*nx[k] + ny[k]*ny[k] + nz[k]*nz[k]);
+         const double inv = (len > 0.0)? 1.0/len : 0.0;
+         out[3*k]   = nx[k]*inv;
+         out[3*k+1] = ny[k]*inv;
+         out[3*k+2] = nz[k]*inv;
+      }
+   }
+}
+
+void geom_kernel::triangle_areas(const double* corners, size_t n, double* areas)
+{
+   double nx[block],ny[block],nz[block];
+   for(size_t i=0; i<n; i+=block) {
+      const size_t m = std::min(block,n-i);
+      triangle_cross(corners + 9*i,m,nx,ny,nz);
+      for(size_t k=0; k<m; k++) {
+         areas[i+k] = 0.5*std::sqrt(nx[k]*nx[k] + ny[k]*ny[k] + nz[k]*nz[k]);
+      }
+   }
+}
+
+void geom_kernel::newell_normal(const double* xyz, size_t n, double normal[3])
+{
+   // edges i -> i+1, the closing edge from the last to the first point is added below
+   double nx = 0.0, ny = 0.0, nz = 0.0;
+   for(size_t i=0; i+1<n; i++) {
+      const double* a = xyz + 3*i;
+      const double* b = a + 3;
+      nx += (a[1] - b[1])*(a[2] + b[2]);
+      ny += (a[2] - b[2])*(a[0] + b[0]);
+      nz += (a[0] - b[0])*(a[1] + b[1]);
+   }
+   if(n > 1) {
+      const double* a = xyz + 3*(n-1);
+      const double* b = xyz;
+      nx += (a[1] - b[1])*(a[2] + b[2]);
+      ny += (a[2] - b[2])*(a[0] + b[0]);
+      nz += (a[0] - b[0])*(a[1] + b[1]);
+   }
+   normal[0] = nx;
+   normal[1] = ny;
+   normal[2] = nz;
+}
+
+double geom_kernel::polygon_area(const double* xyz, size_t n)
+{
+   double normal[3];
+   newell_normal(xyz,n,normal);
+   return 0.5*std::sqrt(normal[0]*normal[0] + normal[1]*normal[1] + normal[2]*normal[2]);
+}
+
+double geom_kernel::signed_area(const double* xy, size_t n)
+{
+   // shoelace sum over the edges, (x2-x1)(y2+y1) is negative for counter-clockwise loops
+   double sum = 0.0;
+   for(size_t i=0; i+1<n; i++) {
+      const double* a = xy + 2*i;
+      sum += (a[2] - a[0])*(a[3] + a[1]);
+   }
+   if(n > 1) {
+      const double* a = xy + 2*(n-1);
+      sum += (xy[0] - a[0])*(xy[1] + a[1]);
+   }
+   return -0.5*sum;
+}
@@ -0,0 +1,53 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef GEOM_KERNEL_H
+#define GEOM_KERNEL_H
+
+#include <cstddef>
+#include <carve/matrix.hpp>
+
+// geom_kernel holds the batch geometry loops shared by the exporters, the mesh checks and the
+// boolean helpers: transforms, bounds, triangle normals and areas, polygon normals and areas.
+// Points are contiguous x,y,z triples (x,y pairs in 2d), so an array of xvertex or dpos2d can be
+// passed directly. The batch loops work on fixed size blocks split into x, y and z lanes, so the
+// compiler vectorizes the arithmetic for the target, and this is the one place to tune them.
+
+class geom_kernel {
+public:
+   // transform n points in place by the affine matrix t, nothing is done for the identity
+   static void transform_xyz(const carve::math::Matrix& t, double* xyz, size_t n);
+
+   // axis aligned bounds of n > 0 points
+   static void bounds(const double* xyz, size_t n, double pmin[3], double pmax[3]);
+
+   // unit normals of n triangles, given by 3 corners (9 values) each. Zero area triangles get (0,0,0)
+   static void triangle_normals(const double* corners, size_t n, double* normals);
+
+   // areas of n triangles, given by 3 corners (9 values) each
+   static void triangle_areas(const double* corners, size_t n, double* areas);
+
+   // Newell normal of a closed polygon of n points, its length is twice the polygon area
+   static void newell_normal(const double* xyz, size_t n, double normal[3]);
+
+   // area of a closed, planar polygon of n points
+   static double polygon_area(const double* xyz, size_t n);
+
+   // signed area of a closed 2d polygon of n points, positive for counter-clockwise
+   static double signed_area(const double* xy, size_t n);
+};
+
+#endif // GEOM_KERNEL_H
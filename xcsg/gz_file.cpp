@@ -0,0 +1,61 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "gz_file.h"
+#include <stdexcept>
+#include <vector>
+
+static void put32(std::vector<unsigned char>& buf, uint32_t v) { for(int i=0; i<4; i++) buf.push_back(static_cast<unsigned char>(v >> (8*i))); }
+
+static void put(FILE* file, const std::vector<unsigned char>& buf)
+{
+   if(std::fwrite(buf.data(),1,buf.size(),file) != buf.size()) throw std::runtime_error("gz_file: write error");
+}
+
+gz_file::gz_file(FILE* file, int level)
+: m_file(file)
+{
+   // no file name or modification time, so equal models give equal files
+   std::vector<unsigned char> h = { 0x1f, 0x8b, 8, 0 };   // magic, deflate, no flags
+   put32(h,0);                                             // mtime
+   h.push_back(0);                                         // extra flags
+   h.push_back(255);                                       // unknown OS
+   put(m_file,h);
+
+   m_deflate.reset(new deflate_stream(m_file,level));
+}
+
+gz_file::~gz_file()
+{}
+
+void gz_file::write(const char* data, size_t nbytes)
+{
+   if(!m_deflate) throw std::logic_error("gz_file: file is closed");
+   m_deflate->write(data,nbytes);
+}
+
+void gz_file::close()
+{
+   if(!m_deflate) return;
+   m_deflate->finish();
+
+   // the uncompressed size is stored modulo 2^32
+   std::vector<unsigned char> t;
+   put32(t,m_deflate->crc());
+   put32(t,static_cast<uint32_t>(m_deflate->size()));
+   put(m_file,t);
+   m_deflate.reset();
+}
@@ -0,0 +1,50 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef GZ_FILE_H
+#define GZ_FILE_H
+
+#include <cstdio>
+#include <memory>
+#include "deflate_stream.h"
+
+// gz_file writes gzip compressed data (RFC 1952) to an open file, for exports requested with
+// --compress gz. The data is compressed in parallel as a deflate_stream, so no separate pass
+// over the uncompressed file is needed.
+//
+//    gz_file gz(file);
+//    gz.write(data,nbytes);   // repeated
+//    gz.close();
+//
+// Write errors are thrown as std::runtime_error
+
+class gz_file {
+public:
+   gz_file(FILE* file, int level = -1);
+   virtual ~gz_file();
+
+   // append uncompressed data
+   void write(const char* data, size_t nbytes);
+
+   // end the compressed data and write the gzip trailer. The file is not closed
+   void close();
+
+private:
+   FILE*                           m_file;
+   std::unique_ptr<deflate_stream> m_deflate;
+};
+
+#endif // GZ_FILE_H
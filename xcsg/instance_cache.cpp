@@ -0,0 +1,160 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "instance_cache.h"
+#include "mesh_cache.h"
+#include "mesh_utils.h"
+#include "compile_context.h"
+#include <vector>
+
+instance_cache& instance_cache::singleton()
+{
+   compile_context* ctx = compile_context::current();
+   if(ctx) return ctx->instances();
+   static instance_cache instance;
+   return instance;
+}
+
+instance_cache::instance_cache()
+: m_shared(0)
+, m_reused(0)
+{}
+
+instance_cache::~instance_cache()
+{}
+
+std::string instance_cache::register_instance(const cf_xmlNode& node)
+{
+   std::string hash = mesh_cache::subtree_hash(node,false);
+   register_instance(hash);
+   return hash;
+}
+
+void instance_cache::register_instance(const std::string& instance_hash)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_count[instance_hash]++;
+}
+
+void instance_cache::register_instances(instance_cache& other)
+{
+   if(&other == this) return;
+   std::map<std::string,size_t> counts;
+   {
+      std::lock_guard<std::mutex> lock(other.m_mutex);
+      counts = other.m_count;
+   }
+   std::lock_guard<std::mutex> lock(m_mutex);
+   for(auto& c : counts) m_count[c.first] += c.second;
+}
+
+bool instance_cache::is_shared(const std::string& instance_hash)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   auto ic = m_count.find(instance_hash);
+   return ic != m_count.end() && ic->second > 1;
+}
+
+instance_cache::MeshSet_ptr instance_cache::get(const std::string& instance_hash, const carve::math::Matrix& t, compute_function compute)
+{
+   MeshSet_ptr local;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto ic = m_count.find(instance_hash);
+      if(ic == m_count.end() || ic->second < 2) return compute(t);
+
+      auto it = m_cache.find(instance_hash);
+      if(it != m_cache.end()) local = it->second;
+   }
+
+   if(local) {
+      m_reused++;
+   }
+   else {
+      // compute outside the lock, if another thread got there first we use its copy.
+      // Waiting for the other thread instead could block a pool worker it depends on
+      MeshSet_ptr created = compute(carve::math::Matrix());
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto ins = m_cache.insert(std::make_pair(instance_hash,created));
+      if(ins.second) m_shared++;
+      else           m_reused++;
+      local = ins.first->second;
+   }
+
+   return transformed_copy(*local,t);
+}
+
+void instance_cache::clear()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_cache.clear();
+}
+
+instance_cache::MeshSet_ptr instance_cache::transformed_copy(const carve::mesh::MeshSet<3>& meshset, const carve::math::Matrix& t)
+{
+   return transformed_copies(meshset,std::vector<carve::math::Matrix>(1,t));
+}
+
+instance_cache::MeshSet_ptr instance_cache::transformed_copies(const carve::mesh::MeshSet<3>& meshset, const std::vector<carve::math::Matrix>& t)
+{
+   // the vertex and face index blocks are collected once and repeated for each copy
+   const size_t nv = meshset.vertex_storage.size();
+   std::vector<carve::geom3d::Vector> local_points;
+   local_points.reserve(nv);
+   for(auto& vertex : meshset.vertex_storage) {
+      local_points.push_back(vertex.v);
+   }
+
+   std::vector<int> local_indices;
+   size_t local_faces = 0;
+   if(nv > 0) {
+      const carve::mesh::Face<3>::vertex_t* v0 = &meshset.vertex_storage[0];
+      std::vector<carve::mesh::Face<3>::vertex_t*> verts;
+      for(carve::mesh::Mesh<3>* mesh : meshset.meshes) {
+         for(carve::mesh::Face<3>* face : mesh->faces) {
+            face->getVertices(verts);
+            local_indices.push_back(static_cast<int>(verts.size()));
+            for(auto vertex : verts) local_indices.push_back(static_cast<int>(vertex - v0));
+            local_faces++;
+         }
+      }
+   }
+
+   std::vector<carve::geom3d::Vector> points;
+   std::vector<int> face_indices;
+   points.reserve(nv*t.size());
+   face_indices.reserve(local_indices.size()*t.size());
+   for(auto& tc : t) {
+      const int offset = static_cast<int>(points.size());
+      points.insert(points.end(),local_points.begin(),local_points.end());
+      mesh_utils::transform_points(tc,nv,points.data()+offset);
+
+      // a left handed transform turns the faces inside out, so they must be reversed
+      bool reverse_face = mesh_utils::is_left_hand(tc);
+      for(size_t i=0; i<local_indices.size(); ) {
+         int n = local_indices[i++];
+         face_indices.push_back(n);
+         if(reverse_face) {
+            for(int k=n-1; k>=0; k--) face_indices.push_back(offset + local_indices[i+k]);
+         }
+         else {
+            for(int k=0; k<n; k++) face_indices.push_back(offset + local_indices[i+k]);
+         }
+         i += n;
+      }
+   }
+
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,local_faces*t.size(),face_indices);
+}
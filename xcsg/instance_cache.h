@@ -0,0 +1,84 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef INSTANCE_CACHE_H
+#define INSTANCE_CACHE_H
+
+#include <atomic>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <carve/csg.hpp>
+#include "csg_parser/cf_xmlNode.h"
+
+// instance_cache shares one mesh between structurally identical subtrees that differ
+// only in their own transformation. Such subtrees are identified by a hash of the xml
+// subtree excluding its own tmatrix. When a subtree occurs more than once in the model,
+// its mesh is computed once in local coordinates and each instance receives a transformed copy.
+
+class instance_cache {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+   typedef std::function<MeshSet_ptr(const carve::math::Matrix& t)> compute_function;
+
+   // the cache of the current compile_context, or the process wide cache outside a compilation
+   static instance_cache& singleton();
+
+   // compute the instance hash of the subtree and count it as one occurrence in the model
+   std::string register_instance(const cf_xmlNode& node);
+
+   // count one more occurrence of an already computed instance hash
+   void register_instance(const std::string& instance_hash);
+
+   // count the occurrences registered in other, for another compilation of the same built model
+   void register_instances(instance_cache& other);
+
+   // return the mesh of the subtree transformed by t. For subtrees occurring once,
+   // compute(t) is called directly. Otherwise compute(identity) is called once and cached
+   MeshSet_ptr get(const std::string& instance_hash, const carve::math::Matrix& t, compute_function compute);
+
+   // true if the subtree occurs more than once in the model, so its mesh is shared
+   bool is_shared(const std::string& instance_hash);
+
+   // number of distinct shared meshes and number of instances created from them
+   size_t shared() const { return m_shared; }
+   size_t reused() const { return m_reused; }
+
+   // remove all cached meshes
+   void clear();
+
+   // create a copy of meshset transformed by t
+   static MeshSet_ptr transformed_copy(const carve::mesh::MeshSet<3>& meshset, const carve::math::Matrix& t);
+
+   // create one mesh set holding a copy of meshset for each transform. The copies must not touch
+   static MeshSet_ptr transformed_copies(const carve::mesh::MeshSet<3>& meshset, const std::vector<carve::math::Matrix>& t);
+
+protected:
+   friend class compile_context;
+   instance_cache();
+   virtual ~instance_cache();
+
+private:
+   std::mutex                          m_mutex;
+   std::map<std::string,size_t>        m_count;    // instance hash -> occurrences in model
+   std::map<std::string,MeshSet_ptr>   m_cache;    // instance hash -> mesh in local coordinates
+   std::atomic<size_t>                 m_shared;
+   std::atomic<size_t>                 m_reused;
+};
+
+#endif // INSTANCE_CACHE_H
@@ -23,6 +23,8 @@ namespace bdt = boost::date_time;
 
 #include "boost_command_line.h"
 #include "xcsg_main.h"
+#include "xcsg_server.h"
+#include "message_log.h"
 
 
 string elapsed_time(bpt::ptime time_begin, bpt::ptime time_end)
@@ -46,8 +48,23 @@ int main(int argc, char **argv)
    if(cmd.parsed_ok()) {
       // command line parameters accepted
       try {
+         if(cmd.service_mode()) {
+            // many jobs in this process
+            xcsg_server server(cmd);
+            if(cmd.count("jobs")) return (server.run_jobs(cmd.get<std::string>("jobs")) == 0)? 0 : 1;
+            server.serve(cmd.get<std::string>("serve"));
+            return 0;
+         }
+         if(cmd.batch_mode()) {
+            // many models with the same options in this process
+            xcsg_server server(cmd);
+            return (server.run_batch(cmd.input_files()) == 0)? 0 : 1;
+         }
+
          xcsg_main engine(cmd);
-         if(engine.run()) {
+         bool ok = engine.run();
+         message_log::singleton().flush();
+         if(ok) {
 
             // report the elapsed time
             cout << "xcsg finished using "<< elapsed_time(time_begin,bdt::microsec_clock<bpt::ptime>::local_time()) << endl;
@@ -55,6 +72,7 @@ int main(int argc, char **argv)
          }
       }
       catch(std::exception& ex) {
+         message_log::singleton().flush();
          cout << "xcsg finished with exception: " << ex.what() << endl;
          return 1;
       }
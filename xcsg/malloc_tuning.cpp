@@ -0,0 +1,38 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "malloc_tuning.h"
+#include <algorithm>
+
+#if defined(__GLIBC__)
+#include <malloc.h>
+#endif
+
+bool malloc_tuning::configure(size_t nthreads)
+{
+#if defined(__GLIBC__)
+   // blocks up to this size come from the arenas instead of separate mappings, 32MB is the glibc maximum
+   bool ok = (mallopt(M_MMAP_THRESHOLD,32*1024*1024) == 1);
+
+   // freed memory is kept until this much is unused at the top of a heap, scaled by the
+   // number of threads as each thread may hold freed memory in its own arena
+   size_t trim = std::min(std::max(nthreads,size_t(1)),size_t(16))*64*1024*1024;
+   ok = (mallopt(M_TRIM_THRESHOLD,static_cast<int>(std::min(trim,size_t(1)<<30))) == 1) && ok;
+   return ok;
+#else
+   (void)nthreads;
+   return false;
+#endif
+}
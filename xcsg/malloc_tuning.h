@@ -0,0 +1,36 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MALLOC_TUNING_H
+#define MALLOC_TUNING_H
+
+#include <cstddef>
+
+// malloc_tuning configures the C library allocator for the boolean workload (--malloc_tuning).
+// The carve meshes of intermediate results are allocated object by object in one boolean task
+// and freed in another, once the next level of the reduction has consumed them. Large blocks such
+// as the vertex storage are by default separate memory mappings, unmapped when freed and mapped
+// again by the next boolean, and freed heap memory is returned to the system as it comes free.
+// Mapping and unmapping serializes all threads of the process, so with many boolean threads
+// the memory is instead kept in the malloc arenas and reused.
+
+class malloc_tuning {
+public:
+   // keep freed memory in the process for reuse by the nthreads worker threads.
+   // Returns false when the C library does not support tuning (it is done for glibc only)
+   static bool configure(size_t nthreads);
+};
+
+#endif // MALLOC_TUNING_H
@@ -0,0 +1,86 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "memory_budget.h"
+#include "trace_recorder.h"
+
+// rough working set per input face of a carve boolean: the intersection data,
+// the split faces and the result mesh together
+static const size_t bytes_per_face = 2048;
+
+// reservations held by the current thread
+static thread_local size_t t_held = 0;
+
+memory_budget::memory_budget()
+: m_limit(0)
+, m_waits(0)
+, m_in_use(0)
+, m_running(0)
+{}
+
+memory_budget::~memory_budget()
+{}
+
+void memory_budget::set_limit(size_t bytes)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_limit = bytes;
+   m_waits = 0;
+}
+
+size_t memory_budget::boolean_bytes(size_t na, size_t nb)
+{
+   return (na+nb)*bytes_per_face;
+}
+
+void memory_budget::acquire(size_t bytes, size_t held)
+{
+   std::unique_lock<std::mutex> lock(m_mutex);
+   if(held == 0 && m_running > 0 && m_in_use+bytes > m_limit) {
+      trace_recorder::span span("memory_budget::wait");
+      m_waits++;
+      m_released.wait(lock,[this,bytes]() { return m_running==0 || m_in_use+bytes <= m_limit; });
+   }
+   m_in_use += bytes;
+   m_running++;
+}
+
+void memory_budget::release(size_t bytes)
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_in_use -= bytes;
+      m_running--;
+   }
+   m_released.notify_all();
+}
+
+memory_budget::reservation::reservation(size_t bytes)
+: m_bytes(bytes)
+, m_acquired(memory_budget::singleton().limit() > 0)
+{
+   if(m_acquired) {
+      memory_budget::singleton().acquire(m_bytes,t_held);
+      t_held++;
+   }
+}
+
+memory_budget::reservation::~reservation()
+{
+   if(m_acquired) {
+      t_held--;
+      memory_budget::singleton().release(m_bytes);
+   }
+}
@@ -0,0 +1,73 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MEMORY_BUDGET_H
+#define MEMORY_BUDGET_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+
+// memory_budget limits the estimated memory of the booleans running at the same time (--mem_limit).
+// A boolean reserves its estimated working set before it starts, and waits while the reservations
+// of the booleans already running would exceed the limit. A boolean is always admitted when no
+// other boolean is running, so one estimated larger than the limit still runs, alone.
+// A thread already holding a reservation is admitted without waiting: a boolean waiting for
+// its thread pool tasks runs other queued booleans on the same thread, and these could
+// otherwise wait for the reservation further up the stack forever.
+
+class memory_budget {
+public:
+   static memory_budget& singleton()  { static memory_budget instance; return instance;  }
+
+   // limit in bytes, 0 means no limit. Called before the booleans start
+   void   set_limit(size_t bytes);
+   size_t limit() const { return m_limit; }
+
+   // estimated peak bytes of a boolean between meshes with na and nb faces
+   static size_t boolean_bytes(size_t na, size_t nb);
+
+   // reservation holds bytes of the budget for its lifetime, no-op when there is no limit
+   class reservation {
+   public:
+      reservation(size_t bytes);
+      ~reservation();
+   private:
+      size_t m_bytes;
+      bool   m_acquired;
+   };
+
+   // number of booleans that had to wait for budget since set_limit
+   size_t waits() const { return m_waits; }
+
+protected:
+   memory_budget();
+   virtual ~memory_budget();
+
+   // held is the number of reservations already held by the calling thread
+   void acquire(size_t bytes, size_t held);
+   void release(size_t bytes);
+
+private:
+   std::atomic<size_t>     m_limit;
+   std::atomic<size_t>     m_waits;
+   std::mutex              m_mutex;
+   std::condition_variable m_released;
+   size_t                  m_in_use;    // bytes reserved by running booleans
+   size_t                  m_running;   // number of running booleans
+};
+
+#endif // MEMORY_BUDGET_H
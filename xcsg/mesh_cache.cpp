@@ -0,0 +1,385 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mesh_cache.h"
+#include "compile_context.h"
+#include "mesh_utils.h"
+#include "carve_boolean.h"
+#include "clipper_boolean.h"
+#include "xmesh_file.h"
+#include "instance_cache.h"
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <atomic>
+#include <vector>
+
+// FNV-1a, 64 bit
+static const uint64_t fnv_offset = 14695981039346656037ULL;
+static const uint64_t fnv_prime  = 1099511628211ULL;
+
+static void hash_bytes(uint64_t& h, const void* data, size_t nbytes)
+{
+   const unsigned char* p = static_cast<const unsigned char*>(data);
+   for(size_t i=0; i<nbytes; i++) {
+      h ^= p[i];
+      h *= fnv_prime;
+   }
+}
+
+static void hash_string(uint64_t& h, const std::string& s)
+{
+   // include the length so that concatenated strings cannot collide
+   uint64_t len = s.length();
+   hash_bytes(h,&len,sizeof(len));
+   hash_bytes(h,s.data(),s.length());
+}
+
+static void hash_ptree(uint64_t& h, const cf_xmlNode::ptree& pt)
+{
+   hash_string(h,pt.data());
+   uint64_t nchild = pt.size();
+   hash_bytes(h,&nchild,sizeof(nchild));
+   for(auto& child : pt) {
+      hash_string(h,child.first);
+      hash_ptree(h,child.second);
+   }
+}
+
+static std::string to_hex(uint64_t h)
+{
+   std::ostringstream out;
+   out << std::hex << std::setw(16) << std::setfill('0') << h;
+   return out.str();
+}
+
+static const std::string manifest_name   = "manifest.txt";
+static const std::string checkpoint_name = "checkpoint.txt";
+
+mesh_cache::mesh_cache()
+: m_memory(false)
+, m_hits(0)
+, m_misses(0)
+, m_checkpoint_interval(0)
+{}
+
+mesh_cache::~mesh_cache()
+{}
+
+void mesh_cache::set_cache_dir(const std::string& cache_dir)
+{
+   if(cache_dir.length() > 0) {
+      boost::filesystem::create_directories(cache_dir);
+   }
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_cache_dir = cache_dir;
+   m_subtrees.clear();
+   m_entries.clear();
+   m_completed.clear();
+   m_hits   = 0;
+   m_misses = 0;
+   m_checkpoint_interval = 0;
+}
+
+void mesh_cache::set_memory(bool memory)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_memory = memory;
+   if(!memory) m_results.clear();
+}
+
+std::string mesh_cache::subtree_hash(const cf_xmlNode& node, bool include_transform)
+{
+   uint64_t h = fnv_offset;
+   hash_string(h,node.tag());
+   hash_string(h,node.get_value(std::string("")));
+   for(auto it=node.begin(); it!=node.end(); it++) {
+      if(!include_transform && it->first == "tmatrix") continue;
+      hash_string(h,it->first);
+      hash_ptree(h,it->second);
+   }
+   return to_hex(h);
+}
+
+std::string mesh_cache::register_subtree(const cf_xmlNode& node)
+{
+   std::string hash = subtree_hash(node);
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_subtrees.insert(hash);
+   return hash;
+}
+
+std::string mesh_cache::cache_path(const std::string& file_name) const
+{
+   boost::filesystem::path path(m_cache_dir);
+   path /= file_name;
+   return path.string();
+}
+
+std::string mesh_cache::cache_file(const std::string& subtree_hash, const carve::math::Matrix& t) const
+{
+   uint64_t h = fnv_offset;
+   hash_string(h,subtree_hash);
+   for(size_t i=0; i<16; i++) {
+      double v = t.v[i];
+      hash_bytes(h,&v,sizeof(v));
+   }
+   double tol = mesh_utils::secant_tolerance();
+   hash_bytes(h,&tol,sizeof(tol));
+   double preview = mesh_utils::preview_tolerance();
+   if(preview > 0.0) hash_bytes(h,&preview,sizeof(preview));
+
+   // simplified results differ from the exact ones
+   double simplify_angle  = carve_boolean::simplify_angle();
+   double simplify_length = carve_boolean::simplify_length();
+   if(simplify_angle > 0.0)  hash_bytes(h,&simplify_angle,sizeof(simplify_angle));
+   if(simplify_length > 0.0) hash_bytes(h,&simplify_length,sizeof(simplify_length));
+   if(carve_boolean::snap_bits() > 0) {
+      compile_context* ctx = compile_context::current();
+      double snap = (ctx)? ctx->snap_spacing() : 0.0;
+      int bits    = carve_boolean::snap_bits();
+      hash_bytes(h,&bits,sizeof(bits));
+      hash_bytes(h,&snap,sizeof(snap));
+   }
+   double simplify2d = clipper_boolean::simplify_fraction();
+   if(simplify2d > 0.0) hash_bytes(h,&simplify2d,sizeof(simplify2d));
+
+   // so do results of other engines than carve
+   std::string engine = carve_boolean::engine()->cache_key();
+   if(engine != "carve") hash_string(h,engine);
+
+   return to_hex(h) + ".xmesh";
+}
+
+mesh_cache::MeshSet_ptr mesh_cache::get(const std::string& subtree_hash, const carve::math::Matrix& t, compute_function compute)
+{
+   if(!enabled()) return compute();
+
+   std::string file_name = cache_file(subtree_hash,t);
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_entries[file_name] = subtree_hash;
+   }
+
+   if(m_memory) {
+      // the caller may modify the mesh it gets, so the cache keeps its own copy
+      MeshSet_ptr cached;
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         auto it = m_results.find(file_name);
+         if(it != m_results.end()) cached = it->second.second;
+      }
+      if(cached) {
+         m_hits++;
+         return instance_cache::transformed_copy(*cached,carve::math::Matrix());
+      }
+      m_misses++;
+      MeshSet_ptr meshset = compute();
+      if(meshset) {
+         MeshSet_ptr copy = instance_cache::transformed_copy(*meshset,carve::math::Matrix());
+         std::lock_guard<std::mutex> lock(m_mutex);
+         m_results[file_name] = std::make_pair(subtree_hash,copy);
+      }
+      return meshset;
+   }
+
+   std::string path = cache_path(file_name);
+   MeshSet_ptr meshset = load(path);
+   if(meshset) {
+      m_hits++;
+      checkpoint(file_name,subtree_hash);
+   }
+   else {
+      m_misses++;
+      meshset = compute();
+      if(meshset && store(path,*meshset)) checkpoint(file_name,subtree_hash);
+   }
+   return meshset;
+}
+
+mesh_cache::MeshSet_ptr mesh_cache::load(const std::string& path)
+{
+   if(!boost::filesystem::exists(path)) return nullptr;
+   try {
+      xmesh_reader reader(path);
+      return reader.create_carve_mesh();
+   }
+   catch(std::exception&) {
+      // invalid cache file, it will be recomputed and overwritten
+      return nullptr;
+   }
+}
+
+bool mesh_cache::store(const std::string& path, const carve::mesh::MeshSet<3>& meshset)
+{
+   // write to a temporary file first, so that an interrupted run never leaves a partial cache file.
+   // The counter keeps temporary names unique when several threads store at the same time
+   static std::atomic<unsigned int> counter(0);
+   std::string tmp_path = path + ".tmp" + std::to_string(counter++);
+   boost::system::error_code ec;
+   try {
+      xmesh_file::write_file(meshset,tmp_path);
+   }
+   catch(std::exception&) {
+      // failing to cache is not an error, the result is simply computed next time
+      boost::filesystem::remove(tmp_path,ec);
+      return false;
+   }
+   boost::filesystem::rename(tmp_path,path,ec);
+   if(ec) boost::filesystem::remove(tmp_path,ec);
+   return !ec;
+}
+
+std::map<std::string,std::string> mesh_cache::read_manifest() const
+{
+   std::map<std::string,std::string> manifest;
+   std::ifstream in(cache_path(manifest_name));
+   std::string file_name,hash;
+   while(in >> file_name >> hash) {
+      manifest[file_name] = hash;
+   }
+   return manifest;
+}
+
+void mesh_cache::update_manifest(std::ostream& out)
+{
+   if(!enabled()) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(m_memory) {
+      // as below, results not visited in this run are kept while their subtree is in the model
+      size_t nremoved = 0;
+      for(auto it=m_results.begin(); it!=m_results.end(); ) {
+         if(m_subtrees.find(it->second.first) == m_subtrees.end()) {
+            it = m_results.erase(it);
+            nremoved++;
+         }
+         else it++;
+      }
+      out << "...memory cache: " << m_hits << " reused, " << m_misses << " recomputed, "
+          << nremoved << " stale results released, " << m_results.size() << " kept" << std::endl;
+      return;
+   }
+   std::map<std::string,std::string> previous = read_manifest();
+
+   std::set<std::string> previous_subtrees;
+   for(auto& p : previous) previous_subtrees.insert(p.second);
+
+   size_t nchanged = 0;
+   for(auto& hash : m_subtrees) {
+      if(previous_subtrees.find(hash) == previous_subtrees.end()) nchanged++;
+   }
+
+   // Entries not visited in this run are kept as long as their subtree is still in the model.
+   // They are skipped when an enclosing subtree is loaded from the cache, but are needed
+   // again once something else inside that subtree changes.
+   std::map<std::string,std::string> current = m_entries;
+   size_t nremoved = 0;
+   for(auto& p : previous) {
+      if(current.find(p.first) != current.end()) continue;
+      if(m_subtrees.find(p.second) != m_subtrees.end()) {
+         current.insert(p);
+      }
+      else {
+         boost::system::error_code ec;
+         boost::filesystem::remove(cache_path(p.first),ec);
+         nremoved++;
+      }
+   }
+
+   std::string manifest_path = cache_path(manifest_name);
+   std::string tmp_path = manifest_path + ".tmp";
+   {
+      std::ofstream manifest(tmp_path);
+      for(auto& p : current) manifest << p.first << ' ' << p.second << std::endl;
+   }
+   boost::system::error_code ec;
+   boost::filesystem::rename(tmp_path,manifest_path,ec);
+
+   out << "...incremental: " << nchanged << " of " << m_subtrees.size() << " cached subtrees changed, "
+       << m_hits << " reused, " << m_misses << " recomputed, " << nremoved << " stale entries removed" << std::endl;
+}
+
+void mesh_cache::set_checkpoint_interval(double interval)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_checkpoint_interval = interval;
+   m_last_checkpoint     = boost::posix_time::microsec_clock::universal_time();
+}
+
+void mesh_cache::checkpoint(const std::string& file_name, const std::string& subtree_hash)
+{
+   if(m_checkpoint_interval <= 0) return;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_completed[file_name] = subtree_hash;
+      boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+      if(0.001*(now - m_last_checkpoint).total_milliseconds() < m_checkpoint_interval) return;
+      m_last_checkpoint = now;
+   }
+   write_checkpoint();
+}
+
+void mesh_cache::write_checkpoint()
+{
+   if(!enabled() || m_checkpoint_interval <= 0) return;
+
+   // the results themselves are already stored, the checkpoint file records which subtrees
+   // they complete. It is replaced atomically so that a crash leaves the previous one
+   std::lock_guard<std::mutex> lock(m_mutex);
+   std::string checkpoint_path = cache_path(checkpoint_name);
+   std::string tmp_path = checkpoint_path + ".tmp";
+   {
+      std::ofstream checkpoint(tmp_path);
+      for(auto& p : m_completed) checkpoint << p.first << ' ' << p.second << std::endl;
+   }
+   boost::system::error_code ec;
+   boost::filesystem::rename(tmp_path,checkpoint_path,ec);
+}
+
+size_t mesh_cache::checkpoint_completed() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   std::ifstream in(cache_path(checkpoint_name));
+   std::set<std::string> completed;
+   std::string file_name,hash;
+   while(in >> file_name >> hash) {
+      if(m_subtrees.find(hash) != m_subtrees.end() && boost::filesystem::exists(cache_path(file_name))) completed.insert(hash);
+   }
+   return completed.size();
+}
+
+size_t mesh_cache::nsubtrees() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_subtrees.size();
+}
+
+void mesh_cache::clear_checkpoint(const std::string& cache_dir, bool remove_dir)
+{
+   if(!boost::filesystem::is_directory(cache_dir)) return;
+
+   boost::system::error_code ec;
+   std::vector<boost::filesystem::path> files;
+   for(auto& entry : boost::filesystem::directory_iterator(cache_dir)) {
+      const boost::filesystem::path& file = entry.path();
+      if(file.extension() == ".xmesh" || file.filename() == checkpoint_name) files.push_back(file);
+   }
+   for(auto& file : files) boost::filesystem::remove(file,ec);
+
+   // remove fails when other files are left in the directory
+   if(remove_dir) boost::filesystem::remove(cache_dir,ec);
+}
@@ -0,0 +1,142 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MESH_CACHE_H
+#define MESH_CACHE_H
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <set>
+#include <string>
+#include <carve/csg.hpp>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include "csg_parser/cf_xmlNode.h"
+
+// mesh_cache stores the resulting meshes of expensive CSG nodes in a cache directory,
+// so that unchanged subtrees are loaded from disk instead of recomputed in later runs.
+// A cache entry is identified by a hash of the xml subtree, the accumulated
+// transformation and the secant tolerance. The cache is disabled unless a directory is set.
+//
+// In incremental mode a manifest in the cache directory records the subtrees of the
+// previous run. It is used to report what changed and to remove cache entries that
+// no longer belong to any subtree of the model.
+//
+// In checkpoint mode the cache directory holds the intermediate results of one long build,
+// so that a crashed build can be resumed. Each result is stored as soon as its subtree is
+// complete, and a checkpoint file listing the completed subtrees is rewritten periodically.
+// A resumed build loads the completed subtrees and computes only the outstanding ones.
+//
+// In memory mode (xcsg --watch) the results are kept in memory instead of a directory, for
+// repeated runs in the same process. Entries of subtrees that left the model are released
+// by update_manifest.
+
+class mesh_cache {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+   typedef std::function<MeshSet_ptr()> compute_function;
+
+   static mesh_cache& singleton()  { static mesh_cache instance; return instance;  }
+
+   // enable the cache, the directory is created if required. An empty string disables the cache.
+   // This starts a new run, the model subtrees and counters of the previous run are cleared
+   void set_cache_dir(const std::string& cache_dir);
+
+   // keep the results in memory across runs of this process instead of in the cache directory.
+   // Disabling memory mode releases the results
+   void set_memory(bool memory);
+   bool memory() const { return m_memory; }
+
+   // true if a cache directory has been set or memory mode is on
+   bool enabled() const { return m_memory || m_cache_dir.length() > 0; }
+
+   // hash of the xml subtree, including tags, attributes and values of all children.
+   // With include_transform=false the tmatrix of the node itself is ignored
+   static std::string subtree_hash(const cf_xmlNode& node, bool include_transform = true);
+
+   // compute the subtree hash and record it as part of the current model
+   std::string register_subtree(const cf_xmlNode& node);
+
+   // return the cached mesh for the subtree transformed by t, or call compute and cache its result.
+   // compute is called directly when the cache is disabled
+   MeshSet_ptr get(const std::string& subtree_hash, const carve::math::Matrix& t, compute_function compute);
+
+   // compare the current model with the manifest of the previous run, remove stale
+   // cache entries and write the new manifest. A summary is written to out.
+   // In memory mode, the results of subtrees no longer in the model are released
+   void update_manifest(std::ostream& out);
+
+   // enable checkpoint mode, the checkpoint file is written at most every interval seconds.
+   // 0 disables checkpoint mode. Call after set_cache_dir
+   void set_checkpoint_interval(double interval);
+
+   // write the checkpoint file of the completed subtrees now
+   void write_checkpoint();
+
+   // number of subtrees of the current model listed as completed in the checkpoint file
+   size_t checkpoint_completed() const;
+
+   // number of subtrees registered for the current model
+   size_t nsubtrees() const;
+
+   // number of subtrees reused from and recomputed for the cache in this run
+   size_t hits() const   { return m_hits; }
+   size_t misses() const { return m_misses; }
+
+   // remove the results and the checkpoint file from cache_dir, with remove_dir also the
+   // directory itself when it is then empty. Other files in the directory are left alone
+   static void clear_checkpoint(const std::string& cache_dir, bool remove_dir);
+
+protected:
+   mesh_cache();
+   virtual ~mesh_cache();
+
+   // full path of cache file for subtree transformed by t
+   std::string cache_file(const std::string& subtree_hash, const carve::math::Matrix& t) const;
+
+   // full path of a file in the cache directory
+   std::string cache_path(const std::string& file_name) const;
+
+   // read/write cache file, load returns nullptr if the file is missing or invalid, store returns false on failure
+   static MeshSet_ptr load(const std::string& path);
+   static bool store(const std::string& path, const carve::mesh::MeshSet<3>& meshset);
+
+   // record a completed subtree and write the checkpoint file when the interval has passed
+   void checkpoint(const std::string& file_name, const std::string& subtree_hash);
+
+   // read the manifest, mapping cache file names to subtree hashes
+   std::map<std::string,std::string> read_manifest() const;
+
+private:
+   std::string m_cache_dir;
+   bool        m_memory;
+
+   mutable std::mutex                 m_mutex;
+   std::set<std::string>              m_subtrees;   // subtree hashes of the current model
+   std::map<std::string,std::string>  m_entries;    // cache file name -> subtree hash, used in this run
+   std::atomic<size_t>                m_hits;
+   std::atomic<size_t>                m_misses;
+   std::map<std::string,std::pair<std::string,MeshSet_ptr>> m_results;  // memory mode: cache file name -> subtree hash, result
+
+   double                             m_checkpoint_interval;  // seconds, 0 when not in checkpoint mode
+   boost::posix_time::ptime           m_last_checkpoint;
+   std::map<std::string,std::string>  m_completed;            // cache file name -> subtree hash, completed in this run
+};
+
+#endif // MESH_CACHE_H
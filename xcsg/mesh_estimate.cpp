@@ -0,0 +1,198 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mesh_estimate.h"
+#include "array_pattern.h"
+#include "boolean_timer.h"
+#include "memory_budget.h"
+#include <algorithm>
+
+mesh_estimate::mesh_estimate()
+: nfaces(0)
+, nbool(0)
+, ndisjoint(0)
+, cost(0.0)
+, boolean_bytes(0)
+, nleaves(0)
+, leaf_faces(0)
+{}
+
+mesh_estimate mesh_estimate::leaf(size_t nfaces, const xbox3d& box)
+{
+   mesh_estimate e;
+   e.nfaces     = nfaces;
+   e.box        = box;
+   e.nleaves    = 1;
+   e.leaf_faces = nfaces;
+   return e;
+}
+
+mesh_estimate mesh_estimate::combine(const mesh_estimate& a, const mesh_estimate& b, carve::csg::CSG::OP op)
+{
+   mesh_estimate e;
+   e.nbool         = a.nbool + b.nbool + 1;
+   e.ndisjoint     = a.ndisjoint + b.ndisjoint;
+   e.cost          = a.cost + b.cost;
+   e.boolean_bytes = std::max(a.boolean_bytes,b.boolean_bytes);
+   e.nleaves       = a.nleaves + b.nleaves;
+   e.leaf_faces    = a.leaf_faces + b.leaf_faces;
+
+   // touching boxes count as overlapping, as in carve_boolean::compute_disjoint
+   bool disjoint = !a.box.intersects(b.box);
+   switch(op) {
+      case carve::csg::CSG::A_MINUS_B:
+      {
+         e.box    = a.box;
+         e.nfaces = (disjoint)? a.nfaces : a.nfaces + b.nfaces;
+         break;
+      }
+      case carve::csg::CSG::INTERSECTION:
+      {
+         e.box    = a.box.intersection(b.box);
+         e.nfaces = (disjoint)? 0 : a.nfaces + b.nfaces;
+         break;
+      }
+      default:
+      {
+         e.box = a.box;
+         e.box.enclose(b.box);
+         e.nfaces = a.nfaces + b.nfaces;
+         break;
+      }
+   };
+
+   if(disjoint) {
+      e.ndisjoint++;
+   }
+   else {
+      e.cost         += boolean_timer::boolean_cost(a.nfaces,b.nfaces);
+      e.boolean_bytes = std::max(e.boolean_bytes,memory_budget::boolean_bytes(a.nfaces,b.nfaces));
+   }
+   return e;
+}
+
+mesh_estimate mesh_estimate::combine(const std::vector<mesh_estimate>& operands, carve::csg::CSG::OP op)
+{
+   if(operands.size() == 0) return mesh_estimate();
+
+   if(op == carve::csg::CSG::INTERSECTION) {
+      mesh_estimate e = operands[0];
+      for(size_t i=1; i<operands.size(); i++) e = combine(e,operands[i],op);
+      return e;
+   }
+   return reduce(operands,0,operands.size(),op);
+}
+
+mesh_estimate mesh_estimate::reduce(const std::vector<mesh_estimate>& operands, size_t begin, size_t end, carve::csg::CSG::OP op)
+{
+   if(end - begin == 1) return operands[begin];
+   size_t middle = begin + (end - begin)/2;
+   return combine(reduce(operands,begin,middle,op),reduce(operands,middle,end,op),op);
+}
+
+mesh_estimate mesh_estimate::minkowski(const mesh_estimate& a, const mesh_estimate& b)
+{
+   // the operands of a minkowski sum are rarely disjoint, the sum is always computed
+   mesh_estimate e = combine(a,b,carve::csg::CSG::UNION);
+   if(!a.box.intersects(b.box)) {
+      e.ndisjoint--;
+      e.cost         += boolean_timer::boolean_cost(a.nfaces,b.nfaces);
+      e.boolean_bytes = std::max(e.boolean_bytes,memory_budget::boolean_bytes(a.nfaces,b.nfaces));
+   }
+   e.box = a.box.minkowski_sum(b.box);
+   return e;
+}
+
+mesh_estimate mesh_estimate::hull(const std::vector<mesh_estimate>& operands)
+{
+   mesh_estimate e;
+   for(auto& op : operands) {
+      e.nfaces     += op.nfaces;
+      e.box.enclose(op.box);
+      e.nbool      += op.nbool;
+      e.ndisjoint  += op.ndisjoint;
+      e.cost       += op.cost;
+      e.boolean_bytes = std::max(e.boolean_bytes,op.boolean_bytes);
+      e.nleaves    += op.nleaves;
+      e.leaf_faces += op.leaf_faces;
+   }
+   e.nbool++;
+   e.cost += boolean_timer::boolean_cost(e.nfaces,0);
+   return e;
+}
+
+mesh_estimate mesh_estimate::copies(const mesh_estimate& local, const std::vector<carve::math::Matrix>& transforms)
+{
+   if(transforms.size() == 0) return mesh_estimate();
+
+   // the work of computing local is done once, the other copies only add their faces
+   std::vector<mesh_estimate> operands(transforms.size());
+   std::vector<xbox3d> boxes(transforms.size());
+   for(size_t i=0; i<transforms.size(); i++) {
+      boxes[i].enclose(transforms[i],local.box);
+      operands[i].nfaces = local.nfaces;
+      operands[i].box    = boxes[i];
+   }
+   operands[0] = local.transformed(transforms[0]);
+
+   if(!array_pattern::disjoint(boxes,1.0E-9*local.box.diagonal())) {
+      return combine(operands,carve::csg::CSG::UNION);
+   }
+
+   mesh_estimate e = operands[0];
+   for(size_t i=1; i<operands.size(); i++) {
+      e.box.enclose(boxes[i]);
+      e.nfaces += local.nfaces;
+   }
+   e.nbool     += transforms.size() - 1;
+   e.ndisjoint += transforms.size() - 1;
+   return e;
+}
+
+mesh_estimate mesh_estimate::transformed(const carve::math::Matrix& t) const
+{
+   mesh_estimate e = *this;
+   e.box = xbox3d();
+   e.box.enclose(t,box);
+   return e;
+}
+
+size_t mesh_estimate::peak_bytes(size_t nthreads) const
+{
+   // the largest booleans may run on all threads at once
+   size_t nrun = std::max(size_t(1),std::min(nthreads,nbool - ndisjoint));
+   return nrun*boolean_bytes;
+}
+
+void mesh_estimate::write_json(std::ostream& out, size_t nthreads) const
+{
+   out << "{\"faces\": " << nfaces
+       << ", \"booleans\": " << nbool
+       << ", \"disjoint\": " << ndisjoint
+       << ", \"cost\": " << cost
+       << ", \"boolean_bytes\": " << boolean_bytes
+       << ", \"peak_bytes\": " << peak_bytes(nthreads)
+       << ", \"leaves\": " << nleaves
+       << ", \"leaf_faces\": " << leaf_faces
+       << ", \"box\": ";
+   if(box.initialised()) {
+      out << "[[" << box.p1()[0] << ", " << box.p1()[1] << ", " << box.p1()[2] << "], ["
+          << box.p2()[0] << ", " << box.p2()[1] << ", " << box.p2()[2] << "]]";
+   }
+   else {
+      out << "null";
+   }
+   out << "}";
+}
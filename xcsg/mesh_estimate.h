@@ -0,0 +1,79 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MESH_ESTIMATE_H
+#define MESH_ESTIMATE_H
+
+#include <cstddef>
+#include <ostream>
+#include <vector>
+#include <carve/csg.hpp>
+#include "xbox3d.h"
+
+// mesh_estimate describes the mesh of a CSG subtree and the work of computing it, estimated without
+// running any 3d boolean (--estimate). Leaves are meshed, primitives come from the primitive_cache.
+// Booleans are combined as the schedulers do: operands with disjoint boxes are resolved at no cost,
+// like carve_boolean::compute_disjoint, and the others cost boolean_timer::boolean_cost with a working
+// set of memory_budget::boolean_bytes. The face count of a boolean result is bounded by the sum of
+// its operands, so the face counts and costs are upper bounds.
+
+class mesh_estimate {
+public:
+   mesh_estimate();
+
+   // a leaf mesh with nfaces faces within box
+   static mesh_estimate leaf(size_t nfaces, const xbox3d& box);
+
+   // a op b, counting one boolean
+   static mesh_estimate combine(const mesh_estimate& a, const mesh_estimate& b, carve::csg::CSG::OP op);
+
+   // reduce the operands with op: a union pairwise in a balanced tree, an intersection one operand at a time.
+   // No operands give an empty estimate
+   static mesh_estimate combine(const std::vector<mesh_estimate>& operands, carve::csg::CSG::OP op);
+
+   // minkowski sum of a and b, estimated as one boolean between them giving a mesh with the faces of both
+   static mesh_estimate minkowski(const mesh_estimate& a, const mesh_estimate& b);
+
+   // convex hull of the operands, estimated as one boolean giving a mesh with the faces of all operands
+   static mesh_estimate hull(const std::vector<mesh_estimate>& operands);
+
+   // union of copies of local placed by transforms, as computed by array3d and symmetry3d: local is computed
+   // once, and copies with disjoint boxes are concatenated
+   static mesh_estimate copies(const mesh_estimate& local, const std::vector<carve::math::Matrix>& transforms);
+
+   // the same estimate with the box enclosing the box transformed by t
+   mesh_estimate transformed(const carve::math::Matrix& t) const;
+
+   // boolean_bytes of the largest booleans running on nthreads threads at once
+   size_t peak_bytes(size_t nthreads) const;
+
+   // the estimate as a JSON object, with peak_bytes for nthreads booleans running at once
+   void write_json(std::ostream& out, size_t nthreads) const;
+
+public:
+   size_t nfaces;          // faces of the resulting mesh
+   xbox3d box;             // bounding box of the result, uninitialised if it is empty
+   size_t nbool;           // 3d booleans in the subtree
+   size_t ndisjoint;       // booleans resolved from disjoint boxes
+   double cost;            // boolean_timer::boolean_cost of all booleans
+   size_t boolean_bytes;   // memory_budget::boolean_bytes of the largest boolean
+   size_t nleaves;         // leaf meshes created, e.g. primitives and extrusions
+   size_t leaf_faces;      // faces of all leaf meshes
+
+private:
+   static mesh_estimate reduce(const std::vector<mesh_estimate>& operands, size_t begin, size_t end, carve::csg::CSG::OP op);
+};
+
+#endif // MESH_ESTIMATE_H
@@ -0,0 +1,594 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "mesh_source.h"
+#include "xmesh_file.h"
+#include "thread_pool.h"
+#include <boost/filesystem.hpp>
+#include <boost/endian/conversion.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+
+static const bool little_endian_host = (boost::endian::order::native == boost::endian::order::little);
+
+// read a value of type T from possibly unaligned data, reversing the bytes when swap is set
+template <typename T>
+static T read_value(const char* p, bool swap)
+{
+   T v;
+   std::memcpy(&v,p,sizeof(T));
+   if(swap) {
+      char* c = reinterpret_cast<char*>(&v);
+      std::reverse(c,c+sizeof(T));
+   }
+   return v;
+}
+
+mesh_source::mesh_source(const std::string& file_path)
+: m_path(file_path)
+{
+   if(!boost::filesystem::exists(file_path)) throw std::runtime_error("mesh_source: file not found " + file_path);
+
+   std::string ext = boost::filesystem::path(file_path).extension().string();
+   std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+   if(ext == ".xmesh") {
+      read_xmesh(file_path);
+      return;
+   }
+
+   size_t size = static_cast<size_t>(boost::filesystem::file_size(file_path));
+   if(size == 0) throw std::runtime_error("mesh_source: empty file " + file_path);
+
+   boost::interprocess::file_mapping  file(file_path.c_str(),boost::interprocess::read_only);
+   boost::interprocess::mapped_region region(file,boost::interprocess::read_only);
+   const char* data = static_cast<const char*>(region.get_address());
+
+   if(ext == ".stl")      read_stl(data,size);
+   else if(ext == ".ply") read_ply(data,size);
+   else if(ext == ".obj") read_obj(data,size);
+   else if(ext == ".off") read_off(data,size);
+   else if(ext == ".f64") read_f64(data,size);
+   else throw std::runtime_error("mesh_source: unsupported file type '" + ext + "' for " + file_path);
+}
+
+mesh_source::~mesh_source()
+{}
+
+void mesh_source::read_xmesh(const std::string& file_path)
+{
+   xmesh_reader reader(file_path);
+
+   const double* v = reader.vertices();
+   m_vertices.reserve(reader.nvertices());
+   for(size_t iv=0; iv<reader.nvertices(); iv++) {
+      m_vertices.push_back(carve::geom::VECTOR(v[3*iv],v[3*iv+1],v[3*iv+2]));
+   }
+
+   const int32_t* indices = reader.indices();
+   m_faces.reserve(reader.nfaces());
+   size_t pos = 0;
+   std::vector<size_t> face;
+   for(size_t iface=0; iface<reader.nfaces(); iface++) {
+      if(pos >= reader.nindices()) throw std::runtime_error("mesh_source: face block too short in " + m_path);
+      int32_t nv = indices[pos++];
+      if(nv < 3 || pos+nv > reader.nindices()) throw std::runtime_error("mesh_source: invalid face size in " + m_path);
+      face.clear();
+      for(int32_t i=0; i<nv; i++) {
+         int32_t index = indices[pos++];
+         if(index < 0 || static_cast<size_t>(index) >= m_vertices.size()) throw std::runtime_error("mesh_source: vertex index out of range in " + m_path);
+         face.push_back(index);
+      }
+      m_faces.push_back(xface(face));
+   }
+}
+
+void mesh_source::read_stl(const char* data, size_t size)
+{
+   // binary STL: 80 byte header, uint32 triangle count, then 50 bytes per triangle
+   // (float32 normal, 3 float32 corners, uint16 attribute)
+   const bool swap = !little_endian_host;
+   size_t ntri = (size >= 84)? read_value<uint32_t>(data+80,swap) : 0;
+   if(size < 84 || size < 84 + 50*ntri) {
+      if(size >= 5 && std::equal(data,data+5,"solid")) {
+         read_stl_ascii(data,size);
+         return;
+      }
+      throw std::runtime_error("mesh_source: inconsistent size of binary STL " + m_path);
+   }
+
+   // corners are merged on their exact float bits
+   struct key_hash {
+      size_t operator()(const std::array<uint32_t,3>& k) const { return (size_t(k[0])*73856093) ^ (size_t(k[1])*19349663) ^ (size_t(k[2])*83492791); }
+   };
+   std::unordered_map<std::array<uint32_t,3>,size_t,key_hash> index;
+   index.reserve(ntri/2 + 3);
+   m_vertices.reserve(ntri/2 + 3);
+   m_faces.reserve(ntri);
+
+   for(size_t itri=0; itri<ntri; itri++) {
+      const char* p = data + 84 + 50*itri + 12;
+      size_t iv[3];
+      for(size_t k=0; k<3; k++, p+=12) {
+         std::array<uint32_t,3> bits = { read_value<uint32_t>(p,swap), read_value<uint32_t>(p+4,swap), read_value<uint32_t>(p+8,swap) };
+         auto it = index.find(bits);
+         if(it == index.end()) {
+            it = index.insert(std::make_pair(bits,m_vertices.size())).first;
+            m_vertices.push_back(carve::geom::VECTOR(read_value<float>(p,swap),read_value<float>(p+4,swap),read_value<float>(p+8,swap)));
+         }
+         iv[k] = it->second;
+      }
+
+      // skip degenerate triangles from the coordinate rounding
+      if(iv[0]!=iv[1] && iv[1]!=iv[2] && iv[2]!=iv[0]) m_faces.push_back(xface(iv[0],iv[1],iv[2]));
+   }
+}
+
+namespace {
+
+   // PLY scalar property types
+   struct ply_type {
+      ply_type() : size(0), is_float(false), is_signed(false) {}
+      size_t size;
+      bool   is_float;
+      bool   is_signed;
+   };
+
+   ply_type ply_type_from(const std::string& name)
+   {
+      ply_type t;
+      if(name=="char"   || name=="int8")         { t.size=1; t.is_signed=true; }
+      else if(name=="uchar"  || name=="uint8")   { t.size=1; }
+      else if(name=="short"  || name=="int16")   { t.size=2; t.is_signed=true; }
+      else if(name=="ushort" || name=="uint16")  { t.size=2; }
+      else if(name=="int"    || name=="int32")   { t.size=4; t.is_signed=true; }
+      else if(name=="uint"   || name=="uint32")  { t.size=4; }
+      else if(name=="float"  || name=="float32") { t.size=4; t.is_float=true; }
+      else if(name=="double" || name=="float64") { t.size=8; t.is_float=true; }
+      else throw std::runtime_error("mesh_source: unknown PLY property type " + name);
+      return t;
+   }
+
+   double ply_value(const char* p, const ply_type& t, bool swap)
+   {
+      if(t.is_float) return (t.size==4)? read_value<float>(p,swap) : read_value<double>(p,swap);
+      switch(t.size) {
+         case 1:  { return t.is_signed? double(read_value<int8_t>(p,swap))  : double(read_value<uint8_t>(p,swap)); }
+         case 2:  { return t.is_signed? double(read_value<int16_t>(p,swap)) : double(read_value<uint16_t>(p,swap)); }
+         default: { return t.is_signed? double(read_value<int32_t>(p,swap)) : double(read_value<uint32_t>(p,swap)); }
+      };
+   }
+
+   struct ply_property {
+      std::string name;
+      ply_type    type;      // value type
+      ply_type    count;     // list count type, size 0 for scalars
+   };
+
+   struct ply_element {
+      std::string               name;
+      size_t                    count;
+      std::vector<ply_property> props;
+   };
+}
+
+void mesh_source::read_ply(const char* data, size_t size)
+{
+   // parse the ascii header
+   const char* end_tag = "end_header";
+   const char* hend = std::search(data,data+size,end_tag,end_tag+std::strlen(end_tag));
+   if(size < 4 || !std::equal(data,data+3,"ply") || hend == data+size) throw std::runtime_error("mesh_source: not a PLY file " + m_path);
+   const char* body = std::find(hend,data+size,'\n');
+   if(body == data+size) throw std::runtime_error("mesh_source: truncated PLY header " + m_path);
+   body++;
+
+   std::istringstream header(std::string(data,hend));
+   std::vector<ply_element> elements;
+   bool swap = false;
+   std::string line;
+   while(std::getline(header,line)) {
+      std::istringstream in(line);
+      std::string word;
+      in >> word;
+      if(word == "format") {
+         std::string format;
+         in >> format;
+         if(format == "binary_little_endian")   swap = !little_endian_host;
+         else if(format == "binary_big_endian") swap = little_endian_host;
+         else throw std::runtime_error("mesh_source: only binary PLY is supported " + m_path);
+      }
+      else if(word == "element") {
+         ply_element e;
+         e.count = 0;
+         in >> e.name >> e.count;
+         elements.push_back(e);
+      }
+      else if(word == "property") {
+         if(elements.size() == 0) throw std::runtime_error("mesh_source: PLY property before element in " + m_path);
+         ply_property prop;
+         std::string type;
+         in >> type;
+         if(type == "list") {
+            std::string count_type;
+            in >> count_type >> type;
+            prop.count = ply_type_from(count_type);
+         }
+         prop.type = ply_type_from(type);
+         in >> prop.name;
+         elements.back().props.push_back(prop);
+      }
+   }
+
+   // read the element data in the order declared
+   const char* p   = body;
+   const char* eof = data+size;
+   std::vector<size_t> face;
+   for(auto& e : elements) {
+      int ix=-1, iy=-1, iz=-1;
+      for(size_t i=0; i<e.props.size(); i++) {
+         if(e.props[i].name == "x") ix = static_cast<int>(i);
+         if(e.props[i].name == "y") iy = static_cast<int>(i);
+         if(e.props[i].name == "z") iz = static_cast<int>(i);
+      }
+      const bool is_vertex = (e.name == "vertex");
+      const bool is_face   = (e.name == "face");
+      if(is_vertex && (ix<0 || iy<0 || iz<0)) throw std::runtime_error("mesh_source: PLY vertex without x,y,z in " + m_path);
+      if(is_vertex) m_vertices.reserve(e.count);
+      if(is_face)   m_faces.reserve(e.count);
+
+      for(size_t ie=0; ie<e.count; ie++) {
+         double xyz[3] = { 0.0, 0.0, 0.0 };
+         bool has_face = false;
+         for(size_t i=0; i<e.props.size(); i++) {
+            const ply_property& prop = e.props[i];
+            size_t n = 1;
+            if(prop.count.size > 0) {
+               if(p + prop.count.size > eof) throw std::runtime_error("mesh_source: truncated PLY data in " + m_path);
+               n = static_cast<size_t>(ply_value(p,prop.count,swap));
+               p += prop.count.size;
+            }
+            if(p + n*prop.type.size > eof) throw std::runtime_error("mesh_source: truncated PLY data in " + m_path);
+
+            if(is_vertex) {
+               if(static_cast<int>(i) == ix) xyz[0] = ply_value(p,prop.type,swap);
+               if(static_cast<int>(i) == iy) xyz[1] = ply_value(p,prop.type,swap);
+               if(static_cast<int>(i) == iz) xyz[2] = ply_value(p,prop.type,swap);
+            }
+            else if(is_face && !has_face && prop.count.size > 0 && (prop.name == "vertex_indices" || prop.name == "vertex_index")) {
+               face.clear();
+               for(size_t k=0; k<n; k++) face.push_back(static_cast<size_t>(ply_value(p+k*prop.type.size,prop.type,swap)));
+               has_face = true;
+            }
+            p += n*prop.type.size;
+         }
+         if(is_vertex) m_vertices.push_back(carve::geom::VECTOR(xyz[0],xyz[1],xyz[2]));
+         if(has_face) {
+            if(face.size() < 3) throw std::runtime_error("mesh_source: PLY face with less than 3 vertices in " + m_path);
+            m_faces.push_back(xface(face));
+         }
+      }
+   }
+
+   for(auto& f : m_faces) {
+      for(size_t iv : f) {
+         if(iv >= m_vertices.size()) throw std::runtime_error("mesh_source: PLY vertex index out of range in " + m_path);
+      }
+   }
+}
+
+namespace {
+
+   // text_cursor reads blank separated tokens from a text buffer that need not be
+   // zero terminated. '#' starts a comment running to the end of the line
+   struct text_cursor {
+      text_cursor(const char* b, const char* e) : p(b), end(e) {}
+
+      // next token on the current line, false at end of line
+      bool token(std::string& tok)
+      {
+         while(p<end && (*p==' ' || *p=='\t' || *p=='\r')) p++;
+         if(p<end && *p=='#') while(p<end && *p!='\n') p++;
+         if(p>=end || *p=='\n') return false;
+         const char* b = p;
+         while(p<end && !std::isspace(static_cast<unsigned char>(*p)) && *p!='#') p++;
+         tok.assign(b,p);
+         return true;
+      }
+
+      // next token, crossing line ends
+      bool any_token(std::string& tok)
+      {
+         while(!token(tok)) {
+            if(!next_line()) return false;
+         }
+         return true;
+      }
+
+      // skip to the start of the next line, false at end of buffer
+      bool next_line()
+      {
+         while(p<end && *p!='\n') p++;
+         if(p>=end) return false;
+         p++;
+         return true;
+      }
+
+      const char* p;
+      const char* end;
+   };
+
+   bool to_double(const std::string& tok, double& value)
+   {
+      char* e = 0;
+      value = std::strtod(tok.c_str(),&e);
+      return e != tok.c_str() && *e == 0;
+   }
+
+   bool to_long(const std::string& tok, long& value)
+   {
+      char* e = 0;
+      value = std::strtol(tok.c_str(),&e,10);
+      return e != tok.c_str() && (*e == 0 || *e == '/');
+   }
+
+   // OBJ records parsed from one chunk of the file. Face indices are stored as
+   // (index<<1) for absolute indices and (index<<1)|1 for indices relative to the chunk start
+   struct obj_chunk {
+      std::vector<double>  coords;
+      std::vector<size_t>  face_sizes;
+      std::vector<int64_t> face_indices;
+      std::string          error;
+   };
+
+   void parse_obj(const char* begin, const char* end, obj_chunk& chunk)
+   {
+      text_cursor cur(begin,end);
+      std::string tok;
+      size_t iline = 0;
+      do {
+         iline++;
+         if(!cur.token(tok)) continue;
+         if(tok == "v") {
+            double xyz[3];
+            for(size_t k=0; k<3; k++) {
+               if(!cur.token(tok) || !to_double(tok,xyz[k])) { chunk.error = "invalid vertex record"; return; }
+            }
+            chunk.coords.insert(chunk.coords.end(),xyz,xyz+3);
+         }
+         else if(tok == "f") {
+            const int64_t nlocal = static_cast<int64_t>(chunk.coords.size()/3);
+            size_t nv = 0;
+            long index = 0;
+            while(cur.token(tok)) {
+               if(!to_long(tok,index) || index == 0) { chunk.error = "invalid face record"; return; }
+               if(index > 0) chunk.face_indices.push_back(static_cast<int64_t>(index-1)*2);
+               else          chunk.face_indices.push_back((nlocal+index)*2 + 1);
+               nv++;
+            }
+            if(nv < 3) { chunk.error = "face with less than 3 vertices"; return; }
+            chunk.face_sizes.push_back(nv);
+         }
+      } while(cur.next_line());
+   }
+}
+
+void mesh_source::read_stl_ascii(const char* data, size_t size)
+{
+   // every 'vertex' record is a triangle corner, three corners make a triangle
+   text_cursor cur(data,data+size);
+   std::string tok;
+   std::vector<size_t> face;
+   while(cur.any_token(tok)) {
+      if(tok != "vertex") continue;
+      double xyz[3];
+      for(size_t k=0; k<3; k++) {
+         if(!cur.token(tok) || !to_double(tok,xyz[k])) throw std::runtime_error("mesh_source: invalid vertex in ascii STL " + m_path);
+      }
+      face.push_back(m_vertices.size());
+      m_vertices.push_back(carve::geom::VECTOR(xyz[0],xyz[1],xyz[2]));
+      if(face.size() == 3) {
+         m_faces.push_back(xface(face));
+         face.clear();
+      }
+   }
+   if(face.size() != 0) throw std::runtime_error("mesh_source: incomplete facet in ascii STL " + m_path);
+   weld(0.0);
+}
+
+void mesh_source::read_obj(const char* data, size_t size)
+{
+   // split into chunks at line ends and parse them concurrently
+   const size_t min_chunk = 1<<20;
+   size_t nchunk = std::max(size_t(1),std::min(thread_pool::singleton().nthreads(),size/min_chunk));
+   std::vector<const char*> split(1,data);
+   for(size_t ic=1; ic<nchunk; ic++) {
+      const char* p = std::find(std::max(split.back(),data + ic*size/nchunk),data+size,'\n');
+      if(p < data+size) p++;
+      split.push_back(p);
+   }
+   split.push_back(data+size);
+
+   std::vector<obj_chunk> chunks(split.size()-1);
+   if(chunks.size() == 1) {
+      parse_obj(split[0],split[1],chunks[0]);
+   }
+   else {
+      thread_pool::task_group group;
+      for(size_t ic=0; ic<chunks.size(); ic++) {
+         thread_pool::singleton().submit(group,[ic,&split,&chunks]() { parse_obj(split[ic],split[ic+1],chunks[ic]); });
+      }
+      thread_pool::singleton().wait(group);
+   }
+
+   // concatenate, resolving the relative indices with the vertex count before each chunk
+   size_t nvert = 0, nface = 0;
+   for(auto& c : chunks) {
+      if(c.error.size() > 0) throw std::runtime_error("mesh_source: " + c.error + " in " + m_path);
+      nvert += c.coords.size()/3;
+      nface += c.face_sizes.size();
+   }
+   m_vertices.reserve(nvert);
+   m_faces.reserve(nface);
+
+   std::vector<size_t> face;
+   int64_t offset = 0;
+   for(auto& c : chunks) {
+      for(size_t i=0; i<c.coords.size(); i+=3) {
+         m_vertices.push_back(carve::geom::VECTOR(c.coords[i],c.coords[i+1],c.coords[i+2]));
+      }
+      size_t pos = 0;
+      for(size_t nv : c.face_sizes) {
+         face.clear();
+         for(size_t k=0; k<nv; k++, pos++) {
+            int64_t code  = c.face_indices[pos];
+            int64_t index = (code & 1)? (code>>1) + offset : (code>>1);
+            if(index < 0 || index >= static_cast<int64_t>(nvert)) throw std::runtime_error("mesh_source: OBJ vertex index out of range in " + m_path);
+            face.push_back(static_cast<size_t>(index));
+         }
+         m_faces.push_back(xface(face));
+      }
+      offset += static_cast<int64_t>(c.coords.size()/3);
+      std::vector<double>().swap(c.coords);
+   }
+}
+
+void mesh_source::read_off(const char* data, size_t size)
+{
+   text_cursor cur(data,data+size);
+   std::string tok;
+   if(!cur.any_token(tok) || tok.size() < 3 || tok.compare(tok.size()-3,3,"OFF") != 0) throw std::runtime_error("mesh_source: not an OFF file " + m_path);
+   if(tok != "OFF") throw std::runtime_error("mesh_source: unsupported OFF variant " + tok + " in " + m_path);
+
+   long counts[3] = { 0, 0, 0 };
+   for(size_t k=0; k<3; k++) {
+      if(!cur.any_token(tok) || !to_long(tok,counts[k]) || counts[k] < 0) throw std::runtime_error("mesh_source: invalid OFF header in " + m_path);
+   }
+   const size_t nvert = counts[0];
+   const size_t nface = counts[1];
+
+   m_vertices.reserve(nvert);
+   for(size_t iv=0; iv<nvert; iv++) {
+      double xyz[3];
+      for(size_t k=0; k<3; k++) {
+         if(!cur.any_token(tok) || !to_double(tok,xyz[k])) throw std::runtime_error("mesh_source: invalid OFF vertex in " + m_path);
+      }
+      m_vertices.push_back(carve::geom::VECTOR(xyz[0],xyz[1],xyz[2]));
+      cur.next_line();
+   }
+
+   m_faces.reserve(nface);
+   std::vector<size_t> face;
+   for(size_t iface=0; iface<nface; iface++) {
+      long nv = 0;
+      if(!cur.any_token(tok) || !to_long(tok,nv) || nv < 3) throw std::runtime_error("mesh_source: invalid OFF face in " + m_path);
+      face.clear();
+      for(long k=0; k<nv; k++) {
+         long index = 0;
+         if(!cur.token(tok) || !to_long(tok,index) || index < 0 || static_cast<size_t>(index) >= nvert) throw std::runtime_error("mesh_source: invalid OFF face in " + m_path);
+         face.push_back(static_cast<size_t>(index));
+      }
+      m_faces.push_back(xface(face));
+
+      // any colour values remain on the line
+      cur.next_line();
+   }
+}
+
+size_t mesh_source::weld(double tol)
+{
+   const size_t nvert = m_vertices.size();
+   std::vector<size_t> remap(nvert);
+   std::vector<xvertex> welded;
+   welded.reserve(nvert);
+
+   // the hash cell size equals the tolerance, so a match is in the cell or a neighbour cell
+   struct key_hash {
+      size_t operator()(const std::array<int64_t,3>& k) const { return (size_t(k[0])*73856093) ^ (size_t(k[1])*19349663) ^ (size_t(k[2])*83492791); }
+   };
+   std::unordered_map<std::array<int64_t,3>,std::vector<size_t>,key_hash> cells;
+   cells.reserve(nvert);
+   const double tol2 = tol*tol;
+   for(size_t iv=0; iv<nvert; iv++) {
+      const xvertex& v = m_vertices[iv];
+      std::array<int64_t,3> key;
+      if(tol > 0.0) {
+         for(size_t k=0; k<3; k++) key[k] = static_cast<int64_t>(std::floor(v[k]/tol));
+      }
+      else {
+         for(size_t k=0; k<3; k++) std::memcpy(&key[k],&v[k],sizeof(double));
+      }
+
+      size_t match = welded.size();
+      const int64_t r = (tol > 0.0)? 1 : 0;
+      for(int64_t ix=-r; ix<=r && match==welded.size(); ix++) {
+         for(int64_t iy=-r; iy<=r && match==welded.size(); iy++) {
+            for(int64_t iz=-r; iz<=r && match==welded.size(); iz++) {
+               auto it = cells.find({ key[0]+ix, key[1]+iy, key[2]+iz });
+               if(it == cells.end()) continue;
+               for(size_t iw : it->second) {
+                  const xvertex& w = welded[iw];
+                  const double d2 = (w.x-v.x)*(w.x-v.x) + (w.y-v.y)*(w.y-v.y) + (w.z-v.z)*(w.z-v.z);
+                  if(d2 <= tol2) { match = iw; break; }
+               }
+            }
+         }
+      }
+      if(match == welded.size()) {
+         cells[key].push_back(match);
+         welded.push_back(v);
+      }
+      remap[iv] = match;
+   }
+
+   // renumber the faces, dropping repeated consecutive vertices
+   std::vector<xface> faces;
+   faces.reserve(m_faces.size());
+   std::vector<size_t> face;
+   for(auto& f : m_faces) {
+      face.clear();
+      for(size_t iv : f) {
+         size_t iw = remap[iv];
+         if(face.size() == 0 || face.back() != iw) face.push_back(iw);
+      }
+      while(face.size() > 1 && face.front() == face.back()) face.pop_back();
+      if(face.size() >= 3) faces.push_back(xface(face));
+   }
+
+   size_t nremoved = nvert - welded.size();
+   m_vertices.swap(welded);
+   m_faces.swap(faces);
+   return nremoved;
+}
+
+void mesh_source::read_f64(const char* data, size_t size)
+{
+   if(size%(3*sizeof(double)) != 0) throw std::runtime_error("mesh_source: raw float64 file size is not a multiple of 24 bytes " + m_path);
+   const bool swap = !little_endian_host;
+   size_t nvert = size/(3*sizeof(double));
+   m_vertices.reserve(nvert);
+   for(size_t iv=0; iv<nvert; iv++) {
+      const char* p = data + 3*sizeof(double)*iv;
+      m_vertices.push_back(carve::geom::VECTOR(read_value<double>(p,swap),read_value<double>(p+8,swap),read_value<double>(p+16,swap)));
+   }
+}
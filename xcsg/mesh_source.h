@@ -0,0 +1,66 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef MESH_SOURCE_H
+#define MESH_SOURCE_H
+
+#include <string>
+#include <vector>
+#include "xshape.h"
+#include "xface.h"
+
+// mesh_source loads vertices and faces from an external binary file, so large meshes
+// need not be written as XML vertex and face elements. The file is memory mapped and
+// the format is selected by the file extension
+//
+//    .xmesh  : xcsg binary mesh, see xmesh_file
+//    .stl    : binary or ascii STL. Identical corner coordinates are merged into one vertex
+//    .ply    : binary PLY (little or big endian), element vertex with x,y,z and
+//              optionally element face with a vertex_indices list
+//    .obj    : Wavefront OBJ, v and f records only. Large files are parsed in parallel
+//    .off    : Object File Format, ascii
+//    .f64    : raw little-endian float64 x,y,z triples, vertices only
+//
+// The constructor throws std::runtime_error if the file is missing or invalid.
+
+class mesh_source {
+public:
+   mesh_source(const std::string& file_path);
+   virtual ~mesh_source();
+
+   const std::vector<xvertex>& vertices() const { return m_vertices; }
+   const std::vector<xface>&   faces() const    { return m_faces; }
+
+   // merge vertices closer than tol using a spatial hash, tol=0 merges identical coordinates only.
+   // Faces are renumbered, faces left with less than 3 distinct vertices are removed.
+   // Returns the number of vertices removed
+   size_t weld(double tol);
+
+protected:
+   void read_xmesh(const std::string& file_path);
+   void read_stl(const char* data, size_t size);
+   void read_stl_ascii(const char* data, size_t size);
+   void read_ply(const char* data, size_t size);
+   void read_obj(const char* data, size_t size);
+   void read_off(const char* data, size_t size);
+   void read_f64(const char* data, size_t size);
+
+private:
+   std::string          m_path;
+   std::vector<xvertex> m_vertices;
+   std::vector<xface>   m_faces;
+};
+
+#endif // MESH_SOURCE_H
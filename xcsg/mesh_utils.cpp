@@ -14,26 +14,72 @@
 // EndLicense:
 
 #include "mesh_utils.h"
+#include "compile_context.h"
+#include "message_log.h"
+#include "geom_kernel.h"
 #include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <string>
 
-double  mesh_utils::m_secant_tolerance = 0.05;
+static const double def_secant_tolerance = 0.05;
 static const double min_secant_tolerance = 0.0009;
+double  mesh_utils::m_secant_tolerance = def_secant_tolerance;
+double  mesh_utils::m_preview_tolerance = 0.0;
+
+double mesh_utils::default_secant_tolerance()
+{
+   return def_secant_tolerance;
+}
 
 double mesh_utils::secant_tolerance()
 {
-   return m_secant_tolerance;
+   compile_context* ctx = compile_context::current();
+   return (ctx)? ctx->secant_tolerance() : m_secant_tolerance;
 }
 
 void  mesh_utils::set_secant_tolerance(double tol)
 {
    if(tol > min_secant_tolerance) {
-      m_secant_tolerance = tol;
+      compile_context* ctx = compile_context::current();
+      if(ctx) ctx->set_secant_tolerance(tol);
+      else    m_secant_tolerance = tol;
    }
    else {
-      std::cout << "Info: ignored secant tolerance " << tol << " < min tolerance=" << min_secant_tolerance << std::endl;
+      message_log::info() << "Info: ignored secant tolerance " << tol << " < min tolerance=" << min_secant_tolerance;
+   }
+}
+
+double mesh_utils::secant_tolerance(double radius)
+{
+   return std::max(secant_tolerance(),m_preview_tolerance*fabs(radius));
+}
+
+double mesh_utils::preview_tolerance()
+{
+   return m_preview_tolerance;
+}
+
+void mesh_utils::set_preview_tolerance(double rel_tol)
+{
+   if(rel_tol < 0.0 || rel_tol >= 1.0) {
+      throw std::logic_error("mesh_utils: preview tolerance must be in the range [0,1>, got " + std::to_string(rel_tol));
    }
+   m_preview_tolerance = rel_tol;
+}
+
+static_assert(sizeof(carve::geom3d::Vector) == 3*sizeof(double),"carve::geom3d::Vector must be a plain x,y,z triple");
+
+void mesh_utils::transform_xyz(const carve::math::Matrix& t, double* xyz, size_t n)
+{
+   geom_kernel::transform_xyz(t,xyz,n);
 }
 
+void mesh_utils::transform_points(const carve::math::Matrix& t, size_t n, carve::geom3d::Vector* points)
+{
+   transform_xyz(t,reinterpret_cast<double*>(points),n);
+}
 
 bool mesh_utils::is_left_hand(const carve::math::Matrix& t)
 {
@@ -45,3 +91,46 @@ bool mesh_utils::is_left_hand(const carve::math::Matrix& t)
    double dot   = carve::geom::dot(z,z_test);
    return (dot < 0.0);
 }
+
+bool mesh_utils::is_identity(const carve::math::Matrix& t)
+{
+   for(size_t i=0; i<4; i++) {
+      for(size_t j=0; j<4; j++) {
+         if(t.m[i][j] != ((i==j)? 1.0 : 0.0)) return false;
+      }
+   }
+   return true;
+}
+
+bool mesh_utils::invert_affine(const carve::math::Matrix& t, carve::math::Matrix& inv)
+{
+   if(t.m[0][3] != 0.0 || t.m[1][3] != 0.0 || t.m[2][3] != 0.0 || t.m[3][3] != 1.0) return false;
+
+   // a[row][col] is the linear part, t.m is stored column by column
+   double a[3][3];
+   for(size_t r=0; r<3; r++) {
+      for(size_t c=0; c<3; c++) a[r][c] = t.m[c][r];
+   }
+
+   double c00 = a[1][1]*a[2][2] - a[1][2]*a[2][1];
+   double c01 = a[1][2]*a[2][0] - a[1][0]*a[2][2];
+   double c02 = a[1][0]*a[2][1] - a[1][1]*a[2][0];
+   double det = a[0][0]*c00 + a[0][1]*c01 + a[0][2]*c02;
+   if(det == 0.0 || !std::isfinite(det)) return false;
+
+   double b[3][3];
+   b[0][0] = c00;  b[0][1] = a[0][2]*a[2][1] - a[0][1]*a[2][2];  b[0][2] = a[0][1]*a[1][2] - a[0][2]*a[1][1];
+   b[1][0] = c01;  b[1][1] = a[0][0]*a[2][2] - a[0][2]*a[2][0];  b[1][2] = a[0][2]*a[1][0] - a[0][0]*a[1][2];
+   b[2][0] = c02;  b[2][1] = a[0][1]*a[2][0] - a[0][0]*a[2][1];  b[2][2] = a[0][0]*a[1][1] - a[0][1]*a[1][0];
+
+   inv = carve::math::Matrix();
+   for(size_t r=0; r<3; r++) {
+      double tr = 0.0;
+      for(size_t c=0; c<3; c++) {
+         inv.m[c][r] = b[r][c]/det;
+         tr -= inv.m[c][r]*t.m[3][c];
+      }
+      inv.m[3][r] = tr;
+   }
+   return true;
+}
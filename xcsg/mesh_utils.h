@@ -29,13 +29,60 @@ public:
 
    // tolerances for adaptive meshing of circular curves/surfaces
    // The tolerance measures the distance from a segment chord to the true circular curve, i.e.  radius*(1-cos(angle/2))
+   // During a compilation the tolerance belongs to its compile_context
    static double secant_tolerance();
    static void set_secant_tolerance(double tol);
 
+   // secant tolerance used when the model does not specify one
+   static double default_secant_tolerance();
+
+   // tolerance for a curve of the given radius. In preview mode the tolerance grows
+   // with the radius, so the number of segments per curve is bounded regardless of its size
+   static double secant_tolerance(double radius);
+
+   // preview tolerance as a fraction of the curve radius, 0.0 means full quality
+   static double preview_tolerance();
+   static void set_preview_tolerance(double rel_tol);
+
    static bool is_left_hand(const carve::math::Matrix& t);
 
+   // true if t is exactly the identity matrix
+   static bool is_identity(const carve::math::Matrix& t);
+
+   // compute the inverse of the affine transform t. Returns false if t is singular or not affine
+   static bool invert_affine(const carve::math::Matrix& t, carve::math::Matrix& inv);
+
+   // transform n points in place by t, point(i) returns a reference to point i.
+   // The matrix coefficients are read once for the whole batch, and nothing is done for the identity
+   template <typename point_at>
+   static void transform_points(const carve::math::Matrix& t, size_t n, point_at point);
+
+   // transform n points stored as contiguous x,y,z triples in place by t, see geom_kernel::transform_xyz
+   static void transform_xyz(const carve::math::Matrix& t, double* xyz, size_t n);
+
+   // transform a contiguous array of n points (e.g. xvertex) in place by t, see transform_xyz
+   static void transform_points(const carve::math::Matrix& t, size_t n, carve::geom3d::Vector* points);
+
 private:
    static double m_secant_tolerance;
+   static double m_preview_tolerance;
 };
 
+template <typename point_at>
+void mesh_utils::transform_points(const carve::math::Matrix& t, size_t n, point_at point)
+{
+   if(is_identity(t)) return;
+
+   const double xx = t.m[0][0], xy = t.m[1][0], xz = t.m[2][0], xw = t.m[3][0];
+   const double yx = t.m[0][1], yy = t.m[1][1], yz = t.m[2][1], yw = t.m[3][1];
+   const double zx = t.m[0][2], zy = t.m[1][2], zz = t.m[2][2], zw = t.m[3][2];
+   for(size_t i=0; i<n; i++) {
+      carve::geom3d::Vector& p = point(i);
+      const double x = p.x, y = p.y, z = p.z;
+      p.x = xx*x + xy*y + xz*z + xw;
+      p.y = yx*x + yy*y + yz*z + yw;
+      p.z = zx*x + zy*y + zz*z + zw;
+   }
+}
+
 #endif // MESH_UTILS_H
@@ -0,0 +1,180 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "message_log.h"
+#include "thread_pool.h"
+#include <cstdio>
+#include <iostream>
+
+message_log::message_log()
+: m_level(info_level)
+, m_json(false)
+, m_origin(std::chrono::steady_clock::now())
+, m_queued(0)
+, m_written(0)
+, m_sleeping(false)
+, m_stop(false)
+{
+   // the list always holds one consumed node
+   m_tail = new node;
+   m_tail->next = nullptr;
+   m_head = m_tail;
+   m_writer = boost::thread(&message_log::writer_run,this);
+}
+
+message_log::~message_log()
+{
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_stop = true;
+   }
+   m_wake.notify_all();
+   m_writer.join();
+   delete m_tail;
+}
+
+void message_log::write(level lvl, const std::string& text)
+{
+   if(!enabled(lvl)) return;
+
+   node* n = new node;
+   n->next = nullptr;
+   n->lvl  = lvl;
+   n->tid  = thread_pool::current_worker() + 1;
+   n->time = std::chrono::duration<double>(std::chrono::steady_clock::now() - m_origin).count();
+   n->text = text;
+
+   // link the node after the previous head, the writer stops at a node not yet linked
+   node* prev = m_head.exchange(n,std::memory_order_acq_rel);
+   prev->next.store(n,std::memory_order_release);
+   m_queued++;
+   if(m_sleeping.load(std::memory_order_relaxed)) m_wake.notify_one();
+}
+
+void message_log::flush()
+{
+   size_t target = m_queued;
+   std::unique_lock<std::mutex> lock(m_mutex);
+   while(m_written < target) {
+      m_wake.notify_one();
+      m_done.wait_for(lock,std::chrono::milliseconds(10));
+   }
+}
+
+void message_log::writer_run()
+{
+   while(true) {
+      if(write_queued() > 0) continue;
+
+      std::unique_lock<std::mutex> lock(m_mutex);
+      if(m_stop) {
+         lock.unlock();
+         write_queued();
+         break;
+      }
+
+      // a wake up missed between the check and the wait is caught by the timeout
+      m_sleeping = true;
+      m_wake.wait_for(lock,std::chrono::milliseconds(10));
+      m_sleeping = false;
+   }
+}
+
+size_t message_log::write_queued()
+{
+   size_t nwritten = 0;
+   node* next = m_tail->next.load(std::memory_order_acquire);
+   while(next) {
+      std::cout << format(*next) << '\n';
+      delete m_tail;
+      m_tail = next;
+      next = m_tail->next.load(std::memory_order_acquire);
+      nwritten++;
+   }
+   if(nwritten > 0) {
+      // the messages count as written when they have left the stream
+      std::cout.flush();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_written += nwritten;
+      m_done.notify_all();
+   }
+   return nwritten;
+}
+
+std::string message_log::format(const node& n) const
+{
+   if(!m_json) return n.text;
+
+   static const char* level_names[] = { "progress", "info", "warning", "error" };
+   std::string out;
+   out.reserve(n.text.size() + 80);
+   char head[96];
+   std::snprintf(head,sizeof(head),"{\"time\": %.6f, \"level\": \"%s\", \"thread\": %d, \"message\": \"",n.time,level_names[n.lvl],n.tid);
+   out += head;
+   for(char c : n.text) {
+      switch(c) {
+         case '"':  { out += "\\\""; break; }
+         case '\\': { out += "\\\\"; break; }
+         case '\t': { out += "\\t";  break; }
+         case '\r': { out += "\\r";  break; }
+         case '\n': { out += "\\n";  break; }
+         default: {
+            if(static_cast<unsigned char>(c) < 0x20) {
+               char esc[8];
+               std::snprintf(esc,sizeof(esc),"\\u%04x",static_cast<unsigned int>(c));
+               out += esc;
+            }
+            else out += c;
+         }
+      };
+   }
+   out += "\"}";
+   return out;
+}
+
+message_log::stream::stream(level lvl)
+: std::ostream(nullptr)
+, m_buffer(lvl)
+{
+   rdbuf(&m_buffer);
+}
+
+message_log::stream::~stream()
+{
+   m_buffer.finish();
+}
+
+void message_log::stream::buffer::finish()
+{
+   if(m_line.size() > 0) message_log::singleton().write(m_level,m_line);
+   m_line.clear();
+}
+
+int message_log::stream::buffer::sync()
+{
+   return 0;
+}
+
+message_log::stream::buffer::int_type message_log::stream::buffer::overflow(int_type c)
+{
+   if(traits_type::eq_int_type(c,traits_type::eof())) return traits_type::not_eof(c);
+   if(traits_type::to_char_type(c) == '\n') {
+      message_log::singleton().write(m_level,m_line);
+      m_line.clear();
+   }
+   else m_line += traits_type::to_char_type(c);
+   return c;
+}
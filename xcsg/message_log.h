@@ -0,0 +1,143 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef MESSAGE_LOG_H
+#define MESSAGE_LOG_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <sstream>
+#include <streambuf>
+#include <string>
+#include <boost/thread.hpp>
+
+// message_log writes the progress and diagnostic messages of a run to std::cout from a background
+// thread, so worker threads never wait for the console or a slow pipe. Messages are pushed to a
+// lock-free queue (an intrusive multi-producer single-consumer list) and written in the order they
+// were queued, each message as one line. Messages below the level set are dropped where they are
+// created (--quiet). With json, each message is written as a JSON object per line (--log_json).
+//
+// A message is composed with the stream style helpers, and queued when the statement ends:
+//
+//    message_log::progress() << "...boolean progress: " << percent << "%";
+//
+// Code writing to std::cout directly must call flush first to keep the order of the messages.
+
+class message_log {
+public:
+   enum level { progress_level = 0, info_level = 1, warning_level = 2, error_level = 3 };
+
+   static message_log& singleton()  { static message_log instance; return instance;  }
+
+   // messages with a lower level are dropped, info_level by default
+   void set_level(level lvl) { m_level = lvl; }
+   bool enabled(level lvl) const { return lvl >= m_level.load(std::memory_order_relaxed); }
+
+   // write messages as JSON lines with time, level and thread
+   void set_json(bool json) { m_json = json; }
+
+   // queue one message, without line terminator
+   void write(level lvl, const std::string& text);
+
+   // wait until all messages queued so far are written and std::cout is flushed
+   void flush();
+
+   // line collects a message and queues it when destroyed
+   class line {
+   public:
+      line(level lvl) : m_level(lvl), m_enabled(singleton().enabled(lvl)) {}
+      line(line&& other) : m_level(other.m_level), m_enabled(other.m_enabled), m_out(std::move(other.m_out)) { other.m_enabled = false; }
+      ~line() { if(m_enabled) singleton().write(m_level,m_out.str()); }
+      template <typename T> line& operator<<(const T& value) { if(m_enabled) m_out << value; return *this; }
+   private:
+      level              m_level;
+      bool               m_enabled;
+      std::ostringstream m_out;
+   };
+
+   static line progress() { return line(progress_level); }
+   static line info()     { return line(info_level); }
+   static line warning()  { return line(warning_level); }
+   static line error()    { return line(error_level); }
+
+   // stream queuing each complete line written to it as a message of one level, for passing
+   // the log of a computation as std::ostream. A stream must be used by one thread at a time
+   class stream : public std::ostream {
+   public:
+      stream(level lvl);
+      virtual ~stream();
+   private:
+      class buffer : public std::streambuf {
+      public:
+         buffer(level lvl) : m_level(lvl) {}
+         void finish();   // queue a last line without terminator
+         int sync() override;
+         int_type overflow(int_type c) override;
+      private:
+         level       m_level;
+         std::string m_line;
+      };
+      buffer m_buffer;
+   };
+
+protected:
+   message_log();
+   virtual ~message_log();
+
+   struct node {
+      std::atomic<node*> next;
+      level              lvl;
+      int                tid;      // thread_pool worker + 1, 0 for other threads
+      double             time;     // seconds since the log was created
+      std::string        text;
+   };
+
+   // the background writer
+   void writer_run();
+
+   // write the messages in the queue, return number written
+   size_t write_queued();
+
+   // format one message
+   std::string format(const node& n) const;
+
+private:
+   message_log(const message_log&) = delete;
+   message_log& operator=(const message_log&) = delete;
+
+   std::atomic<int>                      m_level;
+   std::atomic<bool>                     m_json;
+   std::chrono::steady_clock::time_point m_origin;
+
+   // producers push at m_head, the writer pops after m_tail, which is a consumed node
+   std::atomic<node*>                    m_head;
+   node*                                 m_tail;
+   std::atomic<size_t>                   m_queued;    // messages pushed so far
+   std::atomic<size_t>                   m_written;   // messages written so far
+   std::atomic<bool>                     m_sleeping;  // the writer waits for messages
+
+   std::mutex                            m_mutex;
+   std::condition_variable               m_wake;      // new messages or stop
+   std::condition_variable               m_done;      // messages written
+   bool                                  m_stop;
+   boost::thread                         m_writer;
+};
+
+#endif // MESSAGE_LOG_H
@@ -0,0 +1,204 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "node_profiler.h"
+#include "csg_parser/cf_xmlNode.h"
+#include "thread_pool.h"
+#include "allocator_stats.h"
+#include "perf_counters.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+// innermost scope of the current thread
+static thread_local node_profiler::scope* tl_scope = nullptr;
+
+node_profiler::node_profiler()
+: m_enabled(false)
+, m_alloc_peak(0)
+{}
+
+node_profiler::~node_profiler()
+{}
+
+void node_profiler::reset()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_enabled = false;
+   m_entries.clear();
+   m_build_stack.clear();
+   m_alloc_peak = 0;
+}
+
+size_t node_profiler::begin_node(const cf_xmlNode& node)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+
+   entry e;
+   e.tag        = node.tag();
+   e.parent     = -1;
+   e.nchildren  = 0;
+   e.calls      = 0;
+   e.wall_sec   = 0.0;
+   e.thread_sec = 0.0;
+   e.worker     = -1;
+   e.nvert      = 0;
+   e.nface      = 0;
+   e.bytes      = 0;
+   e.alloc_bytes = 0;
+
+   size_t index = 0;
+   if(m_build_stack.size() > 0) {
+      entry& parent = m_entries[m_build_stack.back()];
+      e.parent = static_cast<long>(m_build_stack.back());
+      e.path   = parent.path;
+      index    = parent.nchildren++;
+   }
+   e.path += "/" + e.tag + "[" + std::to_string(index) + "]";
+
+   size_t id = m_entries.size();
+   m_entries.push_back(e);
+   m_build_stack.push_back(id);
+   return id;
+}
+
+void node_profiler::end_node()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(m_build_stack.size() > 0) m_build_stack.pop_back();
+}
+
+void node_profiler::add(size_t id, double wall_sec, double thread_sec, size_t nvert, size_t nface, size_t bytes, size_t alloc_bytes)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   entry& e = m_entries[id];
+   e.calls++;
+   e.wall_sec   += wall_sec;
+   e.thread_sec += thread_sec;
+   e.worker      = thread_pool::current_worker();
+   e.nvert       = nvert;
+   e.nface       = nface;
+   e.bytes       = bytes;
+   e.alloc_bytes = alloc_bytes;
+   m_alloc_peak  = std::max(m_alloc_peak,alloc_bytes);
+}
+
+node_profiler::scope::scope(size_t id)
+: m_id(id)
+, m_parent(tl_scope)
+, m_start(boost::posix_time::microsec_clock::universal_time())
+, m_nested(0.0)
+, m_nvert(0)
+, m_nface(0)
+, m_bytes(0)
+{
+   tl_scope = this;
+}
+
+node_profiler::scope::~scope()
+{
+   boost::posix_time::time_duration ptime_diff = boost::posix_time::microsec_clock::universal_time() - m_start;
+   double elapsed_sec = 1.0E-6*ptime_diff.total_microseconds();
+   if(m_parent) m_parent->m_nested += elapsed_sec;
+   tl_scope = m_parent;
+
+   // the allocator statistics are read outside the profiler lock
+   size_t alloc_bytes = allocator_stats::in_use();
+   node_profiler::singleton().add(m_id,elapsed_sec,std::max(0.0,elapsed_sec-m_nested),m_nvert,m_nface,m_bytes,alloc_bytes);
+}
+
+void node_profiler::scope::set_result(const carve::mesh::MeshSet<3>& mesh)
+{
+   typedef carve::mesh::MeshSet<3> meshset_t;
+
+   size_t nedge = 0;
+   m_nface = 0;
+   for(auto m : mesh.meshes) {
+      m_nface += m->faces.size();
+      for(auto f : m->faces) nedge += f->n_edges;
+   }
+   m_nvert = mesh.vertex_storage.size();
+   m_bytes = m_nvert*sizeof(meshset_t::vertex_t)
+           + m_nface*sizeof(meshset_t::face_t)
+           + nedge*sizeof(meshset_t::edge_t)
+           + mesh.meshes.size()*sizeof(meshset_t::mesh_t);
+}
+
+void node_profiler::scope::set_result(clipper_profile& profile)
+{
+   m_nvert = 0;
+   m_nface = profile.paths().size();
+   for(auto& path : profile.paths()) m_nvert += path.size();
+   m_bytes = m_nvert*sizeof(ClipperLib::IntPoint) + m_nface*sizeof(ClipperLib::Path);
+}
+
+void node_profiler::write_json(std::ostream& out) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+
+   // the input of a node is the output of its children, and the children's output
+   // is alive while the node is evaluated
+   std::vector<size_t> in_vert(m_entries.size(),0), in_face(m_entries.size(),0), in_bytes(m_entries.size(),0);
+   for(auto& e : m_entries) {
+      if(e.parent >= 0) {
+         in_vert[e.parent]  += e.nvert;
+         in_face[e.parent]  += e.nface;
+         in_bytes[e.parent] += e.bytes;
+      }
+   }
+
+   out << "{" << std::endl;
+   allocator_stats::snapshot alloc = allocator_stats::current();
+   out << "  \"nthreads\": " << thread_pool::singleton().nthreads() << "," << std::endl;
+   out << "  \"allocator\": {\"name\": \"" << allocator_stats::name() << "\""
+       << ", \"available\": "         << (allocator_stats::available()? "true" : "false")
+       << ", \"in_use_bytes\": "      << alloc.in_use
+       << ", \"peak_in_use_bytes\": " << std::max(m_alloc_peak,alloc.in_use)
+       << ", \"resident_bytes\": "    << alloc.resident
+       << ", \"lock_waits\": "        << alloc.lock_waits
+       << "}," << std::endl;
+   perf_counters::singleton().write_json(out);
+   out << "  \"nodes\": [" << std::endl;
+   out << std::setprecision(6);
+   for(size_t id=0; id<m_entries.size(); id++) {
+      const entry& e = m_entries[id];
+      out << "    {\"id\": "          << id
+          << ", \"parent\": "         << e.parent
+          << ", \"tag\": \""          << e.tag  << "\""
+          << ", \"path\": \""         << e.path << "\""
+          << ", \"calls\": "          << e.calls
+          << ", \"wall_sec\": "       << e.wall_sec
+          << ", \"thread_sec\": "     << e.thread_sec
+          << ", \"worker\": "         << e.worker
+          << ", \"in_vertices\": "    << in_vert[id]
+          << ", \"in_faces\": "       << in_face[id]
+          << ", \"out_vertices\": "   << e.nvert
+          << ", \"out_faces\": "      << e.nface
+          << ", \"out_bytes\": "      << e.bytes
+          << ", \"peak_bytes\": "     << std::max(e.bytes,in_bytes[id])
+          << ", \"alloc_bytes\": "    << e.alloc_bytes
+          << "}" << ((id+1 < m_entries.size())? "," : "") << std::endl;
+   }
+   out << "  ]" << std::endl;
+   out << "}" << std::endl;
+}
+
+void node_profiler::write_json(const std::string& path) const
+{
+   std::ofstream out(path);
+   if(!out.is_open()) throw std::runtime_error("node_profiler: could not write profile " + path);
+   write_json(out);
+}
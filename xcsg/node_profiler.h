@@ -0,0 +1,112 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef NODE_PROFILER_H
+#define NODE_PROFILER_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <carve/csg.hpp>
+#include "clipper_csg/clipper_profile.h"
+
+class cf_xmlNode;
+
+// node_profiler records time and mesh sizes for every CSG node when --profile is given.
+// Nodes are registered by xcsg_factory while the tree is built, each evaluation of
+// a node is then measured by a scope object and the result is written as JSON.
+//
+// The xml parser does not keep line numbers, so nodes are identified by their path
+// in the tree, e.g. /union3d[0]/difference3d[2]. The thread time of a node is the time its
+// thread spent in the node, excluding nested nodes evaluated in the same thread.
+// When the allocator provides statistics, the bytes in use after each node are recorded too.
+
+class node_profiler {
+public:
+   static node_profiler& singleton()  { static node_profiler instance; return instance;  }
+
+   // enable profiling before the tree is built
+   void enable()        { m_enabled = true; }
+   bool enabled() const { return m_enabled; }
+
+   // remove all nodes and disable profiling, called before each run
+   void reset();
+
+   // register a node while it is being built and return its id.
+   // Nodes registered before end_node are children of this node
+   size_t begin_node(const cf_xmlNode& node);
+   void   end_node();
+
+   // scope measures one evaluation of a node
+   class scope {
+   public:
+      scope(size_t id);
+      ~scope();
+
+      // record the result of the evaluation
+      void set_result(const carve::mesh::MeshSet<3>& mesh);
+      void set_result(clipper_profile& profile);
+
+   private:
+      size_t                   m_id;
+      scope*                   m_parent;   // enclosing scope in the same thread
+      boost::posix_time::ptime m_start;
+      double                   m_nested;   // seconds spent in nested scopes of this thread
+      size_t                   m_nvert;
+      size_t                   m_nface;
+      size_t                   m_bytes;
+   };
+
+   // write all nodes as JSON
+   void write_json(std::ostream& out) const;
+
+   // write all nodes as JSON to file path
+   void write_json(const std::string& path) const;
+
+protected:
+   node_profiler();
+   virtual ~node_profiler();
+
+   // add one evaluation to the node
+   void add(size_t id, double wall_sec, double thread_sec, size_t nvert, size_t nface, size_t bytes, size_t alloc_bytes);
+
+private:
+   struct entry {
+      std::string tag;
+      std::string path;
+      long        parent;       // -1 for the root
+      size_t      nchildren;    // children registered so far
+      size_t      calls;
+      double      wall_sec;
+      double      thread_sec;
+      int         worker;       // worker of the last evaluation, -1 outside the pool
+      size_t      nvert;        // output vertices
+      size_t      nface;        // output faces, or paths for 2d nodes
+      size_t      bytes;        // estimated bytes of the output mesh or profile
+      size_t      alloc_bytes;  // allocator bytes in use after the last evaluation
+   };
+
+   bool                m_enabled;
+   mutable std::mutex  m_mutex;
+   std::deque<entry>   m_entries;
+   std::vector<size_t> m_build_stack;   // nodes being built
+   size_t              m_alloc_peak;    // highest allocator bytes in use seen after a node
+};
+
+#endif // NODE_PROFILER_H
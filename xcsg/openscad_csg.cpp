@@ -14,7 +14,7 @@
 // EndLicense:
 
 #include "openscad_csg.h"
-#include <iomanip>
+#include "char_buffer.h"
 #include <stdexcept>
 #include "clipper_csg/polygon2d.h"
 #include "clipper_csg/contour2d.h"
@@ -35,13 +35,13 @@ openscad_csg::openscad_csg(const std::string& xcsg_path)
    m_out.open(m_path);
    if(!m_out.is_open())  throw std::runtime_error("Could not open file: " + m_path);
 
-   m_out << "// OpenSCAD file created by xcsg using CARVE: " << m_path << endl;
-   m_out << "union() {" << std::endl;
+   m_out << "// OpenSCAD file created by xcsg using CARVE: " << m_path << '\n';
+   m_out << "union() {" << '\n';
 }
 
 openscad_csg::~openscad_csg()
 {
-   m_out << "};" << std::endl;
+   m_out << "};" << '\n';
 }
 
 std::string openscad_csg::path() const
@@ -70,13 +70,13 @@ void openscad_csg::write_polyhedron_raw(std::shared_ptr<xpolyhedron> poly)
    for(size_t ivert=0; ivert<poly->v_size(); ivert++) {
       const carve::geom3d::Vector& pos = poly->v_get(ivert);
       if(ivert > 0) m_out << ',';
-      m_out << '[' << std::setprecision(16) << pos[0] << ',' << std::setprecision(16) <<  pos[1] << ',' << std::setprecision(16) <<  pos[2] << ']';;
+      m_out << '[' << format_double(pos[0]) << ',' << format_double(pos[1]) << ',' << format_double(pos[2]) << ']';;
    }
    m_out << "],";;
 
    m_out << " faces=[ ";
    for(size_t iface=0; iface<poly->f_size(); iface++) {
-      const xface& face = poly->f_get(iface);
+      xpolyhedron::face_ref face = poly->f_get(iface);
       if(iface > 0) m_out << ',';
       m_out << '[';
       size_t iv=0;
@@ -88,27 +88,27 @@ void openscad_csg::write_polyhedron_raw(std::shared_ptr<xpolyhedron> poly)
    }
    m_out << "] ";
 
-   m_out << ");" << std::endl;
+   m_out << ");" << '\n';
 }
 
 
 void openscad_csg::write_polyhedron_pretty(std::shared_ptr<xpolyhedron> poly)
 {
-   m_out << "\tpolyhedron( " << std::endl;
+   m_out << "\tpolyhedron( " << '\n';
 
-   m_out << "\t\tpoints=[ "<< std::endl;
+   m_out << "\t\tpoints=[ "<< '\n';
    for(size_t ivert=0; ivert<poly->v_size(); ivert++) {
       const carve::geom3d::Vector& pos = poly->v_get(ivert);
       m_out << "\t\t";
       if(ivert > 0) m_out << ',';
-      m_out << '[' << std::setprecision(16) << pos[0] << ',' << std::setprecision(16) <<  pos[1] << ',' << std::setprecision(16) <<  pos[2] << ']' << std::endl;
+      m_out << '[' << format_double(pos[0]) << ',' << format_double(pos[1]) << ',' << format_double(pos[2]) << ']' << '\n';
    }
-   m_out << "\t\t]," << std::endl;
+   m_out << "\t\t]," << '\n';
 
-   m_out << "\t\tfaces=[ "<< std::endl;
+   m_out << "\t\tfaces=[ "<< '\n';
    for(size_t iface=0; iface<poly->f_size(); iface++) {
       m_out << "\t\t";
-      const xface& face = poly->f_get(iface);
+      xpolyhedron::face_ref face = poly->f_get(iface);
       if(iface > 0) m_out << ',';
       m_out << '[';
       size_t iv=0;
@@ -116,11 +116,11 @@ void openscad_csg::write_polyhedron_pretty(std::shared_ptr<xpolyhedron> poly)
          if(iv++ > 0) m_out << ',';
          m_out << *i;
       }
-      m_out << ']' << std::endl;
+      m_out << ']' << '\n';
    }
-   m_out << "\t\t] " << std::endl;
+   m_out << "\t\t] " << '\n';
 
-   m_out << "\t);" << std::endl;
+   m_out << "\t);" << '\n';
 }
 
 void openscad_csg::write_polygon_raw(std::shared_ptr<polygon2d> poly )
@@ -139,7 +139,7 @@ void openscad_csg::write_polygon_raw(std::shared_ptr<polygon2d> poly )
             dpos2d pos = (*contour)[i];
             if(ivcount == 0) m_out << ' ';
             else             m_out << ',';
-            m_out << '[' << std::setprecision(16) << pos.x() << ',' << std::setprecision(16) <<   pos.y() << ']';
+            m_out << '[' << format_double(pos.x()) << ',' << format_double(pos.y()) << ']';
             ivcount++;
          }
       }
@@ -160,7 +160,7 @@ void openscad_csg::write_polygon_raw(std::shared_ptr<polygon2d> poly )
       }
    m_out << "] ";
 
-   m_out << ");" << std::endl;
+   m_out << ");" << '\n';
 }
 
 
@@ -169,11 +169,11 @@ void openscad_csg::write_polygon_pretty(std::shared_ptr<polygon2d> poly )
    // number of contours in polygon
    size_t nc = poly->size();
 
-   m_out << "\tpolygon( " << std::endl;
+   m_out << "\tpolygon( " << '\n';
 
    // first write all the  points in all contours
    size_t ivcount = 0;
-   m_out << "\t\tpoints=[ "<< std::endl;
+   m_out << "\t\tpoints=[ "<< '\n';
       for(size_t ic=0; ic<nc; ic++) {
          std::shared_ptr<const contour2d> contour = (*poly)[ic];
          for(size_t i=0; i<contour->size(); i++) {
@@ -181,20 +181,20 @@ void openscad_csg::write_polygon_pretty(std::shared_ptr<polygon2d> poly )
             m_out << "\t\t";
             if(ivcount == 0) m_out << ' ';
             else             m_out << ',';
-            m_out << '[' << std::setprecision(16) << pos.x() << ',' << std::setprecision(16) <<   pos.y() << ']' << std::endl;
+            m_out << '[' << format_double(pos.x()) << ',' << format_double(pos.y()) << ']' << '\n';
             ivcount++;
          }
       }
-   m_out << "\t\t]," << std::endl;
+   m_out << "\t\t]," << '\n';
 
    // then write all the contours, referring to the points
    ivcount = 0;
-   m_out << "\t\tpaths=[ "<< std::endl;
+   m_out << "\t\tpaths=[ "<< '\n';
       for(size_t ic=0; ic<nc; ic++) {
          std::shared_ptr<const contour2d> contour = (*poly)[ic];
          size_t nv = contour->size();
          if(ic == 0) m_out << "\t\t ";
-         else        m_out << std::endl << "\t\t,";
+         else        m_out << '\n' << "\t\t,";
          m_out << '[';
          for(size_t iv=0; iv<nv; iv++) {
             if(iv > 0) m_out << ',';
@@ -202,9 +202,9 @@ void openscad_csg::write_polygon_pretty(std::shared_ptr<polygon2d> poly )
          }
          m_out << ']';
       }
-   m_out << std::endl << "\t\t] "<< std::endl;
+   m_out << '\n' << "\t\t] "<< '\n';
 
-   m_out << "\t);" << std::endl;
+   m_out << "\t);" << '\n';
 }
 
 void openscad_csg::write_transform(const carve::math::Matrix& t)
@@ -215,10 +215,10 @@ void openscad_csg::write_transform(const carve::math::Matrix& t)
       m_out << '[';
       for(size_t icol=0;icol<4; icol++) {
          if(icol > 0) m_out << ',';
-         m_out << setprecision(16) <<  t.m[icol][irow];
+         m_out << format_double(t.m[icol][irow]);
       }
       m_out << ']';
    }
 
-   m_out << "])" << std::endl;
+   m_out << "])" << '\n';
 }
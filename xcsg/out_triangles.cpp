@@ -14,28 +14,68 @@
 // EndLicense:
 
 #include "out_triangles.h"
-#include <carve/poly.hpp>
 #include <fstream>
 #include "std_filename.h"
+#include "char_buffer.h"
+#include "thread_pool.h"
+#include "zip_file.h"
+#include "gz_file.h"
+#include "geom_kernel.h"
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <functional>
+#include <unordered_map>
 
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
-
-out_triangles::out_triangles(std::shared_ptr<poly_vector> polyset)
-: m_polyset(polyset)
+#if defined(__linux__)
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+#endif
+
+out_triangles::out_triangles(std::shared_ptr<mesh_vector> meshes)
+: m_meshes(meshes)
+, m_weld(false)
+, m_gzip(false)
 {}
 
 out_triangles::~out_triangles()
 {}
 
-static double face_area(std::vector<carve::geom::vector<3>>& p)
+// 64 bit FNV-1a
+static void hash_bytes(uint64_t& h, const void* data, size_t nbytes)
+{
+   const unsigned char* p = static_cast<const unsigned char*>(data);
+   for(size_t i=0; i<nbytes; i++) {
+      h ^= p[i];
+      h *= 1099511628211ULL;
+   }
+}
+
+std::string out_triangles::content_hash() const
 {
-   // https://en.wikipedia.org/wiki/Heron's_formula
-   double a = (p[1] - p[0]).length();
-   double b = (p[2] - p[1]).length();
-   double c = (p[0] - p[2]).length();
-   double s = 0.5*(a+b+c);
-   return sqrt(s*(s-a)*(s-b)*(s-c));
+   uint64_t h = 14695981039346656037ULL;
+   hash_bytes(h,&m_weld,sizeof(m_weld));
+   hash_bytes(h,&m_gzip,sizeof(m_gzip));
+   if(m_meshes) {
+      for(auto& mesh : *m_meshes) {
+         uint64_t nvert = mesh->v_size();
+         uint64_t ntri  = mesh->t_size();
+         hash_bytes(h,&nvert,sizeof(nvert));
+         hash_bytes(h,&ntri,sizeof(ntri));
+         for(size_t ivert=0; ivert<nvert; ivert++) {
+            carve::geom3d::Vector v = mesh->v_get(ivert);
+            hash_bytes(h,v.v,sizeof(v.v));
+         }
+         if(ntri > 0) hash_bytes(h,mesh->t_get(0),3*ntri*sizeof(uint32_t));
+      }
+   }
+   std::ostringstream out;
+   out << std::hex << std::setw(16) << std::setfill('0') << h;
+   return out.str();
 }
 
 std::string out_triangles::write_stl(const std::string& xcsg_path, bool binary)
@@ -44,65 +84,199 @@ std::string out_triangles::write_stl(const std::string& xcsg_path, bool binary)
    else      return write_stl_ascii(xcsg_path);
 }
 
-std::string  out_triangles::write_csg(const std::string& xcsg_path)
+// open a text file for export, throws on failure
+static FILE* open_text_file(const std::string& path)
 {
-   boost::filesystem::path fullpath(xcsg_path);
-   boost::filesystem::path csg_path = fullpath.parent_path() / fullpath.stem();
-   std::string path = csg_path.string() + ".csg";
+   FILE* file = std::fopen(path.c_str(),"w");
+   if(!file) throw std::logic_error("out_triangles:: Failed to open: " + path);
+   return file;
+}
 
-   // fix inconsistent slashes to something that is consistent and works everytwhere
-   std::replace(path.begin(),path.end(), '\\', '/');
+// export_sink is where the encoded data goes, an open file, a compressed file or a caller supplied stream
+class export_sink {
+public:
+   export_sink(FILE* file)        : m_file(file), m_stream(nullptr) {}
+   export_sink(std::ostream& out) : m_file(nullptr), m_stream(&out) {}
+   export_sink(zip_file& zip)     : m_file(nullptr), m_stream(nullptr), m_zip(&zip) {}
+   export_sink(gz_file& gz)       : m_file(nullptr), m_stream(nullptr), m_gz(&gz) {}
+
+   // write buffer contents and clear the buffer. Returns false on write error
+   bool write(char_buffer& buf)
+   {
+      if(m_zip) { m_zip->write(buf.data(),buf.size()); buf.clear(); return true; }
+      if(m_gz)  { m_gz->write(buf.data(),buf.size());  buf.clear(); return true; }
+      return (m_file)? buf.flush(m_file) : buf.flush(*m_stream);
+   }
+   bool write_if_full(char_buffer& buf) { return (buf.size() < char_buffer::flush_size)? true : write(buf); }
+
+private:
+   FILE*         m_file;
+   std::ostream* m_stream;
+   zip_file*     m_zip = nullptr;   // zip_file and gz_file throw on write error
+   gz_file*      m_gz  = nullptr;
+};
+
+// export_file is an export file opened for writing, gzip compressed when requested.
+// A file not closed is removed, it belongs to a failed export
+class export_file {
+public:
+   // ".gz" is appended to path when gzip is true
+   export_file(const std::string& path, bool binary, bool gzip)
+   : m_path(path + ((gzip)? ".gz" : ""))
+   , m_file(std::fopen(m_path.c_str(),(binary || gzip)? "wb" : "w"))
+   {
+      if(!m_file) throw std::logic_error("out_triangles:: Failed to open: " + m_path);
+      if(gzip) m_gz.reset(new gz_file(m_file));
+      m_sink.reset((m_gz)? new export_sink(*m_gz) : new export_sink(m_file));
+   }
 
-   std::ofstream out(path);
+   ~export_file()
+   {
+      if(m_file) {
+         m_gz.reset();
+         std::fclose(m_file);
+         boost::system::error_code ec;
+         boost::filesystem::remove(m_path,ec);
+      }
+   }
 
-   out << "// OpenSCAD file created by xcsg : " << path << std::endl;;
-   out << "union() {" << std::endl;
+   export_sink& sink() { return *m_sink; }
+   const std::string& path() const { return m_path; }
 
-      for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
+   // complete and close the file, throws if ok is false or on failure
+   void close(bool ok)
+   {
+      if(m_gz) m_gz->close();
+      ok = (std::fclose(m_file) == 0) && ok;
+      m_file = nullptr;
+      if(!ok) throw std::logic_error("out_triangles:: Failed to write: " + m_path);
+   }
 
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-         std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+private:
+   std::string                  m_path;
+   FILE*                        m_file;
+   std::unique_ptr<gz_file>     m_gz;
+   std::unique_ptr<export_sink> m_sink;
+};
+
+// vertex_pool holds the vertices of all meshes with coincident vertices merged, for writing
+// all lumps as one indexed mesh. Vertices are merged when their coordinates are equal
+struct vertex_pool {
+   std::vector<const carve::geom3d::Vector*> vertices;   // in order of first use
+   std::vector<std::vector<uint32_t>>        index;      // per mesh, pool index of each mesh vertex
+};
+
+struct vertex_key_hash {
+   size_t operator()(const carve::geom3d::Vector& v) const
+   {
+      // +0.0 makes -0 and 0 hash the same, as they compare equal
+      std::hash<double> h;
+      size_t seed = h(v.x+0.0);
+      seed ^= h(v.y+0.0) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+      seed ^= h(v.z+0.0) + 0x9e3779b9 + (seed<<6) + (seed>>2);
+      return seed;
+   }
+};
 
-         out << "\tpolyhedron( ";
+struct vertex_key_equal {
+   bool operator()(const carve::geom3d::Vector& a, const carve::geom3d::Vector& b) const { return a.x==b.x && a.y==b.y && a.z==b.z; }
+};
+
+static std::shared_ptr<vertex_pool> make_vertex_pool(const out_triangles::mesh_vector& meshes)
+{
+   auto pool = std::make_shared<vertex_pool>();
+   size_t nvert = 0;
+   for(auto& mesh : meshes) nvert += mesh->v_size();
+
+   std::unordered_map<carve::geom3d::Vector,uint32_t,vertex_key_hash,vertex_key_equal> lookup(nvert);
+   pool->vertices.reserve(nvert);
+   pool->index.resize(meshes.size());
+   for(size_t imesh=0; imesh<meshes.size(); imesh++) {
+      const triangle_mesh& mesh = *meshes[imesh];
+      std::vector<uint32_t>& index = pool->index[imesh];
+      index.resize(mesh.v_size());
+      for(size_t ivert=0; ivert<mesh.v_size(); ivert++) {
+         const carve::geom3d::Vector& vtx = mesh.v_get(ivert);
+         auto it = lookup.insert(std::make_pair(vtx,static_cast<uint32_t>(pool->vertices.size()))).first;
+         if(it->second == pool->vertices.size()) pool->vertices.push_back(&vtx);
+         index[ivert] = it->second;
+      }
+   }
+   return pool;
+}
+
+static void encode_csg(const out_triangles::mesh_vector& meshes, const std::string& path, export_sink& sink)
+{
+   char_buffer out(char_buffer::flush_size);
+
+   out.append("// OpenSCAD file created by xcsg : ").append(path).append('\n');
+   out.append("union() {\n");
+
+      for(size_t imesh=0; imesh<meshes.size(); imesh++) {
+
+         const triangle_mesh& mesh = *meshes[imesh];
+
+         out.append("\tpolyhedron( ");
 
          // ========= points / vertices =================
-         out << " points=[ ";
-         for(size_t ivert=0; ivert<vertices.size(); ivert++) {
-            carve::poly::Geometry<3>::vertex_t& vtx = vertices[ivert];
-            if(ivert > 0) out << ',';
-            out << '[' << std::setprecision(16) << vtx.v[0] << ',' << std::setprecision(16) << vtx.v[1] << ',' << std::setprecision(16) <<  vtx.v[2] << ']';
+         out.append(" points=[ ");
+         for(size_t ivert=0; ivert<mesh.v_size(); ivert++) {
+            const carve::geom3d::Vector& vtx = mesh.v_get(ivert);
+            if(ivert > 0) out.append(',');
+            out.append('[').append(vtx.v[0]).append(',').append(vtx.v[1]).append(',').append(vtx.v[2]).append(']');
+            if(!sink.write_if_full(out)) throw std::logic_error("out_triangles:: Failed to write: " + path);
          }
-         out << "],";
+         out.append("],");
 
          // ========= faces =================
-         out << " faces=[ ";
-         for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-            carve::poly::Face<3>& face = poly->faces[iface];
-
-            size_t nvert = face.nVertices();
-            if(nvert != 3)throw std::logic_error("carve_triangulate:: detected non-triangular face after triangulation!");
-            if(iface > 0) out << ',';
-            out << '[';
-            std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-            poly->faces[iface].getVertexLoop(vloop);
-            for(size_t ivert=0; ivert<nvert; ivert++) {
-               if(ivert > 0) out << ',';
-               size_t index = poly->vertexToIndex(vloop[2-ivert]); // reverse vertex order in OpenSCAD
-               out << index;
-            }
-            out << ']';
+         out.append(" faces=[ ");
+         for(size_t itri=0; itri<mesh.t_size(); ++itri) {
+            const uint32_t* tri = mesh.t_get(itri);
+
+            // reverse vertex order in OpenSCAD
+            if(itri > 0) out.append(',');
+            out.append('[').append(size_t(tri[2])).append(',').append(size_t(tri[1])).append(',').append(size_t(tri[0])).append(']');
+            if(!sink.write_if_full(out)) throw std::logic_error("out_triangles:: Failed to write: " + path);
          }
-         out << "] ";
+         out.append("] ");
 
-         out << ");" << std::endl;
+         out.append(");\n");
       }
 
-   out << "};" << std::endl;
+   out.append("};\n");
+   if(!sink.write(out)) throw std::logic_error("out_triangles:: Failed to write: " + path);
+}
+
+std::string  out_triangles::write_csg(const std::string& xcsg_path)
+{
+   boost::filesystem::path fullpath(xcsg_path);
+   boost::filesystem::path csg_path = fullpath.parent_path() / fullpath.stem();
+   std::string path = csg_path.string() + ".csg";
+
+   // fix inconsistent slashes to something that is consistent and works everytwhere
+   std::replace(path.begin(),path.end(), '\\', '/');
+
+   FILE* file = open_text_file(path);
+   export_sink sink(file);
+   try {
+      encode_csg(*m_meshes,path,sink);
+   }
+   catch(...) {
+      std::fclose(file);
+      throw;
+   }
+   if(std::fclose(file) != 0) throw std::logic_error("out_triangles:: Failed to write: " + path);
 
-   m_files_written.insert(path);
+   add_file_written(path);
    return path;
 }
 
+void out_triangles::write_csg(std::ostream& out, const std::string& name)
+{
+   export_sink sink(out);
+   encode_csg(*m_meshes,name,sink);
+}
+
 
 std::string out_triangles::write_off(const std::string& xcsg_path)
 {
@@ -110,106 +284,293 @@ std::string out_triangles::write_off(const std::string& xcsg_path)
    boost::filesystem::path csg_path = fullpath.parent_path() / fullpath.stem();
 
    std::string path;
+   char_buffer out(char_buffer::flush_size);
+
+   // with welded vertices all lumps go to one file
+   if(m_weld) {
+      path = csg_path.string() + ".off";
+      std::replace(path.begin(),path.end(), '\\', '/');
+
+      std::shared_ptr<vertex_pool> pool = make_vertex_pool(*m_meshes);
+      size_t ntri = 0;
+      for(auto& mesh : *m_meshes) ntri += mesh->t_size();
+
+      export_file file(path,false,m_gzip);
+      export_sink& sink = file.sink();
+      bool ok = true;
+      out.append("OFF \n");
+      out.append(pool->vertices.size()).append(' ').append(ntri).append(" 0 \n");
+      for(const carve::geom3d::Vector* vtx : pool->vertices) {
+         out.append(vtx->v[0]).append(' ').append(vtx->v[1]).append(' ').append(vtx->v[2]).append('\n');
+         ok = sink.write_if_full(out) && ok;
+      }
+      for(size_t imesh=0; imesh<m_meshes->size(); imesh++) {
+         const triangle_mesh& mesh = *(*m_meshes)[imesh];
+         const std::vector<uint32_t>& index = pool->index[imesh];
+         for(size_t itri=0; itri<mesh.t_size(); ++itri) {
+            const uint32_t* tri = mesh.t_get(itri);
+            out.append("3 ").append(size_t(index[tri[0]])).append(' ').append(size_t(index[tri[1]])).append(' ').append(size_t(index[tri[2]])).append(" \n");
+            ok = sink.write_if_full(out) && ok;
+         }
+      }
+      ok = sink.write(out) && ok;
+      file.close(ok);
+
+      add_file_written(file.path());
+      return file.path();
+   }
 
-   for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
+   for(size_t imesh=0; imesh<m_meshes->size(); imesh++) {
 
       std::ostringstream postfix;
-      if(ipoly > 0)postfix << '_' << ipoly;
+      if(imesh > 0)postfix << '_' << imesh;
       postfix << ".off";
 
       path = csg_path.string() + postfix.str();
       std::replace(path.begin(),path.end(), '\\', '/');
 
-      std::ofstream out(path);
+      export_file file(path,false,m_gzip);
+      export_sink& sink = file.sink();
+      bool ok = true;
 
-      std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-      std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+      const triangle_mesh& mesh = *(*m_meshes)[imesh];
 
-      out << "OFF " << std::endl;
+      out.append("OFF \n");
   // OFF comment line not supported by tetgen
   //    out << "# OFF file created by xcsg : " << path << std::endl;
-      out << poly->vertices.size() << ' ' << poly->faces.size() << " 0 " <<  std::endl;  // numedges always zero
+      out.append(mesh.v_size()).append(' ').append(mesh.t_size()).append(" 0 \n");  // numedges always zero
 
       // ========= vertices =================
-      for(size_t ivert=0; ivert<vertices.size(); ivert++) {
-         carve::poly::Geometry<3>::vertex_t& vtx = vertices[ivert];
-         out << std::setprecision(16) << vtx.v[0] << ' ' << std::setprecision(16) << vtx.v[1] << ' ' << std::setprecision(16) <<  vtx.v[2] << std::endl;
+      for(size_t ivert=0; ivert<mesh.v_size(); ivert++) {
+         const carve::geom3d::Vector& vtx = mesh.v_get(ivert);
+         out.append(vtx.v[0]).append(' ').append(vtx.v[1]).append(' ').append(vtx.v[2]).append('\n');
+         ok = sink.write_if_full(out) && ok;
       }
 
       // ========= faces =================
-      for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-         carve::poly::Face<3>& face = poly->faces[iface];
-
-         size_t nvert = face.nVertices();
-         std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-         poly->faces[iface].getVertexLoop(vloop);
-         out << nvert << ' ';
-         for(size_t ivert=0; ivert<nvert; ivert++) {
-            size_t index = poly->vertexToIndex(vloop[ivert]);
-            out << index << ' ';
-         }
-         out << std::endl;
+      for(size_t itri=0; itri<mesh.t_size(); ++itri) {
+         const uint32_t* tri = mesh.t_get(itri);
+         out.append("3 ").append(size_t(tri[0])).append(' ').append(size_t(tri[1])).append(' ').append(size_t(tri[2])).append(" \n");
+         ok = sink.write_if_full(out) && ok;
       }
+
+      ok = sink.write(out) && ok;
+      file.close(ok);
+      path = file.path();
    }
 
-   m_files_written.insert(path);
+   add_file_written(path);
    return path;
 }
 
 
+static void encode_obj(const out_triangles::mesh_vector& meshes, const std::string& path, const std::string& object_id, export_sink& sink, const vertex_pool* pool)
+{
+   char_buffer out(char_buffer::flush_size);
+
+   out.append("# OBJ file created by xcsg : ").append(path).append('\n');
+   out.append("o ").append(object_id).append('\n');
+
+   // ========= vertices =================
+   if(pool) {
+      for(const carve::geom3d::Vector* vtx : pool->vertices) {
+         out.append("v ").append(vtx->v[0]).append(' ').append(vtx->v[1]).append(' ').append(vtx->v[2]).append('\n');
+         if(!sink.write_if_full(out)) throw std::logic_error("out_triangles:: Failed to write: " + path);
+      }
+   }
+   else {
+      for(size_t imesh=0; imesh<meshes.size(); imesh++) {
+
+         const triangle_mesh& mesh = *meshes[imesh];
+         for(size_t ivert=0; ivert<mesh.v_size(); ivert++) {
+            const carve::geom3d::Vector& vtx = mesh.v_get(ivert);
+            out.append("v ").append(vtx.v[0]).append(' ').append(vtx.v[1]).append(' ').append(vtx.v[2]).append('\n');
+            if(!sink.write_if_full(out)) throw std::logic_error("out_triangles:: Failed to write: " + path);
+         }
+      }
+   }
+
+   // ========= faces =================
+   size_t vertex_offset = 0;
+   for(size_t imesh=0; imesh<meshes.size(); imesh++) {
+
+      const triangle_mesh& mesh = *meshes[imesh];
+      for(size_t itri=0; itri<mesh.t_size(); ++itri) {
+         const uint32_t* tri = mesh.t_get(itri);
+
+         // indices are 1-based in OBJ
+         out.append("f ");
+         for(size_t ivert=0; ivert<3; ivert++) {
+            size_t index = (pool)? pool->index[imesh][tri[ivert]] : vertex_offset + tri[ivert];
+            out.append(1+index).append(' ');
+         }
+         out.append('\n');
+         if(!sink.write_if_full(out)) throw std::logic_error("out_triangles:: Failed to write: " + path);
+      }
+
+      vertex_offset += mesh.v_size();
+   }
+   if(!sink.write(out)) throw std::logic_error("out_triangles:: Failed to write: " + path);
+}
+
 std::string out_triangles::write_obj(const std::string& xcsg_path)
 {
    boost::filesystem::path fullpath(xcsg_path);
    boost::filesystem::path csg_path = fullpath.parent_path() / fullpath.stem();
    std::string path = csg_path.string() + ".obj";
    std::replace(path.begin(),path.end(), '\\', '/');
-   std::ofstream out(path);
-   std::string object_id = fullpath.stem().string();
+   export_file file(path,false,m_gzip);
+   encode_obj(*m_meshes,path,fullpath.stem().string(),file.sink(),(m_weld)? make_vertex_pool(*m_meshes).get() : nullptr);
+   file.close(true);
 
-   out << "# OBJ file created by xcsg : " << path << std::endl;
-   out  << "o " << object_id << std::endl;
+   add_file_written(file.path());
+   return file.path();
+}
+
+void out_triangles::write_obj(std::ostream& out, const std::string& name)
+{
+   export_sink sink(out);
+   encode_obj(*m_meshes,name,name,sink,(m_weld)? make_vertex_pool(*m_meshes).get() : nullptr);
+}
 
-   // ========= vertices =================
-   for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
 
-      std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-      std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+// STL facets are encoded in parallel, in chunks of mesh triangles.
+// A batch of chunks is encoded at a time and then written to file in order
+static const size_t stl_chunk_faces = 1<<15;
 
-      for(size_t ivert=0; ivert<vertices.size(); ivert++) {
-         carve::poly::Geometry<3>::vertex_t& vtx = vertices[ivert];
-         out << "v " << std::setprecision(16) << vtx.v[0] << ' ' << std::setprecision(16) << vtx.v[1] << ' ' << std::setprecision(16) <<  vtx.v[2] << std::endl;
+struct stl_chunk {
+   std::shared_ptr<triangle_mesh> mesh;
+   size_t first;   // first triangle in chunk
+   size_t last;    // one beyond last triangle in chunk
+};
+
+static std::vector<stl_chunk> make_stl_chunks(const out_triangles::mesh_vector& meshes)
+{
+   std::vector<stl_chunk> chunks;
+   for(auto& mesh : meshes) {
+      size_t ntri = mesh->t_size();
+      for(size_t first=0; first<ntri; first+=stl_chunk_faces) {
+         chunks.push_back({mesh,first,std::min(ntri,first+stl_chunk_faces)});
       }
    }
+   return chunks;
+}
 
-   // ========= faces =================
-   size_t vertex_offset = 0;
-   for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
-
-      std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-      std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
+static bool write_stl_chunks(export_sink& sink, const std::vector<stl_chunk>& chunks, std::function<void(const stl_chunk&, char_buffer&)> encode)
+{
+   bool ok = true;
+   const size_t nbatch = 2*thread_pool::singleton().nthreads();
+   std::vector<char_buffer> buffers(nbatch);
+   for(size_t ibegin=0; ibegin<chunks.size(); ibegin+=nbatch) {
+      size_t iend = std::min(chunks.size(),ibegin+nbatch);
+
+      thread_pool::task_group group;
+      for(size_t ichunk=ibegin; ichunk<iend; ichunk++) {
+         char_buffer& buffer = buffers[ichunk-ibegin];
+         const stl_chunk& chunk = chunks[ichunk];
+         thread_pool::singleton().submit(group,[&encode,&chunk,&buffer]() { encode(chunk,buffer); });
+      }
+      thread_pool::singleton().wait(group);
 
-      for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-         carve::poly::Face<3>& face = poly->faces[iface];
+      for(size_t ichunk=ibegin; ichunk<iend; ichunk++) {
+         ok = sink.write(buffers[ichunk-ibegin]) && ok;
+      }
+   }
+   return ok;
+}
 
-         size_t nvert = face.nVertices();
-         std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-         poly->faces[iface].getVertexLoop(vloop);
-         out << "f ";
-         for(size_t ivert=0; ivert<nvert; ivert++) {
-            size_t index = poly->vertexToIndex(vloop[ivert]);
+// the corners of the triangles of a chunk, 9 values each, and their unit normals, (0,0,0) for zero area
+static void stl_chunk_geometry(const stl_chunk& chunk, std::vector<double>& corners, std::vector<double>& normals)
+{
+   const size_t ntri = chunk.last - chunk.first;
+   corners.resize(9*ntri);
+   normals.resize(3*ntri);
+   for(size_t itri=0; itri<ntri; itri++) {
+      const uint32_t* tri = chunk.mesh->t_get(chunk.first+itri);
+      double* c = &corners[9*itri];
+      for(size_t iv=0; iv<3; iv++) {
+         carve::geom3d::Vector p = chunk.mesh->v_get(tri[iv]);
+         c[3*iv] = p.x; c[3*iv+1] = p.y; c[3*iv+2] = p.z;
+      }
+   }
+   geom_kernel::triangle_normals(corners.data(),ntri,normals.data());
+}
 
-            // indices are 1-based in OBJ
-            out << vertex_offset + 1+index << ' ';
+static bool encode_stl_ascii(const out_triangles::mesh_vector& meshes, export_sink& sink)
+{
+   char_buffer header;
+   header.append("solid xcsg \n");
+   bool ok = sink.write(header);
+
+   ok = write_stl_chunks(sink,make_stl_chunks(meshes),[](const stl_chunk& chunk, char_buffer& out) {
+      std::vector<double> corners,normals;
+      stl_chunk_geometry(chunk,corners,normals);
+      for(size_t itri=0; itri<chunk.last-chunk.first; itri++) {
+         const double* p      = &corners[9*itri];
+         const double* normal = &normals[3*itri];
+         bool has_normal = (normal[0] != 0.0 || normal[1] != 0.0 || normal[2] != 0.0);
+
+         // facet normal does not require high precision, it is usually ignored, so we save some space instead
+         if(has_normal) out.append("facet normal ").append(normal[0],8).append(' ').append(normal[1],8).append(' ').append(normal[2],8).append('\n');
+         else           out.append("facet normal 0 0 0\n");
+
+         out.append("\touter loop\n");
+         for(size_t iv=0;iv<3;iv++) {
+            out.append("\t\tvertex ").append(p[3*iv]).append(' ').append(p[3*iv+1]).append(' ').append(p[3*iv+2]).append('\n');
          }
-         out << std::endl;
+         out.append("\tendloop\n");
+         out.append("endfacet\n");
       }
+   }) && ok;
 
-      vertex_offset += vertices.size();
+   header.append("endsolid\n");
+   return sink.write(header) && ok;
+}
+
+// encode the binary STL facet records of a chunk
+static void encode_stl_binary_chunk(const stl_chunk& chunk, char_buffer& out)
+{
+   // each facet record is 50 bytes: normal, 3 vertices and the attribute byte count
+   const size_t record_size = 12*sizeof(float) + sizeof(uint16_t);
+   char record[record_size];
+   float* xyz = reinterpret_cast<float*>(record);
+
+   std::vector<double> corners,normals;
+   stl_chunk_geometry(chunk,corners,normals);
+   for(size_t itri=0; itri<chunk.last-chunk.first; itri++) {
+
+      // we write regardless of area here, because we didn't check the areas when we computed the number of triangles
+      for(size_t k=0; k<3; k++) xyz[k]   = static_cast<float>(normals[3*itri+k]);
+      for(size_t k=0; k<9; k++) xyz[3+k] = static_cast<float>(corners[9*itri+k]);
+      uint16_t bcount = 0;
+      std::memcpy(record+12*sizeof(float),&bcount,sizeof(bcount));
+      out.append(record,record_size);
    }
-   m_files_written.insert(path);
-   return path;
 }
 
+// the 80 byte header and the number of triangles of a binary STL file
+static bool write_stl_binary_header(export_sink& sink, uint32_t ntri)
+{
+   char_buffer header;
+   const size_t blen=80;
+   char buffer[blen];
+   for(size_t i=0; i<blen; i++) buffer[i]=' ';
+   header.append(buffer,blen);
+   header.append(&ntri,sizeof(uint32_t));
+   return sink.write(header);
+}
+
+static bool encode_stl_binary(const out_triangles::mesh_vector& meshes, export_sink& sink)
+{
+   // write the header with the number of triangles
+   uint32_t ntri=0;
+   for(auto& mesh : meshes) {
+      ntri += static_cast<uint32_t>(mesh->t_size());
+   }
+   bool ok = write_stl_binary_header(sink,ntri);
+   ok = write_stl_chunks(sink,make_stl_chunks(meshes),encode_stl_binary_chunk) && ok;
+   return ok;
+}
 
 std::string  out_triangles::write_stl_ascii(const std::string& file_path)
 {
@@ -219,64 +580,11 @@ std::string  out_triangles::write_stl_ascii(const std::string& file_path)
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
-   std::ofstream out(path);
-   if(out.is_open()) {
-
-      out << "solid xcsg " << std::endl;
-
-      for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-         std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
-
-         size_t nfaces = poly->faces.size();
-         for(size_t iface=0; iface< nfaces; iface++) {
-
-            size_t nv = poly->faces[iface].nVertices();
-            if(nv != 3)throw std::logic_error("out_triangles:: detected non-triangular face after triangulation!");
-
-            typedef carve::geom::vector<3> vec3d;
-            std::vector<vec3d> p;
-            p.reserve(3);
-            std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-            poly->faces[iface].getVertexLoop(vloop);
-            for(size_t ivert=0; ivert<nv; ivert++) {
-               size_t index = poly->vertexToIndex(vloop[ivert]);
-               carve::poly::Geometry<3>::vertex_t& vtx = vertices[index];
-               p.push_back(carve::geom::VECTOR(vtx.v[0],vtx.v[1],vtx.v[2]));
-            }
-
-            vec3d x = p[1] - p[0];
-            vec3d y = p[2] - p[0];
-            vec3d z = carve::geom::cross(x,y);
-            double len = sqrt(z[0]*z[0] + z[1]*z[1] + z[2]*z[2]);
-
-            // facet normal does not require high precision, it is usually ignored, so we save some space instead
-            if(len > 0) out << "facet normal "
-                            << std::setprecision(8) << z[0]/len << ' '
-                            << std::setprecision(8) << z[1]/len << ' '
-                            << std::setprecision(8) << z[2]/len << std::endl;
-            else        out << "facet normal 0 0 0" << std::endl;
-
-
-            out << "\touter loop" << std::endl;
-            for(size_t iv=0;iv<nv;iv++) {
-
-               out << "\t\tvertex "<< std::setprecision(16) << p[iv].x <<
-                               ' ' << std::setprecision(16) << p[iv].y <<
-                               ' ' << std::setprecision(16) << p[iv].z << std::endl;
-            }
-            out << "\tendloop" << std::endl;
-            out << "endfacet" << std::endl;
-         }
-      }
-      out << "endsolid" << std::endl;
-   }
-   else {
-      std::string message = "stl_io::write_ascii(...)  Failed to open: " + file_path;
-      throw std::logic_error(message);
-   }
-   m_files_written.insert(path);
-   return path;
+   export_file stl(path,false,m_gzip);
+   stl.close(encode_stl_ascii(*m_meshes,stl.sink()));
+
+   add_file_written(stl.path());
+   return stl.path();
 }
 
 
@@ -289,75 +597,179 @@ std::string  out_triangles::write_stl_binary(const std::string& file_path)
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
-   if(FILE* stl = std::fopen(path.c_str(),"wb")) {
+   export_file stl(path,true,m_gzip);
+   stl.close(encode_stl_binary(*m_meshes,stl.sink()));
 
-      // write the header
-      const size_t blen=80;
-      char buffer[blen];
-      for(size_t i=0; i<blen; i++) buffer[i]=' ';
-      std::fwrite(buffer,sizeof(char),blen,stl);
+   add_file_written(stl.path());
+   return stl.path();
+}
 
-      // write number of triangles
-      uint32_t ntri=0;
-      for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-         ntri += static_cast<uint32_t>(poly->faces.size());
-      }
-      std::fwrite(&ntri,sizeof(uint32_t),1,stl);
-
-      for(size_t ipoly=0; ipoly<m_polyset->size(); ipoly++) {
-
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*m_polyset)[ipoly];
-         std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
-
-         size_t nfaces = poly->faces.size();
-         for(size_t iface=0; iface < nfaces; iface++) {
-
-            size_t nv = poly->faces[iface].nVertices();
-            if(nv != 3)throw std::logic_error("out_triangles:: detected non-triangular face after triangulation!");
-
-            typedef carve::geom::vector<3> vec3d;
-            std::vector<vec3d> p;
-            p.reserve(3);
-            std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-            poly->faces[iface].getVertexLoop(vloop);
-            for(size_t ivert=0; ivert<nv; ivert++) {
-               size_t index = poly->vertexToIndex(vloop[ivert]);
-               carve::poly::Geometry<3>::vertex_t& vtx = vertices[index];
-               p.push_back(carve::geom::VECTOR(vtx.v[0],vtx.v[1],vtx.v[2]));
-            }
-
-            // compute facet normal
-            vec3d x = p[1] - p[0];
-            vec3d y = p[2] - p[0];
-            vec3d z = carve::geom::cross(x,y);
-            double len = sqrt(z[0]*z[0] + z[1]*z[1] + z[2]*z[2]);
-
-            // we write regardless of area here, because we didn't check the areas when we computed the number of triangles
-            float xyz[] = {static_cast<float>(z[0]/len), static_cast<float>(z[1]/len),  static_cast<float>(z[2]/len) };
-            std::fwrite(xyz,sizeof(float),3,stl);
-
-            for(size_t iv=0;iv<nv;iv++) {
-               float xyz[] = {static_cast<float>(p[iv].x), static_cast<float>(p[iv].y),  static_cast<float>(p[iv].z) };
-               std::fwrite(xyz,sizeof(float),3,stl);
-            }
-
-            // write the attribute byte count value
-            uint16_t bcount = 0;
-            std::fwrite(&bcount, sizeof(bcount), 1, stl);
+void out_triangles::write_stl(std::ostream& out, bool binary)
+{
+   export_sink sink(out);
+   bool ok = (binary)? encode_stl_binary(*m_meshes,sink) : encode_stl_ascii(*m_meshes,sink);
+   if(!ok) throw std::logic_error("out_triangles::write_stl(...)  Failed to write to stream");
+}
+
+// 3MF vertices are encoded in chunks of stl_chunk_faces vertices, first and last are vertex indices
+static std::vector<stl_chunk> make_vertex_chunks(const std::shared_ptr<triangle_mesh>& mesh)
+{
+   std::vector<stl_chunk> chunks;
+   size_t nvert = mesh->v_size();
+   for(size_t first=0; first<nvert; first+=stl_chunk_faces) {
+      chunks.push_back({mesh,first,std::min(nvert,first+stl_chunk_faces)});
+   }
+   return chunks;
+}
+
+// the 3MF model part, one object per mesh, all placed in the build
+static bool encode_3mf_model(const out_triangles::mesh_vector& meshes, export_sink& sink)
+{
+   char_buffer out;
+   out.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+   out.append("<model unit=\"millimeter\" xml:lang=\"en-US\" xmlns=\"http://schemas.microsoft.com/3dmanufacturing/core/2015/02\">\n");
+   out.append(" <metadata name=\"Application\">xcsg</metadata>\n");
+   out.append(" <resources>\n");
+   bool ok = sink.write(out);
+
+   for(size_t imesh=0; imesh<meshes.size(); imesh++) {
+      const std::shared_ptr<triangle_mesh>& mesh = meshes[imesh];
+
+      // object ids are positive
+      out.append("  <object id=\"").append(imesh+1).append("\" type=\"model\">\n");
+      out.append("   <mesh>\n    <vertices>\n");
+      ok = sink.write(out) && ok;
+
+      ok = write_stl_chunks(sink,make_vertex_chunks(mesh),[](const stl_chunk& chunk, char_buffer& buf) {
+         for(size_t ivert=chunk.first; ivert<chunk.last; ivert++) {
+            const carve::geom3d::Vector& vtx = chunk.mesh->v_get(ivert);
+            buf.append("     <vertex x=\"").append(vtx.v[0]).append("\" y=\"").append(vtx.v[1]).append("\" z=\"").append(vtx.v[2]).append("\"/>\n");
          }
+      }) && ok;
+
+      out.append("    </vertices>\n    <triangles>\n");
+      ok = sink.write(out) && ok;
+
+      std::vector<stl_chunk> chunks;
+      for(size_t first=0; first<mesh->t_size(); first+=stl_chunk_faces) {
+         chunks.push_back({mesh,first,std::min(mesh->t_size(),first+stl_chunk_faces)});
       }
+      ok = write_stl_chunks(sink,chunks,[](const stl_chunk& chunk, char_buffer& buf) {
+         for(size_t itri=chunk.first; itri<chunk.last; itri++) {
+            const uint32_t* tri = chunk.mesh->t_get(itri);
+            buf.append("     <triangle v1=\"").append(size_t(tri[0])).append("\" v2=\"").append(size_t(tri[1])).append("\" v3=\"").append(size_t(tri[2])).append("\"/>\n");
+         }
+      }) && ok;
 
-      std::fclose(stl);
+      out.append("    </triangles>\n   </mesh>\n  </object>\n");
+      ok = sink.write(out) && ok;
    }
-   else {
-      std::string message = "out_triangles::write_stl_binary(...)  Failed to open: " + file_path;
-      throw std::logic_error(message);
+
+   out.append(" </resources>\n <build>\n");
+   for(size_t imesh=0; imesh<meshes.size(); imesh++) {
+      out.append("  <item objectid=\"").append(imesh+1).append("\"/>\n");
    }
-   m_files_written.insert(path);
+   out.append(" </build>\n</model>\n");
+   return sink.write(out) && ok;
+}
+
+std::string out_triangles::write_3mf(const std::string& xcsg_path)
+{
+   boost::filesystem::path fullpath(xcsg_path);
+   boost::filesystem::path tmf_path = fullpath.parent_path() / fullpath.stem();
+   std::string path = tmf_path.string() + ".3mf";
+   std::replace(path.begin(),path.end(), '\\', '/');
+
+   FILE* file = std::fopen(path.c_str(),"wb");
+   if(!file) throw std::logic_error("out_triangles:: Failed to open: " + path);
+
+   // a 3MF file is a zip package: content types, the package relationship to the model, and the model
+   bool ok = true;
+   try {
+      zip_file zip(file);
+      char_buffer out;
+      export_sink sink(zip);
+
+      zip.begin_entry("[Content_Types].xml");
+      out.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+      out.append("<Types xmlns=\"http://schemas.openxmlformats.org/package/2006/content-types\">");
+      out.append("<Default Extension=\"rels\" ContentType=\"application/vnd.openxmlformats-package.relationships+xml\"/>");
+      out.append("<Default Extension=\"model\" ContentType=\"application/vnd.ms-package.3dmanufacturing-3dmodel+xml\"/>");
+      out.append("</Types>\n");
+      sink.write(out);
+      zip.end_entry();
+
+      zip.begin_entry("_rels/.rels");
+      out.append("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n");
+      out.append("<Relationships xmlns=\"http://schemas.openxmlformats.org/package/2006/relationships\">");
+      out.append("<Relationship Target=\"/3D/3dmodel.model\" Id=\"rel0\" Type=\"http://schemas.microsoft.com/3dmanufacturing/2013/01/3dmodel\"/>");
+      out.append("</Relationships>\n");
+      sink.write(out);
+      zip.end_entry();
+
+      zip.begin_entry("3D/3dmodel.model");
+      ok = encode_3mf_model(*m_meshes,sink);
+      zip.end_entry();
+      zip.close();
+   }
+   catch(...) {
+      std::fclose(file);
+      throw;
+   }
+   ok = (std::fclose(file) == 0) && ok;
+   if(!ok) throw std::logic_error("out_triangles:: Failed to write: " + path);
+
+   add_file_written(path);
    return path;
 }
 
+void out_triangles::add_file_written(const std::string& file_path)
+{
+   std::lock_guard<std::mutex> lock(m_files_mutex);
+   m_files_written.insert(file_path);
+}
+
+std::string out_triangles::rename_file_written(const std::string& from_path, const std::string& to_path)
+{
+   boost::filesystem::rename(from_path,to_path);
+   std::lock_guard<std::mutex> lock(m_files_mutex);
+   m_files_written.erase(from_path);
+   m_files_written.insert(to_path);
+   return to_path;
+}
+
+// make a copy-on-write clone of source as target, on file systems supporting it (btrfs, xfs)
+static bool reflink_file(const std::string& source, const std::string& target)
+{
+#if defined(__linux__) && defined(FICLONE)
+   int in = ::open(source.c_str(),O_RDONLY);
+   if(in < 0) return false;
+   int out = ::open(target.c_str(),O_WRONLY|O_CREAT|O_TRUNC,0644);
+   if(out < 0) {
+      ::close(in);
+      return false;
+   }
+   bool ok = (::ioctl(out,FICLONE,in) == 0);
+   ::close(out);
+   ::close(in);
+   if(!ok) ::unlink(target.c_str());
+   return ok;
+#else
+   return false;
+#endif
+}
+
+// give target the contents of source without copying the data when possible: a reflink, else a plain copy.
+// A hard link is not used, the writers rewrite their files in place and would change the copy too
+static void link_or_copy(const std::string& source, const std::string& target)
+{
+   namespace bfs = boost::filesystem;
+   boost::system::error_code ec;
+   bfs::remove(target,ec);
+   if(reflink_file(source,target)) return;
+   bfs::copy_file(source,target,bfs::copy_option::overwrite_if_exists);
+}
+
 std::set<std::string> out_triangles::copy_to(const std::string& dir_path)
 {
    namespace bfs = boost::filesystem;
@@ -375,13 +787,17 @@ std::set<std::string> out_triangles::copy_to(const std::string& dir_path)
       std_filename::create_directories(target_dir);
    }
 
-   // traverse the files to be copied
+   // traverse the files to be copied. The files are complete here, so they are cloned rather than copied
+   // where the file system allows, to avoid writing large results twice
+   boost::system::error_code ec;
    std::set<std::string> files_copied;
    for(auto& file : m_files_written) {
       std_filename source_file(file);
       std_filename target_file(file);
       target_file.SetPath(target_dir);
-      bfs::copy_file(source_file.GetFullPath(),target_file.GetFullPath(),bfs::copy_option::overwrite_if_exists);
+      if(!bfs::equivalent(source_file.GetFullPath(),target_file.GetFullPath(),ec)) {
+         link_or_copy(source_file.GetFullPath(),target_file.GetFullPath());
+      }
 
       if(std_filename::Exists(target_file.GetFullPath())) {
          std::string copied_path = target_file.GetFullPath();
@@ -392,3 +808,75 @@ std::set<std::string> out_triangles::copy_to(const std::string& dir_path)
 
    return std::move(files_copied);
 }
+
+stl_stream::stl_stream(const std::string& xcsg_path)
+: m_file(nullptr)
+, m_next(0)
+, m_ntri(0)
+, m_writing(false)
+, m_ok(true)
+{
+   boost::filesystem::path fullpath(xcsg_path);
+   boost::filesystem::path stl_path = fullpath.parent_path() / fullpath.stem();
+   m_path = stl_path.string() + ".stl";
+   std::replace(m_path.begin(),m_path.end(), '\\', '/');
+
+   m_file = std::fopen(m_path.c_str(),"wb");
+   if(!m_file) throw std::logic_error("stl_stream: Failed to open: " + m_path);
+
+   // the number of triangles is patched when the stream is closed
+   export_sink sink(m_file);
+   m_ok = write_stl_binary_header(sink,0);
+}
+
+stl_stream::~stl_stream()
+{
+   // a stream that was not closed belongs to a failed computation, the partial file is removed
+   if(m_file) {
+      std::fclose(m_file);
+      boost::system::error_code ec;
+      boost::filesystem::remove(m_path,ec);
+   }
+}
+
+void stl_stream::add_lump(size_t ilump, std::shared_ptr<triangle_mesh> mesh)
+{
+   std::unique_lock<std::mutex> lock(m_mutex);
+   m_pending[ilump] = mesh;
+   if(m_writing) return;
+
+   // this thread writes the lumps that are next in order, while others may add further lumps
+   m_writing = true;
+   auto next = m_pending.find(m_next);
+   while(next != m_pending.end()) {
+      std::shared_ptr<triangle_mesh> lump = next->second;
+      m_pending.erase(next);
+      lock.unlock();
+
+      export_sink sink(m_file);
+      out_triangles::mesh_vector lumps(1,lump);
+      bool ok = write_stl_chunks(sink,make_stl_chunks(lumps),encode_stl_binary_chunk);
+
+      lock.lock();
+      m_ok = m_ok && ok;
+      m_ntri += lump->t_size();
+      next = m_pending.find(++m_next);
+   }
+   m_writing = false;
+}
+
+std::string stl_stream::close()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   if(m_pending.size() > 0) throw std::logic_error("stl_stream: lump " + std::to_string(m_next+1) + " missing in " + m_path);
+
+   // patch the number of triangles in the header
+   uint32_t ntri = static_cast<uint32_t>(m_ntri);
+   char_buffer count;
+   count.append(&ntri,sizeof(uint32_t));
+   bool ok = (std::fseek(m_file,80,SEEK_SET) == 0) && count.flush(m_file) && m_ok;
+   ok = (std::fclose(m_file) == 0) && ok;
+   m_file = nullptr;
+   if(!ok) throw std::logic_error("stl_stream: Failed to write: " + m_path);
+   return m_path;
+}
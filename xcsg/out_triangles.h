@@ -18,17 +18,33 @@
 
 #include <vector>
 #include <set>
+#include <map>
+#include <cstdio>
 #include <memory>
-#include <carve/csg.hpp>
+#include <mutex>
+#include <string>
 #include <ostream>
+#include "triangle_mesh.h"
 
 class out_triangles {
 public:
-   typedef std::vector<std::shared_ptr<carve::poly::Polyhedron>> poly_vector;
+   typedef triangle_mesh_vector mesh_vector;
 
-   out_triangles(std::shared_ptr<poly_vector> polyset);
+   out_triangles(std::shared_ptr<mesh_vector> meshes);
    virtual ~out_triangles();
 
+   // when true, OBJ and OFF are written as one indexed mesh for all lumps, with coincident vertices merged.
+   // Must be set before the write_* functions are called
+   void set_weld(bool weld) { m_weld = weld; }
+
+   // when true, STL, OFF and OBJ files are written gzip compressed, with ".gz" appended to the file name.
+   // Must be set before the write_* functions are called
+   void set_gzip(bool gzip) { m_gzip = gzip; }
+
+   // hash of the exported content: the triangles and vertices of all meshes in order, and the weld and gzip
+   // settings. Equal hashes give equal files, see export_hash
+   std::string  content_hash() const;
+
    // export to (formatted) STL, return the path to the file created
    // input is full path to .xcsg file, stl to be stored in same folder
    std::string  write_stl(const std::string& xcsg_path, bool binary);
@@ -44,10 +60,25 @@ public:
    // export to OpenSCAD .csg
    std::string  write_csg(const std::string& xcsg_path);
 
-   // add additional path to written files
-   void add_file_written(const std::string& file_path) { m_files_written.insert(file_path); }
+   // export to 3MF, one object per mesh, return the path to the file created
+   // input is full path to .xcsg file, 3MF to be stored in same folder
+   std::string  write_3mf(const std::string& xcsg_path);
+
+   // export to a caller supplied stream instead of a file, no file is recorded as written.
+   // name is shown in the file comment (csg, obj) or used as object name (obj).
+   // Binary STL requires a stream opened in binary mode
+   void  write_stl(std::ostream& out, bool binary);
+   void  write_obj(std::ostream& out, const std::string& name);
+   void  write_csg(std::ostream& out, const std::string& name);
+
+   // add additional path to written files. The write_* functions may be called concurrently
+   void add_file_written(const std::string& file_path);
 
-   // copy all previously written files to target directory, return set of target files copied
+   // rename a previously written file, return the new path
+   std::string rename_file_written(const std::string& from_path, const std::string& to_path);
+
+   // copy all previously written files to target directory, return set of target files copied.
+   // The copies are reflinks when the file system supports them, so the data is not written again
    std::set<std::string> copy_to(const std::string& dir_path);
 
 private:
@@ -60,9 +91,45 @@ private:
    std::string  write_stl_binary(const std::string& file_path);
 
 private:
-   std::shared_ptr<poly_vector> m_polyset;
+   std::shared_ptr<mesh_vector> m_meshes;
+   bool                         m_weld;
+   bool                         m_gzip;
 
+   std::mutex            m_files_mutex;
    std::set<std::string> m_files_written;  // contains one entry per call to write_* functions
 };
 
+// stl_stream writes a binary STL file while the lumps are still being triangulated, so the export
+// overlaps with the computation of the remaining lumps. Lumps may be added from several threads
+// in any order, they are written in lump order as soon as all lumps before them are written. The
+// file is then the same as from out_triangles::write_stl. The triangle count in the header is
+// patched when the stream is closed, a stream destroyed without close removes its file.
+
+class stl_stream {
+public:
+   // input is full path to .xcsg file, stl to be stored in same folder
+   stl_stream(const std::string& xcsg_path);
+   virtual ~stl_stream();
+
+   // add lump ilump, counted from 0
+   void add_lump(size_t ilump, std::shared_ptr<triangle_mesh> mesh);
+
+   // patch the header and close the file after all lumps are added, return the path to the file created
+   std::string close();
+
+private:
+   stl_stream(const stl_stream&) = delete;
+   stl_stream& operator=(const stl_stream&) = delete;
+
+   std::string  m_path;
+   FILE*        m_file;
+
+   std::mutex   m_mutex;
+   std::map<size_t,std::shared_ptr<triangle_mesh>> m_pending;   // lumps added but not yet written
+   size_t       m_next;      // next lump to write
+   size_t       m_ntri;      // triangles written
+   bool         m_writing;   // a thread is writing lumps
+   bool         m_ok;        // no write errors
+};
+
 #endif // OUT_TRIANGLES_H
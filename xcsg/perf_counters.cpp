@@ -0,0 +1,230 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "perf_counters.h"
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <iomanip>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+static long current_tid()
+{
+#if defined(__linux__)
+   return static_cast<long>(syscall(SYS_gettid));
+#else
+   return -1;
+#endif
+}
+
+const char* perf_counters::name(size_t ic)
+{
+   static const char* names[ncounters] = { "cycles", "instructions", "cache_misses", "branch_misses", "context_switches" };
+   return names[ic];
+}
+
+perf_counters::perf_counters()
+: m_enabled(false)
+{
+   m_available.fill(false);
+   m_mark.fill(0.0);
+}
+
+perf_counters::~perf_counters()
+{
+   reset();
+}
+
+void perf_counters::register_thread(int worker)
+{
+   long tid = current_tid();
+   if(tid < 0) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   for(auto& t : m_threads) {
+      if(t.tid == tid) return;
+   }
+   thread_entry t;
+   t.tid    = tid;
+   t.worker = worker;
+   for(size_t ic=0; ic<ncounters; ic++) t.fd[ic] = -1;
+   if(m_enabled) open(t);
+   m_threads.push_back(t);
+}
+
+bool perf_counters::enable()
+{
+#if defined(__linux__)
+   register_thread(-1);
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_error.clear();
+   m_phases.clear();
+   m_mark.fill(0.0);
+   for(auto& t : m_threads) close(t);
+
+   // the counters the calling thread can open are opened for all threads
+   m_available.fill(true);
+   const long tid = current_tid();
+   thread_entry* self = &m_threads[0];
+   for(auto& t : m_threads) {
+      if(t.tid == tid) self = &t;
+   }
+   open(*self);
+   bool any = false;
+   for(size_t ic=0; ic<ncounters; ic++) {
+      m_available[ic] = (self->fd[ic] >= 0);
+      any = any || m_available[ic];
+   }
+   if(!any) return false;
+   for(auto& t : m_threads) {
+      if(&t != self) open(t);
+   }
+   m_enabled = true;
+   return true;
+#else
+   m_error = "performance counters are only supported on Linux";
+   return false;
+#endif
+}
+
+void perf_counters::reset()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   for(auto& t : m_threads) close(t);
+   m_enabled = false;
+   m_phases.clear();
+   m_mark.fill(0.0);
+}
+
+void perf_counters::open(thread_entry& t)
+{
+#if defined(__linux__)
+   static const uint32_t types[ncounters]  = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_SOFTWARE };
+   static const uint64_t events[ncounters] = { PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+                                               PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_SW_CONTEXT_SWITCHES };
+   for(size_t ic=0; ic<ncounters; ic++) {
+      if(!m_available[ic]) continue;
+
+      struct perf_event_attr attr;
+      std::memset(&attr,0,sizeof(attr));
+      attr.size           = sizeof(attr);
+      attr.type           = types[ic];
+      attr.config         = events[ic];
+      attr.read_format    = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+      attr.exclude_kernel = (types[ic] == PERF_TYPE_HARDWARE)? 1 : 0;
+      attr.exclude_hv     = 1;
+      t.fd[ic] = static_cast<int>(syscall(SYS_perf_event_open,&attr,static_cast<pid_t>(t.tid),-1,-1,0));
+      if(t.fd[ic] < 0 && m_error.length() == 0) {
+         m_error = std::string("perf_event_open failed for ") + name(ic) + ": " + std::strerror(errno);
+      }
+   }
+#else
+   (void)t;
+#endif
+}
+
+void perf_counters::close(thread_entry& t)
+{
+   for(size_t ic=0; ic<ncounters; ic++) {
+#if defined(__linux__)
+      if(t.fd[ic] >= 0) ::close(t.fd[ic]);
+#endif
+      t.fd[ic] = -1;
+   }
+}
+
+perf_counters::values perf_counters::read(const thread_entry& t) const
+{
+   values v;
+   v.fill(0.0);
+#if defined(__linux__)
+   for(size_t ic=0; ic<ncounters; ic++) {
+      if(t.fd[ic] < 0) continue;
+      uint64_t data[3] = {0,0,0};   // value, time enabled, time running
+      if(::read(t.fd[ic],data,sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+      double scale = (data[2] > 0)? double(data[1])/double(data[2]) : 0.0;
+      v[ic] = double(data[0])*scale;
+   }
+#endif
+   return v;
+}
+
+perf_counters::values perf_counters::total() const
+{
+   values sum;
+   sum.fill(0.0);
+   for(auto& t : m_threads) {
+      values v = read(t);
+      for(size_t ic=0; ic<ncounters; ic++) sum[ic] += v[ic];
+   }
+   return sum;
+}
+
+void perf_counters::end_phase(const std::string& name)
+{
+   if(!m_enabled) return;
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   values now = total();
+   values delta;
+   for(size_t ic=0; ic<ncounters; ic++) delta[ic] = now[ic] - m_mark[ic];
+   m_phases.push_back(std::make_pair(name,delta));
+   m_mark = now;
+}
+
+// write the counters as JSON members, null when not available
+static void write_values(std::ostream& out, const perf_counters::values& v, const std::array<bool,perf_counters::ncounters>& available)
+{
+   for(size_t ic=0; ic<perf_counters::ncounters; ic++) {
+      out << ", \"" << perf_counters::name(ic) << "\": ";
+      if(available[ic]) out << static_cast<uint64_t>(v[ic] + 0.5);
+      else              out << "null";
+   }
+   if(available[perf_counters::cycles] && available[perf_counters::instructions]) {
+      double ipc = (v[perf_counters::cycles] > 0.0)? v[perf_counters::instructions]/v[perf_counters::cycles] : 0.0;
+      out << ", \"ipc\": " << std::setprecision(3) << ipc;
+   }
+}
+
+void perf_counters::write_json(std::ostream& out) const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   out << "  \"counters\": {\"available\": " << ((m_enabled)? "true" : "false");
+   if(m_error.length() > 0) out << ", \"error\": \"" << m_error << "\"";
+   if(m_enabled) {
+      out << "," << std::endl << "    \"phases\": [";
+      for(size_t ip=0; ip<m_phases.size(); ip++) {
+         out << ((ip > 0)? ", " : "") << "{\"phase\": \"" << m_phases[ip].first << "\"";
+         write_values(out,m_phases[ip].second,m_available);
+         out << "}";
+      }
+      out << "]," << std::endl << "    \"threads\": [";
+      for(size_t it=0; it<m_threads.size(); it++) {
+         out << ((it > 0)? ", " : "") << "{\"tid\": " << m_threads[it].tid << ", \"worker\": " << m_threads[it].worker;
+         write_values(out,read(m_threads[it]),m_available);
+         out << "}";
+      }
+      out << "]";
+   }
+   out << "}," << std::endl;
+}
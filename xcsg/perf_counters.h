@@ -0,0 +1,96 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <array>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <utility>
+#include <vector>
+
+// perf_counters collects hardware performance counters of the process with --counters: cycles,
+// instructions, cache misses, branch misses and context switches. They are totalled per phase of
+// phase_timer and per thread, and written to the --profile JSON next to the node timings.
+//
+// The counters are read with perf_event_open and are only available on Linux, when the kernel
+// permits it (see /proc/sys/kernel/perf_event_paranoid). Every thread has its own counters, so the
+// pool workers register themselves as they start. Counters multiplexed by the kernel are scaled
+// to the time they were enabled. Counters the machine does not provide, e.g. the hardware counters
+// in most virtual machines, are written as null.
+
+class perf_counters {
+public:
+   static perf_counters& singleton()  { static perf_counters instance; return instance;  }
+
+   enum counter { cycles, instructions, cache_misses, branch_misses, context_switches, ncounters };
+   typedef std::array<double,ncounters> values;
+
+   // JSON name of counter ic
+   static const char* name(size_t ic);
+
+   // record the calling thread, worker is its thread_pool index or -1. Its counters are opened
+   // now if collection is enabled, else when it is enabled
+   void register_thread(int worker);
+
+   // start collecting for all registered threads and the calling thread.
+   // Returns false if no counter is supported or permitted, see error()
+   bool enable();
+   bool enabled() const { return m_enabled; }
+   const std::string& error() const { return m_error; }
+
+   // close all counters and disable collection, called before each run
+   void reset();
+
+   // attribute the counts since the previous phase to phase name, see phase_timer::end_phase
+   void end_phase(const std::string& name);
+
+   // write the "counters" member of the profile JSON, followed by a comma
+   void write_json(std::ostream& out) const;
+
+protected:
+   perf_counters();
+   virtual ~perf_counters();
+
+   struct thread_entry {
+      long   tid;
+      int    worker;
+      int    fd[ncounters];     // -1 when not open
+   };
+
+   // open the available counters of a thread
+   void open(thread_entry& t);
+   void close(thread_entry& t);
+
+   // counts of a thread since its counters were opened
+   values read(const thread_entry& t) const;
+
+   // counts of all threads since collection was enabled
+   values total() const;
+
+private:
+   mutable std::mutex                        m_mutex;
+   bool                                      m_enabled;
+   std::string                               m_error;
+   std::array<bool,ncounters>                m_available;
+   std::vector<thread_entry>                 m_threads;
+   values                                    m_mark;     // total at the end of the previous phase
+   std::vector<std::pair<std::string,values>> m_phases;
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,123 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "phase_timer.h"
+#include "perf_counters.h"
+#include <fstream>
+#include <iomanip>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#include <unistd.h>
+#endif
+
+phase_timer::phase_timer()
+{
+   start();
+}
+
+phase_timer::~phase_timer()
+{}
+
+void phase_timer::start()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_start = boost::posix_time::microsec_clock::universal_time();
+   m_mark  = m_start;
+   m_phases.clear();
+   m_values.clear();
+}
+
+void phase_timer::end_phase(const std::string& name)
+{
+   boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_phases.push_back(std::make_pair(name,1.0E-6*(now - m_mark).total_microseconds()));
+   m_mark = now;
+   perf_counters::singleton().end_phase(name);
+}
+
+void phase_timer::set_value(const std::string& name, double value)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_values.push_back(std::make_pair(name,value));
+}
+
+std::vector<std::pair<std::string,double>> phase_timer::phases() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_phases;
+}
+
+std::vector<std::pair<std::string,double>> phase_timer::values() const
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   return m_values;
+}
+
+size_t phase_timer::peak_rss_kb()
+{
+#ifdef _WIN32
+   // not measured on windows
+   return 0;
+#else
+   struct rusage usage;
+   if(getrusage(RUSAGE_SELF,&usage) != 0) return 0;
+#ifdef __APPLE__
+   // bytes on macOS, kilobytes elsewhere
+   return static_cast<size_t>(usage.ru_maxrss)/1024;
+#else
+   return static_cast<size_t>(usage.ru_maxrss);
+#endif
+#endif
+}
+
+size_t phase_timer::current_rss_kb()
+{
+#ifdef __linux__
+   // second field of statm: resident pages
+   std::ifstream in("/proc/self/statm");
+   size_t size = 0, resident = 0;
+   if(!(in >> size >> resident)) return 0;
+   return resident*static_cast<size_t>(sysconf(_SC_PAGESIZE))/1024;
+#else
+   return 0;
+#endif
+}
+
+void phase_timer::write_json(const std::string& path) const
+{
+   std::ofstream out(path);
+   if(!out.is_open()) throw std::runtime_error("phase_timer: could not write timing " + path);
+
+   boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+   std::lock_guard<std::mutex> lock(m_mutex);
+   out << std::setprecision(9);
+   out << "{" << std::endl;
+   out << "  \"total_sec\": " << 1.0E-6*(now - m_start).total_microseconds() << "," << std::endl;
+   out << "  \"peak_rss_kb\": " << peak_rss_kb() << "," << std::endl;
+   out << "  \"phases\": {";
+   for(size_t i=0; i<m_phases.size(); i++) {
+      out << ((i>0)? ", " : "") << "\"" << m_phases[i].first << "\": " << m_phases[i].second;
+   }
+   out << "}," << std::endl;
+   out << "  \"values\": {";
+   for(size_t i=0; i<m_values.size(); i++) {
+      out << ((i>0)? ", " : "") << "\"" << m_values[i].first << "\": " << m_values[i].second;
+   }
+   out << "}" << std::endl;
+   out << "}" << std::endl;
+}
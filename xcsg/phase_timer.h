@@ -0,0 +1,67 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef PHASE_TIMER_H
+#define PHASE_TIMER_H
+
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+// phase_timer records the wall time of the main phases of a run (parse, csg, triangulate, export)
+// together with a few result values. It is written as JSON with the --timing option,
+// which is what xcsg_bench reads for each run. Compilers running concurrently may record phases at the same time.
+
+class phase_timer {
+public:
+   static phase_timer& singleton()  { static phase_timer instance; return instance;  }
+
+   // start timing, the first phase starts here
+   void start();
+
+   // end the current phase and start the next one
+   void end_phase(const std::string& name);
+
+   // record a named result value, e.g. number of triangles
+   void set_value(const std::string& name, double value);
+
+   // phases and values recorded since start
+   std::vector<std::pair<std::string,double>> phases() const;
+   std::vector<std::pair<std::string,double>> values() const;
+
+   // peak resident set size of the process in kilobytes, 0 if not available
+   static size_t peak_rss_kb();
+
+   // current resident set size of the process in kilobytes, 0 if not available (Linux only)
+   static size_t current_rss_kb();
+
+   // write phases and values as JSON to file path
+   void write_json(const std::string& path) const;
+
+protected:
+   phase_timer();
+   virtual ~phase_timer();
+
+private:
+   mutable std::mutex                           m_mutex;
+   boost::posix_time::ptime                     m_start;
+   boost::posix_time::ptime                     m_mark;
+   std::vector<std::pair<std::string,double>>   m_phases;
+   std::vector<std::pair<std::string,double>>   m_values;
+};
+
+#endif // PHASE_TIMER_H
@@ -14,6 +14,7 @@
 // EndLicense:
 
 #include "polymesh3d.h"
+#include <iterator>
 
 polymesh3d::polymesh3d()
 {}
@@ -26,10 +27,7 @@ polymesh3d::polymesh3d(std::shared_ptr<const polymesh2d> pm2d, const carve::math
 , m_contour(pm2d->contours())
 {
    m_vert.reserve(pm2d->nvertices());
-   for(size_t i=0; i<pm2d->nvertices(); i++) {
-      const dpos2d& v = pm2d->vertex(i);
-      m_vert.push_back(t * carve::geom::VECTOR(v.x(),v.y(),0.0));
-   }
+   transform_vertices(*pm2d,t,std::back_inserter(m_vert));
 }
 
 // return number of vertices
@@ -35,6 +35,17 @@ public:
 
    virtual ~polymesh3d();
 
+   // write the vertices of the 2d mesh transformed into 3d to out, returns the end of the output
+   template <typename OutputIt>
+   static OutputIt transform_vertices(const polymesh2d& pm2d, const carve::math::Matrix& t, OutputIt out)
+   {
+      for(size_t i=0; i<pm2d.nvertices(); i++) {
+         const dpos2d& v = pm2d.vertex(i);
+         *out++ = t * carve::geom::VECTOR(v.x(),v.y(),0.0);
+      }
+      return out;
+   }
+
    // return number of vertices
    size_t nvertices() const;
 
@@ -0,0 +1,379 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "primitive_boolean.h"
+#include "xcube.h"
+#include "xcuboid.h"
+#include "xcylinder.h"
+#include "xsphere.h"
+#include "xbox3d.h"
+#include "extrude_mesh.h"
+#include "geom_kernel.h"
+#include "primitives3d.h"
+#include "clipper_csg/polyset2d.h"
+#include "clipper_csg/tmesh_adapter.h"
+#include "carve/mesh_simplify.hpp"
+#include <algorithm>
+#include <cmath>
+
+static const double pi = 4.0*atan(1.0);
+
+bool primitive_boolean::is_primitive(const xsolid& solid)
+{
+   const xsolid* s = xsolid::unwrap(&solid);
+   return dynamic_cast<const xcube*>(s)
+       || dynamic_cast<const xcuboid*>(s)
+       || dynamic_cast<const xcylinder*>(s)
+       || dynamic_cast<const xsphere*>(s);
+}
+
+primitive_boolean::MeshSet_ptr primitive_boolean::empty_mesh()
+{
+   return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
+}
+
+void primitive_boolean::face_planes(const carve::mesh::MeshSet<3>& mesh, plane_vector& planes)
+{
+   planes.clear();
+   std::vector<xvertex> loop;
+   for(const carve::mesh::Mesh<3>* m : mesh.meshes) {
+      for(const carve::mesh::Face<3>* face : m->faces) {
+
+         // Newell normal and vertex average of the face loop
+         xvertex c = carve::geom::VECTOR(0,0,0);
+         loop.clear();
+         const carve::mesh::Edge<3>* e = face->edge;
+         do {
+            loop.push_back(e->vert->v);
+            c += e->vert->v;
+            e = e->next;
+         } while(e != face->edge);
+         const size_t nv = loop.size();
+         xvertex n;
+         geom_kernel::newell_normal(loop[0].v,nv,n.v);
+
+         double len = n.length();
+         if(!(len > 0.0)) continue;
+
+         plane p;
+         p.normal = n/len;
+         p.d      = carve::geom::dot(p.normal,c/double(nv));
+         planes.push_back(p);
+      }
+   }
+}
+
+bool primitive_boolean::inside(const plane_vector& planes, const carve::mesh::MeshSet<3>& mesh, double tol)
+{
+   for(auto& vertex : mesh.vertex_storage) {
+      for(auto& p : planes) {
+         if(carve::geom::dot(p.normal,vertex.v) - p.d > tol) return false;
+      }
+   }
+   return true;
+}
+
+bool primitive_boolean::outside(const plane_vector& planes, const carve::mesh::MeshSet<3>& mesh, double tol)
+{
+   for(auto& p : planes) {
+      bool separating = true;
+      for(auto& vertex : mesh.vertex_storage) {
+         if(carve::geom::dot(p.normal,vertex.v) - p.d < -tol) { separating = false; break; }
+      }
+      if(separating) return true;
+   }
+   return false;
+}
+
+bool primitive_boolean::box_frame(const xsolid& solid, const carve::math::Matrix& t, box& b, double tol)
+{
+   xvertex edges[3];
+   const xsolid* s = xsolid::unwrap(&solid);
+   if(const xcube* cube = dynamic_cast<const xcube*>(s))            cube->box_frame(t,b.origin,edges);
+   else if(const xcuboid* cuboid = dynamic_cast<const xcuboid*>(s)) cuboid->box_frame(t,b.origin,edges);
+   else return false;
+
+   for(size_t k=0; k<3; k++) {
+      b.len[k] = edges[k].length();
+      if(!(b.len[k] > tol)) return false;
+      b.axis[k] = edges[k]/b.len[k];
+   }
+
+   // sheared boxes are not rectangular
+   const double eps = 1.0E-12;
+   for(size_t k=0; k<3; k++) {
+      if(fabs(carve::geom::dot(b.axis[k],b.axis[(k+1)%3])) > eps) return false;
+   }
+   return true;
+}
+
+primitive_boolean::MeshSet_ptr primitive_boolean::through_holes(const box& a, const std::vector<MeshSet_ptr>& cylinders, double tol)
+{
+   struct hole {
+      std::vector<std::pair<double,double>> pts;  // ring in box face coordinates, CCW
+      double cx,cy,r;
+   };
+   std::vector<hole> holes;
+   int k = -1;
+
+   for(auto& mesh : cylinders) {
+      const size_t nv = mesh->vertex_storage.size();
+      if(nv < 6) return nullptr;
+
+      // vertex coordinates in the box system
+      std::vector<xvertex> q(nv);
+      for(size_t iv=0; iv<nv; iv++) {
+         xvertex d = mesh->vertex_storage[iv].v - a.origin;
+         q[iv] = carve::geom::VECTOR(carve::geom::dot(d,a.axis[0]),carve::geom::dot(d,a.axis[1]),carve::geom::dot(d,a.axis[2]));
+      }
+
+      // the drilling axis is the box axis where the vertices form two rings of equal size
+      int kc = -1;
+      double zmin = 0.0, zmax = 0.0;
+      for(int j=0; j<3 && kc<0; j++) {
+         double lo = q[0][j], hi = q[0][j];
+         for(auto& p : q) { lo = std::min(lo,p[j]); hi = std::max(hi,p[j]); }
+         size_t nlo = 0, nhi = 0;
+         for(auto& p : q) {
+            if(fabs(p[j]-lo) <= tol)      nlo++;
+            else if(fabs(p[j]-hi) <= tol) nhi++;
+         }
+         if(hi-lo > tol && nlo==nhi && nlo+nhi==nv) { kc = j; zmin = lo; zmax = hi; }
+      }
+      if(kc < 0 || (k >= 0 && kc != k)) return nullptr;
+      k = kc;
+
+      // the cylinder must pass through the box
+      if(zmin > tol || zmax < a.len[k]-tol) return nullptr;
+
+      const int i = (k+1)%3;
+      const int j = (k+2)%3;
+      std::vector<std::pair<double,double>> bot,top;
+      for(auto& p : q) {
+         if(fabs(p[k]-zmin) <= tol) bot.push_back(std::make_pair(p[i],p[j]));
+         else                       top.push_back(std::make_pair(p[i],p[j]));
+      }
+
+      hole h;
+      h.cx = 0.0; h.cy = 0.0;
+      for(auto& p : bot) { h.cx += p.first; h.cy += p.second; }
+      h.cx /= bot.size();
+      h.cy /= bot.size();
+
+      // the cylinder caps have a centre vertex, keep the rings only
+      auto remove_centre = [&h](std::vector<std::pair<double,double>>& ring) {
+         double rmax = 0.0;
+         for(auto& p : ring) rmax = std::max(rmax,sqrt(pow(p.first-h.cx,2.0)+pow(p.second-h.cy,2.0)));
+         std::vector<std::pair<double,double>> outer;
+         for(auto& p : ring) if(sqrt(pow(p.first-h.cx,2.0)+pow(p.second-h.cy,2.0)) > 0.5*rmax) outer.push_back(p);
+         ring.swap(outer);
+      };
+      remove_centre(bot);
+      remove_centre(top);
+      if(bot.size() < 3 || bot.size() != top.size()) return nullptr;
+
+      // both rings sorted by angle around the centre must coincide, i.e. the cylinder is a right prism
+      auto by_angle = [&h](const std::pair<double,double>& p1, const std::pair<double,double>& p2) {
+         return atan2(p1.second-h.cy,p1.first-h.cx) < atan2(p2.second-h.cy,p2.first-h.cx);
+      };
+      std::sort(bot.begin(),bot.end(),by_angle);
+      std::sort(top.begin(),top.end(),by_angle);
+      h.r = 0.0;
+      for(size_t iv=0; iv<bot.size(); iv++) {
+         double dx = bot[iv].first - top[iv].first;
+         double dy = bot[iv].second - top[iv].second;
+         if(sqrt(dx*dx+dy*dy) > tol) return nullptr;
+
+         // the hole must be strictly inside the box face
+         if(bot[iv].first <= tol || bot[iv].first >= a.len[i]-tol) return nullptr;
+         if(bot[iv].second <= tol || bot[iv].second >= a.len[j]-tol) return nullptr;
+         h.r = std::max(h.r,sqrt(pow(bot[iv].first-h.cx,2.0)+pow(bot[iv].second-h.cy,2.0)));
+      }
+      h.pts.swap(bot);
+      holes.push_back(h);
+   }
+   if(k < 0) return nullptr;
+
+   // holes must not touch each other
+   for(size_t ih=0; ih<holes.size(); ih++) {
+      for(size_t jh=ih+1; jh<holes.size(); jh++) {
+         double dist = sqrt(pow(holes[ih].cx-holes[jh].cx,2.0)+pow(holes[ih].cy-holes[jh].cy,2.0));
+         if(dist <= holes[ih].r + holes[jh].r + tol) return nullptr;
+      }
+   }
+
+   // the box face with holes as a 2d profile: outer contour CCW, holes CW
+   const int i = (k+1)%3;
+   const int j = (k+2)%3;
+   std::shared_ptr<polygon2d> poly(new polygon2d());
+   poly->reserve(holes.size()+1);
+   std::shared_ptr<contour2d> outer(new contour2d());
+   outer->reserve(4);
+   outer->push_back(dpos2d(0.0,0.0));
+   outer->push_back(dpos2d(a.len[i],0.0));
+   outer->push_back(dpos2d(a.len[i],a.len[j]));
+   outer->push_back(dpos2d(0.0,a.len[j]));
+   poly->push_back(outer);
+   for(auto& h : holes) {
+      std::shared_ptr<contour2d> c(new contour2d());
+      c->reserve(h.pts.size());
+      for(auto ip=h.pts.rbegin(); ip!=h.pts.rend(); ip++) c->push_back(dpos2d(ip->first,ip->second));
+      poly->push_back(c);
+   }
+   std::shared_ptr<polyset2d> pset(new polyset2d());
+   pset->push_back(poly);
+
+   tmesh_adapter tess;
+   tess.tesselate(pset);
+
+   // extrude along the drilling axis in the box system
+   carve::math::Matrix f = carve::math::Matrix::IDENT();
+   for(size_t c=0; c<3; c++) {
+      f.m[0][c] = a.axis[i][c];
+      f.m[1][c] = a.axis[j][c];
+      f.m[2][c] = a.axis[k][c];
+      f.m[3][c] = a.origin[c];
+   }
+   MeshSet_ptr meshset = extrude_mesh::linear_extrude(tess.mesh(),a.len[k],f);
+
+   carve::mesh::MeshSimplifier simplifier;
+   double min_normal_angle=(pi/180.)*1E-4;  // 1E-4 degrees
+   simplifier.mergeCoplanarFaces(meshset.get(),min_normal_angle);
+   return meshset;
+}
+
+primitive_boolean::MeshSet_ptr primitive_boolean::box_intersection(const std::vector<box>& boxes, double tol)
+{
+   const box& b0 = boxes[0];
+   double lo[3] = { 0.0, 0.0, 0.0 };
+   double hi[3] = { b0.len[0], b0.len[1], b0.len[2] };
+
+   const double eps = 1.0E-12;
+   for(size_t ib=1; ib<boxes.size(); ib++) {
+      const box& b = boxes[ib];
+
+      // each edge direction must be parallel to one of the first box
+      for(size_t k=0; k<3; k++) {
+         bool parallel = false;
+         for(size_t j=0; j<3; j++) {
+            if(fabs(fabs(carve::geom::dot(b.axis[k],b0.axis[j]))-1.0) <= eps) parallel = true;
+         }
+         if(!parallel) return nullptr;
+      }
+
+      // extent of the box along the first box axes
+      for(size_t j=0; j<3; j++) {
+         double blo = 0.0, bhi = 0.0;
+         for(size_t corner=0; corner<8; corner++) {
+            xvertex p = b.origin;
+            for(size_t k=0; k<3; k++) if(corner & (1<<k)) p += b.axis[k]*b.len[k];
+            double s = carve::geom::dot(p-b0.origin,b0.axis[j]);
+            blo = (corner==0)? s : std::min(blo,s);
+            bhi = (corner==0)? s : std::max(bhi,s);
+         }
+         lo[j] = std::max(lo[j],blo);
+         hi[j] = std::min(hi[j],bhi);
+      }
+   }
+   for(size_t j=0; j<3; j++) {
+      if(hi[j]-lo[j] <= tol) return empty_mesh();
+   }
+
+   carve::math::Matrix f = carve::math::Matrix::IDENT();
+   xvertex origin = b0.origin + b0.axis[0]*lo[0] + b0.axis[1]*lo[1] + b0.axis[2]*lo[2];
+   for(size_t c=0; c<3; c++) {
+      f.m[0][c] = b0.axis[0][c];
+      f.m[1][c] = b0.axis[1][c];
+      f.m[2][c] = b0.axis[2][c];
+      f.m[3][c] = origin[c];
+   }
+   return primitives3d::make_cuboid(hi[0]-lo[0],hi[1]-lo[1],hi[2]-lo[2],false,false,f)->create_carve_mesh();
+}
+
+primitive_boolean::MeshSet_ptr primitive_boolean::difference(const carve::math::Matrix& t,
+                                                             std::shared_ptr<xsolid> a,
+                                                             const std::vector<std::shared_ptr<xsolid>>& excl,
+                                                             MeshSet_ptr& a_mesh,
+                                                             std::vector<MeshSet_ptr>& excl_meshes)
+{
+   a_mesh = a->create_carve_mesh(t);
+   excl_meshes.clear();
+
+   plane_vector a_planes;
+   face_planes(*a_mesh,a_planes);
+   const double tol = 1.0E-9*xbox3d(*a_mesh).diagonal();
+
+   bool cylinders = true;
+   plane_vector planes;
+   for(auto& e : excl) {
+      MeshSet_ptr mesh = e->create_carve_mesh(t);
+      face_planes(*mesh,planes);
+
+      // nothing is left of a inside an excluded object
+      if(inside(planes,*a_mesh,tol)) return empty_mesh();
+
+      // disjoint objects do not change a
+      if(outside(a_planes,*mesh,tol) || outside(planes,*a_mesh,tol)) continue;
+
+      excl_meshes.push_back(mesh);
+      if(!dynamic_cast<const xcylinder*>(xsolid::unwrap(e.get()))) cylinders = false;
+   }
+   if(excl_meshes.size() == 0) return a_mesh;
+
+   box b;
+   if(cylinders && box_frame(*a,t,b,tol)) {
+      MeshSet_ptr result = through_holes(b,excl_meshes,tol);
+      if(result) return result;
+   }
+   return nullptr;
+}
+
+primitive_boolean::MeshSet_ptr primitive_boolean::intersection(const carve::math::Matrix& t,
+                                                               const std::vector<std::shared_ptr<xsolid>>& objects,
+                                                               std::vector<MeshSet_ptr>& meshes)
+{
+   const size_t n = objects.size();
+   meshes.resize(n);
+   std::vector<plane_vector> planes(n);
+   double tol = 0.0;
+   for(size_t i=0; i<n; i++) {
+      meshes[i] = objects[i]->create_carve_mesh(t);
+      face_planes(*meshes[i],planes[i]);
+      tol = std::max(tol,1.0E-9*xbox3d(*meshes[i]).diagonal());
+   }
+
+   // any disjoint pair makes the intersection empty
+   for(size_t i=0; i<n; i++) {
+      for(size_t j=i+1; j<n; j++) {
+         if(outside(planes[i],*meshes[j],tol) || outside(planes[j],*meshes[i],tol)) return empty_mesh();
+      }
+   }
+
+   // an object inside all the others is the intersection
+   for(size_t i=0; i<n; i++) {
+      bool contained = true;
+      for(size_t j=0; j<n && contained; j++) {
+         if(j != i) contained = inside(planes[j],*meshes[i],tol);
+      }
+      if(contained) return meshes[i];
+   }
+
+   std::vector<box> boxes(n);
+   for(size_t i=0; i<n; i++) {
+      if(!box_frame(*objects[i],t,boxes[i],tol)) return nullptr;
+   }
+   return box_intersection(boxes,tol);
+}
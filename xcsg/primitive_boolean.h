@@ -0,0 +1,89 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef PRIMITIVE_BOOLEAN_H
+#define PRIMITIVE_BOOLEAN_H
+
+#include <memory>
+#include <vector>
+#include <carve/csg.hpp>
+#include "xsolid.h"
+
+// primitive_boolean resolves booleans between convex primitives (cube, cuboid, cylinder, sphere)
+// without carve where the result follows from the geometry alone:
+//  - disjoint objects are dropped, or give an empty intersection
+//  - an object contained in the other gives the result directly
+//  - cylinders drilled straight through a cube/cuboid are built as a linear extrusion of the box face with holes
+//  - intersections of boxes with parallel edges are a box
+// The primitive meshes are convex, so containment and separation are tested exactly on the meshes.
+
+class primitive_boolean {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   // true if the solid is one of the convex primitives handled here
+   static bool is_primitive(const xsolid& solid);
+
+   // a - union(excl) for primitives transformed by t. Returns the result if resolved, otherwise nullptr.
+   // On return a_mesh is the mesh of a and excl_meshes the meshes of the excl objects still overlapping a
+   static MeshSet_ptr difference(const carve::math::Matrix& t,
+                                 std::shared_ptr<xsolid> a,
+                                 const std::vector<std::shared_ptr<xsolid>>& excl,
+                                 MeshSet_ptr& a_mesh,
+                                 std::vector<MeshSet_ptr>& excl_meshes);
+
+   // intersection of primitives transformed by t. Returns the result if resolved, otherwise nullptr.
+   // On return meshes contains the meshes of the objects
+   static MeshSet_ptr intersection(const carve::math::Matrix& t,
+                                   const std::vector<std::shared_ptr<xsolid>>& objects,
+                                   std::vector<MeshSet_ptr>& meshes);
+
+   // the empty mesh
+   static MeshSet_ptr empty_mesh();
+
+protected:
+   struct plane {
+      xvertex normal;   // outward unit normal
+      double  d;        // normal*x = d on the plane
+   };
+   typedef std::vector<plane> plane_vector;
+
+   struct box {
+      xvertex origin;   // minimum corner
+      xvertex axis[3];  // unit edge directions
+      double  len[3];   // edge lengths
+   };
+
+   // face planes of a convex mesh
+   static void face_planes(const carve::mesh::MeshSet<3>& mesh, plane_vector& planes);
+
+   // true if all vertices of mesh are inside the planes within tol
+   static bool inside(const plane_vector& planes, const carve::mesh::MeshSet<3>& mesh, double tol);
+
+   // true if one of the planes has all vertices of mesh on its outside within tol
+   static bool outside(const plane_vector& planes, const carve::mesh::MeshSet<3>& mesh, double tol);
+
+   // box description of a cube or cuboid transformed by t, false if the box is not rectangular
+   static bool box_frame(const xsolid& solid, const carve::math::Matrix& t, box& b, double tol);
+
+   // a minus cylinders drilled through it parallel to one of its edges, nullptr if the cylinders do not qualify
+   static MeshSet_ptr through_holes(const box& a, const std::vector<MeshSet_ptr>& cylinders, double tol);
+
+   // intersection of boxes with parallel edges, nullptr if the edges are not parallel
+   static MeshSet_ptr box_intersection(const std::vector<box>& boxes, double tol);
+};
+
+#endif // PRIMITIVE_BOOLEAN_H
@@ -0,0 +1,77 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "primitive_cache.h"
+#include "mesh_utils.h"
+#include <sstream>
+#include <iomanip>
+#include <limits>
+#include <vector>
+
+primitive_cache::primitive_cache()
+{}
+
+primitive_cache::~primitive_cache()
+{}
+
+std::string primitive_cache::make_key(const std::string& type, std::initializer_list<double> params, bool curved)
+{
+   std::ostringstream out;
+   out << std::setprecision(std::numeric_limits<double>::max_digits10) << type;
+   for(double p : params) out << ' ' << p;
+   if(curved) {
+      out << " tol=" << mesh_utils::secant_tolerance();
+      if(mesh_utils::preview_tolerance() > 0.0) out << " preview=" << mesh_utils::preview_tolerance();
+   }
+   return out.str();
+}
+
+std::shared_ptr<xpolyhedron> primitive_cache::get(const std::string& key, factory create_untransformed, const carve::math::Matrix& t)
+{
+   std::shared_ptr<const xpolyhedron> poly;
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      auto it = m_cache.find(key);
+      if(it != m_cache.end()) poly = it->second;
+   }
+
+   if(!poly) {
+      // create outside the lock, if another thread got there first we use its copy
+      std::shared_ptr<const xpolyhedron> created = create_untransformed();
+      std::lock_guard<std::mutex> lock(m_mutex);
+      poly = m_cache.insert(std::make_pair(key,created)).first->second;
+   }
+
+   return transformed_copy(*poly,t);
+}
+
+void primitive_cache::clear()
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_cache.clear();
+}
+
+std::shared_ptr<xpolyhedron> primitive_cache::transformed_copy(const xpolyhedron& poly, const carve::math::Matrix& t)
+{
+   // a left handed transform turns the faces inside out, so they must be reversed
+   bool reverse_face = mesh_utils::is_left_hand(t);
+
+   // the flat vertex and face arrays are copied as a whole and modified in place
+   std::shared_ptr<xpolyhedron> copy(new xpolyhedron(poly));
+   xvertex* points = copy->v_range(0,copy->v_size());
+   mesh_utils::transform_points(t,copy->v_size(),points);
+   if(reverse_face) copy->f_reverse();
+   return copy;
+}
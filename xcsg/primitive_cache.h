@@ -0,0 +1,60 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef PRIMITIVE_CACHE_H
+#define PRIMITIVE_CACHE_H
+
+#include <functional>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "xpolyhedron.h"
+
+// primitive_cache keeps one untransformed polyhedron per primitive type and parameter set,
+// so that identical primitives differing only in their transformation are meshed once.
+// The key includes the secant tolerance, which controls the number of segments, except for
+// primitives without curved surfaces. Those are shared by compilations at different tolerances.
+
+class primitive_cache {
+public:
+   typedef std::function<std::shared_ptr<xpolyhedron>()> factory;
+
+   static primitive_cache& singleton()  { static primitive_cache instance; return instance;  }
+
+   // create a cache key from primitive type and parameters. curved is false for primitives not depending on the tolerance
+   static std::string make_key(const std::string& type, std::initializer_list<double> params, bool curved = true);
+
+   // return a copy of the cached primitive transformed by t.
+   // create_untransformed is called to create the primitive when not yet cached
+   std::shared_ptr<xpolyhedron> get(const std::string& key, factory create_untransformed, const carve::math::Matrix& t);
+
+   // remove all cached primitives
+   void clear();
+
+protected:
+   primitive_cache();
+   virtual ~primitive_cache();
+
+   // create a transformed copy of poly
+   static std::shared_ptr<xpolyhedron> transformed_copy(const xpolyhedron& poly, const carve::math::Matrix& t);
+
+private:
+   std::mutex                                                 m_mutex;
+   std::map<std::string,std::shared_ptr<const xpolyhedron>>   m_cache;
+};
+
+#endif // PRIMITIVE_CACHE_H
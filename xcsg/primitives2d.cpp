@@ -15,6 +15,8 @@
 
 #include "primitives2d.h"
 #include "mesh_utils.h"
+#include <algorithm>
+#include <cmath>
 
 static const double pi = 4.0*atan(1.0);
 
@@ -25,16 +27,37 @@ primitives2d::~primitives2d()
 {}
 
 
+int primitives2d::circle_segments(double r)
+{
+   // the secant deviation r*(1-cos(pi/nseg)) must not exceed the tolerance
+   r = fabs(r);
+   double tol = mesh_utils::secant_tolerance(r);
+   if(r <= 0.0 || tol >= r) return 4;
+   double n = ceil(pi/acos(1.0-tol/r));
+   if(n > 1.0e6) n = 1.0e6;
+   int nseg = std::max(4,static_cast<int>(n));
+   if(nseg%2 != 0) nseg++;
+
+   // ceil may be one too high when pi/acos is an exact integer in theory
+   if(nseg > 4 && r*(1.0-cos(pi/(nseg-2))) <= tol) nseg -= 2;
+   return nseg;
+}
+
+double primitives2d::max_scale(const carve::math::Matrix& t)
+{
+   // the columns of the 2x2 xy part, the largest singular value is the largest scale
+   xvertex o = t * carve::geom::VECTOR(0.0,0.0,0.0);
+   xvertex u = t * carve::geom::VECTOR(1.0,0.0,0.0) - o;
+   xvertex v = t * carve::geom::VECTOR(0.0,1.0,0.0) - o;
+   double e   = u.x*u.x + u.y*u.y + v.x*v.x + v.y*v.y;
+   double det = u.x*v.y - u.y*v.x;
+   return sqrt(0.5*(e + sqrt(std::max(0.0,e*e - 4.0*det*det))));
+}
+
 std::shared_ptr<polygon2d> primitives2d::make_circle(double r, int nseg, const carve::math::Matrix& t)
 {
-   if(nseg < 0) {
-      nseg = 4;
-      double alpha = 2.0*pi/nseg;
-      while(r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance()) {
-         nseg += 2;
-         alpha = 2*pi/nseg;
-      }
-   }
+   // segments are chosen from the radius as it appears in the result
+   if(nseg < 0) nseg = circle_segments(r*max_scale(t));
    double dang = 2*pi/nseg;
 
    std::shared_ptr<polygon2d> polygon(new polygon2d());
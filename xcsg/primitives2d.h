@@ -24,9 +24,16 @@ public:
    primitives2d();
    virtual ~primitives2d();
 
-   // circle
+   // circle. With nseg < 0 the number of segments is chosen from the radius after transformation by t,
+   // so the secant tolerance is met for scaled circles too
    static std::shared_ptr<polygon2d> make_circle(double r, int nseg, const carve::math::Matrix& t = carve::math::Matrix());
 
+   // smallest even number of segments, at least 4, for which a circle of radius r meets the secant tolerance
+   static int circle_segments(double r);
+
+   // largest scale factor of the transformation t in the xy plane, as seen after projection to z=0
+   static double max_scale(const carve::math::Matrix& t);
+
    // rectangle and square
    static std::shared_ptr<polygon2d> make_rectangle(double dx, double dy, bool center, const carve::math::Matrix& t = carve::math::Matrix());
 
@@ -15,6 +15,7 @@
 
 #include "primitives3d.h"
 #include "geodesic_sphere.h"
+#include <algorithm>
 using namespace std;
 
 static const double pi = 4.0*atan(1.0);
@@ -37,20 +38,23 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cuboid(double dx, double dy, do
    bool reverse_face = mesh_utils::is_left_hand(tloc);
 
    std::shared_ptr<xpolyhedron> poly(new xpolyhedron());
+   poly->set_trusted(true);
    poly->v_reserve(8);
    poly->f_reserve(6);
 
    // bottom
-   poly->v_add(tloc * carve::geom::VECTOR( 0.0,  0.0,  0.0));
-   poly->v_add(tloc * carve::geom::VECTOR( +dx,  0.0,  0.0));
-   poly->v_add(tloc * carve::geom::VECTOR( +dx,  +dy,  0.0));
-   poly->v_add(tloc * carve::geom::VECTOR( 0.0,  +dy,  0.0));
+   poly->v_add(carve::geom::VECTOR( 0.0,  0.0,  0.0));
+   poly->v_add(carve::geom::VECTOR( +dx,  0.0,  0.0));
+   poly->v_add(carve::geom::VECTOR( +dx,  +dy,  0.0));
+   poly->v_add(carve::geom::VECTOR( 0.0,  +dy,  0.0));
 
    // top
-   poly->v_add(tloc * carve::geom::VECTOR( 0.0,  0.0,  +dz));
-   poly->v_add(tloc * carve::geom::VECTOR( +dx,  0.0,  +dz));
-   poly->v_add(tloc * carve::geom::VECTOR( +dx,  +dy,  +dz));
-   poly->v_add(tloc * carve::geom::VECTOR( 0.0,  +dy,  +dz));
+   poly->v_add(carve::geom::VECTOR( 0.0,  0.0,  +dz));
+   poly->v_add(carve::geom::VECTOR( +dx,  0.0,  +dz));
+   poly->v_add(carve::geom::VECTOR( +dx,  +dy,  +dz));
+   poly->v_add(carve::geom::VECTOR( 0.0,  +dy,  +dz));
+
+   mesh_utils::transform_points(tloc,poly->v_size(),poly->v_range(0,poly->v_size()));
 
    // sides
    poly->f_add( xface(0, 1, 5, 4),reverse_face );
@@ -73,7 +77,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cone(double r1, double r2, doub
       double r = (r1 > r2)? r1 : r2;
       nseg = 12;
       double alpha = 2.0*pi/nseg;
-      while(r*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance()) {
+      while(r*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance(r)) {
          nseg += 2;
          alpha = 2*pi/nseg;
       }
@@ -99,13 +103,14 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cone(double r1, double r2, doub
    double dang = 2*pi/nseg;
 
    std::shared_ptr<xpolyhedron> poly(new xpolyhedron());
+   poly->set_trusted(true);
    poly->v_reserve(nvert);
    poly->f_reserve(nface);
 
    // vertices and faces at top & bottom
    for(size_t iz=0; iz<2; iz++) {
       // first vertex v0 is at center
-      size_t v0 = poly->v_add(t * carve::geom::VECTOR(0.0,0.0,z[iz]));
+      size_t v0 = poly->v_add(carve::geom::VECTOR(0.0,0.0,z[iz]));
 
       // then along circumfecence
       double r  = radius[iz];
@@ -113,7 +118,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cone(double r1, double r2, doub
       for(size_t ivc=0; ivc<nvc; ivc++) {
          double x = r*cos(ang);
          double y = r*sin(ang);
-         size_t v1 = poly->v_add(t * carve::geom::VECTOR(x,y,z[iz]));
+         size_t v1 = poly->v_add(carve::geom::VECTOR(x,y,z[iz]));
          size_t v2 = (ivc==(nvc-1))? v0+1:v1+1;
 
          // reverse bottom faces
@@ -124,6 +129,8 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_cone(double r1, double r2, doub
       }
    }
 
+   mesh_utils::transform_points(t,poly->v_size(),poly->v_range(0,poly->v_size()));
+
    // side faces
    size_t vb0 = 1;
    for(size_t ivc=0; ivc<nvc; ivc++) {
@@ -144,7 +151,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_sphere(double r, int nseg, cons
    if(nseg < 0) {
       nseg = 4;
       double alpha = 2.0*pi/nseg;
-      while(r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance()) {
+      while(r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance(r)) {
          nseg += 2;
          alpha = 2*pi/nseg;
       }
@@ -165,11 +172,12 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_sphere(double r, int nseg, cons
    size_t nface = nlong*(nlat+1)*2;
 
    std::shared_ptr<xpolyhedron>  poly(new xpolyhedron());
+   poly->set_trusted(true);
    poly->v_reserve(nvert);
    poly->f_reserve(nface);
 
    // first vertex v0 is at south pole
-   poly->v_add(t * carve::geom::VECTOR(0.0,0.0,-r));
+   poly->v_add(carve::geom::VECTOR(0.0,0.0,-r));
 
    double ang_lat = -0.5*pi + dang;
    while(ang_lat < 0.5*pi) {
@@ -182,7 +190,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_sphere(double r, int nseg, cons
          double ang_lon = ilong*dang;
          double x = r*cos(ang_lat)*cos(ang_lon);
          double y = r*cos(ang_lat)*sin(ang_lon);
-         size_t v0 = poly->v_add(t * carve::geom::VECTOR(x,y,z));
+         size_t v0 = poly->v_add(carve::geom::VECTOR(x,y,z));
 
          if(ang_lat+dang < 0.5*pi) {
             // add faces only as lomg as there wil be another vertex row
@@ -196,7 +204,9 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_sphere(double r, int nseg, cons
    }
 
    // last vertex is at north pole
-   size_t vnp =  poly->v_add(t * carve::geom::VECTOR(0.0,0.0,r));
+   size_t vnp =  poly->v_add(carve::geom::VECTOR(0.0,0.0,r));
+
+   mesh_utils::transform_points(t,poly->v_size(),poly->v_range(0,poly->v_size()));
 
    // pole faces
    for(size_t ilong=0; ilong<nlong; ilong++) {
@@ -227,7 +237,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_geodesic_sphere(double r, int n
    if(nseg < 0) {
       nseg = 6;
       double alpha = 2.0*pi/nseg;
-      while(1.1*r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance()) {
+      while(1.1*r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance(r)) {
          nseg *= 2;
          alpha = 2*pi/nseg;
       }
@@ -243,20 +253,26 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_geodesic_sphere(double r, int n
    if(nseg > 192)idepth = 5;
 
 
-   geodesic_sphere gsphere(idepth);
+   // the unit sphere template is shared, so only the copy and transform is done per sphere
+   const geodesic_sphere& gsphere = geodesic_sphere::unit(idepth);
 
    size_t nvert = gsphere.v_size();
    size_t nface = gsphere.f_size();
 
    std::shared_ptr<xpolyhedron>  poly(new xpolyhedron());
-   poly->v_reserve(nvert);
-   poly->f_reserve(nface);
+   poly->set_trusted(true);
+   poly->v_resize(nvert);
+   poly->f_resize(nface);
+
+   xvertex* vert = poly->v_range(0,nvert);
+   std::copy(gsphere.v_data(),gsphere.v_data()+nvert,vert);
+   mesh_utils::transform_points(tloc,nvert,vert);
 
-   for(size_t ivert=0;ivert<nvert; ivert++) {
-      poly->v_add(tloc* gsphere.v_get(ivert));
-   }
    for(size_t iface=0;iface<nface; iface++) {
-      poly->f_add(gsphere.f_get(iface),reverse_face);
+      const size_t* tri = gsphere.f_get(iface);
+      size_t* face = poly->f_range(iface);
+      if(reverse_face) std::reverse_copy(tri,tri+3,face);
+      else             std::copy(tri,tri+3,face);
    }
 
    return poly;
@@ -265,6 +281,7 @@ std::shared_ptr<xpolyhedron>  primitives3d::make_geodesic_sphere(double r, int n
 std::shared_ptr<xpolyhedron> primitives3d::make_polygon(const std::vector<xvertex>& vertices, double dz, const carve::math::Matrix& t)
 {
    std::shared_ptr<xpolyhedron>  poly(new xpolyhedron());
+   poly->set_trusted(true);
 
    bool reverse_face = mesh_utils::is_left_hand(t);
 
@@ -277,9 +294,10 @@ std::shared_ptr<xpolyhedron> primitives3d::make_polygon(const std::vector<xverte
    for(size_t i=0; i<2; i++) {
       for(size_t iv=0; iv<nvert; iv++) {
          xvertex vert = (i==0)? vertices[iv] : vertices[iv] + carve::geom::VECTOR(0.0,0.0,dz);
-         poly->v_add(t * vert);
+         poly->v_add(vert);
       }
    }
+   mesh_utils::transform_points(t,poly->v_size(),poly->v_range(0,poly->v_size()));
 
    // top & bottom faces mentions all vertices in their relative layers, but in opposite orders
    std::vector<size_t> ind_bot(nvert);
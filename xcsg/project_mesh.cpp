@@ -13,182 +13,199 @@
 // A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
 // EndLicense:
 
-// include xshape2d so that xvertex is defines
-#include "xshape2d.h"
-
 #include "project_mesh.h"
-#include "primitives2d.h"
-
-#include <carve/poly.hpp>
-#include "carve_boolean.h"
-#include "carve_triangulate.h"
-
-#include "clipper_boolean.h"
-#include "xpolyhedron.h"
-
+#include "thread_pool.h"
+#include "trace_recorder.h"
+#include "message_log.h"
+#include <algorithm>
+#include <cmath>
 #include <iostream>
-using namespace std;
-
-std::shared_ptr<clipper_profile> project_mesh::project(std::shared_ptr<carve::mesh::MeshSet<3>> meshset)
-{
-   clipper_boolean csg_clipper;
-
-   carve_boolean csg_carve;
-   csg_carve.compute(meshset,carve::csg::CSG::OP::UNION);
-   size_t nmani = csg_carve.size();
+#include <unordered_map>
 
-   size_t npoly = 0;
-
-   // The mesh may contain non-triangular faces, so we must triangulate into polyhedra
-   for(size_t imani=0; imani<nmani; imani++) {
-
-      cout << "manifold " << imani << " of " << nmani << endl;
-
-      // create polyset with triangles from manifold
-      carve_triangulate triangulate;
-      std::shared_ptr<xpolyhedron> poly = csg_carve.create_manifold(imani);
-
-      size_t num_non_tri = 0;
-      poly->check_polyhedron(cout,num_non_tri);
-
-      if(num_non_tri > 0) {
-         cout << "...Triangulating lump ... " << std::endl;
-         cout << "...Triangulation completed with " << triangulate.compute2d(poly->create_carve_polyhedron())<< " triangle faces " << endl;;
-      }
-      else {
-         // triangulation not required
-         triangulate.add(poly->create_carve_polyhedron());
-      }
+project_mesh::projection_strategy project_mesh::m_strategy = project_mesh::projection_silhouette;
 
-      cout << "...Computing projection" << std::endl;
-
-      // extract triangle faces
-      std::shared_ptr<carve_triangulate::poly_vector>  polyset = triangulate.carve_polyset();
-      for(size_t ipoly=0; ipoly<polyset->size(); ipoly++) {
-
-         std::shared_ptr<carve::poly::Polyhedron> poly = (*polyset)[ipoly];
-         std::vector<carve::poly::Geometry<3>::vertex_t>& vertices = poly->vertices;
-
-         for(size_t iface = 0; iface<poly->faces.size(); ++iface) {
-
-            // coordinates of face to be stored in this vector
-            std::vector<xvertex> face_coords;
+ClipperLib::Paths project_mesh::union_paths(const std::vector<ClipperLib::Paths>& paths, size_t begin, size_t end)
+{
+   ClipperLib::Clipper clipper;
+   for(size_t i=begin; i<end; i++) clipper.AddPaths(paths[i],ClipperLib::ptSubject,true);
+   ClipperLib::Paths result;
+   if(!clipper.Execute(ClipperLib::ctUnion,result,ClipperLib::pftNonZero,ClipperLib::pftNonZero)) {
+      throw std::logic_error("project_mesh::project, union failed");
+   }
+   return result;
+}
 
-            carve::poly::Face<3>& face = poly->faces[iface];
-            size_t nvert = face.nVertices();
-            std::vector<const carve::poly::Polyhedron::vertex_t *> vloop;
-            face.getVertexLoop(vloop);
-            for(size_t ivert=0; ivert<nvert; ivert++) {
-               size_t index = poly->vertexToIndex(vloop[ivert]);
-               carve::poly::Geometry<3>::vertex_t& vertex = vertices[index];
-               face_coords.push_back(vertex.v);
-            }
+std::shared_ptr<clipper_profile> project_mesh::make_profile(ClipperLib::Paths& paths)
+{
+   std::shared_ptr<clipper_profile> profile = std::make_shared<clipper_profile>();
+   profile->paths().swap(paths);
+   ClipperLib::CleanPolygons(profile->paths());
 
-            // we now have the triangle face coordinates.
-            std::shared_ptr<polygon2d> polygon = primitives2d::make_polygon(face_coords);
+   // make sure paths are sorted with positive path first
+   profile->sort();
+   return profile;
+}
 
-            // here, there is always just a single contour
-            std::shared_ptr<contour2d> cont = polygon->get_contour(0);
+std::shared_ptr<clipper_profile> project_mesh::project(std::shared_ptr<carve::mesh::MeshSet<3>> meshset)
+{
+   trace_recorder::span span("project_mesh::project");
 
-            // skip any triangles with zero area, i.e. face was perpendicular to XY plane.
-            // we also consider only triangles with positive winding order. The ones with negative winding
-            // are always hidden by those with positive winding order (CCW) and can safely be ignored
-            double signed_area = cont->signed_area();
-            if(signed_area > 0.0) {
+   if(m_strategy == projection_silhouette) {
+      if(std::shared_ptr<clipper_profile> profile = project_silhouette(meshset)) return profile;
+      message_log::info() << "...Silhouette edges do not form closed loops, projecting faces";
+   }
+   return project_faces(meshset);
+}
 
-               // turn triangle into a clipper profile and add its paths to the projection (a single path)
-               std::shared_ptr<clipper_profile> poly_prof = std::make_shared<clipper_profile>();
-               poly_prof->AddPaths(polygon->paths());
-               csg_clipper.compute(poly_prof,ClipperLib::ctUnion);
+bool project_mesh::silhouette_loops(carve::mesh::Mesh<3>* mesh, ClipperLib::Paths& loops)
+{
+   typedef carve::mesh::Face<3>   face_t;
+   typedef carve::mesh::Edge<3>   edge_t;
+   typedef carve::mesh::Vertex<3> vertex_t;
+
+   // a face is seen from above if its projection has positive area
+   auto seen_from_above = [](const face_t* face) {
+      double area2 = 0.0;
+      const edge_t* e = face->edge;
+      do {
+         const carve::geom3d::Vector& p1 = e->vert->v;
+         const carve::geom3d::Vector& p2 = e->next->vert->v;
+         area2 += p1.x*p2.y - p2.x*p1.y;
+         e = e->next;
+      } while(e != face->edge);
+      return area2 > 0.0;
+   };
+
+   // silhouette edges, an edge without opposite edge is on the border of an open mesh
+   std::vector<edge_t*> edges;
+   for(face_t* face : mesh->faces) {
+      if(!seen_from_above(face)) continue;
+      edge_t* e = face->edge;
+      do {
+         if(!e->rev || !seen_from_above(e->rev->face)) edges.push_back(e);
+         e = e->next;
+      } while(e != face->edge);
+   }
 
-               npoly++;
-            }
-         }
+   // chain the edges into loops. Every vertex has as many silhouette edges in as out,
+   // so any way of chaining them gives the same winding numbers
+   std::unordered_map<const vertex_t*,std::vector<size_t>> outgoing;
+   for(size_t i=0; i<edges.size(); i++) outgoing[edges[i]->vert].push_back(i);
+
+   std::vector<bool> used(edges.size(),false);
+   for(size_t first=0; first<edges.size(); first++) {
+      if(used[first]) continue;
+
+      ClipperLib::Path loop;
+      const vertex_t* start = edges[first]->vert;
+      size_t iedge = first;
+      while(true) {
+         used[iedge] = true;
+         const carve::geom3d::Vector& v = edges[iedge]->vert->v;
+         loop.push_back(ClipperLib::IntPoint(ClipperLib::cInt(std::llround(v.x*TO_CLIPPER)),ClipperLib::cInt(std::llround(v.y*TO_CLIPPER))));
+
+         const vertex_t* end = edges[iedge]->next->vert;
+         if(end == start) break;
+
+         std::vector<size_t>& out = outgoing[end];
+         while(out.size() > 0 && used[out.back()]) out.pop_back();
+         if(out.size() == 0) return false;
+         iedge = out.back();
+         out.pop_back();
       }
+      loops.push_back(loop);
    }
-
-   cout << "...Projection computed from " << npoly << " triangles." << endl;
-
-   // make sure paths are sorted with positive path first
-   csg_clipper.sort();
-
-   // return completed projection profile
-   return csg_clipper.profile();
-
+   return true;
 }
 
-/*
-std::shared_ptr<clipper_profile> project_mesh::project(std::shared_ptr<carve::mesh::MeshSet<3>> meshset)
+std::shared_ptr<clipper_profile> project_mesh::project_silhouette(std::shared_ptr<carve::mesh::MeshSet<3>> meshset)
 {
+   // the meshes are independent, their loops are found in parallel
    size_t nmesh = meshset->meshes.size();
-
-   // vertices are shared between the meshes in the mesh set
-   // const std::vector<carve::mesh::MeshSet<3>::vertex_t>& vertex_storage = meshset->vertex_storage;
-
-   clipper_boolean csg;
-
-   // traverse meshes in mesh set
+   std::vector<ClipperLib::Paths> loops(nmesh);
+   std::vector<char> closed(nmesh,0);
+   thread_pool::task_group group;
    for(size_t imesh=0; imesh<nmesh; imesh++) {
+      thread_pool::singleton().submit(group,[&meshset,&loops,&closed,imesh]() {
+         closed[imesh] = silhouette_loops(meshset->meshes[imesh],loops[imesh]);
+      });
+   }
+   thread_pool::singleton().wait(group);
+   if(std::find(closed.begin(),closed.end(),0) != closed.end()) return std::shared_ptr<clipper_profile>();
+
+   size_t nloops = 0;
+   for(auto& l : loops) nloops += l.size();
+   ClipperLib::Paths result = union_paths(loops,0,loops.size());
+   message_log::info() << "...Projection computed from " << nloops << " silhouette loops.";
+   return make_profile(result);
+}
 
-      carve::mesh::Mesh<3>* mesh = meshset->meshes[imesh];
-
-      // traverse faces of this mesh and convert them into polygon2d
+std::shared_ptr<clipper_profile> project_mesh::project_faces(std::shared_ptr<carve::mesh::MeshSet<3>> meshset)
+{
+   // a batch is a range of faces in one mesh
+   struct batch {
+      carve::mesh::Mesh<3>* mesh;
+      size_t                begin;
+      size_t                end;
+   };
+   std::vector<batch> batches;
+   for(carve::mesh::Mesh<3>* mesh : meshset->meshes) {
       size_t nfaces = mesh->faces.size();
-      for (size_t iface=0; iface<nfaces; iface++) {
-
-         // coordinates of face to be stored in this vector
-         std::vector<xvertex> face_coords;
-         face_coords.reserve(24);  // triangular faces mostly
+      for(size_t begin=0; begin<nfaces; begin+=batch_faces) {
+         batches.push_back({mesh,begin,std::min(nfaces,begin+batch_faces)});
+      }
+   }
 
-         // traverse face vertices and extract vertex coordinates
-         carve::mesh::Face<3>* face = mesh->faces[iface];
+   // project and union the batches. A face is a planar simple polygon, so its
+   // projection is a simple polygon too and needs no triangulation
+   std::vector<ClipperLib::Paths> results(batches.size());
+   std::vector<size_t> nprojected(batches.size(),0);
+   thread_pool::task_group group;
+   for(size_t ibatch=0; ibatch<batches.size(); ibatch++) {
+      thread_pool::singleton().submit(group,[&batches,&results,&nprojected,ibatch]() {
+         const batch& b = batches[ibatch];
+         std::vector<ClipperLib::Paths> paths(1);
+         paths[0].reserve(b.end - b.begin);
          std::vector<carve::mesh::Face<3>::vertex_t*> verts;
-         face->getVertices(verts);
-         set<carve::mesh::Vertex<3>*> vseen;
-         carve::mesh::Face<3>::vertex_t* vprev=0;
-         for(size_t i=0;i<verts.size();i++) {
-            carve::mesh::Face<3>::vertex_t* vertex = verts[i];
-
-            cout << " face " << iface << " vertex " << i << " " << vertex
-                             << " " << vertex->v[0] << " " << vertex->v[1] << " " << vertex->v[2]
-                             << endl;
-
-            if(vseen.find(vertex) == vseen.end()) {
-               face_coords.push_back(vertex->v);
-               vseen.insert(vertex);
+         ClipperLib::Path path;
+         for(size_t iface=b.begin; iface<b.end; iface++) {
+            b.mesh->faces[iface]->getVertices(verts);
+            path.resize(verts.size());
+            for(size_t i=0; i<verts.size(); i++) {
+               const carve::geom3d::Vector& v = verts[i]->v;
+               path[i] = ClipperLib::IntPoint(ClipperLib::cInt(std::llround(v.x*TO_CLIPPER)),ClipperLib::cInt(std::llround(v.y*TO_CLIPPER)));
             }
-            else {
-            //   cout << " face " << iface << " dup vertex " << i << " of " << verts.size()  << " " << vertex << endl;
-            }
-            vprev = vertex;
-         }
-
-         // create 2d polygon
-         // This causes z coordinate to be dropped, i.e. projection to XY plane
-         std::shared_ptr<polygon2d> poly = primitives2d::make_polygon(face_coords);
-         std::shared_ptr<contour2d> cont = poly->get_contour(0);
-
-         // skip any polygons with zero area, i.e. face was perpendicular to XY plane
-         double signed_area = cont->signed_area();
 
-         if(fabs(signed_area) > 0.0) {
-
-            // make sure winding order is CCW
-            if(signed_area < 0.0) cont->reverse();
-
-            // turn polygon into a clipper profile and add its paths to the projection using clipper
-            std::shared_ptr<clipper_profile> poly_prof = std::make_shared<clipper_profile>();
-            poly_prof->AddPaths(poly->paths());
-            csg.compute(poly_prof,ClipperLib::ctUnion);
+            // faces with negative or zero area are seen from below or edge-on
+            if(ClipperLib::Area(path) > 0.0) paths[0].push_back(path);
          }
+         nprojected[ibatch] = paths[0].size();
+         results[ibatch]    = union_paths(paths,0,1);
+      });
+   }
+   thread_pool::singleton().wait(group);
+
+   size_t npoly = 0;
+   for(size_t n : nprojected) npoly += n;
+
+   // merge the batch results level by level
+   while(results.size() > 1) {
+      size_t nmerged = (results.size() + merge_fan_in - 1)/merge_fan_in;
+      std::vector<ClipperLib::Paths> merged(nmerged);
+      thread_pool::task_group merge_group;
+      for(size_t imerged=0; imerged<nmerged; imerged++) {
+         thread_pool::singleton().submit(merge_group,[&results,&merged,imerged]() {
+            size_t begin = imerged*merge_fan_in;
+            merged[imerged] = union_paths(results,begin,std::min(results.size(),begin+merge_fan_in));
+         });
       }
+      thread_pool::singleton().wait(merge_group);
+      results.swap(merged);
    }
 
-   // make sure paths are sorted with positive path first
-   csg.sort();
+   message_log::info() << "...Projection computed from " << npoly << " faces.";
 
-   // return completed projection profile
-   return csg.profile();
+   ClipperLib::Paths result;
+   if(results.size() > 0) result.swap(results[0]);
+   return make_profile(result);
 }
-
-*/
@@ -17,14 +17,56 @@
 #ifndef PROJECT_MESH_H
 #define PROJECT_MESH_H
 
+#include <vector>
 #include <carve/mesh.hpp>
 #include "clipper_csg/clipper_profile.h"
 
-// project 3d to 2d
+// project 3d to 2d. The projection is the silhouette of the mesh seen along Z.
+//
+// projection_silhouette: the outline of a closed mesh is made of its silhouette edges, where a
+// face seen from above meets one that is not. These edges, oriented as in the faces seen from
+// above, are chained into loops whose winding number counts the faces covering a point, so a
+// single Clipper union with the non-zero fill rule gives the projection. If the edges do not form
+// closed loops, e.g. for an open mesh, the faces strategy is used instead.
+//
+// projection_faces: only faces seen from above are projected, faces seen from below or edge-on
+// are covered by them in a closed mesh. The faces are split in batches, each batch is projected and
+// unioned in one Clipper execute as a thread_pool task, and the batch results are merged
+// in a tree of n-ary unions, where the unions of each level run in parallel.
 
 class project_mesh {
 public:
+   enum projection_strategy {
+      projection_silhouette,  // union of silhouette edge loops
+      projection_faces        // union of all faces seen from above
+   };
+   static void set_strategy(projection_strategy strategy) { m_strategy = strategy; }
+   static projection_strategy get_strategy() { return m_strategy; }
+
+   // faces in one batch, and batch results merged by one union
+   static const size_t batch_faces  = 4096;
+   static const size_t merge_fan_in = 8;
+
    static std::shared_ptr<clipper_profile> project(std::shared_ptr<carve::mesh::MeshSet<3>> mesh);
+
+private:
+   static std::shared_ptr<clipper_profile> project_faces(std::shared_ptr<carve::mesh::MeshSet<3>> mesh);
+
+   // returns nullptr if the silhouette edges do not form closed loops
+   static std::shared_ptr<clipper_profile> project_silhouette(std::shared_ptr<carve::mesh::MeshSet<3>> mesh);
+
+   // append the silhouette loops of mesh to loops, returns false if an edge chain does not close
+   static bool silhouette_loops(carve::mesh::Mesh<3>* mesh, ClipperLib::Paths& loops);
+
+   // union of paths[begin,end) with the non-zero fill rule. Outer paths must have
+   // positive and holes negative orientation, the result has the same form
+   static ClipperLib::Paths union_paths(const std::vector<ClipperLib::Paths>& paths, size_t begin, size_t end);
+
+   // profile from the final union, sorted with positive paths first
+   static std::shared_ptr<clipper_profile> make_profile(ClipperLib::Paths& paths);
+
+private:
+   static projection_strategy m_strategy;
 };
 
 #endif // PROJECT_MESH_H
@@ -0,0 +1,166 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "remote_executor.h"
+#include "xmesh_file.h"
+#include "csg_parser/cf_xmlTree.h"
+#include <algorithm>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <boost/asio.hpp>
+
+remote_executor::remote_executor()
+: m_min_bool(16)
+{}
+
+remote_executor::~remote_executor()
+{}
+
+void remote_executor::set_workers(const std::vector<std::string>& workers)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   m_workers.clear();
+   for(auto& endpoint : workers) {
+      worker w;
+      w.endpoint = endpoint;
+      m_workers.push_back(w);
+   }
+}
+
+bool remote_executor::tcp_endpoint(const std::string& endpoint, std::string& host, std::string& port)
+{
+   size_t icolon = endpoint.rfind(':');
+   if(icolon == std::string::npos || icolon+1 == endpoint.size()) return false;
+   port = endpoint.substr(icolon+1);
+   if(port.find_first_not_of("0123456789") != std::string::npos) return false;
+   host = endpoint.substr(0,icolon);
+   return true;
+}
+
+std::string remote_executor::make_fragment(const cf_xmlNode& node)
+{
+   cf_xmlTree tree;
+   tree.create_root("xcsg");
+   cf_xmlNode root;
+   tree.get_root(root);
+   root.add_child(node);
+
+   std::ostringstream out;
+   tree.write_binary(out);
+   return out.str();
+}
+
+// send the request and return the xmesh data of the reply.
+// The reply starts with "xcsg mesh ok <nbytes>" or "xcsg mesh failed: <message>"
+template <typename Socket>
+static std::string exchange(Socket& socket, const std::string& header, const std::string& fragment)
+{
+   boost::asio::write(socket,boost::asio::buffer(header));
+   boost::asio::write(socket,boost::asio::buffer(fragment));
+
+   boost::asio::streambuf reply;
+   boost::asio::read_until(socket,reply,'\n');
+   std::istream in(&reply);
+   std::string line;
+   std::getline(in,line);
+
+   const std::string ok("xcsg mesh ok ");
+   if(line.compare(0,ok.size(),ok) != 0) throw std::runtime_error("remote_executor: " + line);
+   size_t nbytes = std::stoull(line.substr(ok.size()));
+
+   // part of the mesh may already be buffered after the status line
+   std::string data(nbytes,'\0');
+   size_t nbuffered = std::min(nbytes,reply.size());
+   in.read(&data[0],nbuffered);
+   if(nbytes > nbuffered) boost::asio::read(socket,boost::asio::buffer(&data[nbuffered],nbytes-nbuffered));
+   return data;
+}
+
+std::string remote_executor::request(const std::string& endpoint, const std::string& header, const std::string& fragment)
+{
+   boost::asio::io_context io;
+   std::string host,port;
+   if(tcp_endpoint(endpoint,host,port)) {
+      boost::asio::ip::tcp::socket socket(io);
+      boost::asio::ip::tcp::resolver resolver(io);
+      boost::asio::connect(socket,resolver.resolve(host,port));
+      return exchange(socket,header,fragment);
+   }
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+   boost::asio::local::stream_protocol::socket socket(io);
+   socket.connect(boost::asio::local::stream_protocol::endpoint(endpoint));
+   return exchange(socket,header,fragment);
+#else
+   throw boost::system::system_error(boost::asio::error::operation_not_supported,"remote_executor: Unix domain sockets are not supported, use host:port");
+#endif
+}
+
+remote_executor::MeshSet_ptr remote_executor::compute(const std::string& fragment, const carve::math::Matrix& t, double secant_tolerance)
+{
+   // "mesh <nbytes> <secant tolerance> <16 matrix values, row by row>"
+   std::ostringstream header;
+   header << std::setprecision(std::numeric_limits<double>::max_digits10);
+   header << "mesh " << fragment.size() << ' ' << secant_tolerance;
+   for(size_t i=0; i<4; i++) {
+      for(size_t j=0; j<4; j++) header << ' ' << t.m[i][j];
+   }
+   header << '\n';
+
+   while(true) {
+
+      // the worker with the least data in flight, the first one when several are idle
+      size_t iworker = 0;
+      std::string endpoint;
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         iworker = m_workers.size();
+         for(size_t i=0; i<m_workers.size(); i++) {
+            if(m_workers[i].down) continue;
+            if(iworker == m_workers.size() || m_workers[i].bytes_in_flight < m_workers[iworker].bytes_in_flight) iworker = i;
+         }
+         if(iworker == m_workers.size()) return nullptr;
+         m_workers[iworker].bytes_in_flight += fragment.size();
+         endpoint = m_workers[iworker].endpoint;
+      }
+
+      std::string data;
+      bool reached = true;
+      try {
+         data = request(endpoint,header.str(),fragment);
+      }
+      catch(boost::system::system_error&) {
+         // connection or transfer failure, try another worker
+         reached = false;
+      }
+      catch(...) {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         m_workers[iworker].bytes_in_flight -= fragment.size();
+         throw;
+      }
+
+      {
+         std::lock_guard<std::mutex> lock(m_mutex);
+         m_workers[iworker].bytes_in_flight -= fragment.size();
+         if(!reached) m_workers[iworker].down = true;
+      }
+      if(reached) {
+         xmesh_reader reader(data.data(),data.size());
+         return reader.create_carve_mesh();
+      }
+   }
+}
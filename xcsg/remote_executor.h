@@ -0,0 +1,82 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef REMOTE_EXECUTOR_H
+#define REMOTE_EXECUTOR_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <carve/csg.hpp>
+class cf_xmlNode;
+
+// remote_executor sends expensive subtrees to other xcsg processes started with --serve, so a
+// cluster can share the booleans of one model (--remote option). A subtree is sent as a binary
+// xcsg tree together with its accumulated transformation and the secant tolerance of the model,
+// the worker returns the mesh in xmesh format. Files referenced by the subtree, e.g. by import3d,
+// must be available under the same paths on the workers.
+//
+// Workers are "host:port" TCP endpoints or Unix domain socket paths. Each request goes to the
+// worker with the fewest bytes in flight, a worker that cannot be reached is not used again
+// in the run and the subtree is then computed locally.
+
+class remote_executor {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   static remote_executor& singleton()  { static remote_executor instance; return instance;  }
+
+   // set the workers, an empty list disables remote execution
+   void set_workers(const std::vector<std::string>& workers);
+
+   // true if workers are set
+   bool enabled() const { return m_workers.size() > 0; }
+
+   // subtrees with at least min_bool booleans are sent to the workers
+   void   set_min_bool(size_t min_bool) { m_min_bool = min_bool; }
+   size_t min_bool() const              { return m_min_bool; }
+
+   // serialize the subtree of node as a binary xcsg tree
+   static std::string make_fragment(const cf_xmlNode& node);
+
+   // compute the mesh of the fragment transformed by t on a worker. Returns nullptr if no
+   // worker could be reached, throws std::runtime_error if the worker reports an error
+   MeshSet_ptr compute(const std::string& fragment, const carve::math::Matrix& t, double secant_tolerance);
+
+   // split "host:port" into host and port, false if endpoint is not of that form
+   static bool tcp_endpoint(const std::string& endpoint, std::string& host, std::string& port);
+
+protected:
+   remote_executor();
+   virtual ~remote_executor();
+
+   // send one request to the worker and return the xmesh data of the reply
+   static std::string request(const std::string& endpoint, const std::string& header, const std::string& fragment);
+
+private:
+   struct worker {
+      std::string endpoint;
+      size_t      bytes_in_flight = 0;   // fragment bytes of the requests not yet answered
+      bool        down = false;          // could not be reached
+   };
+
+   std::mutex          m_mutex;
+   std::vector<worker> m_workers;
+   size_t              m_min_bool;
+};
+
+#endif // REMOTE_EXECUTOR_H
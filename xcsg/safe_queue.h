@@ -17,8 +17,14 @@
 #define SAFE_QUEUE_H
 
 #include <queue>
+#include <vector>
 #include <mutex>
+#include <atomic>
 #include <condition_variable>
+#include "trace_recorder.h"
+
+// safe_queue is a mutex protected FIFO queue. The size is mirrored in an atomic,
+// so polling the size does not take the lock or contend with producers and consumers
 
 template <class T>
 class safe_queue {
@@ -27,6 +33,7 @@ public:
    : q()
    , m()
    , c()
+   , count(0)
    {}
 
    ~safe_queue(void)
@@ -39,7 +46,9 @@ public:
       // Therefore this extra code block.
       {
        std::lock_guard<std::mutex> lock(m);
-       q.push(t);
+       q.push(std::move(t));
+       count.store(q.size(),std::memory_order_release);
+       trace_recorder::counter("safe_queue",this,q.size());
       }
       c.notify_one();
    }
@@ -47,11 +56,16 @@ public:
    // return false if queue is empty
    bool try_dequeue(T& val)
    {
+      // an empty queue is detected without the lock
+      if(count.load(std::memory_order_acquire) == 0) return false;
+
       std::unique_lock<std::mutex> lock(m);
       if(q.empty())return false;
 
-      val = q.front();
+      val = std::move(q.front());
       q.pop();
+      count.store(q.size(),std::memory_order_release);
+      trace_recorder::counter("safe_queue",this,q.size());
       return true;
   }
 
@@ -63,21 +77,39 @@ public:
       {
          c.wait(lock);
       }
-      T val = q.front();
+      T val = std::move(q.front());
       q.pop();
+      count.store(q.size(),std::memory_order_release);
+      trace_recorder::counter("safe_queue",this,q.size());
       return val;
    }
 
-   size_t size() const
+   // move all queued values to the end of out under one lock, returns the number moved
+   size_t dequeue_all(std::vector<T>& out)
    {
       std::lock_guard<std::mutex> lock(m);
-      return q.size();
+      size_t n = q.size();
+      out.reserve(out.size()+n);
+      while(!q.empty()) {
+         out.push_back(std::move(q.front()));
+         q.pop();
+      }
+      count.store(0,std::memory_order_release);
+      trace_recorder::counter("safe_queue",this,0);
+      return n;
+   }
+
+   // the size when last changed, read without the lock
+   size_t size() const
+   {
+      return count.load(std::memory_order_acquire);
    }
 
 private:
    std::queue<T> q;
    mutable std::mutex m;
    std::condition_variable c;
+   std::atomic<size_t> count; // q.size(), updated under the lock
 };
 
 #endif // SAFE_QUEUE_H
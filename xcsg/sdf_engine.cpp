@@ -0,0 +1,436 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "sdf_engine.h"
+#include "xbox3d.h"
+#include "thread_pool.h"
+#include "trace_recorder.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+double sdf_engine::m_voxel = 0.0;
+
+typedef carve::geom3d::Vector vec3;
+
+// columns of a grid are processed in slices of this many rows (x index)
+static const size_t slice_rows = 8;
+
+// column_grid holds for every (x,y) column the sorted z values where it enters and leaves the solid,
+// in pairs. Column (i,j) is at ((ix0+i+0.5)*h,(iy0+j+0.5)*h), sample k of a column at z = (iz0+k+0.5)*h
+struct column_grid {
+   double  h;
+   int64_t ix0,iy0,iz0;
+   size_t  nx,ny,nz;
+   std::vector<std::vector<double>> cols;
+
+   double x(size_t i) const { return (ix0 + static_cast<int64_t>(i) + 0.5)*h; }
+   double y(size_t j) const { return (iy0 + static_cast<int64_t>(j) + 0.5)*h; }
+   double z(size_t k) const { return (iz0 + static_cast<int64_t>(k) + 0.5)*h; }
+
+   const std::vector<double>& col(size_t i, size_t j) const { return cols[i*ny+j]; }
+   std::vector<double>&       col(size_t i, size_t j)       { return cols[i*ny+j]; }
+
+   // sample index at or below z, may be outside the grid
+   int64_t k_below(double zv) const { return static_cast<int64_t>(std::floor(zv/h - 0.5)) - iz0; }
+
+   // point at z is inside when an odd number of boundaries is at or below it
+   static bool inside(const std::vector<double>& col, double zv) { return ((std::upper_bound(col.begin(),col.end(),zv) - col.begin()) & 1) != 0; }
+   bool inside(size_t i, size_t j, size_t k) const { return inside(col(i,j),z(k)); }
+
+   // signed distance along the column to the nearest boundary, negative inside, limited to 2 cells
+   double distance(size_t i, size_t j, size_t k) const
+   {
+      const std::vector<double>& c = col(i,j);
+      double zv = z(k);
+      double d  = 2*h;
+      auto it = std::upper_bound(c.begin(),c.end(),zv);
+      if(it != c.end())   d = std::min(d,*it - zv);
+      if(it != c.begin()) d = std::min(d,zv - *(it-1));
+      return (((it - c.begin()) & 1) != 0)? -d : d;
+   }
+};
+
+// run f(i) for the rows of the grid in parallel slices
+static void for_rows(size_t nx, const std::function<void(size_t)>& f)
+{
+   thread_pool::task_group group;
+   for(size_t first=0; first<nx; first+=slice_rows) {
+      size_t last = std::min(nx,first+slice_rows);
+      thread_pool::singleton().submit(group,[&f,first,last]() { for(size_t i=first; i<last; i++) f(i); });
+   }
+   thread_pool::singleton().wait(group);
+}
+
+// grid covering the boxes with 2 empty columns and samples on each side
+static column_grid make_grid(const xbox3d& box, double h)
+{
+   column_grid grid;
+   grid.h   = h;
+   grid.ix0 = static_cast<int64_t>(std::floor(box.p1().x/h)) - 2;
+   grid.iy0 = static_cast<int64_t>(std::floor(box.p1().y/h)) - 2;
+   grid.iz0 = static_cast<int64_t>(std::floor(box.p1().z/h)) - 2;
+   grid.nx  = static_cast<size_t>(static_cast<int64_t>(std::ceil(box.p2().x/h)) + 2 - grid.ix0);
+   grid.ny  = static_cast<size_t>(static_cast<int64_t>(std::ceil(box.p2().y/h)) + 2 - grid.iy0);
+   grid.nz  = static_cast<size_t>(static_cast<int64_t>(std::ceil(box.p2().z/h)) + 2 - grid.iz0);
+   if(grid.nx*grid.ny > sdf_engine::max_columns) {
+      std::ostringstream msg;
+      msg << "sdf_engine: grid of " << grid.nx << "x" << grid.ny << " columns is too large, use a larger --voxel";
+      throw std::runtime_error(msg.str());
+   }
+   grid.cols.resize(grid.nx*grid.ny);
+   return grid;
+}
+
+// projected triangle crossing the columns, delta is +1 where a column enters the solid going up
+struct column_triangle {
+   vec3 p[3];      // counter clockwise seen from above
+   int  delta;
+};
+
+// top-left fill rule, so a column on an edge shared by two triangles hits exactly one of them
+static bool edge_inside(const vec3& a, const vec3& b, double px, double py, double& w)
+{
+   w = (b.x-a.x)*(py-a.y) - (b.y-a.y)*(px-a.x);
+   if(w > 0.0) return true;
+   if(w < 0.0) return false;
+   double dx = b.x-a.x, dy = b.y-a.y;
+   return (dy < 0.0) || (dy == 0.0 && dx < 0.0);
+}
+
+// fill the columns of grid with the boundaries of the mesh. Faces are fanned into triangles,
+// the winding count along each column decides the inside, so non-convex faces are handled
+static void voxelize(const carve::mesh::MeshSet<3>& meshset, column_grid& grid)
+{
+   trace_recorder::span span("sdf_engine::voxelize");
+
+   // the triangles are binned by the slices they cover
+   size_t nslice = (grid.nx + slice_rows - 1)/slice_rows;
+   std::vector<std::vector<column_triangle>> bins(nslice);
+   for(auto mesh : meshset.meshes) {
+      for(auto face : mesh->faces) {
+         const carve::mesh::Edge<3>* e0 = face->edge;
+         const carve::mesh::Edge<3>* e  = e0->next;
+         while(e->next != e0) {
+            column_triangle t;
+            t.p[0] = e0->vert->v;
+            t.p[1] = e->vert->v;
+            t.p[2] = e->next->vert->v;
+            e = e->next;
+
+            double area = (t.p[1].x-t.p[0].x)*(t.p[2].y-t.p[0].y) - (t.p[1].y-t.p[0].y)*(t.p[2].x-t.p[0].x);
+            if(area == 0.0) continue;
+
+            // an outward normal pointing down means the column enters the solid
+            t.delta = (area < 0.0)? 1 : -1;
+            if(area < 0.0) std::swap(t.p[1],t.p[2]);
+
+            double xmin = std::min({t.p[0].x,t.p[1].x,t.p[2].x});
+            double xmax = std::max({t.p[0].x,t.p[1].x,t.p[2].x});
+            int64_t i0 = std::max<int64_t>(0,static_cast<int64_t>(std::floor(xmin/grid.h - 0.5)) - grid.ix0);
+            int64_t i1 = std::min<int64_t>(grid.nx-1,static_cast<int64_t>(std::ceil(xmax/grid.h - 0.5)) - grid.ix0);
+            for(int64_t islice=i0/slice_rows; islice<=i1/static_cast<int64_t>(slice_rows); islice++) bins[islice].push_back(t);
+         }
+      }
+   }
+
+   thread_pool::task_group group;
+   for(size_t islice=0; islice<nslice; islice++) {
+      thread_pool::singleton().submit(group,[&grid,&bins,islice]() {
+         size_t first = islice*slice_rows;
+         size_t last  = std::min(grid.nx,first+slice_rows);
+         std::vector<std::vector<std::pair<double,int>>> crossings((last-first)*grid.ny);
+         for(const column_triangle& t : bins[islice]) {
+            double xmin = std::min({t.p[0].x,t.p[1].x,t.p[2].x}), xmax = std::max({t.p[0].x,t.p[1].x,t.p[2].x});
+            double ymin = std::min({t.p[0].y,t.p[1].y,t.p[2].y}), ymax = std::max({t.p[0].y,t.p[1].y,t.p[2].y});
+            int64_t i0 = std::max<int64_t>(first,static_cast<int64_t>(std::floor(xmin/grid.h - 0.5)) - grid.ix0);
+            int64_t i1 = std::min<int64_t>(last-1,static_cast<int64_t>(std::ceil(xmax/grid.h - 0.5)) - grid.ix0);
+            int64_t j0 = std::max<int64_t>(0,static_cast<int64_t>(std::floor(ymin/grid.h - 0.5)) - grid.iy0);
+            int64_t j1 = std::min<int64_t>(grid.ny-1,static_cast<int64_t>(std::ceil(ymax/grid.h - 0.5)) - grid.iy0);
+            double area = (t.p[1].x-t.p[0].x)*(t.p[2].y-t.p[0].y) - (t.p[1].y-t.p[0].y)*(t.p[2].x-t.p[0].x);
+            for(int64_t i=i0; i<=i1; i++) {
+               double px = grid.x(i);
+               for(int64_t j=j0; j<=j1; j++) {
+                  double py = grid.y(j);
+                  double w0,w1,w2;
+                  if(!edge_inside(t.p[1],t.p[2],px,py,w0) || !edge_inside(t.p[2],t.p[0],px,py,w1) || !edge_inside(t.p[0],t.p[1],px,py,w2)) continue;
+                  double zv = (w0*t.p[0].z + w1*t.p[1].z + w2*t.p[2].z)/area;
+                  crossings[(i-first)*grid.ny + j].push_back(std::make_pair(zv,t.delta));
+               }
+            }
+         }
+
+         // boundaries where the winding count changes between zero and non-zero
+         for(size_t i=first; i<last; i++) {
+            for(size_t j=0; j<grid.ny; j++) {
+               std::vector<std::pair<double,int>>& c = crossings[(i-first)*grid.ny + j];
+               std::sort(c.begin(),c.end());
+               std::vector<double>& col = grid.col(i,j);
+               int winding = 0;
+               for(size_t ic=0; ic<c.size(); ) {
+                  double zv = c[ic].first;
+                  bool was_inside = (winding != 0);
+                  for(; ic<c.size() && c[ic].first == zv; ic++) winding += c[ic].second;
+                  if(was_inside != (winding != 0)) col.push_back(zv);
+               }
+               // an open mesh may leave a column inside, it is closed at the last crossing
+               if(col.size() % 2 != 0) col.pop_back();
+            }
+         }
+      });
+   }
+   thread_pool::singleton().wait(group);
+}
+
+static bool apply_op(bool a, bool b, carve::csg::CSG::OP op)
+{
+   switch(op) {
+      case carve::csg::CSG::UNION:                return a || b;
+      case carve::csg::CSG::INTERSECTION:         return a && b;
+      case carve::csg::CSG::A_MINUS_B:            return a && !b;
+      case carve::csg::CSG::B_MINUS_A:            return b && !a;
+      case carve::csg::CSG::SYMMETRIC_DIFFERENCE: return a != b;
+      default:                                    return a;
+   }
+}
+
+// combine the columns of b into a, evaluating the operation exactly along each column
+static void combine(column_grid& a, const column_grid& b, carve::csg::CSG::OP op)
+{
+   trace_recorder::span span("sdf_engine::combine");
+   for_rows(a.nx,[&a,&b,op](size_t i) {
+      std::vector<double> result;
+      for(size_t j=0; j<a.ny; j++) {
+         std::vector<double>& ca = a.col(i,j);
+         const std::vector<double>& cb = b.col(i,j);
+         result.clear();
+         bool in_a = false, in_b = false, in = apply_op(false,false,op);
+         size_t ia = 0, ib = 0;
+         while(ia < ca.size() || ib < cb.size()) {
+            double zv = std::min((ia < ca.size())? ca[ia] : HUGE_VAL,(ib < cb.size())? cb[ib] : HUGE_VAL);
+            for(; ia < ca.size() && ca[ia] == zv; ia++) in_a = !in_a;
+            for(; ib < cb.size() && cb[ib] == zv; ib++) in_b = !in_b;
+            bool next = apply_op(in_a,in_b,op);
+            if(next != in) result.push_back(zv);
+            in = next;
+         }
+         ca.swap(result);
+      }
+   });
+}
+
+// sample ranges [k0,k1] where the states of the columns may differ, or a boundary lies between samples.
+// The ranges are widened by one sample, the cells and edges found are checked exactly afterwards
+static void candidate_samples(const column_grid& grid, std::initializer_list<const std::vector<double>*> cols, std::vector<int64_t>& ks)
+{
+   ks.clear();
+   std::vector<double> events;
+   for(auto c : cols) events.insert(events.end(),c->begin(),c->end());
+   std::sort(events.begin(),events.end());
+
+   for(size_t ie=0; ie<events.size(); ie++) {
+      int64_t k0 = grid.k_below(events[ie]);
+      int64_t k1 = (ie+1 < events.size())? grid.k_below(events[ie+1]) : k0;
+
+      // between two events the states are constant, they differ unless all columns agree
+      bool differ = false;
+      if(ie+1 < events.size()) {
+         double zm = 0.5*(events[ie]+events[ie+1]);
+         bool first = column_grid::inside(**cols.begin(),zm);
+         for(auto c : cols) differ = differ || (column_grid::inside(*c,zm) != first);
+      }
+      if(!differ) k1 = k0;
+      for(int64_t k=k0-1; k<=k1+1; k++) {
+         if(k >= 0 && k < static_cast<int64_t>(grid.nz)) ks.push_back(k);
+      }
+   }
+   std::sort(ks.begin(),ks.end());
+   ks.erase(std::unique(ks.begin(),ks.end()),ks.end());
+}
+
+// extract the surface of the grid, one vertex per cell crossed by the surface and two triangles per crossed sample edge
+static boolean_engine::MeshSet_ptr extract(const column_grid& grid)
+{
+   trace_recorder::span span("sdf_engine::extract");
+   const double h = grid.h;
+
+   // cell (i,j,k) has the samples (i..i+1,j..j+1,k..k+1) as corners. The vertices of each
+   // cell column are listed by k with their index local to the row
+   size_t ncx = grid.nx-1, ncy = grid.ny-1;
+   std::vector<std::vector<std::pair<int64_t,uint32_t>>> cell_vertex(ncx*ncy);
+   std::vector<std::vector<vec3>> row_vertices(ncx);
+   for_rows(ncx,[&](size_t i) {
+      std::vector<int64_t> ks;
+      std::vector<vec3>& verts = row_vertices[i];
+      for(size_t j=0; j<ncy; j++) {
+         candidate_samples(grid,{&grid.col(i,j),&grid.col(i+1,j),&grid.col(i,j+1),&grid.col(i+1,j+1)},ks);
+         for(int64_t k : ks) {
+            if(k+1 >= static_cast<int64_t>(grid.nz)) continue;
+
+            // mass point of the crossings on the 12 cell edges
+            vec3 sum = carve::geom::VECTOR(0,0,0);
+            size_t n = 0;
+            for(size_t di=0; di<2; di++) {
+               for(size_t dj=0; dj<2; dj++) {
+                  const std::vector<double>& c = grid.col(i+di,j+dj);
+                  double z0 = grid.z(k), z1 = grid.z(k+1);
+                  if(column_grid::inside(c,z0) != column_grid::inside(c,z1)) {
+                     double zc = *std::upper_bound(c.begin(),c.end(),z0);
+                     sum += carve::geom::VECTOR(grid.x(i+di),grid.y(j+dj),zc);
+                     n++;
+                  }
+               }
+            }
+            for(size_t dk=0; dk<2; dk++) {
+               for(size_t d=0; d<2; d++) {
+                  // x edge at j+d and y edge at i+d, crossings interpolated from the column distances
+                  double fx0 = grid.distance(i,j+d,k+dk),   fx1 = grid.distance(i+1,j+d,k+dk);
+                  if((fx0 < 0.0) != (fx1 < 0.0)) {
+                     double t = std::min(1.0,std::max(0.0,fx0/(fx0-fx1)));
+                     sum += carve::geom::VECTOR(grid.x(i)+t*h,grid.y(j+d),grid.z(k+dk));
+                     n++;
+                  }
+                  double fy0 = grid.distance(i+d,j,k+dk),   fy1 = grid.distance(i+d,j+1,k+dk);
+                  if((fy0 < 0.0) != (fy1 < 0.0)) {
+                     double t = std::min(1.0,std::max(0.0,fy0/(fy0-fy1)));
+                     sum += carve::geom::VECTOR(grid.x(i+d),grid.y(j)+t*h,grid.z(k+dk));
+                     n++;
+                  }
+               }
+            }
+            if(n == 0) continue;
+            cell_vertex[i*ncy+j].push_back(std::make_pair(k,static_cast<uint32_t>(verts.size())));
+            verts.push_back(sum/static_cast<double>(n));
+         }
+      }
+   });
+
+   // global vertex indices, rows in order
+   std::vector<size_t> row_offset(ncx+1,0);
+   for(size_t i=0; i<ncx; i++) row_offset[i+1] = row_offset[i] + row_vertices[i].size();
+   if(row_offset[ncx] > static_cast<size_t>(std::numeric_limits<int>::max())) throw std::runtime_error("sdf_engine: too many vertices, use a larger --voxel");
+
+   auto vertex = [&](size_t i, size_t j, int64_t k, int& v) {
+      const std::vector<std::pair<int64_t,uint32_t>>& cv = cell_vertex[i*ncy+j];
+      auto it = std::lower_bound(cv.begin(),cv.end(),std::make_pair(k,uint32_t(0)));
+      if(it == cv.end() || it->first != k) return false;
+      v = static_cast<int>(row_offset[i] + it->second);
+      return true;
+   };
+
+   // quads around each sample edge where the state changes, oriented with the inside below
+   // the edge direction. Each quad is split along its shorter diagonal
+   std::vector<std::vector<int>> row_faces(grid.nx);
+   for_rows(grid.nx,[&](size_t i) {
+      if(i == 0 || i+1 >= grid.nx) return;
+      std::vector<int>& faces = row_faces[i];
+      std::vector<int64_t> ks;
+      auto quad = [&](size_t ci[4], size_t cj[4], int64_t ck[4], bool flip) {
+         int v[4];
+         for(size_t q=0; q<4; q++) if(!vertex(ci[q],cj[q],ck[q],v[q])) return;
+         if(flip) std::swap(v[1],v[3]);
+         faces.insert(faces.end(),{ 4, v[0], v[1], v[2], v[3] });
+      };
+      for(size_t j=1; j+1<grid.ny; j++) {
+         const std::vector<double>& c = grid.col(i,j);
+
+         // z edges
+         candidate_samples(grid,{&c},ks);
+         for(int64_t k : ks) {
+            if(k+1 >= static_cast<int64_t>(grid.nz)) continue;
+            bool in0 = grid.inside(i,j,k);
+            if(in0 == grid.inside(i,j,k+1)) continue;
+            size_t ci[4] = { i-1, i, i, i-1 };
+            size_t cj[4] = { j-1, j-1, j, j };
+            int64_t ck[4] = { k, k, k, k };
+            quad(ci,cj,ck,!in0);
+         }
+
+         // x edges
+         candidate_samples(grid,{&c,&grid.col(i+1,j)},ks);
+         for(int64_t k : ks) {
+            if(k < 1) continue;
+            bool in0 = grid.inside(i,j,k);
+            if(in0 == grid.inside(i+1,j,k)) continue;
+            size_t ci[4] = { i, i, i, i };
+            size_t cj[4] = { j-1, j, j, j-1 };
+            int64_t ck[4] = { k-1, k-1, k, k };
+            quad(ci,cj,ck,!in0);
+         }
+
+         // y edges
+         candidate_samples(grid,{&c,&grid.col(i,j+1)},ks);
+         for(int64_t k : ks) {
+            if(k < 1) continue;
+            bool in0 = grid.inside(i,j,k);
+            if(in0 == grid.inside(i,j+1,k)) continue;
+            size_t ci[4] = { i-1, i-1, i, i };
+            size_t cj[4] = { j, j, j, j };
+            int64_t ck[4] = { k-1, k, k, k-1 };
+            quad(ci,cj,ck,!in0);
+         }
+      }
+   });
+
+   std::vector<vec3> points;
+   points.reserve(row_offset[ncx]);
+   for(auto& verts : row_vertices) points.insert(points.end(),verts.begin(),verts.end());
+
+   std::vector<int> face_indices;
+   size_t nfaces = 0;
+   for(auto& faces : row_faces) {
+      for(size_t pos=0; pos<faces.size(); pos+=5) {
+         const int* v = &faces[pos+1];
+         bool diag02 = carve::geom::distance2(points[v[0]],points[v[2]]) <= carve::geom::distance2(points[v[1]],points[v[3]]);
+         if(diag02) face_indices.insert(face_indices.end(),{ 3, v[0], v[1], v[2], 3, v[0], v[2], v[3] });
+         else       face_indices.insert(face_indices.end(),{ 3, v[0], v[1], v[3], 3, v[1], v[2], v[3] });
+         nfaces += 2;
+      }
+   }
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,nfaces,face_indices);
+}
+
+std::string sdf_engine::cache_key() const
+{
+   std::ostringstream key;
+   key.precision(17);
+   key << name() << ' ' << m_voxel;
+   return key.str();
+}
+
+boolean_engine::MeshSet_ptr sdf_engine::compute(const MeshSet_ptr& a, const MeshSet_ptr& b, carve::csg::CSG::OP op) const
+{
+   xbox3d box(*a);
+   box.enclose(xbox3d(*b));
+   if(!box.initialised()) return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<vec3>(),0,std::vector<int>());
+
+   double h = m_voxel;
+   if(!(h > 0.0)) {
+      double extent = std::max({ box.p2().x-box.p1().x, box.p2().y-box.p1().y, box.p2().z-box.p1().z });
+      if(!(extent > 0.0)) extent = 1.0;
+      h = std::ldexp(1.0,std::ilogb(extent/default_cells));
+   }
+
+   column_grid grid_a = make_grid(box,h);
+   column_grid grid_b = make_grid(box,h);
+   voxelize(*a,grid_a);
+   voxelize(*b,grid_b);
+   combine(grid_a,grid_b,op);
+   return extract(grid_a);
+}
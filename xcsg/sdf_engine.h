@@ -0,0 +1,53 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef SDF_ENGINE_H
+#define SDF_ENGINE_H
+
+#include "boolean_engine.h"
+
+// sdf_engine is an approximate boolean engine for fast previews of deep trees. The operands are
+// voxelized on a grid of z columns spaced voxel apart: each column holds the z values where it
+// enters and leaves the solid, found by casting the column through the faces. The boolean is the
+// min/max of the inside states of the two operands, evaluated exactly along each column. The result
+// surface is extracted by dual contouring with mass point vertices (surface nets), one vertex per
+// grid cell crossed by the surface, quads split in triangles. Columns are computed in parallel slices.
+//
+// Grids are aligned to multiples of the voxel size, so consecutive booleans sample the same columns.
+// Without a voxel size, a power of 2 spacing of about 1/default_cells of the operand size is used.
+// Details smaller than the voxel size are lost, and the result may contain non-manifold edges
+// where solids touch diagonally within one cell.
+
+class sdf_engine : public boolean_engine {
+public:
+   static const int default_cells = 256;
+
+   // max columns in a grid, larger grids throw
+   static const size_t max_columns = size_t(1)<<26;
+
+   std::string name() const override { return "sdf"; }
+   std::string cache_key() const override;
+   MeshSet_ptr compute(const MeshSet_ptr& a, const MeshSet_ptr& b, carve::csg::CSG::OP op) const override;
+
+   // grid spacing, 0 for the default relative spacing
+   static void set_voxel(double voxel) { m_voxel = voxel; }
+   static double voxel() { return m_voxel; }
+
+private:
+   static double m_voxel;
+};
+
+#endif // SDF_ENGINE_H
@@ -0,0 +1,194 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "server_metrics.h"
+#include "phase_timer.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+
+// seconds, the last bucket is +Inf
+const std::array<double,server_metrics::nbuckets> server_metrics::bucket_bounds = {
+   0.005, 0.01, 0.05, 0.1, 0.25, 0.5, 1.0, 2.5, 5.0, 10.0, 60.0, 300.0
+};
+
+// phase_timer values accumulated as counters: value name, metric name, help text
+static const char* counter_values[][3] = {
+   { "nbool",              "xcsg_booleans_total",                 "Boolean operations in computed models" },
+   { "disjoint_hits",      "xcsg_boolean_disjoint_hits_total",    "Booleans resolved by the disjoint bounding box fast path" },
+   { "disjoint_misses",    "xcsg_boolean_disjoint_misses_total",  "Booleans whose operand bounding boxes overlapped" },
+   { "boolean_retries",    "xcsg_boolean_retries_total",          "Booleans the engine failed on, recomputed by a retry" },
+   { "cache_hits",         "xcsg_mesh_cache_hits_total",          "Subtrees reused from the mesh cache (--cache_dir, --incremental)" },
+   { "cache_misses",       "xcsg_mesh_cache_misses_total",        "Subtrees recomputed and stored in the mesh cache" },
+   { "triangles",          "xcsg_triangles_total",                "Triangles in computed models" },
+   { "boolean_thread_sec", "xcsg_boolean_thread_seconds_total",   "Thread time spent in booleans" },
+};
+
+void server_metrics::histogram::observe(double value)
+{
+   for(size_t i=0; i<nbuckets; i++) {
+      if(value <= bucket_bounds[i]) {
+         count[i]++;
+         break;
+      }
+   }
+   n++;
+   sum += value;
+}
+
+server_metrics::server_metrics()
+: m_start(boost::posix_time::microsec_clock::universal_time())
+, m_jobs_ok(0)
+, m_jobs_failed(0)
+, m_mesh_ok(0)
+, m_mesh_failed(0)
+, m_utilization(0.0)
+, m_job_peak_bytes(0.0)
+{}
+
+server_metrics::~server_metrics()
+{}
+
+void server_metrics::begin_job()
+{
+#ifdef __linux__
+   // "5" resets the peak resident set size (VmHWM) of the process
+   std::ofstream clear_refs("/proc/self/clear_refs");
+   if(clear_refs.is_open()) clear_refs << "5";
+#endif
+}
+
+double server_metrics::job_peak_bytes()
+{
+#ifdef __linux__
+   std::ifstream status("/proc/self/status");
+   std::string line;
+   while(std::getline(status,line)) {
+      if(line.compare(0,6,"VmHWM:") == 0) {
+         std::istringstream in(line.substr(6));
+         double kb = 0.0;
+         if(in >> kb) return 1024.0*kb;
+      }
+   }
+#endif
+   return 1024.0*phase_timer::peak_rss_kb();
+}
+
+void server_metrics::end_job(bool ok, double seconds)
+{
+   std::vector<std::pair<std::string,double>> phases = phase_timer::singleton().phases();
+   std::vector<std::pair<std::string,double>> values = phase_timer::singleton().values();
+   double peak_bytes = job_peak_bytes();
+
+   std::lock_guard<std::mutex> lock(m_mutex);
+   (ok? m_jobs_ok : m_jobs_failed)++;
+   m_job_seconds.observe(seconds);
+   m_job_peak_bytes = peak_bytes;
+
+   double csg_sec = 0.0;
+   for(auto& p : phases) {
+      m_phase_seconds[p.first].observe(p.second);
+      if(p.first == "csg") csg_sec += p.second;
+   }
+   double thread_sec = 0.0;
+   for(auto& v : values) {
+      m_totals[v.first] += v.second;
+      if(v.first == "boolean_thread_sec") thread_sec += v.second;
+   }
+   size_t nthreads = std::max(size_t(1),thread_pool::singleton().nthreads());
+   m_utilization = (csg_sec > 0.0)? std::min(1.0,thread_sec/(csg_sec*nthreads)) : 0.0;
+}
+
+void server_metrics::add_mesh_request(bool ok, double seconds)
+{
+   std::lock_guard<std::mutex> lock(m_mutex);
+   (ok? m_mesh_ok : m_mesh_failed)++;
+   m_mesh_seconds.observe(seconds);
+}
+
+void server_metrics::write_histogram(std::ostream& out, const std::string& name, const std::string& labels, const histogram& h)
+{
+   std::string sep = (labels.size() > 0)? "," : "";
+   size_t cumulative = 0;
+   for(size_t i=0; i<nbuckets; i++) {
+      cumulative += h.count[i];
+      out << name << "_bucket{" << labels << sep << "le=\"" << bucket_bounds[i] << "\"} " << cumulative << "\n";
+   }
+   out << name << "_bucket{" << labels << sep << "le=\"+Inf\"} " << h.n << "\n";
+   std::string braces = (labels.size() > 0)? "{" + labels + "}" : "";
+   out << name << "_sum" << braces << " " << h.sum << "\n";
+   out << name << "_count" << braces << " " << h.n << "\n";
+}
+
+void server_metrics::write_text(std::ostream& out) const
+{
+   boost::posix_time::ptime now = boost::posix_time::microsec_clock::universal_time();
+   std::lock_guard<std::mutex> lock(m_mutex);
+   out << std::setprecision(9);
+
+   out << "# HELP xcsg_uptime_seconds Seconds since the server started\n";
+   out << "# TYPE xcsg_uptime_seconds gauge\n";
+   out << "xcsg_uptime_seconds " << 1.0E-6*(now - m_start).total_microseconds() << "\n";
+
+   out << "# HELP xcsg_jobs_total Jobs completed\n";
+   out << "# TYPE xcsg_jobs_total counter\n";
+   out << "xcsg_jobs_total{status=\"ok\"} " << m_jobs_ok << "\n";
+   out << "xcsg_jobs_total{status=\"failed\"} " << m_jobs_failed << "\n";
+
+   out << "# HELP xcsg_job_duration_seconds Wall time of jobs\n";
+   out << "# TYPE xcsg_job_duration_seconds histogram\n";
+   write_histogram(out,"xcsg_job_duration_seconds","",m_job_seconds);
+
+   out << "# HELP xcsg_phase_duration_seconds Wall time of the phases of jobs\n";
+   out << "# TYPE xcsg_phase_duration_seconds histogram\n";
+   for(auto& p : m_phase_seconds) {
+      write_histogram(out,"xcsg_phase_duration_seconds","phase=\"" + p.first + "\"",p.second);
+   }
+
+   out << "# HELP xcsg_mesh_requests_total Subtrees computed for remote clients (--remote)\n";
+   out << "# TYPE xcsg_mesh_requests_total counter\n";
+   out << "xcsg_mesh_requests_total{status=\"ok\"} " << m_mesh_ok << "\n";
+   out << "xcsg_mesh_requests_total{status=\"failed\"} " << m_mesh_failed << "\n";
+
+   out << "# HELP xcsg_mesh_request_duration_seconds Wall time of subtree requests\n";
+   out << "# TYPE xcsg_mesh_request_duration_seconds histogram\n";
+   write_histogram(out,"xcsg_mesh_request_duration_seconds","",m_mesh_seconds);
+
+   for(auto& c : counter_values) {
+      auto it = m_totals.find(c[0]);
+      out << "# HELP " << c[1] << " " << c[2] << "\n";
+      out << "# TYPE " << c[1] << " counter\n";
+      out << c[1] << " " << ((it != m_totals.end())? it->second : 0.0) << "\n";
+   }
+
+   out << "# HELP xcsg_thread_pool_threads Worker threads\n";
+   out << "# TYPE xcsg_thread_pool_threads gauge\n";
+   out << "xcsg_thread_pool_threads " << thread_pool::singleton().nthreads() << "\n";
+
+   out << "# HELP xcsg_thread_pool_queued_tasks Tasks waiting in the worker queues\n";
+   out << "# TYPE xcsg_thread_pool_queued_tasks gauge\n";
+   out << "xcsg_thread_pool_queued_tasks " << thread_pool::singleton().queued() << "\n";
+
+   out << "# HELP xcsg_thread_pool_utilization Boolean thread time over csg wall time of all threads, last job\n";
+   out << "# TYPE xcsg_thread_pool_utilization gauge\n";
+   out << "xcsg_thread_pool_utilization " << m_utilization << "\n";
+
+   out << "# HELP xcsg_job_peak_memory_bytes Peak resident memory of the last job\n";
+   out << "# TYPE xcsg_job_peak_memory_bytes gauge\n";
+   out << "xcsg_job_peak_memory_bytes " << m_job_peak_bytes << "\n";
+}
@@ -0,0 +1,85 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef SERVER_METRICS_H
+#define SERVER_METRICS_H
+
+#include <array>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+// server_metrics collects the throughput and latency of the jobs run by xcsg_server (--serve, --jobs)
+// and writes them in the Prometheus text exposition format, which OpenMetrics scrapers also read.
+// After each job, the phase times and result values recorded by phase_timer (as written by --timing)
+// are added to per phase latency histograms and to counters of booleans, disjoint bounding box hits
+// and cache hits. Rates such as jobs/sec are derived by the scraper from the counters.
+// The server answers "metrics" requests, and HTTP "GET /metrics", with write_text.
+
+class server_metrics {
+public:
+   static server_metrics& singleton()  { static server_metrics instance; return instance;  }
+
+   // call before a job starts, resets the peak memory of the process where supported (Linux)
+   void begin_job();
+
+   // record a completed job using the phase_timer of the job
+   void end_job(bool ok, double seconds);
+
+   // record a remote_executor subtree request
+   void add_mesh_request(bool ok, double seconds);
+
+   // write all metrics in the Prometheus text format, version 0.0.4
+   void write_text(std::ostream& out) const;
+
+protected:
+   server_metrics();
+   virtual ~server_metrics();
+
+   // histogram with the fixed bucket bounds below, counts are cumulative when written
+   static const size_t nbuckets = 12;
+   static const std::array<double,nbuckets> bucket_bounds;
+   struct histogram {
+      std::array<size_t,nbuckets> count{};   // observations <= bound, not cumulative
+      size_t                      n = 0;
+      double                      sum = 0.0;
+      void observe(double value);
+   };
+
+   // write histogram h with name and optional label "key=value" pair
+   static void write_histogram(std::ostream& out, const std::string& name, const std::string& labels, const histogram& h);
+
+   // peak resident bytes since begin_job, or of the process when it can not be reset
+   static double job_peak_bytes();
+
+private:
+   mutable std::mutex               m_mutex;
+   boost::posix_time::ptime         m_start;
+   size_t                           m_jobs_ok;
+   size_t                           m_jobs_failed;
+   size_t                           m_mesh_ok;
+   size_t                           m_mesh_failed;
+   histogram                        m_job_seconds;
+   histogram                        m_mesh_seconds;
+   std::map<std::string,histogram>  m_phase_seconds;   // parse, csg, triangulate, export
+   std::map<std::string,double>     m_totals;          // summed phase_timer values, e.g. nbool
+   double                           m_utilization;     // boolean thread time / (csg time * threads) of last job
+   double                           m_job_peak_bytes;  // of last job
+};
+
+#endif // SERVER_METRICS_H
@@ -0,0 +1,190 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "slice_mesh.h"
+#include "thread_pool.h"
+#include "trace_recorder.h"
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+struct point_hash {
+   size_t operator()(const ClipperLib::IntPoint& p) const
+   {
+      return std::hash<ClipperLib::cInt>()(p.X)*31 + std::hash<ClipperLib::cInt>()(p.Y);
+   }
+};
+
+static ClipperLib::IntPoint to_clipper(double x, double y)
+{
+   return ClipperLib::IntPoint(ClipperLib::cInt(std::llround(x*TO_CLIPPER)),ClipperLib::cInt(std::llround(y*TO_CLIPPER)));
+}
+
+std::shared_ptr<clipper_profile> slice_mesh::slice(MeshSet_ptr meshset, double z)
+{
+   return slice(meshset,std::vector<double>{z})[0];
+}
+
+std::vector<std::shared_ptr<clipper_profile>> slice_mesh::slice(MeshSet_ptr meshset, std::vector<double> z)
+{
+   trace_recorder::span span("slice_mesh::slice");
+   std::sort(z.begin(),z.end());
+
+   // faces are sliced in batches, each batch collects the segments of all planes
+   struct batch {
+      carve::mesh::Mesh<3>* mesh;
+      size_t                begin;
+      size_t                end;
+      plane_segments        segments;
+   };
+   std::vector<batch> batches;
+   for(carve::mesh::Mesh<3>* mesh : meshset->meshes) {
+      size_t nfaces = mesh->faces.size();
+      for(size_t begin=0; begin<nfaces; begin+=batch_faces) {
+         batches.push_back({mesh,begin,std::min(nfaces,begin+batch_faces),plane_segments()});
+      }
+   }
+
+   thread_pool::task_group group;
+   for(size_t ibatch=0; ibatch<batches.size(); ibatch++) {
+      thread_pool::singleton().submit(group,[&batches,&z,ibatch]() {
+         batch& b = batches[ibatch];
+         b.segments.resize(z.size());
+         for(size_t iface=b.begin; iface<b.end; iface++) slice_face(b.mesh->faces[iface],z,b.segments);
+      });
+   }
+   thread_pool::singleton().wait(group);
+
+   // the planes are independent, chain and resolve them in parallel
+   std::vector<std::shared_ptr<clipper_profile>> profiles(z.size());
+   thread_pool::task_group plane_group;
+   for(size_t iplane=0; iplane<z.size(); iplane++) {
+      thread_pool::singleton().submit(plane_group,[&batches,&profiles,iplane]() {
+         std::vector<segment> segments;
+         for(auto& b : batches) segments.insert(segments.end(),b.segments[iplane].begin(),b.segments[iplane].end());
+         profiles[iplane] = make_profile(chain(segments));
+      });
+   }
+   thread_pool::singleton().wait(plane_group);
+   return profiles;
+}
+
+void slice_mesh::slice_face(carve::mesh::Face<3>* face, const std::vector<double>& z, plane_segments& segments)
+{
+   typedef carve::mesh::Edge<3> edge_t;
+
+   // z range and Newell normal of the face, only the xy part of the normal is needed
+   double zmin = std::numeric_limits<double>::max();
+   double zmax = -zmin;
+   double nx = 0.0, ny = 0.0;
+   const edge_t* e = face->edge;
+   do {
+      const carve::geom3d::Vector& a = e->vert->v;
+      const carve::geom3d::Vector& b = e->next->vert->v;
+      zmin = std::min(zmin,a.z);
+      zmax = std::max(zmax,a.z);
+      nx += (a.y - b.y)*(a.z + b.z);
+      ny += (a.z - b.z)*(a.x + b.x);
+      e = e->next;
+   } while(e != face->edge);
+
+   // planes with zmin < z <= zmax have vertices on both sides
+   auto first = std::upper_bound(z.begin(),z.end(),zmin);
+   auto last  = std::upper_bound(first,z.end(),zmax);
+   if(first == last) return;
+
+   // the section runs along the face with the material on its left: direction (-ny,nx)
+   std::vector<std::pair<double,ClipperLib::IntPoint>> crossings;
+   for(auto it=first; it!=last; it++) {
+      double zp = *it;
+      crossings.clear();
+      e = face->edge;
+      do {
+         const carve::geom3d::Vector* lo = &e->vert->v;
+         const carve::geom3d::Vector* hi = &e->next->vert->v;
+         if((lo->z >= zp) != (hi->z >= zp)) {
+            // compute from the lower end, so both faces sharing the edge get the same point
+            if(lo->z > hi->z) std::swap(lo,hi);
+            double t = (zp - lo->z)/(hi->z - lo->z);
+            double x = lo->x + t*(hi->x - lo->x);
+            double y = lo->y + t*(hi->y - lo->y);
+            crossings.push_back(std::make_pair(-ny*x + nx*y,to_clipper(x,y)));
+         }
+         e = e->next;
+      } while(e != face->edge);
+
+      // consecutive crossings along the direction enter and leave the face
+      std::sort(crossings.begin(),crossings.end(),[](const std::pair<double,ClipperLib::IntPoint>& a, const std::pair<double,ClipperLib::IntPoint>& b) { return a.first < b.first; });
+      std::vector<segment>& plane = segments[it - z.begin()];
+      for(size_t i=0; i+1<crossings.size(); i+=2) {
+         plane.push_back({crossings[i].second,crossings[i+1].second});
+      }
+   }
+}
+
+ClipperLib::Paths slice_mesh::chain(const std::vector<segment>& segments)
+{
+   // segments that vanished in rounding are left out, the chain continues at the same point
+   std::unordered_map<ClipperLib::IntPoint,std::vector<size_t>,point_hash> outgoing;
+   std::vector<bool> used(segments.size(),false);
+   for(size_t i=0; i<segments.size(); i++) {
+      if(segments[i].p1 == segments[i].p2) used[i] = true;
+      else outgoing[segments[i].p1].push_back(i);
+   }
+
+   // an open chain, from an open mesh, is kept as it is and closed by clipper
+   ClipperLib::Paths contours;
+   for(size_t first=0; first<segments.size(); first++) {
+      if(used[first]) continue;
+
+      ClipperLib::Path contour;
+      size_t iseg = first;
+      while(true) {
+         used[iseg] = true;
+         contour.push_back(segments[iseg].p1);
+
+         const ClipperLib::IntPoint& end = segments[iseg].p2;
+         if(end == segments[first].p1) break;
+
+         auto it = outgoing.find(end);
+         if(it == outgoing.end()) break;
+         std::vector<size_t>& out = it->second;
+         while(out.size() > 0 && used[out.back()]) out.pop_back();
+         if(out.size() == 0) break;
+         iseg = out.back();
+         out.pop_back();
+      }
+      if(contour.size() > 2) contours.push_back(contour);
+   }
+   return contours;
+}
+
+std::shared_ptr<clipper_profile> slice_mesh::make_profile(const ClipperLib::Paths& contours)
+{
+   std::shared_ptr<clipper_profile> profile = std::make_shared<clipper_profile>();
+   ClipperLib::Clipper clipper;
+   clipper.AddPaths(contours,ClipperLib::ptSubject,true);
+   if(!clipper.Execute(ClipperLib::ctUnion,profile->paths(),ClipperLib::pftNonZero,ClipperLib::pftNonZero)) {
+      throw std::logic_error("slice_mesh::slice, union failed");
+   }
+   ClipperLib::CleanPolygons(profile->paths());
+
+   // make sure paths are sorted with positive path first
+   profile->sort();
+   return profile;
+}
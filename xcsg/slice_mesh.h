@@ -0,0 +1,61 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef SLICE_MESH_H
+#define SLICE_MESH_H
+
+#include <memory>
+#include <vector>
+#include <carve/mesh.hpp>
+#include "clipper_csg/clipper_profile.h"
+
+// slice_mesh computes planar sections of a closed mesh at planes z = constant.
+// Each face crossing a plane contributes a segment directed with the material on its left.
+// The segments are chained into contours by their end points, rounded to clipper
+// coordinates, and the contours are resolved with one Clipper union using the non-zero fill rule.
+// A vertex exactly in a plane counts as above it, so faces touching the plane from above
+// contribute nothing. Several planes are sliced in one pass over the faces.
+
+class slice_mesh {
+public:
+   typedef std::shared_ptr<carve::mesh::MeshSet<3>> MeshSet_ptr;
+
+   // faces handled by one thread_pool task
+   static const size_t batch_faces = 4096;
+
+   // section at z
+   static std::shared_ptr<clipper_profile> slice(MeshSet_ptr meshset, double z);
+
+   // sections at all z values, returned in increasing z order
+   static std::vector<std::shared_ptr<clipper_profile>> slice(MeshSet_ptr meshset, std::vector<double> z);
+
+private:
+   struct segment {
+      ClipperLib::IntPoint p1;
+      ClipperLib::IntPoint p2;
+   };
+   typedef std::vector<std::vector<segment>> plane_segments;
+
+   // append the segments of face for the planes it crosses. z is sorted
+   static void slice_face(carve::mesh::Face<3>* face, const std::vector<double>& z, plane_segments& segments);
+
+   // chain segments into closed contours
+   static ClipperLib::Paths chain(const std::vector<segment>& segments);
+
+   // union of the contours as a profile
+   static std::shared_ptr<clipper_profile> make_profile(const ClipperLib::Paths& contours);
+};
+
+#endif // SLICE_MESH_H
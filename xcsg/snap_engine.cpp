@@ -0,0 +1,68 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "snap_engine.h"
+#include "xbox3d.h"
+#include <algorithm>
+#include <cmath>
+
+boolean_engine::MeshSet_ptr snap_engine::snap(const carve::mesh::MeshSet<3>& mesh, double spacing)
+{
+   MeshSet_ptr copy(mesh.clone());
+   for(auto& vertex : copy->vertex_storage) {
+      for(size_t i=0; i<3; i++) vertex.v[i] = std::round(vertex.v[i]/spacing)*spacing;
+   }
+
+   // the face planes are cached, update them for the moved vertices
+   for(auto mesh : copy->meshes) {
+      for(auto face : mesh->faces) face->recalc();
+   }
+   return copy;
+}
+
+double snap_engine::grid_spacing(const carve::mesh::MeshSet<3>& a, const carve::mesh::MeshSet<3>& b, int nbits)
+{
+   xbox3d box(a);
+   box.enclose(xbox3d(b));
+   return grid_spacing(box,nbits);
+}
+
+double snap_engine::grid_spacing(const xbox3d& box, int nbits)
+{
+   // the largest coordinate magnitude decides the precision available
+   double extent = 0.0;
+   for(const xvertex* p : { &box.p1(), &box.p2() }) {
+      extent = std::max({ extent, std::fabs(p->x), std::fabs(p->y), std::fabs(p->z) });
+   }
+   if(extent <= 0.0) extent = 1.0;
+   return std::ldexp(1.0,std::ilogb(extent) + 1 - nbits);
+}
+
+boolean_engine::MeshSet_ptr snap_engine::compute(const MeshSet_ptr& a, const MeshSet_ptr& b, carve::csg::CSG::OP op) const
+{
+   int nbits = grid_bits;
+   for(int attempt=1; ; attempt++, nbits -= step_bits) {
+      double spacing = grid_spacing(*a,*b,nbits);
+      try {
+         MeshSet_ptr sa = snap(*a,spacing);
+         MeshSet_ptr sb = snap(*b,spacing);
+         carve::csg::CSG csg;
+         return MeshSet_ptr(csg.compute(sa.get(),sb.get(),op));
+      }
+      catch(carve::exception&) {
+         if(attempt == attempts) throw;
+      }
+   }
+}
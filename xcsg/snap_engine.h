@@ -0,0 +1,52 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef SNAP_ENGINE_H
+#define SNAP_ENGINE_H
+
+#include "boolean_engine.h"
+class xbox3d;
+
+// snap_engine rounds the vertices of both operands to a common grid before running carve.
+// Near-coincident vertices and faces from the two operands then become exactly coincident,
+// which carve handles consistently, instead of nearly touching, which makes carve fail.
+// The grid spacing is a power of 2 relative to the size of the operands, so the rounded
+// coordinates are exact. If carve still fails, the boolean is retried on a coarser grid,
+// the error of the last attempt is thrown.
+//
+// This is not an exact arithmetic engine, it removes the near-degenerate cases that carve's
+// floating point predicates cannot decide.
+
+class snap_engine : public boolean_engine {
+public:
+   // bits of the first grid relative to the operand size, each retry removes step_bits
+   static const int grid_bits = 36;
+   static const int step_bits = 6;
+   static const int attempts  = 3;
+
+   std::string name() const override { return "snap"; }
+   MeshSet_ptr compute(const MeshSet_ptr& a, const MeshSet_ptr& b, carve::csg::CSG::OP op) const override;
+
+   // return a copy of mesh with vertex coordinates rounded to multiples of spacing
+   static MeshSet_ptr snap(const carve::mesh::MeshSet<3>& mesh, double spacing);
+
+   // power of 2 grid spacing of nbits relative to the size of the boxes of a and b
+   static double grid_spacing(const carve::mesh::MeshSet<3>& a, const carve::mesh::MeshSet<3>& b, int nbits);
+
+   // power of 2 grid spacing of nbits relative to the largest coordinate magnitude of box
+   static double grid_spacing(const xbox3d& box, int nbits);
+};
+
+#endif // SNAP_ENGINE_H
@@ -1,12 +1,12 @@
 #include "svg_file.h"
 
-#include <sstream>
-#include <iomanip>
+#include <cstdio>
+#include <stdexcept>
 #include "clipper_csg/polyset2d.h"
+#include "char_buffer.h"
 #include <boost/filesystem.hpp>
 #include <boost/filesystem/convenience.hpp>
 
-#include "csg_parser/cf_xmlTree.h"
 
 svg_file::svg_file()
 {
@@ -34,6 +34,29 @@ std::string svg_file::write( std::shared_ptr<polyset2d> polyset, const std::stri
    // fix inconsistent slashes to something that is consistent and works everytwhere
    std::replace(path.begin(),path.end(), '\\', '/');
 
+   FILE* file = std::fopen(path.c_str(),"w");
+   if(!file)  throw std::runtime_error("Could not open file: " + path);
+   bool ok = false;
+   try {
+      ok = encode(polyset,fullpath.stem().string(),[file](char_buffer& buf) { return buf.flush(file); });
+   }
+   catch(...) {
+      std::fclose(file);
+      throw;
+   }
+   ok = (std::fclose(file) == 0) && ok;
+   if(!ok) throw std::runtime_error("Could not write file: " + path);
+
+   return path;
+}
+
+void svg_file::write( std::shared_ptr<polyset2d> polyset, std::ostream& out, const std::string& name)
+{
+   if(!encode(polyset,name,[&out](char_buffer& buf) { return buf.flush(out); })) throw std::runtime_error("Could not write SVG to stream");
+}
+
+bool svg_file::encode(std::shared_ptr<polyset2d> polyset, const std::string& name, std::function<bool(char_buffer&)> write)
+{
    // get bounding box of this polyset
    dbox2d box = polyset->bounding_box();
    dpos2d p1  = box.p1();
@@ -41,80 +64,54 @@ std::string svg_file::write( std::shared_ptr<polyset2d> polyset, const std::stri
    double dx  = p2.x() - p1.x();
    double dy  = p2.y() - p1.y();
 
-   cf_xmlTree tree;
-   if(tree.create_root("svg")) {
-      cf_xmlNode root;
-      if(tree.get_root(root)) {
-
-         // create some margin space for the viewBox
-         double mx = dx*0.03;
-         double my = dy*0.03;
-
-        // model bounding box, rounded up to nearest mm
-        // By NOT including these properties, the model will autofit to the canvas, e.g. in a browser
-        //
-        //  root.add_property("width",std::to_string(int(dx+2*mx))+"mm");
-        //  root.add_property("height",std::to_string(int(dy+2*my))+"mm");
-
-         dpos2d p = to_svg(p1,box);
-         std::ostringstream box_out;
-         box_out << -mx  << ' ' << -my << ' ' << dx+mx  << ' ' << dy+my;
-         root.add_property("viewBox",box_out.str());
-
-         // bureaucracy
-         root.add_property("xmlns","http://www.w3.org/2000/svg");
-         root.add_property("version","1.1");
-
-         // marketing
-         cf_xmlNode title = root.add_child("title");
-         title.put_value("xcsg: " +fullpath.stem().string());
-
-         // Create the model data, written as a giant "path", containing several closed contours with "pen-ups" between them.
-         // This loop creates the value of the "d" property
-         std::string svg_path;
-         for(auto i=polyset->begin(); i!=polyset->end(); i++) {
-            std::shared_ptr<polygon2d> poly = *i;
-            size_t nc = poly->size();
-            for(size_t ic=0;ic<nc;ic++) {
-               svg_path += write_contour(poly->get_contour(ic),box);
-            }
-         }
-
-         // create the one and only path tag, with properties and model data.
-
-         // set a stroke width that is adapted to the model size
-         ostringstream stroke_out;
-         stroke_out << std::setprecision(3) << (dx+dy)/1000;
-
-         cf_xmlNode path_tag = root.add_child("path");
-
-         // properties
-         path_tag.add_property("stroke","black");
-         path_tag.add_property("stroke-width",stroke_out.str());
-         path_tag.add_property("fill","lightgray");
-
-         // model data
-         path_tag.add_property("d",svg_path);
-
-         // write SVG to file
-         tree.write_xml(path);
+   // create some margin space for the viewBox
+   double mx = dx*0.03;
+   double my = dy*0.03;
+
+   // model bounding box, rounded up to nearest mm
+   // By NOT including width and height properties, the model will autofit to the canvas, e.g. in a browser
+   char_buffer out;
+   out.append("<?xml version=\"1.0\" encoding=\"utf-8\"?>\n");
+   out.append("<svg viewBox=\"").append(-mx).append(' ').append(-my).append(' ').append(dx+mx).append(' ').append(dy+my).append('"');
+   out.append(" xmlns=\"http://www.w3.org/2000/svg\" version=\"1.1\">\n");
+   out.append("\t<title>xcsg: ").append_xml(name).append("</title>\n");
+
+   // The model data is written as a giant "path", containing several closed contours with "pen-ups" between them.
+   // The stroke width is adapted to the model size
+   out.append("\t<path stroke=\"black\" stroke-width=\"").append((dx+dy)/1000,3).append("\" fill=\"lightgray\" d=\"");
+   bool ok = write(out);
+
+   // the contours are encoded in parallel chunks of about chunk_points points, and written in order
+   const size_t chunk_points = 1<<14;
+   std::vector<std::shared_ptr<contour2d>> contours;
+   std::vector<size_t> chunks(1,0);
+   size_t npoints = 0;
+   for(auto i=polyset->begin(); i!=polyset->end(); i++) {
+      std::shared_ptr<polygon2d> poly = *i;
+      size_t nc = poly->size();
+      for(size_t ic=0;ic<nc;ic++) {
+         contours.push_back(poly->get_contour(ic));
+         npoints += contours.back()->size();
+         if(npoints >= chunk_points) { chunks.push_back(contours.size()); npoints = 0; }
       }
    }
+   if(chunks.back() != contours.size()) chunks.push_back(contours.size());
 
-   return path;
-}
+   ok = char_buffer::write_ordered(chunks.size()-1,[this,&contours,&chunks,&box](size_t ichunk, char_buffer& buf) {
+      for(size_t ic=chunks[ichunk]; ic<chunks[ichunk+1]; ic++) write_contour(buf,contours[ic],box);
+   },write) && ok;
 
+   out.append("\"/>\n</svg>\n");
+   return write(out) && ok;
+}
 
-std::string svg_file::write_contour(std::shared_ptr<contour2d> contour, const dbox2d& box)
+void svg_file::write_contour(char_buffer& out, std::shared_ptr<contour2d> contour, const dbox2d& box)
 {
-   std::ostringstream out;
    for(size_t i=0; i<contour->size();i++) {
       const dpos2d& vtx = (*contour)[i];
       dpos2d p = to_svg(vtx,box);
-      if(i==0) out << " M ";
-      else     out << " L ";
-      out << p.x() << ',' << p.y();
+      out.append((i==0)? " M " : " L ");
+      out.append(p.x()).append(',').append(p.y());
    }
-   out << " z";
-   return out.str();
+   out.append(" z");
 }
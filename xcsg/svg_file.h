@@ -16,10 +16,12 @@
 #ifndef SVG_FILE_H
 #define SVG_FILE_H
 
+#include <functional>
 #include <memory>
 #include <string>
-#include <fstream>
+#include <ostream>
 #include "dmesh/dpos2d.h"
+class char_buffer;
 class polyset2d;
 class contour2d;
 class dbox2d;
@@ -33,11 +35,17 @@ public:
    // input is full path to file, file extension will be replaced to ".svg"
    std::string  write( std::shared_ptr<polyset2d> polyset, const std::string& file_path);
 
+   // export to SVG on a caller supplied stream, name is shown in the SVG title
+   void  write( std::shared_ptr<polyset2d> polyset, std::ostream& out, const std::string& name);
+
 private:
    dpos2d to_svg(const dpos2d& p, const dbox2d& box);
 
-   // convert the contour into an SVG path sequence
-   std::string write_contour(std::shared_ptr<contour2d> contour, const dbox2d& box);
+   // encode the SVG document, passing the text to write in order. Returns false on write error
+   bool encode(std::shared_ptr<polyset2d> polyset, const std::string& name, std::function<bool(char_buffer&)> write);
+
+   // append the contour as an SVG path sequence
+   void write_contour(char_buffer& out, std::shared_ptr<contour2d> contour, const dbox2d& box);
 };
 
 #endif // SVG_FILE_H
@@ -16,6 +16,8 @@
 #include "sweep_mesh.h"
 
 #include "mesh_utils.h"
+#include "thread_pool.h"
+#include <algorithm>
 #include <carve/matrix.hpp>
 
 
@@ -23,7 +25,9 @@ sweep_mesh::sweep_mesh(std::shared_ptr<sweep_path> path, bool torus)
 : m_path(path)
 , m_polyhedron(new xpolyhedron())
 , m_torus(torus)
-{}
+{
+   m_polyhedron->set_trusted(true);
+}
 
 sweep_mesh::~sweep_mesh()
 {}
@@ -38,49 +42,65 @@ std::shared_ptr<xpolyhedron> sweep_mesh::polyhedron()
 
 bool sweep_mesh::sweep()
 {
-   // obtain the number of sweep segments and the parameter step length
-   size_t nseg = m_path->nseg();
-   double dp = 1.0/double(nseg);
-
-   // traverse the sweep segments, i.e. parameter space p=[0,1]
-   size_t last_seg = nseg-1;
-   for(size_t iseg=0; iseg<nseg; iseg++) {
-
-      // obtain the transformed profile mesh at parameter value p, with all 3d coordinates already computed
-      double p = iseg*dp;
-      std::shared_ptr<const polymesh3d> mesh = m_path->profile(p);
-
-      // number of faces so far
-      // size_t f_offset  = m_polyhedron->f_size();
-
-      // offset to layer bottom vertices
-      size_t v_offset0 = m_polyhedron->v_size();
-      // add vertices for this layer by copying from the mesh
-      add_mesh_vertices(mesh);
-      // offset to layer top vertices can now be obtained
-      size_t v_offset1 =  m_polyhedron->v_size();
-
-      if(!m_torus && (iseg==0)) {
-         // 1st segment, add flipped faces from mesh
-         add_mesh_faces(v_offset0,mesh,true);
+   // obtain the number of sweep segments, the layer parameters are given by the path
+   const size_t nseg = m_path->nseg();
+
+   // All layers are transforms of the same profile, so the vertex and side face counts are known
+   // from the first layer. The vertex and face ranges of each layer can then be filled independently.
+   // Face order: side faces per segment, bottom face, top face (no bottom and top for a torus).
+   // The topology comes from the untransformed profiles, the layer vertices are transformed
+   // directly into the polyhedron storage without an intermediate polymesh3d per layer
+   std::shared_ptr<const polymesh2d> mesh0 = m_path->base_profile(0.0);
+   std::shared_ptr<const polymesh2d> mesh1 = (m_torus)? std::shared_ptr<const polymesh2d>() : m_path->base_profile(1.0);
+
+   const size_t nv = mesh0->nvertices();
+   size_t nside = 0;
+   for(size_t i=0; i<mesh0->ncontours(); i++) nside += mesh0->contour(i).size();
+
+   const size_t nlayer = (m_torus)? nseg : nseg+1;
+   m_polyhedron->v_resize(nlayer*nv);
+   m_polyhedron->f_resize(nseg*nside,4);
+
+   auto fill_layer = [this,nseg,nv,nside](size_t ilayer) {
+
+      const double p = m_path->layer_param(ilayer);
+      std::shared_ptr<const polymesh2d> mesh = m_path->base_profile(p);
+      if(mesh->nvertices() != nv) throw logic_error("sweep_mesh: profile vertex count changes along the path");
+
+      size_t v_offset0 = ilayer*nv;
+      m_path->layer_vertices(ilayer,m_polyhedron->v_range(v_offset0,nv));
+
+      if(ilayer < nseg) {
+         // connect the last side faces to bottom layer to create a topological torus
+         size_t v_offset1 = (m_torus && ilayer==nseg-1)? 0 : v_offset0+nv;
+         if(create_side_faces(ilayer*nside,v_offset0,v_offset1,mesh,false) != nside) {
+            throw logic_error("sweep_mesh: profile contours change along the path");
+         }
       }
+   };
 
-      if(m_torus && (iseg==last_seg)) {
-         // connect side faces to bottom layer to create a topological torus
-         v_offset1 = 0;
+   const size_t min_parallel_layers = 16;
+   if(nlayer < min_parallel_layers) {
+      for(size_t ilayer=0; ilayer<nlayer; ilayer++) fill_layer(ilayer);
+   }
+   else {
+      // contiguous layer ranges as thread pool tasks
+      const size_t ntask = std::min(nlayer,4*thread_pool::singleton().nthreads());
+      thread_pool::task_group group;
+      for(size_t itask=0; itask<ntask; itask++) {
+         size_t first = itask*nlayer/ntask;
+         size_t last  = (itask+1)*nlayer/ntask;
+         thread_pool::singleton().submit(group,[first,last,&fill_layer]() {
+            for(size_t ilayer=first; ilayer<last; ilayer++) fill_layer(ilayer);
+         });
       }
-
-      // create side faces
-      create_side_faces(v_offset0,v_offset1,mesh,false);
+      thread_pool::singleton().wait(group);
    }
 
    if(!m_torus) {
-      // add normally oriented faces on top
-      double p = 1.0;
-      std::shared_ptr<const polymesh3d> mesh = m_path->profile(p);
-      size_t v_offset0 = m_polyhedron->v_size();
-      add_mesh_vertices(mesh);
-      add_mesh_faces(v_offset0, mesh,false);
+      // flipped faces at the bottom, normally oriented faces on top
+      add_mesh_faces(0,mesh0,true);
+      add_mesh_faces(nseg*nv,mesh1,false);
    }
 
    // the polyhedron should now be complete
@@ -88,49 +108,47 @@ bool sweep_mesh::sweep()
    return true;
 }
 
-void sweep_mesh::add_mesh_vertices(std::shared_ptr<const polymesh3d> mesh)
-{
-   for(size_t iv=0; iv<mesh->nvertices(); iv++) {
-      m_polyhedron->v_add(mesh->vertex(iv));
-   }
-}
-
-void sweep_mesh::add_mesh_faces(size_t v_offset, std::shared_ptr<const polymesh3d> mesh, bool reverse)
+void sweep_mesh::add_mesh_faces(size_t v_offset, std::shared_ptr<const polymesh2d> mesh, bool reverse)
 {
    for(size_t i=0; i<mesh->nfaces(); i++) {
 
       // take a copy here
-      polymesh3d::index_vector vinds = mesh->face(i);
+      polymesh2d::index_vector vinds = mesh->face(i);
       for(size_t i=0;i<vinds.size();i++) {
          vinds[i] += v_offset;
       }
 
       // add face indicies with proper vertex offset
-      m_polyhedron->f_add(vinds,reverse);
+      m_polyhedron->f_add(vinds.begin(),vinds.end(),reverse);
    }
 }
 
 
-void sweep_mesh::create_side_faces(size_t v_offset0, // vertex offset to bottom layer vertices
-                                   size_t v_offset1, // vertex offset to top layer vertices
-                                   std::shared_ptr<const polymesh3d> mesh, bool reverse)
+size_t sweep_mesh::create_side_faces(size_t f_offset,  // face index of first side face
+                                     size_t v_offset0, // vertex offset to bottom layer vertices
+                                     size_t v_offset1, // vertex offset to top layer vertices
+                                     std::shared_ptr<const polymesh2d> mesh, bool reverse)
 {
    // v_offset = offset to 1st vertex in vertex layer below the faces to be created
+   size_t nface = 0;
 
    for(size_t i=0; i<mesh->ncontours(); i++) {
 
       // zero level vertex indicies for this contour
-      const polymesh3d::index_vector& vinds = mesh->contour(i);
+      const polymesh2d::index_vector& vinds = mesh->contour(i);
       size_t nvc = vinds.size();
 
       // we must create nvc faces, where the last face connects to the first
-      for(size_t ivc=0; ivc<nvc; ivc++) {
+      for(size_t ivc=0; ivc<nvc; ivc++, nface++) {
 
          size_t iv0 = v_offset0 + vinds[ivc];
          size_t iv1 = v_offset0 + ((ivc==(nvc-1))? vinds[0] : vinds[ivc+1]) ;
          size_t iv2 = iv1 + (v_offset1 - v_offset0);
          size_t iv3 = iv0 + (v_offset1 - v_offset0);
-         m_polyhedron->f_add( {iv0,iv1,iv2,iv3}, reverse );
+         size_t* face = m_polyhedron->f_range(f_offset+nface);
+         if(reverse) { face[0] = iv3; face[1] = iv2; face[2] = iv1; face[3] = iv0; }
+         else        { face[0] = iv0; face[1] = iv1; face[2] = iv2; face[3] = iv3; }
       }
    }
+   return nface;
 }
@@ -33,12 +33,15 @@ public:
    std::shared_ptr<xpolyhedron> polyhedron();
 
 private:
-   void add_mesh_vertices(std::shared_ptr<const polymesh3d> mesh);
-   void add_mesh_faces(size_t v_offset, std::shared_ptr<const polymesh3d> mesh, bool reverse);
-
-   void create_side_faces(size_t v_offset0, // vertex offset to bottom layer vertices
-                          size_t v_offset1, // vertex offset to top layer vertices
-                          std::shared_ptr<const polymesh3d> mesh, bool reverse);
+   // appends the faces of mesh, with vertex indices offset by v_offset
+   void add_mesh_faces(size_t v_offset, std::shared_ptr<const polymesh2d> mesh, bool reverse);
+
+   // fills a pre-sized range of side faces, may run concurrently for different layers
+   // returns the number of side faces created
+   size_t create_side_faces(size_t f_offset,  // face index of first side face
+                            size_t v_offset0, // vertex offset to bottom layer vertices
+                            size_t v_offset1, // vertex offset to top layer vertices
+                            std::shared_ptr<const polymesh2d> mesh, bool reverse);
 
 private:
    std::shared_ptr<sweep_path>  m_path;
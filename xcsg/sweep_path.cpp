@@ -20,3 +20,30 @@ sweep_path::sweep_path()
 
 sweep_path::~sweep_path()
 {}
+
+void sweep_path::profile_vertices(double p, xvertex* v) const
+{
+   polymesh3d::transform_vertices(*base_profile(p),transform(p),v);
+}
+
+carve::math::Matrix sweep_path::layer_transform(size_t ilayer) const
+{
+   return transform(layer_param(ilayer));
+}
+
+void sweep_path::layer_vertices(size_t ilayer, xvertex* v) const
+{
+   double p = layer_param(ilayer);
+   polymesh3d::transform_vertices(*base_profile(p),layer_transform(ilayer),v);
+}
+
+double sweep_path::layer_param(size_t ilayer) const
+{
+   size_t n = nseg();
+   return (ilayer < n)? double(ilayer)/double(n) : 1.0;
+}
+
+std::shared_ptr<const polymesh3d> sweep_path::profile(double p) const
+{
+   return std::shared_ptr<const polymesh3d>(new polymesh3d(base_profile(p),transform(p)));
+}
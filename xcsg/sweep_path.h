@@ -18,6 +18,7 @@
 
 #include <memory>
 #include "polymesh3d.h"
+#include "clipper_csg/polymesh2d.h"
 
 // sweep path is the abstract base for sweeping a 2d mesh to become a 3d mesh
 // The general approach taken before sweeping is
@@ -31,11 +32,33 @@ public:
    sweep_path();
    virtual ~sweep_path();
 
+   // return the untransformed profile at parameter p=[0,1]. It defines the face and contour topology
+   virtual std::shared_ptr<const polymesh2d> base_profile(double p) const = 0;
+
+   // return the transformation of the base profile at parameter p=[0,1]
+   virtual carve::math::Matrix transform(double p) const = 0;
+
+   // write the transformed profile vertices at parameter p=[0,1] to v,
+   // which must have room for base_profile(p)->nvertices() vertices
+   void profile_vertices(double p, xvertex* v) const;
+
+   // return the transformation of the base profile at layer ilayer=[0,nseg()]. The default is
+   // transform(layer_param(ilayer)), paths may return frames computed once for all layers
+   virtual carve::math::Matrix layer_transform(size_t ilayer) const;
+
+   // write the transformed profile vertices of layer ilayer=[0,nseg()] to v,
+   // which must have room for base_profile(layer_param(ilayer))->nvertices() vertices
+   void layer_vertices(size_t ilayer, xvertex* v) const;
+
    // return the transformed profile at parameter p=[0,1] in the form of a polymesh3d
-   virtual std::shared_ptr<const polymesh3d> profile(double p) const = 0;
+   std::shared_ptr<const polymesh3d> profile(double p) const;
 
    // return the number of segments for the parameter range [0,1]
    virtual size_t nseg() const = 0;
+
+   // return the path parameter of layer ilayer=[0,nseg()]. The default is uniform spacing,
+   // paths with varying curvature may return a non-uniform parameterization
+   virtual double layer_param(size_t ilayer) const;
 };
 
 #endif // SWEEP_PATH_H
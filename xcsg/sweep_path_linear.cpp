@@ -23,10 +23,14 @@ sweep_path_linear::sweep_path_linear(std::shared_ptr<const polymesh2d> pm2d, dou
 sweep_path_linear::~sweep_path_linear()
 {}
 
-std::shared_ptr<const polymesh3d> sweep_path_linear::profile(double p) const
+std::shared_ptr<const polymesh2d> sweep_path_linear::base_profile(double) const
 {
-   carve::math::Matrix t = carve::math::Matrix::TRANS(0.0,0.0,p*m_h);
-   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_pm2d,t));
+   return m_pm2d;
+}
+
+carve::math::Matrix sweep_path_linear::transform(double p) const
+{
+   return carve::math::Matrix::TRANS(0.0,0.0,p*m_h);
 }
 
 size_t sweep_path_linear::nseg() const
@@ -26,8 +26,11 @@ public:
    sweep_path_linear(std::shared_ptr<const polymesh2d> pm2d, double h);
    virtual ~sweep_path_linear();
 
-   // return the transformed profile at parameter p=[0,1] in the form of a polymesh3d
-   virtual std::shared_ptr<const polymesh3d> profile(double p) const;
+   // return the untransformed profile at parameter p=[0,1]
+   virtual std::shared_ptr<const polymesh2d> base_profile(double p) const;
+
+   // return the transformation of the base profile at parameter p=[0,1]
+   virtual carve::math::Matrix transform(double p) const;
 
    // return the number of segments for the parameter range [0,1]
    virtual size_t nseg() const;
@@ -23,7 +23,20 @@ sweep_path_rotate::sweep_path_rotate(std::shared_ptr<const polymesh2d> pm2d, dou
 , m_angle(angle)
 , m_nseg(nseg)
 , m_pitch(pitch)
+, m_pitch_radius(0.0)
 {
+   // the radius of the thread centre is constant along the path
+   if(fabs(pitch) > 0) {
+      double xmin = std::numeric_limits<double>::max();
+      double xmax = std::numeric_limits<double>::lowest();
+      for(size_t iv=0; iv<m_pm2d->nvertices(); iv++) {
+         const dpos2d& vtx = m_pm2d->vertex(iv);
+         xmax = std::max(xmax,vtx.x());
+         xmin = std::min(xmin,vtx.x());
+      }
+      m_pitch_radius = (xmax+xmin)/2.0;
+   }
+
    if(m_nseg < 1) {
 
       // estimate the max radius of the profile
@@ -49,7 +62,7 @@ sweep_path_rotate::sweep_path_rotate(std::shared_ptr<const polymesh2d> pm2d, dou
       double alpha = m_angle/nseg;
       // guard against multiples of 2*pi
       // the resulting segment angle must be less than PI/2
-      while( (fabs(alpha)>0.5*pi) || (radius*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance()) ) {
+      while( (fabs(alpha)>0.5*pi) || (radius*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance(radius)) ) {
          nseg += 1;
          alpha = m_angle/nseg;
       }
@@ -62,7 +75,12 @@ sweep_path_rotate::~sweep_path_rotate()
 {}
 
 
-std::shared_ptr<const polymesh3d> sweep_path_rotate::profile(double p) const
+std::shared_ptr<const polymesh2d> sweep_path_rotate::base_profile(double) const
+{
+   return m_pm2d;
+}
+
+carve::math::Matrix sweep_path_rotate::transform(double p) const
 {
    // negative rotate about Y
   double angle = p*fabs(m_angle);
@@ -82,17 +100,8 @@ std::shared_ptr<const polymesh3d> sweep_path_rotate::profile(double p) const
 
       double dy    = m_pitch*angle/(2*pi);
 
-
-      // obtain the Radius radius = 0.5*Dp of the center of the thread
-      double xmin = std::numeric_limits<double>::max();
-      double xmax = std::numeric_limits<double>::min();
-      for(size_t iv=0; iv!=m_pm2d->nvertices(); iv++) {
-         const dpos2d& vtx = m_pm2d->vertex(iv);
-         xmax = std::max(xmax,vtx.x());
-         xmin = std::min(xmin,vtx.x());
-      }
-      double radius = (xmax+xmin)/2.0;
-      double angle_pitch = atan(m_pitch/(2*pi*radius));
+      // radius = 0.5*Dp of the center of the thread
+      double angle_pitch = atan(m_pitch/(2*pi*m_pitch_radius));
 
       // tilt the profile around the global X axis to accomodate the pitch angle
       // notice the global sweep rotation axis is Y
@@ -102,8 +111,7 @@ std::shared_ptr<const polymesh3d> sweep_path_rotate::profile(double p) const
       t  =  carve::math::Matrix::TRANS(0.0,dy,0.0) * t  * rot_p ;
    };
 
-
-   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_pm2d,t));
+   return t;
 }
 
 size_t sweep_path_rotate::nseg() const
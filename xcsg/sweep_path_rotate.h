@@ -30,8 +30,11 @@ public:
    sweep_path_rotate(std::shared_ptr<const polymesh2d> pm2d, double angle, double pitch = 0.0, int nseg = -1);
    virtual ~sweep_path_rotate();
 
-   // return the transformed profile at parameter p=[0,1] in the form of a polymesh3d
-   virtual std::shared_ptr<const polymesh3d> profile(double p) const;
+   // return the untransformed profile at parameter p=[0,1]
+   virtual std::shared_ptr<const polymesh2d> base_profile(double p) const;
+
+   // return the transformation of the base profile at parameter p=[0,1]
+   virtual carve::math::Matrix transform(double p) const;
 
    // return the number of segments for the parameter range [0,1]
    virtual size_t nseg() const;
@@ -41,6 +44,7 @@ private:
    double                            m_angle;  // extrusion angle
    double                            m_pitch;
    int                               m_nseg;   // number of extrusion segments
+   double                            m_pitch_radius; // radius of the thread centre, where the pitch angle is measured
 };
 
 #endif // SWEEP_PATH_ROTATE_H
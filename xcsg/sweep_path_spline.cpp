@@ -15,7 +15,8 @@
 
 #include "sweep_path_spline.h"
 #include "mesh_utils.h"
-static const double pi = 4.0*atan(1.0);
+#include <algorithm>
+#include <queue>
 
 sweep_path_spline::sweep_path_spline(std::shared_ptr<const polymesh2d> pm2d, std::shared_ptr<const csplines::spline_path> path, int nseg)
 : m_pm2d(pm2d)
@@ -23,87 +24,49 @@ sweep_path_spline::sweep_path_spline(std::shared_ptr<const polymesh2d> pm2d, std
 , m_nseg(nseg)
 {
    if(nseg < 1) {
-
-      // estimate the max curvature of the path
-      std::shared_ptr<const csplines::spline_path> summed_path = path->summed_spline();
-      int nseg_sample = 20;
-      double c_max = summed_path->max_curvature(nseg_sample);
-      if(c_max > 1.0E-5) {
-
-         // start with a minimum of 2 segments and increase until the tolerance is satisfied
-         nseg = std::max(2,std::abs(nseg));
-
-         double radius = 1.0/c_max;
-         double angle  = 0.5*pi;   // Assuming 90 degree segment at given radius
-
-         double alpha = angle/nseg;
-         while( radius*(1.0-cos(0.5*alpha)) > mesh_utils::secant_tolerance() ) {
-            nseg += 1;
-            if(nseg > 512)break;
-            alpha = angle/nseg;
-         }
-
-         // we now have number of segments for a presumed 90 degree circular path at given radius
-         // scale actual number of segments by known path length
-
-         double arclen = 0.5*pi*radius;
-         double slen   = summed_path->length();
-         double factor = slen/arclen;
-
-         if(factor > 0.0) {
-            int nseg1 = static_cast<int>(nseg * slen/arclen);
-            nseg  = std::max(nseg,nseg1);
-         }
-      }
-
-      double srange = path->scaling_range();
-      if(srange > 0.0  && nseg == std::abs(m_nseg)) {
-         nseg = std::max(nseg,nseg*static_cast<int>(srange+0.5));
-      }
-
-      if(nseg == -1) {
-         // in case of a twisted straight curve, we just set 10 segments
-         csplines::cpoint v0 = path->dir(0.0);
-         csplines::cpoint v1 = path->dir(1.0);
-         double dvx = v1.vx - v0.vx;
-         double dvy = v1.vy - v0.vy;
-         double dvz = v1.vz - v0.vz;
-         if(sqrt(dvx*dvx+dvy*dvy+dvz*dvz) > 1.0E-3)nseg = 10;
-      }
+      // non-uniform layers from the local path geometry
+      adaptive_params();
+      m_nseg = static_cast<int>(m_param.size()-1);
    }
-   m_nseg = std::abs(nseg);
-
-   // use number of segments at least as fine grained as the number of control points in the path
-   if(path->size() >  static_cast<size_t>(m_nseg))m_nseg =  static_cast<int>(path->size());
+   else {
+      // use number of segments at least as fine grained as the number of control points in the path
+      if(path->size() >  static_cast<size_t>(m_nseg))m_nseg =  static_cast<int>(path->size());
+   }
+   compute_frames();
 }
 
 sweep_path_spline::~sweep_path_spline()
 {}
 
 
-std::shared_ptr<const polymesh3d> sweep_path_spline::profile(double p) const
+std::shared_ptr<const polymesh2d> sweep_path_spline::base_profile(double) const
+{
+   return m_pm2d;
+}
+
+typedef carve::geom::vector<3> vec3d;
+
+// transformation of the base profile to the path position cp with tangent and vector given by cp_dir.
+// The profile y axis follows the path vector, scaled by its length. When the path has no vector, it
+// follows yfree, or is guessed from the global axes when yfree is null
+static carve::math::Matrix path_frame(const csplines::cpoint& cp, const csplines::cpoint& cp_dir, const vec3d* yfree)
 {
-   typedef carve::geom::vector<3> vec3d;
-   const vec3d xglob = carve::geom::VECTOR( 1, 0, 0);
    const vec3d yglob = carve::geom::VECTOR( 0, 1, 0);
    const vec3d zglob = carve::geom::VECTOR( 0, 0, 1);
 
    carve::math::Matrix t = carve::math::Matrix::IDENT();
 
-   // get the curve point
-   csplines::cpoint cp = m_path->pos(p);
-
    // set curve position in transformation
    t.m[3][0] = cp.px;
    t.m[3][1] = cp.py;
    t.m[3][2] = cp.pz;
 
-   // get the profile normal vector at parameter p
-   csplines::cpoint cp_dir = m_path->dir(p);
-
    vec3d zdir = carve::geom::VECTOR( cp_dir.px, cp_dir.py, cp_dir.pz).normalize();
    vec3d ydir = carve::geom::VECTOR( cp_dir.vx, cp_dir.vy, cp_dir.vz);
 
+   if(!(ydir.length() > 0.0) && yfree) {
+      ydir = *yfree;
+   }
    if(!(ydir.length() > 0.0) ) {
       // ydir must be guesstimated
       ydir = carve::geom::cross(zdir,yglob).normalize();
@@ -134,11 +97,157 @@ std::shared_ptr<const polymesh3d> sweep_path_spline::profile(double p) const
    // profile scaling
    carve::math::Matrix tscale = carve::math::Matrix::SCALE(scale,scale,1.0);
 
-   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_pm2d,t*tscale));
+   return t*tscale;
+}
+
+carve::math::Matrix sweep_path_spline::transform(double p) const
+{
+   return path_frame(m_path->pos(p),m_path->dir(p),nullptr);
+}
+
+void sweep_path_spline::compute_frames()
+{
+   // evaluate the path at all layer parameters at once, the intervals are located incrementally
+   const size_t nlayer = nseg()+1;
+   std::vector<double> param(nlayer);
+   for(size_t ilayer=0; ilayer<nlayer; ilayer++) param[ilayer] = layer_param(ilayer);
+   std::vector<csplines::cpoint> pos,dir;
+   m_path->eval(param,pos,dir);
+
+   m_frames.clear();
+   m_frames.reserve(nlayer);
+   vec3d yprev;
+   for(size_t ilayer=0; ilayer<nlayer; ilayer++) {
+      vec3d yfree;
+      const vec3d* yfree_ptr = nullptr;
+      if(ilayer > 0) {
+         // rotation minimizing frame by double reflection (Wang et al. 2008): reflect the previous
+         // y axis and tangent in the bisector plane of the positions, then in the plane between the tangents
+         const csplines::cpoint& c0 = pos[ilayer-1];
+         const csplines::cpoint& c1 = pos[ilayer];
+         vec3d t0 = carve::geom::VECTOR(dir[ilayer-1].px,dir[ilayer-1].py,dir[ilayer-1].pz).normalize();
+         vec3d t1 = carve::geom::VECTOR(dir[ilayer].px,dir[ilayer].py,dir[ilayer].pz).normalize();
+         vec3d v1 = carve::geom::VECTOR(c1.px-c0.px,c1.py-c0.py,c1.pz-c0.pz);
+         yfree = yprev;
+         vec3d tl = t0;
+         double q1 = carve::geom::dot(v1,v1);
+         if(q1 > 0.0) {
+            yfree = yfree - (2.0/q1)*carve::geom::dot(v1,yfree)*v1;
+            tl    = tl    - (2.0/q1)*carve::geom::dot(v1,tl)*v1;
+         }
+         vec3d v2 = t1 - tl;
+         double q2 = carve::geom::dot(v2,v2);
+         if(q2 > 0.0) yfree = yfree - (2.0/q2)*carve::geom::dot(v2,yfree)*v2;
+         yfree_ptr = &yfree;
+      }
+      m_frames.push_back(path_frame(pos[ilayer],dir[ilayer],yfree_ptr));
+
+      // unit y axis of this layer, carried to the next
+      const carve::math::Matrix& t = m_frames.back();
+      yprev = carve::geom::VECTOR(t.m[1][0],t.m[1][1],t.m[1][2]).normalize();
+   }
 }
 
+carve::math::Matrix sweep_path_spline::layer_transform(size_t ilayer) const
+{
+   return m_frames[std::min(ilayer,m_frames.size()-1)];
+}
 
 size_t sweep_path_spline::nseg() const
 {
    return std::max(1,m_nseg);
 }
+
+double sweep_path_spline::layer_param(size_t ilayer) const
+{
+   if(m_param.size() == 0) return sweep_path::layer_param(ilayer);
+   return m_param[std::min(ilayer,m_param.size()-1)];
+}
+
+double sweep_path_spline::deviation(double a, double b) const
+{
+   const carve::math::Matrix ta = transform(a);
+   const carve::math::Matrix tb = transform(b);
+
+   // the sweep between two layers is linear, compare with the exact profile at interior points.
+   // Several points are checked so that an S-bend within the interval is not missed
+   double dmax = 0.0;
+   const double fracs[] = { 0.25, 0.5, 0.75 };
+   for(double f : fracs) {
+      const carve::math::Matrix tp = transform(a + f*(b-a));
+      for(const xvertex& v : m_test) {
+         xvertex va = ta*v;
+         xvertex vb = tb*v;
+         xvertex vp = tp*v;
+         double dx = vp.x - ((1.0-f)*va.x + f*vb.x);
+         double dy = vp.y - ((1.0-f)*va.y + f*vb.y);
+         double dz = vp.z - ((1.0-f)*va.z + f*vb.z);
+         dmax = std::max(dmax,sqrt(dx*dx+dy*dy+dz*dz));
+      }
+   }
+   return dmax;
+}
+
+void sweep_path_spline::adaptive_params()
+{
+   // the profile extremes see the largest deviation from bending, twist and scaling.
+   // The bounding box corners enclose them, the origin follows the path itself
+   double xmin=0.0,xmax=0.0,ymin=0.0,ymax=0.0;
+   for(size_t i=0; i<m_pm2d->nvertices(); i++) {
+      const dpos2d& v = m_pm2d->vertex(i);
+      xmin = std::min(xmin,v.x()); xmax = std::max(xmax,v.x());
+      ymin = std::min(ymin,v.y()); ymax = std::max(ymax,v.y());
+   }
+   m_test.clear();
+   m_test.push_back(carve::geom::VECTOR(0.0,0.0,0.0));
+   m_test.push_back(carve::geom::VECTOR(xmin,ymin,0.0));
+   m_test.push_back(carve::geom::VECTOR(xmax,ymin,0.0));
+   m_test.push_back(carve::geom::VECTOR(xmax,ymax,0.0));
+   m_test.push_back(carve::geom::VECTOR(xmin,ymax,0.0));
+
+   const double tol      = mesh_utils::secant_tolerance();
+   const size_t max_seg  = 512;
+   const double min_step = 1.0E-6;
+
+   // initial intervals of equal arc length, at least one per control point so that no path feature is skipped
+   const size_t nseed = std::max(size_t(4),m_path->size());
+   const double slen  = m_path->arc_length();
+
+   // refine the interval with the largest deviation first, until all are within tolerance
+   typedef std::pair<double,std::pair<double,double>> interval;  // (deviation,(a,b))
+   std::priority_queue<interval> queue;
+   for(size_t i=0; i<nseed; i++) {
+      double a = (i>0)? m_path->arc_param(slen*i/nseed) : 0.0;
+      double b = (i+1<nseed)? m_path->arc_param(slen*(i+1)/nseed) : 1.0;
+      queue.push(std::make_pair(deviation(a,b),std::make_pair(a,b)));
+   }
+   while(queue.size() < max_seg && queue.top().first > tol) {
+      interval iv = queue.top();
+      double a = iv.second.first;
+      double b = iv.second.second;
+      if(b-a < min_step) break;
+      queue.pop();
+      double m = 0.5*(a+b);
+      queue.push(std::make_pair(deviation(a,m),std::make_pair(a,m)));
+      queue.push(std::make_pair(deviation(m,b),std::make_pair(m,b)));
+   }
+
+   std::vector<double> param;
+   param.reserve(queue.size()+1);
+   param.push_back(0.0);
+   while(!queue.empty()) {
+      param.push_back(queue.top().second.second);
+      queue.pop();
+   }
+   std::sort(param.begin(),param.end());
+
+   // the seed intervals may be finer than needed on straight sections, so
+   // drop interior layers where the merged interval is still within tolerance
+   m_param.clear();
+   m_param.reserve(param.size());
+   m_param.push_back(param[0]);
+   for(size_t i=1; i+1<param.size(); i++) {
+      if(deviation(m_param.back(),param[i+1]) > tol) m_param.push_back(param[i]);
+   }
+   m_param.push_back(1.0);
+}
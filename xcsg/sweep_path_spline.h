@@ -25,18 +25,41 @@ public:
    sweep_path_spline(std::shared_ptr<const polymesh2d> pm2d, std::shared_ptr<const csplines::spline_path> path, int nseg=-1);
    virtual ~sweep_path_spline();
 
-   // return the transformed profile at parameter p=[0,1] in the form of a polymesh3d
-   virtual std::shared_ptr<const polymesh3d> profile(double p) const;
+   // return the untransformed profile at parameter p=[0,1]
+   virtual std::shared_ptr<const polymesh2d> base_profile(double p) const;
+
+   // return the transformation of the base profile at parameter p=[0,1]
+   virtual carve::math::Matrix transform(double p) const;
 
    // return the number of segments for the parameter range [0,1]
    virtual size_t nseg() const;
 
+   // return the path parameter of layer ilayer=[0,nseg()]
+   virtual double layer_param(size_t ilayer) const;
+
+   // return the transformation of layer ilayer=[0,nseg()] from the frame table
+   virtual carve::math::Matrix layer_transform(size_t ilayer) const;
+
 protected:
+   // place the layers by local bending, twist and scaling of the path, so that
+   // the swept profile deviates less than the secant tolerance from the exact sweep
+   void adaptive_params();
+
+   // max deviation of the profile test points between parameters a and b,
+   // relative to linear interpolation between the layers at a and b
+   double deviation(double a, double b) const;
+
+   // compute the frames of all layers in one pass over the layer parameters. Where the path has no
+   // vector, the frame is carried from the previous layer by double reflection, so it does not twist
+   void compute_frames();
 
 private:
    std::shared_ptr<const polymesh2d>            m_pm2d;
    std::shared_ptr<const csplines::spline_path> m_path;
    int                                          m_nseg;   // number of sweep segments
+   std::vector<double>                          m_param;  // adaptive layer parameters, empty for uniform layers
+   std::vector<xvertex>                         m_test;   // profile points used for measuring deviation
+   std::vector<carve::math::Matrix>             m_frames; // transformation of each layer
 };
 
 #endif // SWEEP_PATH_SPLINE_H
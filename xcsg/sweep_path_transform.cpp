@@ -26,12 +26,14 @@ sweep_path_transform::sweep_path_transform(const carve::math::Matrix& t_bot, std
 sweep_path_transform::~sweep_path_transform()
 {}
 
-std::shared_ptr<const polymesh3d> sweep_path_transform::profile(double p) const
+std::shared_ptr<const polymesh2d> sweep_path_transform::base_profile(double p) const
 {
-   if(p>0.0){
-     return std::shared_ptr<const polymesh3d>(new polymesh3d(m_top,m_t_top));
-   }
-   return std::shared_ptr<const polymesh3d>(new polymesh3d(m_bot,m_t_bot));
+   return (p>0.0)? m_top : m_bot;
+}
+
+carve::math::Matrix sweep_path_transform::transform(double p) const
+{
+   return (p>0.0)? m_t_top : m_t_bot;
 }
 
 size_t sweep_path_transform::nseg() const
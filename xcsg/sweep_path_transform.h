@@ -28,8 +28,11 @@ public:
                         const carve::math::Matrix& t_top, std::shared_ptr<const polymesh2d> top);
    virtual ~sweep_path_transform();
 
-   // return the transformed profile at parameter p=[0,1] in the form of a polymesh3d
-   virtual std::shared_ptr<const polymesh3d> profile(double p) const;
+   // return the untransformed profile at parameter p=[0,1]
+   virtual std::shared_ptr<const polymesh2d> base_profile(double p) const;
+
+   // return the transformation of the base profile at parameter p=[0,1]
+   virtual carve::math::Matrix transform(double p) const;
 
    // return the number of segments for the parameter range [0,1]
    virtual size_t nseg() const;
@@ -0,0 +1,325 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "thread_pool.h"
+#include "compile_context.h"
+#include "perf_counters.h"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#if defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// index of the pool worker running in this thread, npos outside the pool
+static thread_local size_t tl_worker = static_cast<size_t>(-1);
+
+thread_pool::thread_pool()
+: m_nthreads(0)
+, m_started(false)
+, m_stop(false)
+, m_queued(0)
+, m_pin(false)
+{}
+
+thread_pool::~thread_pool()
+{
+   m_stop = true;
+   notify_all();
+   for(auto& thread : m_threads) {
+      thread.join();
+   }
+}
+
+void thread_pool::set_nthreads(size_t nthreads)
+{
+   std::lock_guard<std::mutex> lock(m_start_mutex);
+   if(!m_started) m_nthreads = nthreads;
+}
+
+void thread_pool::set_pinning(bool pin)
+{
+   std::lock_guard<std::mutex> lock(m_start_mutex);
+   if(!m_started) m_pin = pin;
+}
+
+// parse a Linux cpu list such as "0-5,12-17"
+static std::vector<int> parse_cpulist(const std::string& text)
+{
+   std::vector<int> cpus;
+   std::istringstream in(text);
+   std::string range;
+   while(std::getline(in,range,',')) {
+      int first = 0, last = 0;
+      char dash = 0;
+      std::istringstream rin(range);
+      if(!(rin >> first)) continue;
+      last = first;
+      if(rin >> dash >> last && dash != '-') last = first;
+      for(int cpu=first; cpu<=last; cpu++) cpus.push_back(cpu);
+   }
+   return cpus;
+}
+
+// the cores of each NUMA node that this process may run on, one node holding all cores if unknown
+static std::vector<std::vector<int>> numa_cpus()
+{
+   std::vector<std::vector<int>> nodes;
+#if defined(__linux__)
+   cpu_set_t allowed;
+   CPU_ZERO(&allowed);
+   bool have_allowed = (sched_getaffinity(0,sizeof(allowed),&allowed) == 0);
+
+   for(size_t inode=0; ; inode++) {
+      std::ifstream in("/sys/devices/system/node/node" + std::to_string(inode) + "/cpulist");
+      if(!in.is_open()) break;
+      std::string text;
+      std::getline(in,text);
+      std::vector<int> cpus;
+      for(int cpu : parse_cpulist(text)) {
+         if(!have_allowed || (cpu < CPU_SETSIZE && CPU_ISSET(cpu,&allowed))) cpus.push_back(cpu);
+      }
+      if(cpus.size() > 0) nodes.push_back(cpus);
+   }
+   if(nodes.size() == 0 && have_allowed) {
+      std::vector<int> cpus;
+      for(int cpu=0; cpu<CPU_SETSIZE; cpu++) {
+         if(CPU_ISSET(cpu,&allowed)) cpus.push_back(cpu);
+      }
+      if(cpus.size() > 0) nodes.push_back(cpus);
+   }
+#endif
+   return nodes;
+}
+
+void thread_pool::place_workers(size_t nworkers)
+{
+   m_worker_node.assign(nworkers,0);
+   m_worker_cpu.assign(nworkers,-1);
+   if(!m_pin) return;
+
+   std::vector<std::vector<int>> nodes = numa_cpus();
+   if(nodes.size() == 0) return;
+
+   // consecutive workers share a node, each node gets its share of the workers
+   std::vector<size_t> used(nodes.size(),0);
+   for(size_t i=0; i<nworkers; i++) {
+      size_t inode = i*nodes.size()/nworkers;
+      std::vector<int>& cpus = nodes[inode];
+      m_worker_node[i] = inode;
+      m_worker_cpu[i]  = cpus[used[inode]++ % cpus.size()];
+   }
+}
+
+size_t thread_pool::nthreads() const
+{
+   if(m_started) return m_worker_queues.size();
+   if(m_nthreads > 0) return m_nthreads;
+   size_t hw = boost::thread::hardware_concurrency();
+   return (hw > 0)? hw : 1;
+}
+
+void thread_pool::start()
+{
+   if(m_started) return;
+
+   std::lock_guard<std::mutex> lock(m_start_mutex);
+   if(m_started) return;
+
+   size_t nworkers = nthreads();
+   place_workers(nworkers);
+   m_worker_queues.reserve(nworkers);
+   for(size_t i=0; i<nworkers; i++) {
+      m_worker_queues.push_back(std::unique_ptr<worker_queue>(new worker_queue));
+   }
+   for(size_t i=0; i<nworkers; i++) {
+      m_threads.push_back(boost::thread(&thread_pool::worker_run,this,i));
+   }
+   m_started = true;
+}
+
+int thread_pool::current_worker()
+{
+   return (tl_worker != npos)? static_cast<int>(tl_worker) : -1;
+}
+
+void thread_pool::submit(task_group& group, task t)
+{
+   start();
+
+   group.m_pending++;
+   m_queued++;
+
+   // workers push to their own deque, others to the shared queue
+   worker_queue& wq = (tl_worker != npos)? *m_worker_queues[tl_worker] : m_shared_queue;
+   {
+      std::lock_guard<std::mutex> lock(wq.m);
+      wq.q.push_back(entry{&group,t,compile_context::current()});
+   }
+   notify_all();
+}
+
+void thread_pool::wait(task_group& group)
+{
+   while(!group.done()) {
+      entry e;
+      if(try_pop(tl_worker,e)) {
+         execute(e);
+      }
+      else {
+         std::unique_lock<std::mutex> lock(m_sleep_mutex);
+         m_sleep_cond.wait(lock,[&]{ return group.done() || m_queued>0; });
+      }
+   }
+
+   if(group.m_exception_queue.size() > 0) {
+      throw std::logic_error(group.m_exception_queue.dequeue());
+   }
+   if(group.m_skipped) throw_if_cancelled();
+}
+
+void thread_pool::cancel(const std::string& msg)
+{
+   compile_context* ctx = compile_context::current();
+   if(ctx) ctx->cancel(msg);
+}
+
+bool thread_pool::cancelled() const
+{
+   compile_context* ctx = compile_context::current();
+   return ctx && ctx->cancelled();
+}
+
+void thread_pool::throw_if_cancelled() const
+{
+   compile_context* ctx = compile_context::current();
+   if(ctx) ctx->throw_if_cancelled();
+}
+
+void thread_pool::worker_run(size_t iworker)
+{
+   tl_worker = iworker;
+   perf_counters::singleton().register_thread(static_cast<int>(iworker));
+
+#if defined(__linux__)
+   // memory is allocated on the node of the thread touching it first, so a pinned worker
+   // keeps its own allocations local
+   if(m_worker_cpu[iworker] >= 0) {
+      cpu_set_t cpuset;
+      CPU_ZERO(&cpuset);
+      CPU_SET(m_worker_cpu[iworker],&cpuset);
+      pthread_setaffinity_np(pthread_self(),sizeof(cpuset),&cpuset);
+   }
+#endif
+
+   while(!m_stop) {
+      entry e;
+      if(try_pop(iworker,e)) {
+         execute(e);
+      }
+      else {
+         std::unique_lock<std::mutex> lock(m_sleep_mutex);
+         m_sleep_cond.wait(lock,[&]{ return m_stop || m_queued>0; });
+      }
+   }
+}
+
+bool thread_pool::try_pop(size_t iworker, entry& e)
+{
+   if(m_queued == 0) return false;
+
+   // own tasks first, most recent first
+   if(iworker != npos) {
+      worker_queue& wq = *m_worker_queues[iworker];
+      std::lock_guard<std::mutex> lock(wq.m);
+      if(!wq.q.empty()) {
+         e = wq.q.back();
+         wq.q.pop_back();
+         m_queued--;
+         return true;
+      }
+   }
+
+   // then tasks submitted from outside the pool
+   {
+      std::lock_guard<std::mutex> lock(m_shared_queue.m);
+      if(!m_shared_queue.q.empty()) {
+         e = m_shared_queue.q.front();
+         m_shared_queue.q.pop_front();
+         m_queued--;
+         return true;
+      }
+   }
+
+   // finally steal the oldest task from another worker, from workers on the same NUMA node first
+   size_t nworkers = m_worker_queues.size();
+   for(size_t pass=0; pass<2; pass++) {
+      for(size_t i=1; i<=nworkers; i++) {
+         size_t ivictim = (iworker==npos)? i-1 : (iworker+i)%nworkers;
+         if(ivictim == iworker) continue;
+         if(iworker != npos) {
+            bool same_node = (m_worker_node[ivictim] == m_worker_node[iworker]);
+            if(same_node != (pass == 0)) continue;
+         }
+         else if(pass > 0) break;
+         worker_queue& wq = *m_worker_queues[ivictim];
+         std::lock_guard<std::mutex> lock(wq.m);
+         if(!wq.q.empty()) {
+            e = wq.q.front();
+            wq.q.pop_front();
+            m_queued--;
+            return true;
+         }
+      }
+   }
+   return false;
+}
+
+void thread_pool::execute(entry& e)
+{
+   // the task runs in the compilation it was submitted from, also when executed by a thread waiting for another
+   compile_context::scope scope(e.ctx);
+
+   // after a failure the remaining tasks are dropped, their group rethrows the failure
+   if(e.ctx && e.ctx->cancelled()) {
+      e.group->m_skipped = true;
+   }
+   else {
+      try {
+         e.t();
+      }
+      catch(std::exception& ex) {
+         e.group->m_exception_queue.enqueue(ex.what());
+         cancel(ex.what());
+      }
+      catch(...) {
+         e.group->m_exception_queue.enqueue("thread_pool: unknown exception in task");
+         cancel("thread_pool: unknown exception in task");
+      }
+   }
+
+   // the group may be destroyed by its waiter as soon as pending reaches zero
+   if(--e.group->m_pending == 0) {
+      notify_all();
+   }
+}
+
+void thread_pool::notify_all()
+{
+   // taking the lock makes sure a thread between predicate check and wait does not miss the notification
+   { std::lock_guard<std::mutex> lock(m_sleep_mutex); }
+   m_sleep_cond.notify_all();
+}
@@ -0,0 +1,156 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <string>
+#include <vector>
+#include <boost/thread.hpp>
+#include "safe_queue.h"
+class compile_context;
+
+// thread_pool is the process wide work-stealing pool used by all CSG nodes.
+// Each worker owns a task deque: it pops its own tasks LIFO and steals from
+// the other workers FIFO. Tasks submitted from outside the pool go to a shared queue.
+//
+// Tasks are submitted as part of a task_group. A thread waiting for a group
+// keeps executing queued tasks until the group is complete, so nested CSG
+// nodes can wait for their children without blocking a worker.
+//
+// With pinning, each worker is bound to a core. The workers are placed on the NUMA nodes in
+// blocks, and a worker steals from workers on its own node before the others. A task submitted by
+// a worker is then mostly run on the same node, where its memory was allocated (first touch) and
+// where its parent consumes the result.
+//
+// Each task runs with the compile_context of the thread that submitted it. The first task
+// failure cancels that compilation: its queued tasks are skipped instead of run, and long
+// running tasks poll cancelled() between their work items. Waiting for a group with skipped
+// tasks rethrows the first failure. Tasks of other compilations are not affected.
+
+class thread_pool {
+public:
+   typedef std::function<void()> task;
+
+   // task_group counts the outstanding tasks submitted together
+   // and collects the error messages from tasks that failed
+   class task_group {
+   public:
+      task_group() : m_pending(0), m_skipped(false) {}
+      bool done() const { return m_pending == 0; }
+   private:
+      friend class thread_pool;
+      std::atomic<size_t>     m_pending;
+      std::atomic<bool>       m_skipped;   // tasks were not run because the pool was cancelled
+      safe_queue<std::string> m_exception_queue;
+   };
+
+   static thread_pool& singleton()  { static thread_pool instance; return instance;  }
+
+   // number of worker threads, 0 means hardware concurrency.
+   // Must be called before the first task is submitted to have effect.
+   void set_nthreads(size_t nthreads);
+
+   // number of worker threads in the pool
+   size_t nthreads() const;
+
+   // pin the worker threads to cores, see above. Only supported on Linux.
+   // Must be called before the first task is submitted to have effect.
+   void set_pinning(bool pin);
+
+   // number of tasks waiting in the queues
+   size_t queued() const { return m_queued; }
+
+   // index of the worker thread calling, or -1 for threads outside the pool
+   static int current_worker();
+
+   // submit a task as part of group
+   void submit(task_group& group, task t);
+
+   // wait for all tasks in group to complete, executing other queued tasks meanwhile.
+   // If any task failed, the first error is rethrown as std::logic_error
+   void wait(task_group& group);
+
+   // cancel the outstanding work of the current compilation after a failure with message msg
+   void cancel(const std::string& msg);
+
+   // true after a failure in the current compilation
+   bool cancelled() const;
+
+   // throw the first failure of the current compilation as std::logic_error if it is cancelled
+   void throw_if_cancelled() const;
+
+protected:
+   thread_pool();
+   virtual ~thread_pool();
+
+   struct entry {
+      task_group*      group;
+      task             t;
+      compile_context* ctx;   // context of the submitting thread
+   };
+
+   struct worker_queue {
+      std::mutex        m;
+      std::deque<entry> q;
+   };
+
+   // start worker threads unless already running
+   void start();
+
+   // the worker thread function
+   void worker_run(size_t iworker);
+
+   // assign the workers to NUMA nodes and cores, when pinning
+   void place_workers(size_t nworkers);
+
+   // pick a task. iworker is the index of calling worker or npos for threads outside the pool
+   bool try_pop(size_t iworker, entry& e);
+
+   // execute a task and signal its group
+   void execute(entry& e);
+
+   // wake threads sleeping in worker_run or wait
+   void notify_all();
+
+private:
+   static const size_t npos = static_cast<size_t>(-1);
+
+   std::mutex                                   m_start_mutex;
+   size_t                                       m_nthreads;
+   std::atomic<bool>                            m_started;
+   std::atomic<bool>                            m_stop;
+   std::atomic<size_t>                          m_queued;    // number of tasks waiting in queues
+
+   bool                                         m_pin;
+   std::vector<size_t>                          m_worker_node;   // NUMA node of each worker, 0 without pinning
+   std::vector<int>                             m_worker_cpu;    // core of each worker, -1 without pinning
+
+   std::vector<std::unique_ptr<worker_queue>>   m_worker_queues;
+   worker_queue                                 m_shared_queue;
+   std::list<boost::thread>                     m_threads;
+
+   std::mutex                                   m_sleep_mutex;
+   std::condition_variable                      m_sleep_cond;
+};
+
+#endif // THREAD_POOL_H
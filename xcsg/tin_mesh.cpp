@@ -16,12 +16,32 @@
 #include "tin_mesh.h"
 #include "dmesh/dmesh.h"
 #include "dmesh/dtriangle.h"
+#include "dmesh/dedge.h"
+#include "thread_pool.h"
 #include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdint>
 #include <iostream>
+#include <limits>
+#include <random>
+#include <unordered_map>
+#include <unordered_set>
+
+// smallest number of points per strip worth a separate triangulation
+static const size_t min_strip_points = 50000;
 
 std::shared_ptr<tin_mesh::tpoly> tin_mesh::make_tin(std::shared_ptr<tpoly> poly)
 {
+   size_t nstrips = std::min(thread_pool::singleton().nthreads(),poly->m_vert.size()/min_strip_points);
+   if(nstrips < 2 || !triangulate_strips(poly,nstrips)) {
+      triangulate_serial(poly);
+   }
+   return close_tin(poly);
+}
 
+void tin_mesh::triangulate_serial(std::shared_ptr<tpoly> poly)
+{
    dmesh mesh;
 
    // convert 3d points to 2d
@@ -35,21 +55,223 @@ std::shared_ptr<tin_mesh::tpoly> tin_mesh::make_tin(std::shared_ptr<tpoly> poly)
    mesh.triangulate_point_cloud(points);
 
    // get triangles
-   poly->m_face.reserve(mesh.size());
+   poly->m_tri.clear();
+   poly->m_tri.reserve(3*mesh.size());
+   for(dtriangle* t : mesh) {
+      poly->m_tri.push_back(t->vertex1()-3);
+      poly->m_tri.push_back(t->vertex2()-3);
+      poly->m_tri.push_back(t->vertex3()-3);
+   }
+}
+
+bool tin_mesh::triangulate_strips(std::shared_ptr<tpoly> poly, size_t nstrips)
+{
+   typedef std::array<size_t,3> tri;
+   const size_t npoints = poly->m_vert.size();
+
+   // bounding box of the points
+   double xmin = poly->m_vert[0].x, xmax = xmin;
+   double ymin = poly->m_vert[0].y, ymax = ymin;
+   for(auto& v : poly->m_vert) {
+      xmin = std::min(xmin,v.x);  xmax = std::max(xmax,v.x);
+      ymin = std::min(ymin,v.y);  ymax = std::max(ymax,v.y);
+   }
+   const double extent = std::max(xmax-xmin,ymax-ymin);
+   if(extent <= 0.0) return false;
+
+   // Survey points are often on a regular grid, i.e. cocircular. Each triangulation could then
+   // resolve the ties differently, so all of them work on the same slightly perturbed positions
+   std::vector<dpos2d> pos;
+   pos.reserve(npoints);
+   std::mt19937 rng(5489);
+   std::uniform_real_distribution<double> perturb(-1.0E-10*extent,1.0E-10*extent);
+   for(auto& v : poly->m_vert) {
+      double dx = perturb(rng);
+      double dy = perturb(rng);
+      pos.push_back(dpos2d(v.x+dx,v.y+dy));
+   }
+
+   // split into strips of equal point count along x
+   std::vector<size_t> order(npoints);
+   for(size_t i=0; i<npoints; i++) order[i] = i;
+   std::sort(order.begin(),order.end(),[&pos](size_t a, size_t b) { return pos[a].x() < pos[b].x(); });
+
+   std::vector<size_t> first(nstrips+1);
+   for(size_t is=0; is<=nstrips; is++) first[is] = is*npoints/nstrips;
+
+   // all points of other strips are at or outside the limits (xlo,xhi) of a strip
+   const double inf = std::numeric_limits<double>::infinity();
+   std::vector<double> xlo(nstrips), xhi(nstrips);
+   for(size_t is=0; is<nstrips; is++) {
+      xlo[is] = (is > 0)?         pos[order[first[is]-1]].x() : -inf;
+      xhi[is] = (is+1 < nstrips)? pos[order[first[is+1]]].x() :  inf;
+   }
+
+   // triangulate the strips concurrently. A triangle with its circumcircle inside the strip
+   // limits is part of the complete triangulation, the others are retriangulated below
+   const double margin = 1.0E-9*extent;
+   std::vector<std::vector<tri>>    safe(nstrips);
+   std::vector<std::vector<size_t>> seam(nstrips);
+   thread_pool::task_group group;
+   for(size_t is=0; is<nstrips; is++) {
+      thread_pool::singleton().submit(group,[is,&pos,&order,&first,&xlo,&xhi,margin,&safe,&seam]() {
+         std::vector<dpos2d> points;
+         points.reserve(first[is+1]-first[is]);
+         for(size_t i=first[is]; i<first[is+1]; i++) points.push_back(pos[order[i]]);
+
+         dmesh mesh;
+         mesh.triangulate_point_cloud(points);
+
+         auto global = [is,&order,&first](size_t iv) { return order[first[is]+iv-3]; };
+         safe[is].reserve(mesh.size());
+         for(dtriangle* t : mesh) {
+            const dcircle& circle = t->circle();
+            const double r = circle.radius()*(1.0+1.0E-9) + margin;
+            tri g = { global(t->vertex1()), global(t->vertex2()), global(t->vertex3()) };
+            if(circle.center().x()-r > xlo[is] && circle.center().x()+r < xhi[is]) {
+               safe[is].push_back(g);
+            }
+            else {
+               seam[is].insert(seam[is].end(),g.begin(),g.end());
+            }
+
+            // the strip boundary points must also be retriangulated,
+            // their missing triangles connect to the neighbour strips
+            for(size_t i=0; i<3; i++) {
+               const dcoedge* coedge = t->coedge(i);
+               if(coedge->edge()->use_count() == 1) {
+                  seam[is].push_back(global(coedge->vertex1()));
+                  seam[is].push_back(global(coedge->vertex2()));
+               }
+            }
+         }
+      });
+   }
+   thread_pool::singleton().wait(group);
+
+   // collect the seam points
+   std::vector<char>   in_seam(npoints,0);
+   std::vector<size_t> seam_vert;
+   for(auto& s : seam) {
+      for(size_t iv : s) {
+         if(!in_seam[iv]) {
+            in_seam[iv] = 1;
+            seam_vert.push_back(iv);
+         }
+      }
+      std::vector<size_t>().swap(s);
+   }
+   if(seam_vert.size() < 3) return false;
+
+   // grid of the remaining points, used to check the circumcircles of the seam triangles
+   const size_t nrest = npoints - seam_vert.size();
+   const double cell = std::max(extent*std::sqrt(2.0/std::max(nrest,size_t(1))),1.0E-6*extent);
+   const size_t nx = static_cast<size_t>((xmax-xmin)/cell) + 1;
+   const size_t ny = static_cast<size_t>((ymax-ymin)/cell) + 1;
+   auto cell_x = [xmin,cell,nx](double x) { return std::min(nx-1,static_cast<size_t>(std::max(0.0,(x-xmin)/cell))); };
+   auto cell_y = [ymin,cell,ny](double y) { return std::min(ny-1,static_cast<size_t>(std::max(0.0,(y-ymin)/cell))); };
+   std::vector<size_t> cell_start(nx*ny+1,0);
+   for(size_t iv=0; iv<npoints; iv++) {
+      if(!in_seam[iv]) cell_start[cell_y(pos[iv].y())*nx + cell_x(pos[iv].x()) + 1]++;
+   }
+   for(size_t ic=0; ic<nx*ny; ic++) cell_start[ic+1] += cell_start[ic];
+   std::vector<size_t> cell_points(nrest);
+   {
+      std::vector<size_t> fill(cell_start.begin(),cell_start.end()-1);
+      for(size_t iv=0; iv<npoints; iv++) {
+         if(!in_seam[iv]) cell_points[fill[cell_y(pos[iv].y())*nx + cell_x(pos[iv].x())]++] = iv;
+      }
+   }
+
+   // the safe triangles made only of seam points may be found again in the seam triangulation
+   auto key = [](tri t) { std::sort(t.begin(),t.end()); return t; };
+   struct tri_hash { size_t operator()(const tri& t) const { return std::hash<size_t>()(t[0]*73856093 ^ t[1]*19349663 ^ t[2]*83492791); } };
+   std::unordered_set<tri,tri_hash> seam_safe;
+   for(auto& s : safe) {
+      for(auto& t : s) {
+         if(in_seam[t[0]] && in_seam[t[1]] && in_seam[t[2]]) seam_safe.insert(key(t));
+      }
+   }
+
+   // triangulate the seam points. A seam triangle belongs to the complete triangulation
+   // when none of the remaining points is strictly inside its circumcircle
+   dmesh mesh;
+   {
+      std::vector<dpos2d> points;
+      points.reserve(seam_vert.size());
+      for(size_t iv : seam_vert) points.push_back(pos[iv]);
+      mesh.triangulate_point_cloud(points);
+   }
+
+   std::vector<tri> stitch;
    for(dtriangle* t : mesh) {
-      size_t v1 = t->vertex1()-3;
-      size_t v2 = t->vertex2()-3;
-      size_t v3 = t->vertex3()-3;
-      poly->m_face.push_back({v1,v2,v3});
+      tri g = { seam_vert[t->vertex1()-3], seam_vert[t->vertex2()-3], seam_vert[t->vertex3()-3] };
+      if(seam_safe.find(key(g)) != seam_safe.end()) continue;
+
+      const dcircle& circle = t->circle();
+      const double r = circle.radius()*(1.0+1.0E-9) + margin;
+      const double cx = circle.center().x();
+      const double cy = circle.center().y();
+      if(cy+r < ymin || cy-r > ymax || cx+r < xmin || cx-r > xmax) {
+         stitch.push_back(g);
+         continue;
+      }
+
+      // visit the cells overlapping the circle, row by row
+      bool empty = true;
+      const size_t iy1 = cell_y(cy-r), iy2 = cell_y(cy+r);
+      for(size_t iy=iy1; empty && iy<=iy2; iy++) {
+         const double y1 = ymin + iy*cell;
+         const double dy = std::max(0.0,std::max(y1-cy,cy-(y1+cell)));
+         if(dy > r) continue;
+         const double dx = std::sqrt(r*r-dy*dy);
+         const size_t ix1 = cell_x(cx-dx), ix2 = cell_x(cx+dx);
+         for(size_t ic=iy*nx+ix1; empty && ic<=iy*nx+ix2; ic++) {
+            for(size_t ip=cell_start[ic]; ip<cell_start[ic+1]; ip++) {
+               if(t->incircle(pos[cell_points[ip]]) > 0.0) {
+                  empty = false;
+                  break;
+               }
+            }
+         }
+      }
+      if(empty) stitch.push_back(g);
+   }
+
+   // consistency check: each directed edge at most once and all points used.
+   // Otherwise the caller falls back to the serial triangulation
+   size_t nfaces = stitch.size();
+   for(auto& s : safe) nfaces += s.size();
+   std::unordered_set<size_t> directed;
+   directed.reserve(3*nfaces);
+   std::vector<char> used(npoints,0);
+   auto check = [&directed,&used,npoints](const tri& t) {
+      for(size_t i=0; i<3; i++) {
+         used[t[i]] = 1;
+         if(!directed.insert(t[i]*npoints + t[(i+1)%3]).second) return false;
+      }
+      return true;
+   };
+   for(auto& t : stitch) if(!check(t)) return false;
+   for(auto& s : safe) {
+      for(auto& t : s) if(!check(t)) return false;
    }
+   if(std::find(used.begin(),used.end(),0) != used.end()) return false;
 
-   return close_tin(poly,mesh);
+   poly->m_tri.clear();
+   poly->m_tri.reserve(3*nfaces);
+   for(auto& s : safe) {
+      for(auto& t : s) poly->m_tri.insert(poly->m_tri.end(),t.begin(),t.end());
+   }
+   for(auto& t : stitch) poly->m_tri.insert(poly->m_tri.end(),t.begin(),t.end());
+   return true;
 }
 
-std::shared_ptr<tin_mesh::tpoly> tin_mesh::close_tin(std::shared_ptr<tpoly> poly, dmesh& mesh)
+std::shared_ptr<tin_mesh::tpoly> tin_mesh::close_tin(std::shared_ptr<tpoly> poly)
 {
-   size_t nvert = poly->m_vert.size();
-   size_t nface = poly->m_face.size();
+   const size_t nvert = poly->m_vert.size();
+   const std::vector<size_t>& tri = poly->m_tri;
+   const size_t nedge = tri.size();
 
    // compute min and max z
    double zmin = poly->m_vert[0].z;
@@ -60,21 +282,66 @@ std::shared_ptr<tin_mesh::tpoly> tin_mesh::close_tin(std::shared_ptr<tpoly> poly
    }
    double diff = zmax-zmin;
 
+   // directed edges of the triangles in a flat open addressing hash, 0 marks an empty slot.
+   // A boundary edge is an edge whose reverse is not used by any triangle
+   size_t bits = 1;
+   while((size_t(1) << bits) < 2*nedge) bits++;
+   const size_t mask = (size_t(1) << bits) - 1;
+   std::vector<uint64_t> table(mask+1,0);
+   auto edge_key = [nvert](size_t v1, size_t v2) { return uint64_t(v1)*nvert + v2 + 1; };
+   auto slot     = [bits](uint64_t key) { return size_t((key*0x9E3779B97F4A7C15ULL) >> (64-bits)); };
+   for(size_t i=0; i<nedge; i++) {
+      const uint64_t key = edge_key(tri[i],tri[i-i%3+(i+1)%3]);
+      size_t is = slot(key);
+      while(table[is] != 0 && table[is] != key) is = (is+1) & mask;
+      table[is] = key;
+   }
+   auto has_edge = [&](size_t v1, size_t v2) {
+      const uint64_t key = edge_key(v1,v2);
+      for(size_t is = slot(key); table[is] != 0; is = (is+1) & mask) {
+         if(table[is] == key) return true;
+      }
+      return false;
+   };
 
+   std::vector<size_t> boundary;
+   for(size_t i=0; i<nedge; i++) {
+      const size_t v1 = tri[i];
+      const size_t v2 = tri[i-i%3+(i+1)%3];
+      if(!has_edge(v2,v1)) {
+         boundary.push_back(v1);
+         boundary.push_back(v2);
+      }
+   }
+   std::vector<uint64_t>().swap(table);
 
    std::shared_ptr<tpoly> cpoly = std::shared_ptr<tpoly>(new tpoly( std::vector<txyz>()));
    cpoly->m_vert.reserve(nvert*2);
-   cpoly->m_face.reserve(nface*2);
+   cpoly->m_tri.reserve(2*nedge + 3*boundary.size());
 
    // z coordinate of bottom vertices
    double zlow = zmin-diff*0.1;
    for( auto& v : poly->m_vert) cpoly->m_vert.push_back(txyz(v.x,v.y,zlow));  // bottom vertices
    for( auto& v : poly->m_vert) cpoly->m_vert.push_back(v);                   // top vertices
 
+   std::vector<size_t>& ctri = cpoly->m_tri;
+   for(size_t i=0; i<nedge; i+=3) {      // bottom faces (reversed)
+      ctri.push_back(tri[i+2]);
+      ctri.push_back(tri[i+1]);
+      ctri.push_back(tri[i]);
+   }
+   for(size_t iv : tri) ctri.push_back(iv+nvert);  // top faces
 
-   for( auto& f : poly->m_face)  cpoly->m_face.push_back({f[2],f[1],f[0]});    // bottom faces (reversed)
-   for( auto& f : poly->m_face) cpoly->m_face.push_back({f[0]+nvert,f[1]+nvert,f[2]+nvert}); // top faces
+   // walls, 2 triangles for each boundary edge v1->v2 of the top, using the reversed edge
+   for(size_t i=0; i<boundary.size(); i+=2) {
+      const size_t v1 = boundary[i];
+      const size_t v2 = boundary[i+1];
+      ctri.insert(ctri.end(),{ v2+nvert, v1+nvert, v1 });
+      ctri.insert(ctri.end(),{ v2+nvert, v1, v2 });
+   }
 
+   // the open TIN is no longer needed
+   std::vector<size_t>().swap(poly->m_tri);
 
    return cpoly;
 }
@@ -28,19 +28,33 @@ public:
       double x,y,z;
    };
 
-   typedef std::vector<size_t>  pface;
+   // triangles are stored contiguously, 3 vertex indices each, counterclockwise seen from outside
    struct tpoly {
       tpoly(const std::vector<txyz>& vertices) : m_vert(vertices) {}
+      size_t nface() const { return m_tri.size()/3; }
       std::vector<txyz>   m_vert;
-      std::vector<pface>  m_face;
+      std::vector<size_t> m_tri;
    };
 
-   // perform inital meshing of original points, returns non-closed mesh
+   // perform inital meshing of original points, returns non-closed mesh.
+   // Large point sets are triangulated in parallel strips, see triangulate_strips
    static std::shared_ptr<tpoly> make_tin(std::shared_ptr<tpoly> poly);
 
+protected:
+   // triangulate all points in a single dmesh, adding faces to poly
+   static void triangulate_serial(std::shared_ptr<tpoly> poly);
+
+   // triangulate the points in nstrips vertical strips concurrently, adding faces to poly.
+   // Strip triangles with a circumcircle inside the strip are final. The points of the
+   // remaining triangles, plus the strip boundary points, are triangulated again and their
+   // triangles are kept when no other point lies inside the circumcircle.
+   // Returns false, leaving poly unchanged, if the stitched result is inconsistent
+   static bool triangulate_strips(std::shared_ptr<tpoly> poly, size_t nstrips);
+
 private:
-   // convert non-closed mesh to closed polyhedron
-   static std::shared_ptr<tpoly> close_tin(std::shared_ptr<tpoly> poly, dmesh& mesh);
+   // convert non-closed mesh to closed polyhedron: the TIN on top, a flat bottom below the
+   // lowest point, and vertical walls along the boundary edges, i.e. the edges used by one triangle
+   static std::shared_ptr<tpoly> close_tin(std::shared_ptr<tpoly> poly);
 
 };
 
@@ -0,0 +1,113 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "trace_recorder.h"
+#include "thread_pool.h"
+#include <fstream>
+#include <stdexcept>
+
+std::atomic<bool>                     trace_recorder::s_enabled(false);
+std::chrono::steady_clock::time_point trace_recorder::s_origin;
+
+// the buffer of this thread, owned by the recorder
+static thread_local void* tl_buffer = nullptr;
+
+trace_recorder::trace_recorder()
+: m_nother(0)
+{}
+
+trace_recorder::~trace_recorder()
+{}
+
+void trace_recorder::enable()
+{
+   // the thread buffers are kept, since the threads refer to them
+   {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      for(auto& tb : m_buffers) tb.events.clear();
+   }
+   s_origin = std::chrono::steady_clock::now();
+   s_enabled = true;
+}
+
+void trace_recorder::disable()
+{
+   s_enabled = false;
+}
+
+int64_t trace_recorder::now()
+{
+   auto us = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - s_origin).count();
+   return static_cast<int64_t>(us) + 1;
+}
+
+trace_recorder::thread_buffer& trace_recorder::buffer()
+{
+   if(!tl_buffer) {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      thread_buffer tb;
+
+      // pool workers are numbered from 1, other threads follow after the workers
+      int worker = thread_pool::current_worker();
+      if(worker >= 0)              tb.tid = worker+1;
+      else if(m_nother++ == 0)     tb.tid = 0;
+      else                         tb.tid = static_cast<int>(thread_pool::singleton().nthreads() + m_nother);
+      m_buffers.push_back(tb);
+      tl_buffer = &m_buffers.back();
+   }
+   return *static_cast<thread_buffer*>(tl_buffer);
+}
+
+void trace_recorder::add_span(const char* name, int64_t start, int64_t end)
+{
+   buffer().events.push_back(event{name,'X',start,end-start,nullptr});
+}
+
+void trace_recorder::add_counter(const char* name, const void* id, size_t value)
+{
+   buffer().events.push_back(event{name,'C',now(),static_cast<int64_t>(value),id});
+}
+
+void trace_recorder::write_json(const std::string& path)
+{
+   std::ofstream out(path);
+   if(!out.is_open()) throw std::runtime_error("trace_recorder: could not write trace " + path);
+
+   // called after the work is done, so no thread is adding events
+   std::lock_guard<std::mutex> lock(m_mutex);
+   out << "{\"traceEvents\":[" << std::endl;
+   bool first = true;
+   for(auto& tb : m_buffers) {
+      if(!first) out << "," << std::endl;
+      first = false;
+      std::string thread_name = "thread " + std::to_string(tb.tid);
+      if(tb.tid == 0)                                                         thread_name = "main";
+      else if(tb.tid <= static_cast<int>(thread_pool::singleton().nthreads())) thread_name = "worker " + std::to_string(tb.tid-1);
+      out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tb.tid << ",\"args\":{\"name\":\"" << thread_name << "\"}}";
+
+      for(auto& e : tb.events) {
+         out << "," << std::endl;
+         if(e.ph == 'X') {
+            out << "{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << tb.tid
+                << ",\"ts\":" << e.ts << ",\"dur\":" << e.dur << "}";
+         }
+         else {
+            out << "{\"name\":\"" << e.name << "\",\"ph\":\"C\",\"pid\":1,\"tid\":" << tb.tid
+                << ",\"id\":\"" << e.id << "\",\"ts\":" << e.ts << ",\"args\":{\"depth\":" << e.dur << "}}";
+         }
+      }
+   }
+   out << std::endl << "]}" << std::endl;
+}
@@ -0,0 +1,104 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// trace_recorder collects a timeline of spans and counters for all threads and writes it
+// in Chrome trace event JSON format, viewable in chrome://tracing or Perfetto (--trace option).
+// Each thread records into its own buffer. When tracing is disabled, a span or counter
+// costs one relaxed atomic load.
+//
+// Names must be string literals or otherwise outlive the recorder.
+
+class trace_recorder {
+public:
+   static trace_recorder& singleton()  { static trace_recorder instance; return instance;  }
+
+   // true when tracing is enabled, checked inline by span and counter
+   static bool enabled() { return s_enabled.load(std::memory_order_relaxed); }
+
+   // start recording, the time stamps are relative to this call.
+   // Events recorded before are discarded
+   void enable();
+
+   // stop recording
+   void disable();
+
+   // span records the lifetime of the object as a complete event in the current thread
+   class span {
+   public:
+      span(const char* name) : m_name(name), m_start(enabled()? now() : 0) {}
+      ~span() { if(m_start) trace_recorder::singleton().add_span(m_name,m_start,now()); }
+   private:
+      const char* m_name;
+      int64_t     m_start;   // 0 when tracing was disabled at construction
+   };
+
+   // record a counter value, id distinguishes counters with the same name.
+   // The value is shown as "depth", the counters are used for queue depths
+   static void counter(const char* name, const void* id, size_t value)
+   {
+      if(enabled()) singleton().add_counter(name,id,value);
+   }
+
+   // write the recorded events to file path
+   void write_json(const std::string& path);
+
+protected:
+   trace_recorder();
+   virtual ~trace_recorder();
+
+   // microseconds since enable, never 0 so it can flag a running span
+   static int64_t now();
+
+   void add_span(const char* name, int64_t start, int64_t end);
+   void add_counter(const char* name, const void* id, size_t value);
+
+private:
+   struct event {
+      const char* name;
+      char        ph;        // 'X' complete event or 'C' counter
+      int64_t     ts;        // start time [us]
+      int64_t     dur;       // duration [us] or counter value
+      const void* id;        // counter id
+   };
+
+   struct thread_buffer {
+      int                tid;       // thread_pool worker + 1, 0 for other threads
+      std::vector<event> events;
+   };
+
+   // the buffer of the calling thread
+   thread_buffer& buffer();
+
+private:
+   static std::atomic<bool>                     s_enabled;
+   static std::chrono::steady_clock::time_point s_origin;
+
+   std::mutex                         m_mutex;     // protects m_buffers and m_nother
+   std::list<thread_buffer>           m_buffers;
+   size_t                             m_nother;    // threads outside the pool seen so far
+};
+
+#endif // TRACE_RECORDER_H
@@ -0,0 +1,290 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "triangle_mesh.h"
+#include <carve/triangulator.hpp>
+#include "trace_recorder.h"
+#include "carve_triangulate.h"
+#include "thread_pool.h"
+#include "geom_kernel.h"
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+triangle_mesh::triangle_mesh()
+: m_compact(false)
+{}
+
+triangle_mesh::~triangle_mesh()
+{}
+
+static double triangle_area(const carve::geom3d::Vector& a, const carve::geom3d::Vector& b, const carve::geom3d::Vector& c)
+{
+   return 0.5*carve::geom::cross(b-a,c-a).length();
+}
+
+std::shared_ptr<triangle_mesh> triangle_mesh::create(const carve::mesh::Mesh<3>& mesh, size_t& ndropped)
+{
+   trace_recorder::span span("triangle_mesh::create");
+
+   typedef carve::mesh::Face<3>::vertex_t vertex_t;
+   ndropped = 0;
+
+   // the face vertex loops in one flat array, with the face sizes in a separate array
+   size_t nfaces = mesh.faces.size();
+   std::vector<const vertex_t*> face_verts;
+   std::vector<size_t>          face_sizes;
+   face_sizes.reserve(nfaces);
+   face_verts.reserve(3*nfaces);
+   std::vector<vertex_t*> verts;
+   for(auto face : mesh.faces) {
+      face->getVertices(verts);
+      face_sizes.push_back(verts.size());
+      face_verts.insert(face_verts.end(),verts.begin(),verts.end());
+   }
+
+   // the unique vertices referenced by the mesh, sorted by address for the index lookup
+   std::vector<const vertex_t*> unique_verts(face_verts);
+   std::sort(unique_verts.begin(),unique_verts.end());
+   unique_verts.erase(std::unique(unique_verts.begin(),unique_verts.end()),unique_verts.end());
+   size_t nvert = unique_verts.size();
+   if(nvert > std::numeric_limits<uint32_t>::max()) {
+      throw std::logic_error("triangle_mesh::create, too many vertices: " + std::to_string(nvert));
+   }
+
+   // output order of the vertices is by coordinates
+   std::vector<uint32_t> order(nvert);
+   std::iota(order.begin(),order.end(),0);
+   std::sort(order.begin(),order.end(),[&unique_verts](uint32_t a, uint32_t b) {
+      const carve::geom3d::Vector& pa = unique_verts[a]->v;
+      const carve::geom3d::Vector& pb = unique_verts[b]->v;
+      if(pa.x != pb.x) return pa.x < pb.x;
+      if(pa.y != pb.y) return pa.y < pb.y;
+      if(pa.z != pb.z) return pa.z < pb.z;
+      return a < b;
+   });
+   std::vector<uint32_t> rank(nvert);
+   for(size_t i=0; i<nvert; i++) rank[order[i]] = static_cast<uint32_t>(i);
+
+   auto index_of = [&unique_verts,&rank](const vertex_t* v) {
+      return rank[std::lower_bound(unique_verts.begin(),unique_verts.end(),v) - unique_verts.begin()];
+   };
+
+   std::shared_ptr<triangle_mesh> tmesh(new triangle_mesh());
+   tmesh->m_vert.resize(nvert);
+   for(size_t i=0; i<nvert; i++) tmesh->m_vert[i] = unique_verts[order[i]]->v;
+
+   size_t ntri = 0;
+   for(size_t nv : face_sizes) ntri += nv-2;
+   tmesh->m_tri.reserve(3*ntri);
+
+   size_t pos = 0;
+   std::vector<const vertex_t*>             vloop;
+   std::vector<carve::triangulate::tri_idx> result;
+   for(size_t iface=0; iface<nfaces; iface++) {
+      size_t nv = face_sizes[iface];
+      const vertex_t** loop = &face_verts[pos];
+      pos += nv;
+
+      if(nv == 3) {
+         for(size_t iv=0; iv<3; iv++) tmesh->m_tri.push_back(index_of(loop[iv]));
+         continue;
+      }
+
+      // triangulate the polygon in its own plane, convex polygons directly
+      const carve::mesh::Face<3>* face = mesh.faces[iface];
+      carve::mesh::Face<3>::projection_mapping projection(face->project);
+      vloop.assign(loop,loop+nv);
+      result.clear();
+      if(!carve_triangulate::triangulate_convex(vloop,[face](const vertex_t* v) { return face->project(v->v); },result)) {
+         carve::triangulate::triangulate(projection,vloop,result);
+         carve::triangulate::improve(projection,vloop,result);
+      }
+
+      for(auto& tri : result) {
+         if(triangle_area(vloop[tri.a]->v,vloop[tri.b]->v,vloop[tri.c]->v) > 0.0) {
+            tmesh->m_tri.push_back(index_of(vloop[tri.a]));
+            tmesh->m_tri.push_back(index_of(vloop[tri.b]));
+            tmesh->m_tri.push_back(index_of(vloop[tri.c]));
+         }
+         else {
+            ndropped++;
+         }
+      }
+   }
+   tmesh->m_tri.shrink_to_fit();
+   return tmesh;
+}
+
+std::shared_ptr<triangle_mesh> triangle_mesh::create(std::vector<carve::geom3d::Vector>&& vert, std::vector<uint32_t>&& tri)
+{
+   std::shared_ptr<triangle_mesh> tmesh(new triangle_mesh());
+   tmesh->m_vert = std::move(vert);
+   tmesh->m_tri  = std::move(tri);
+   return tmesh;
+}
+
+void triangle_mesh::compact()
+{
+   if(m_compact) return;
+   m_fvert.resize(3*m_vert.size());
+   float* p = m_fvert.data();
+   for(auto& v : m_vert) {
+      *p++ = static_cast<float>(v.x);
+      *p++ = static_cast<float>(v.y);
+      *p++ = static_cast<float>(v.z);
+   }
+   std::vector<carve::geom3d::Vector>().swap(m_vert);
+   m_compact = true;
+}
+
+// smallest number of vertices per task computing Hilbert keys
+static const size_t min_key_chunk = 65536;
+
+// position on a 3d Hilbert curve of order 21 of integer coordinates x,y,z < 2^21,
+// by the transposed axes algorithm of J. Skilling, "Programming the Hilbert curve" (2004)
+static uint64_t hilbert_key(uint32_t x, uint32_t y, uint32_t z)
+{
+   const int bits = 21;
+   uint32_t X[3] = { x, y, z };
+
+   // inverse undo
+   for(uint32_t q = uint32_t(1) << (bits-1); q > 1; q >>= 1) {
+      const uint32_t p = q-1;
+      for(int i=0; i<3; i++) {
+         if(X[i] & q) {
+            X[0] ^= p;
+         }
+         else {
+            uint32_t t = (X[0]^X[i]) & p;
+            X[0] ^= t;
+            X[i] ^= t;
+         }
+      }
+   }
+
+   // gray encode
+   for(int i=1; i<3; i++) X[i] ^= X[i-1];
+   uint32_t t = 0;
+   for(uint32_t q = uint32_t(1) << (bits-1); q > 1; q >>= 1) {
+      if(X[2] & q) t ^= q-1;
+   }
+   for(int i=0; i<3; i++) X[i] ^= t;
+
+   // interleave the transposed bits, most significant first
+   uint64_t key = 0;
+   for(int b=bits-1; b>=0; b--) {
+      for(int i=0; i<3; i++) key = (key << 1) | ((X[i] >> b) & 1);
+   }
+   return key;
+}
+
+std::shared_ptr<triangle_mesh> triangle_mesh::spatial_order(std::shared_ptr<const triangle_mesh> mesh)
+{
+   trace_recorder::span span("triangle_mesh::spatial_order");
+
+   const size_t nvert = mesh->v_size();
+   if(nvert == 0) return std::make_shared<triangle_mesh>(*mesh);
+
+   carve::geom3d::Vector vmin = mesh->v_get(0);
+   carve::geom3d::Vector vmax = vmin;
+   if(!mesh->m_compact) {
+      geom_kernel::bounds(mesh->m_vert[0].v,nvert,vmin.v,vmax.v);
+   }
+   else {
+      for(size_t i=0; i<nvert; i++) {
+         const carve::geom3d::Vector v = mesh->v_get(i);
+         vmin.x = std::min(vmin.x,v.x);  vmax.x = std::max(vmax.x,v.x);
+         vmin.y = std::min(vmin.y,v.y);  vmax.y = std::max(vmax.y,v.y);
+         vmin.z = std::min(vmin.z,v.z);  vmax.z = std::max(vmax.z,v.z);
+      }
+   }
+   const double extent = std::max(vmax.x-vmin.x,std::max(vmax.y-vmin.y,vmax.z-vmin.z));
+   const double scale  = (extent > 0.0)? ((uint32_t(1) << 21) - 1)/extent : 0.0;
+
+   // the keys of large meshes are computed in concurrent chunks
+   std::vector<std::pair<uint64_t,uint32_t>> keys(nvert);
+   auto compute_keys = [&mesh,&keys,&vmin,scale](size_t first, size_t last) {
+      for(size_t i=first; i<last; i++) {
+         const carve::geom3d::Vector v = mesh->v_get(i);
+         uint32_t x = static_cast<uint32_t>((v.x-vmin.x)*scale);
+         uint32_t y = static_cast<uint32_t>((v.y-vmin.y)*scale);
+         uint32_t z = static_cast<uint32_t>((v.z-vmin.z)*scale);
+         keys[i] = std::make_pair(hilbert_key(x,y,z),static_cast<uint32_t>(i));
+      }
+   };
+   const size_t nchunk = std::max(size_t(1),std::min(thread_pool::singleton().nthreads(),nvert/min_key_chunk));
+   if(nchunk > 1) {
+      thread_pool::task_group group;
+      for(size_t ic=0; ic<nchunk; ic++) {
+         thread_pool::singleton().submit(group,[ic,nchunk,nvert,&compute_keys]() { compute_keys(ic*nvert/nchunk,(ic+1)*nvert/nchunk); });
+      }
+      thread_pool::singleton().wait(group);
+   }
+   else {
+      compute_keys(0,nvert);
+   }
+   std::sort(keys.begin(),keys.end());
+
+   // a compact mesh stays compact
+   std::shared_ptr<triangle_mesh> tmesh(new triangle_mesh());
+   std::vector<uint32_t> rank(nvert);
+   if(mesh->m_compact) {
+      tmesh->m_compact = true;
+      tmesh->m_fvert.resize(3*nvert);
+      for(size_t i=0; i<nvert; i++) {
+         rank[keys[i].second] = static_cast<uint32_t>(i);
+         std::copy_n(&mesh->m_fvert[3*keys[i].second],3,&tmesh->m_fvert[3*i]);
+      }
+   }
+   else {
+      tmesh->m_vert.resize(nvert);
+      for(size_t i=0; i<nvert; i++) {
+         rank[keys[i].second] = static_cast<uint32_t>(i);
+         tmesh->m_vert[i] = mesh->m_vert[keys[i].second];
+      }
+   }
+   std::vector<std::pair<uint64_t,uint32_t>>().swap(keys);
+
+   // renumber the triangles, rotated to start at the lowest index, and sort them
+   const size_t ntri = mesh->t_size();
+   std::vector<std::array<uint32_t,3>> tri(ntri);
+   for(size_t it=0; it<ntri; it++) {
+      const uint32_t* t = mesh->t_get(it);
+      uint32_t a = rank[t[0]], b = rank[t[1]], c = rank[t[2]];
+      if(b < a && b < c)      tri[it] = {{ b, c, a }};
+      else if(c < a && c < b) tri[it] = {{ c, a, b }};
+      else                    tri[it] = {{ a, b, c }};
+   }
+   std::sort(tri.begin(),tri.end());
+
+   tmesh->m_tri.reserve(3*ntri);
+   for(auto& t : tri) tmesh->m_tri.insert(tmesh->m_tri.end(),t.begin(),t.end());
+   return tmesh;
+}
+
+std::shared_ptr<triangle_mesh_vector> spatial_order(std::shared_ptr<const triangle_mesh_vector> meshes)
+{
+   std::shared_ptr<triangle_mesh_vector> ordered = std::make_shared<triangle_mesh_vector>(meshes->size());
+   thread_pool::task_group group;
+   for(size_t i=0; i<meshes->size(); i++) {
+      thread_pool::singleton().submit(group,[i,&meshes,&ordered]() { (*ordered)[i] = triangle_mesh::spatial_order((*meshes)[i]); });
+   }
+   thread_pool::singleton().wait(group);
+   return ordered;
+}
@@ -0,0 +1,76 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef TRIANGLE_MESH_H
+#define TRIANGLE_MESH_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <carve/mesh.hpp>
+
+// triangle_mesh is the final stage result of one lump: a flat vertex array and
+// 3 vertex indices per triangle. It is created directly from the boolean result
+// and read by all the triangle exporters
+
+class triangle_mesh {
+public:
+   triangle_mesh();
+   virtual ~triangle_mesh();
+
+   // triangulate one manifold of a carve mesh set. Triangle faces are copied as they are,
+   // other faces are triangulated in their plane and zero area triangles from that are dropped.
+   // The vertices are ordered by coordinates, so the output does not depend on memory layout
+   static std::shared_ptr<triangle_mesh> create(const carve::mesh::Mesh<3>& mesh, size_t& ndropped);
+
+   // mesh from given vertices and triangles, 3 vertex indices each
+   static std::shared_ptr<triangle_mesh> create(std::vector<carve::geom3d::Vector>&& vert, std::vector<uint32_t>&& tri);
+
+   // copy of mesh with the vertices ordered along a 3d Hilbert curve through its bounding box, and
+   // the triangles ordered by their vertex indices, so consumers see spatially coherent data.
+   // Each triangle starts at its lowest vertex index, the orientation is kept
+   static std::shared_ptr<triangle_mesh> spatial_order(std::shared_ptr<const triangle_mesh> mesh);
+
+   // convert the vertices to a float32 buffer and release the double precision coordinates,
+   // which halves the vertex memory. Binary STL, 3MF and AMF store float32 anyway
+   void compact();
+   bool is_compact() const { return m_compact; }
+
+   // vertices
+   size_t                v_size() const { return (m_compact)? m_fvert.size()/3 : m_vert.size(); }
+   carve::geom3d::Vector v_get(size_t v_ind) const
+   {
+      if(!m_compact) return m_vert[v_ind];
+      const float* p = &m_fvert[3*v_ind];
+      return carve::geom::VECTOR(p[0],p[1],p[2]);
+   }
+
+   // triangles, 3 vertex indices each
+   size_t          t_size() const { return m_tri.size()/3; }
+   const uint32_t* t_get(size_t t_ind) const { return &m_tri[3*t_ind]; }
+
+private:
+   std::vector<carve::geom3d::Vector> m_vert;  // vertex coordinates
+   std::vector<float>                 m_fvert; // vertex coordinates of a compact mesh, 3 per vertex
+   std::vector<uint32_t>              m_tri;   // vertex indices of triangles
+   bool                               m_compact;
+};
+
+typedef std::vector<std::shared_ptr<triangle_mesh>> triangle_mesh_vector;
+
+// spatially ordered copies of all meshes, computed concurrently
+std::shared_ptr<triangle_mesh_vector> spatial_order(std::shared_ptr<const triangle_mesh_vector> meshes);
+
+#endif // TRIANGLE_MESH_H
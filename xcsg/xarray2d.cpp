@@ -0,0 +1,140 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "xarray2d.h"
+#include "clipper_boolean.h"
+#include "extrude_mesh.h"
+#include "mesh_utils.h"
+#include "csg_parser/cf_xmlNode.h"
+#include "xshape2d_collector.h"
+#include <algorithm>
+#include <cmath>
+
+xarray2d::xarray2d()
+{}
+
+xarray2d::xarray2d(const cf_xmlNode& node)
+: m_pattern(node)
+{
+   if(node.tag() != "array2d")throw logic_error("Expected xml tag array2d, but found " + node.tag());
+   set_transform(node);
+
+   std::vector<std::shared_ptr<xshape2d>> incl;
+   xshape2d_collector::collect_children(node,incl);
+   if(incl.size() != 1) throw logic_error("array2d requires 1 child but found " + std::to_string(incl.size()));
+   m_shape = incl[0];
+}
+
+xarray2d::~xarray2d()
+{}
+
+size_t xarray2d::nbool()
+{
+   // as for a union of the copies, the child booleans are computed once
+   return m_shape->nbool() + m_pattern.size() - 1;
+}
+
+std::shared_ptr<clipper_profile> xarray2d::create_clipper_profile(const carve::math::Matrix& t) const
+{
+   return compute_profile(t*get_transform());
+}
+
+std::shared_ptr<clipper_profile> xarray2d::compute_profile(const carve::math::Matrix& t) const
+{
+   std::vector<carve::math::Matrix> copies = m_pattern.transforms(t);
+
+   // the child profile can only be reused when z does not feed into x and y,
+   // otherwise projecting before or after the transform gives different profiles
+   bool in_plane = true;
+   for(auto& tc : copies) {
+      if(tc.m[2][0] != 0.0 || tc.m[2][1] != 0.0) in_plane = false;
+   }
+   if(!in_plane) {
+      return clipper_boolean::simplify(clipper_boolean::reduce(copies.size(),[this,&copies](size_t i) { return m_shape->create_clipper_profile(copies[i]); },ClipperLib::ctUnion));
+   }
+
+   // the child profile is created once in its own system
+   std::shared_ptr<clipper_profile> local = m_shape->create_clipper_profile();
+   const ClipperLib::Paths& local_paths = local->paths();
+
+   xbox3d local_box;
+   const double from_clipper = 1.0/TO_CLIPPER;
+   for(auto& path : local_paths) {
+      for(auto& p : path) local_box.enclose(carve::geom::VECTOR(p.X*from_clipper,p.Y*from_clipper,0.0));
+   }
+   std::vector<xbox3d> boxes(copies.size());
+   for(size_t i=0; i<copies.size(); i++) boxes[i].enclose(copies[i],local_box);
+
+   // copies that cannot touch are concatenated
+   if(array_pattern::disjoint(boxes,1.0E-9*local_box.diagonal() + 2.0*from_clipper)) {
+      std::shared_ptr<clipper_profile> profile = std::make_shared<clipper_profile>();
+      for(auto& tc : copies) profile->AddPaths(transformed_paths(local_paths,tc));
+      return profile;
+   }
+
+   // overlapping copies are unioned
+   return clipper_boolean::simplify(clipper_boolean::reduce(copies.size(),[&local_paths,&copies](size_t i) {
+      std::shared_ptr<clipper_profile> profile = std::make_shared<clipper_profile>();
+      profile->AddPaths(transformed_paths(local_paths,copies[i]));
+      return profile;
+   },ClipperLib::ctUnion));
+}
+
+ClipperLib::Paths xarray2d::transformed_paths(const ClipperLib::Paths& paths, const carve::math::Matrix& t)
+{
+   // the linear part applies to Clipper units directly, the translation is scaled
+   const double xx = t.m[0][0], xy = t.m[1][0], xw = t.m[3][0]*TO_CLIPPER;
+   const double yx = t.m[0][1], yy = t.m[1][1], yw = t.m[3][1]*TO_CLIPPER;
+   const bool reverse = (xx*yy - xy*yx) < 0.0;
+
+   ClipperLib::Paths result(paths.size());
+   for(size_t ip=0; ip<paths.size(); ip++) {
+      const ClipperLib::Path& path = paths[ip];
+      ClipperLib::Path& tpath = result[ip];
+      tpath.reserve(path.size());
+      for(auto& p : path) {
+         double x = static_cast<double>(p.X);
+         double y = static_cast<double>(p.Y);
+         tpath.push_back(ClipperLib::IntPoint(static_cast<ClipperLib::cInt>(std::llround(xx*x + xy*y + xw)),
+                                              static_cast<ClipperLib::cInt>(std::llround(yx*x + yy*y + yw))));
+      }
+      // a mirrored path changes orientation, it is reversed to keep outer paths and holes apart
+      if(reverse) std::reverse(tpath.begin(),tpath.end());
+   }
+   return result;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xarray2d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   // the profile is created in the local system, the 3d transformation is applied by the extrusion
+   std::shared_ptr<clipper_profile> profile = compute_profile(carve::math::Matrix());
+   if(!profile.get() || profile->paths().size() == 0) {
+      return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
+   }
+   return extrude_mesh::linear_extrude(profile,mesh_utils::thickness(),t*get_transform());
+}
+
+bool xarray2d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // the child box is computed for each copy, as the profiles are projected after the transform
+   box = xbox3d();
+   for(auto& tc : m_pattern.transforms(t*get_transform())) {
+      xbox3d copy_box;
+      if(!m_shape->bounding_box(tc,copy_box)) return false;
+      box.enclose(copy_box);
+   }
+   return true;
+}
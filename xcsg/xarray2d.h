@@ -0,0 +1,54 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef XARRAY2D_H
+#define XARRAY2D_H
+
+#include "xshape2d.h"
+#include "array_pattern.h"
+
+// xarray2d is the union of copies of one child shape placed by an array_pattern.
+// The child profile is created once and its paths transformed for each copy. When the
+// bounding boxes of the copies do not touch, the paths are concatenated without booleans
+
+class xarray2d : public xshape2d {
+public:
+   xarray2d();
+   xarray2d(const cf_xmlNode& node);
+   virtual ~xarray2d();
+
+   virtual size_t nbool();
+
+   std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // the 2d boolean is computed with clipper and the result extruded to a slab
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+protected:
+   // compute the profile, t includes the transform of this object
+   std::shared_ptr<clipper_profile> compute_profile(const carve::math::Matrix& t) const;
+
+   // paths transformed by t in the xy plane, reversed if t is left handed
+   static ClipperLib::Paths transformed_paths(const ClipperLib::Paths& paths, const carve::math::Matrix& t);
+
+private:
+   array_pattern             m_pattern;
+   std::shared_ptr<xshape2d> m_shape;
+};
+
+#endif // XARRAY2D_H
@@ -0,0 +1,109 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "xarray3d.h"
+#include "csg_parser/cf_xmlNode.h"
+#include "xsolid_collector.h"
+#include "mesh_cache.h"
+#include "instance_cache.h"
+#include "trace_recorder.h"
+#include "boolean_timer.h"
+
+#include "carve_boolean_thread.h"
+
+xarray3d::xarray3d()
+{}
+
+xarray3d::xarray3d(const cf_xmlNode& node)
+: m_pattern(node)
+{
+   if(node.tag() != "array3d")throw logic_error("Expected xml tag array3d, but found " + node.tag());
+   set_transform(node);
+   m_subtree_hash = mesh_cache::singleton().register_subtree(node);
+   set_cost_key(m_subtree_hash);
+   m_instance_hash = instance_cache::singleton().register_instance(node);
+
+   std::vector<std::shared_ptr<xsolid>> incl;
+   xsolid_collector::collect_children(node,incl);
+   if(incl.size() != 1) throw logic_error("array3d requires 1 child but found " + std::to_string(incl.size()));
+   m_solid = incl[0];
+}
+
+xarray3d::~xarray3d()
+{}
+
+size_t xarray3d::nbool()
+{
+   // as for a union of the copies, the child booleans are computed once
+   return m_solid->nbool() + m_pattern.size() - 1;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xarray3d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   carve::math::Matrix tt = t*get_transform();
+   return mesh_cache::singleton().get(m_subtree_hash,tt,[this,&tt]() {
+      return instance_cache::singleton().get(m_instance_hash,tt,[this](const carve::math::Matrix& ti) { return compute_carve_mesh(ti); });
+   });
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xarray3d::compute_carve_mesh(const carve::math::Matrix& t) const
+{
+   trace_recorder::span span("xarray3d::compute_carve_mesh");
+
+   // the child is meshed once in its own system
+   std::shared_ptr<carve::mesh::MeshSet<3>> local = m_solid->create_carve_mesh();
+   std::vector<carve::math::Matrix> copies = m_pattern.transforms(t);
+
+   xbox3d local_box(*local);
+   std::vector<xbox3d> boxes(copies.size());
+   for(size_t i=0; i<copies.size(); i++) boxes[i].enclose(copies[i],local_box);
+
+   // copies that cannot touch are concatenated, each boolean is counted as disjoint
+   if(array_pattern::disjoint(boxes,1.0E-9*local_box.diagonal())) {
+      for(size_t i=1; i<copies.size(); i++) {
+         boolean_timer::singleton().add_disjoint(true);
+         boolean_timer::singleton().add_elapsed(0.0);
+      }
+      return instance_cache::transformed_copies(*local,copies);
+   }
+
+   // overlapping copies are unioned, the union tree pairs them by location
+   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
+   for(auto& tc : copies) mesh_queue.enqueue(instance_cache::transformed_copy(*local,tc));
+   carve_boolean_thread::reduce(mesh_queue,carve::csg::CSG::UNION);
+
+   return mesh_queue.dequeue();
+}
+
+mesh_estimate xarray3d::estimate(const carve::math::Matrix& t) const
+{
+   return mesh_estimate::copies(m_solid->estimate(carve::math::Matrix()),m_pattern.transforms(t*get_transform()));
+}
+
+bool xarray3d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   xbox3d local_box;
+   if(!m_solid->bounding_box(carve::math::Matrix(),local_box)) return false;
+
+   box = xbox3d();
+   for(auto& tc : m_pattern.transforms(t*get_transform())) box.enclose(tc,local_box);
+   return true;
+}
+
+void xarray3d::hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const
+{
+   for(auto& tc : m_pattern.transforms(t*get_transform())) m_solid->hull_points(tc,points);
+}
@@ -0,0 +1,55 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef XARRAY3D_H
+#define XARRAY3D_H
+
+#include "xsolid.h"
+#include "array_pattern.h"
+
+// xarray3d is the union of copies of one child solid placed by an array_pattern.
+// The child is meshed once. When the bounding boxes of the copies do not touch, the
+// copies are concatenated into one mesh set without booleans, otherwise they are unioned
+
+class xarray3d : public xsolid {
+public:
+   xarray3d();
+   xarray3d(const cf_xmlNode& node);
+   virtual ~xarray3d();
+
+   virtual size_t nbool();
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // the hull points of the child, once for each copy
+   void hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const;
+
+protected:
+   // compute the mesh without consulting the caches, t includes the transform of this object
+   std::shared_ptr<carve::mesh::MeshSet<3>> compute_carve_mesh(const carve::math::Matrix& t) const;
+
+private:
+   array_pattern           m_pattern;
+   std::shared_ptr<xsolid> m_solid;
+   std::string m_subtree_hash;  // identifies this subtree in the mesh_cache
+   std::string m_instance_hash; // identifies identical instances in the instance_cache
+};
+
+#endif // XARRAY3D_H
@@ -0,0 +1,154 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xbox3d.h"
+#include <algorithm>
+#include <cmath>
+
+xbox3d::xbox3d(bool initialised)
+: m_p1(carve::geom::VECTOR(0.0,0.0,0.0))
+, m_p2(carve::geom::VECTOR(0.0,0.0,0.0))
+, m_initialised(initialised)
+{}
+
+xbox3d::xbox3d(const xvertex& pos1, const xvertex& pos2)
+: m_p1(pos1)
+, m_p2(pos1)
+, m_initialised(false)
+{
+   enclose(pos1);
+   enclose(pos2);
+}
+
+xbox3d::xbox3d(const carve::mesh::MeshSet<3>& meshset)
+: m_p1(carve::geom::VECTOR(0.0,0.0,0.0))
+, m_p2(carve::geom::VECTOR(0.0,0.0,0.0))
+, m_initialised(false)
+{
+   for(auto& vertex : meshset.vertex_storage) {
+      enclose(vertex.v);
+   }
+}
+
+xbox3d::~xbox3d()
+{}
+
+bool xbox3d::initialised() const
+{
+   return m_initialised;
+}
+
+void xbox3d::enclose(const xvertex& pos, double tolerance)
+{
+   if(!m_initialised) {
+      m_p1 = pos;
+      m_p2 = pos;
+      m_initialised = true;
+   }
+   for(size_t i=0; i<3; i++) {
+      m_p1[i] = std::min(m_p1[i],pos[i]-tolerance);
+      m_p2[i] = std::max(m_p2[i],pos[i]+tolerance);
+   }
+}
+
+void xbox3d::enclose(const xbox3d& box)
+{
+   if(box.m_initialised) {
+      enclose(box.m_p1);
+      enclose(box.m_p2);
+   }
+}
+
+void xbox3d::enclose(const carve::math::Matrix& t, const xbox3d& box)
+{
+   if(!box.m_initialised) return;
+   for(size_t i=0; i<8; i++) {
+      xvertex corner = carve::geom::VECTOR((i&1)? box.m_p2[0] : box.m_p1[0],
+                                           (i&2)? box.m_p2[1] : box.m_p1[1],
+                                           (i&4)? box.m_p2[2] : box.m_p1[2]);
+      enclose(t*corner);
+   }
+}
+
+void xbox3d::enclose_ellipsoid(const carve::math::Matrix& t, const xvertex& center, double rx, double ry, double rz)
+{
+   // the half extent along each axis is the length of the scaled row of the linear part
+   xvertex c = t*center;
+   xvertex extent;
+   for(size_t i=0; i<3; i++) {
+      double ex = rx*t.m[0][i];
+      double ey = ry*t.m[1][i];
+      double ez = rz*t.m[2][i];
+      extent[i] = sqrt(ex*ex + ey*ey + ez*ez);
+   }
+   enclose(c-extent);
+   enclose(c+extent);
+}
+
+xbox3d xbox3d::intersection(const xbox3d& box) const
+{
+   xbox3d common;
+   if(!intersects(box)) return common;
+   xvertex p1,p2;
+   for(size_t i=0; i<3; i++) {
+      p1[i] = std::max(m_p1[i],box.m_p1[i]);
+      p2[i] = std::min(m_p2[i],box.m_p2[i]);
+   }
+   common.enclose(p1);
+   common.enclose(p2);
+   return common;
+}
+
+xbox3d xbox3d::minkowski_sum(const xbox3d& box) const
+{
+   xbox3d sum;
+   if(!m_initialised || !box.m_initialised) return sum;
+   sum.enclose(m_p1+box.m_p1);
+   sum.enclose(m_p2+box.m_p2);
+   return sum;
+}
+
+bool xbox3d::intersects(const xbox3d& box, double tolerance) const
+{
+   if(!m_initialised || !box.m_initialised) return false;
+   for(size_t i=0; i<3; i++) {
+      if(m_p2[i]+tolerance < box.m_p1[i]) return false;
+      if(box.m_p2[i]+tolerance < m_p1[i]) return false;
+   }
+   return true;
+}
+
+bool xbox3d::contains(const xbox3d& box) const
+{
+   if(!m_initialised || !box.m_initialised) return false;
+   for(size_t i=0; i<3; i++) {
+      if(box.m_p1[i] < m_p1[i]) return false;
+      if(box.m_p2[i] > m_p2[i]) return false;
+   }
+   return true;
+}
+
+xvertex xbox3d::center() const
+{
+   return carve::geom::VECTOR(0.5*(m_p1[0]+m_p2[0]),0.5*(m_p1[1]+m_p2[1]),0.5*(m_p1[2]+m_p2[2]));
+}
+
+double xbox3d::diagonal() const
+{
+   double dx = m_p2[0]-m_p1[0];
+   double dy = m_p2[1]-m_p1[1];
+   double dz = m_p2[2]-m_p1[2];
+   return sqrt(dx*dx + dy*dy + dz*dz);
+}
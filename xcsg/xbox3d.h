@@ -0,0 +1,70 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XBOX3D_H
+#define XBOX3D_H
+
+#include "xshape.h"
+#include <carve/matrix.hpp>
+
+// a xbox3d is a utility for computing a 3d axis aligned bounding box
+
+class xbox3d {
+public:
+   xbox3d(bool initialised = false);
+   xbox3d(const xvertex& pos1, const xvertex& pos2);
+
+   // bounding box of all vertices in a carve mesh
+   xbox3d(const carve::mesh::MeshSet<3>& meshset);
+   virtual ~xbox3d();
+
+   bool initialised() const;
+
+   void  enclose(const xvertex& pos, double tolerance=0.0);
+   void  enclose(const xbox3d& box);
+
+   // enclose the 8 corners of box transformed by t
+   void  enclose(const carve::math::Matrix& t, const xbox3d& box);
+
+   // enclose the axis aligned ellipsoid with radii rx,ry,rz around center, transformed by t.
+   // A zero radius gives an ellipse or a line segment
+   void  enclose_ellipsoid(const carve::math::Matrix& t, const xvertex& center, double rx, double ry, double rz);
+
+   // the common part of the boxes, uninitialised if they do not intersect
+   xbox3d intersection(const xbox3d& box) const;
+
+   // the box of the minkowski sum of anything inside the boxes
+   xbox3d minkowski_sum(const xbox3d& box) const;
+
+   // true if the boxes share any part of space, touching boxes count as intersecting
+   bool intersects(const xbox3d& box, double tolerance=0.0) const;
+
+   // true if box is completely inside this box
+   bool contains(const xbox3d& box) const;
+
+   // box center and length of box diagonal
+   xvertex center() const;
+   double  diagonal() const;
+
+   const xvertex& p1() const { return m_p1; }
+   const xvertex& p2() const { return m_p2; }
+
+private:
+   xvertex m_p1;   // minimum corner
+   xvertex m_p2;   // maximum corner
+   bool    m_initialised;
+};
+
+#endif // XBOX3D_H
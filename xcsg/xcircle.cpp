@@ -50,3 +50,12 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xcircle::create_carve_mesh(const carve:
    std::shared_ptr<xpolyhedron> poly = primitives3d::make_cone(m_r,m_r, mesh_utils::thickness(),false,nseg,t*get_transform());
    return poly->create_carve_mesh();
 }
+
+bool xcircle::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // the profile vertices are on the circle
+   box = xbox3d();
+   box.enclose_ellipsoid(t*get_transform(),carve::geom::VECTOR(0.0,0.0,0.0),m_r,m_r,0.0);
+   box = projected(box);
+   return true;
+}
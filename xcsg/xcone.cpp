@@ -15,6 +15,7 @@
 
 #include "xcone.h"
 #include "primitives3d.h"
+#include "primitive_cache.h"
 #include "csg_parser/cf_xmlNode.h"
 
 xcone::xcone(double h, double r1, double r2, bool center)
@@ -45,8 +46,22 @@ xcone::~xcone()
 std::shared_ptr<carve::mesh::MeshSet<3>> xcone::create_carve_mesh(const carve::math::Matrix& t) const
 {
    int nseg = -1;
-   std::shared_ptr<xpolyhedron> poly = primitives3d::make_cone(m_r1,m_r2,m_h,m_center,nseg,t*get_transform());
+   std::string key = primitive_cache::make_key("cone",{m_r1,m_r2,m_h,double(m_center)});
+   double r1 = m_r1, r2 = m_r2, h = m_h;
+   bool center = m_center;
+   std::shared_ptr<xpolyhedron> poly = primitive_cache::singleton().get(key,[r1,r2,h,center,nseg]() { return primitives3d::make_cone(r1,r2,h,center,nseg); },t*get_transform());
 
    std::shared_ptr<carve::mesh::MeshSet<3>> mesh = poly->create_carve_mesh();
    return mesh;
 }
+
+bool xcone::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // the box of the bottom and top circles
+   const carve::math::Matrix tt = t*get_transform();
+   const double z1 = (m_center)? -0.5*m_h : 0.0;
+   box = xbox3d();
+   box.enclose_ellipsoid(tt,carve::geom::VECTOR(0.0,0.0,z1),m_r1,m_r1,0.0);
+   box.enclose_ellipsoid(tt,carve::geom::VECTOR(0.0,0.0,z1+m_h),m_r2,m_r2,0.0);
+   return true;
+}
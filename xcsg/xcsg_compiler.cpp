@@ -0,0 +1,602 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xcsg_compiler.h"
+
+#include <boost/date_time.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+#include "csg_parser/cf_xmlTree.h"
+#include "xsolid.h"
+#include "xunion3d.h"
+#include "xshape2d.h"
+#include "clipper_boolean.h"
+#include "clipper_csg/clipper_offset.h"
+#include "clipper_csg/polyset2d.h"
+#include "mesh_utils.h"
+#include "xpolyhedron.h"
+#include "xcsg_factory.h"
+#include "boolean_timer.h"
+#include "thread_pool.h"
+#include "instance_cache.h"
+#include "phase_timer.h"
+#include "memory_budget.h"
+#include "compile_context.h"
+#include "decimate_mesh.h"
+#include "snap_engine.h"
+#include "xbox3d.h"
+#include "mesh_estimate.h"
+
+xcsg_compiler::xcsg_compiler(size_t max_bool)
+: m_max_bool(max_bool)
+, m_context(std::make_shared<compile_context>())
+, m_decimate_faces(0)
+, m_decimate_error(0.0)
+, m_streaming(false)
+, m_compact(false)
+, m_max_faces(0)
+, m_max_bytes(0)
+, m_max_sec(0.0)
+{}
+
+xcsg_compiler::~xcsg_compiler()
+{}
+
+bool xcsg_compiler::compile(cf_xmlTree& tree, std::ostream& log, bool all_objects)
+{
+   if(!build(tree,log,all_objects)) return false;
+   compute(log);
+   return true;
+}
+
+bool xcsg_compiler::build(cf_xmlTree& tree, std::ostream& log, bool all_objects)
+{
+   compile_context::scope scope(m_context.get());
+   m_objects.clear();
+   xcsg_factory::singleton().clear_shared();
+   m_context->reset_cancel();
+
+   cf_xmlNode root;
+   if(!tree.get_root(root) || "xcsg" != root.tag()) return false;
+
+   // set the global secant tolerance,
+   mesh_utils::set_secant_tolerance(root.get_property("secant_tolerance",mesh_utils::default_secant_tolerance()));
+
+   // build the CSG tree from the first solid or shape2d, or from all of them
+   for(auto i=root.begin(); i!=root.end(); i++) {
+      cf_xmlNode child(i);
+      if(!child.is_attribute_node()) {
+         if(xcsg_factory::singleton().is_solid(child)) {
+            log << "processing solid: " << child.tag() << std::endl;
+            m_objects.push_back(std::make_shared<object>());
+            m_objects.back()->index = m_objects.size()-1;
+            m_objects.back()->solid = xcsg_factory::singleton().make_solid(child);
+            m_objects.back()->nbool = m_objects.back()->solid->nbool();
+         }
+         else if(xcsg_factory::singleton().is_shape2d(child)) {
+            log << "processing shape2d: " << child.tag() << std::endl;
+            m_objects.push_back(std::make_shared<object>());
+            m_objects.back()->index = m_objects.size()-1;
+            m_objects.back()->shape2d = xcsg_factory::singleton().make_shape2d(child);
+            m_objects.back()->nbool = m_objects.back()->shape2d->nbool();
+         }
+         if(m_objects.size() > 0 && !all_objects) break;
+      }
+   }
+
+   // the snap grid of intermediate boolean results is relative to the size of the whole model
+   m_context->set_snap_spacing(0.0);
+   if(carve_boolean::snap_bits() > 0) {
+      std::vector<std::shared_ptr<xsolid>> solids;
+      for(auto& obj : m_objects) if(obj->solid) solids.push_back(obj->solid);
+      xbox3d box;
+      if(solids.size() > 0 && xsolid::bounding_box(carve::math::Matrix(),solids,box) && box.initialised()) {
+         m_context->set_snap_spacing(snap_engine::grid_spacing(box,carve_boolean::snap_bits()));
+      }
+   }
+
+   // the CSG objects hold all data they need, so the xml tree is released
+   // before the booleans start instead of staying in memory during the run.
+   // Subtrees shared between parents are kept alive by them, not by the factory
+   xcsg_factory::singleton().clear_shared();
+   tree.clear();
+   return m_objects.size() > 0;
+}
+
+std::shared_ptr<xcsg_compiler> xcsg_compiler::derive(double secant_tolerance) const
+{
+   std::shared_ptr<xcsg_compiler> compiler = std::make_shared<xcsg_compiler>(m_max_bool);
+   compiler->m_lump_function  = m_lump_function;
+   compiler->m_decimate_faces = m_decimate_faces;
+   compiler->m_decimate_error = m_decimate_error;
+   compiler->m_streaming      = m_streaming;
+   compiler->m_compact        = m_compact;
+   compiler->m_max_faces      = m_max_faces;
+   compiler->m_max_bytes      = m_max_bytes;
+   compiler->m_max_sec        = m_max_sec;
+   for(auto& obj : m_objects) {
+      if(!obj->solid && !obj->shape2d) throw std::logic_error("xcsg_compiler::derive: object " + std::to_string(obj->index+1) + " is already computed");
+      compiler->m_objects.push_back(std::make_shared<object>());
+      object& copy = *compiler->m_objects.back();
+      copy.index   = obj->index;
+      copy.nbool   = obj->nbool;
+      copy.solid   = obj->solid;
+      copy.shape2d = obj->shape2d;
+   }
+
+   // the tolerance, snap grid and instance counts of the model, as set by build
+   compile_context::scope scope(compiler->m_context.get());
+   mesh_utils::set_secant_tolerance(secant_tolerance);
+   compiler->m_context->set_snap_spacing(m_context->snap_spacing());
+   compiler->m_context->instances().register_instances(m_context->instances());
+   return compiler;
+}
+
+double xcsg_compiler::secant_tolerance() const
+{
+   return m_context->secant_tolerance();
+}
+
+void xcsg_compiler::estimate(std::ostream& out)
+{
+   if(m_objects.size() == 0) throw std::logic_error("xcsg tree contains no data. ");
+
+   compile_context::scope scope(m_context.get());
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+
+   // the objects are computed concurrently, so the largest booleans of all of them may run at once
+   const size_t nthreads = thread_pool::singleton().nthreads();
+   std::vector<mesh_estimate> estimates(m_objects.size());
+   double cost = 0.0;
+   size_t peak_bytes = 0;
+   for(size_t iobj=0; iobj<m_objects.size(); iobj++) {
+      object& obj = *m_objects[iobj];
+      if(!obj.solid) continue;
+      estimates[iobj] = obj.solid->estimate(carve::math::Matrix());
+      cost += estimates[iobj].cost;
+      peak_bytes = std::max(peak_bytes,estimates[iobj].peak_bytes(nthreads));
+   }
+   boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - time_0;
+
+   out << "{" << std::endl;
+   out << "  \"secant_tolerance\": " << secant_tolerance() << "," << std::endl;
+   out << "  \"threads\": " << nthreads << "," << std::endl;
+   out << "  \"nbool\": " << nbool() << "," << std::endl;
+   out << "  \"cost\": " << cost << "," << std::endl;
+   out << "  \"peak_bytes\": " << peak_bytes << "," << std::endl;
+   out << "  \"estimate_sec\": " << 1.0E-6*ptime_diff.total_microseconds() << "," << std::endl;
+   out << "  \"objects\": [";
+   for(size_t iobj=0; iobj<m_objects.size(); iobj++) {
+      object& obj = *m_objects[iobj];
+      out << ((iobj>0)? "," : "") << std::endl;
+      out << "    {\"index\": " << obj.index+1 << ", \"type\": \"" << ((obj.solid)? "solid" : "shape2d") << "\", \"nbool\": " << obj.nbool;
+      if(obj.solid) {
+         out << ", \"estimate\": ";
+         estimates[iobj].write_json(out,nthreads);
+      }
+      out << "}";
+   }
+   out << std::endl << "  ]" << std::endl;
+   out << "}" << std::endl;
+}
+
+void xcsg_compiler::cancel(const std::string& msg)
+{
+   m_context->cancel(msg);
+}
+
+size_t xcsg_compiler::nbool() const
+{
+   size_t nbool = 0;
+   for(auto& obj : m_objects) nbool += obj->nbool;
+   return nbool;
+}
+
+void xcsg_compiler::compute(std::ostream& log)
+{
+   if(m_objects.size() == 0) throw std::logic_error("xcsg tree contains no data. ");
+
+   // tolerance, timer, instance cache and cancellation of this compilation.
+   // The first failure in a task cancels the remaining work of this compilation
+   compile_context::scope scope(m_context.get());
+   m_context->reset_cancel();
+   m_context->set_max_faces(m_max_faces);
+   check_limits(log);
+
+   // the watchdog cancels the compilation at the time or memory limit, the tasks stop at their next check.
+   // The memory of this compilation is the growth of the resident memory since it started. The peak of
+   // the process can not be used, it never decreases and includes earlier and concurrent compilations
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   const size_t rss_0 = 1024*phase_timer::current_rss_kb();
+   std::mutex              watch_mutex;
+   std::condition_variable watch_cond;
+   bool                    done = false;
+   boost::thread           watchdog;
+   if(m_max_sec > 0.0 || m_max_bytes > 0) {
+      watchdog = boost::thread([this,&watch_mutex,&watch_cond,&done,time_0,rss_0]() {
+         std::unique_lock<std::mutex> lock(watch_mutex);
+         while(!watch_cond.wait_for(lock,std::chrono::milliseconds(100),[&done]() { return done; })) {
+            double elapsed = 0.001*(boost::posix_time::microsec_clock::universal_time() - time_0).total_milliseconds();
+            if(m_max_sec > 0.0 && elapsed > m_max_sec) {
+               m_context->cancel("Time limit of " + std::to_string(m_max_sec) + " [sec] exceeded");
+               break;
+            }
+            size_t rss = 1024*phase_timer::current_rss_kb();
+            if(m_max_bytes > 0 && rss > rss_0 && rss-rss_0 > m_max_bytes) {
+               m_context->cancel("Memory limit of " + std::to_string(m_max_bytes/(1024*1024)) + " MB exceeded");
+               break;
+            }
+         }
+      });
+   }
+   auto stop_watchdog = [&watch_mutex,&watch_cond,&done,&watchdog]() {
+      {
+         std::lock_guard<std::mutex> lock(watch_mutex);
+         done = true;
+      }
+      watch_cond.notify_all();
+      if(watchdog.joinable()) watchdog.join();
+   };
+
+   try {
+      compute_objects(log);
+   }
+   catch(...) {
+      stop_watchdog();
+      throw;
+   }
+   stop_watchdog();
+
+   // a limit reached in a part of the computation that completed anyway still fails it
+   m_context->throw_if_cancelled();
+}
+
+void xcsg_compiler::check_limits(std::ostream& log)
+{
+   if(m_max_faces == 0 && m_max_bytes == 0) return;
+
+   const size_t nthreads = thread_pool::singleton().nthreads();
+   for(auto& obj : m_objects) {
+      if(!obj->solid) continue;
+      mesh_estimate e = obj->solid->estimate(carve::math::Matrix());
+      log << "...estimated " << e.nfaces << " faces, " << e.peak_bytes(nthreads)/(1024*1024) << " MB for booleans" << std::endl;
+      if(m_max_faces > 0 && e.nfaces > m_max_faces) {
+         throw std::logic_error("Estimated " + std::to_string(e.nfaces) + " faces exceed the limit of " + std::to_string(m_max_faces) + " faces");
+      }
+      if(m_max_bytes > 0 && e.peak_bytes(nthreads) > m_max_bytes) {
+         throw std::logic_error("Estimated " + std::to_string(e.peak_bytes(nthreads)/(1024*1024)) + " MB for booleans exceed the limit of " + std::to_string(m_max_bytes/(1024*1024)) + " MB");
+      }
+   }
+}
+
+void xcsg_compiler::compute_objects(std::ostream& log)
+{
+   if(m_objects.size() == 1) {
+      object& obj = *m_objects[0];
+      if(obj.solid) compute_xsolid(obj,log,true);
+      else          compute_xshape2d(obj,log,true);
+      return;
+   }
+
+   size_t nbool_tot = nbool();
+   log << "...completed CSG tree: " <<  nbool_tot << " boolean operations to process." << std::endl;
+   if(nbool_tot > m_max_bool) {
+      std::ostringstream sout;
+      sout << "Max " << m_max_bool << " boolean operations allowed in this configuration.";
+      throw std::logic_error(sout.str());
+   }
+   log << "...computing " << m_objects.size() << " objects concurrently" << std::endl;
+
+   // each object is a task, the booleans within an object are tasks as well. The most expensive
+   // objects are submitted first. The log output of each object is shown in object order afterwards
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   boolean_timer::singleton().init(static_cast<int>(nbool_tot));
+   std::vector<std::ostringstream> object_log(m_objects.size());
+   std::vector<std::pair<double,size_t>> costs;
+   for(size_t iobj=0; iobj<m_objects.size(); iobj++) {
+      object& obj = *m_objects[iobj];
+      costs.push_back(std::make_pair((obj.solid)? obj.solid->cost() : static_cast<double>(obj.nbool+1),iobj));
+   }
+   std::stable_sort(costs.begin(),costs.end(),[](const std::pair<double,size_t>& a, const std::pair<double,size_t>& b) { return a.first > b.first; });
+   thread_pool::task_group group;
+   for(auto& c : costs) {
+      size_t iobj = c.second;
+      thread_pool::singleton().submit(group,[this,&object_log,iobj]() {
+         object& obj = *m_objects[iobj];
+         std::ostringstream& out = object_log[iobj];
+         out << "...object " << iobj+1 << std::endl;
+         if(obj.solid) compute_xsolid(obj,out,false);
+         else          compute_xshape2d(obj,out,false);
+      });
+   }
+   thread_pool::singleton().wait(group);
+   for(auto& out : object_log) log << out.str();
+
+   // the phases of concurrent objects overlap, so they are reported as one
+   size_t nmani = 0;
+   size_t ntri  = 0;
+   for(auto& obj : m_objects) {
+      if(obj->triangles) {
+         nmani += obj->triangles->size();
+         for(auto& mesh : *obj->triangles) ntri += mesh->t_size();
+      }
+      else if(obj->polyset) nmani += obj->polyset->size();
+   }
+   phase_timer::singleton().end_phase("csg");
+   phase_timer::singleton().set_value("nbool",static_cast<double>(nbool_tot));
+   phase_timer::singleton().set_value("objects",static_cast<double>(m_objects.size()));
+   phase_timer::singleton().set_value("lumps",static_cast<double>(nmani));
+   phase_timer::singleton().set_value("triangles",static_cast<double>(ntri));
+   phase_timer::singleton().set_value("disjoint_hits",boolean_timer::singleton().disjoint_hits());
+   phase_timer::singleton().set_value("disjoint_misses",boolean_timer::singleton().disjoint_misses());
+   phase_timer::singleton().set_value("boolean_retries",boolean_timer::singleton().retries_recovered());
+
+   boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - time_0;
+   log << "...completed " << m_objects.size() << " objects in " << std::setprecision(5) << 0.001*ptime_diff.total_milliseconds() << " [sec] " << std::endl;
+   log << "...disjoint bounding boxes: " << boolean_timer::singleton().disjoint_hits() << " hits, "
+       << boolean_timer::singleton().disjoint_misses() << " misses" << std::endl;
+   if(boolean_timer::singleton().retries_recovered() > 0) {
+      log << "...failed booleans recomputed by retry: " << boolean_timer::singleton().retries_recovered() << std::endl;
+   }
+   if(memory_budget::singleton().limit() > 0) {
+      log << "...memory limit: " << memory_budget::singleton().waits() << " booleans waited for memory" << std::endl;
+   }
+   if(instance_cache::singleton().shared() > 0) {
+      log << "...instanced subtrees: " << instance_cache::singleton().shared() << " shared meshes, "
+          << instance_cache::singleton().reused() << " reused" << std::endl;
+   }
+   instance_cache::singleton().clear();
+}
+
+void xcsg_compiler::compute_xsolid(object& obj, std::ostream& log, bool single)
+{
+   size_t nbool = obj.nbool;
+   log << "...completed CSG tree: " <<  nbool << " boolean operations to process." << std::endl;
+   if(nbool > m_max_bool) {
+      std::ostringstream sout;
+      sout << "Max " << m_max_bool << " boolean operations allowed in this configuration.";
+      throw std::logic_error(sout.str());
+   }
+
+   if(nbool > 0) {
+      log << "...starting boolean operations (" << carve_boolean::engine()->name() << " engine)" << std::endl;
+   }
+
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   carve_boolean& csg = obj.csg;
+   try {
+
+      if(single) boolean_timer::singleton().init(static_cast<int>(nbool));
+      const xunion3d* root_union = (m_streaming && m_lump_function)? dynamic_cast<const xunion3d*>(xsolid::unwrap(obj.solid.get())) : nullptr;
+      if(root_union) {
+         auto part_function = [this,&obj](std::shared_ptr<carve::mesh::MeshSet<3>> part) { stream_part(obj,part); };
+         csg.compute(root_union->stream_carve_mesh(carve::math::Matrix(),part_function),carve::csg::CSG::OP::UNION);
+      }
+      else {
+         csg.compute(obj.solid->create_carve_mesh(),carve::csg::CSG::OP::UNION);
+      }
+
+      // the CSG tree and the data of its leaves are not needed after this
+      obj.solid.reset();
+      boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - time_0;
+      double elapsed_sec = 0.001*ptime_diff.total_milliseconds();
+      log << "...completed boolean operations in " << std::setprecision(5) << elapsed_sec << " [sec] " << std::endl;
+
+      if(single) {
+         phase_timer::singleton().end_phase("csg");
+         phase_timer::singleton().set_value("nbool",static_cast<double>(nbool));
+         phase_timer::singleton().set_value("boolean_thread_sec",boolean_timer::singleton().thread_elapsed());
+         phase_timer::singleton().set_value("disjoint_hits",boolean_timer::singleton().disjoint_hits());
+         phase_timer::singleton().set_value("disjoint_misses",boolean_timer::singleton().disjoint_misses());
+         phase_timer::singleton().set_value("boolean_retries",boolean_timer::singleton().retries_recovered());
+         log << "...disjoint bounding boxes: " << boolean_timer::singleton().disjoint_hits() << " hits, "
+             << boolean_timer::singleton().disjoint_misses() << " misses" << std::endl;
+         if(boolean_timer::singleton().retries_recovered() > 0) {
+            log << "...failed booleans recomputed by retry: " << boolean_timer::singleton().retries_recovered() << std::endl;
+         }
+         if(memory_budget::singleton().limit() > 0) {
+            log << "...memory limit: " << memory_budget::singleton().waits() << " booleans waited for memory" << std::endl;
+         }
+         if(instance_cache::singleton().shared() > 0) {
+            log << "...instanced subtrees: " << instance_cache::singleton().shared() << " shared meshes, "
+                << instance_cache::singleton().reused() << " reused" << std::endl;
+         }
+         instance_cache::singleton().clear();
+      }
+   }
+   catch(carve::exception& ex ) {
+
+      // rethrow as std::exception
+      std::string msg("(carve error): ");
+      msg += ex.str();
+      log << "WARNING: " << msg << std::endl;
+//         throw std::exception(msg.c_str());
+   }
+
+   if(obj.streamed > 0) {
+      log << "...streamed " << obj.streamed << ((obj.streamed==1)? " lump": " lumps") << " with " << obj.streamed_triangles << " triangle faces." << std::endl;
+      if(obj.streamed_dropped > 0) log << ">>> Warning: dropped "<< obj.streamed_dropped <<" zero area triangles(s) during triangulation." << std::endl;
+   }
+
+   size_t nmani = csg.size();
+   log << "...result model contains " << nmani << ((nmani==1)? " lump.": " lumps.") << std::endl;
+
+   // we export only triangles.
+   // Each lump is checked and triangulated as a separate task, the triangles are
+   // created directly from the boolean result. The log output and results are collected
+   // in lump order afterwards
+   obj.triangles = std::make_shared<mesh_vector>(nmani);
+   mesh_vector& lump_triangles = *obj.triangles;
+   std::vector<std::ostringstream> lump_log(nmani);
+   thread_pool::task_group group;
+   for(size_t imani=0; imani<nmani; imani++) {
+      thread_pool::singleton().submit(group,[this,&obj,&csg,&lump_triangles,&lump_log,imani]() {
+
+         boost::posix_time::ptime time_1 = boost::posix_time::microsec_clock::universal_time();
+         std::ostringstream& out = lump_log[imani];
+
+         // create & check lump
+         std::shared_ptr<xpolyhedron> poly = csg.create_manifold(imani);
+         out << "...lump " << imani+1 << ": " <<poly->v_size() << " vertices, " << poly->f_size() << " polygon faces." << std::endl;
+
+         // the check only reports, so it runs while the lump is triangulated.
+         // Its messages are shown before the triangulation messages
+         std::ostringstream check_out;
+         size_t num_checked = 0;
+         thread_pool::task_group check_group;
+         thread_pool::singleton().submit(check_group,[&poly,&check_out,&num_checked]() { poly->check_polyhedron(check_out,num_checked); });
+
+         size_t num_non_tri = 0;
+         for(size_t iface=0; iface<poly->f_size(); iface++) num_non_tri += (poly->f_get(iface).size()!=3)? 1 : 0;
+
+         std::ostringstream tri_out;
+         try {
+            if(num_non_tri > 0) tri_out << "...Triangulating lump ... " << std::endl;
+
+            size_t ndropped = 0;
+            lump_triangles[imani] = triangle_mesh::create(*csg.mesh_set()->meshes[imani],ndropped);
+            if(ndropped > 0) tri_out << ">>> Warning: dropped "<< ndropped <<" zero area triangles(s) during triangulation." << std::endl;
+
+            if(num_non_tri > 0) {
+               boost::posix_time::ptime time_2 = boost::posix_time::microsec_clock::universal_time();
+               double elapsed_2 = 0.001*(time_2 - time_1).total_milliseconds();
+               tri_out << "...Triangulation completed with " << lump_triangles[imani]->t_size() << " triangle faces in " << elapsed_2 << " [sec]" << std::endl;
+            }
+         }
+         catch(...) {
+            // the check task refers to this stack frame
+            thread_pool::singleton().wait(check_group);
+            throw;
+         }
+         thread_pool::singleton().wait(check_group);
+         out << check_out.str() << tri_out.str();
+
+         if(!decimating()) {
+            if(m_compact) lump_triangles[imani]->compact();
+            if(m_lump_function) m_lump_function(obj.index,obj.streamed+imani,lump_triangles[imani]);
+         }
+      });
+   }
+   thread_pool::singleton().wait(group);
+
+   if(decimating()) decimate_lumps(obj,lump_log);
+   if(m_compact) csg.clear();
+
+   for(size_t imani=0; imani<nmani; imani++) {
+      log << lump_log[imani].str();
+   }
+
+   if(single) {
+      size_t ntri = obj.streamed_triangles;
+      for(auto& mesh : *obj.triangles) ntri += mesh->t_size();
+      phase_timer::singleton().end_phase("triangulate");
+      phase_timer::singleton().set_value("lumps",static_cast<double>(nmani+obj.streamed));
+      phase_timer::singleton().set_value("triangles",static_cast<double>(ntri));
+   }
+}
+
+void xcsg_compiler::stream_part(object& obj, std::shared_ptr<carve::mesh::MeshSet<3>> part)
+{
+   // the lump number is taken when the lump is complete, so the lump function receives them nearly in order
+   for(auto mesh : part->meshes) {
+      size_t ndropped = 0;
+      std::shared_ptr<triangle_mesh> lump = triangle_mesh::create(*mesh,ndropped);
+      obj.streamed_triangles += lump->t_size();
+      obj.streamed_dropped   += ndropped;
+      m_lump_function(obj.index,obj.streamed++,lump);
+   }
+}
+
+void xcsg_compiler::decimate_lumps(object& obj, std::vector<std::ostringstream>& lump_log)
+{
+   // the target number of faces is shared by the lumps in proportion to their size
+   mesh_vector& lump_triangles = *obj.triangles;
+   size_t ntri = 0;
+   for(auto& mesh : lump_triangles) ntri += mesh->t_size();
+
+   thread_pool::task_group group;
+   for(size_t imani=0; imani<lump_triangles.size(); imani++) {
+      thread_pool::singleton().submit(group,[this,&obj,&lump_triangles,&lump_log,ntri,imani]() {
+
+         boost::posix_time::ptime time_1 = boost::posix_time::microsec_clock::universal_time();
+         std::ostringstream& out = lump_log[imani];
+         std::shared_ptr<triangle_mesh> mesh = lump_triangles[imani];
+
+         size_t target = 0;
+         if(m_decimate_faces > 0) {
+            double share = static_cast<double>(mesh->t_size())/static_cast<double>(std::max<size_t>(ntri,1));
+            target = std::max<size_t>(4,static_cast<size_t>(share*m_decimate_faces + 0.5));
+         }
+         if(target == 0 || target < mesh->t_size()) {
+            std::shared_ptr<triangle_mesh> decimated = decimate_mesh::decimate(*mesh,target,m_decimate_error);
+            boost::posix_time::ptime time_2 = boost::posix_time::microsec_clock::universal_time();
+            double elapsed_2 = 0.001*(time_2 - time_1).total_milliseconds();
+            out << "...Decimation completed with " << decimated->t_size() << " of " << mesh->t_size() << " triangle faces in " << elapsed_2 << " [sec]" << std::endl;
+
+            // the decimated lump is checked like the boolean result
+            xpolyhedron poly;
+            poly.v_reserve(decimated->v_size());
+            for(size_t iv=0; iv<decimated->v_size(); iv++) poly.v_add(decimated->v_get(iv));
+            poly.f_reserve(decimated->t_size());
+            for(size_t itri=0; itri<decimated->t_size(); itri++) {
+               const uint32_t* tri = decimated->t_get(itri);
+               poly.f_add(tri,tri+3,false);
+            }
+            size_t num_non_tri = 0;
+            poly.check_polyhedron(out,num_non_tri);
+
+            lump_triangles[imani] = decimated;
+         }
+
+         if(m_compact) lump_triangles[imani]->compact();
+         if(m_lump_function) m_lump_function(obj.index,obj.streamed+imani,lump_triangles[imani]);
+      });
+   }
+   thread_pool::singleton().wait(group);
+}
+
+void xcsg_compiler::compute_xshape2d(object& obj, std::ostream& log, bool single)
+{
+   size_t nbool = obj.shape2d->nbool();
+   log << "...completed CSG tree: " <<  nbool << " boolean operations to process." << std::endl;
+   if(nbool > m_max_bool) {
+      std::ostringstream sout;
+      sout << "Max " << m_max_bool << " boolean operations allowed in this configuration.";
+      throw std::logic_error(sout.str());
+   }
+
+   if(nbool > 0) {
+      log << "...starting boolean operations" << std::endl;
+   }
+   clipper_boolean csg;
+   csg.compute(obj.shape2d->create_clipper_profile(),ClipperLib::ctUnion);
+
+   obj.polyset = csg.profile()->polyset();
+   size_t nmani = obj.polyset->size();
+   log << "...result model contains " << nmani << ((nmani==1)? " lump.": " lumps.") << std::endl;
+   if(single) {
+      if(clipper_offset::cache_hits() > 0) log << "...offset cache: " << clipper_offset::cache_hits() << " reused offsets" << std::endl;
+      clipper_offset::clear_cache();
+      phase_timer::singleton().end_phase("csg");
+      phase_timer::singleton().set_value("lumps",static_cast<double>(nmani));
+   }
+}
@@ -0,0 +1,182 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XCSG_COMPILER_H
+#define XCSG_COMPILER_H
+
+#include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <carve/csg.hpp>
+#include "carve_boolean.h"
+#include "triangle_mesh.h"
+
+class cf_xmlTree;
+class xsolid;
+class xshape2d;
+class polyset2d;
+class compile_context;
+
+// xcsg_compiler compiles an xcsg tree held in memory into its result model, it is the
+// entry point for programs embedding xcsg (libxcsg). No files are read or written:
+// a 3d model gives triangle meshes, one per lump, a 2d model gives a polyset2d.
+// The results can be written to caller supplied streams with out_triangles.
+//
+//    xcsg_compiler compiler;
+//    if(compiler.compile(tree,log)) {
+//       out_triangles exporter(compiler.triangles());
+//       exporter.write_stl(stream,true);
+//    }
+//
+// Normally only the first top-level object of the tree is compiled. With all_objects, every
+// top-level solid and shape2d is compiled, and the objects are computed concurrently.
+// Each compiler has its own compile_context holding the secant tolerance, boolean timer,
+// instance cache and cancellation state, so compilers may run concurrently in different
+// threads. They share the process wide thread pool and the content keyed mesh caches.
+// The first failure in any task cancels the remaining tasks of the compilation.
+
+class xcsg_compiler {
+public:
+   typedef triangle_mesh_vector mesh_vector;
+
+   // receives lump ilump of object iobj as soon as it is triangulated
+   typedef std::function<void(size_t iobj, size_t ilump, std::shared_ptr<triangle_mesh> mesh)> lump_function;
+
+   // max_bool limits the number of boolean operations in a model
+   xcsg_compiler(size_t max_bool = std::numeric_limits<size_t>::max());
+   virtual ~xcsg_compiler();
+
+   // build and compute the first (or all) solid or shape2d in tree, writing progress messages to log.
+   // Returns false if the tree contains no xcsg object, throws on errors
+   bool compile(cf_xmlTree& tree, std::ostream& log, bool all_objects = false);
+
+   // build the CSG objects from the first (or all) solid or shape2d in tree and set the secant
+   // tolerance of the model. The xml tree is cleared, the CSG objects hold all data they need
+   bool build(cf_xmlTree& tree, std::ostream& log, bool all_objects = false);
+
+   // compute the booleans of the built objects, and triangulate the lumps of solids
+   void compute(std::ostream& log);
+
+   // estimate the size and boolean cost of the built objects without computing them, see mesh_estimate,
+   // and write the estimate to out as JSON. Leaves are meshed, no 3d boolean runs
+   void estimate(std::ostream& out);
+
+   // create a compiler for the objects built by this compiler, computed with another secant tolerance.
+   // The CSG objects are shared, so the model is parsed and built once for several tolerances. The
+   // compilers have separate contexts and may compute concurrently. Must be called before compute
+   std::shared_ptr<xcsg_compiler> derive(double secant_tolerance) const;
+
+   // secant tolerance of the model, set by build or derive
+   double secant_tolerance() const;
+
+   // cancel a running compute from another thread, compute then throws std::logic_error with msg
+   void cancel(const std::string& msg);
+
+   // number of objects built
+   size_t size() const { return m_objects.size(); }
+
+   // true if the object is a solid, false if it is a shape2d
+   bool is_solid(size_t iobj = 0) const { return m_objects[iobj]->shape2d.get() == nullptr; }
+
+   // 3d result: triangle meshes, one per lump. nullptr for a 2d object
+   std::shared_ptr<mesh_vector> triangles(size_t iobj = 0) const { return m_objects[iobj]->triangles; }
+
+   // 3d result before triangulation, nullptr for a 2d object
+   std::shared_ptr<carve::mesh::MeshSet<3>> mesh_set(size_t iobj = 0) { return m_objects[iobj]->csg.mesh_set(); }
+
+   // 2d result, nullptr for a 3d object
+   std::shared_ptr<polyset2d> polyset(size_t iobj = 0) const { return m_objects[iobj]->polyset; }
+
+   // number of boolean operations in all objects
+   size_t nbool() const;
+
+   // call f for every lump triangulated by compute, e.g. to stream it to an export file while other
+   // lumps are being computed. f is called from thread_pool tasks, possibly concurrently
+   void set_lump_function(lump_function f) { m_lump_function = f; }
+
+   // reduce the triangulated lumps of solids to target_faces triangles in total, or until the
+   // error of a collapse exceeds max_error, see decimate_mesh. A value of 0 is not used as limit
+   void set_decimation(size_t target_faces, double max_error) { m_decimate_faces = target_faces; m_decimate_error = max_error; }
+
+   // stream a solid whose top-level object is a union3d: each lump is triangulated and passed to the lump function
+   // as soon as no other child of the union can touch it, and released, see carve_union_tree. The streamed lumps are
+   // not kept in triangles() and not checked, so the model is never held in memory as a whole. Requires a lump function
+   void set_streaming(bool stream) { m_streaming = stream; }
+
+   // limits of the resources of compute, 0 means no limit. Before any boolean runs, the estimated faces
+   // and memory of each solid are checked against max_faces and max_bytes, see estimate. During compute,
+   // a boolean result with more than max_faces faces fails the compilation, and it is cancelled when the
+   // wall time exceeds max_sec or the resident memory of the process has grown by more than max_bytes since
+   // compute started (Linux only). compute then throws std::logic_error
+   void set_limits(size_t max_faces, size_t max_bytes, double max_sec) { m_max_faces = max_faces; m_max_bytes = max_bytes; m_max_sec = max_sec; }
+
+   // hold the triangulated lumps of solids with float32 vertices, see triangle_mesh::compact, and release
+   // the boolean result once it is triangulated, so the export stage holds only the compact triangles.
+   // mesh_set() then returns nullptr
+   void set_compact(bool compact) { m_compact = compact; }
+
+protected:
+   // the solid is released when its boolean result is computed
+   struct object {
+      size_t                       index = 0;
+      size_t                       nbool = 0;
+      std::shared_ptr<xsolid>      solid;
+      std::shared_ptr<xshape2d>    shape2d;
+      carve_boolean                csg;
+      std::shared_ptr<mesh_vector> triangles;
+      std::shared_ptr<polyset2d>   polyset;
+      std::atomic<size_t>          streamed{0};            // lumps passed on by a streamed union
+      std::atomic<size_t>          streamed_triangles{0};
+      std::atomic<size_t>          streamed_dropped{0};    // zero area triangles dropped from streamed lumps
+   };
+
+   // compute all objects
+   void compute_objects(std::ostream& log);
+
+   // throw std::logic_error if the estimate of a solid exceeds max_faces or max_bytes
+   void check_limits(std::ostream& log);
+
+   // compute one object. When single is true it is the only object, and the phase
+   // times and process wide boolean statistics are reported for it
+   void compute_xsolid(object& obj, std::ostream& log, bool single);
+   void compute_xshape2d(object& obj, std::ostream& log, bool single);
+
+   // triangulate the lumps of a final part of a streamed union and pass them to the lump function
+   void stream_part(object& obj, std::shared_ptr<carve::mesh::MeshSet<3>> part);
+
+   // decimate the triangulated lumps of obj, messages are appended to the lump logs
+   bool decimating() const { return m_decimate_faces > 0 || m_decimate_error > 0.0; }
+   void decimate_lumps(object& obj, std::vector<std::ostringstream>& lump_log);
+
+private:
+   size_t                               m_max_bool;
+   std::vector<std::shared_ptr<object>> m_objects;
+   std::shared_ptr<compile_context>     m_context;
+   lump_function                        m_lump_function;
+   size_t                               m_decimate_faces;
+   double                               m_decimate_error;
+   bool                                 m_streaming;
+   bool                                 m_compact;
+   size_t                               m_max_faces;
+   size_t                               m_max_bytes;
+   double                               m_max_sec;
+};
+
+#endif // XCSG_COMPILER_H
@@ -24,8 +24,9 @@
 #include "xdifference3d.h"
 #include "xintersection3d.h"
 #include "xpolyhedron.h"
+#include "ximport3d.h"
 #include "xsphere.h"
-// #include "xtin_model.h"
+#include "xtin_model.h"
 #include "xunion3d.h"
 #include "xhull3d.h"
 #include "xlinear_extrude.h"
@@ -33,6 +34,8 @@
 #include "xtransform_extrude.h"
 #include "xsweep.h"
 #include "xminkowski3d.h"
+#include "xarray3d.h"
+#include "xsymmetry3d.h"
 
 #include "xcircle.h"
 #include "xpolygon.h"
@@ -46,6 +49,18 @@
 #include "xoffset2d.h"
 #include "xminkowski2d.h"
 #include "xprojection2d.h"
+#include "xarray2d.h"
+
+#include "node_profiler.h"
+#include "xprofiled_solid.h"
+#include "xprofiled_shape2d.h"
+#include "xshared_solid.h"
+#include "xtmatrix.h"
+#include "mesh_cache.h"
+#include "mesh_utils.h"
+#include "instance_cache.h"
+#include "compile_context.h"
+#include "remote_executor.h"
 
 xcsg_factory::xcsg_factory()
 {
@@ -56,8 +71,9 @@ xcsg_factory::xcsg_factory()
    m_solid_map.insert(std::make_pair("difference3d",xcsg_factory::make_difference3d));
    m_solid_map.insert(std::make_pair("intersection3d",xcsg_factory::make_intersection3d));
    m_solid_map.insert(std::make_pair("polyhedron",xcsg_factory::make_polyhedron));
+   m_solid_map.insert(std::make_pair("import3d",xcsg_factory::make_import3d));
    m_solid_map.insert(std::make_pair("sphere",xcsg_factory::make_sphere));
- // experimental only  m_solid_map.insert(std::make_pair("tin_model",xcsg_factory::make_tin_model));
+   m_solid_map.insert(std::make_pair("tin_model",xcsg_factory::make_tin_model));
    m_solid_map.insert(std::make_pair("union3d",xcsg_factory::make_union3d));
    m_solid_map.insert(std::make_pair("hull3d",xcsg_factory::make_hull3d));
    m_solid_map.insert(std::make_pair("linear_extrude",xcsg_factory::make_linear_extrude));
@@ -65,6 +81,11 @@ xcsg_factory::xcsg_factory()
    m_solid_map.insert(std::make_pair("transform_extrude",xcsg_factory::make_transform_extrude));
    m_solid_map.insert(std::make_pair("sweep",xcsg_factory::make_sweep));
    m_solid_map.insert(std::make_pair("minkowski3d",xcsg_factory::make_minkowski3d));
+   m_solid_map.insert(std::make_pair("array3d",xcsg_factory::make_array3d));
+   m_solid_map.insert(std::make_pair("symmetry3d",xcsg_factory::make_symmetry3d));
+
+   // composite solids consulting the instance_cache, equal subtrees of these are built once
+   m_shared_tags = { "union3d", "difference3d", "intersection3d", "hull3d", "minkowski3d", "array3d", "symmetry3d" };
 
    m_shape2d_map.insert(std::make_pair("circle",xcsg_factory::make_circle));
    m_shape2d_map.insert(std::make_pair("polygon",xcsg_factory::make_polygon));
@@ -78,6 +99,7 @@ xcsg_factory::xcsg_factory()
    m_shape2d_map.insert(std::make_pair("offset2d",xcsg_factory::make_offset2d));
    m_shape2d_map.insert(std::make_pair("minkowski2d",xcsg_factory::make_minkowski2d));
    m_shape2d_map.insert(std::make_pair("projection2d",xcsg_factory::make_projection2d));
+   m_shape2d_map.insert(std::make_pair("array2d",xcsg_factory::make_array2d));
 }
 
 xcsg_factory::~xcsg_factory()
@@ -94,17 +116,82 @@ bool xcsg_factory::is_solid(const cf_xmlNode& node)
 }
 
 std::shared_ptr<xsolid> xcsg_factory::make_solid(const cf_xmlNode& node)
+{
+   std::shared_ptr<xsolid> solid = make_solid_node(node);
+
+   // subtrees large enough to be sent to remote workers keep their xml
+   remote_executor& remote = remote_executor::singleton();
+   if(remote.enabled() && solid->nbool() >= remote.min_bool()) solid->set_fragment(remote_executor::make_fragment(node));
+   return solid;
+}
+
+std::shared_ptr<xsolid> xcsg_factory::make_solid_node(const cf_xmlNode& node)
 {
    std::string tag = node.tag();
    auto i=m_solid_map.find(tag);
    if(i != m_solid_map.end()) {
       solid_factory f = i->second;
-      return f(node);
+      bool shared = m_shared_tags.find(tag) != m_shared_tags.end();
+      if(!node_profiler::singleton().enabled()) {
+         if(shared) return make_shared_solid(node,f);
+         return f(node);
+      }
+
+      // the children are built inside f and registered below this node. The wrapper is
+      // seen through by the type tests of the nodes, see xsolid::unwrap
+      size_t id = node_profiler::singleton().begin_node(node);
+      std::shared_ptr<xsolid> solid;
+      try {
+         solid = (shared)? make_shared_solid(node,f) : f(node);
+      }
+      catch(...) {
+         node_profiler::singleton().end_node();
+         throw;
+      }
+      node_profiler::singleton().end_node();
+      return std::shared_ptr<xsolid>(new xprofiled_solid(node,solid,id));
    }
    throw logic_error("make_solid: No factory function installed for XML tag " + tag);
    return 0;
 }
 
+std::shared_ptr<xsolid> xcsg_factory::make_shared_solid(const cf_xmlNode& node, solid_factory f)
+{
+   // the shared subtrees belong to the compilation, outside one nothing is shared
+   compile_context* ctx = compile_context::current();
+   if(!ctx) return f(node);
+   std::map<std::string,std::shared_ptr<xsolid>>& shared = ctx->shared_solids();
+
+   std::string hash = mesh_cache::subtree_hash(node,false);
+   auto is = shared.find(hash);
+   if(is != shared.end()) {
+      std::shared_ptr<xsolid> proto = is->second;
+
+      // this node is evaluated as the prototype with its own transform replaced by ours
+      carve::math::Matrix inv;
+      if(mesh_utils::invert_affine(proto->get_transform(),inv)) {
+         carve::math::Matrix t;
+         cf_xmlNode tm_node;
+         if(node.get_child("tmatrix",tm_node)) t = xtmatrix(tm_node).t();
+
+         instance_cache::singleton().register_instance(hash);
+         return std::shared_ptr<xsolid>(new xshared_solid(node,proto,t*inv));
+      }
+      // a singular prototype transform cannot be replaced, so the subtree is built again
+      return f(node);
+   }
+
+   std::shared_ptr<xsolid> solid = f(node);
+   shared[hash] = solid;
+   return solid;
+}
+
+void xcsg_factory::clear_shared()
+{
+   compile_context* ctx = compile_context::current();
+   if(ctx) ctx->shared_solids().clear();
+}
+
 
 std::shared_ptr<xsolid> xcsg_factory::make_cone(const cf_xmlNode& node)               { return std::shared_ptr<xsolid>(new xcone(node));           }
 std::shared_ptr<xsolid> xcsg_factory::make_cube(const cf_xmlNode& node)               { return std::shared_ptr<xsolid>(new xcube(node));           }
@@ -113,8 +200,9 @@ std::shared_ptr<xsolid> xcsg_factory::make_cylinder(const cf_xmlNode& node)
 std::shared_ptr<xsolid> xcsg_factory::make_difference3d(const cf_xmlNode& node)       { return std::shared_ptr<xsolid>(new xdifference3d(node));   }
 std::shared_ptr<xsolid> xcsg_factory::make_intersection3d(const cf_xmlNode& node)     { return std::shared_ptr<xsolid>(new xintersection3d(node)); }
 std::shared_ptr<xsolid> xcsg_factory::make_polyhedron(const cf_xmlNode& node)         { return std::shared_ptr<xsolid>(new xpolyhedron(node));     }
+std::shared_ptr<xsolid> xcsg_factory::make_import3d(const cf_xmlNode& node)           { return std::shared_ptr<xsolid>(new ximport3d(node));       }
 std::shared_ptr<xsolid> xcsg_factory::make_sphere(const cf_xmlNode& node)             { return std::shared_ptr<xsolid>(new xsphere(node));         }
-// std::shared_ptr<xsolid> xcsg_factory::make_tin_model(const cf_xmlNode& node)          { return std::shared_ptr<xsolid>(new xtin_model(node));      }
+std::shared_ptr<xsolid> xcsg_factory::make_tin_model(const cf_xmlNode& node)          { return std::shared_ptr<xsolid>(new xtin_model(node));      }
 std::shared_ptr<xsolid> xcsg_factory::make_union3d(const cf_xmlNode& node)            { return std::shared_ptr<xsolid>(new xunion3d(node));        }
 std::shared_ptr<xsolid> xcsg_factory::make_hull3d(const cf_xmlNode& node)             { return std::shared_ptr<xsolid>(new xhull3d(node));         }
 std::shared_ptr<xsolid> xcsg_factory::make_linear_extrude(const cf_xmlNode& node)     { return std::shared_ptr<xsolid>(new xlinear_extrude(node)); }
@@ -122,6 +210,8 @@ std::shared_ptr<xsolid> xcsg_factory::make_rotate_extrude(const cf_xmlNode& node
 std::shared_ptr<xsolid> xcsg_factory::make_transform_extrude(const cf_xmlNode& node)  { return std::shared_ptr<xsolid>(new xtransform_extrude(node)); }
 std::shared_ptr<xsolid> xcsg_factory::make_sweep(const cf_xmlNode& node)              { return std::shared_ptr<xsolid>(new xsweep(node));          }
 std::shared_ptr<xsolid> xcsg_factory::make_minkowski3d(const cf_xmlNode& node)        { return std::shared_ptr<xsolid>(new xminkowski3d(node));    }
+std::shared_ptr<xsolid> xcsg_factory::make_array3d(const cf_xmlNode& node)            { return std::shared_ptr<xsolid>(new xarray3d(node));        }
+std::shared_ptr<xsolid> xcsg_factory::make_symmetry3d(const cf_xmlNode& node)         { return std::shared_ptr<xsolid>(new xsymmetry3d(node));     }
 
 std::shared_ptr<xshape2d>  xcsg_factory::make_shape2d(const cf_xmlNode& node)
 {
@@ -129,7 +219,21 @@ std::shared_ptr<xshape2d>  xcsg_factory::make_shape2d(const cf_xmlNode& node)
    auto i=m_shape2d_map.find(tag);
    if(i != m_shape2d_map.end()) {
       shape2d_factory f = i->second;
-      return f(node);
+      if(!node_profiler::singleton().enabled()) return f(node);
+
+      // the children are built inside f and registered below this node. The wrapper is
+      // seen through by the type tests of the nodes, see xshape2d::unwrap
+      size_t id = node_profiler::singleton().begin_node(node);
+      std::shared_ptr<xshape2d> shape;
+      try {
+         shape = f(node);
+      }
+      catch(...) {
+         node_profiler::singleton().end_node();
+         throw;
+      }
+      node_profiler::singleton().end_node();
+      return std::shared_ptr<xshape2d>(new xprofiled_shape2d(node,shape,id));
    }
    throw logic_error("make_shape2d: No factory function installed for XML tag " + tag);
    return 0;
@@ -147,3 +251,4 @@ std::shared_ptr<xshape2d> xcsg_factory::make_fill2d(const cf_xmlNode& node)
 std::shared_ptr<xshape2d> xcsg_factory::make_offset2d(const cf_xmlNode& node)       { return std::shared_ptr<xshape2d>(new xoffset2d(node));       }
 std::shared_ptr<xshape2d> xcsg_factory::make_minkowski2d(const cf_xmlNode& node)    { return std::shared_ptr<xshape2d>(new xminkowski2d(node));    }
 std::shared_ptr<xshape2d> xcsg_factory::make_projection2d(const cf_xmlNode& node)   { return std::shared_ptr<xshape2d>(new xprojection2d(node));   }
+std::shared_ptr<xshape2d> xcsg_factory::make_array2d(const cf_xmlNode& node)        { return std::shared_ptr<xshape2d>(new xarray2d(node));        }
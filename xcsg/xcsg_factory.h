@@ -18,6 +18,8 @@
 
 #include <map>
 #include <memory>
+#include <set>
+#include <string>
 
 class xsolid;
 class xshape2d;
@@ -42,12 +44,21 @@ public:
    std::shared_ptr<xshape2d> make_shape2d(const cf_xmlNode& node);
    std::shared_ptr<xsolid>   make_solid(const cf_xmlNode& node);
 
+   // forget the subtrees shared by make_solid in the current compile_context, called when a model has been built
+   void clear_shared();
+
 protected:
    xcsg_factory();
    virtual ~xcsg_factory();
 
 protected:
 
+   // build the solid of node, make_solid adds the fragment for remote workers
+   std::shared_ptr<xsolid> make_solid_node(const cf_xmlNode& node);
+
+   // build a composite solid, or share an equal subtree built earlier that differs only in its own transform
+   std::shared_ptr<xsolid> make_shared_solid(const cf_xmlNode& node, solid_factory f);
+
    // concrete 3d types
    static std::shared_ptr<xsolid> make_cone(const cf_xmlNode& node);
    static std::shared_ptr<xsolid> make_cube(const cf_xmlNode& node);
@@ -56,6 +67,7 @@ protected:
    static std::shared_ptr<xsolid> make_difference3d(const cf_xmlNode& node);
    static std::shared_ptr<xsolid> make_intersection3d(const cf_xmlNode& node);
    static std::shared_ptr<xsolid> make_polyhedron(const cf_xmlNode& node);
+   static std::shared_ptr<xsolid> make_import3d(const cf_xmlNode& node);
    static std::shared_ptr<xsolid> make_sphere(const cf_xmlNode& node);
    static std::shared_ptr<xsolid> make_tin_model(const cf_xmlNode& node);
 
@@ -66,6 +78,8 @@ protected:
    static std::shared_ptr<xsolid> make_transform_extrude(const cf_xmlNode& node);
    static std::shared_ptr<xsolid> make_sweep(const cf_xmlNode& node);
    static std::shared_ptr<xsolid> make_minkowski3d(const cf_xmlNode& node);
+   static std::shared_ptr<xsolid> make_array3d(const cf_xmlNode& node);
+   static std::shared_ptr<xsolid> make_symmetry3d(const cf_xmlNode& node);
 
 
    // concrete 2d types
@@ -82,6 +96,7 @@ protected:
    static std::shared_ptr<xshape2d> make_offset2d(const cf_xmlNode& node);
    static std::shared_ptr<xshape2d> make_minkowski2d(const cf_xmlNode& node);
    static std::shared_ptr<xshape2d> make_projection2d(const cf_xmlNode& node);
+   static std::shared_ptr<xshape2d> make_array2d(const cf_xmlNode& node);
 
 private:
    typedef std::map<std::string,solid_factory> solid_factory_map;
@@ -89,6 +104,8 @@ private:
 
    solid_factory_map    m_solid_map;
    shape2d_factory_map  m_shape2d_map;
+
+   std::set<std::string> m_shared_tags; // composite solids that may be shared
 };
 
 #endif // XCSG_FACTORY_H
@@ -14,39 +14,127 @@
 // EndLicense:
 
 #include "xcsg_main.h"
+#include "xcsg_compiler.h"
 
 #include <boost/date_time.hpp>
+#include <boost/filesystem.hpp>
 
 #include <sstream>
+#include <vector>
 #include <stdexcept>
+#include <ctime>
+#include <cstdlib>
+#include <functional>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
 using namespace std;
 #include "csg_parser/cf_xmlTree.h"
 
 #include "xshape2d.h"
 
 #include "clipper_boolean.h"
+#include "clipper_csg/clipper_offset.h"
 #include "carve_boolean.h"
-#include "carve_triangulate.h"
-#include "mesh_utils.h"
 #include "xpolyhedron.h"
-#include "xcsg_factory.h"
-#include "boolean_timer.h"
+#include "sdf_engine.h"
+#include "mesh_utils.h"
+#include "thread_pool.h"
+#include "mesh_cache.h"
+#include "instance_cache.h"
+#include "node_profiler.h"
+#include "perf_counters.h"
+#include "trace_recorder.h"
+#include "message_log.h"
+#include "phase_timer.h"
+#include "memory_budget.h"
+#include "malloc_tuning.h"
+#include "project_mesh.h"
+#include "extrude_mesh.h"
+#include "remote_executor.h"
 
 #include "openscad_csg.h"
 #include "out_triangles.h"
+#include "export_hash.h"
+#include "file_watch.h"
 #include "amf_file.h"
 #include "dxf_file.h"
 #include "svg_file.h"
+#include "xmesh_file.h"
 
 #include "std_filename.h"
 
 #include "csg_parser/csg_parser.h"
+#include "csg_parser/csg_value.h"
+
+// seconds between checkpoint files of a long build, see mesh_cache
+static const double checkpoint_interval = 60;
 
 static std::string DisplayName(const std_filename& fname, bool show_path)
 {
    return ((show_path)? fname.GetFullPath() : fname.GetFullName());
 }
 
+// --decimate value: an integer is the target number of triangles, a decimal number the max collapse error
+static void decimate_option(const std::string& value, size_t& target_faces, double& max_error)
+{
+   target_faces = 0;
+   max_error    = 0.0;
+   try {
+      size_t pos = 0;
+      if(value.find_first_of(".eE") != std::string::npos) max_error    = std::stod(value,&pos);
+      else                                                target_faces = std::stoul(value,&pos);
+      if(pos == value.size() && (target_faces > 0 || max_error > 0.0)) return;
+   }
+   catch(std::exception&) {}
+   throw std::runtime_error("Invalid decimate value: " + value);
+}
+
+// --tolerances value: comma separated secant tolerances, each giving one output set
+static std::vector<double> tolerances_option(const std::string& value)
+{
+   std::vector<double> tolerances;
+   std::istringstream in(value);
+   std::string item;
+   while(std::getline(in,item,',')) {
+      try {
+         size_t pos = 0;
+         double tol = std::stod(item,&pos);
+         if(pos == item.size() && tol > 0.0) {
+            tolerances.push_back(tol);
+            continue;
+         }
+      }
+      catch(std::exception&) {}
+      throw std::runtime_error("Invalid tolerances value: " + value);
+   }
+   if(tolerances.size() == 0) throw std::runtime_error("Invalid tolerances value: " + value);
+   return tolerances;
+}
+
+// --time_budget value: seconds, optionally followed by 's'
+static double time_budget_option(const std::string& value, const std::string& option = "time_budget")
+{
+   try {
+      size_t pos = 0;
+      double sec = std::stod(value,&pos);
+      if(pos < value.size() && value[pos] == 's') pos++;
+      if(pos == value.size() && sec > 0.0) return sec;
+   }
+   catch(std::exception&) {}
+   throw std::runtime_error("Invalid " + option + " value: " + value);
+}
+
+// STL is written to a temporary name first and renamed when the other formats are complete,
+// so that it is the most recent file. Returns the .xcsg path the temporary STL name is derived from
+static std::string stl_part_xcsg(const std::string& xcsg_file)
+{
+   std_filename stl_tmp(xcsg_file);
+   stl_tmp.SetName(stl_tmp.GetName() + ".part");
+   return stl_tmp.GetFullPath();
+}
+
 xcsg_main::xcsg_main(const boost_command_line& cmd)
 : m_cmd(cmd)
 {}
@@ -65,61 +153,252 @@ bool xcsg_main::run()
    std::string xcsg_file;
    try {
       xcsg_file = m_cmd.get<std::string>("xcsg-file");
-      std::replace(xcsg_file.begin(),xcsg_file.end(), '\\', '/');
    }
    catch(std::exception& ex) {
       ostringstream sout;
       sout << "xcsg  command line processing error: " << ex.what() << ", please report. "<< endl;
       throw std::logic_error(sout.str());
    }
+   if(m_cmd.count("watch")>0) {
+      watch(xcsg_file);
+      return true;
+   }
+   return run(xcsg_file);
+}
+
+void xcsg_main::watch(const std::string& xcsg_file)
+{
+   // the thread pool, the primitive caches and the boolean results stay warm between the runs
+   mesh_cache::singleton().set_memory(true);
+   file_watch watcher(xcsg_file);
+   while(true) {
+      try {
+         run(xcsg_file);
+      }
+      catch(std::exception& ex) {
+         // a failing edit must not end the session, the next save is processed as usual
+         message_log::singleton().flush();
+         cout << "xcsg failed: " << ex.what() << endl;
+      }
+      message_log::singleton().flush();
+      cout << "...watching " << xcsg_file << " for changes, Ctrl-C to stop" << endl;
+      watcher.wait();
+   }
+}
+
+bool xcsg_main::run(std::string xcsg_file)
+{
+   if(!m_cmd.parsed_ok())return false;
+   std::replace(xcsg_file.begin(),xcsg_file.end(), '\\', '/');
 
    if(!std_filename::Exists(xcsg_file)) throw std::runtime_error("File does not exist: " + xcsg_file);
 
-   // determine if we shall display full file paths
-   bool show_path = m_cmd.count("fullpath")>0;
+   configure();
 
-   cf_xmlTree tree;
-   std_filename file(xcsg_file);
+   // phase timing and tracing start here so they cover the whole run
+   phase_timer::singleton().start();
+   if(m_cmd.count("trace")) trace_recorder::singleton().enable();
+   else                     trace_recorder::singleton().disable();
 
-   if(file.GetExt() == ".csg") {
+   // node profiling must be enabled before the CSG tree is built
+   node_profiler::singleton().reset();
+   if(m_cmd.count("profile")) node_profiler::singleton().enable();
 
-      cout << "Converting from: " << DisplayName(xcsg_file,show_path) << endl;
-      std::ifstream csg(xcsg_file);
-      csg_parser parser(csg,m_cmd.secant_tolerance());
-      parser.to_xcsg(tree);
+   // hardware counters per phase and thread are added to the profile
+   perf_counters::singleton().reset();
+   if(m_cmd.count("counters")) {
+      if(m_cmd.count("profile") == 0) cout << "Info: --counters ignored, it requires --profile" << endl;
+      else if(!perf_counters::singleton().enable()) cout << "Info: performance counters not available, " << perf_counters::singleton().error() << endl;
+   }
 
-      file.SetExt("xcsg");
-      xcsg_file = file.GetFullPath();
-      tree.write_xml(xcsg_file);
+   // operands of slow booleans are captured next to the input file for xcsg_replay
+   carve_boolean::set_capture("",0.0);
+   if(m_cmd.count("capture_booleans")) {
+      std_filename dir(xcsg_file);
+      boost::filesystem::path path(dir.GetPath());
+      path /= dir.GetName() + ".xcsg_capture";
+      carve_boolean::set_capture(path.string(),time_budget_option(m_cmd.get<std::string>("capture_booleans"),"capture_booleans"));
    }
 
-   if(tree.read_xml(xcsg_file)) {
+   // reuse boolean results from previous runs if requested.
+   // Incremental mode defaults to a cache directory next to the input file
+   bool incremental = m_cmd.count("incremental")>0;
+   bool watching    = mesh_cache::singleton().memory();
+   bool resume      = m_cmd.count("resume")>0;
+   bool checkpoint  = !watching && (resume || m_cmd.count("checkpoint")>0);
+   std::string checkpoint_dir;
+   auto cache_pair = m_cmd.cache_dir();
+   if(checkpoint) {
+      // a new build starts with an empty checkpoint, a resumed one reuses the completed subtrees
+      checkpoint_dir = (m_cmd.count("checkpoint"))? m_cmd.get<std::string>("checkpoint") : "";
+      if(checkpoint_dir.length() == 0) {
+         std_filename dir(xcsg_file);
+         boost::filesystem::path path(dir.GetPath());
+         path /= dir.GetName() + ".xcsg_checkpoint";
+         checkpoint_dir = path.string();
+      }
+      if(!resume) mesh_cache::clear_checkpoint(checkpoint_dir,false);
+      else if(!boost::filesystem::is_directory(checkpoint_dir)) cout << "...resume: no checkpoint found, starting from the beginning" << endl;
+      mesh_cache::singleton().set_cache_dir(checkpoint_dir);
+      mesh_cache::singleton().set_checkpoint_interval(checkpoint_interval);
+   }
+   else if(watching) {
+      // results are kept in memory between the runs, see watch
+      mesh_cache::singleton().set_cache_dir("");
+   }
+   else if(cache_pair.first) {
+      mesh_cache::singleton().set_cache_dir(cache_pair.second);
+   }
+   else if(incremental) {
+      std_filename cache_dir(xcsg_file);
+      boost::filesystem::path path(cache_dir.GetPath());
+      path /= cache_dir.GetName() + ".xcsg_cache";
+      mesh_cache::singleton().set_cache_dir(path.string());
+   }
+   else {
+      mesh_cache::singleton().set_cache_dir("");
+   }
+
+   // determine if we shall display full file paths
+   bool show_path = m_cmd.count("fullpath")>0;
+
+   cf_xmlTree tree;
+   if(load(xcsg_file,tree,cout)) {
+
+      // build the CSG tree from the first solid or shape2d and compute it
+      // With --all_objects every top-level object is computed, and each is exported to its own
+      // numbered file name_1, name_2, ...
+      xcsg_compiler compiler(m_cmd.max_bool());
+      configure_compiler(compiler,cout);
+      // computation messages are queued to the message log, together with those of the worker threads
+      message_log::stream log(message_log::info_level);
+      if(compiler.build(tree,log,m_cmd.count("all_objects")>0)) {
+         phase_timer::singleton().end_phase("parse");
+         message_log::singleton().flush();
+
+         if(resume) {
+            cout << "...resume: " << mesh_cache::singleton().checkpoint_completed() << " of "
+                 << mesh_cache::singleton().nsubtrees() << " subtrees completed in checkpoint" << endl;
+         }
 
-      cout << "xcsg processing: " << DisplayName(file,show_path) << endl;
+         // a dry run for job schedulers: the estimate replaces the booleans and the export
+         if(m_cmd.count("estimate")) {
+            std::string estimate_path = m_cmd.get<std::string>("estimate");
+            if(estimate_path.length() == 0) {
+               compiler.estimate(cout);
+            }
+            else {
+               std::ofstream out(estimate_path);
+               compiler.estimate(out);
+               cout << "Created estimate     : " << DisplayName(estimate_path,show_path) << endl;
+            }
+            message_log::singleton().flush();
+            return true;
+         }
 
-      cf_xmlNode root;
-      if(tree.get_root(root)) {
-         if("xcsg" == root.tag()) {
+         // with several tolerances, the built model is shared by one compiler per tolerance
+         std::vector<double> tolerances;
+         std::vector<std::shared_ptr<xcsg_compiler>> tol_compilers;
+         if(m_cmd.count("tolerances")) {
+            tolerances = tolerances_option(m_cmd.get<std::string>("tolerances"));
+            for(double tol : tolerances) tol_compilers.push_back(compiler.derive(tol));
+         }
+
+         // progressive refinement writes a coarse result first and improves it while time remains
+         double time_budget = 0.0;
+         if(m_cmd.count("time_budget")) {
+            if(tolerances.size() == 0) time_budget = time_budget_option(m_cmd.get<std::string>("time_budget"));
+            else cout << "...time_budget ignored, it can not be combined with --tolerances" << endl;
+         }
+
+         // binary STL of a single solid is written while its lumps are triangulated,
+         // unless compressed: the triangle count in its header is patched at the end
+         std::shared_ptr<stl_stream> stl_out;
+         if(m_cmd.count("stl")>0 && m_cmd.count("compress")==0 && compiler.size() == 1 && compiler.is_solid(0) && tolerances.size() == 0 && time_budget == 0.0) {
+            stl_out = std::make_shared<stl_stream>(stl_part_xcsg(xcsg_file));
+            if(m_cmd.count("spatial_order")) {
+               compiler.set_lump_function([stl_out](size_t, size_t ilump, std::shared_ptr<triangle_mesh> mesh) { stl_out->add_lump(ilump,triangle_mesh::spatial_order(mesh)); });
+            }
+            else {
+               compiler.set_lump_function([stl_out](size_t, size_t ilump, std::shared_ptr<triangle_mesh> mesh) { stl_out->add_lump(ilump,mesh); });
+            }
+         }
 
-            // set the global secant tolerance,
-            mesh_utils::set_secant_tolerance(root.get_property("secant_tolerance",mesh_utils::secant_tolerance()));
+         // streamed lumps are only written to the binary STL, other formats and decimation need the whole model
+         if(m_cmd.count("stream_lumps")) {
+            size_t other_formats = m_cmd.count("astl") + m_cmd.count("obj") + m_cmd.count("off") + m_cmd.count("amf")
+                                 + m_cmd.count("3mf") + m_cmd.count("csg") + m_cmd.count("xmesh");
+            if(stl_out && other_formats == 0 && m_cmd.count("decimate") == 0) compiler.set_streaming(true);
+            else cout << "...stream_lumps ignored, it requires --stl of a single solid as only output, without --compress or --decimate" << endl;
+         }
 
-            size_t icount = 0;
-            for(auto i=root.begin(); i!=root.end(); i++) {
-               cf_xmlNode child(i);
-               if(!child.is_attribute_node()) {
-                  if(xcsg_factory::singleton().is_solid(child)) {
-                     run_xsolid(child,xcsg_file);
-                     icount++;
-                  }
-                  else if(xcsg_factory::singleton().is_shape2d(child)) {
-                     run_xshape2d(child,xcsg_file);
-                     icount++;
-                  }
+         try {
+            if(time_budget > 0.0) {
+               run_refinement(compiler,xcsg_file,time_budget);
+            }
+            else if(tol_compilers.size() == 0) {
+               compiler.compute(log);
+            }
+            else {
+               // the tolerances are computed concurrently, their messages are shown in order afterwards
+               std::vector<std::ostringstream> tol_log(tol_compilers.size());
+               thread_pool::task_group group;
+               for(size_t itol=0; itol<tol_compilers.size(); itol++) {
+                  thread_pool::singleton().submit(group,[&tol_compilers,&tol_log,itol]() { tol_compilers[itol]->compute(tol_log[itol]); });
+               }
+               thread_pool::singleton().wait(group);
+               message_log::singleton().flush();
+               for(size_t itol=0; itol<tol_compilers.size(); itol++) {
+                  cout << "Tolerance " << itol+1 << ": secant_tolerance=" << tolerances[itol] << endl << tol_log[itol].str();
                }
-               if(icount > 0)break;
             }
          }
+         catch(...) {
+            message_log::singleton().flush();
+            // a failed build can be resumed from the subtrees completed so far
+            if(checkpoint) mesh_cache::singleton().write_checkpoint();
+            throw;
+         }
+         message_log::singleton().flush();
+
+         // each tolerance is exported to its own numbered file name_tol1, name_tol2, ...
+         if(time_budget == 0.0 && tol_compilers.size() == 0) {
+            run_objects(compiler,xcsg_file,stl_out);
+         }
+         for(size_t itol=0; itol<tol_compilers.size(); itol++) {
+            std_filename tol_file(xcsg_file);
+            tol_file.SetName(tol_file.GetName() + "_tol" + std::to_string(itol+1));
+            cout << "Tolerance " << itol+1 << endl;
+            run_objects(*tol_compilers[itol],tol_file.GetFullPath(),stl_out);
+         }
+
+         if(mesh_cache::singleton().enabled()) {
+            phase_timer::singleton().set_value("cache_hits",static_cast<double>(mesh_cache::singleton().hits()));
+            phase_timer::singleton().set_value("cache_misses",static_cast<double>(mesh_cache::singleton().misses()));
+         }
+         if(incremental || watching) mesh_cache::singleton().update_manifest(cout);
+
+         // the build completed, so its checkpoint is no longer needed
+         if(checkpoint) {
+            mesh_cache::singleton().set_cache_dir("");
+            mesh_cache::clear_checkpoint(checkpoint_dir,true);
+         }
+
+         if(node_profiler::singleton().enabled()) {
+            std::string profile_path = m_cmd.get<std::string>("profile");
+            node_profiler::singleton().write_json(profile_path);
+            cout << "Created profile      : " << DisplayName(profile_path,show_path) << endl;
+         }
+         if(m_cmd.count("timing")) {
+            std::string timing_path = m_cmd.get<std::string>("timing");
+            phase_timer::singleton().write_json(timing_path);
+            cout << "Created timing       : " << DisplayName(timing_path,show_path) << endl;
+         }
+         if(trace_recorder::enabled()) {
+            std::string trace_path = m_cmd.get<std::string>("trace");
+            trace_recorder::singleton().write_json(trace_path);
+            cout << "Created trace        : " << DisplayName(trace_path,show_path) << endl;
+         }
       }
    }
    else {
@@ -128,100 +407,406 @@ bool xcsg_main::run()
    return true;
 }
 
+void xcsg_main::configure()
+{
+   // all CSG nodes share the same pool of worker threads.
+   // The XCSG_THREADS environment variable applies when --threads is not given
+   size_t nthreads = m_cmd.threads();
+   if(nthreads == 0) {
+      if(const char* env = std::getenv("XCSG_THREADS")) {
+         char* end = nullptr;
+         long value = std::strtol(env,&end,10);
+         if(end != env && *end == '\0' && value > 0) nthreads = static_cast<size_t>(value);
+         else cout << "Info: ignored invalid XCSG_THREADS=" << env << endl;
+      }
+   }
+   thread_pool::singleton().set_nthreads(nthreads);
+   thread_pool::singleton().set_pinning(m_cmd.count("pin_threads")>0);
+
+   // large vectors in .csg files are parsed by the same pool
+   csg_value::set_parallel_for([](size_t n, const std::function<void(size_t)>& task) {
+      thread_pool& pool = thread_pool::singleton();
+      thread_pool::task_group group;
+      for(size_t i=0; i<n; i++) pool.submit(group,[&task,i]() { task(i); });
+      pool.wait(group);
+   },thread_pool::singleton().nthreads());
+
+   if(m_cmd.count("malloc_tuning")>0 && !malloc_tuning::configure(thread_pool::singleton().nthreads())) {
+      cout << "Info: --malloc_tuning is not supported on this platform" << endl;
+   }
+   carve_boolean::set_simplify((m_cmd.count("merge_faces"))? m_cmd.get<double>("merge_faces") : 0.0,
+                               (m_cmd.count("short_edges"))? m_cmd.get<double>("short_edges") : 0.0);
+   carve_boolean::set_snap_bits((m_cmd.count("snap_vertices"))? m_cmd.get<int>("snap_vertices") : 0);
+   carve_boolean::set_face_bvh_check(m_cmd.count("face_bvh")>0);
+   xpolyhedron::set_direct_mesh(m_cmd.count("direct_mesh")>0);
+   message_log::singleton().set_level((m_cmd.count("quiet"))? message_log::warning_level : message_log::info_level);
+   message_log::singleton().set_json(m_cmd.count("log_json")>0);
+   clipper_boolean::set_simplify((m_cmd.count("simplify2d"))? m_cmd.get<double>("simplify2d") : 0.0);
+   carve_boolean::set_engine(boolean_engine::create((m_cmd.count("engine"))? m_cmd.get<std::string>("engine") : "carve"));
+   sdf_engine::set_voxel((m_cmd.count("voxel"))? m_cmd.get<double>("voxel") : 0.0);
+   carve_boolean::set_retry(m_cmd.count("no_retry")==0);
+   carve_boolean::set_retry_engine((m_cmd.count("retry_engine"))? boolean_engine::create(m_cmd.get<std::string>("retry_engine")) : nullptr);
+   memory_budget::singleton().set_limit((m_cmd.count("mem_limit"))? m_cmd.get<size_t>("mem_limit")*1024*1024 : 0);
+   mesh_utils::set_preview_tolerance(m_cmd.preview_tolerance());
+   if(m_cmd.count("minkowski2d")) {
+      std::string engine = m_cmd.get<std::string>("minkowski2d");
+      if(engine == "convex")       clipper_boolean::set_minkowski_strategy(clipper_boolean::minkowski_convex);
+      else if(engine == "clipper") clipper_boolean::set_minkowski_strategy(clipper_boolean::minkowski_clipper);
+      else throw std::runtime_error("Unknown minkowski2d engine: " + engine);
+   }
+   else {
+      clipper_boolean::set_minkowski_strategy(clipper_boolean::minkowski_clipper);
+   }
+   if(m_cmd.count("projection2d")) {
+      std::string engine = m_cmd.get<std::string>("projection2d");
+      if(engine == "silhouette")  project_mesh::set_strategy(project_mesh::projection_silhouette);
+      else if(engine == "faces")  project_mesh::set_strategy(project_mesh::projection_faces);
+      else throw std::runtime_error("Unknown projection2d engine: " + engine);
+   }
+   else {
+      project_mesh::set_strategy(project_mesh::projection_silhouette);
+   }
+   if(m_cmd.count("extrude_caps")) {
+      std::string engine = m_cmd.get<std::string>("extrude_caps");
+      if(engine == "delaunay")      extrude_mesh::set_cap_strategy(extrude_mesh::cap_delaunay);
+      else if(engine == "monotone") extrude_mesh::set_cap_strategy(extrude_mesh::cap_monotone);
+      else throw std::runtime_error("Unknown extrude_caps engine: " + engine);
+   }
+   else {
+      extrude_mesh::set_cap_strategy(extrude_mesh::cap_delaunay);
+   }
+   if(m_cmd.count("compress")) {
+      std::string method = m_cmd.get<std::string>("compress");
+      if(method != "gz") throw std::runtime_error("Unknown compression: " + method);
+   }
+
+   // the settings below are made for every run, since a server process runs
+   // many jobs and must not carry state from one job to the next
+   instance_cache::singleton().clear();
+   clipper_offset::clear_cache();
+
+   // expensive subtrees may be computed by other xcsg processes (--serve) given as a comma separated list
+   std::vector<std::string> workers;
+   if(m_cmd.count("remote")) {
+      std::istringstream in(m_cmd.get<std::string>("remote"));
+      std::string worker;
+      while(std::getline(in,worker,',')) {
+         if(worker.length() > 0) workers.push_back(worker);
+      }
+   }
+   remote_executor::singleton().set_workers(workers);
+   remote_executor::singleton().set_min_bool((m_cmd.count("remote_min_bool"))? m_cmd.get<size_t>("remote_min_bool") : 16);
+}
 
-bool xcsg_main::run_xsolid(cf_xmlNode& node,const std::string& xcsg_file)
+bool xcsg_main::load(std::string& xcsg_file, cf_xmlTree& tree, std::ostream& out)
 {
-   cout << "processing solid: " << node.tag() << endl;
-   std::shared_ptr<xsolid> obj = xcsg_factory::singleton().make_solid(node);
-   if(obj.get()) {
+   // determine if we shall display full file paths
+   bool show_path = m_cmd.count("fullpath")>0;
+   std_filename file(xcsg_file);
 
-      // determine if we shall display full file paths
-      bool show_path = m_cmd.count("fullpath")>0;
+   // a converted .csg file is processed from the tree in memory,
+   // writing the .xcsg file is optional
+   bool converted = false;
+   if(file.GetExt() == ".csg") {
+
+      out << "Converting from: " << DisplayName(xcsg_file,show_path) << endl;
+      std::ifstream csg(xcsg_file);
+      csg_parser parser(csg,m_cmd.secant_tolerance());
+      converted = parser.to_xcsg(tree);
 
-      size_t nbool = obj->nbool();
-      cout << "...completed CSG tree: " <<  nbool << " boolean operations to process." << endl;
-      if(nbool > m_cmd.max_bool()) {
-         ostringstream sout;
-         sout << "Max " << m_cmd.max_bool() << " boolean operations allowed in this configuration.";
-         throw std::logic_error(sout.str());
+      file.SetExt("xcsg");
+      xcsg_file = file.GetFullPath();
+      if(converted && m_cmd.count("save_xcsg")>0) {
+         tree.write_xml(xcsg_file);
+         out << "Created xcsg file    : " << DisplayName(xcsg_file,show_path) << endl;
       }
+   }
 
+   // the xcsg tree may also be given in binary or JSON form
+   bool loaded = converted;
+   bool binary = (file.GetExt() == ".xcsgb");
+   if(!loaded) {
+      if(binary)                          loaded = tree.read_binary(xcsg_file);
+      else if(file.GetExt() == ".json")   loaded = tree.read_json(xcsg_file);
+      else                                loaded = tree.read_xml(xcsg_file);
+   }
 
-      if(nbool > 0) {
-         cout << "...starting boolean operations" << endl;
-      }
+   if(!loaded) return false;
 
-      boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
-      carve_boolean csg;
-      try {
+   if(!binary && m_cmd.count("save_xcsgb")>0) {
+      std_filename binary_file(file);
+      binary_file.SetExt("xcsgb");
+      tree.write_binary(binary_file.GetFullPath());
+      out << "Created xcsgb file   : " << DisplayName(binary_file,show_path) << endl;
+   }
 
-         boolean_timer::singleton().init(static_cast<int>(nbool));
-         csg.compute(obj->create_carve_mesh(),carve::csg::CSG::OP::UNION);
-         boost::posix_time::time_duration  ptime_diff = boost::posix_time::microsec_clock::universal_time() - time_0;
-         double elapsed_sec = 0.001*ptime_diff.total_milliseconds();
+   out << "xcsg processing: " << DisplayName(file,show_path) << endl;
+   return true;
+}
 
-         cout << "...completed boolean operations in " << setprecision(5) << elapsed_sec << " [sec] " << endl;
-      }
-      catch(carve::exception& ex ) {
+void xcsg_main::configure_compiler(xcsg_compiler& compiler, std::ostream& out)
+{
+   if(m_cmd.count("decimate")) {
+      size_t target_faces = 0;
+      double max_error    = 0.0;
+      decimate_option(m_cmd.get<std::string>("decimate"),target_faces,max_error);
+      compiler.set_decimation(target_faces,max_error);
+   }
+   if(m_cmd.count("max_faces") || m_cmd.count("max_memory") || m_cmd.count("max_time")) {
+      size_t max_faces = (m_cmd.count("max_faces"))?  m_cmd.get<size_t>("max_faces") : 0;
+      size_t max_bytes = (m_cmd.count("max_memory"))? m_cmd.get<size_t>("max_memory")*1024*1024 : 0;
+      double max_sec   = (m_cmd.count("max_time"))?   time_budget_option(m_cmd.get<std::string>("max_time"),"max_time") : 0.0;
+      compiler.set_limits(max_faces,max_bytes,max_sec);
+   }
 
-         // rethrow as std::exception
-         string msg("(carve error): ");
-         msg += ex.str();
-         cout << "WARNING: " << msg << endl;
-//         throw std::exception(msg.c_str());
-      }
+   // the XMESH format is written from the boolean result, which a compact compiler releases
+   if(m_cmd.count("float32")) {
+      if(m_cmd.count("xmesh") == 0) compiler.set_compact(true);
+      else out << "...float32 ignored, it can not be combined with --xmesh" << endl;
+   }
+}
+
+bool xcsg_main::concurrent_batch()
+{
+   // these options keep state of one model in the process: caches and checkpoints next to
+   // the input file, process wide profiles and captures, or several results per model
+   static const char* per_model[] = { "incremental", "checkpoint", "resume", "cache_dir", "capture_booleans",
+                                      "profile", "counters", "timing", "trace", "estimate", "tolerances",
+                                      "time_budget", "stream_lumps" };
+   for(const char* option : per_model) {
+      if(m_cmd.count(option)) return false;
+   }
+   return true;
+}
+
+std::shared_ptr<xcsg_compiler> xcsg_main::compile(std::string& xcsg_file, std::ostream& log)
+{
+   std::replace(xcsg_file.begin(),xcsg_file.end(), '\\', '/');
+   if(!std_filename::Exists(xcsg_file)) throw std::runtime_error("File does not exist: " + xcsg_file);
 
-      size_t nmani = csg.size();
-      cout << "...result model contains " << nmani << ((nmani==1)? " lump.": " lumps.") << endl;
+   cf_xmlTree tree;
+   if(!load(xcsg_file,tree,log)) {
+      log << "error: xcsg input file not found: " << xcsg_file << endl;
+      return nullptr;
+   }
 
-      // we export only triangles
-       boost::posix_time::ptime time_1 = boost::posix_time::microsec_clock::universal_time();
-      carve_triangulate triangulate;
-      for(size_t imani=0; imani<nmani; imani++) {
+   std::shared_ptr<xcsg_compiler> compiler = std::make_shared<xcsg_compiler>(m_cmd.max_bool());
+   configure_compiler(*compiler,log);
+   if(!compiler->build(tree,log,m_cmd.count("all_objects")>0)) return nullptr;
+   compiler->compute(log);
+   return compiler;
+}
 
-         // create & check lump
-         std::shared_ptr<xpolyhedron> poly = csg.create_manifold(imani);
-         cout << "...lump " << imani+1 << ": " <<poly->v_size() << " vertices, " << poly->f_size() << " polygon faces." << endl;
 
-         size_t num_non_tri = 0;
-         poly->check_polyhedron(cout,num_non_tri);
+void xcsg_main::run_objects(xcsg_compiler& compiler,const std::string& xcsg_file,std::shared_ptr<stl_stream> stl_out)
+{
+   for(size_t iobj=0; iobj<compiler.size(); iobj++) {
+      std_filename object_file(xcsg_file);
+      if(compiler.size() > 1) {
+         object_file.SetName(object_file.GetName() + "_" + std::to_string(iobj+1));
+         cout << "Object " << iobj+1 << endl;
+      }
+      if(compiler.is_solid(iobj)) run_xsolid(compiler,iobj,object_file.GetFullPath(),stl_out);
+      else                        run_xshape2d(compiler,iobj,object_file.GetFullPath());
+   }
+}
 
-         if(num_non_tri > 0) {
-            cout << "...Triangulating lump ... " << std::endl;
-            bool improve      = true;
-            bool canonicalize = true;
-            bool degen_check  = true;
+void xcsg_main::run_refinement(xcsg_compiler& compiler,const std::string& xcsg_file,double budget_sec)
+{
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   auto elapsed = [&time_0]() { return 0.001*(boost::posix_time::microsec_clock::universal_time() - time_0).total_milliseconds(); };
 
-            cout << "...Triangulation completed with " << triangulate.compute(poly->create_carve_polyhedron(),improve,canonicalize,degen_check)<< " triangle faces ";
-//            cout << "...Triangulation completed with " << triangulate.compute2d(poly->create_carve_polyhedron())<< " triangle faces ";
+   // the coarse levels have 16 and 4 times the model tolerance, roughly 1/16 and 1/4 of the faces of curved surfaces
+   double target = compiler.secant_tolerance();
+   std::vector<double> levels = { 16.0*target, 4.0*target, target };
 
-            boost::posix_time::ptime time_2 = boost::posix_time::microsec_clock::universal_time();
-            double elapsed_2 = 0.001*(time_2 - time_1).total_milliseconds();
-            cout << "in " << elapsed_2 << " [sec]" << endl;
+   // each level is exported to a hidden directory and its files are moved over the output files,
+   // so every output file is replaced atomically by its refined version
+   boost::filesystem::path xcsg_path(xcsg_file);
+   boost::filesystem::path out_dir = xcsg_path.parent_path();
+   boost::filesystem::path tmp_dir = out_dir / ("." + xcsg_path.stem().string() + ".refine");
+   std::string tmp_xcsg = (tmp_dir / xcsg_path.filename()).string();
 
+   try {
+      double level_sec = 0.0;
+      for(size_t ilevel=0; ilevel<levels.size(); ilevel++) {
+
+         // a level is only started when it is expected to complete in the remaining time,
+         // the next level has about 4 times the faces of the previous one
+         double remaining = budget_sec - elapsed();
+         if(ilevel > 0 && 4.0*level_sec > remaining) {
+            cout << "...refinement stopped after level " << ilevel << " of " << levels.size() << ", time budget used" << endl;
+            break;
          }
-         else {
-            // triangulation not required
-            triangulate.add(poly->create_carve_polyhedron());
+         double level_start = elapsed();
+         cout << "Refinement level " << ilevel+1 << ": secant_tolerance=" << levels[ilevel] << endl;
+         std::shared_ptr<xcsg_compiler> level = compiler.derive(levels[ilevel]);
+
+         // the refinements are cancelled at the deadline, the previous result then stays in place.
+         // The coarse level always completes, so there is a result
+         std::mutex              watch_mutex;
+         std::condition_variable watch_cond;
+         bool                    level_done = false;
+         boost::thread watchdog;
+         if(ilevel > 0) {
+            watchdog = boost::thread([&watch_mutex,&watch_cond,&level_done,&level,remaining]() {
+               std::unique_lock<std::mutex> lock(watch_mutex);
+               auto timeout = std::chrono::milliseconds(static_cast<long long>(1000.0*remaining));
+               if(!watch_cond.wait_for(lock,timeout,[&level_done]() { return level_done; })) level->cancel("time budget exceeded");
+            });
          }
+         std::ostringstream level_log;
+         std::string failure;
+         try {
+            level->compute(level_log);
+         }
+         catch(std::exception& ex) {
+            failure = ex.what();
+         }
+         {
+            std::lock_guard<std::mutex> lock(watch_mutex);
+            level_done = true;
+         }
+         watch_cond.notify_all();
+         if(watchdog.joinable()) watchdog.join();
+         message_log::singleton().flush();
+         cout << level_log.str();
+         if(failure.size() > 0) {
+            if(ilevel == 0) throw std::runtime_error(failure);
+            cout << "...refinement level " << ilevel+1 << " not completed: " << failure << endl;
+            break;
+         }
+
+         boost::filesystem::create_directories(tmp_dir);
+         run_objects(*level,tmp_xcsg,nullptr);
+         for(boost::filesystem::directory_iterator it(tmp_dir); it!=boost::filesystem::directory_iterator(); it++) {
+            boost::filesystem::rename(it->path(),out_dir / it->path().filename());
+         }
+         level_sec = elapsed() - level_start;
+         cout << "...refinement level " << ilevel+1 << " written after " << std::setprecision(5) << elapsed() << " [sec]" << endl;
       }
+   }
+   catch(...) {
+      boost::system::error_code ec;
+      boost::filesystem::remove_all(tmp_dir,ec);
+      throw;
+   }
+   boost::system::error_code ec;
+   boost::filesystem::remove_all(tmp_dir,ec);
+}
+
+bool xcsg_main::run_xsolid(xcsg_compiler& compiler,size_t iobj,const std::string& xcsg_file,std::shared_ptr<stl_stream> stl_out)
+{
+   if(compiler.triangles(iobj)) {
+
+      // determine if we shall display full file paths
+      bool show_path = m_cmd.count("fullpath")>0;
+
       cout <<    "...Exporting results " << endl;
 
-      // create object for file export
-      out_triangles exporter(triangulate.carve_polyset());
+      // create object for file export, with the meshes ordered along a Hilbert curve on request
+      std::shared_ptr<out_triangles::mesh_vector> triangles = compiler.triangles(iobj);
+      if(m_cmd.count("spatial_order")) triangles = spatial_order(triangles);
+      out_triangles exporter(triangles);
+      exporter.set_weld(m_cmd.count("weld")>0);
+      bool gzip = m_cmd.count("compress")>0;
+      exporter.set_gzip(gzip);
+
+      // with --skip_unchanged, a format is not written again when its content hash equals that of its
+      // last export, so the file keeps its modification time
+      std::shared_ptr<export_hash> hashes;
+      std::string content_hash;
+      if(m_cmd.count("skip_unchanged")>0) {
+         hashes = std::make_shared<export_hash>(xcsg_file);
+         content_hash = exporter.content_hash();
+      }
 
-      if(m_cmd.count("csg")>0)       cout << "Created OpenSCAD file: " << DisplayName(std_filename(exporter.write_csg(xcsg_file)),show_path) << endl;
+      // the formats only read the triangulated model, so they are written concurrently.
+      // Messages are shown in the order below after all files are written
+      std::vector<std::pair<std::string,std::function<std::string()>>> exports;
+      std::vector<std::string> formats;
+      auto add_export = [&exports,&formats](const std::string& format, const std::string& message, std::function<std::string()> write) {
+         exports.push_back(std::make_pair(message,write));
+         formats.push_back(format);
+      };
+      if(m_cmd.count("csg")>0)       add_export("csg","Created OpenSCAD file: ",[&]() { return exporter.write_csg(xcsg_file); });
       if(m_cmd.count("amf")>0) {
-         amf_file amf;
-         std::string amf_path = amf.write(triangulate.carve_polyset(),xcsg_file);
-         cout << "Created AMF file     : " << DisplayName(std_filename(amf_path),show_path) << endl;
-         exporter.add_file_written(amf_path);
+         add_export((m_cmd.count("amf_zip")>0)? "amf_zip" : "amf","Created AMF file     : ",[&]() {
+            amf_file amf;
+            std::string amf_path = amf.write(triangles,xcsg_file,m_cmd.count("amf_zip")>0);
+            exporter.add_file_written(amf_path);
+            return amf_path;
+         });
+      }
+      if(m_cmd.count("3mf")>0)       add_export("3mf","Created 3MF file     : ",[&]() { return exporter.write_3mf(xcsg_file); });
+      if(m_cmd.count("obj")>0)       add_export("obj","Created OBJ file     : ",[&]() { return exporter.write_obj(xcsg_file); });
+      if(m_cmd.count("off")>0)       add_export("off","Created OFF file(s)  : ",[&]() { return exporter.write_off(xcsg_file); });
+      if(m_cmd.count("xmesh")>0 && compiler.mesh_set(iobj)) {
+         add_export("xmesh","Created XMESH file   : ",[&]() {
+            std::string xmesh_path = xmesh_file::write(*compiler.mesh_set(iobj),xcsg_file,gzip);
+            exporter.add_file_written(xmesh_path);
+            return xmesh_path;
+         });
+      }
+
+      // STL must still be the most recent updated format. It is written to a temporary
+      // name and renamed when the other formats are complete, see below.
+      // A streamed STL only needs its header completed
+      std::string stl_tmp_xcsg = stl_part_xcsg(xcsg_file);
+      bool binary_stl = m_cmd.count("stl")>0;
+      bool write_stl  = binary_stl || m_cmd.count("astl")>0;
+      std::string stl_format = (binary_stl)? "stl" : "astl";
+      if(write_stl && stl_out) {
+         add_export(stl_format,"Created STL file     : ",[&]() {
+            std::string stl_path = stl_out->close();
+            exporter.add_file_written(stl_path);
+            return stl_path;
+         });
+      }
+      else if(write_stl) add_export(stl_format,"Created STL file     : ",[&]() { return exporter.write_stl(stl_tmp_xcsg,binary_stl); });
+
+      std::vector<std::string> export_paths(exports.size());
+      std::vector<char>        unchanged(exports.size(),0);
+      thread_pool::task_group export_group;
+      for(size_t iexp=0; iexp<exports.size(); iexp++) {
+         thread_pool::singleton().submit(export_group,[&,iexp]() {
+            trace_recorder::span span("export");
+            if(hashes && hashes->unchanged(formats[iexp],content_hash,export_paths[iexp])) {
+               exporter.add_file_written(export_paths[iexp]);
+               unchanged[iexp] = 1;
+               return;
+            }
+            export_paths[iexp] = exports[iexp].second();
+            if(hashes) hashes->set(formats[iexp],content_hash,export_paths[iexp]);
+         });
+      }
+      thread_pool::singleton().wait(export_group);
+
+      // an STL streamed during the computation is discarded when the existing file has the same content
+      if(write_stl && stl_out && unchanged.back()) {
+         boost::filesystem::remove(stl_out->close());
+      }
+
+      if(write_stl && !unchanged.back()) {
+         // give the STL its final name and make it the most recent file
+         boost::filesystem::path stl_path(xcsg_file);
+         stl_path.replace_extension(".stl");
+         std::string path = stl_path.string() + ((gzip)? ".gz" : "");
+         std::replace(path.begin(),path.end(), '\\', '/');
+         export_paths.back() = exporter.rename_file_written(export_paths.back(),path);
+         boost::filesystem::last_write_time(path,std::time(nullptr));
+         if(hashes) hashes->set(stl_format,content_hash,path);
+      }
+      if(hashes) hashes->write();
+
+      phase_timer::singleton().end_phase("export");
+
+      for(size_t iexp=0; iexp<exports.size(); iexp++) {
+         // "Created STL file     : " becomes "Kept STL file        : "
+         std::string message = exports[iexp].first;
+         if(unchanged[iexp]) message = "Kept" + message.substr(7,message.find(':')-7) + "   : ";
+         cout << message << DisplayName(std_filename(export_paths[iexp]),show_path) << endl;
       }
-      if(m_cmd.count("obj")>0)       cout << "Created OBJ file     : " << DisplayName(std_filename(exporter.write_obj(xcsg_file)),show_path) << endl;
-      if(m_cmd.count("off")>0)       cout << "Created OFF file(s)  : " << DisplayName(std_filename(exporter.write_off(xcsg_file)),show_path) << endl;
-      // write STL last so it is the most recent updated format
-      if(m_cmd.count("stl")>0)       cout << "Created STL file     : " << DisplayName(std_filename(exporter.write_stl(xcsg_file,true)),show_path) << endl;
-      else if(m_cmd.count("astl")>0) cout << "Created STL file     : " << DisplayName(std_filename(exporter.write_stl(xcsg_file,false)),show_path) << endl;
 
       // check if export is requested
       auto export_pair = m_cmd.export_dir();
@@ -237,33 +822,14 @@ bool xcsg_main::run_xsolid(cf_xmlNode& node,const std::string& xcsg_file)
 }
 
 
-bool xcsg_main::run_xshape2d(cf_xmlNode& node,const std::string& xcsg_file)
+bool xcsg_main::run_xshape2d(xcsg_compiler& compiler,size_t iobj,const std::string& xcsg_file)
 {
-   cout << "processing shape2d: " << node.tag() << endl;
-   std::shared_ptr<xshape2d> obj = xcsg_factory::singleton().make_shape2d(node);
-   if(obj.get()) {
+   if(compiler.polyset(iobj)) {
 
       // determine if we shall display full file paths
       bool show_path = m_cmd.count("fullpath")>0;
 
-      size_t nbool = obj->nbool();
-      cout << "...completed CSG tree: " <<  nbool << " boolean operations to process." << endl;
-      if(nbool > m_cmd.max_bool()) {
-         ostringstream sout;
-         sout << "Max " << m_cmd.max_bool() << " boolean operations allowed in this configuration.";
-         throw std::logic_error(sout.str());
-      }
-
-      if(nbool > 0) {
-         cout << "...starting boolean operations" << endl;
-      }
-      clipper_boolean csg;
-      csg.compute(obj->create_clipper_profile(),ClipperLib::ctUnion);
-
-      std::shared_ptr<polyset2d> polyset = csg.profile()->polyset();
-      size_t nmani = polyset->size();
-      cout << "...result model contains " << nmani << ((nmani==1)? " lump.": " lumps.") << endl;
-
+      std::shared_ptr<polyset2d> polyset = compiler.polyset(iobj);
       if(m_cmd.count("csg")>0) {
          openscad_csg openscad(xcsg_file);
          size_t imani = 0;
@@ -291,6 +857,7 @@ bool xcsg_main::run_xshape2d(cf_xmlNode& node,const std::string& xcsg_file)
          exporter.add_file_written(dxf_path);
          cout << "Created DXF      file: " << DisplayName(std_filename(dxf_path),show_path) << endl;
       }
+      phase_timer::singleton().end_phase("export");
 
       // check if export is requested
       auto export_pair = m_cmd.export_dir();
@@ -16,20 +16,65 @@
 #ifndef XCSG_MAIN_H
 #define XCSG_MAIN_H
 
+#include <memory>
+#include <ostream>
+#include <string>
 #include "boost_command_line.h"
-class cf_xmlNode;
+class cf_xmlTree;
+class xsolid;
+class xshape2d;
+class xcsg_compiler;
+class stl_stream;
 
 class xcsg_main {
 public:
    xcsg_main(const boost_command_line& m_cmd);
    virtual ~xcsg_main();
 
+   // process the input file given on the command line
    bool run();
 
+   // process xcsg_file using the options given on the command line
+   bool run(std::string xcsg_file);
+
+   // process xcsg_file, then again each time it is saved, until the process is stopped.
+   // Results of unchanged subtrees are kept in memory between the runs, see mesh_cache
+   void watch(const std::string& xcsg_file);
+
+   // true if several models can be compiled concurrently with the options of the command line (--batch).
+   // Options keeping the state of one model in the process, e.g. --incremental or --profile, require
+   // the models to be run one at a time
+   bool concurrent_batch();
+
+   // make the process wide settings of the command line. run does this for every model,
+   // a concurrent batch once before its models are compiled
+   void configure();
+
+   // read and compute the model in xcsg_file without exporting it, so that several models of a batch can
+   // be compiled concurrently, each by its own xcsg_compiler. Requires configure. Messages are written to log,
+   // xcsg_file becomes the .xcsg name of a converted .csg file. Returns nullptr if there is no xcsg object
+   std::shared_ptr<xcsg_compiler> compile(std::string& xcsg_file, std::ostream& log);
+
+   // export all computed objects of compiler, numbered name_1, name_2, ... if there are several
+   void run_objects(xcsg_compiler& compiler,const std::string& xcsg_file,std::shared_ptr<stl_stream> stl_out);
+
 protected:
 
-   bool run_xsolid(cf_xmlNode& node,const std::string& xcsg_file);
-   bool run_xshape2d(cf_xmlNode& node,const std::string& xcsg_file);
+   // read xcsg_file into tree, converting an OpenSCAD .csg file, whose xcsg_file then becomes the .xcsg name.
+   // Messages are written to out. Returns false if the file could not be read
+   bool load(std::string& xcsg_file, cf_xmlTree& tree, std::ostream& out);
+
+   // apply the decimation, limits and float32 options to compiler
+   void configure_compiler(xcsg_compiler& compiler, std::ostream& out);
+
+   // compute the built model of compiler at coarse tolerances first and refine it toward the model tolerance
+   // while budget_sec remains, replacing the output files with each completed level
+   void run_refinement(xcsg_compiler& compiler,const std::string& xcsg_file,double budget_sec);
+
+   // export computed object iobj to the requested file formats.
+   // stl_out is the binary STL already streamed during the computation, or nullptr
+   bool run_xsolid(xcsg_compiler& compiler,size_t iobj,const std::string& xcsg_file,std::shared_ptr<stl_stream> stl_out = nullptr);
+   bool run_xshape2d(xcsg_compiler& compiler,size_t iobj,const std::string& xcsg_file);
 
 private:
    boost_command_line m_cmd;
@@ -0,0 +1,461 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "xcsg_server.h"
+#include "xcsg_main.h"
+#include "xcsg_compiler.h"
+#include "thread_pool.h"
+#include "compile_context.h"
+#include "message_log.h"
+#include "server_metrics.h"
+#include "remote_executor.h"
+#include "xcsg_factory.h"
+#include "xmesh_file.h"
+#include "xsolid.h"
+#include "mesh_utils.h"
+#include "csg_parser/cf_xmlTree.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <boost/asio.hpp>
+#include <boost/date_time.hpp>
+#include <boost/filesystem.hpp>
+
+// redirect cout to another stream buffer while in scope
+class cout_redirect {
+public:
+   cout_redirect(std::streambuf* buf) : m_old(std::cout.rdbuf(buf)) {}
+   ~cout_redirect() { std::cout.rdbuf(m_old); }
+private:
+   std::streambuf* m_old;
+};
+
+// true if name matches pattern containing '*' and '?' wildcards
+static bool wildcard_match(const char* pattern, const char* name)
+{
+   const char* star  = nullptr;  // position after the last '*' seen
+   const char* retry = nullptr;  // name position matched by that '*'
+   while(*name) {
+      if(*pattern == '*')                            { star = ++pattern; retry = name; }
+      else if(*pattern == '?' || *pattern == *name)  { pattern++; name++; }
+      else if(star)                                  { pattern = star; name = ++retry; }
+      else return false;
+   }
+   while(*pattern == '*') pattern++;
+   return *pattern == 0;
+}
+
+// largest subtree accepted in a mesh request, so that a peer can not make the server allocate any size
+static const size_t max_fragment_bytes = size_t(256)*1024*1024;
+
+static bool is_model_file(const boost::filesystem::path& path)
+{
+   std::string ext = path.extension().string();
+   return ext == ".xcsg" || ext == ".xcsgb" || ext == ".json" || ext == ".csg";
+}
+
+xcsg_server::xcsg_server(const boost_command_line& cmd)
+: m_cmd(cmd)
+, m_njobs(0)
+{
+   // start the worker threads now, so --threads given to the server applies to all jobs
+   // and the jobs' own --threads settings have no effect
+   thread_pool& pool = thread_pool::singleton();
+   pool.set_nthreads(m_cmd.threads());
+   pool.set_pinning(m_cmd.count("pin_threads")>0);
+   thread_pool::task_group group;
+   pool.submit(group,[](){});
+   pool.wait(group);
+}
+
+xcsg_server::~xcsg_server()
+{}
+
+std::vector<std::string> xcsg_server::split_args(const std::string& command_line)
+{
+   std::vector<std::string> args;
+   std::string arg;
+   bool in_arg   = false;
+   bool in_quote = false;
+   for(char c : command_line) {
+      if(c == '"') {
+         in_quote = !in_quote;
+         in_arg   = true;
+      }
+      else if(!in_quote && (c == ' ' || c == '\t' || c == '\r' || c == '\n')) {
+         if(in_arg) args.push_back(arg);
+         arg.clear();
+         in_arg = false;
+      }
+      else {
+         arg += c;
+         in_arg = true;
+      }
+   }
+   if(in_quote) throw std::runtime_error("xcsg_server: unbalanced quotes in job: " + command_line);
+   if(in_arg) args.push_back(arg);
+   return args;
+}
+
+bool xcsg_server::run_job(const std::string& command_line, std::ostream& out)
+{
+   m_njobs++;
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+
+   bool ok = false;
+   server_metrics::singleton().begin_job();
+   cout_redirect redirect(out.rdbuf());
+   try {
+      std::vector<std::string> args = split_args(command_line);
+      args.insert(args.begin(),"xcsg");
+      std::vector<char*> argv;
+      for(auto& arg : args) argv.push_back(&arg[0]);
+      argv.push_back(nullptr);
+
+      boost_command_line cmd(static_cast<int>(args.size()),argv.data());
+      if(cmd.service_mode()) {
+         std::cout << "xcsg job error: --jobs and --serve are not allowed in a job" << std::endl;
+      }
+      else if(cmd.parsed_ok()) {
+         xcsg_main engine(cmd);
+         ok = engine.run();
+      }
+   }
+   catch(std::exception& ex) {
+      message_log::singleton().flush();
+      std::cout << "xcsg finished with exception: " << ex.what() << std::endl;
+      ok = false;
+   }
+   // the queued messages of the job go to its output before the redirection ends
+   message_log::singleton().flush();
+
+   boost::posix_time::time_duration ptime_diff = boost::posix_time::microsec_clock::universal_time() - time_0;
+   std::cout << "xcsg job " << m_njobs << " finished using " << 0.001*ptime_diff.total_milliseconds() << " [sec]" << std::endl;
+   server_metrics::singleton().end_job(ok,0.001*ptime_diff.total_milliseconds());
+   return ok;
+}
+
+std::vector<std::string> xcsg_server::expand_inputs(const std::vector<std::string>& inputs)
+{
+   std::vector<std::string> files;
+   for(auto& input : inputs) {
+      boost::filesystem::path path(input);
+      std::string pattern = path.filename().string();
+      bool is_pattern = pattern.find_first_of("*?") != std::string::npos;
+
+      if(!is_pattern && !boost::filesystem::is_directory(path)) {
+         // a plain file is taken as given, also when it does not exist so the job reports it
+         if(!is_model_file(path)) throw std::runtime_error("xcsg_server: input file extension must be '.xcsg', '.xcsgb', '.json' or '.csg': " + input);
+         files.push_back(input);
+         continue;
+      }
+
+      boost::filesystem::path dir = (is_pattern)? path.parent_path() : path;
+      if(dir.empty()) dir = ".";
+      if(!boost::filesystem::is_directory(dir)) throw std::runtime_error("xcsg_server: directory not found: " + dir.string());
+
+      // the model files in a directory, or the files matching the pattern
+      std::vector<std::string> matches;
+      for(auto& entry : boost::filesystem::directory_iterator(dir)) {
+         const boost::filesystem::path& file = entry.path();
+         if(!boost::filesystem::is_regular_file(file) || !is_model_file(file)) continue;
+         if(is_pattern && !wildcard_match(pattern.c_str(),file.filename().string().c_str())) continue;
+         matches.push_back(((is_pattern && path.parent_path().empty())? file.filename() : file).string());
+      }
+      if(matches.size() == 0) std::cout << "xcsg batch: no model files in " << input << std::endl;
+      std::sort(matches.begin(),matches.end());
+      files.insert(files.end(),matches.begin(),matches.end());
+   }
+   return files;
+}
+
+size_t xcsg_server::run_batch(const std::vector<std::string>& inputs)
+{
+   std::vector<std::string> files = expand_inputs(inputs);
+
+   // all models use the same options, only the input file differs
+   xcsg_main engine(m_cmd);
+   size_t nfailed = 0;
+   auto report = [this,&files,&nfailed](const std::string& file, bool ok, boost::posix_time::ptime time_0) {
+      message_log::singleton().flush();
+      if(!ok) nfailed++;
+      boost::posix_time::time_duration ptime_diff = boost::posix_time::microsec_clock::universal_time() - time_0;
+      std::cout << "xcsg batch " << m_njobs << "/" << files.size() << (ok? " completed " : " failed ") << file
+                << " using " << 0.001*ptime_diff.total_milliseconds() << " [sec]" << std::endl << std::endl;
+   };
+
+   if(!engine.concurrent_batch()) {
+      // the options keep per model state, so the models run one at a time
+      for(auto& file : files) {
+         m_njobs++;
+         boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+         bool ok = false;
+         try {
+            ok = engine.run(file);
+         }
+         catch(std::exception& ex) {
+            message_log::singleton().flush();
+            std::cout << "xcsg finished with exception: " << ex.what() << std::endl;
+         }
+         report(file,ok,time_0);
+      }
+   }
+   else {
+      // each model is compiled by a thread_pool task in a compilation of its own, concurrently with
+      // the other models, and exported in input order. At most one model per worker thread is
+      // compiled or waiting for export at a time, which bounds the memory held
+      struct model {
+         std::string                    file;       // input file, or the .xcsg name of a converted .csg file
+         std::ostringstream             log;
+         std::shared_ptr<xcsg_compiler> compiler;
+         std::string                    error;
+         boost::posix_time::ptime       time_0;
+         thread_pool::task_group        group;
+      };
+      engine.configure();
+      thread_pool& pool = thread_pool::singleton();
+      size_t window = std::max(size_t(1),pool.nthreads());
+      std::vector<std::unique_ptr<model>> models(files.size());
+      auto submit = [&engine,&pool,&files,&models](size_t imodel) {
+         models[imodel].reset(new model);
+         model& m = *models[imodel];
+         m.file = files[imodel];
+         pool.submit(m.group,[&engine,&m]() {
+            m.time_0 = boost::posix_time::microsec_clock::universal_time();
+            try {
+               m.compiler = engine.compile(m.file,m.log);
+            }
+            catch(std::exception& ex) {
+               m.error = ex.what();
+            }
+         });
+      };
+
+      for(size_t imodel=0; imodel<std::min(window,files.size()); imodel++) submit(imodel);
+      for(size_t imodel=0; imodel<files.size(); imodel++) {
+         model& m = *models[imodel];
+         pool.wait(m.group);
+         if(imodel+window < files.size()) submit(imodel+window);
+
+         m_njobs++;
+         message_log::singleton().flush();
+         std::cout << m.log.str();
+         if(m.error.length() == 0 && m.compiler) {
+            try {
+               engine.run_objects(*m.compiler,m.file,nullptr);
+            }
+            catch(std::exception& ex) {
+               m.error = ex.what();
+            }
+         }
+         if(m.error.length() > 0) {
+            message_log::singleton().flush();
+            std::cout << "xcsg finished with exception: " << m.error << std::endl;
+         }
+         report(files[imodel],m.error.length() == 0,m.time_0);
+         models[imodel].reset();
+      }
+   }
+   std::cout << "xcsg batch completed: " << files.size() << " models, " << nfailed << " failed" << std::endl;
+   return nfailed;
+}
+
+size_t xcsg_server::run_jobs(const std::string& jobs_file)
+{
+   std::ifstream in(jobs_file);
+   if(!in.is_open()) throw std::runtime_error("xcsg_server: could not open jobs file " + jobs_file);
+
+   size_t nfailed = 0;
+   std::string line;
+   while(std::getline(in,line)) {
+      size_t ifirst = line.find_first_not_of(" \t\r");
+      if(ifirst == std::string::npos || line[ifirst] == '#') continue;
+
+      std::cout << "xcsg job: " << line.substr(ifirst) << std::endl;
+      if(!run_job(line,std::cout)) {
+         std::cout << "xcsg job failed" << std::endl;
+         nfailed++;
+      }
+      std::cout << std::endl;
+   }
+   std::cout << "xcsg jobs completed: " << m_njobs << " jobs, " << nfailed << " failed" << std::endl;
+   return nfailed;
+}
+
+void xcsg_server::run_mesh(const std::string& request, const std::string& fragment, std::ostream& reply)
+{
+   m_njobs++;
+   boost::posix_time::ptime time_0 = boost::posix_time::microsec_clock::universal_time();
+   bool ok = false;
+   try {
+      // "mesh <nbytes> <secant tolerance> <16 matrix values, row by row>", see remote_executor
+      std::istringstream in(request);
+      std::string keyword;
+      size_t nbytes = 0;
+      double secant_tolerance = 0.0;
+      in >> keyword >> nbytes >> secant_tolerance;
+      carve::math::Matrix t;
+      for(size_t i=0; i<4; i++) {
+         for(size_t j=0; j<4; j++) in >> t.m[i][j];
+      }
+      if(!in) throw std::runtime_error("invalid mesh request");
+
+      std::istringstream fragment_in(fragment);
+      cf_xmlTree tree;
+      cf_xmlNode root;
+      if(!tree.read_binary(fragment_in) || !tree.get_root(root)) throw std::runtime_error("invalid subtree in mesh request");
+
+      // the subtree is computed in a compilation of its own, with the tolerance of the client model
+      compile_context context;
+      compile_context::scope scope(&context);
+      mesh_utils::set_secant_tolerance(secant_tolerance);
+      std::shared_ptr<xsolid> solid;
+      for(auto i=root.begin(); i!=root.end() && !solid; i++) {
+         cf_xmlNode child(i);
+         if(!child.is_attribute_node() && xcsg_factory::singleton().is_solid(child)) solid = xcsg_factory::singleton().make_solid(child);
+      }
+      if(!solid) throw std::runtime_error("no solid in mesh request");
+      tree.clear();
+
+      std::shared_ptr<carve::mesh::MeshSet<3>> meshset = solid->create_carve_mesh(t);
+      std::ostringstream data;
+      xmesh_file::write_stream(*meshset,data);
+      reply << "xcsg mesh ok " << data.str().size() << '\n' << data.str();
+      ok = true;
+   }
+   catch(std::exception& ex) {
+      std::string msg(ex.what());
+      std::replace(msg.begin(),msg.end(),'\n',' ');
+      reply << "xcsg mesh failed: " << msg << '\n';
+   }
+   boost::posix_time::time_duration ptime_diff = boost::posix_time::microsec_clock::universal_time() - time_0;
+   server_metrics::singleton().add_mesh_request(ok,0.001*ptime_diff.total_milliseconds());
+}
+
+template <typename Acceptor>
+void xcsg_server::accept_loop(Acceptor& acceptor, bool jobs)
+{
+   bool quit = false;
+   while(!quit) {
+      typename Acceptor::protocol_type::socket socket(acceptor.get_executor());
+      acceptor.accept(socket);
+      try {
+         boost::asio::streambuf request;
+         boost::asio::read_until(socket,request,'\n');
+         std::istream request_stream(&request);
+         std::string line;
+         std::getline(request_stream,line);
+         if(line.size() > 0 && line.back() == '\r') line.pop_back();
+
+         std::ostringstream reply;
+         bool is_request = (line == "metrics") || (line.compare(0,4,"GET ") == 0) || (line.compare(0,5,"mesh ") == 0);
+         if(!jobs && !is_request) {
+            reply << "xcsg job error: jobs are not accepted on this port, see --serve_jobs" << std::endl;
+            reply << "xcsg job failed" << std::endl;
+            std::cout << "xcsg server rejected job from " << socket.remote_endpoint() << std::endl;
+         }
+         else if(line == "quit") {
+            reply << "xcsg server stopped" << std::endl;
+            quit = true;
+         }
+         else if(line == "metrics") {
+            server_metrics::singleton().write_text(reply);
+         }
+         else if(line.compare(0,4,"GET ") == 0) {
+            // a Prometheus scrape over HTTP, the request headers are skipped
+            std::string header;
+            do {
+               boost::asio::read_until(socket,request,'\n');
+               std::getline(request_stream,header);
+               if(header.size() > 0 && header.back() == '\r') header.pop_back();
+            } while(header.size() > 0);
+
+            std::ostringstream body;
+            if(line.compare(0,13,"GET /metrics ") == 0) {
+               server_metrics::singleton().write_text(body);
+               reply << "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n";
+            }
+            else {
+               body << "not found, use /metrics\n";
+               reply << "HTTP/1.0 404 Not Found\r\nContent-Type: text/plain\r\n";
+            }
+            reply << "Content-Length: " << body.str().size() << "\r\n\r\n" << body.str();
+         }
+         else if(line.compare(0,5,"mesh ") == 0) {
+            // a subtree sent by remote_executor follows the request line
+            size_t nbytes = std::stoull(line.substr(5));
+            if(nbytes > max_fragment_bytes) throw std::runtime_error("mesh request of " + std::to_string(nbytes) + " bytes exceeds the limit");
+            std::string fragment(nbytes,'\0');
+            size_t nbuffered = std::min(nbytes,request.size());
+            request_stream.read(&fragment[0],nbuffered);
+            if(nbytes > nbuffered) boost::asio::read(socket,boost::asio::buffer(&fragment[nbuffered],nbytes-nbuffered));
+            run_mesh(line,fragment,reply);
+            std::cout << "xcsg mesh " << m_njobs << ", " << nbytes << " bytes" << std::endl;
+         }
+         else {
+            std::cout << "xcsg job: " << line << std::endl;
+            bool ok = run_job(line,reply);
+            reply << (ok? "xcsg job ok" : "xcsg job failed") << std::endl;
+            std::cout << "xcsg job " << m_njobs << (ok? " ok" : " failed") << std::endl;
+         }
+         boost::asio::write(socket,boost::asio::buffer(reply.str()));
+      }
+      catch(std::exception& ex) {
+         // a failing connection does not stop the server
+         std::cout << "xcsg server connection error: " << ex.what() << std::endl;
+      }
+   }
+   acceptor.close();
+}
+
+void xcsg_server::serve(const std::string& socket_path)
+{
+   boost::asio::io_context io;
+
+   // "host:port" listens on a TCP port, so that workers on other machines can be reached. Without
+   // a host only local clients can connect, other machines need the host, e.g. 0.0.0.0:7000.
+   // The peers are not authenticated, so jobs are accepted only when enabled with --serve_jobs
+   std::string host,port;
+   if(remote_executor::tcp_endpoint(socket_path,host,port)) {
+      boost::asio::ip::tcp::resolver resolver(io);
+      boost::asio::ip::tcp::endpoint endpoint = *resolver.resolve((host.size() > 0)? host : "127.0.0.1",port).begin();
+      boost::asio::ip::tcp::acceptor acceptor(io,endpoint);
+      bool jobs = m_cmd.count("serve_jobs") > 0;
+      std::cout << "xcsg serving " << (jobs? "jobs" : "subtrees") << " on " << endpoint << std::endl;
+      accept_loop(acceptor,jobs);
+      return;
+   }
+
+#if defined(BOOST_ASIO_HAS_LOCAL_SOCKETS)
+   typedef boost::asio::local::stream_protocol protocol;
+
+   // a socket file left by a previous server is removed
+   boost::system::error_code ec;
+   boost::filesystem::remove(socket_path,ec);
+
+   protocol::acceptor acceptor(io,protocol::endpoint(socket_path));
+   // the socket file permissions decide who may connect
+   std::cout << "xcsg serving jobs on " << socket_path << std::endl;
+   accept_loop(acceptor,true);
+   boost::filesystem::remove(socket_path,ec);
+#else
+   throw std::runtime_error("xcsg_server: Unix domain sockets are not supported on this platform, use --jobs or --serve host:port");
+#endif
+}
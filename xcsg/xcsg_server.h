@@ -0,0 +1,81 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef XCSG_SERVER_H
+#define XCSG_SERVER_H
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+#include "boost_command_line.h"
+
+// xcsg_server runs many xcsg jobs in one process (--jobs, --serve and --batch options), so that the
+// worker threads and the primitive cache are reused instead of being set up for every model.
+// A job is a complete xcsg command line without the program name, e.g. "--stl model.xcsg".
+// Jobs run one at a time, each job uses all worker threads. The console output of a job is
+// returned with the job, the output files are written by the job as usual.
+
+class xcsg_server {
+public:
+   xcsg_server(const boost_command_line& cmd);
+   virtual ~xcsg_server();
+
+   // run the jobs listed in jobs_file, one command line per line.
+   // Empty lines and lines starting with '#' are skipped. Returns the number of failed jobs
+   size_t run_jobs(const std::string& jobs_file);
+
+   // accept jobs on the Unix domain socket socket_path, or on a TCP port when given as "host:port",
+   // until a client sends "quit". A client sends one command line terminated by a newline and
+   // receives the job output, ending with the status line "xcsg job ok" or "xcsg job failed".
+   // The server also computes subtrees sent by remote_executor (--remote) of other xcsg processes.
+   // A "metrics" request, or an HTTP "GET /metrics", returns the server_metrics of the jobs so far.
+   // The peers are not authenticated. A TCP port listens on the loopback interface unless a host is
+   // given, and accepts job lines and "quit" only with --serve_jobs, as a job reads and writes any
+   // file the server can access. Subtree and metrics requests are always accepted
+   void serve(const std::string& socket_path);
+
+   // process the models in inputs with the options of the server command line (--batch).
+   // An input is a file, a directory or a file name pattern with '*' and '?' wildcards,
+   // see expand_inputs. The models are compiled concurrently and exported in input order,
+   // unless the options require one model at a time, see xcsg_main::concurrent_batch.
+   // Returns the number of failed models
+   size_t run_batch(const std::vector<std::string>& inputs);
+
+   // run one job and write its console output to out, returns true if the job succeeded
+   bool run_job(const std::string& command_line, std::ostream& out);
+
+protected:
+   // serve the connections of acceptor until a client sends "quit". Job lines and "quit"
+   // are rejected unless jobs is true
+   template <typename Acceptor>
+   void accept_loop(Acceptor& acceptor, bool jobs);
+
+   // compute the mesh of the subtree in fragment for a remote_executor request and write it to reply
+   void run_mesh(const std::string& request, const std::string& fragment, std::ostream& reply);
+
+   // split a command line into arguments, double quotes group arguments containing blanks
+   static std::vector<std::string> split_args(const std::string& command_line);
+
+   // expand directories and wildcard patterns into the model files they contain, in sorted order.
+   // Wildcards are allowed in the file name only, the directory part is taken literally
+   static std::vector<std::string> expand_inputs(const std::vector<std::string>& inputs);
+
+private:
+   boost_command_line m_cmd;
+   size_t             m_njobs;   // jobs run so far
+};
+
+#endif // XCSG_SERVER_H
@@ -15,6 +15,7 @@
 
 #include "xcube.h"
 #include "primitives3d.h"
+#include "primitive_cache.h"
 #include "csg_parser/cf_xmlNode.h"
 
 xcube::xcube(double size, bool center)
@@ -27,10 +28,23 @@ xcube::~xcube()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xcube::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   std::shared_ptr<xpolyhedron> poly = primitives3d::make_cuboid(m_size,m_size,m_size,m_center,m_center,t*get_transform());
+   std::string key = primitive_cache::make_key("cuboid",{m_size,m_size,m_size,double(m_center)},false);
+   double dx = m_size, dy = m_size, dz = m_size;
+   bool center = m_center;
+   std::shared_ptr<xpolyhedron> poly = primitive_cache::singleton().get(key,[dx,dy,dz,center]() { return primitives3d::make_cuboid(dx,dy,dz,center,center); },t*get_transform());
    return poly->create_carve_mesh();
 }
 
+void xcube::box_frame(const carve::math::Matrix& t, xvertex& origin, xvertex edges[3]) const
+{
+   const carve::math::Matrix tt = t*get_transform();
+   const double d0 = (m_center)? -0.5*m_size : 0.0;
+   origin   = tt*carve::geom::VECTOR(d0,d0,d0);
+   edges[0] = tt*carve::geom::VECTOR(d0+m_size,d0,d0) - origin;
+   edges[1] = tt*carve::geom::VECTOR(d0,d0+m_size,d0) - origin;
+   edges[2] = tt*carve::geom::VECTOR(d0,d0,d0+m_size) - origin;
+}
+
 xcube::xcube(const cf_xmlNode& node)
 {
    if(node.tag() != "cube")throw logic_error("Expected xml tag cube, but found " + node.tag());
@@ -40,3 +54,11 @@ xcube::xcube(const cf_xmlNode& node)
    m_size   = node.get_property("size",1.0);
    m_center = ("true" == node.get_property("center","false"))? true : false;
 }
+
+bool xcube::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   const double d0 = (m_center)? -0.5*m_size : 0.0;
+   box = xbox3d();
+   box.enclose(t*get_transform(),xbox3d(carve::geom::VECTOR(d0,d0,d0),carve::geom::VECTOR(d0+m_size,d0+m_size,d0+m_size)));
+   return true;
+}
@@ -15,6 +15,7 @@
 
 #include "xcuboid.h"
 #include "primitives3d.h"
+#include "primitive_cache.h"
 #include "csg_parser/cf_xmlNode.h"
 
 xcuboid::xcuboid(double dx, double dy, double dz, bool center)
@@ -30,10 +31,24 @@ xcuboid::~xcuboid()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xcuboid::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   std::shared_ptr<xpolyhedron> poly = primitives3d::make_cuboid(m_dx,m_dy,m_dz,m_center,m_center,t*get_transform());
+   std::string key = primitive_cache::make_key("cuboid",{m_dx,m_dy,m_dz,double(m_center)},false);
+   double dx = m_dx, dy = m_dy, dz = m_dz;
+   bool center = m_center;
+   std::shared_ptr<xpolyhedron> poly = primitive_cache::singleton().get(key,[dx,dy,dz,center]() { return primitives3d::make_cuboid(dx,dy,dz,center,center); },t*get_transform());
    return poly->create_carve_mesh();
 }
 
+void xcuboid::box_frame(const carve::math::Matrix& t, xvertex& origin, xvertex edges[3]) const
+{
+   const carve::math::Matrix tt = t*get_transform();
+   const double x0 = (m_center)? -0.5*m_dx : 0.0;
+   const double y0 = (m_center)? -0.5*m_dy : 0.0;
+   const double z0 = (m_center)? -0.5*m_dz : 0.0;
+   origin   = tt*carve::geom::VECTOR(x0,y0,z0);
+   edges[0] = tt*carve::geom::VECTOR(x0+m_dx,y0,z0) - origin;
+   edges[1] = tt*carve::geom::VECTOR(x0,y0+m_dy,z0) - origin;
+   edges[2] = tt*carve::geom::VECTOR(x0,y0,z0+m_dz) - origin;
+}
 
 xcuboid::xcuboid(const cf_xmlNode& node)
 {
@@ -49,3 +64,13 @@ xcuboid::xcuboid(const cf_xmlNode& node)
    m_dz  = node.get_property("dz",1.0);
    m_center = ("true" == node.get_property("center","false"))? true : false;
 }
+
+bool xcuboid::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   const double x0 = (m_center)? -0.5*m_dx : 0.0;
+   const double y0 = (m_center)? -0.5*m_dy : 0.0;
+   const double z0 = (m_center)? -0.5*m_dz : 0.0;
+   box = xbox3d();
+   box.enclose(t*get_transform(),xbox3d(carve::geom::VECTOR(x0,y0,z0),carve::geom::VECTOR(x0+m_dx,y0+m_dy,z0+m_dz)));
+   return true;
+}
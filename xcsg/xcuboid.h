@@ -25,6 +25,11 @@ public:
    virtual ~xcuboid();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // minimum corner and edge vectors of the box transformed by t*get_transform()
+   void box_frame(const carve::math::Matrix& t, xvertex& origin, xvertex edges[3]) const;
 private:
    double m_dx;
    double m_dy;
@@ -15,6 +15,7 @@
 
 #include "xcylinder.h"
 #include "primitives3d.h"
+#include "primitive_cache.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "carve/mesh_simplify.hpp"
 
@@ -32,7 +33,10 @@ xcylinder::~xcylinder()
 std::shared_ptr<carve::mesh::MeshSet<3>> xcylinder::create_carve_mesh(const carve::math::Matrix& t) const
 {
    const int nseg = -1;
-   std::shared_ptr<xpolyhedron> poly = primitives3d::make_cone(m_r,m_r,m_h,m_center,nseg,t*get_transform());
+   std::string key = primitive_cache::make_key("cone",{m_r,m_r,m_h,double(m_center)});
+   double r = m_r, h = m_h;
+   bool center = m_center;
+   std::shared_ptr<xpolyhedron> poly = primitive_cache::singleton().get(key,[r,h,center,nseg]() { return primitives3d::make_cone(r,r,h,center,nseg); },t*get_transform());
    std::shared_ptr<carve::mesh::MeshSet<3>> meshset = poly->create_carve_mesh();
 
    carve::mesh::MeshSimplifier simplifier;
@@ -53,3 +57,14 @@ xcylinder::xcylinder(const cf_xmlNode& node)
    m_r   = node.get_property("r",1.0);
    m_center = ("true" == node.get_property("center","false"))? true : false;
 }
+
+bool xcylinder::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // the box of the bottom and top circles
+   const carve::math::Matrix tt = t*get_transform();
+   const double z1 = (m_center)? -0.5*m_h : 0.0;
+   box = xbox3d();
+   box.enclose_ellipsoid(tt,carve::geom::VECTOR(0.0,0.0,z1),m_r,m_r,0.0);
+   box.enclose_ellipsoid(tt,carve::geom::VECTOR(0.0,0.0,z1+m_h),m_r,m_r,0.0);
+   return true;
+}
@@ -25,6 +25,8 @@ public:
    virtual ~xcylinder();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
 private:
    double m_h;
    double m_r;
@@ -15,7 +15,8 @@
 
 #include "xdifference2d.h"
 #include "clipper_boolean.h"
-#include "carve_boolean.h"
+#include "extrude_mesh.h"
+#include "mesh_utils.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xshape2d_collector.h"
@@ -28,41 +29,53 @@ xdifference2d::~xdifference2d()
 
 std::shared_ptr<clipper_profile> xdifference2d::create_clipper_profile(const carve::math::Matrix& t) const
 {
-   clipper_boolean a,b;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      a.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
-   }
+   return compute_profile(t*get_transform());
+}
 
-   for(auto i=m_excl.begin(); i!=m_excl.end(); i++) {
-      b.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
-   }
+std::shared_ptr<clipper_profile> xdifference2d::compute_profile(const carve::math::Matrix& t) const
+{
+   // shapes missing the bounding box of the included shapes are dropped before their profiles are created
+   std::vector<std::shared_ptr<xshape2d>> excl;
+   overlapping_excl(t,excl);
+
+   // the included and excluded unions are computed concurrently
+   std::shared_ptr<clipper_profile> a,b;
+   clipper_boolean::for_each(2,[this,&t,&a,&b,&excl](size_t i) {
+      if(i == 0)               a = clipper_boolean::reduce(m_incl.size(),[this,&t](size_t i) { return m_incl[i]->create_clipper_profile(t); },ClipperLib::ctUnion,weights(m_incl));
+      else if(excl.size() > 0) b = clipper_boolean::reduce(excl.size(),[&excl,&t](size_t i) { return excl[i]->create_clipper_profile(t); },ClipperLib::ctUnion,weights(excl));
+   });
 
    clipper_boolean csg;
-   csg.compute(a.profile(),ClipperLib::ctUnion);
-   csg.compute(b.profile(),ClipperLib::ctDifference);
+   csg.compute(a,ClipperLib::ctUnion);
+   if(b.get()) csg.compute(b,ClipperLib::ctDifference);
 
-   return csg.profile();
+   return clipper_boolean::simplify(csg.profile());
 }
 
-
-
-std::shared_ptr<carve::mesh::MeshSet<3>> xdifference2d::create_carve_mesh(const carve::math::Matrix& t) const
+void xdifference2d::overlapping_excl(const carve::math::Matrix& t, std::vector<std::shared_ptr<xshape2d>>& excl) const
 {
-   carve_boolean a,b;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      std::shared_ptr<xshape2d> obj = *i;
-      a.compute(obj->create_carve_mesh(t*get_transform()),carve::csg::CSG::UNION);
+   xbox3d abox;
+   if(!xshape2d::bounding_box(t,m_incl,abox)) {
+      excl = m_excl;
+      return;
    }
 
-   for(auto i=m_excl.begin(); i!=m_excl.end(); i++) {
-      std::shared_ptr<xshape2d> obj = *i;
-      b.compute(obj->create_carve_mesh(t*get_transform()),carve::csg::CSG::UNION);
+   const double tol = 1.0E-9*abox.diagonal();
+   excl.reserve(m_excl.size());
+   for(auto& shape : m_excl) {
+      xbox3d box;
+      if(!shape->bounding_box(t,box) || box.intersects(abox,tol)) excl.push_back(shape);
    }
+}
 
-   carve_boolean csg;
-   csg.compute(a.mesh_set(),carve::csg::CSG::UNION);
-   csg.compute(b.mesh_set(),carve::csg::CSG::A_MINUS_B);
-   return csg.mesh_set();
+std::shared_ptr<carve::mesh::MeshSet<3>> xdifference2d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   // the profile is created in the local system, the 3d transformation is applied by the extrusion
+   std::shared_ptr<clipper_profile> profile = compute_profile(carve::math::Matrix());
+   if(!profile.get() || profile->paths().size() == 0) {
+      return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
+   }
+   return extrude_mesh::linear_extrude(profile,mesh_utils::thickness(),t*get_transform());
 }
 
 size_t xdifference2d::nbool()
@@ -89,3 +102,8 @@ xdifference2d::xdifference2d(const cf_xmlNode& node)
    size_t nchildren = m_incl.size() + m_excl.size();
    if(nchildren<2) throw logic_error("difference2d requires 2 or more children but found " + std::to_string(nchildren));
 }
+
+bool xdifference2d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   return xshape2d::bounding_box(t*get_transform(),m_incl,box);
+}
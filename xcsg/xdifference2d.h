@@ -17,7 +17,7 @@
 #define XDIFFERENCE2D_H
 
 #include "xshape2d.h"
-#include <set>
+#include <vector>
 
 class xdifference2d : public xshape2d {
 public:
@@ -29,10 +29,21 @@ public:
 
    std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
+   // the box of the included shapes, the excluded shapes only remove from it
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // the 2d boolean is computed with clipper and the result extruded to a slab
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+protected:
+   // compute the profile, t includes the transform of this object
+   std::shared_ptr<clipper_profile> compute_profile(const carve::math::Matrix& t) const;
+
+   // the excluded shapes whose bounding box is unknown or overlaps the box of the included shapes
+   void overlapping_excl(const carve::math::Matrix& t, std::vector<std::shared_ptr<xshape2d>>& excl) const;
 private:
-   std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
-   std::unordered_set<std::shared_ptr<xshape2d>> m_excl;
+   std::vector<std::shared_ptr<xshape2d>> m_incl;
+   std::vector<std::shared_ptr<xshape2d>> m_excl;
 };
 
 #endif // XDIFFERENCE3D_H
@@ -20,6 +20,12 @@
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xsolid_collector.h"
+#include "xunion3d.h"
+#include "mesh_cache.h"
+#include "instance_cache.h"
+#include "primitive_boolean.h"
+#include "difference_planner.h"
+#include "boolean_timer.h"
 
 #include "carve_boolean_thread.h"
 #include "carve_mesh_thread.h"
@@ -30,47 +36,108 @@ xdifference3d::xdifference3d( )
 xdifference3d::~xdifference3d()
 {}
 
-std::shared_ptr<carve::mesh::MeshSet<3>> xdifference3d::compute_union(const carve::math::Matrix& t, std::unordered_set<std::shared_ptr<xsolid>>  objects) const
+std::shared_ptr<carve::mesh::MeshSet<3>> xdifference3d::compute_union(const carve::math::Matrix& t, const std::vector<std::shared_ptr<xsolid>>& objects) const
 {
-   safe_queue<std::string> exception_queue;
    safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
-   carve_mesh_thread::create_mesh_queue(t*get_transform(),objects,mesh_queue);
+   carve_mesh_thread::create_mesh_queue(t,objects,mesh_queue);
 
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::UNION,exception_queue)));
-   }
-
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
-   }
-
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
-   }
+   carve_boolean_thread::reduce(mesh_queue,carve::csg::CSG::UNION);
 
    if(mesh_queue.size() > 0) return mesh_queue.dequeue();
    else return nullptr;
 }
 
 
+bool xdifference3d::all_primitives() const
+{
+   for(auto& obj : m_incl) if(!primitive_boolean::is_primitive(*obj)) return false;
+   for(auto& obj : m_excl) if(!primitive_boolean::is_primitive(*obj)) return false;
+   return true;
+}
+
 std::shared_ptr<carve::mesh::MeshSet<3>> xdifference3d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   // run booleans in threads
+   carve::math::Matrix tt = t*get_transform();
+   return mesh_cache::singleton().get(m_subtree_hash,tt,[this,&tt]() {
+      return instance_cache::singleton().get(m_instance_hash,tt,[this](const carve::math::Matrix& ti) { return compute_carve_mesh(ti); });
+   });
+}
 
-   std::shared_ptr<carve::mesh::MeshSet<3>>  a = compute_union(t,m_incl);
-   std::shared_ptr<carve::mesh::MeshSet<3>>  b = compute_union(t,m_excl);
+std::shared_ptr<carve::mesh::MeshSet<3>> xdifference3d::compute_carve_mesh(const carve::math::Matrix& t) const
+{
+   std::shared_ptr<carve::mesh::MeshSet<3>>  a;
+   std::vector<std::shared_ptr<carve::mesh::MeshSet<3>>> cutters;
+
+   // cutters missing the bounding box of a are dropped before their meshes are created
+   std::vector<carve::math::Matrix>     transforms;
+   std::vector<std::shared_ptr<xsolid>> excl;
+   overlapping_excl(t,transforms,excl);
+   if(excl.size() == 0) return compute_union(t,m_incl);
+
+   if(m_incl.size()==1 && all_primitives()) {
+      // primitive pairs may be resolved without carve, the excluded objects still overlapping a remain.
+      // No union was expanded, so all excluded objects have the transform t
+      std::shared_ptr<carve::mesh::MeshSet<3>> result = primitive_boolean::difference(t,m_incl[0],excl,a,cutters);
+      if(result.get()) return result;
+   }
+   else {
+      // run booleans in threads
+      a = compute_union(t,m_incl);
 
-   carve_boolean csg;
-   csg.compute(a,carve::csg::CSG::UNION);
-   if(b.get())csg.compute(b,carve::csg::CSG::A_MINUS_B);
-   csg.eliminate_short_edges();
+      safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
+      carve_mesh_thread::create_mesh_queue(transforms,excl,mesh_queue);
+      mesh_queue.dequeue_all(cutters);
+   }
 
-   return csg.mesh_set();
+   // the planner decides how the cutters are subtracted
+   return difference_planner::subtract(a,cutters);
 }
 
+void xdifference3d::overlapping_excl(const carve::math::Matrix& t, std::vector<carve::math::Matrix>& transforms, std::vector<std::shared_ptr<xsolid>>& excl) const
+{
+   xbox3d abox;
+   if(!xsolid::bounding_box(t,m_incl,abox)) {
+      transforms.assign(m_excl.size(),t);
+      excl = m_excl;
+      return;
+   }
+
+   // the boxes may be larger than the objects, so a cutter outside the box of a cannot touch it
+   const double tol = 1.0E-9*abox.diagonal();
+   auto overlaps = [&abox,tol](const carve::math::Matrix& tc, const xsolid& obj) {
+      xbox3d box;
+      if(!obj.bounding_box(tc,box) || box.intersects(abox,tol)) return true;
+
+      // counted as a disjoint boolean, as when the planner drops a cutter
+      boolean_timer::singleton().add_disjoint(true);
+      boolean_timer::singleton().add_elapsed(0.0);
+      return false;
+   };
+
+   excl.reserve(m_excl.size());
+   transforms.reserve(m_excl.size());
+   for(auto& obj : m_excl) {
+      if(!overlaps(t,*obj)) continue;
+
+      // a union of cutters often reaches the box of a with only some of its children
+      const xunion3d* nested = dynamic_cast<const xunion3d*>(xsolid::unwrap(obj.get()));
+      if(nested && nested->expandable()) {
+         std::vector<carve::math::Matrix>     nested_transforms;
+         std::vector<std::shared_ptr<xsolid>> nested_children;
+         nested->flatten(t*nested->get_transform(),nested_transforms,nested_children);
+         for(size_t i=0; i<nested_children.size(); i++) {
+            if(overlaps(nested_transforms[i],*nested_children[i])) {
+               transforms.push_back(nested_transforms[i]);
+               excl.push_back(nested_children[i]);
+            }
+         }
+      }
+      else {
+         transforms.push_back(t);
+         excl.push_back(obj);
+      }
+   }
+}
 
 size_t xdifference3d::nbool()
 {
@@ -90,9 +157,29 @@ xdifference3d::xdifference3d(const cf_xmlNode& node)
 {
    if(node.tag() != "difference3d")throw logic_error("Expected xml tag difference3d, but found " + node.tag());
    set_transform(node);
+   m_subtree_hash = mesh_cache::singleton().register_subtree(node);
+   set_cost_key(m_subtree_hash);
+   m_instance_hash = instance_cache::singleton().register_instance(node);
 
    xsolid_collector::collect_children(node,m_incl,1,m_excl);
 
    size_t nchildren = m_incl.size() + m_excl.size();
    if(nchildren<2) throw logic_error("difference3d requires 2 or more children but found " + std::to_string(nchildren));
 }
+
+mesh_estimate xdifference3d::estimate(const carve::math::Matrix& t) const
+{
+   // the excluded objects are united and subtracted from the union of the included ones
+   carve::math::Matrix tt = t*get_transform();
+   std::vector<mesh_estimate> incl,excl;
+   for(auto& obj : m_incl) incl.push_back(obj->estimate(tt));
+   for(auto& obj : m_excl) excl.push_back(obj->estimate(tt));
+   mesh_estimate e = mesh_estimate::combine(incl,carve::csg::CSG::UNION);
+   if(excl.size() == 0) return e;
+   return mesh_estimate::combine(e,mesh_estimate::combine(excl,carve::csg::CSG::UNION),carve::csg::CSG::A_MINUS_B);
+}
+
+bool xdifference3d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   return xsolid::bounding_box(t*get_transform(),m_incl,box);
+}
@@ -17,7 +17,7 @@
 #define XDIFFERENCE3D_H
 
 #include "xsolid.h"
-#include <set>
+#include <vector>
 
 class xdifference3d : public xsolid {
 public:
@@ -29,12 +29,30 @@ public:
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
+   mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   // the box of the included objects, the excluded objects only remove from it
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+protected:
+   // compute the mesh without consulting the caches, t includes the transform of this object
+   std::shared_ptr<carve::mesh::MeshSet<3>> compute_carve_mesh(const carve::math::Matrix& t) const;
+
 private:
-   std::shared_ptr<carve::mesh::MeshSet<3>> compute_union(const carve::math::Matrix& t, std::unordered_set<std::shared_ptr<xsolid>>  objects) const;
+   // true if all children are convex primitives
+   bool all_primitives() const;
+
+   // the excluded objects whose bounding box is unknown or overlaps the box of the included objects, and
+   // their transforms. Excluded unions are expanded, so their children are dropped one by one
+   void overlapping_excl(const carve::math::Matrix& t, std::vector<carve::math::Matrix>& transforms, std::vector<std::shared_ptr<xsolid>>& excl) const;
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> compute_union(const carve::math::Matrix& t, const std::vector<std::shared_ptr<xsolid>>& objects) const;
 
 private:
-   std::unordered_set<std::shared_ptr<xsolid>> m_incl;
-   std::unordered_set<std::shared_ptr<xsolid>> m_excl;
+   std::vector<std::shared_ptr<xsolid>> m_incl;
+   std::vector<std::shared_ptr<xsolid>> m_excl;
+   std::string m_subtree_hash;  // identifies this subtree in the mesh_cache
+   std::string m_instance_hash; // identifies identical instances in the instance_cache
 };
 
 #endif // XDIFFERENCE3D_H
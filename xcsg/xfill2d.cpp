@@ -49,22 +49,12 @@ size_t xfill2d::nbool()
 
 std::shared_ptr<clipper_profile> xfill2d ::create_clipper_profile(const carve::math::Matrix& t) const
 {
-   // traverse underlying objects, fill holes and union the result
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      std::shared_ptr<clipper_profile> profile = (*i)->create_clipper_profile(t*get_transform());
-
-      // split the profile into single path profiles with only positive winding order
-      std::list<std::shared_ptr<clipper_profile>> profiles;
-      profile->positive_profiles(profiles);
+   // create the underlying objects concurrently, fill holes and union the result
+   carve::math::Matrix tt = t*get_transform();
+   std::vector<std::shared_ptr<clipper_profile>> incl = clipper_boolean::create_all(m_incl.size(),[this,&tt](size_t i) { return m_incl[i]->create_clipper_profile(tt); },weights(m_incl));
 
-      // union the profiles to obtain a single profile again
-      // the effect is that all holes dissapear, but outer contours remain
-      for(auto& p : profiles) {
-         csg.compute(p,ClipperLib::ctUnion);
-      }
-   }
-   return csg.profile();
+   // drop the holes of each profile and union the outer contours in one pass
+   return clipper_boolean::fill_all(incl);
 }
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xfill2d ::create_carve_mesh(const carve::math::Matrix& t) const
@@ -72,4 +62,7 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xfill2d ::create_carve_mesh(const carve
    return 0;
 }
 
-
+bool xfill2d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   return xshape2d::bounding_box(t*get_transform(),m_incl,box);
+}
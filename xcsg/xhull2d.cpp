@@ -48,20 +48,15 @@ std::shared_ptr<clipper_profile> xhull2d::create_clipper_profile(const carve::ma
 
    qhull2d qhull;
 
-   // accumulate vertices of underlying objects
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-
-      std::shared_ptr<clipper_profile> profile = (*i)->create_clipper_profile(t*get_transform());
-      std::shared_ptr<polyset2d> polyset = profile->polyset();
-
-      for(auto ipoly=polyset->begin(); ipoly!=polyset->end(); ipoly++) {
-         std::shared_ptr<polygon2d> poly = *ipoly;
-         for(size_t ic=0; ic<poly->size();ic++) {
-            std::shared_ptr<const contour2d> contour = (*poly)[ic];
-            for(size_t iv=0; iv<contour->size();iv++) {
-                const dpos2d& vtx = (*contour)[iv];
-                qhull.push_back(qhull2d::xy(vtx.x(),vtx.y()));
-            }
+   // accumulate vertices of underlying objects, created concurrently
+   carve::math::Matrix tt = t*get_transform();
+   std::vector<std::shared_ptr<clipper_profile>> incl = clipper_boolean::create_all(m_incl.size(),[this,&tt](size_t i) { return m_incl[i]->create_clipper_profile(tt); },weights(m_incl));
+   for(auto& profile : incl) {
+
+      // the hull only needs the path points, no polyset is required
+      for(auto& path : profile->paths()) {
+         for(auto& p : path) {
+            qhull.push_back(qhull2d::xy(double(p.X)/TO_CLIPPER,double(p.Y)/TO_CLIPPER));
          }
       }
    }
@@ -105,7 +100,11 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xhull2d::create_carve_mesh(const carve:
 
    carve_boolean csg;
    csg.compute(qhull);
-   return csg.mesh_set();
+   return csg.release();
 }
 
-
+bool xhull2d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // the hull of the boxes is the box of their union
+   return xshape2d::bounding_box(t*get_transform(),m_incl,box);
+}
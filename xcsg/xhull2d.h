@@ -17,7 +17,7 @@
 #define XHULL2D_H
 
 #include "xshape2d.h"
-#include <set>
+#include <vector>
 
 class xhull2d : public xshape2d {
 public:
@@ -28,9 +28,11 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 private:
-   std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
+   std::vector<std::shared_ptr<xshape2d>> m_incl;
 };
 
 #endif // XHULL3D_H
@@ -19,6 +19,8 @@
 #include "carve_boolean.h"
 #include "qhull/qhull3d.h"
 #include "xsolid_collector.h"
+#include "mesh_cache.h"
+#include "instance_cache.h"
 
 xhull3d::xhull3d()
 {}
@@ -27,6 +29,9 @@ xhull3d::xhull3d(const cf_xmlNode& node)
 {
    if(node.tag() != "hull3d")throw logic_error("Expected xml tag hull3d, but found " + node.tag());
    set_transform(node);
+   m_subtree_hash = mesh_cache::singleton().register_subtree(node);
+   set_cost_key(m_subtree_hash);
+   m_instance_hash = instance_cache::singleton().register_instance(node);
    xsolid_collector::collect_children(node,m_incl);
 }
 
@@ -40,26 +45,47 @@ size_t xhull3d::nbool()
 }
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xhull3d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   carve::math::Matrix tt = t*get_transform();
+   return mesh_cache::singleton().get(m_subtree_hash,tt,[this,&tt]() {
+      return instance_cache::singleton().get(m_instance_hash,tt,[this](const carve::math::Matrix& ti) { return compute_carve_mesh(ti); });
+   });
+}
+
+void xhull3d::hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const
+{
+   xsolid::collect_hull_points(t*get_transform(),m_incl,points,true);
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xhull3d::compute_carve_mesh(const carve::math::Matrix& t) const
 {
    qhull3d qhull;
 
-   // accumulate vertices of underlying objects
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      std::shared_ptr<carve::mesh::MeshSet<3>> meshset = (*i)->create_carve_mesh(t*get_transform());
-      size_t nvert =  meshset->vertex_storage.size();
-      qhull.reserve(qhull.nvertices()+nvert);
-      for(size_t i=0;i<nvert;i++) {
-         carve::mesh::MeshSet<3>::vertex_t& vertex = meshset->vertex_storage[i];
-         qhull.push_back(vertex.v[0],vertex.v[1],vertex.v[2]);
-	//	   cout << "vertex " <<  vertex.v[0] << "  " <<  vertex.v[1] << "  " << vertex.v[2] << endl;
-      }
+   // accumulate vertices of underlying objects, children are processed in parallel
+   // and their interior points are filtered away before the final hull
+   std::vector<carve::geom3d::Vector> points;
+   xsolid::collect_hull_points(t,m_incl,points,true);
+   qhull.reserve(points.size());
+   for(auto& p : points) {
+      qhull.push_back(p[0],p[1],p[2]);
    }
 
    carve_boolean csg;
   // cout << " xhull3d:: csg.compute(qhull)" << endl;
    csg.compute(qhull);
   // cout << " xhull3d:: csg.compute(qhull) OK " << csg.mesh_set()->vertex_storage.size() << " " << csg.mesh_set()->meshes.size()  << endl;
-   return csg.mesh_set();
+   return csg.release();
 }
 
+mesh_estimate xhull3d::estimate(const carve::math::Matrix& t) const
+{
+   std::vector<mesh_estimate> operands;
+   for(auto& obj : m_incl) operands.push_back(obj->estimate(t*get_transform()));
+   return mesh_estimate::hull(operands);
+}
 
+bool xhull3d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // the hull of the boxes is the box of their union
+   return xsolid::bounding_box(t*get_transform(),m_incl,box);
+}
@@ -17,7 +17,7 @@
 #define XHULL3D_H
 
 #include "xsolid.h"
-#include <set>
+#include <vector>
 
 class xhull3d : public xsolid {
 public:
@@ -28,8 +28,22 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // the hull vertices are among the children points, so the hull is not computed
+   void hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const;
+
+protected:
+   // compute the mesh without consulting the caches, t includes the transform of this object
+   std::shared_ptr<carve::mesh::MeshSet<3>> compute_carve_mesh(const carve::math::Matrix& t) const;
+
 private:
-   std::unordered_set<std::shared_ptr<xsolid>> m_incl;
+   std::vector<std::shared_ptr<xsolid>> m_incl;
+   std::string m_subtree_hash;  // identifies this subtree in the mesh_cache
+   std::string m_instance_hash; // identifies identical instances in the instance_cache
 };
 
 #endif // XHULL3D_H
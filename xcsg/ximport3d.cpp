@@ -0,0 +1,67 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "ximport3d.h"
+#include "mesh_source.h"
+#include "mesh_utils.h"
+#include "csg_parser/cf_xmlNode.h"
+
+ximport3d::ximport3d(const cf_xmlNode& node)
+{
+   if(node.tag() != "import3d")throw logic_error("Expected xml tag import3d, but found " + node.tag());
+   set_transform(node);
+
+   std::string path = node.get_property("file",std::string());
+   if(path.size() == 0) throw logic_error("import3d: missing 'file' attribute");
+
+   mesh_source source(path);
+   source.weld(node.get_property("weld",0.0));
+   if(source.faces().size() == 0) throw logic_error("import3d: no faces in file " + path);
+
+   m_vertices = source.vertices();
+   m_faces    = source.faces();
+}
+
+ximport3d::~ximport3d()
+{}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> ximport3d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   const bool reverse_face = mesh_utils::is_left_hand(t);
+   const carve::math::Matrix tt = t*get_transform();
+
+   // build the meshset directly from the face index list
+   std::vector<carve::geom3d::Vector> points;
+   points.reserve(m_vertices.size());
+   for(auto& v : m_vertices) points.push_back(tt*v);
+
+   std::vector<int> face_indices;
+   face_indices.reserve(4*m_faces.size());
+   for(auto& face : m_faces) {
+      face_indices.push_back(static_cast<int>(face.size()));
+      if(reverse_face) for(auto i=face.rbegin(); i!=face.rend(); i++) face_indices.push_back(static_cast<int>(*i));
+      else             for(auto i=face.begin(); i!=face.end(); i++)   face_indices.push_back(static_cast<int>(*i));
+   }
+
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,m_faces.size(),face_indices);
+}
+
+void ximport3d::hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const
+{
+   // the vertices are enough, no mesh required
+   const carve::math::Matrix tt = t*get_transform();
+   points.reserve(points.size()+m_vertices.size());
+   for(auto& v : m_vertices) points.push_back(tt*v);
+}
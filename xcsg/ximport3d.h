@@ -0,0 +1,39 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XIMPORT3D_H
+#define XIMPORT3D_H
+
+#include "xsolid.h"
+#include "xface.h"
+
+// import3d is a solid read from an external mesh file (STL, OFF, OBJ, PLY or xmesh), see mesh_source.
+// Vertices closer than the 'weld' attribute are merged, by default only identical coordinates
+
+class ximport3d : public xsolid {
+public:
+   ximport3d(const cf_xmlNode& node);
+   virtual ~ximport3d();
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   virtual void hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const;
+
+private:
+   std::vector<xvertex> m_vertices;  // vertex coordinates
+   std::vector<xface>   m_faces;     // vertex indices for faces
+};
+
+#endif // XIMPORT3D_H
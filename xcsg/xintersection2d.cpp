@@ -15,7 +15,8 @@
 
 #include "xintersection2d.h"
 #include "clipper_boolean.h"
-#include "carve_boolean.h"
+#include "extrude_mesh.h"
+#include "mesh_utils.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xshape2d_collector.h"
@@ -38,29 +39,64 @@ size_t xintersection2d::nbool()
 
 std::shared_ptr<clipper_profile> xintersection2d::create_clipper_profile(const carve::math::Matrix& t) const
 {
-   clipper_boolean csg;
-   size_t icount=0;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      if(icount == 0) csg.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
-      else            csg.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctIntersection);
-      icount++;
+   return compute_profile(t*get_transform());
+}
+
+std::shared_ptr<clipper_profile> xintersection2d::compute_profile(const carve::math::Matrix& t) const
+{
+   std::vector<carve::math::Matrix>       transforms;
+   std::vector<std::shared_ptr<xshape2d>> children;
+   flatten(t,transforms,children);
+
+   // children with disjoint bounding boxes have an empty intersection, no profile is created
+   bool known = false;
+   xbox3d common;
+   for(size_t i=0; i<children.size(); i++) {
+      xbox3d box;
+      if(!children[i]->bounding_box(transforms[i],box)) continue;
+      common = (known)? common.intersection(box) : box;
+      known  = true;
    }
-   return csg.profile();
+   if(known && !common.initialised()) return std::make_shared<clipper_profile>();
+
+   return clipper_boolean::simplify(clipper_boolean::reduce(children.size(),[&children,&transforms](size_t i) { return children[i]->create_clipper_profile(transforms[i]); },ClipperLib::ctIntersection,weights(children)));
 }
 
-std::shared_ptr<carve::mesh::MeshSet<3>> xintersection2d::create_carve_mesh(const carve::math::Matrix& t) const
+void xintersection2d::flatten(const carve::math::Matrix& t, std::vector<carve::math::Matrix>& transforms, std::vector<std::shared_ptr<xshape2d>>& children) const
+{
+   for(auto& obj : m_incl) {
+      const xintersection2d* nested = dynamic_cast<const xintersection2d*>(xshape2d::unwrap(obj.get()));
+      if(nested) {
+         nested->flatten(t*nested->get_transform(),transforms,children);
+      }
+      else {
+         transforms.push_back(t);
+         children.push_back(obj);
+      }
+   }
+}
+bool xintersection2d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
 {
-   carve_boolean csg;
+   bool known = false;
+   carve::math::Matrix tt = t*get_transform();
+   box = xbox3d();
+   for(auto& shape : m_incl) {
+      xbox3d shape_box;
+      if(!shape->bounding_box(tt,shape_box)) continue;
+      box   = (known)? box.intersection(shape_box) : shape_box;
+      known = true;
+   }
+   return known;
+}
 
-   size_t icount=0;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      std::shared_ptr<xshape2d> obj = *i;
-      if(icount == 0) csg.compute(obj->create_carve_mesh(t*get_transform()),carve::csg::CSG::UNION);
-      else            csg.compute(obj->create_carve_mesh(t*get_transform()),carve::csg::CSG::INTERSECTION);
-      icount++;
+std::shared_ptr<carve::mesh::MeshSet<3>> xintersection2d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   // the profile is created in the local system, the 3d transformation is applied by the extrusion
+   std::shared_ptr<clipper_profile> profile = compute_profile(carve::math::Matrix());
+   if(!profile.get() || profile->paths().size() == 0) {
+      return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
    }
-   csg.eliminate_short_edges();
-   return csg.mesh_set();
+   return extrude_mesh::linear_extrude(profile,mesh_utils::thickness(),t*get_transform());
 }
 
 xintersection2d::xintersection2d(const cf_xmlNode& node)
@@ -18,9 +18,12 @@
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xsolid_collector.h"
+#include "mesh_cache.h"
+#include "instance_cache.h"
 
 #include "carve_boolean_thread.h"
 #include "carve_mesh_thread.h"
+#include "primitive_boolean.h"
 
 xintersection3d::xintersection3d()
 {}
@@ -32,6 +35,9 @@ xintersection3d::xintersection3d(const cf_xmlNode& node)
 {
    if(node.tag() != "intersection3d")throw logic_error("Expected xml tag intersection3d, but found " + node.tag());
    set_transform(node);
+   m_subtree_hash = mesh_cache::singleton().register_subtree(node);
+   set_cost_key(m_subtree_hash);
+   m_instance_hash = instance_cache::singleton().register_instance(node);
 
    xsolid_collector::collect_children(node,m_incl);
 
@@ -40,30 +46,85 @@ xintersection3d::xintersection3d(const cf_xmlNode& node)
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xintersection3d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   // run booleans in threads
+   carve::math::Matrix tt = t*get_transform();
+   return mesh_cache::singleton().get(m_subtree_hash,tt,[this,&tt]() {
+      return instance_cache::singleton().get(m_instance_hash,tt,[this](const carve::math::Matrix& ti) { return compute_carve_mesh(ti); });
+   });
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xintersection3d::compute_carve_mesh(const carve::math::Matrix& t) const
+{
+   // children with disjoint bounding boxes have an empty intersection, no mesh is created
+   xbox3d box;
+   if(common_box(t,box) && !box.initialised()) return primitive_boolean::empty_mesh();
 
-   safe_queue<std::string> exception_queue;
    safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
-   carve_mesh_thread::create_mesh_queue(t*get_transform(),m_incl,mesh_queue);
 
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::INTERSECTION,exception_queue)));
+   if(primitives()) {
+      // primitive intersections may be resolved without carve
+      std::vector<std::shared_ptr<carve::mesh::MeshSet<3>>> meshes;
+      std::shared_ptr<carve::mesh::MeshSet<3>> result = primitive_boolean::intersection(t,m_incl,meshes);
+      if(result.get()) return result;
+      for(auto& mesh : meshes) mesh_queue.enqueue(std::move(mesh));
    }
-
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
+   else {
+      // run booleans in threads
+      std::vector<carve::math::Matrix>     transforms;
+      std::vector<std::shared_ptr<xsolid>> children;
+      flatten(t,transforms,children);
+      carve_mesh_thread::create_mesh_queue(transforms,children,mesh_queue);
    }
 
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
-   }
+   carve_boolean_thread::reduce(mesh_queue,carve::csg::CSG::INTERSECTION);
 
    return mesh_queue.dequeue();
 }
 
+mesh_estimate xintersection3d::estimate(const carve::math::Matrix& t) const
+{
+   std::vector<mesh_estimate> operands;
+   for(auto& obj : m_incl) operands.push_back(obj->estimate(t*get_transform()));
+   return mesh_estimate::combine(operands,carve::csg::CSG::INTERSECTION);
+}
+
+bool xintersection3d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   return common_box(t*get_transform(),box);
+}
+
+bool xintersection3d::common_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   bool known = false;
+   box = xbox3d();
+   for(auto& obj : m_incl) {
+      xbox3d obj_box;
+      if(!obj->bounding_box(t,obj_box)) continue;
+      box = (known)? box.intersection(obj_box) : obj_box;
+      known = true;
+   }
+   return known;
+}
+
+bool xintersection3d::primitives() const
+{
+   for(auto& obj : m_incl) if(!primitive_boolean::is_primitive(*obj)) return false;
+   return true;
+}
+
+void xintersection3d::flatten(const carve::math::Matrix& t, std::vector<carve::math::Matrix>& transforms, std::vector<std::shared_ptr<xsolid>>& children) const
+{
+   for(auto& obj : m_incl) {
+      const xintersection3d* nested = dynamic_cast<const xintersection3d*>(xsolid::unwrap(obj.get()));
+      if(nested && !nested->primitives() && !mesh_cache::singleton().enabled() && !instance_cache::singleton().is_shared(nested->m_instance_hash)) {
+         nested->flatten(t*nested->get_transform(),transforms,children);
+      }
+      else {
+         transforms.push_back(t);
+         children.push_back(obj);
+      }
+   }
+}
+
 size_t xintersection3d::nbool()
 {
    size_t nbool = 0;
@@ -17,6 +17,7 @@
 #define XINTERSECTION3D_H
 
 #include "xsolid.h"
+#include <vector>
 
 class xintersection3d : public xsolid {
 public:
@@ -27,8 +28,31 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   // the common part of the known boxes of the children
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+protected:
+   // compute the mesh without consulting the caches, t includes the transform of this object
+   std::shared_ptr<carve::mesh::MeshSet<3>> compute_carve_mesh(const carve::math::Matrix& t) const;
+
+   // the common part of the known boxes of the children transformed by t, false if none is known
+   bool common_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // true if all children are primitives, the intersection may then be resolved without carve
+   bool primitives() const;
+
+   // append the children of this intersection and their transforms, t includes the transform of this object.
+   // Nested intersections are expanded in place, except those resolved as primitive intersections
+   // or kept in the mesh_cache or shared by several instances
+   void flatten(const carve::math::Matrix& t, std::vector<carve::math::Matrix>& transforms, std::vector<std::shared_ptr<xsolid>>& children) const;
+
 private:
-   std::unordered_set<std::shared_ptr<xsolid>> m_incl;
+   std::vector<std::shared_ptr<xsolid>> m_incl;
+   std::string m_subtree_hash;  // identifies this subtree in the mesh_cache
+   std::string m_instance_hash; // identifies identical instances in the instance_cache
 };
 
 #endif // XINTERSECTION3D_H
@@ -40,14 +40,11 @@ xlinear_extrude::xlinear_extrude(const cf_xmlNode& node)
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xlinear_extrude::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      // create profile in native 2d system
-      csg.compute((*i)->create_clipper_profile(carve::math::Matrix()),ClipperLib::ctUnion);
-   }
+   // create profiles in native 2d system, concurrently
+   std::shared_ptr<clipper_profile> profile = clipper_boolean::reduce(m_incl.size(),[this](size_t i) { return m_incl[i]->create_clipper_profile(carve::math::Matrix()); },ClipperLib::ctUnion,xshape2d::weights(m_incl));
 
    // apply 3d transformation when creating 3d mesh
-   return  extrude_mesh::linear_extrude(csg.profile(),m_dz,t*get_transform());
+   return  extrude_mesh::linear_extrude(profile,m_dz,t*get_transform());
 }
 
 
@@ -60,3 +57,19 @@ size_t xlinear_extrude::nbool()
    }
    return nbool-1;
 }
+
+bool xlinear_extrude::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // the profiles are created in the native 2d system and extruded along z
+   xbox3d profile_box;
+   if(!xshape2d::bounding_box(carve::math::Matrix(),m_incl,profile_box)) return false;
+
+   box = xbox3d();
+   if(profile_box.initialised()) {
+      xvertex p1 = profile_box.p1();
+      xvertex p2 = profile_box.p2();
+      p2[2] = m_dz;
+      box.enclose(t*get_transform(),xbox3d(p1,p2));
+   }
+   return true;
+}
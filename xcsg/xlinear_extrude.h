@@ -18,6 +18,7 @@
 
 #include "xsolid.h"
 #include "xshape2d.h"
+#include <vector>
 
 class xlinear_extrude : public xsolid {
 public:
@@ -28,9 +29,11 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
 private:
    double  m_dz;
-   std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
+   std::vector<std::shared_ptr<xshape2d>> m_incl;
 };
 
 #endif // XLINEAR_EXTRUDE3D_H
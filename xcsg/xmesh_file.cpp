@@ -0,0 +1,245 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xmesh_file.h"
+#include "gz_file.h"
+#include <boost/filesystem.hpp>
+#include <boost/endian/conversion.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <streambuf>
+
+static const char xmesh_magic[8] = { 'X','C','S','G','M','E','S','H' };
+
+static const bool little_endian_host = (boost::endian::order::native == boost::endian::order::little);
+
+template <typename T>
+static void write_le(std::ostream& out, const T* values, size_t count)
+{
+   if(little_endian_host) {
+      out.write(reinterpret_cast<const char*>(values),count*sizeof(T));
+   }
+   else {
+      for(size_t i=0; i<count; i++) {
+         T v = values[i];
+         char* p = reinterpret_cast<char*>(&v);
+         std::reverse(p,p+sizeof(T));
+         out.write(p,sizeof(T));
+      }
+   }
+}
+
+template <typename T>
+static T from_le(T v)
+{
+   if(!little_endian_host) {
+      char* p = reinterpret_cast<char*>(&v);
+      std::reverse(p,p+sizeof(T));
+   }
+   return v;
+}
+
+// unbuffered stream buffer passing the written data to a gz_file, errors are reported as a bad stream
+class gz_streambuf : public std::streambuf {
+public:
+   gz_streambuf(gz_file& gz) : m_gz(gz) {}
+
+protected:
+   std::streamsize xsputn(const char* s, std::streamsize n) override { m_gz.write(s,static_cast<size_t>(n)); return n; }
+   int_type overflow(int_type c) override
+   {
+      if(traits_type::eq_int_type(c,traits_type::eof())) return traits_type::not_eof(c);
+      char ch = traits_type::to_char_type(c);
+      m_gz.write(&ch,1);
+      return c;
+   }
+
+private:
+   gz_file& m_gz;
+};
+
+std::string xmesh_file::write(const carve::mesh::MeshSet<3>& meshset, const std::string& xcsg_path, bool gzip)
+{
+   boost::filesystem::path fullpath(xcsg_path);
+   boost::filesystem::path xmesh_path = fullpath.parent_path() / fullpath.stem();
+   std::string path = xmesh_path.string() + ".xmesh";
+   std::replace(path.begin(),path.end(), '\\', '/');
+   if(!gzip) {
+      write_file(meshset,path);
+      return path;
+   }
+
+   path += ".gz";
+   FILE* file = std::fopen(path.c_str(),"wb");
+   if(!file) throw std::runtime_error("xmesh_file: could not create " + path);
+   bool ok = false;
+   try {
+      gz_file gz(file);
+      gz_streambuf buf(gz);
+      std::ostream out(&buf);
+      write_stream(meshset,out);
+      gz.close();
+      ok = static_cast<bool>(out);
+   }
+   catch(...) {}
+   ok = (std::fclose(file) == 0) && ok;
+   if(!ok) {
+      boost::system::error_code ec;
+      boost::filesystem::remove(path,ec);
+      throw std::runtime_error("xmesh_file: error writing " + path);
+   }
+   return path;
+}
+
+void xmesh_file::write_file(const carve::mesh::MeshSet<3>& meshset, const std::string& file_path)
+{
+   std::ofstream out(file_path,std::ios::binary);
+   if(!out.is_open()) throw std::runtime_error("xmesh_file: could not create " + file_path);
+   write_stream(meshset,out);
+   if(!out) throw std::runtime_error("xmesh_file: error writing " + file_path);
+}
+
+void xmesh_file::write_stream(const carve::mesh::MeshSet<3>& meshset, std::ostream& out)
+{
+   std::vector<double> coords;
+   coords.reserve(3*meshset.vertex_storage.size());
+   for(auto& vertex : meshset.vertex_storage) {
+      coords.push_back(vertex.v[0]);
+      coords.push_back(vertex.v[1]);
+      coords.push_back(vertex.v[2]);
+   }
+
+   uint64_t nfaces = 0;
+   std::vector<int32_t> indices;
+   if(meshset.vertex_storage.size() > 0) {
+      const carve::mesh::Face<3>::vertex_t* v0 = &meshset.vertex_storage[0];
+      std::vector<carve::mesh::Face<3>::vertex_t*> verts;
+      for(carve::mesh::Mesh<3>* mesh : meshset.meshes) {
+         for(carve::mesh::Face<3>* face : mesh->faces) {
+            face->getVertices(verts);
+            indices.push_back(static_cast<int32_t>(verts.size()));
+            for(auto vertex : verts) indices.push_back(static_cast<int32_t>(vertex - v0));
+            nfaces++;
+         }
+      }
+   }
+
+   header h;
+   std::memcpy(h.magic,xmesh_magic,sizeof(h.magic));
+   h.version     = version;
+   h.header_size = sizeof(header);
+   h.nvert       = meshset.vertex_storage.size();
+   h.nfaces      = nfaces;
+   h.nindices    = indices.size();
+
+   out.write(h.magic,sizeof(h.magic));
+   write_le(out,&h.version,1);
+   write_le(out,&h.header_size,1);
+   write_le(out,&h.nvert,1);
+   write_le(out,&h.nfaces,1);
+   write_le(out,&h.nindices,1);
+   write_le(out,coords.data(),coords.size());
+   write_le(out,indices.data(),indices.size());
+}
+
+xmesh_reader::xmesh_reader(const std::string& file_path)
+: m_nvert(0)
+, m_nfaces(0)
+, m_nindices(0)
+, m_vertices(nullptr)
+, m_indices(nullptr)
+{
+   if(!boost::filesystem::exists(file_path)) throw std::runtime_error("xmesh_reader: file not found " + file_path);
+   uint64_t file_size = boost::filesystem::file_size(file_path);
+   if(file_size < sizeof(xmesh_file::header)) throw std::runtime_error("xmesh_reader: file too small " + file_path);
+
+   m_file   = boost::interprocess::file_mapping(file_path.c_str(),boost::interprocess::read_only);
+   m_region = boost::interprocess::mapped_region(m_file,boost::interprocess::read_only);
+   init(static_cast<const char*>(m_region.get_address()),file_size,file_path);
+}
+
+xmesh_reader::xmesh_reader(const char* data, size_t size)
+: m_nvert(0)
+, m_nfaces(0)
+, m_nindices(0)
+, m_vertices(nullptr)
+, m_indices(nullptr)
+{
+   if(size < sizeof(xmesh_file::header)) throw std::runtime_error("xmesh_reader: data too small");
+   init(data,size,"data in memory");
+}
+
+void xmesh_reader::init(const char* data, uint64_t file_size, const std::string& file_path)
+{
+   xmesh_file::header h;
+   std::memcpy(&h,data,sizeof(h));
+   if(!std::equal(h.magic,h.magic+sizeof(h.magic),xmesh_magic)) throw std::runtime_error("xmesh_reader: not an xmesh file " + file_path);
+   if(from_le(h.version) != xmesh_file::version) throw std::runtime_error("xmesh_reader: unsupported version in " + file_path);
+
+   size_t header_size = from_le(h.header_size);
+   m_nvert    = from_le(h.nvert);
+   m_nfaces   = from_le(h.nfaces);
+   m_nindices = from_le(h.nindices);
+
+   uint64_t expected = header_size + 3*sizeof(double)*uint64_t(m_nvert) + sizeof(int32_t)*uint64_t(m_nindices);
+   if(header_size < sizeof(xmesh_file::header) || file_size != expected) throw std::runtime_error("xmesh_reader: inconsistent size of " + file_path);
+
+   const double*  vertices = reinterpret_cast<const double*>(data + header_size);
+   const int32_t* indices  = reinterpret_cast<const int32_t*>(data + header_size + 3*sizeof(double)*m_nvert);
+   if(little_endian_host) {
+      m_vertices = vertices;
+      m_indices  = indices;
+   }
+   else {
+      m_vertex_buffer.resize(3*m_nvert);
+      for(size_t i=0; i<m_vertex_buffer.size(); i++) m_vertex_buffer[i] = from_le(vertices[i]);
+      m_index_buffer.resize(m_nindices);
+      for(size_t i=0; i<m_index_buffer.size(); i++) m_index_buffer[i] = from_le(indices[i]);
+      m_vertices = m_vertex_buffer.data();
+      m_indices  = m_index_buffer.data();
+   }
+}
+
+xmesh_reader::~xmesh_reader()
+{}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xmesh_reader::create_carve_mesh() const
+{
+   std::vector<carve::geom3d::Vector> points;
+   points.reserve(m_nvert);
+   for(size_t iv=0; iv<m_nvert; iv++) {
+      points.push_back(carve::geom::VECTOR(m_vertices[3*iv],m_vertices[3*iv+1],m_vertices[3*iv+2]));
+   }
+
+   // validate the face list before handing it to carve
+   size_t pos = 0;
+   for(size_t iface=0; iface<m_nfaces; iface++) {
+      if(pos >= m_nindices) throw std::runtime_error("xmesh_reader: face block too short");
+      int32_t nv = m_indices[pos++];
+      if(nv < 3 || pos+nv > m_nindices) throw std::runtime_error("xmesh_reader: invalid face size");
+      for(int32_t i=0; i<nv; i++) {
+         int32_t index = m_indices[pos+i];
+         if(index < 0 || static_cast<size_t>(index) >= m_nvert) throw std::runtime_error("xmesh_reader: vertex index out of range");
+      }
+      pos += nv;
+   }
+   if(pos != m_nindices) throw std::runtime_error("xmesh_reader: face block too long");
+
+   std::vector<int> face_indices(m_indices,m_indices+m_nindices);
+   return std::make_shared<carve::mesh::MeshSet<3>>(points,m_nfaces,face_indices);
+}
@@ -0,0 +1,108 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XMESH_FILE_H
+#define XMESH_FILE_H
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include <carve/csg.hpp>
+#include <boost/interprocess/file_mapping.hpp>
+#include <boost/interprocess/mapped_region.hpp>
+
+// xmesh is a compact binary format for carve meshes, used for cached and intermediate results.
+// All values are little-endian. The file layout is
+//
+//    header     : char magic[8] = "XCSGMESH", uint32 version, uint32 header size,
+//                 uint64 nvert, uint64 nfaces, uint64 nindices
+//    vertices   : double[3*nvert]  x,y,z per vertex
+//    faces      : int32[nindices]  per face: number of vertices followed by the vertex indices
+//
+// The blocks are aligned so that a memory mapped file can be used directly on little-endian hosts.
+
+class xmesh_file {
+public:
+   static const uint32_t version = 1;
+
+   struct header {
+      char     magic[8];
+      uint32_t version;
+      uint32_t header_size;
+      uint64_t nvert;
+      uint64_t nfaces;
+      uint64_t nindices;
+   };
+
+   // export to xmesh, return the path to the file created
+   // input is full path to .xcsg file, xmesh to be stored in same folder.
+   // With gzip the file is gzip compressed, with ".gz" appended to the file name
+   static std::string write(const carve::mesh::MeshSet<3>& meshset, const std::string& xcsg_path, bool gzip = false);
+
+   // write meshset to the given file path, throws on failure
+   static void write_file(const carve::mesh::MeshSet<3>& meshset, const std::string& file_path);
+
+   // write meshset to a binary stream, e.g. for sending it to another process
+   static void write_stream(const carve::mesh::MeshSet<3>& meshset, std::ostream& out);
+};
+
+// xmesh_reader memory maps an xmesh file, or reads xmesh data already in memory. On little-endian
+// hosts the vertex and face blocks are used in place, otherwise they are converted into local
+// buffers. The constructors throw std::runtime_error if the file is missing or the data invalid.
+
+class xmesh_reader {
+public:
+   xmesh_reader(const std::string& file_path);
+
+   // read xmesh data of size bytes. The data must stay valid while the reader is used
+   xmesh_reader(const char* data, size_t size);
+
+   virtual ~xmesh_reader();
+
+   size_t nvertices() const { return m_nvert; }
+   size_t nfaces() const    { return m_nfaces; }
+   size_t nindices() const  { return m_nindices; }
+
+   // x,y,z of each vertex
+   const double*  vertices() const { return m_vertices; }
+
+   // per face: number of vertices followed by the vertex indices
+   const int32_t* indices() const  { return m_indices; }
+
+   // create carve mesh from file data
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh() const;
+
+private:
+   // check the header and set up the vertex and face blocks, source is used in messages
+   void init(const char* data, uint64_t size, const std::string& source);
+
+private:
+   boost::interprocess::file_mapping   m_file;
+   boost::interprocess::mapped_region  m_region;
+
+   size_t         m_nvert;
+   size_t         m_nfaces;
+   size_t         m_nindices;
+   const double*  m_vertices;
+   const int32_t* m_indices;
+
+   // used only on big-endian hosts
+   std::vector<double>  m_vertex_buffer;
+   std::vector<int32_t> m_index_buffer;
+};
+
+#endif // XMESH_FILE_H
@@ -34,8 +34,11 @@ size_t xminkowski2d::nbool()
 
 std::shared_ptr<clipper_profile> xminkowski2d::create_clipper_profile(const carve::math::Matrix& t) const
 {
-   std::shared_ptr<clipper_profile> a       = m_incl[0]->create_clipper_profile(t*get_transform());
-   std::shared_ptr<clipper_profile> b_brush = m_incl[1]->create_clipper_profile(t*get_transform());
+   // both operands are created concurrently
+   carve::math::Matrix tt = t*get_transform();
+   std::vector<std::shared_ptr<clipper_profile>> incl = clipper_boolean::create_all(2,[this,&tt](size_t i) { return m_incl[i]->create_clipper_profile(tt); },weights(m_incl));
+   std::shared_ptr<clipper_profile> a       = incl[0];
+   std::shared_ptr<clipper_profile> b_brush = incl[1];
 
    clipper_boolean csg;
    csg.minkowski_sum(a,b_brush);
@@ -48,3 +51,16 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xminkowski2d::create_carve_mesh(const c
 
    return mesh;
 }
+
+bool xminkowski2d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // both operands are transformed by tt before they are summed
+   const carve::math::Matrix tt = t*get_transform();
+   box = xbox3d(true);
+   for(auto& shape : m_incl) {
+      xbox3d shape_box;
+      if(!shape->bounding_box(tt,shape_box)) return false;
+      box = box.minkowski_sum(shape_box);
+   }
+   return true;
+}
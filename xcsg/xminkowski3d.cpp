@@ -1,12 +1,13 @@
 #include "xminkowski3d.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xsolid_collector.h"
+#include "mesh_cache.h"
+#include "instance_cache.h"
 
 #include "carve_boolean.h"
 #include "carve_boolean_thread.h"
 #include "carve_minkowski_thread.h"
 
-#include "boolean_timer.h"
 
 xminkowski3d::xminkowski3d()
 {
@@ -17,6 +18,9 @@ xminkowski3d::xminkowski3d(const cf_xmlNode& node)
 {
    if(node.tag() != "minkowski3d")throw logic_error("Expected xml tag minkowski3d, but found " + node.tag());
    set_transform(node);
+   m_subtree_hash = mesh_cache::singleton().register_subtree(node);
+   set_cost_key(m_subtree_hash);
+   m_instance_hash = instance_cache::singleton().register_instance(node);
    xsolid_collector::collect_children(node,m_incl);
 
    if(m_incl.size() != 2) throw logic_error("Expected 2 parameters for minkowski3d, but got " + std::to_string(m_incl.size()));
@@ -39,28 +43,47 @@ size_t xminkowski3d::nbool()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xminkowski3d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   // first fill the mesh queue with objects to union
-   safe_queue<std::string> exception_queue;
-   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
-   carve_minkowski_thread::create_mesh_queue(t*get_transform(),m_incl,mesh_queue);
+   carve::math::Matrix tt = t*get_transform();
+   return mesh_cache::singleton().get(m_subtree_hash,tt,[this,&tt]() {
+      return instance_cache::singleton().get(m_instance_hash,tt,[this](const carve::math::Matrix& ti) { return compute_carve_mesh(ti); });
+   });
+}
 
-   // improve the timer estimate now that the number of booleans is known for this operation
-   boolean_timer::singleton().add_nbool(mesh_queue.size());
+std::shared_ptr<carve::mesh::MeshSet<3>> xminkowski3d::compute_carve_mesh(const carve::math::Matrix& t) const
+{
+   // first fill the mesh queue with objects to union, this also
+   // improves the timer estimate now that the number of booleans is known
+   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
+   carve_minkowski_thread::create_mesh_queue(t,m_incl,mesh_queue);
 
    // union the resulting meshes
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::UNION,exception_queue)));
-   }
+   carve_boolean_thread::reduce(mesh_queue,carve::csg::CSG::UNION);
 
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
-   }
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
+   return mesh_queue.dequeue();
+}
+
+mesh_estimate xminkowski3d::estimate(const carve::math::Matrix& t) const
+{
+   const carve::math::Matrix tt = t*get_transform();
+   mesh_estimate e;
+   bool first = true;
+   for(auto& obj : m_incl) {
+      mesh_estimate op = obj->estimate(tt);
+      e = (first)? op : mesh_estimate::minkowski(e,op);
+      first = false;
    }
+   return e;
+}
 
-   return mesh_queue.dequeue();
+bool xminkowski3d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // both operands are transformed by tt before they are summed
+   const carve::math::Matrix tt = t*get_transform();
+   box = xbox3d(true);
+   for(auto& obj : m_incl) {
+      xbox3d obj_box;
+      if(!obj->bounding_box(tt,obj_box)) return false;
+      box = box.minkowski_sum(obj_box);
+   }
+   return true;
 }
@@ -12,10 +12,20 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   // the minkowski sum of the boxes of both operands
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
 protected:
+   // compute the mesh without consulting the caches, t includes the transform of this object
+   std::shared_ptr<carve::mesh::MeshSet<3>> compute_carve_mesh(const carve::math::Matrix& t) const;
 
 private:
    std::list<std::shared_ptr<xsolid>> m_incl;
+   std::string m_subtree_hash;  // identifies this subtree in the mesh_cache
+   std::string m_instance_hash; // identifies identical instances in the instance_cache
 };
 
 #endif // XMINKOWSKI3D_H
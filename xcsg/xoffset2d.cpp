@@ -55,18 +55,34 @@ size_t xoffset2d::nbool()
    return nbool-1;
 }
 
-std::shared_ptr<clipper_profile> xoffset2d::create_clipper_profile(const carve::math::Matrix& t) const
+std::shared_ptr<clipper_profile> xoffset2d::offset_source(const carve::math::Matrix& t, double& delta) const
 {
-   // first union together the components (usually only one)
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      csg.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
+   carve::math::Matrix tt = t*get_transform();
+   delta += m_delta;
+
+   // dilations by discs add up, and so do erosions, but not a dilation and an erosion
+   if(m_round && m_incl.size() == 1) {
+      std::shared_ptr<xoffset2d> child = std::dynamic_pointer_cast<xoffset2d>(xshape2d::unwrap(m_incl[0]));
+      if(child && child->m_round && (child->m_delta*m_delta) >= 0.0) {
+         return child->offset_source(tt,delta);
+      }
    }
 
-   // then compute offset profile and return it
+   // union together the components (usually only one)
+   std::shared_ptr<clipper_profile> profile = clipper_boolean::reduce(m_incl.size(),[this,&tt](size_t i) { return m_incl[i]->create_clipper_profile(tt); },ClipperLib::ctUnion,weights(m_incl));
+   if(!profile) profile = std::make_shared<clipper_profile>();
+   return profile;
+}
 
+std::shared_ptr<clipper_profile> xoffset2d::create_clipper_profile(const carve::math::Matrix& t) const
+{
+   // first union together the components, fusing nested round offsets
+   double delta = 0.0;
+   std::shared_ptr<clipper_profile> profile = offset_source(t,delta);
+
+   // then compute offset profile and return it
    clipper_offset offset;
-   offset.compute(csg.profile(),m_delta,m_round,m_chamfer);
+   offset.compute(profile,delta,m_round,m_chamfer);
    return offset.profile();
 }
 
@@ -17,6 +17,7 @@
 #define XOFFSET2D_H
 
 #include "xshape2d.h"
+#include <vector>
 
 class xoffset2d : public xshape2d {
 public:
@@ -29,11 +30,16 @@ public:
    std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
+protected:
+   // the profile to offset and the total offset delta. A single round offset2d child with delta of the
+   // same sign is fused into this offset, as offsetting by r1 and then r2 equals offsetting by r1+r2
+   std::shared_ptr<clipper_profile> offset_source(const carve::math::Matrix& t, double& delta) const;
+
 private:
    double m_delta;    // offset value
    bool   m_round;    // use rounded corners
    bool   m_chamfer;  // apply chamfer corners (ignored for m_round=true)
-   std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
+   std::vector<std::shared_ptr<xshape2d>> m_incl;
 };
 
 #endif // XOFFSET2D_H
@@ -16,6 +16,7 @@
 #include "xpolygon.h"
 #include "primitives2d.h"
 #include "primitives3d.h"
+#include "clipper_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 #include <map>
 
@@ -81,7 +82,9 @@ std::shared_ptr<clipper_profile> xpolygon::create_clipper_profile(const carve::m
    std::shared_ptr<polygon2d> poly = primitives2d::make_polygon(m_vert,t*get_transform());
    std::shared_ptr<clipper_profile> mesh(new clipper_profile());
    mesh->AddPaths(poly->paths());
-   return mesh;
+
+   // imported polygons often carry collinear vertices
+   return clipper_boolean::simplify(mesh);
 }
 
 
@@ -91,3 +94,11 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xpolygon::create_carve_mesh(const carve
    return poly->create_carve_mesh();
 }
 
+bool xpolygon::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   const carve::math::Matrix tt = t*get_transform();
+   box = xbox3d();
+   for(auto& pos : m_vert) box.enclose(tt*pos);
+   box = projected(box);
+   return true;
+}
@@ -20,58 +20,44 @@
 #include "carve_boolean.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "mesh_utils.h"
+#include "geom_kernel.h"
+#include "mesh_source.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <limits>
 #include <map>
+#include <stdexcept>
 
-/*
-static double face_area(const std::vector<xvertex>& p)
+// number of faces first..last-1 with zero area. The triangles are collected and computed as one batch
+static size_t zero_area_faces(const std::vector<xvertex>& vertices, const xpolyhedron& poly, size_t first, size_t last)
 {
-   // https://en.wikipedia.org/wiki/Heron's_formula
-   double a = (p[1] - p[0]).length();
-   double b = (p[2] - p[1]).length();
-   double c = (p[0] - p[2]).length();
-   double s = 0.5*(a+b+c);
-   return sqrt(s*(s-a)*(s-b)*(s-c));
-}
-*/
-
-static double face_area(const std::vector<xvertex>& p)
-{
-   double area = 0.0;
-
-   typedef carve::geom::vector<3> vec3d;
-   if(p.size() == 3) {
-
-      // triangle
-      vec3d x = p[1] - p[0];
-      vec3d y = p[2] - p[0];
-      vec3d normal = carve::geom::cross(x,y);
-      area = 0.5*normal.length();
+   size_t nzero = 0;
+   std::vector<double> corners,loop;
+   for(size_t iface=first; iface<last; iface++) {
+      xpolyhedron::face_ref face = poly.f_get(iface);
+      std::vector<double>& xyz = (face.size() == 3)? corners : loop;
+      if(face.size() != 3) loop.clear();
+      for(size_t iv=0; iv<face.size(); iv++) {
+         const xvertex& p = vertices[face[iv]];
+         xyz.push_back(p.x); xyz.push_back(p.y); xyz.push_back(p.z);
+      }
+      if(face.size() != 3 && !(geom_kernel::polygon_area(loop.data(),face.size()) > 0.0)) nzero++;
    }
-   else {
-
-      // general polygon
-      vec3d normal = carve::geom::VECTOR(0.0,0.0,0.0);
-      size_t n = p.size();
-      vec3d b  = p[n-2];
-      vec3d c  = p[n-1];
-      for(size_t i=0; i<n; i++ ) {
-
-         vec3d a = b;
-         b       = c;
-         c       = p[i];
-
-         double dx = b.y * (c.z - a.z);
-         double dy = b.z * (c.x - a.x);
-         double dz = b.x * (c.y - a.y);
 
-         normal += carve::geom::VECTOR(dx,dy,dz);
-      }
-      area = 0.5*normal.length();
+   std::vector<double> areas(corners.size()/9);
+   geom_kernel::triangle_areas(corners.data(),areas.size(),areas.data());
+   for(double area : areas) {
+      if(!(area > 0.0)) nzero++;
    }
-   return area;
+   return nzero;
 }
 
 xpolyhedron::xpolyhedron()
+: m_face_offsets(1,0)
+, m_trusted(false)
 {}
 
 xpolyhedron::~xpolyhedron()
@@ -79,20 +65,37 @@ xpolyhedron::~xpolyhedron()
 
 xpolyhedron::xpolyhedron(const xpolyhedron& other)
 : m_vertices(other.m_vertices)
-, m_faces(other.m_faces)
+, m_face_offsets(other.m_face_offsets)
+, m_face_indices(other.m_face_indices)
+, m_trusted(other.m_trusted)
 {}
 
 xpolyhedron::xpolyhedron(const cf_xmlNode& const_node)
+: m_face_offsets(1,0)
+, m_trusted(false)
 {
     if(const_node.tag() != "polyhedron")throw logic_error("Expected xml tag polyhedron, but found " + const_node.tag());
 
     set_transform(const_node);
 
+    // vertices and faces may be loaded from an external binary file instead
+    const bool from_file = const_node.has_property("file");
+    if(from_file) {
+       mesh_source source(const_node.get_property("file",std::string()));
+       if(source.faces().size() == 0) throw logic_error("polyhedron: no faces in file " + const_node.get_property("file",std::string()));
+       m_vertices = source.vertices();
+       f_reserve(source.faces().size());
+       for(auto& face : source.faces()) f_add(face,false);
+    }
+
     cf_xmlNode node = const_node;
     for(auto i=node.begin(); i!=node.end(); i++) {
 
        cf_xmlNode sub(i);
        if(!sub.is_attribute_node()) {
+          if(from_file && ("vertices" == sub.tag() || "faces" == sub.tag())) {
+             throw logic_error("polyhedron: '" + sub.tag() + "' cannot be combined with the file attribute");
+          }
           if("vertices" == sub.tag()) {
 
              // be sure to sort the vertices
@@ -135,10 +138,10 @@ xpolyhedron::xpolyhedron(const cf_xmlNode& const_node)
                 }
              }
 
-             // copy to member variable
-             m_faces.resize(f.size());
+             // copy to member variable, the map is ordered by face id
+             f_reserve(f.size());
              for(auto i=f.begin(); i!=f.end(); i++) {
-                m_faces[i->first] = i->second;
+                f_add(i->second,false);
              }
           }
           else if("tmatrix" == sub.tag()) {
@@ -158,7 +161,13 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xpolyhedron::create_carve_mesh(const ca
    carve::input::PolyhedronData data;
    carve::input::Options options;
 
-   if(m_faces.size() > 0) {
+   size_t nfaces = f_size();
+   if(nfaces > 0 && m_trusted && m_direct_mesh) {
+      std::shared_ptr<carve::mesh::MeshSet<3>> meshset = create_trusted_mesh(t,reverse_face);
+      if(meshset) return meshset;
+   }
+
+   if(nfaces > 0) {
 
       // conventional polyhedron
       data.reserveVertices(static_cast<int>(m_vertices.size()));
@@ -166,9 +175,9 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xpolyhedron::create_carve_mesh(const ca
          data.addVertex(t*get_transform()*m_vertices[i]);
       }
 
-      data.reserveFaces(static_cast<int>(m_faces.size()),4);
-      for(size_t i=0; i<m_faces.size(); i++) {
-         const xface& face = m_faces[i];
+      data.reserveFaces(static_cast<int>(nfaces),4);
+      for(size_t i=0; i<nfaces; i++) {
+         face_ref face = f_get(i);
          if(reverse_face) data.addFace(face.rbegin(),face.rend());
          else             data.addFace(face.begin(),face.end());
       }
@@ -185,12 +194,137 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xpolyhedron::create_carve_mesh(const ca
 
       carve_boolean csg;
       csg.compute(qhull);
-      return csg.mesh_set();
+      return csg.release();
    }
 
    return std::shared_ptr<carve::mesh::MeshSet<3>>(data.createMesh(options));
 }
 
+bool xpolyhedron::m_direct_mesh = false;
+
+// smallest number of faces per task when building a trusted mesh
+static const size_t min_trusted_chunk = 16384;
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xpolyhedron::create_trusted_mesh(const carve::math::Matrix& t, bool reverse_face) const
+{
+   typedef carve::mesh::Vertex<3> vertex_t;
+   typedef carve::mesh::Edge<3>   edge_t;
+   typedef carve::mesh::Face<3>   face_t;
+   typedef carve::mesh::Mesh<3>   mesh_t;
+
+   const size_t nverts = m_vertices.size();
+   const size_t nfaces = f_size();
+   const size_t nedges = m_face_indices.size();
+   const size_t nchunk = std::max(size_t(1),std::min(thread_pool::singleton().nthreads(),nfaces/min_trusted_chunk));
+   auto for_chunks = [nchunk](size_t n, const std::function<void(size_t,size_t)>& f) {
+      if(nchunk == 1) { f(0,n); return; }
+      thread_pool::task_group group;
+      for(size_t ic=0; ic<nchunk; ic++) {
+         thread_pool::singleton().submit(group,[ic,n,nchunk,&f]() { f(ic*n/nchunk,(ic+1)*n/nchunk); });
+      }
+      thread_pool::singleton().wait(group);
+   };
+
+   for(size_t iv : m_face_indices) {
+      if(iv >= nverts) throw std::logic_error("xpolyhedron::create_carve_mesh, vertex index out of range");
+   }
+
+   // the vertex storage is not resized below, so the faces can refer to its vertices
+   const carve::math::Matrix tt = t*get_transform();
+   std::vector<vertex_t> vertex_storage(nverts,vertex_t(carve::geom::VECTOR(0.0,0.0,0.0)));
+   for_chunks(nverts,[this,&tt,&vertex_storage](size_t first, size_t last) {
+      for(size_t iv=first; iv<last; iv++) vertex_storage[iv].v = tt*m_vertices[iv];
+   });
+
+   // faces, with their edges in one array in face order
+   std::vector<face_t*> faces(nfaces,nullptr);
+   std::vector<edge_t*> edges(nedges,nullptr);
+   for_chunks(nfaces,[this,reverse_face,&vertex_storage,&faces,&edges](size_t first, size_t last) {
+      std::vector<vertex_t*> loop;
+      for(size_t iface=first; iface<last; iface++) {
+         face_ref face = f_get(iface);
+         loop.clear();
+         if(reverse_face) for(auto it=face.rbegin(); it!=face.rend(); it++) loop.push_back(&vertex_storage[*it]);
+         else             for(auto it=face.begin();  it!=face.end();  it++) loop.push_back(&vertex_storage[*it]);
+         face_t* f = new face_t(loop.begin(),loop.end());
+         f->recalc();
+         faces[iface] = f;
+         edge_t* e = f->edge;
+         for(size_t ie=m_face_offsets[iface]; ie<m_face_offsets[iface+1]; ie++, e = e->next) edges[ie] = e;
+      }
+   });
+   auto origin = [&vertex_storage,&edges](size_t ie) { return size_t(edges[ie]->vert - vertex_storage.data()); };
+   auto target = [&vertex_storage,&edges](size_t ie) { return size_t(edges[ie]->next->vert - vertex_storage.data()); };
+
+   // the edges leaving each vertex
+   std::vector<size_t> out_start(nverts+1,0);
+   for(size_t ie=0; ie<nedges; ie++) out_start[origin(ie)+1]++;
+   for(size_t iv=0; iv<nverts; iv++) out_start[iv+1] += out_start[iv];
+   std::vector<size_t> out_edges(nedges);
+   {
+      std::vector<size_t> fill(out_start.begin(),out_start.end()-1);
+      for(size_t ie=0; ie<nedges; ie++) out_edges[fill[origin(ie)]++] = ie;
+   }
+
+   // the reverse of edge a->b is the only edge b->a, and a->b must be unique
+   const size_t none = std::numeric_limits<size_t>::max();
+   std::vector<size_t> rev_edge(nedges,none);
+   std::atomic<bool> matched(true);
+   for_chunks(nfaces,[this,&edges,&origin,&target,&out_start,&out_edges,&rev_edge,&matched](size_t first, size_t last) {
+      for(size_t ie=m_face_offsets[first]; ie<m_face_offsets[last]; ie++) {
+         const size_t a = origin(ie);
+         const size_t b = target(ie);
+         size_t nsame = 0;
+         for(size_t io=out_start[a]; io<out_start[a+1]; io++) {
+            if(target(out_edges[io]) == b) nsame++;
+         }
+         size_t nrev = 0;
+         for(size_t io=out_start[b]; io<out_start[b+1]; io++) {
+            if(target(out_edges[io]) == a) { rev_edge[ie] = out_edges[io]; nrev++; }
+         }
+         if(nsame != 1 || nrev > 1) { matched = false; return; }
+         if(nrev == 1) edges[ie]->rev = edges[rev_edge[ie]];
+      }
+   });
+   if(!matched) {
+      for(face_t* f : faces) delete f;
+      return nullptr;
+   }
+
+   // face of each edge
+   std::vector<size_t> edge_face(nedges);
+   for(size_t iface=0; iface<nfaces; iface++) {
+      std::fill(edge_face.begin()+m_face_offsets[iface],edge_face.begin()+m_face_offsets[iface+1],iface);
+   }
+
+   // lumps are the sets of faces connected across edges
+   std::vector<char>    visited(nfaces,0);
+   std::vector<size_t>  stack;
+   std::vector<mesh_t*> meshes;
+   for(size_t iface=0; iface<nfaces; iface++) {
+      if(visited[iface]) continue;
+      std::vector<face_t*> lump;
+      visited[iface] = 1;
+      stack.push_back(iface);
+      while(!stack.empty()) {
+         size_t jface = stack.back();
+         stack.pop_back();
+         lump.push_back(faces[jface]);
+         for(size_t ie=m_face_offsets[jface]; ie<m_face_offsets[jface+1]; ie++) {
+            if(rev_edge[ie] == none) continue;
+            size_t kface = edge_face[rev_edge[ie]];
+            if(!visited[kface]) {
+               visited[kface] = 1;
+               stack.push_back(kface);
+            }
+         }
+      }
+      meshes.push_back(new mesh_t(lump));
+   }
+
+   return std::make_shared<carve::mesh::MeshSet<3>>(vertex_storage,meshes);
+}
+
 void xpolyhedron::v_reserve(size_t nverts)
 {
    m_vertices.reserve(nverts);
@@ -213,73 +347,173 @@ const xvertex& xpolyhedron::v_get(size_t v_ind) const
    return m_vertices.at(v_ind);
 }
 
-void xpolyhedron::f_reserve(size_t nfaces)
+void xpolyhedron::v_resize(size_t nverts)
 {
-   m_faces.reserve(nfaces);
+   m_vertices.resize(nverts);
+}
+
+void xpolyhedron::v_set(size_t v_ind, const xvertex& pos)
+{
+   m_vertices.at(v_ind) = pos;
+}
+
+xvertex* xpolyhedron::v_range(size_t v_ind, size_t nverts)
+{
+   if(v_ind+nverts > m_vertices.size()) throw std::logic_error("xpolyhedron::v_range, vertex range out of bounds");
+   return (nverts > 0)? &m_vertices[v_ind] : 0;
+}
+
+void xpolyhedron::f_reserve(size_t nfaces, size_t face_size)
+{
+   m_face_offsets.reserve(nfaces+1);
+   m_face_indices.reserve(nfaces*face_size);
 }
 
 size_t xpolyhedron::f_add(const xface& face, bool reverse_face)
 {
-   size_t index = m_faces.size();
-   if(reverse_face) m_faces.push_back(face.reverse_copy());
-   else             m_faces.push_back(face);
-   return index;
+   return f_add(face.begin(),face.end(),reverse_face);
 }
 
-size_t xpolyhedron::f_size() const
+xpolyhedron::face_ref xpolyhedron::f_get(size_t f_ind) const
 {
-   return m_faces.size();
+   const size_t* indices = m_face_indices.data();
+   return face_ref(indices+m_face_offsets[f_ind],indices+m_face_offsets[f_ind+1]);
 }
 
-const xface& xpolyhedron::f_get(size_t f_ind) const
+void xpolyhedron::f_resize(size_t nfaces, size_t face_size)
 {
-   return m_faces.at(f_ind);
+   size_t nold = f_size();
+   m_face_offsets.resize(nfaces+1);
+   for(size_t iface=nold; iface<nfaces; iface++) {
+      m_face_offsets[iface+1] = m_face_offsets[iface] + face_size;
+   }
+   m_face_indices.resize(m_face_offsets[nfaces],0);
 }
 
-bool  xpolyhedron::check_polyhedron(ostream& out, size_t& num_non_tri)
+void xpolyhedron::f_set(size_t f_ind, const xface& face, bool reverse_face)
 {
-   map<size_t,size_t> edge_count;
-   size_t face_error=0;
+   if(f_ind >= f_size()) throw std::logic_error("xpolyhedron::f_set, face index out of bounds");
+   size_t* indices = &m_face_indices[m_face_offsets[f_ind]];
+   size_t nv = m_face_offsets[f_ind+1] - m_face_offsets[f_ind];
+   if(face.size() != nv) throw std::logic_error("xpolyhedron::f_set, face size does not match pre-sized face");
+   if(reverse_face) std::copy(face.rbegin(),face.rend(),indices);
+   else             std::copy(face.begin(),face.end(),indices);
+}
 
-   num_non_tri = 0;
+size_t* xpolyhedron::f_range(size_t f_ind)
+{
+   if(f_ind >= f_size()) throw std::logic_error("xpolyhedron::f_range, face index out of bounds");
+   return m_face_indices.data() + m_face_offsets[f_ind];
+}
 
-   for(auto i=m_faces.begin(); i!=m_faces.end(); i++) {
-      const xface& face = *i;
+void xpolyhedron::f_reverse()
+{
+   for(size_t iface=0; iface<f_size(); iface++) {
+      std::reverse(m_face_indices.begin()+m_face_offsets[iface],m_face_indices.begin()+m_face_offsets[iface+1]);
+   }
+}
 
-      std::vector<xvertex> p;
-      p.reserve(face.size());
-      for(size_t i=0; i<face.size(); i++) {
-         p.push_back(m_vertices[face[i]]);
-      }
-      if(!(face_area(p)>0.0))face_error++;
-
-      num_non_tri += (face.size()!=3)? 1 : 0;
-
-      // number of edges == number of vertices
-      size_t nedge = face.size();
-      size_t last_edge = nedge-1;
-      for(size_t iedge=0; iedge<nedge; iedge++) {
-         size_t iv0 = face[iedge];
-         size_t iv1 = (iedge<last_edge)? face[iedge+1] : face[0];
-         size_t edge_id = std::min(iv0,iv1)*1000000 + std::max(iv0,iv1);
-         edge_count[edge_id]++;
+// faces are checked and edge keys sorted in parallel chunks of this size
+static const size_t check_chunk_size = 1<<16;
+
+// sort keys in parallel: chunks are sorted as separate tasks, then merged pairwise
+static void parallel_sort(std::vector<uint64_t>& keys)
+{
+   size_t nkeys = keys.size();
+   if(nkeys <= check_chunk_size) {
+      std::sort(keys.begin(),keys.end());
+      return;
+   }
+
+   thread_pool::task_group group;
+   for(size_t first=0; first<nkeys; first+=check_chunk_size) {
+      size_t last = std::min(nkeys,first+check_chunk_size);
+      thread_pool::singleton().submit(group,[&keys,first,last]() { std::sort(keys.begin()+first,keys.begin()+last); });
+   }
+   thread_pool::singleton().wait(group);
+
+   for(size_t width=check_chunk_size; width<nkeys; width*=2) {
+      thread_pool::task_group merge_group;
+      for(size_t first=0; first+width<nkeys; first+=2*width) {
+         size_t middle = first+width;
+         size_t last   = std::min(nkeys,first+2*width);
+         thread_pool::singleton().submit(merge_group,[&keys,first,middle,last]() {
+            std::inplace_merge(keys.begin()+first,keys.begin()+middle,keys.begin()+last);
+         });
       }
+      thread_pool::singleton().wait(merge_group);
+   }
+}
+
+bool  xpolyhedron::check_polyhedron(ostream& out, size_t& num_non_tri)
+{
+   // each edge is recorded once per face using it, as a key with the lowest vertex index
+   // in the upper 32 bits. Sorting the keys brings the uses of each edge together
+   if(m_vertices.size() > std::numeric_limits<uint32_t>::max()) {
+      throw std::logic_error("xpolyhedron::check_polyhedron, too many vertices: " + std::to_string(m_vertices.size()));
    }
 
-   size_t nerr = 0;
-   size_t nc1  = 0;
-   for(auto i=edge_count.begin(); i!=edge_count.end(); i++) {
-      if(i->second != 2) {
+   // a face has as many edges as vertices, so the face offsets are also the edge key offsets
+   size_t nfaces = f_size();
+   const std::vector<size_t>& key_offset = m_face_offsets;
+   std::vector<uint64_t> edge_keys(m_face_indices.size());
+
+   size_t nchunk = (nfaces + check_chunk_size - 1)/check_chunk_size;
+   std::vector<size_t> chunk_face_error(nchunk,0);
+   std::vector<size_t> chunk_non_tri(nchunk,0);
+   thread_pool::task_group group;
+   for(size_t ichunk=0; ichunk<nchunk; ichunk++) {
+      thread_pool::singleton().submit(group,[this,ichunk,nfaces,&key_offset,&edge_keys,&chunk_face_error,&chunk_non_tri]() {
+         size_t first = ichunk*check_chunk_size;
+         size_t last  = std::min(nfaces,first+check_chunk_size);
+         chunk_face_error[ichunk] = zero_area_faces(m_vertices,*this,first,last);
+         for(size_t iface=first; iface<last; iface++) {
+            face_ref face = f_get(iface);
+            chunk_non_tri[ichunk] += (face.size()!=3)? 1 : 0;
+
+            // number of edges == number of vertices
+            size_t nedge = face.size();
+            uint64_t* keys = edge_keys.data() + key_offset[iface];
+            for(size_t iedge=0; iedge<nedge; iedge++) {
+               uint64_t iv0 = face[iedge];
+               uint64_t iv1 = face[(iedge+1<nedge)? iedge+1 : 0];
+               keys[iedge] = (std::min(iv0,iv1) << 32) | std::max(iv0,iv1);
+            }
+         }
+      });
+   }
+   thread_pool::singleton().wait(group);
+
+   size_t face_error=0;
+   num_non_tri = 0;
+   for(size_t ichunk=0; ichunk<nchunk; ichunk++) {
+      face_error  += chunk_face_error[ichunk];
+      num_non_tri += chunk_non_tri[ichunk];
+   }
+
+   parallel_sort(edge_keys);
+
+   // count the uses of each edge
+   size_t nedges = 0;
+   size_t nerr   = 0;
+   size_t nc1    = 0;
+   for(size_t ikey=0; ikey<edge_keys.size(); ) {
+      size_t iend = ikey+1;
+      while(iend<edge_keys.size() && edge_keys[iend]==edge_keys[ikey]) iend++;
+      size_t use_count = iend-ikey;
+      nedges++;
+      if(use_count != 2) {
          nerr++;
-         if(i->second == 1)nc1++;
+         if(use_count == 1)nc1++;
       }
+      ikey = iend;
    }
 
    if(nerr == 0) {
       out << "...Polyhedron is water-tight (edge use-count check OK)" << endl;
    }
    else {
-      out << ">>> Warning: Polyhedron is not water-tight, it has " << edge_count.size() << " edges, " << nerr << " with wrong use count, " << nc1 << " with use-count==1" << endl;
+      out << ">>> Warning: Polyhedron is not water-tight, it has " << nedges << " edges, " << nerr << " with wrong use count, " << nc1 << " with use-count==1" << endl;
    }
    if(face_error == 0) {
       out << "...Polyhedron has no degenerated faces (face area check OK)" << endl;
@@ -297,11 +531,19 @@ std::shared_ptr<carve::poly::Polyhedron> xpolyhedron::create_carve_polyhedron()
 {
    carve::input::PolyhedronData data;
    data.points = m_vertices;
-   data.reserveFaces(static_cast<int>(m_faces.size()),4);
-   for(auto i=m_faces.begin(); i!=m_faces.end(); i++) {
-      const xface& face = *i;
+   data.reserveFaces(static_cast<int>(f_size()),4);
+   for(size_t iface=0; iface<f_size(); iface++) {
+      face_ref face = f_get(iface);
       data.addFace(face.begin(),face.end());
    }
    carve::input::Options options;
    return std::shared_ptr<carve::poly::Polyhedron>(data.create(options));
 }
+
+bool xpolyhedron::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   const carve::math::Matrix tt = t*get_transform();
+   box = xbox3d();
+   for(auto& pos : m_vertices) box.enclose(tt*pos);
+   return true;
+}
@@ -16,12 +16,37 @@
 #ifndef XPOLYHEDRON_H
 #define XPOLYHEDRON_H
 
+#include <algorithm>
+#include <iterator>
 #include <vector>
 #include "xface.h"
 #include "xsolid.h"
 
+// The faces are stored in compressed form: the vertex indices of all faces in one
+// flat array, and the start of each face in an offset array with one extra entry
+
 class xpolyhedron : public xsolid {
 public:
+   // read only view of the vertex indices of one face
+   class face_ref {
+   public:
+      typedef const size_t* const_iterator;
+      typedef std::reverse_iterator<const size_t*> const_reverse_iterator;
+
+      face_ref(const size_t* first, const size_t* last) : m_first(first), m_last(last) {}
+
+      size_t size() const { return m_last - m_first; }
+      size_t operator[](size_t iv) const { return m_first[iv]; }
+
+      const_iterator begin() const { return m_first; }
+      const_iterator end() const   { return m_last; }
+      const_reverse_iterator rbegin() const { return const_reverse_iterator(m_last); }
+      const_reverse_iterator rend() const   { return const_reverse_iterator(m_first); }
+   private:
+      const size_t* m_first;
+      const size_t* m_last;
+   };
+
    xpolyhedron();
    xpolyhedron(const cf_xmlNode& node);
    xpolyhedron(const xpolyhedron& other);
@@ -33,22 +58,72 @@ public:
    size_t         v_size() const;
    const xvertex& v_get(size_t v_ind) const;
 
-   // faces
-   void           f_reserve(size_t nfaces);
+   // pre-sized vertex storage, v_set may be called concurrently for different indices
+   void           v_resize(size_t nverts);
+   void           v_set(size_t v_ind, const xvertex& pos);
+   xvertex*       v_range(size_t v_ind, size_t nverts);   // writable range of nverts pre-sized vertices
+
+   // faces, face_size is the expected average number of vertices per face
+   void           f_reserve(size_t nfaces, size_t face_size = 3);
    size_t         f_add(const xface& face, bool reverse_face);
-   size_t         f_size() const;
-   const xface&   f_get(size_t f_ind) const;
+   template <typename InputIt>
+   size_t         f_add(InputIt first, InputIt last, bool reverse_face);
+   size_t         f_size() const { return m_face_offsets.size()-1; }
+   face_ref       f_get(size_t f_ind) const;
+
+   // pre-sized face storage. Faces added by f_resize have face_size vertices, they are filled with
+   // f_set or f_range. f_set may be called concurrently for different indices, but the face size cannot change
+   void           f_resize(size_t nfaces, size_t face_size = 3);
+   void           f_set(size_t f_ind, const xface& face, bool reverse_face);
+   size_t*        f_range(size_t f_ind);   // writable vertex indices of a pre-sized face
+
+   // reverse the orientation of all faces
+   void           f_reverse();
 
    bool check_polyhedron(ostream& out, size_t& num_non_tri);
 
    // create meshset from this polyhedron
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
+   // a trusted polyhedron is consistently oriented by construction, as the primitives and extrusions created by xcsg.
+   // With direct meshes enabled, its meshset is built directly from the face list, see create_trusted_mesh.
+   // Not trusted by default
+   void set_trusted(bool trusted) { m_trusted = trusted; }
+   bool is_trusted() const { return m_trusted; }
+
+   // build the meshsets of trusted polyhedra directly, skipping the checks and degeneracy handling of
+   // carve::input::PolyhedronData (--direct_mesh). Experimental, off by default
+   static void set_direct_mesh(bool direct) { m_direct_mesh = direct; }
+   static bool direct_mesh() { return m_direct_mesh; }
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
    std::shared_ptr<carve::poly::Polyhedron> create_carve_polyhedron();
 
+protected:
+   // build the carve half-edge structure directly: the reverse of each edge is looked up among the edges leaving
+   // its end vertex, and the lumps are the connected sets of faces. Large polyhedra are built concurrently.
+   // Returns nullptr if an edge is used twice in the same direction, the generic carve input is then required
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_trusted_mesh(const carve::math::Matrix& t, bool reverse_face) const;
+
 private:
-   std::vector<xvertex> m_vertices;  // vertex coordinates
-   std::vector<xface>   m_faces;     // vertex indices for faces
+   std::vector<xvertex> m_vertices;      // vertex coordinates
+   std::vector<size_t>  m_face_offsets;  // start of each face in m_face_indices, f_size()+1 entries
+   std::vector<size_t>  m_face_indices;  // vertex indices of all faces
+   bool                 m_trusted;
+
+   static bool          m_direct_mesh;
 };
 
+template <typename InputIt>
+size_t xpolyhedron::f_add(InputIt first, InputIt last, bool reverse_face)
+{
+   size_t index = f_size();
+   size_t start = m_face_indices.size();
+   m_face_indices.insert(m_face_indices.end(),first,last);
+   if(reverse_face) std::reverse(m_face_indices.begin()+start,m_face_indices.end());
+   m_face_offsets.push_back(m_face_indices.size());
+   return index;
+}
+
 #endif // XPOLYHEDRON_H
@@ -0,0 +1,54 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xprofiled_shape2d.h"
+#include "node_profiler.h"
+
+xprofiled_shape2d::xprofiled_shape2d(const cf_xmlNode& node, std::shared_ptr<xshape2d> shape, size_t id)
+: m_shape(shape)
+, m_id(id)
+{
+   // the transform is visible to parents reading it directly, e.g. transform_extrude
+   set_transform(node);
+}
+
+xprofiled_shape2d::~xprofiled_shape2d()
+{}
+
+size_t xprofiled_shape2d::nbool()
+{
+   return m_shape->nbool();
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xprofiled_shape2d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   node_profiler::scope scope(m_id);
+   std::shared_ptr<carve::mesh::MeshSet<3>> mesh = m_shape->create_carve_mesh(t);
+   if(mesh) scope.set_result(*mesh);
+   return mesh;
+}
+
+std::shared_ptr<clipper_profile> xprofiled_shape2d::create_clipper_profile(const carve::math::Matrix& t) const
+{
+   node_profiler::scope scope(m_id);
+   std::shared_ptr<clipper_profile> profile = m_shape->create_clipper_profile(t);
+   if(profile) scope.set_result(*profile);
+   return profile;
+}
+
+bool xprofiled_shape2d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   return m_shape->bounding_box(t,box);
+}
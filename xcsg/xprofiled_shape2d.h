@@ -0,0 +1,43 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XPROFILED_SHAPE2D_H
+#define XPROFILED_SHAPE2D_H
+
+#include "xshape2d.h"
+
+// xprofiled_shape2d wraps a 2d shape created by xcsg_factory when profiling is enabled,
+// each call is measured and recorded in node_profiler
+
+class xprofiled_shape2d : public xshape2d {
+public:
+   xprofiled_shape2d(const cf_xmlNode& node, std::shared_ptr<xshape2d> shape, size_t id);
+   virtual ~xprofiled_shape2d();
+
+   virtual size_t nbool();
+
+   virtual std::shared_ptr<xshape2d> wrapped() const { return m_shape; }
+
+   virtual std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+   virtual std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   virtual bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+private:
+   std::shared_ptr<xshape2d> m_shape;
+   size_t                    m_id;     // node_profiler id
+};
+
+#endif // XPROFILED_SHAPE2D_H
@@ -0,0 +1,57 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "xprofiled_solid.h"
+#include "node_profiler.h"
+
+xprofiled_solid::xprofiled_solid(const cf_xmlNode& node, std::shared_ptr<xsolid> solid, size_t id)
+: m_solid(solid)
+, m_id(id)
+{
+   // the transform is visible to parents reading it directly
+   set_transform(node);
+}
+
+xprofiled_solid::~xprofiled_solid()
+{}
+
+size_t xprofiled_solid::nbool()
+{
+   return m_solid->nbool();
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xprofiled_solid::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   node_profiler::scope scope(m_id);
+   std::shared_ptr<carve::mesh::MeshSet<3>> mesh = m_solid->create_carve_mesh(t);
+   if(mesh) scope.set_result(*mesh);
+   return mesh;
+}
+
+void xprofiled_solid::hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const
+{
+   node_profiler::scope scope(m_id);
+   m_solid->hull_points(t,points);
+}
+
+mesh_estimate xprofiled_solid::estimate(const carve::math::Matrix& t) const
+{
+   return m_solid->estimate(t);
+}
+
+bool xprofiled_solid::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   return m_solid->bounding_box(t,box);
+}
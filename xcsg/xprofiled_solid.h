@@ -0,0 +1,46 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef XPROFILED_SOLID_H
+#define XPROFILED_SOLID_H
+
+#include "xsolid.h"
+
+// xprofiled_solid wraps a solid created by xcsg_factory when profiling is enabled,
+// each call is measured and recorded in node_profiler
+
+class xprofiled_solid : public xsolid {
+public:
+   xprofiled_solid(const cf_xmlNode& node, std::shared_ptr<xsolid> solid, size_t id);
+   virtual ~xprofiled_solid();
+
+   virtual size_t nbool();
+
+   virtual std::shared_ptr<xsolid> wrapped() const { return m_solid; }
+
+   virtual std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   virtual mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   virtual bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   virtual void hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const;
+
+private:
+   std::shared_ptr<xsolid> m_solid;
+   size_t                  m_id;     // node_profiler id
+};
+
+#endif // XPROFILED_SOLID_H
@@ -20,14 +20,17 @@
 #include "carve_boolean_thread.h"
 #include "carve_mesh_thread.h"
 #include "project_mesh.h"
+#include "slice_mesh.h"
 
 xprojection2d::xprojection2d()
+: m_cut(false)
 {}
 
 xprojection2d::xprojection2d (const cf_xmlNode& node)
 {
    if(node.tag() != "projection2d")throw std::logic_error("Expected xml tag projection2d, but found " + node.tag());
    set_transform(node);
+   m_cut = ("true" == node.get_property("cut","false"))? true : false;
    xsolid_collector::collect_children(node,m_incl);
 
    if(m_incl.size() != 1) throw std::logic_error("Expected one child object for projection2d, but found " + std::to_string(m_incl.size()));
@@ -51,29 +54,16 @@ std::shared_ptr<clipper_profile> xprojection2d ::create_clipper_profile(const ca
 {
    // run 3d booleans in threads
 
-   safe_queue<std::string> exception_queue;
    safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
    carve_mesh_thread::create_mesh_queue(t*get_transform(),m_incl,mesh_queue);
 
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::UNION,exception_queue)));
-   }
-
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
-   }
-
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
-   }
+   carve_boolean_thread::reduce(mesh_queue,carve::csg::CSG::UNION);
 
    // retrieve the computed 3d mesh
    std::shared_ptr<carve::mesh::MeshSet<3>> mesh = mesh_queue.dequeue();
 
-   // project to 2d and return the result
+   // project to 2d, or cut at z=0, and return the result
+   if(m_cut) return slice_mesh::slice(mesh,0.0);
    return project_mesh::project(mesh);
 }
 
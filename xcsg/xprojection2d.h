@@ -19,6 +19,7 @@
 
 #include "xshape2d.h"
 #include "xsolid.h"
+#include <vector>
 
 class xprojection2d : public xshape2d {
 public:
@@ -32,7 +33,9 @@ public:
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
 private:
-   std::unordered_set<std::shared_ptr<xsolid>> m_incl;
+   std::vector<std::shared_ptr<xsolid>> m_incl;
+   bool                                 m_cut;   // section at z=0 instead of projection
+
 };
 
 #endif // XPROJECTION2D_H
@@ -54,3 +54,13 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xrectangle::create_carve_mesh(const car
    std::shared_ptr<xpolyhedron> poly = primitives3d::make_cuboid(m_dx,m_dy, mesh_utils::thickness(),m_center,false,t*get_transform());
    return poly->create_carve_mesh();
 }
+
+bool xrectangle::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   const double x0 = (m_center)? -0.5*m_dx : 0.0;
+   const double y0 = (m_center)? -0.5*m_dy : 0.0;
+   box = xbox3d();
+   box.enclose(t*get_transform(),xbox3d(carve::geom::VECTOR(x0,y0,0.0),carve::geom::VECTOR(x0+m_dx,y0+m_dy,0.0)));
+   box = projected(box);
+   return true;
+}
@@ -26,6 +26,8 @@ public:
 
    std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
 private:
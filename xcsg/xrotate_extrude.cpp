@@ -26,6 +26,9 @@ static const double pi = 4.0*atan(1.0);
 
 xrotate_extrude::xrotate_extrude(double angle)
 : m_angle(angle)
+, m_pitch(0.0)
+, m_trim(false)
+, m_core(-1.0)
 {}
 
 xrotate_extrude::~xrotate_extrude()
@@ -34,6 +37,8 @@ xrotate_extrude::~xrotate_extrude()
 xrotate_extrude::xrotate_extrude(const cf_xmlNode& node)
 : m_angle(1.0)
 , m_pitch(0.0)
+, m_trim(false)
+, m_core(-1.0)
 {
    if(node.tag() != "rotate_extrude")throw logic_error("Expected xml tag 'rotate_extrude', but found " + node.tag());
    set_transform(node);
@@ -41,6 +46,9 @@ xrotate_extrude::xrotate_extrude(const cf_xmlNode& node)
    // apply negative angle to achieve CCW around Y  (in XZ plane)
    m_angle  = -fabs(node.get_property("angle",m_angle));
    m_pitch  = node.get_property("pitch",m_pitch);
+   m_trim   = ("true" == node.get_property("trim","false"))? true : false;
+   m_core   = node.get_property("core",m_core);
+   if(m_trim && !(fabs(m_pitch) > 0)) throw logic_error("rotate_extrude: trim requires a pitch");
 
    xshape2d_collector::collect_children(node,m_incl);
 }
@@ -57,14 +65,12 @@ size_t xrotate_extrude::nbool()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xrotate_extrude::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      // create profile in native 2d system
-      csg.compute((*i)->create_clipper_profile(carve::math::Matrix()),ClipperLib::ctUnion);
-   }
+   // create profiles in native 2d system, concurrently
+   std::shared_ptr<clipper_profile> profile = clipper_boolean::reduce(m_incl.size(),[this](size_t i) { return m_incl[i]->create_clipper_profile(carve::math::Matrix()); },ClipperLib::ctUnion,xshape2d::weights(m_incl));
 
    // apply 3d transformation when creating 3d mesh
-   return extrude_mesh::rotate_extrude(csg.profile(),m_angle,m_pitch,t*get_transform());
+   if(m_trim) return extrude_mesh::thread(profile,m_angle,m_pitch,m_core,t*get_transform());
+   return extrude_mesh::rotate_extrude(profile,m_angle,m_pitch,t*get_transform());
 }
 
 
@@ -105,7 +111,7 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xrotate_extrude::create_carve_mesh(cons
    double r = extrude_mesh::evaluate_max_x(csg.mesh_set());
    size_t nseg = 1;
    double alpha = extrude_angle/nseg;
-   while(r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance()) {
+   while(r*(1.0-cos(0.5*alpha)) >  mesh_utils::secant_tolerance(r)) {
       nseg += 1;
       alpha = extrude_angle/nseg;
    }
@@ -18,6 +18,7 @@
 
 #include "xsolid.h"
 #include "xshape2d.h"
+#include <vector>
 
 class xrotate_extrude : public xsolid {
 public:
@@ -31,7 +32,9 @@ public:
 private:
    double  m_angle; // ccw angle around y
    double  m_pitch;
-   std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
+   bool    m_trim;  // with pitch: the threaded rod of core and profile, trimmed to the height of the sweep
+   double  m_core;  // core radius of the trimmed thread, negative for the smallest profile radius
+   std::vector<std::shared_ptr<xshape2d>> m_incl;
 };
 
 #endif // XROTATE_EXTRUDE_H
@@ -38,3 +38,46 @@ const carve::math::Matrix& xshape2d::get_transform() const
    return m_t;
 }
 
+const xshape2d* xshape2d::unwrap(const xshape2d* shape)
+{
+   while(std::shared_ptr<xshape2d> inner = shape->wrapped()) shape = inner.get();
+   return shape;
+}
+
+std::shared_ptr<xshape2d> xshape2d::unwrap(std::shared_ptr<xshape2d> shape)
+{
+   while(std::shared_ptr<xshape2d> inner = shape->wrapped()) shape = inner;
+   return shape;
+}
+
+
+clipper_boolean::weight_function xshape2d::weights(const std::vector<std::shared_ptr<xshape2d>>& shapes)
+{
+   // computed once, as nbool traverses the subtree
+   auto w = std::make_shared<std::vector<size_t>>();
+   w->reserve(shapes.size());
+   for(auto& shape : shapes) w->push_back(shape->nbool()+1);
+   return [w](size_t i) { return (*w)[i]; };
+}
+
+bool xshape2d::bounding_box(const carve::math::Matrix&, xbox3d&) const
+{
+   return false;
+}
+
+bool xshape2d::bounding_box(const carve::math::Matrix& t, const std::vector<std::shared_ptr<xshape2d>>& shapes, xbox3d& box)
+{
+   box = xbox3d();
+   for(auto& shape : shapes) {
+      xbox3d shape_box;
+      if(!shape->bounding_box(t,shape_box)) return false;
+      box.enclose(shape_box);
+   }
+   return true;
+}
+
+xbox3d xshape2d::projected(const xbox3d& box)
+{
+   if(!box.initialised()) return box;
+   return xbox3d(carve::geom::VECTOR(box.p1()[0],box.p1()[1],0.0),carve::geom::VECTOR(box.p2()[0],box.p2()[1],0.0));
+}
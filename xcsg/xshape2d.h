@@ -18,8 +18,11 @@
 
 
 #include "xshape.h"
+#include "xbox3d.h"
 #include <carve/matrix.hpp>
 #include "clipper_csg/clipper_profile.h"
+#include "clipper_boolean.h"
+#include <vector>
 
 // abstract base class for 2d objects
 
@@ -33,6 +36,29 @@ public:
 
    virtual std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const = 0;
    virtual std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const = 0;
+
+   // the shape wrapped by this node, nullptr unless the node only decorates another, see xprofiled_shape2d
+   virtual std::shared_ptr<xshape2d> wrapped() const { return nullptr; }
+
+   // the innermost shape wrapped by shape, or shape itself. The type of a node is tested on
+   // the unwrapped shape, so that a wrapper does not change how the model is computed
+   static const xshape2d* unwrap(const xshape2d* shape);
+   static std::shared_ptr<xshape2d> unwrap(std::shared_ptr<xshape2d> shape);
+
+   // bounding box of the profile transformed by t, computed without creating the profile. The box may be
+   // larger than the shape, its z range is zero. Returns false if not known, an uninitialised box means the shape is empty
+   virtual bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // bounding box enclosing all shapes transformed by t, false if one of them is not known
+   static bool bounding_box(const carve::math::Matrix& t, const std::vector<std::shared_ptr<xshape2d>>& shapes, xbox3d& box);
+
+   // weights of the shapes for grouping them in thread_pool tasks, the number of booleans in each shape plus one
+   static clipper_boolean::weight_function weights(const std::vector<std::shared_ptr<xshape2d>>& shapes);
+
+protected:
+   // the box projected to the xy plane, as the profiles are
+   static xbox3d projected(const xbox3d& box);
+
 private:
    carve::math::Matrix m_t;
 };
@@ -23,7 +23,7 @@ void xshape2d_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A)
    for(auto i=tmp.begin(); i!=tmp.end(); i++) {
       cf_xmlNode sub(i);
       if(xcsg_factory::singleton().is_shape2d(sub)) {
-         A.insert(xcsg_factory::singleton().make_shape2d(sub));
+         A.push_back(xcsg_factory::singleton().make_shape2d(sub));
          icount++;
       }
    }
@@ -41,10 +41,10 @@ void xshape2d_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A,
       cf_xmlNode sub(i);
       if(xcsg_factory::singleton().is_shape2d(sub)) {
          if(icount < nA) {
-            A.insert(xcsg_factory::singleton().make_shape2d(sub));
+            A.push_back(xcsg_factory::singleton().make_shape2d(sub));
          }
          else {
-            B.insert(xcsg_factory::singleton().make_shape2d(sub));
+            B.push_back(xcsg_factory::singleton().make_shape2d(sub));
          }
          icount++;
       }
@@ -54,19 +54,3 @@ void xshape2d_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A,
       throw logic_error("Expected 2d shape under " + parent.tag() + ", but found none.");
    }
 }
-
-void xshape2d_collector::collect_children(const cf_xmlNode& parent, ShapeVector& A)
-{
-   size_t icount=0;
-   cf_xmlNode tmp(parent);
-   for(auto i=tmp.begin(); i!=tmp.end(); i++) {
-      cf_xmlNode sub(i);
-      if(xcsg_factory::singleton().is_shape2d(sub)) {
-         A.push_back(xcsg_factory::singleton().make_shape2d(sub));
-          icount++;
-      }
-   }
-   if(icount == 0) {
-      throw logic_error("Expected 2d shape under " + parent.tag() + ", but found none.");
-   }
-}
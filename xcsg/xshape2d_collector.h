@@ -26,17 +26,13 @@
 
 class xshape2d_collector {
 public:
-   typedef std::unordered_set<std::shared_ptr<xshape2d>> ShapeSet;
-   typedef std::vector<std::shared_ptr<xshape2d>> ShapeVector;
+   typedef std::vector<std::shared_ptr<xshape2d>> ShapeSet;
 
    // collect all children into A
    static void collect_children(const cf_xmlNode& parent, ShapeSet& A);
 
    // collect nA first children into A, the rest into B
    static void collect_children(const cf_xmlNode& parent, ShapeSet& A, size_t nA, ShapeSet& B);
-
-   // collect all children into A
-   static void collect_children(const cf_xmlNode& parent, ShapeVector& A);
 };
 
 #endif // XSHAPE2D_COLLECTOR_H
@@ -0,0 +1,53 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#include "xshared_solid.h"
+
+xshared_solid::xshared_solid(const cf_xmlNode& node, std::shared_ptr<xsolid> proto, const carve::math::Matrix& to_proto)
+: m_proto(proto)
+, m_to_proto(to_proto)
+{
+   // the transform is visible to parents reading it directly
+   set_transform(node);
+}
+
+xshared_solid::~xshared_solid()
+{}
+
+size_t xshared_solid::nbool()
+{
+   return m_proto->nbool();
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xshared_solid::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   return m_proto->create_carve_mesh(t*m_to_proto);
+}
+
+void xshared_solid::hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const
+{
+   m_proto->hull_points(t*m_to_proto,points);
+}
+
+mesh_estimate xshared_solid::estimate(const carve::math::Matrix& t) const
+{
+   return m_proto->estimate(t*m_to_proto);
+}
+
+bool xshared_solid::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   return m_proto->bounding_box(t*m_to_proto,box);
+}
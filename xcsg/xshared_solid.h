@@ -0,0 +1,48 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+#ifndef XSHARED_SOLID_H
+#define XSHARED_SOLID_H
+
+#include "xsolid.h"
+
+// xshared_solid is created by xcsg_factory for a subtree that is structurally equal to one
+// built earlier, apart from its own transformation. The subtree is not built again, the
+// prototype is evaluated instead with this node's transformation in place of its own.
+// The prototype consults the instance_cache, so the shared mesh is computed once.
+
+class xshared_solid : public xsolid {
+public:
+   // to_proto maps the prototype's own transformation to the transformation of this node
+   xshared_solid(const cf_xmlNode& node, std::shared_ptr<xsolid> proto, const carve::math::Matrix& to_proto);
+   virtual ~xshared_solid();
+
+   virtual size_t nbool();
+
+   virtual std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   virtual mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   virtual bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   virtual void hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const;
+
+private:
+   std::shared_ptr<xsolid> m_proto;
+   carve::math::Matrix     m_to_proto;
+};
+
+#endif // XSHARED_SOLID_H
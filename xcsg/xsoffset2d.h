@@ -17,6 +17,7 @@
 #define XSOFFSET2D_H
 
 #include "xshape2d.h"
+#include <vector>
 
 
 class xsoffset2d : public xshape2d {
@@ -33,7 +34,7 @@ public:
 private:
    double m_delta;
    bool   m_chamfer;
-   std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
+   std::vector<std::shared_ptr<xshape2d>> m_incl;
 };
 
 #endif // XSOFFSET2D_H
@@ -16,6 +16,11 @@
 #include "xsolid.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xtmatrix.h"
+#include "thread_pool.h"
+#include "cost_history.h"
+#include "qhull/qhull3d.h"
+#include <carve/mesh.hpp>
+#include <stdexcept>
 
 xsolid::xsolid()
 {}
@@ -38,3 +43,98 @@ const carve::math::Matrix& xsolid::get_transform() const
    return m_t;
 }
 
+const xsolid* xsolid::unwrap(const xsolid* solid)
+{
+   while(std::shared_ptr<xsolid> inner = solid->wrapped()) solid = inner.get();
+   return solid;
+}
+
+std::shared_ptr<xsolid> xsolid::unwrap(std::shared_ptr<xsolid> solid)
+{
+   while(std::shared_ptr<xsolid> inner = solid->wrapped()) solid = inner;
+   return solid;
+}
+
+double xsolid::cost()
+{
+   return cost_history::singleton().estimate(m_cost_key,static_cast<double>(nbool()+1));
+}
+
+void xsolid::record_cost(double seconds)
+{
+   cost_history::singleton().record(m_cost_key,static_cast<double>(nbool()+1),seconds);
+}
+
+void xsolid::hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const
+{
+   std::shared_ptr<carve::mesh::MeshSet<3>> meshset = create_carve_mesh(t);
+   points.reserve(points.size()+meshset->vertex_storage.size());
+   for(auto& vertex : meshset->vertex_storage) points.push_back(vertex.v);
+}
+
+// remove points with no influence on the convex hull
+static void reduce_hull_points(std::vector<carve::geom3d::Vector>& points)
+{
+   qhull3d qhull;
+   qhull.reserve(points.size());
+   for(auto& p : points) qhull.push_back(p[0],p[1],p[2]);
+   if(qhull.filter_interior() == 0) return;
+
+   points.clear();
+   for(auto i=qhull.in_coords_begin(); i!=qhull.in_coords_end(); i+=3) {
+      points.push_back(carve::geom::VECTOR(*i,*(i+1),*(i+2)));
+   }
+}
+
+mesh_estimate xsolid::estimate(const carve::math::Matrix& t) const
+{
+   std::shared_ptr<carve::mesh::MeshSet<3>> mesh = create_carve_mesh(t);
+   size_t nfaces = 0;
+   for(auto m : mesh->meshes) nfaces += m->faces.size();
+   return mesh_estimate::leaf(nfaces,xbox3d(*mesh));
+}
+
+bool xsolid::bounding_box(const carve::math::Matrix&, xbox3d&) const
+{
+   return false;
+}
+
+bool xsolid::bounding_box(const carve::math::Matrix& t, const std::vector<std::shared_ptr<xsolid>>& objects, xbox3d& box)
+{
+   box = xbox3d();
+   for(auto& obj : objects) {
+      xbox3d obj_box;
+      if(!obj->bounding_box(t,obj_box)) return false;
+      box.enclose(obj_box);
+   }
+   return true;
+}
+
+void xsolid::collect_hull_points(const carve::math::Matrix& t, const std::vector<std::shared_ptr<xsolid>>& objects, std::vector<carve::geom3d::Vector>& points, bool reduce)
+{
+   if(objects.size() == 1) {
+      objects[0]->hull_points(t,points);
+      return;
+   }
+
+   // each object has its own result vector, so the point order is independent of timing
+   std::vector<std::vector<carve::geom3d::Vector>> object_points(objects.size());
+   thread_pool::task_group group;
+   for(size_t i=0; i<objects.size(); i++) {
+      thread_pool::singleton().submit(group,[&t,&objects,&object_points,i,reduce]() {
+         try {
+            objects[i]->hull_points(t,object_points[i]);
+            if(reduce) reduce_hull_points(object_points[i]);
+         }
+         catch(carve::exception& ex) {
+            throw std::runtime_error("(carve error): " + ex.str());
+         }
+      });
+   }
+   thread_pool::singleton().wait(group);
+
+   size_t npoints = points.size();
+   for(auto& p : object_points) npoints += p.size();
+   points.reserve(npoints);
+   for(auto& p : object_points) points.insert(points.end(),p.begin(),p.end());
+}
@@ -17,7 +17,13 @@
 #define XSOLID_H
 
 #include "xshape.h"
+#include "xbox3d.h"
+#include "mesh_estimate.h"
 #include <carve/matrix.hpp>
+#include <carve/geom3d.hpp>
+#include <memory>
+#include <string>
+#include <vector>
 
 // abstract base class for 3d objects
 
@@ -31,8 +37,52 @@ public:
 
    virtual std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const = 0;
 
+   // the solid wrapped by this node, nullptr unless the node only decorates another, see xprofiled_solid
+   virtual std::shared_ptr<xsolid> wrapped() const { return nullptr; }
+
+   // the innermost solid wrapped by solid, or solid itself. The type of a node is tested on
+   // the unwrapped solid, so that a wrapper does not change how the model is computed
+   static const xsolid* unwrap(const xsolid* solid);
+   static std::shared_ptr<xsolid> unwrap(std::shared_ptr<xsolid> solid);
+
+   // append points with the same convex hull as the mesh created with transform t.
+   // The default uses the mesh vertices, nodes may avoid creating the mesh
+   virtual void hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const;
+
+   // bounding box of the solid transformed by t, computed without creating the mesh. The box may be
+   // larger than the solid. Returns false if not known, an uninitialised box means the solid is empty
+   virtual bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // bounding box enclosing all objects transformed by t, false if one of them is not known
+   static bool bounding_box(const carve::math::Matrix& t, const std::vector<std::shared_ptr<xsolid>>& objects, xbox3d& box);
+
+   // append the hull points of all objects, the objects are processed as thread_pool tasks.
+   // With reduce, the interior points of each object are filtered away in its task
+   static void collect_hull_points(const carve::math::Matrix& t, const std::vector<std::shared_ptr<xsolid>>& objects, std::vector<carve::geom3d::Vector>& points, bool reduce = false);
+
+   // estimate of the mesh created with transform t and of the work to create it, see mesh_estimate.
+   // The default creates the mesh of a leaf, nodes with 3d booleans combine the estimates of their children
+   virtual mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   // estimated relative cost of creating the mesh, used to start the most expensive subtrees first.
+   // The number of booleans in the subtree + 1, or the measured time of an earlier evaluation
+   double cost();
+
+   // record the time spent creating the mesh, for the cost of later evaluations
+   void record_cost(double seconds);
+
+   // the subtree as a binary xcsg tree when it is sent to remote workers, otherwise empty
+   const std::string& fragment() const           { return m_fragment; }
+   void set_fragment(const std::string& fragment) { m_fragment = fragment; }
+
+protected:
+   // identify the subtree in the cost_history, composite nodes use their mesh_cache subtree hash
+   void set_cost_key(const std::string& key) { m_cost_key = key; }
+
 private:
    carve::math::Matrix m_t;
+   std::string         m_cost_key;
+   std::string         m_fragment;
 };
 
 #endif // XSOLID_H
@@ -23,7 +23,7 @@ void xsolid_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A)
    for(auto i=tmp.begin(); i!=tmp.end(); i++) {
       cf_xmlNode sub(i);
       if(xcsg_factory::singleton().is_solid(sub)) {
-         A.insert(xcsg_factory::singleton().make_solid(sub));
+         A.push_back(xcsg_factory::singleton().make_solid(sub));
          icount++;
       }
    }
@@ -40,10 +40,10 @@ void xsolid_collector::collect_children(const cf_xmlNode& parent, ShapeSet& A, s
       cf_xmlNode sub(i);
       if(xcsg_factory::singleton().is_solid(sub)) {
          if(icount < nA) {
-            A.insert(xcsg_factory::singleton().make_solid(sub));
+            A.push_back(xcsg_factory::singleton().make_solid(sub));
          }
          else {
-            B.insert(xcsg_factory::singleton().make_solid(sub));
+            B.push_back(xcsg_factory::singleton().make_solid(sub));
          }
          icount++;
       }
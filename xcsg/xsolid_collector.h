@@ -19,6 +19,7 @@
 #include <set>
 #include <list>
 #include <memory>
+#include <vector>
 #include "xsolid.h"
 #include "csg_parser/cf_xmlNode.h"
 
@@ -26,7 +27,7 @@
 
 class xsolid_collector {
 public:
-   typedef std::unordered_set<std::shared_ptr<xsolid>> ShapeSet;
+   typedef std::vector<std::shared_ptr<xsolid>> ShapeSet;
    typedef std::list<std::shared_ptr<xsolid>>          ShapeList;
 
    // collect all children into A
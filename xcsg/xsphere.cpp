@@ -15,6 +15,7 @@
 
 #include "xsphere.h"
 #include "primitives3d.h"
+#include "primitive_cache.h"
 
 xsphere::xsphere(double r)
 : m_r(r)
@@ -37,6 +38,16 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xsphere::create_carve_mesh(const carve:
 {
    int nseg = -1;
  //  std::shared_ptr<xpolyhedron> poly = primitives3d::make_sphere(m_r,nseg,t*get_transform());
-   std::shared_ptr<xpolyhedron> poly = primitives3d::make_geodesic_sphere(m_r,nseg,t*get_transform());
+   std::string key = primitive_cache::make_key("sphere",{m_r});
+   double r = m_r;
+   std::shared_ptr<xpolyhedron> poly = primitive_cache::singleton().get(key,[r,nseg]() { return primitives3d::make_geodesic_sphere(r,nseg); },t*get_transform());
    return poly->create_carve_mesh();
 }
+
+bool xsphere::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   // the mesh vertices are on the sphere
+   box = xbox3d();
+   box.enclose_ellipsoid(t*get_transform(),carve::geom::VECTOR(0.0,0.0,0.0),m_r,m_r,m_r);
+   return true;
+}
@@ -52,3 +52,12 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xsquare::create_carve_mesh(const carve:
    std::shared_ptr<xpolyhedron> poly = primitives3d::make_cuboid(m_size,m_size, mesh_utils::thickness(),m_center,false,t*get_transform());
    return poly->create_carve_mesh();
 }
+
+bool xsquare::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   const double d0 = (m_center)? -0.5*m_size : 0.0;
+   box = xbox3d();
+   box.enclose(t*get_transform(),xbox3d(carve::geom::VECTOR(d0,d0,0.0),carve::geom::VECTOR(d0+m_size,d0+m_size,0.0)));
+   box = projected(box);
+   return true;
+}
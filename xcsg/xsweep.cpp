@@ -51,18 +51,14 @@ xsweep::~xsweep()
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xsweep::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   // create profile in native 2d system
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      // create profile in native 2d system
-      csg.compute((*i)->create_clipper_profile(carve::math::Matrix()),ClipperLib::ctUnion);
-   }
+   // create profiles in native 2d system, concurrently
+   std::shared_ptr<clipper_profile> profile = clipper_boolean::reduce(m_incl.size(),[this](size_t i) { return m_incl[i]->create_clipper_profile(carve::math::Matrix()); },ClipperLib::ctUnion,xshape2d::weights(m_incl));
 
 
    // apply 3d transformation when creating 3d mesh
    std::shared_ptr<const csplines::spline_path> spline(new csplines::spline_path(m_path->cp()));
 
-   return  extrude_mesh::sweep_extrude(csg.profile(),spline,t*get_transform());
+   return  extrude_mesh::sweep_extrude(profile,spline,t*get_transform());
 }
 
 
@@ -17,6 +17,7 @@
 #define XSWEEP_H
 
 #include "xsolid.h"
+#include <vector>
 class xshape2d;
 class xspline_path;
 
@@ -33,7 +34,7 @@ public:
 protected:
 
 private:
-   std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
+   std::vector<std::shared_ptr<xshape2d>> m_incl;
    std::shared_ptr<xspline_path> m_path;
 };
 
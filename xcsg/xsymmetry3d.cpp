@@ -0,0 +1,202 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+
+#include "xsymmetry3d.h"
+#include "csg_parser/cf_xmlNode.h"
+#include "xsolid_collector.h"
+#include "xpolyhedron.h"
+#include "array_pattern.h"
+#include "mesh_cache.h"
+#include "instance_cache.h"
+#include "trace_recorder.h"
+#include "boolean_timer.h"
+#include <cmath>
+
+#include "carve_boolean_thread.h"
+
+static const double pi = 4.0*atan(1.0);
+
+xsymmetry3d::xsymmetry3d()
+: m_order(1)
+, m_mirror(false)
+, m_clip(false)
+{}
+
+xsymmetry3d::xsymmetry3d(const cf_xmlNode& node)
+: m_order(1)
+, m_mirror(false)
+, m_clip(false)
+{
+   if(node.tag() != "symmetry3d")throw logic_error("Expected xml tag symmetry3d, but found " + node.tag());
+   set_transform(node);
+   m_subtree_hash = mesh_cache::singleton().register_subtree(node);
+   set_cost_key(m_subtree_hash);
+   m_instance_hash = instance_cache::singleton().register_instance(node);
+
+   m_order  = node.get_property("order",1);
+   m_mirror = ("true" == node.get_property("mirror","false"))? true : false;
+   m_clip   = ("true" == node.get_property("clip","false"))? true : false;
+   if(m_order < 1) throw logic_error("symmetry3d requires order >= 1");
+
+   // each sector is the child, followed by its mirror image when mirrored
+   const carve::math::Matrix mirror = carve::math::Matrix::SCALE(1.0,-1.0,1.0);
+   for(int i=0; i<m_order; i++) {
+      carve::math::Matrix rot = carve::math::Matrix::ROT(i*2*pi/m_order,carve::geom::VECTOR(0.0,0.0,1.0));
+      m_placements.push_back(rot);
+      if(m_mirror) m_placements.push_back(rot*mirror);
+   }
+
+   std::vector<std::shared_ptr<xsolid>> incl;
+   xsolid_collector::collect_children(node,incl);
+   if(incl.size() != 1) throw logic_error("symmetry3d requires 1 child but found " + std::to_string(incl.size()));
+   m_solid = incl[0];
+}
+
+xsymmetry3d::~xsymmetry3d()
+{}
+
+double xsymmetry3d::span() const
+{
+   return (m_mirror)? pi/m_order : 2*pi/m_order;
+}
+
+size_t xsymmetry3d::nbool()
+{
+   // the child booleans are computed once, the clip is one more
+   size_t nclip = (m_clip && m_placements.size() > 1)? 1 : 0;
+   return m_solid->nbool() + nclip + m_placements.size() - 1;
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xsymmetry3d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   carve::math::Matrix tt = t*get_transform();
+   return mesh_cache::singleton().get(m_subtree_hash,tt,[this,&tt]() {
+      return instance_cache::singleton().get(m_instance_hash,tt,[this](const carve::math::Matrix& ti) { return compute_carve_mesh(ti); });
+   });
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xsymmetry3d::sector_mesh() const
+{
+   std::shared_ptr<carve::mesh::MeshSet<3>> local = m_solid->create_carve_mesh();
+   if(!m_clip || m_placements.size() == 1) return local;
+
+   // the wedge is a prism over a polygon covering the sector from angle 0 to span,
+   // made larger than the child so only the seam planes cut it
+   xbox3d box(*local);
+   if(!box.initialised()) return local;
+   const double margin = 0.1*box.diagonal() + 1.0;
+   double radius = 0.0;
+   for(double x : { box.p1()[0], box.p2()[0] }) {
+      for(double y : { box.p1()[1], box.p2()[1] }) radius = std::max(radius,std::sqrt(x*x+y*y));
+   }
+   radius += margin;
+   const double z1 = box.p1()[2] - margin;
+   const double z2 = box.p2()[2] + margin;
+
+   std::vector<std::pair<double,double>> polygon;
+   const double s = span();
+   if(s < pi*(1.0-1.0E-12)) {
+      // the outer edges are tangent to the circle at 1/4 and 3/4 of the span
+      const double rho = radius/cos(0.25*s);
+      polygon = { {0.0,0.0}, {rho,0.0}, {rho*cos(0.5*s),rho*sin(0.5*s)}, {rho*cos(s),rho*sin(s)} };
+   }
+   else {
+      // a half sector, the half space y >= 0
+      polygon = { {-radius,0.0}, {radius,0.0}, {radius,radius}, {-radius,radius} };
+   }
+
+   const size_t np = polygon.size();
+   xpolyhedron wedge;
+   wedge.v_reserve(2*np);
+   wedge.f_reserve(np+2,4);
+   for(double z : { z1, z2 }) {
+      for(auto& p : polygon) wedge.v_add(carve::geom::VECTOR(p.first,p.second,z));
+   }
+   for(size_t i=0; i<np; i++) {
+      size_t j = (i+1)%np;
+      wedge.f_add(xface(i,j,np+j,np+i),false);
+   }
+   std::vector<size_t> top,bottom;
+   for(size_t i=0; i<np; i++) {
+      top.push_back(np+i);
+      bottom.push_back(np-1-i);
+   }
+   wedge.f_add(top.begin(),top.end(),false);
+   wedge.f_add(bottom.begin(),bottom.end(),false);
+
+   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
+   mesh_queue.enqueue(local);
+   mesh_queue.enqueue(wedge.create_carve_mesh());
+   carve_boolean_thread::reduce(mesh_queue,carve::csg::CSG::INTERSECTION);
+   return mesh_queue.dequeue();
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xsymmetry3d::compute_carve_mesh(const carve::math::Matrix& t) const
+{
+   trace_recorder::span span("xsymmetry3d::compute_carve_mesh");
+
+   // one sector is evaluated in the local system
+   std::shared_ptr<carve::mesh::MeshSet<3>> local = sector_mesh();
+   std::vector<carve::math::Matrix> copies;
+   copies.reserve(m_placements.size());
+   for(auto& placement : m_placements) copies.push_back(t*placement);
+
+   xbox3d local_box(*local);
+   std::vector<xbox3d> boxes(copies.size());
+   for(size_t i=0; i<copies.size(); i++) boxes[i].enclose(copies[i],local_box);
+
+   // sectors that cannot touch are concatenated, each boolean is counted as disjoint
+   if(array_pattern::disjoint(boxes,1.0E-9*local_box.diagonal())) {
+      for(size_t i=1; i<copies.size(); i++) {
+         boolean_timer::singleton().add_disjoint(true);
+         boolean_timer::singleton().add_elapsed(0.0);
+      }
+      return instance_cache::transformed_copies(*local,copies);
+   }
+
+   // neighbouring sectors meet at the seams, the union tree merges neighbours first
+   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
+   for(auto& tc : copies) mesh_queue.enqueue(instance_cache::transformed_copy(*local,tc));
+   carve_boolean_thread::reduce(mesh_queue,carve::csg::CSG::UNION);
+
+   return mesh_queue.dequeue();
+}
+
+mesh_estimate xsymmetry3d::estimate(const carve::math::Matrix& t) const
+{
+   // the clipped sector is the intersection of the child with a wedge of 6 faces
+   mesh_estimate local = m_solid->estimate(carve::math::Matrix());
+   if(m_clip && m_placements.size() > 1 && local.box.initialised()) {
+      local = mesh_estimate::combine(local,mesh_estimate::leaf(6,local.box),carve::csg::CSG::INTERSECTION);
+   }
+
+   std::vector<carve::math::Matrix> copies;
+   carve::math::Matrix tt = t*get_transform();
+   for(auto& placement : m_placements) copies.push_back(tt*placement);
+   return mesh_estimate::copies(local,copies);
+}
+
+bool xsymmetry3d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   xbox3d local_box;
+   if(!m_solid->bounding_box(carve::math::Matrix(),local_box)) return false;
+
+   box = xbox3d();
+   carve::math::Matrix tt = t*get_transform();
+   for(auto& placement : m_placements) box.enclose(tt*placement,local_box);
+   return true;
+}
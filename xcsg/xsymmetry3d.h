@@ -0,0 +1,65 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+
+#ifndef XSYMMETRY3D_H
+#define XSYMMETRY3D_H
+
+#include "xsolid.h"
+
+// xsymmetry3d declares that its result is symmetric about the z axis. Its child holds one sector of
+// the part, which is evaluated once and replicated, so the booleans of the child are paid once
+// instead of once per sector. The copies meet only along the seams, where they are unioned.
+//
+//    order    number of sectors rotated about the z axis, each spanning 2*pi/order
+//    mirror   each sector is mirrored about its y=0 plane, the child holds half a sector
+//    clip     the child is first cut to the sector, so material overhanging the seams is removed
+
+class xsymmetry3d : public xsolid {
+public:
+   xsymmetry3d();
+   xsymmetry3d(const cf_xmlNode& node);
+   virtual ~xsymmetry3d();
+
+   virtual size_t nbool();
+
+   std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+protected:
+   // compute the mesh without consulting the caches, t includes the transform of this object
+   std::shared_ptr<carve::mesh::MeshSet<3>> compute_carve_mesh(const carve::math::Matrix& t) const;
+
+   // the child mesh in the local system, cut to the sector when clipping
+   std::shared_ptr<carve::mesh::MeshSet<3>> sector_mesh() const;
+
+   // angle spanned by the part of the sector held by the child
+   double span() const;
+
+private:
+   int                     m_order;
+   bool                    m_mirror;
+   bool                    m_clip;
+   std::vector<carve::math::Matrix> m_placements;
+   std::shared_ptr<xsolid> m_solid;
+   std::string m_subtree_hash;  // identifies this subtree in the mesh_cache
+   std::string m_instance_hash; // identifies identical instances in the instance_cache
+};
+
+#endif // XSYMMETRY3D_H
@@ -17,7 +17,13 @@
 #include "primitives3d.h"
 #include <carve/input.hpp>
 #include <map>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
 #include "tin_mesh.h"
+#include "mesh_source.h"
+#include <boost/filesystem.hpp>
 
 
 
@@ -27,6 +33,20 @@ xtin_model::xtin_model(const cf_xmlNode& const_node)
 
    set_transform(const_node);
 
+   // points may be given in a separate file instead of as vertex elements.
+   // Text files have one point per line, other formats are read by mesh_source
+   if(const_node.has_property("file")) {
+      std::string path = const_node.get_property("file",std::string());
+      std::string ext  = boost::filesystem::path(path).extension().string();
+      std::transform(ext.begin(),ext.end(),ext.begin(),::tolower);
+      if(ext == ".xyz" || ext == ".txt" || ext == ".csv") {
+         read_points(path);
+      }
+      else {
+         m_vertices = mesh_source(path).vertices();
+      }
+   }
+
    cf_xmlNode node = const_node;
    for(auto i=node.begin(); i!=node.end(); i++) {
 
@@ -50,10 +70,10 @@ xtin_model::xtin_model(const cf_xmlNode& const_node)
                }
             }
 
-            // copy to member variable
-            m_vertices.resize(v.size());
+            // copy to member variable, after any points from file
+            m_vertices.reserve(m_vertices.size()+v.size());
             for(auto i=v.begin(); i!=v.end(); i++) {
-               m_vertices[i->first] = i->second;
+               m_vertices.push_back(i->second);
             }
          }
       }
@@ -63,6 +83,40 @@ xtin_model::xtin_model(const cf_xmlNode& const_node)
 xtin_model::~xtin_model()
 {}
 
+void xtin_model::read_points(const std::string& path)
+{
+   std::ifstream in(path);
+   if(!in.is_open()) throw logic_error("tin_model: could not open points file " + path);
+
+   // one point per line as "x y z", separated by blanks or commas. '#' starts a comment.
+   // The file is read line by line, so only the coordinates are kept in memory
+   std::string line;
+   size_t iline = 0;
+   while(std::getline(in,line)) {
+      iline++;
+      size_t icomment = line.find('#');
+      if(icomment != std::string::npos) line.erase(icomment);
+      std::replace(line.begin(),line.end(),',',' ');
+
+      const char* p = line.c_str();
+      double xyz[3];
+      size_t ncoord = 0;
+      for(; ncoord<3; ncoord++) {
+         char* next = 0;
+         xyz[ncoord] = std::strtod(p,&next);
+         if(next == p) break;
+         p = next;
+      }
+      if(ncoord == 0 && line.find_first_not_of(" \t\r") == std::string::npos) continue;
+      if(ncoord < 3) {
+         std::ostringstream out;
+         out << "tin_model: expected x y z in " << path << " line " << iline;
+         throw logic_error(out.str());
+      }
+      m_vertices.push_back(carve::geom::VECTOR(xyz[0],xyz[1],xyz[2]));
+   }
+}
+
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xtin_model::create_carve_mesh(const carve::math::Matrix& t) const
 {
@@ -87,10 +141,11 @@ std::shared_ptr<carve::mesh::MeshSet<3>> xtin_model::create_carve_mesh(const car
       data.addVertex(t*get_transform()*carve::geom::VECTOR(v.x,v.y,v.z));
    }
 
-   data.reserveFaces(static_cast<int>(poly->m_face.size()),3);
-   for(size_t i=0; i<poly->m_face.size(); i++) {
-      const xface& face = poly->m_face[i];
-      data.addFace(face.begin(),face.end());
+   // the triangles are passed directly from the contiguous index buffer
+   const size_t* tri = poly->m_tri.data();
+   data.reserveFaces(static_cast<int>(poly->nface()),3);
+   for(size_t i=0; i<poly->nface(); i++, tri+=3) {
+      data.addFace(tri,tri+3);
    }
 
    carve::input::Options options;
@@ -27,6 +27,8 @@ public:
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
 protected:
+   // append the points of a text file with one "x y z" point per line
+   void read_points(const std::string& path);
 
 private:
    std::vector<xvertex> m_vertices;  // vertex coordinates
@@ -25,17 +25,15 @@ xtmatrix::xtmatrix(carve::math::Matrix& t)
 
 xtmatrix::xtmatrix(cf_xmlNode& node)
 {
+   // each row is read in one pass over its attributes, missing values are 0.0
+   static const char* const columns[] = { "c0", "c1", "c2", "c3" };
    int irow = 0;
-   for(auto i=node.begin();i!=node.end();i++) {
-      cf_xmlNode row(i);
-      if(row.tag() == "trow") {
-         if(irow < 4) {
-            m_t.m[0][irow] = row.get_property("c0",0.0);
-            m_t.m[1][irow] = row.get_property("c1",0.0);
-            m_t.m[2][irow] = row.get_property("c2",0.0);
-            m_t.m[3][irow] = row.get_property("c3",0.0);
-            irow++;
-         }
+   for(auto i=node.begin();i!=node.end() && irow<4;i++) {
+      if(i->first == "trow") {
+         double c[] = { 0.0, 0.0, 0.0, 0.0 };
+         cf_xmlNode(i).get_properties(columns,4,c);
+         for(size_t icol=0; icol<4; icol++) m_t.m[icol][irow] = c[icol];
+         irow++;
       }
    }
 }
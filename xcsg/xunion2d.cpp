@@ -15,7 +15,8 @@
 
 #include "xunion2d.h"
 #include "clipper_boolean.h"
-#include "carve_boolean.h"
+#include "extrude_mesh.h"
+#include "mesh_utils.h"
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xshape2d_collector.h"
@@ -45,20 +46,43 @@ size_t xunion2d::nbool()
 
 std::shared_ptr<clipper_profile> xunion2d::create_clipper_profile(const carve::math::Matrix& t) const
 {
-   clipper_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      csg.compute((*i)->create_clipper_profile(t*get_transform()),ClipperLib::ctUnion);
+   return compute_profile(t*get_transform());
+}
+
+std::shared_ptr<clipper_profile> xunion2d::compute_profile(const carve::math::Matrix& t) const
+{
+   std::vector<carve::math::Matrix>       transforms;
+   std::vector<std::shared_ptr<xshape2d>> children;
+   flatten(t,transforms,children);
+   return clipper_boolean::simplify(clipper_boolean::reduce(children.size(),[&children,&transforms](size_t i) { return children[i]->create_clipper_profile(transforms[i]); },ClipperLib::ctUnion,weights(children)));
+}
+
+void xunion2d::flatten(const carve::math::Matrix& t, std::vector<carve::math::Matrix>& transforms, std::vector<std::shared_ptr<xshape2d>>& children) const
+{
+   for(auto& obj : m_incl) {
+      const xunion2d* nested = dynamic_cast<const xunion2d*>(xshape2d::unwrap(obj.get()));
+      if(nested) {
+         nested->flatten(t*nested->get_transform(),transforms,children);
+      }
+      else {
+         transforms.push_back(t);
+         children.push_back(obj);
+      }
    }
-   return csg.profile();
 }
 
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xunion2d::create_carve_mesh(const carve::math::Matrix& t) const
 {
-   carve_boolean csg;
-   for(auto i=m_incl.begin(); i!=m_incl.end(); i++) {
-      csg.compute((*i)->create_carve_mesh(t*get_transform()),carve::csg::CSG::UNION);
+   // the profile is created in the local system, the 3d transformation is applied by the extrusion
+   std::shared_ptr<clipper_profile> profile = compute_profile(carve::math::Matrix());
+   if(!profile.get() || profile->paths().size() == 0) {
+      return std::make_shared<carve::mesh::MeshSet<3>>(std::vector<carve::geom3d::Vector>(),0,std::vector<int>());
    }
-   csg.eliminate_short_edges();
-   return csg.mesh_set();
+   return extrude_mesh::linear_extrude(profile,mesh_utils::thickness(),t*get_transform());
+}
+
+bool xunion2d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   return xshape2d::bounding_box(t*get_transform(),m_incl,box);
 }
@@ -17,7 +17,7 @@
 #define XUNION2D_H
 
 #include "xshape2d.h"
-#include <set>
+#include <vector>
 
 class xunion2d : public xshape2d {
 public:
@@ -29,9 +29,20 @@ public:
 
    std::shared_ptr<clipper_profile> create_clipper_profile(const carve::math::Matrix& t = carve::math::Matrix()) const;
 
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // the 2d boolean is computed with clipper and the result extruded to a slab
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+protected:
+   // compute the profile, t includes the transform of this object
+   std::shared_ptr<clipper_profile> compute_profile(const carve::math::Matrix& t) const;
+
+   // append the children of this union and their transforms, t includes the transform of this object.
+   // Nested union2ds are expanded in place, so the whole union is reduced at once
+   void flatten(const carve::math::Matrix& t, std::vector<carve::math::Matrix>& transforms, std::vector<std::shared_ptr<xshape2d>>& children) const;
 private:
-   std::unordered_set<std::shared_ptr<xshape2d>> m_incl;
+   std::vector<std::shared_ptr<xshape2d>> m_incl;
 };
 
 #endif // XUNION3D_H
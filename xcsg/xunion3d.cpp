@@ -18,6 +18,8 @@
 #include "csg_parser/cf_xmlNode.h"
 #include "xcsg_factory.h"
 #include "xsolid_collector.h"
+#include "mesh_cache.h"
+#include "instance_cache.h"
 
 #include "carve_boolean_thread.h"
 #include "carve_mesh_thread.h"
@@ -29,6 +31,9 @@ xunion3d::xunion3d(const cf_xmlNode& node)
 {
    if(node.tag() != "union3d")throw logic_error("Expected xml tag union3d, but found " + node.tag());
    set_transform(node);
+   m_subtree_hash = mesh_cache::singleton().register_subtree(node);
+   set_cost_key(m_subtree_hash);
+   m_instance_hash = instance_cache::singleton().register_instance(node);
    xsolid_collector::collect_children(node,m_incl);
 }
 
@@ -46,27 +51,75 @@ size_t xunion3d::nbool()
 }
 
 std::shared_ptr<carve::mesh::MeshSet<3>> xunion3d::create_carve_mesh(const carve::math::Matrix& t) const
+{
+   carve::math::Matrix tt = t*get_transform();
+   return mesh_cache::singleton().get(m_subtree_hash,tt,[this,&tt]() {
+      return instance_cache::singleton().get(m_instance_hash,tt,[this](const carve::math::Matrix& ti) { return compute_carve_mesh(ti); });
+   });
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xunion3d::compute_carve_mesh(const carve::math::Matrix& t) const
 {
    // run booleans in threads
 
-   safe_queue<std::string> exception_queue;
+   std::vector<carve::math::Matrix>     transforms;
+   std::vector<std::shared_ptr<xsolid>> children;
+   flatten(t,transforms,children);
+
    safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
-   carve_mesh_thread::create_mesh_queue(t*get_transform(),m_incl,mesh_queue);
+   carve_mesh_thread::create_mesh_queue(transforms,children,mesh_queue);
 
-   const size_t nthreads = carve_boolean_thread::default_nthreads();
-   list<boost::thread>  csg_threads;
-   for(size_t i=0; i<nthreads; i++) {
-      csg_threads.push_back(boost::thread(carve_boolean_thread(mesh_queue,carve::csg::CSG::UNION,exception_queue)));
-   }
+   carve_boolean_thread::reduce(mesh_queue,carve::csg::CSG::UNION);
 
-   // wait for the threads to finish
-   for(auto ithread=csg_threads.begin(); ithread!=csg_threads.end(); ithread++) {
-      ithread->join();
-   }
+   return mesh_queue.dequeue();
+}
+
+std::shared_ptr<carve::mesh::MeshSet<3>> xunion3d::stream_carve_mesh(const carve::math::Matrix& t, carve_union_tree::part_function f) const
+{
+   std::vector<carve::math::Matrix>     transforms;
+   std::vector<std::shared_ptr<xsolid>> children;
+   flatten(t*get_transform(),transforms,children);
+
+   safe_queue<carve_boolean_thread::MeshSet_ptr> mesh_queue;
+   carve_mesh_thread::create_mesh_queue(transforms,children,mesh_queue);
+
+   carve_union_tree tree(mesh_queue);
+   tree.set_part_function(f);
+   return tree.compute();
+}
 
-   if(exception_queue.size() > 0) {
-      throw std::logic_error(exception_queue.dequeue());
+void xunion3d::flatten(const carve::math::Matrix& t, std::vector<carve::math::Matrix>& transforms, std::vector<std::shared_ptr<xsolid>>& children) const
+{
+   for(auto& obj : m_incl) {
+      const xunion3d* nested = dynamic_cast<const xunion3d*>(xsolid::unwrap(obj.get()));
+      if(nested && nested->expandable()) {
+         nested->flatten(t*nested->get_transform(),transforms,children);
+      }
+      else {
+         transforms.push_back(t);
+         children.push_back(obj);
+      }
    }
+}
 
-   return mesh_queue.dequeue();
+bool xunion3d::expandable() const
+{
+   return !mesh_cache::singleton().enabled() && !instance_cache::singleton().is_shared(m_instance_hash);
+}
+
+void xunion3d::hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const
+{
+   xsolid::collect_hull_points(t*get_transform(),m_incl,points);
+}
+
+mesh_estimate xunion3d::estimate(const carve::math::Matrix& t) const
+{
+   std::vector<mesh_estimate> operands;
+   for(auto& obj : m_incl) operands.push_back(obj->estimate(t*get_transform()));
+   return mesh_estimate::combine(operands,carve::csg::CSG::UNION);
+}
+
+bool xunion3d::bounding_box(const carve::math::Matrix& t, xbox3d& box) const
+{
+   return xsolid::bounding_box(t*get_transform(),m_incl,box);
 }
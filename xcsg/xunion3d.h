@@ -17,7 +17,8 @@
 #define XUNION3D_H
 
 #include "xsolid.h"
-#include <set>
+#include "carve_union_tree.h"
+#include <vector>
 
 class xunion3d : public xsolid {
 public:
@@ -28,8 +29,34 @@ public:
    virtual size_t nbool();
 
    std::shared_ptr<carve::mesh::MeshSet<3>> create_carve_mesh(const carve::math::Matrix& t = carve::math::Matrix()) const;
+
+   // compute the union without the caches, passing each lump to f as soon as no other child can touch it,
+   // see carve_union_tree. All lumps are passed to f, and the returned mesh set is empty
+   std::shared_ptr<carve::mesh::MeshSet<3>> stream_carve_mesh(const carve::math::Matrix& t, carve_union_tree::part_function f) const;
+
+   mesh_estimate estimate(const carve::math::Matrix& t) const;
+
+   bool bounding_box(const carve::math::Matrix& t, xbox3d& box) const;
+
+   // the hull of a union is the hull of the children, so no boolean is required
+   void hull_points(const carve::math::Matrix& t, std::vector<carve::geom3d::Vector>& points) const;
+
+   // append the children of this union and their transforms, t includes the transform of this object.
+   // Nested unions are expanded in place, so the whole union is reduced at once,
+   // unless their meshes are kept in the mesh_cache or shared by several instances
+   void flatten(const carve::math::Matrix& t, std::vector<carve::math::Matrix>& transforms, std::vector<std::shared_ptr<xsolid>>& children) const;
+
+   // true if a parent may expand this union into its children, i.e. its mesh is not cached or shared
+   bool expandable() const;
+
+protected:
+   // compute the mesh without consulting the caches, t includes the transform of this object
+   std::shared_ptr<carve::mesh::MeshSet<3>> compute_carve_mesh(const carve::math::Matrix& t) const;
+
 private:
-   std::unordered_set<std::shared_ptr<xsolid>> m_incl;
+   std::vector<std::shared_ptr<xsolid>> m_incl;
+   std::string m_subtree_hash;  // identifies this subtree in the mesh_cache
+   std::string m_instance_hash; // identifies identical instances in the instance_cache
 };
 
 #endif // XUNION3D_H
@@ -0,0 +1,177 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#include "zip_file.h"
+#include <algorithm>
+#include <ctime>
+#include <stdexcept>
+
+// little endian fields of the zip headers
+static void put16(std::vector<unsigned char>& buf, uint16_t v) { for(int i=0; i<2; i++) buf.push_back(static_cast<unsigned char>(v >> (8*i))); }
+static void put32(std::vector<unsigned char>& buf, uint32_t v) { for(int i=0; i<4; i++) buf.push_back(static_cast<unsigned char>(v >> (8*i))); }
+static void put64(std::vector<unsigned char>& buf, uint64_t v) { for(int i=0; i<8; i++) buf.push_back(static_cast<unsigned char>(v >> (8*i))); }
+
+static const uint32_t zip64_limit = 0xFFFFFFFF;
+
+zip_file::zip_file(FILE* file, int level)
+: m_file(file)
+, m_level(level)
+, m_offset(0)
+, m_dos_time(0)
+, m_dos_date(0)
+{
+   time_t now = time(0);
+   struct tm* t = localtime(&now);
+   m_dos_time = static_cast<uint16_t>((t->tm_hour << 11) | (t->tm_min << 5) | (t->tm_sec / 2));
+   m_dos_date = static_cast<uint16_t>(((std::max(t->tm_year,80) - 80) << 9) | ((t->tm_mon + 1) << 5) | t->tm_mday);
+}
+
+zip_file::~zip_file()
+{}
+
+void zip_file::put(const void* data, size_t nbytes)
+{
+   if(nbytes > 0 && std::fwrite(data,1,nbytes,m_file) != nbytes) throw std::runtime_error("zip_file: write error");
+   m_offset += nbytes;
+}
+
+void zip_file::begin_entry(const std::string& name)
+{
+   if(m_deflate) throw std::logic_error("zip_file: previous entry not ended");
+
+   entry e;
+   e.name   = name;
+   e.offset = m_offset;
+   m_entries.push_back(e);
+
+   // the sizes are not known yet, they follow in a zip64 data descriptor (flag bit 3)
+   std::vector<unsigned char> h;
+   put32(h,0x04034b50);
+   put16(h,45);                 // version needed, zip64
+   put16(h,0x0808);             // data descriptor, utf-8 name
+   put16(h,8);                  // deflate
+   put16(h,m_dos_time);
+   put16(h,m_dos_date);
+   put32(h,0);                  // crc
+   put32(h,zip64_limit);        // compressed size, in zip64 extra
+   put32(h,zip64_limit);        // uncompressed size, in zip64 extra
+   put16(h,static_cast<uint16_t>(name.size()));
+   put16(h,20);
+   h.insert(h.end(),name.begin(),name.end());
+   put16(h,0x0001);             // zip64 extra field
+   put16(h,16);
+   put64(h,0);
+   put64(h,0);
+   put(h.data(),h.size());
+
+   m_deflate.reset(new deflate_stream(m_file,m_level));
+}
+
+void zip_file::write(const char* data, size_t nbytes)
+{
+   if(!m_deflate) throw std::logic_error("zip_file: no entry");
+   m_deflate->write(data,nbytes);
+}
+
+void zip_file::end_entry()
+{
+   if(!m_deflate) throw std::logic_error("zip_file: no entry");
+
+   m_deflate->finish();
+   entry& e  = m_entries.back();
+   e.crc     = m_deflate->crc();
+   e.size    = m_deflate->size();
+   e.csize   = m_deflate->csize();
+   m_offset += e.csize;
+   m_deflate.reset();
+
+   std::vector<unsigned char> d;
+   put32(d,0x08074b50);
+   put32(d,e.crc);
+   put64(d,e.csize);
+   put64(d,e.size);
+   put(d.data(),d.size());
+}
+
+void zip_file::close()
+{
+   if(m_deflate) end_entry();
+
+   // central directory, with zip64 extra fields only where the values do not fit
+   uint64_t cd_offset = m_offset;
+   for(const entry& e : m_entries) {
+      std::vector<unsigned char> extra;
+      if(e.size   >= zip64_limit) put64(extra,e.size);
+      if(e.csize  >= zip64_limit) put64(extra,e.csize);
+      if(e.offset >= zip64_limit) put64(extra,e.offset);
+
+      std::vector<unsigned char> h;
+      put32(h,0x02014b50);
+      put16(h,45);              // version made by
+      put16(h,45);              // version needed
+      put16(h,0x0808);
+      put16(h,8);
+      put16(h,m_dos_time);
+      put16(h,m_dos_date);
+      put32(h,e.crc);
+      put32(h,static_cast<uint32_t>(std::min<uint64_t>(e.csize,zip64_limit)));
+      put32(h,static_cast<uint32_t>(std::min<uint64_t>(e.size,zip64_limit)));
+      put16(h,static_cast<uint16_t>(e.name.size()));
+      put16(h,static_cast<uint16_t>((extra.size() > 0)? extra.size() + 4 : 0));
+      put16(h,0);               // comment
+      put16(h,0);               // disk
+      put16(h,0);               // internal attributes
+      put32(h,0);               // external attributes
+      put32(h,static_cast<uint32_t>(std::min<uint64_t>(e.offset,zip64_limit)));
+      h.insert(h.end(),e.name.begin(),e.name.end());
+      if(extra.size() > 0) {
+         put16(h,0x0001);
+         put16(h,static_cast<uint16_t>(extra.size()));
+         h.insert(h.end(),extra.begin(),extra.end());
+      }
+      put(h.data(),h.size());
+   }
+   uint64_t cd_size = m_offset - cd_offset;
+
+   std::vector<unsigned char> h;
+   bool zip64 = (cd_offset >= zip64_limit) || (cd_size >= zip64_limit) || (m_entries.size() >= 0xFFFF);
+   if(zip64) {
+      uint64_t eocd64 = m_offset;
+      put32(h,0x06064b50);
+      put64(h,44);
+      put16(h,45);
+      put16(h,45);
+      put32(h,0);
+      put32(h,0);
+      put64(h,m_entries.size());
+      put64(h,m_entries.size());
+      put64(h,cd_size);
+      put64(h,cd_offset);
+
+      put32(h,0x07064b50);
+      put32(h,0);
+      put64(h,eocd64);
+      put32(h,1);
+   }
+   put32(h,0x06054b50);
+   put16(h,0);
+   put16(h,0);
+   put16(h,static_cast<uint16_t>(std::min<size_t>(m_entries.size(),0xFFFF)));
+   put16(h,static_cast<uint16_t>(std::min<size_t>(m_entries.size(),0xFFFF)));
+   put32(h,static_cast<uint32_t>(std::min<uint64_t>(cd_size,zip64_limit)));
+   put32(h,static_cast<uint32_t>(std::min<uint64_t>(cd_offset,zip64_limit)));
+   put16(h,0);
+   put(h.data(),h.size());
+}
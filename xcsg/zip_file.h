@@ -0,0 +1,77 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+#ifndef ZIP_FILE_H
+#define ZIP_FILE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include "deflate_stream.h"
+
+// zip_file writes a zip archive to an open file, for formats stored as zip (compressed AMF, 3MF).
+// Each entry is written as a deflate_stream, compressed in parallel on the thread pool.
+// No seeking is done, the sizes follow the data. Archives and entries above 4GB are written as zip64.
+//
+//    zip_file zip(file);
+//    zip.begin_entry("model.amf");
+//    zip.write(data,nbytes);   // repeated
+//    zip.end_entry();
+//    zip.close();
+//
+// Write errors are thrown as std::runtime_error
+
+class zip_file {
+public:
+   zip_file(FILE* file, int level = -1);
+   virtual ~zip_file();
+
+   // start a new entry, the previous entry must be ended
+   void begin_entry(const std::string& name);
+
+   // append uncompressed data to the current entry
+   void write(const char* data, size_t nbytes);
+
+   // complete the current entry, waiting for its blocks to be compressed
+   void end_entry();
+
+   // write the central directory. The file is not closed
+   void close();
+
+protected:
+   struct entry {
+      std::string name;
+      uint32_t    crc = 0;
+      uint64_t    size = 0;               // uncompressed
+      uint64_t    csize = 0;              // compressed
+      uint64_t    offset = 0;             // of local header
+   };
+
+   // write raw bytes, counting the offset
+   void put(const void* data, size_t nbytes);
+
+private:
+   FILE*                                m_file;
+   int                                  m_level;
+   uint64_t                             m_offset;
+   uint16_t                             m_dos_time;
+   uint16_t                             m_dos_date;
+   std::vector<entry>                   m_entries;
+   std::unique_ptr<deflate_stream>      m_deflate;     // of the current entry
+};
+
+#endif // ZIP_FILE_H
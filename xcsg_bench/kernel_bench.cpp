@@ -0,0 +1,253 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+// kernel_bench drives the main geometry kernels of xcsg in isolation with parameter sweeps,
+// so a regression in one kernel is visible without running complete models.
+// Each kernel is repeated until the minimum time has passed, results are reported as ns/op and items/sec.
+//
+// usage: kernel_bench [--min_time <sec>] [--out <file>] [--engine carve|snap] [kernel ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "carve_boolean.h"
+#include "clipper_boolean.h"
+#include "boolean_timer.h"
+#include "mesh_utils.h"
+#include "primitives2d.h"
+#include "primitives3d.h"
+#include "xpolyhedron.h"
+#include "extrude_mesh.h"
+#include "clipper_csg/tmesh_adapter.h"
+#include "clipper_csg/dmesh_adapter.h"
+#include "qhull/qhull3d.h"
+
+using namespace std;
+
+struct bench_result {
+   string kernel;
+   string param;
+   size_t iterations;
+   double items;          // items processed per operation
+   double ns_per_op;
+   double items_per_sec;
+};
+
+static double g_min_time = 0.5;
+
+// run op repeatedly for at least g_min_time seconds after one warmup call
+static bench_result measure(const string& kernel, const string& param, double items, function<void()> op)
+{
+   op();
+
+   size_t iterations = 0;
+   auto t0 = chrono::steady_clock::now();
+   double elapsed = 0.0;
+   do {
+      op();
+      iterations++;
+      elapsed = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+   } while(elapsed < g_min_time || iterations < 3);
+
+   bench_result r;
+   r.kernel        = kernel;
+   r.param         = param;
+   r.iterations    = iterations;
+   r.items         = items;
+   r.ns_per_op     = 1.0E9*elapsed/iterations;
+   r.items_per_sec = items*iterations/elapsed;
+
+   cout << setw(16) << left << kernel << setw(20) << param << right
+        << setw(16) << fixed << setprecision(0) << r.ns_per_op << " ns/op"
+        << setw(16) << setprecision(0) << r.items_per_sec << " items/sec"
+        << "  (" << iterations << " ops)" << endl;
+   return r;
+}
+
+static std::shared_ptr<clipper_profile> ngon(double r, int n, double x = 0.0, double angle = 0.0)
+{
+   carve::math::Matrix t = carve::math::Matrix::TRANS(x,0,0)*carve::math::Matrix::ROT(angle,0,0,1);
+   std::shared_ptr<clipper_profile> profile(new clipper_profile());
+   profile->AddPaths(primitives2d::make_circle(r,n,t)->paths());
+   return profile;
+}
+
+static void bench_carve_boolean(vector<bench_result>& results)
+{
+   // sphere/sphere union, the sphere resolution follows the secant tolerance
+   const double tol_default = mesh_utils::secant_tolerance();
+   for(double tol : {0.1, 0.05, 0.02, 0.01}) {
+      mesh_utils::set_secant_tolerance(tol);
+      auto a = primitives3d::make_geodesic_sphere(10,-1)->create_carve_mesh();
+      auto b = primitives3d::make_geodesic_sphere(10,-1,carve::math::Matrix::TRANS(5,3,1))->create_carve_mesh();
+      double items = static_cast<double>(carve_boolean::face_count(a) + carve_boolean::face_count(b));
+      results.push_back(measure("carve_boolean","sec_tol=" + to_string(tol).substr(0,4),items,[a,b]() {
+         carve_boolean csg;
+         csg.compute(a,carve::csg::CSG::UNION);
+         csg.compute(b,carve::csg::CSG::UNION);
+      }));
+   }
+   mesh_utils::set_secant_tolerance(tol_default);
+}
+
+static void bench_clipper_boolean(vector<bench_result>& results)
+{
+   // union of two overlapping N-gons
+   for(int n : {16, 256, 4096, 65536}) {
+      auto a = ngon(10,n);
+      auto b = ngon(10,n,5.0,0.5/n);
+      results.push_back(measure("clipper_boolean","ngon=" + to_string(n),2.0*n,[a,b]() {
+         clipper_boolean csg;
+         csg.compute(a,ClipperLib::ctUnion);
+         csg.compute(b,ClipperLib::ctUnion);
+      }));
+   }
+}
+
+static void bench_qhull3d(vector<bench_result>& results)
+{
+   // random points in a cube
+   for(size_t n : {1000, 10000, 100000, 1000000}) {
+      mt19937 gen(12345);
+      uniform_real_distribution<double> dist(-1.0,1.0);
+      vector<double> coords(3*n);
+      for(auto& c : coords) c = dist(gen);
+      results.push_back(measure("qhull3d","points=" + to_string(n),static_cast<double>(n),[&coords,n]() {
+         qhull3d qhull;
+         qhull.reserve(n);
+         for(size_t i=0; i<n; i++) qhull.push_back(coords[3*i],coords[3*i+1],coords[3*i+2]);
+         qhull.compute();
+      }));
+   }
+}
+
+static void bench_tesselate(vector<bench_result>& results)
+{
+   // a large contour with a hole, polygon vertices are the items
+   for(int n : {256, 4096, 32768}) {
+      clipper_boolean csg;
+      csg.compute(ngon(100,n),ClipperLib::ctUnion);
+      csg.compute(ngon(50,n/2),ClipperLib::ctDifference);
+      std::shared_ptr<clipper_profile> profile = csg.profile();
+      double items = 1.5*n;
+
+      results.push_back(measure("tmesh_adapter","contour=" + to_string(n),items,[profile]() {
+         tmesh_adapter tess;
+         tess.tesselate(profile->create_polyset());
+      }));
+      results.push_back(measure("dmesh","contour=" + to_string(n),items,[profile]() {
+         dmesh_adapter tess(-1.0);
+         tess.tesselate(profile->create_polyset());
+      }));
+   }
+}
+
+static void bench_sweep_extrude(vector<bench_result>& results)
+{
+   // a circular profile swept along a helix with n control points
+   const double pi = 4.0*atan(1.0);
+   auto profile = ngon(2,32);
+   for(int n : {16, 64, 256}) {
+      vector<csplines::cpoint> points;
+      for(int i=0; i<n; i++) {
+         double a = 2.0*pi*i/12.0;
+         points.push_back(csplines::cpoint(20*cos(a),20*sin(a),1.0*i,0,0,1));
+      }
+      std::shared_ptr<const csplines::spline_path> path(new csplines::spline_path(points));
+      results.push_back(measure("sweep_extrude","cpoints=" + to_string(n),static_cast<double>(n),[profile,path]() {
+         extrude_mesh::sweep_extrude(profile,path,carve::math::Matrix());
+      }));
+   }
+}
+
+static void usage()
+{
+   cout << "usage: kernel_bench [--min_time <sec>] [--out <file>] [--engine carve|snap] [kernel ...]" << endl;
+   cout << "kernels: carve_boolean clipper_boolean qhull3d tesselate sweep_extrude" << endl;
+}
+
+int main(int argc, char **argv)
+{
+   string out_file;
+   string engine = "carve";
+   vector<string> selected;
+   for(int i=1; i<argc; i++) {
+      string arg = argv[i];
+      bool has_value = (i+1 < argc);
+      if(arg == "--help" || arg == "-h")           { usage(); return 0; }
+      else if(arg == "--min_time" && has_value)    g_min_time = atof(argv[++i]);
+      else if(arg == "--out"      && has_value)    out_file   = argv[++i];
+      else if(arg == "--engine"   && has_value)    engine     = argv[++i];
+      else if(arg.size() > 1 && arg[0] == '-')     { usage(); return 1; }
+      else selected.push_back(arg);
+   }
+
+   vector<pair<string,function<void(vector<bench_result>&)>>> kernels = {
+      { "carve_boolean",   bench_carve_boolean   },
+      { "clipper_boolean", bench_clipper_boolean },
+      { "qhull3d",         bench_qhull3d         },
+      { "tesselate",       bench_tesselate       },
+      { "sweep_extrude",   bench_sweep_extrude   }
+   };
+
+   // the booleans report to the timer, a large total keeps the progress lines away
+   boolean_timer::singleton().init(INT_MAX/2);
+
+   vector<bench_result> results;
+   try {
+      carve_boolean::set_engine(boolean_engine::create(engine));
+      for(auto& k : kernels) {
+         if(selected.empty() || find(selected.begin(),selected.end(),k.first) != selected.end()) {
+            k.second(results);
+         }
+      }
+   }
+   catch(carve::exception& ex) {
+      cout << "(carve error): " << ex.str() << endl;
+      return 1;
+   }
+   catch(exception& ex) {
+      cout << ex.what() << endl;
+      return 1;
+   }
+
+   if(out_file.size() > 0) {
+      ofstream out(out_file);
+      if(!out.is_open()) { cout << "kernel_bench: could not write " << out_file << endl; return 1; }
+      out << setprecision(9);
+      out << "{\"engine\": \"" << engine << "\"," << endl;
+      out << " \"results\": [" << endl;
+      for(size_t i=0; i<results.size(); i++) {
+         const bench_result& r = results[i];
+         out << "  {\"kernel\": \"" << r.kernel << "\", \"param\": \"" << r.param << "\", \"iterations\": " << r.iterations
+             << ", \"items\": " << r.items << ", \"ns_per_op\": " << r.ns_per_op << ", \"items_per_sec\": " << r.items_per_sec
+             << "}" << ((i+1 < results.size())? "," : "") << endl;
+      }
+      out << "]}" << endl;
+      cout << "Created kernel results: " << out_file << endl;
+   }
+   return 0;
+}
@@ -0,0 +1,243 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+// xcsg_bench runs the models of a corpus through xcsg several times and writes the
+// results as JSON, so runs from different commits can be compared.
+// Each run calls xcsg with --timing, which reports the wall time of each phase,
+// the peak resident set size and the result sizes.
+//
+// usage: xcsg_bench [--xcsg <exe>] [--corpus <file>] [--runs <n>] [--warmup <n>]
+//                   [--threads <n>] [--out <file>] [case ...]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+using namespace std;
+
+#ifdef _WIN32
+static const char* null_device = "NUL";
+#else
+static const char* null_device = "/dev/null";
+#endif
+
+struct bench_case {
+   string name;
+   string file;
+   string options;
+};
+
+struct bench_run {
+   int                          status;    // xcsg exit status
+   double                       wall_sec;  // measured by xcsg_bench, including process start
+   map<string,double>           timing;    // phases and values reported by xcsg
+};
+
+// directory part of path, including the trailing separator
+static string dir_of(const string& path)
+{
+   size_t pos = path.find_last_of("/\\");
+   return (pos == string::npos)? string() : path.substr(0,pos+1);
+}
+
+static vector<bench_case> read_corpus(const string& corpus_file)
+{
+   ifstream in(corpus_file);
+   if(!in.is_open()) throw runtime_error("xcsg_bench: could not read corpus " + corpus_file);
+
+   vector<bench_case> cases;
+   string line;
+   while(getline(in,line)) {
+      size_t pos = line.find_first_not_of(" \t\r");
+      if(pos == string::npos || line[pos] == '#') continue;
+
+      istringstream sin(line);
+      bench_case c;
+      sin >> c.name >> c.file;
+      getline(sin,c.options);
+      c.options.erase(0,c.options.find_first_not_of(" \t"));
+      c.options.erase(c.options.find_last_not_of(" \t\r")+1);
+      if(c.options.empty()) c.options = "--stl";
+      c.file = dir_of(corpus_file) + c.file;
+      cases.push_back(c);
+   }
+   return cases;
+}
+
+// read the "name": number pairs of the --timing JSON, the nested object names are
+// dropped, so phases and values end up in the same map
+static map<string,double> read_timing(const string& timing_file)
+{
+   map<string,double> timing;
+   ifstream in(timing_file);
+   if(!in.is_open()) return timing;
+   string text((istreambuf_iterator<char>(in)),istreambuf_iterator<char>());
+
+   size_t pos = 0;
+   while((pos = text.find('"',pos)) != string::npos) {
+      size_t end = text.find('"',pos+1);
+      if(end == string::npos) break;
+      string key = text.substr(pos+1,end-pos-1);
+      size_t colon = text.find_first_not_of(" \t\r\n",end+1);
+      pos = end+1;
+      if(colon == string::npos || text[colon] != ':') continue;
+      size_t value = text.find_first_not_of(" \t\r\n",colon+1);
+      if(value == string::npos || text[value] == '{') continue;
+      timing[key] = atof(text.c_str()+value);
+   }
+   return timing;
+}
+
+static bench_run run_case(const string& xcsg, const bench_case& c, const string& extra_options, const string& timing_file)
+{
+   remove(timing_file.c_str());
+   string cmd = "\"" + xcsg + "\" " + c.options + extra_options + " --timing \"" + timing_file + "\" \"" + c.file + "\" > " + null_device;
+#ifdef _WIN32
+   // cmd.exe strips the outer quotes of the whole command line
+   cmd = "\"" + cmd + "\"";
+#endif
+
+   bench_run run;
+   auto t0 = chrono::steady_clock::now();
+   run.status   = system(cmd.c_str());
+   run.wall_sec = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+   run.timing   = read_timing(timing_file);
+   return run;
+}
+
+static double median(vector<double> values)
+{
+   if(values.empty()) return 0.0;
+   sort(values.begin(),values.end());
+   size_t n = values.size();
+   return (n%2)? values[n/2] : 0.5*(values[n/2-1] + values[n/2]);
+}
+
+static void write_map(ostream& out, const map<string,double>& m)
+{
+   out << "{";
+   for(auto i=m.begin(); i!=m.end(); i++) {
+      out << ((i!=m.begin())? ", " : "") << "\"" << i->first << "\": " << i->second;
+   }
+   out << "}";
+}
+
+static void usage()
+{
+   cout << "usage: xcsg_bench [--xcsg <exe>] [--corpus <file>] [--runs <n>] [--warmup <n>] [--threads <n>] [--out <file>] [case ...]" << endl;
+}
+
+int main(int argc, char **argv)
+{
+   string xcsg        = "xcsg";
+   string corpus_file = "corpus.txt";
+   string out_file    = "xcsg_bench.json";
+   string extra_options;
+   int nruns   = 5;
+   int nwarmup = 1;
+   vector<string> selected;
+
+   for(int i=1; i<argc; i++) {
+      string arg = argv[i];
+      bool has_value = (i+1 < argc);
+      if(arg == "--help" || arg == "-h")          { usage(); return 0; }
+      else if(arg == "--xcsg"    && has_value)    xcsg        = argv[++i];
+      else if(arg == "--corpus"  && has_value)    corpus_file = argv[++i];
+      else if(arg == "--out"     && has_value)    out_file    = argv[++i];
+      else if(arg == "--runs"    && has_value)    nruns       = max(1,atoi(argv[++i]));
+      else if(arg == "--warmup"  && has_value)    nwarmup     = max(0,atoi(argv[++i]));
+      else if(arg == "--threads" && has_value)    extra_options += string(" --threads ") + argv[++i];
+      else if(arg.size() > 1 && arg[0] == '-')    { usage(); return 1; }
+      else selected.push_back(arg);
+   }
+
+   try {
+      vector<bench_case> cases = read_corpus(corpus_file);
+      if(selected.size() > 0) {
+         cases.erase(remove_if(cases.begin(),cases.end(),[&selected](const bench_case& c) {
+            return find(selected.begin(),selected.end(),c.name) == selected.end();
+         }),cases.end());
+      }
+      if(cases.empty()) throw runtime_error("xcsg_bench: no cases to run");
+
+      ofstream out(out_file);
+      if(!out.is_open()) throw runtime_error("xcsg_bench: could not write " + out_file);
+      string timing_file = out_file + ".timing";
+
+      out << setprecision(6);
+      out << "{" << endl;
+      out << "  \"xcsg\": \"" << xcsg << "\"," << endl;
+      out << "  \"runs\": " << nruns << "," << endl;
+      out << "  \"warmup\": " << nwarmup << "," << endl;
+      out << "  \"cases\": [" << endl;
+
+      for(size_t icase=0; icase<cases.size(); icase++) {
+         const bench_case& c = cases[icase];
+         cout << c.name << ": " << flush;
+
+         for(int i=0; i<nwarmup; i++) run_case(xcsg,c,extra_options,timing_file);
+
+         vector<bench_run> runs;
+         for(int i=0; i<nruns; i++) runs.push_back(run_case(xcsg,c,extra_options,timing_file));
+
+         // medians over the successful runs
+         map<string,vector<double>> samples;
+         size_t nfailed = 0;
+         for(auto& run : runs) {
+            if(run.status != 0) { nfailed++; continue; }
+            samples["wall_sec"].push_back(run.wall_sec);
+            for(auto& t : run.timing) samples[t.first].push_back(t.second);
+         }
+         map<string,double> medians;
+         for(auto& s : samples) medians[s.first] = median(s.second);
+
+         cout << setprecision(4) << medians["wall_sec"] << " [sec] median";
+         if(nfailed > 0) cout << ", " << nfailed << " failed";
+         cout << endl;
+
+         out << "    {\"name\": \"" << c.name << "\", \"file\": \"" << c.file << "\", \"options\": \"" << c.options << "\"," << endl;
+         out << "     \"failed\": " << nfailed << "," << endl;
+         out << "     \"median\": ";
+         write_map(out,medians);
+         out << "," << endl;
+         out << "     \"runs\": [" << endl;
+         for(size_t irun=0; irun<runs.size(); irun++) {
+            out << "       {\"status\": " << runs[irun].status << ", \"wall_sec\": " << runs[irun].wall_sec << ", \"timing\": ";
+            write_map(out,runs[irun].timing);
+            out << "}" << ((irun+1 < runs.size())? "," : "") << endl;
+         }
+         out << "     ]}" << ((icase+1 < cases.size())? "," : "") << endl;
+      }
+      out << "  ]" << endl;
+      out << "}" << endl;
+      remove(timing_file.c_str());
+
+      cout << "Created benchmark results: " << out_file << endl;
+   }
+   catch(exception& ex) {
+      cout << ex.what() << endl;
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,352 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+// xcsg_bench_compare compares two result files written by xcsg_bench, a baseline and a new build.
+// For every case found in both files, each metric (the wall time, the phase times and the peak
+// memory) is compared over the successful runs: median, median absolute deviation (MAD) and the
+// relative change of the median. The Mann-Whitney U test tells whether the runs of the two builds
+// differ by more than run to run noise, exact for small run counts without ties. A change larger
+// than the threshold with a p-value below alpha is flagged as a regression (or improvement).
+// The exit status is 1 when any regression is found, so the comparison can gate an upgrade.
+// At least 4 runs per build are needed for a significant result at alpha=0.05.
+//
+// usage: xcsg_bench_compare [--threshold <percent>] [--alpha <p>] [--metrics <m1,m2,...>] [--all] <baseline.json> <new.json>
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+// the subset of JSON written by xcsg_bench: objects, arrays, strings and numbers
+struct json_value {
+   enum kind { null_kind, number_kind, string_kind, array_kind, object_kind };
+   kind                                    type = null_kind;
+   double                                  number = 0.0;
+   string                                  text;
+   vector<json_value>                      items;
+   vector<pair<string,json_value>>         members;
+
+   const json_value* find(const string& key) const
+   {
+      for(auto& m : members) if(m.first == key) return &m.second;
+      return nullptr;
+   }
+};
+
+class json_reader {
+public:
+   json_reader(const string& text) : m_text(text), m_pos(0) {}
+
+   json_value read()
+   {
+      json_value v = value();
+      skip();
+      if(m_pos != m_text.size()) error("unexpected text after value");
+      return v;
+   }
+
+private:
+   void error(const string& msg) const
+   {
+      throw runtime_error("xcsg_bench_compare: invalid JSON at offset " + to_string(m_pos) + ": " + msg);
+   }
+
+   void skip()
+   {
+      while(m_pos < m_text.size() && isspace(static_cast<unsigned char>(m_text[m_pos]))) m_pos++;
+   }
+
+   bool accept(char c)
+   {
+      skip();
+      if(m_pos < m_text.size() && m_text[m_pos] == c) { m_pos++; return true; }
+      return false;
+   }
+
+   void expect(char c)
+   {
+      if(!accept(c)) error(string("expected '") + c + "'");
+   }
+
+   string str()
+   {
+      expect('"');
+      string s;
+      while(m_pos < m_text.size() && m_text[m_pos] != '"') {
+         if(m_text[m_pos] == '\\' && m_pos+1 < m_text.size()) m_pos++;
+         s += m_text[m_pos++];
+      }
+      expect('"');
+      return s;
+   }
+
+   json_value value()
+   {
+      json_value v;
+      skip();
+      if(m_pos >= m_text.size()) error("unexpected end");
+      char c = m_text[m_pos];
+      if(c == '{') {
+         v.type = json_value::object_kind;
+         m_pos++;
+         if(!accept('}')) {
+            do {
+               string key = str();
+               expect(':');
+               v.members.push_back(make_pair(key,value()));
+            } while(accept(','));
+            expect('}');
+         }
+      }
+      else if(c == '[') {
+         v.type = json_value::array_kind;
+         m_pos++;
+         if(!accept(']')) {
+            do { v.items.push_back(value()); } while(accept(','));
+            expect(']');
+         }
+      }
+      else if(c == '"') {
+         v.type = json_value::string_kind;
+         v.text = str();
+      }
+      else {
+         const char* begin = m_text.c_str() + m_pos;
+         char* end = nullptr;
+         v.number = strtod(begin,&end);
+         if(end == begin) {
+            if(m_text.compare(m_pos,4,"null") != 0) error("expected a value");
+            m_pos += 4;
+            return v;
+         }
+         v.type = json_value::number_kind;
+         m_pos += end - begin;
+      }
+      return v;
+   }
+
+   const string& m_text;
+   size_t        m_pos;
+};
+
+// samples[case][metric] = values of the successful runs
+typedef map<string,map<string,vector<double>>> bench_samples;
+
+static bench_samples read_results(const string& path)
+{
+   ifstream in(path);
+   if(!in.is_open()) throw runtime_error("xcsg_bench_compare: could not read " + path);
+   string text((istreambuf_iterator<char>(in)),istreambuf_iterator<char>());
+   json_value root = json_reader(text).read();
+
+   bench_samples samples;
+   const json_value* cases = root.find("cases");
+   if(!cases || cases->type != json_value::array_kind) throw runtime_error("xcsg_bench_compare: no cases in " + path);
+   for(auto& c : cases->items) {
+      const json_value* name = c.find("name");
+      const json_value* runs = c.find("runs");
+      if(!name || !runs) continue;
+      auto& metrics = samples[name->text];
+      for(auto& run : runs->items) {
+         const json_value* status = run.find("status");
+         if(status && status->number != 0.0) continue;
+         if(const json_value* wall = run.find("wall_sec")) metrics["wall_sec"].push_back(wall->number);
+         if(const json_value* timing = run.find("timing")) {
+            for(auto& t : timing->members) metrics[t.first].push_back(t.second.number);
+         }
+      }
+   }
+   return samples;
+}
+
+static double median(vector<double> values)
+{
+   if(values.empty()) return 0.0;
+   sort(values.begin(),values.end());
+   size_t n = values.size();
+   return (n%2)? values[n/2] : 0.5*(values[n/2-1] + values[n/2]);
+}
+
+// median absolute deviation from the median
+static double mad(const vector<double>& values)
+{
+   double m = median(values);
+   vector<double> dev;
+   for(double v : values) dev.push_back(fabs(v - m));
+   return median(dev);
+}
+
+// two-sided p-value of the Mann-Whitney U test of samples a and b. Without ties and with few
+// samples the exact distribution of U is counted, otherwise the normal approximation is used
+static double mann_whitney_p(const vector<double>& a, const vector<double>& b)
+{
+   size_t n1 = a.size(), n2 = b.size();
+   if(n1 == 0 || n2 == 0) return 1.0;
+
+   // ranks of the pooled samples, ties get their average rank
+   vector<pair<double,size_t>> pooled;
+   for(double v : a) pooled.push_back(make_pair(v,0));
+   for(double v : b) pooled.push_back(make_pair(v,1));
+   sort(pooled.begin(),pooled.end());
+   size_t n = pooled.size();
+   double rank_sum_a = 0.0;
+   double tie_term   = 0.0;
+   bool   ties       = false;
+   for(size_t i=0; i<n; ) {
+      size_t j = i;
+      while(j+1 < n && pooled[j+1].first == pooled[i].first) j++;
+      double rank = 0.5*(i + j) + 1.0;
+      for(size_t k=i; k<=j; k++) if(pooled[k].second == 0) rank_sum_a += rank;
+      double t = static_cast<double>(j - i + 1);
+      if(t > 1) { ties = true; tie_term += t*t*t - t; }
+      i = j+1;
+   }
+   double u    = rank_sum_a - 0.5*n1*(n1+1);
+   double umin = min(u,n1*n2 - u);
+
+   if(!ties && n1 <= 20 && n2 <= 20) {
+      // count[i][j][k] = number of orderings of i values of a and j values of b with U=k
+      size_t umax = n1*n2;
+      vector<vector<vector<double>>> count(n1+1,vector<vector<double>>(n2+1,vector<double>(umax+1,0.0)));
+      for(size_t i=0; i<=n1; i++) {
+         for(size_t j=0; j<=n2; j++) {
+            if(i == 0 || j == 0) { count[i][j][0] = 1.0; continue; }
+            for(size_t k=0; k<=i*j; k++) {
+               // the largest value is from a (adds j to U) or from b
+               count[i][j][k] = ((k >= j)? count[i-1][j][k-j] : 0.0) + ((k <= i*(j-1))? count[i][j-1][k] : 0.0);
+            }
+         }
+      }
+      double total = 0.0, tail = 0.0;
+      for(size_t k=0; k<=umax; k++) {
+         total += count[n1][n2][k];
+         if(k <= umin + 1.0E-9) tail += count[n1][n2][k];
+      }
+      return min(1.0,2.0*tail/total);
+   }
+
+   double mean  = 0.5*n1*n2;
+   double var   = n1*n2/12.0*((n + 1) - tie_term/(static_cast<double>(n)*(n - 1)));
+   if(var <= 0.0) return 1.0;
+   double z = (fabs(u - mean) - 0.5)/sqrt(var);
+   return min(1.0,erfc(max(0.0,z)/sqrt(2.0)));
+}
+
+static vector<string> split(const string& list)
+{
+   vector<string> items;
+   istringstream in(list);
+   string item;
+   while(getline(in,item,',')) if(item.size() > 0) items.push_back(item);
+   return items;
+}
+
+static void usage()
+{
+   cout << "usage: xcsg_bench_compare [--threshold <percent>] [--alpha <p>] [--metrics <m1,m2,...>] [--all] <baseline.json> <new.json>" << endl;
+}
+
+int main(int argc, char **argv)
+{
+   double threshold = 5.0;
+   double alpha     = 0.05;
+   bool   show_all  = false;
+   vector<string> metrics = { "wall_sec", "parse", "csg", "triangulate", "export", "peak_rss_kb" };
+   vector<string> files;
+
+   for(int i=1; i<argc; i++) {
+      string arg = argv[i];
+      bool has_value = (i+1 < argc);
+      if(arg == "--help" || arg == "-h")            { usage(); return 0; }
+      else if(arg == "--threshold" && has_value)    threshold = atof(argv[++i]);
+      else if(arg == "--alpha"     && has_value)    alpha     = atof(argv[++i]);
+      else if(arg == "--metrics"   && has_value)    metrics   = split(argv[++i]);
+      else if(arg == "--all")                       show_all  = true;
+      else if(arg.size() > 1 && arg[0] == '-')      { usage(); return 1; }
+      else files.push_back(arg);
+   }
+   if(files.size() != 2) { usage(); return 1; }
+
+   size_t nregressions = 0;
+   try {
+      bench_samples base = read_results(files[0]);
+      bench_samples test = read_results(files[1]);
+
+      cout << left << setw(20) << "case" << setw(13) << "metric" << right
+           << setw(11) << "base" << setw(9) << "mad" << setw(11) << "new" << setw(9) << "mad"
+           << setw(9) << "change" << setw(8) << "p" << "  " << endl;
+
+      size_t ncompared = 0, nimproved = 0, nfew = 0;
+      for(auto& c : base) {
+         auto it = test.find(c.first);
+         if(it == test.end()) {
+            cout << left << setw(20) << c.first << "missing in " << files[1] << endl;
+            continue;
+         }
+         for(auto& metric : metrics) {
+            auto a = c.second.find(metric);
+            auto b = it->second.find(metric);
+            if(a == c.second.end() || b == it->second.end()) continue;
+
+            double ma = median(a->second);
+            double mb = median(b->second);
+            double change = (ma > 0.0)? 100.0*(mb - ma)/ma : 0.0;
+            double p = mann_whitney_p(a->second,b->second);
+            if(min(a->second.size(),b->second.size()) < 4) nfew++;
+            ncompared++;
+
+            string flag;
+            if(p < alpha && change >  threshold) { flag = "REGRESSION"; nregressions++; }
+            if(p < alpha && change < -threshold) { flag = "improved";   nimproved++; }
+            if(flag.empty() && !show_all) continue;
+
+            ostringstream pct;
+            pct << showpos << fixed << setprecision(1) << change << "%";
+            cout << left << setw(20) << c.first << setw(13) << metric << right << setprecision(4)
+                 << setw(11) << ma << setw(9) << mad(a->second)
+                 << setw(11) << mb << setw(9) << mad(b->second)
+                 << setw(9) << pct.str() << setw(8) << setprecision(2) << p << "  " << flag << endl;
+         }
+
+         // a change of the result sizes means the builds compute different models
+         auto ta = c.second.find("triangles");
+         auto tb = it->second.find("triangles");
+         if(ta != c.second.end() && tb != it->second.end() && median(ta->second) != median(tb->second)) {
+            cout << left << setw(20) << c.first << "triangles differ: " << setprecision(10) << median(ta->second) << " -> " << median(tb->second) << endl;
+         }
+      }
+
+      cout << ncompared << " comparisons, " << nregressions << " regressions, " << nimproved << " improvements"
+           << " (threshold " << threshold << "%, alpha " << alpha << ")" << endl;
+      if(nfew > 0) cout << "Warning: " << nfew << " comparisons have fewer than 4 runs per build, use --runs 5 or more in xcsg_bench" << endl;
+   }
+   catch(exception& ex) {
+      cout << ex.what() << endl;
+      return 1;
+   }
+   return (nregressions > 0)? 1 : 0;
+}
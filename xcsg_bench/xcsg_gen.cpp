@@ -0,0 +1,246 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+// xcsg_gen writes synthetic .xcsg models of controllable size for stress testing.
+// The primitives are placed on a regular grid, the spacing is given by the overlap ratio so that
+// neighbouring primitives intersect. The primitives are grouped into a balanced tree of booleans
+// with the requested depth. The lowest groups of neighbour primitives draw their boolean operation
+// from the operation mix, the groups above are unions, as differences and intersections between
+// groups far apart would remove most of the model.
+// With a 2d blend, the lowest groups become linear extrusions of 2d booleans.
+//
+// usage: xcsg_gen [--primitives <n>] [--depth <n>] [--overlap <ratio>] [--ops <union,difference,intersection>]
+//                 [--blend2d <ratio>] [--secant_tolerance <tol>] [--seed <n>] --out <file>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+struct gen_options {
+   size_t primitives       = 1000;
+   int    depth            = 4;
+   double overlap          = 0.3;      // 0 = touching primitives, approaching 1 = coincident
+   double w_union          = 0.7;      // operation mix, relative weights
+   double w_difference     = 0.2;
+   double w_intersection   = 0.1;
+   double blend2d          = 0.0;      // 0 = 3d only, 1 = 2d model, in between share of extruded 2d groups
+   double secant_tolerance = 0.1;
+   unsigned seed           = 1;
+   string out;
+};
+
+class model_generator {
+public:
+   model_generator(const gen_options& opt)
+   : m_opt(opt)
+   , m_gen(opt.seed)
+   , m_radius(5.0)
+   , m_nodes(0)
+   {
+      m_model2d = (opt.blend2d >= 1.0);
+      double dim = (m_model2d)? 2.0 : 3.0;
+      m_grid    = static_cast<size_t>(ceil(pow(static_cast<double>(opt.primitives),1.0/dim) - 1.0E-9));
+      m_grid    = max<size_t>(m_grid,1);
+      m_spacing = 2.0*m_radius*(1.0 - min(max(opt.overlap,0.0),0.95));
+   }
+
+   size_t nodes() const { return m_nodes; }
+
+   void write(ostream& out)
+   {
+      out << "<?xml version=\"1.0\" encoding=\"utf-8\"?>\n";
+      out << "<xcsg version=\"1.0\" secant_tolerance=\"" << m_opt.secant_tolerance << "\">\n";
+      out << "\t<metadata>\n";
+      out << "\t\t<model name=\"xcsg_gen\" primitives=\"" << m_opt.primitives << "\" depth=\"" << m_opt.depth
+          << "\" overlap=\"" << m_opt.overlap << "\" blend2d=\"" << m_opt.blend2d << "\" seed=\"" << m_opt.seed << "\"/>\n";
+      out << "\t</metadata>\n";
+      write_tree(out,0,m_opt.primitives,0,m_model2d,1);
+      out << "</xcsg>\n";
+   }
+
+protected:
+   // write the subtree for primitives [first,first+count) at tree level
+   void write_tree(ostream& out, size_t first, size_t count, int level, bool is2d, int indent)
+   {
+      if(count == 1) {
+         write_primitive(out,first,is2d,indent);
+         return;
+      }
+
+      int levels_left = max(m_opt.depth - level,1);
+      size_t fanout = (levels_left == 1)? count : static_cast<size_t>(ceil(pow(static_cast<double>(count),1.0/levels_left)));
+      fanout = min(max<size_t>(fanout,2),count);
+
+      // the lowest 3d groups may become extruded 2d groups
+      if(!is2d && levels_left == 1 && m_opt.blend2d > 0.0 && m_uniform(m_gen) < m_opt.blend2d) {
+         xvec p = position(first);
+         out << tabs(indent) << "<linear_extrude dz=\"" << 2.0*m_radius << "\">\n";
+         write_tree(out,first,count,level,true,indent+1);
+         write_tmatrix(out,0.0,0.0,p.z-m_radius,indent+1);
+         out << tabs(indent) << "</linear_extrude>\n";
+         m_nodes++;
+         return;
+      }
+
+      string tag = (levels_left == 1)? boolean_tag(is2d) : string((is2d)? "union2d" : "union3d");
+      out << tabs(indent) << "<" << tag << ">\n";
+      m_nodes++;
+      size_t pos = first;
+      for(size_t i=0; i<fanout; i++) {
+         // spread the remainder over the first children
+         size_t n = count/fanout + ((i < count%fanout)? 1 : 0);
+         write_tree(out,pos,n,level+1,is2d,indent+1);
+         pos += n;
+      }
+      out << tabs(indent) << "</" << tag << ">\n";
+   }
+
+   void write_primitive(ostream& out, size_t index, bool is2d, int indent)
+   {
+      xvec p = position(index);
+      int kind = m_kind(m_gen);
+      double r = m_radius;
+      if(is2d) {
+         if(kind%2 == 0) out << tabs(indent) << "<circle r=\"" << r << "\">\n";
+         else            out << tabs(indent) << "<square size=\"" << 2*r << "\" center=\"true\">\n";
+         write_tmatrix(out,p.x,p.y,0.0,indent+1);
+         out << tabs(indent) << ((kind%2 == 0)? "</circle>\n" : "</square>\n");
+      }
+      else {
+         const char* tag = (kind == 0)? "sphere" : ((kind == 1)? "cube" : "cylinder");
+         if(kind == 0)      out << tabs(indent) << "<sphere r=\"" << r << "\">\n";
+         else if(kind == 1) out << tabs(indent) << "<cube size=\"" << 2*r << "\" center=\"true\">\n";
+         else               out << tabs(indent) << "<cylinder r=\"" << r << "\" h=\"" << 2*r << "\" center=\"true\">\n";
+         write_tmatrix(out,p.x,p.y,p.z,indent+1);
+         out << tabs(indent) << "</" << tag << ">\n";
+      }
+      m_nodes++;
+   }
+
+   void write_tmatrix(ostream& out, double x, double y, double z, int indent)
+   {
+      string t = tabs(indent);
+      out << t << "<tmatrix>\n";
+      out << t << "\t<trow c0=\"1\" c1=\"0\" c2=\"0\" c3=\"" << x << "\"/>\n";
+      out << t << "\t<trow c0=\"0\" c1=\"1\" c2=\"0\" c3=\"" << y << "\"/>\n";
+      out << t << "\t<trow c0=\"0\" c1=\"0\" c2=\"1\" c3=\"" << z << "\"/>\n";
+      out << t << "\t<trow c0=\"0\" c1=\"0\" c2=\"0\" c3=\"1\"/>\n";
+      out << t << "</tmatrix>\n";
+   }
+
+   string boolean_tag(bool is2d)
+   {
+      double total = m_opt.w_union + m_opt.w_difference + m_opt.w_intersection;
+      double u = m_uniform(m_gen)*total;
+      string op = "union";
+      if(u >= m_opt.w_union) op = (u < m_opt.w_union + m_opt.w_difference)? "difference" : "intersection";
+      return op + ((is2d)? "2d" : "3d");
+   }
+
+private:
+   struct xvec { double x,y,z; };
+
+   // grid position of primitive index, rows along x first
+   xvec position(size_t index) const
+   {
+      xvec p;
+      p.x = m_spacing*(index%m_grid);
+      p.y = m_spacing*((index/m_grid)%m_grid);
+      p.z = (m_model2d)? 0.0 : m_spacing*(index/(m_grid*m_grid));
+      return p;
+   }
+
+   static const string& tabs(int indent)
+   {
+      static vector<string> cache;
+      while(static_cast<int>(cache.size()) <= indent) cache.push_back(string(cache.size(),'\t'));
+      return cache[indent];
+   }
+
+private:
+   gen_options                       m_opt;
+   mt19937                           m_gen;
+   uniform_real_distribution<double> m_uniform;
+   uniform_int_distribution<int>     m_kind{0,2};
+   double                            m_radius;
+   double                            m_spacing;
+   size_t                            m_grid;
+   bool                              m_model2d;
+   size_t                            m_nodes;      // boolean, extrusion and primitive nodes written
+};
+
+// parse "union,difference,intersection" weights
+static void parse_ops(const string& value, gen_options& opt)
+{
+   string v(value);
+   replace(v.begin(),v.end(),',',' ');
+   istringstream in(v);
+   if(!(in >> opt.w_union >> opt.w_difference >> opt.w_intersection)) {
+      throw runtime_error("xcsg_gen: --ops expects 3 comma separated weights, got " + value);
+   }
+   if(opt.w_union < 0 || opt.w_difference < 0 || opt.w_intersection < 0 || opt.w_union + opt.w_difference + opt.w_intersection <= 0) {
+      throw runtime_error("xcsg_gen: --ops weights must be non-negative with a positive sum");
+   }
+}
+
+static void usage()
+{
+   cout << "usage: xcsg_gen [--primitives <n>] [--depth <n>] [--overlap <ratio>] [--ops <union,difference,intersection>]" << endl;
+   cout << "                [--blend2d <ratio>] [--secant_tolerance <tol>] [--seed <n>] --out <file>" << endl;
+}
+
+int main(int argc, char **argv)
+{
+   gen_options opt;
+   try {
+      for(int i=1; i<argc; i++) {
+         string arg = argv[i];
+         bool has_value = (i+1 < argc);
+         if(arg == "--help" || arg == "-h")                   { usage(); return 0; }
+         else if(arg == "--primitives" && has_value)          opt.primitives       = max(1L,atol(argv[++i]));
+         else if(arg == "--depth" && has_value)               opt.depth            = max(1,atoi(argv[++i]));
+         else if(arg == "--overlap" && has_value)             opt.overlap          = atof(argv[++i]);
+         else if(arg == "--ops" && has_value)                 parse_ops(argv[++i],opt);
+         else if(arg == "--blend2d" && has_value)             opt.blend2d          = atof(argv[++i]);
+         else if(arg == "--secant_tolerance" && has_value)    opt.secant_tolerance = atof(argv[++i]);
+         else if(arg == "--seed" && has_value)                opt.seed             = static_cast<unsigned>(atol(argv[++i]));
+         else if(arg == "--out" && has_value)                 opt.out              = argv[++i];
+         else                                                 { usage(); return 1; }
+      }
+      if(opt.out.empty()) { usage(); return 1; }
+
+      ofstream out(opt.out);
+      if(!out.is_open()) throw runtime_error("xcsg_gen: could not write " + opt.out);
+
+      model_generator gen(opt);
+      gen.write(out);
+      out.close();
+      cout << "xcsg_gen: created " << opt.out << " with " << gen.nodes() << " nodes, " << opt.primitives << " primitives" << endl;
+   }
+   catch(exception& ex) {
+      cout << ex.what() << endl;
+      return 1;
+   }
+   return 0;
+}
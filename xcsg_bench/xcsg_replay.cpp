@@ -0,0 +1,188 @@
+// BeginLicense:
+// Part of: xcsg - XML based Constructive Solid Geometry
+// Copyright (C) 2017-2020 Carsten Arnholm
+// All rights reserved
+//
+// This file may be used under the terms of either the GNU General
+// Public License version 2 or 3 (at your option) as published by the
+// Free Software Foundation and appearing in the files LICENSE.GPL2
+// and LICENSE.GPL3 included in the packaging of this file.
+//
+// This file is provided "AS IS" with NO WARRANTY OF ANY KIND,
+// INCLUDING THE WARRANTIES OF DESIGN, MERCHANTABILITY AND FITNESS FOR
+// A PARTICULAR PURPOSE. ALL COPIES OF THIS FILE MUST INCLUDE THIS LICENSE.
+// EndLicense:
+
+
+// xcsg_replay runs a boolean captured by xcsg --capture_booleans alone, so a slow boolean of a real
+// model can be profiled and compared between engines without the model. The capture file names the
+// operation and the operand xmesh files, see carve_boolean::capture. The boolean is repeated until the
+// minimum time has passed, like a kernel of kernel_bench, and reported as ns/op and faces/sec.
+//
+// usage: xcsg_replay [--min_time <sec>] [--out <file>] [--engine carve|snap|sdf] capture.txt ...
+
+#include <chrono>
+#include <climits>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "carve_boolean.h"
+#include "boolean_timer.h"
+#include "xmesh_file.h"
+
+using namespace std;
+
+struct replay_result {
+   string capture;
+   string operation;
+   string engine;
+   size_t iterations;
+   double faces;          // operand faces per operation
+   size_t result_faces;
+   double captured_sec;   // time of the boolean in the captured model
+   double ns_per_op;
+   double faces_per_sec;
+};
+
+static double g_min_time = 0.5;
+
+// capture file: one "key value" pair per line
+static map<string,string> read_capture(const string& path)
+{
+   ifstream in(path);
+   if(!in.is_open()) throw runtime_error("xcsg_replay: could not read " + path);
+   map<string,string> values;
+   string line;
+   while(getline(in,line)) {
+      istringstream is(line);
+      string key,value;
+      if(is >> key >> value) values[key] = value;
+   }
+   for(auto key : { "operation", "operand_a", "operand_b" }) {
+      if(values.find(key) == values.end()) throw runtime_error("xcsg_replay: no " + string(key) + " in " + path);
+   }
+   return values;
+}
+
+// run op repeatedly for at least g_min_time seconds after one warmup call
+static void measure(replay_result& r, function<void()> op)
+{
+   op();
+
+   size_t iterations = 0;
+   auto t0 = chrono::steady_clock::now();
+   double elapsed = 0.0;
+   do {
+      op();
+      iterations++;
+      elapsed = chrono::duration<double>(chrono::steady_clock::now() - t0).count();
+   } while(elapsed < g_min_time || iterations < 3);
+
+   r.iterations    = iterations;
+   r.ns_per_op     = 1.0E9*elapsed/iterations;
+   r.faces_per_sec = r.faces*iterations/elapsed;
+}
+
+static replay_result replay(const string& capture_file, const string& engine)
+{
+   map<string,string> values = read_capture(capture_file);
+   boost::filesystem::path dir = boost::filesystem::path(capture_file).parent_path();
+
+   // the operands are not modified by the boolean, so they are read once
+   auto a = xmesh_reader((dir / values["operand_a"]).string()).create_carve_mesh();
+   auto b = xmesh_reader((dir / values["operand_b"]).string()).create_carve_mesh();
+   carve::csg::CSG::OP op = carve_boolean::boolean_op(values["operation"]);
+
+   // the engine of the capture unless another is given
+   replay_result r;
+   r.capture      = capture_file;
+   r.operation    = values["operation"];
+   r.engine       = (engine.length() > 0)? engine : ((values.count("engine"))? values["engine"] : "carve");
+   r.faces        = static_cast<double>(carve_boolean::face_count(a) + carve_boolean::face_count(b));
+   r.captured_sec = (values.count("seconds"))? atof(values["seconds"].c_str()) : 0.0;
+   carve_boolean::set_engine(boolean_engine::create(r.engine));
+
+   size_t result_faces = 0;
+   measure(r,[a,b,op,&result_faces]() {
+      carve_boolean csg;
+      csg.compute(a,carve::csg::CSG::UNION);
+      csg.compute(b,op);
+      result_faces = carve_boolean::face_count(csg.mesh_set());
+   });
+   r.result_faces = result_faces;
+
+   cout << setw(24) << left << boost::filesystem::path(capture_file).filename().string()
+        << setw(22) << (r.operation + " " + r.engine) << right
+        << setw(16) << fixed << setprecision(0) << r.ns_per_op << " ns/op"
+        << setw(16) << setprecision(0) << r.faces_per_sec << " faces/sec"
+        << setw(12) << r.result_faces << " faces"
+        << "  (" << r.iterations << " ops, captured " << setprecision(3) << r.captured_sec << " sec)" << endl;
+   return r;
+}
+
+static void usage()
+{
+   cout << "usage: xcsg_replay [--min_time <sec>] [--out <file>] [--engine carve|snap|sdf] capture.txt ..." << endl;
+   cout << "capture files are written by xcsg --capture_booleans, e.g. model.xcsg_capture/boolean_0001.txt" << endl;
+}
+
+int main(int argc, char **argv)
+{
+   string out_file;
+   string engine;
+   vector<string> captures;
+   for(int i=1; i<argc; i++) {
+      string arg = argv[i];
+      bool has_value = (i+1 < argc);
+      if(arg == "--help" || arg == "-h")           { usage(); return 0; }
+      else if(arg == "--min_time" && has_value)    g_min_time = atof(argv[++i]);
+      else if(arg == "--out"      && has_value)    out_file   = argv[++i];
+      else if(arg == "--engine"   && has_value)    engine     = argv[++i];
+      else if(arg.size() > 1 && arg[0] == '-')     { usage(); return 1; }
+      else captures.push_back(arg);
+   }
+   if(captures.empty()) { usage(); return 1; }
+
+   // the booleans report to the timer, a large total keeps the progress lines away
+   boolean_timer::singleton().init(INT_MAX/2);
+
+   vector<replay_result> results;
+   try {
+      for(auto& c : captures) results.push_back(replay(c,engine));
+   }
+   catch(carve::exception& ex) {
+      cout << "(carve error): " << ex.str() << endl;
+      return 1;
+   }
+   catch(exception& ex) {
+      cout << ex.what() << endl;
+      return 1;
+   }
+
+   if(out_file.size() > 0) {
+      ofstream out(out_file);
+      if(!out.is_open()) { cout << "xcsg_replay: could not write " << out_file << endl; return 1; }
+      out << setprecision(9);
+      out << "{\"results\": [" << endl;
+      for(size_t i=0; i<results.size(); i++) {
+         const replay_result& r = results[i];
+         string capture = boost::filesystem::path(r.capture).generic_string();
+         out << "  {\"capture\": \"" << capture << "\", \"operation\": \"" << r.operation << "\", \"engine\": \"" << r.engine
+             << "\", \"iterations\": " << r.iterations << ", \"faces\": " << r.faces << ", \"result_faces\": " << r.result_faces
+             << ", \"captured_sec\": " << r.captured_sec << ", \"ns_per_op\": " << r.ns_per_op << ", \"faces_per_sec\": " << r.faces_per_sec
+             << "}" << ((i+1 < results.size())? "," : "") << endl;
+      }
+      out << "]}" << endl;
+      cout << "Created replay results: " << out_file << endl;
+   }
+   return 0;
+}